@@ -48,6 +48,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(picohash_open)
+        {
+            int ret = picohash_open_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(picohash_bytes)
         {
             int ret = picohash_bytes_test();
@@ -202,6 +209,62 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(sockloop_recv_batch)
+        {
+            int ret = sockloop_recv_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_epoll)
+        {
+            int ret = sockloop_epoll_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_uring)
+        {
+            int ret = sockloop_uring_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_send_batch)
+        {
+            int ret = sockloop_send_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_send_batch_peers)
+        {
+            int ret = sockloop_send_batch_peers_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_send_batch_partial)
+        {
+            int ret = sockloop_send_batch_partial_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_send_batch_eio)
+        {
+            int ret = sockloop_send_batch_eio_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(sockloop_shard)
+        {
+            int ret = sockloop_shard_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(splay)
         {
             int ret = splay_test();
@@ -209,6 +272,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(wheel)
+        {
+            int ret = wheel_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(picoindex)
+        {
+            int ret = picoindex_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(create_cnx)
         {
             int ret = create_cnx_test();
@@ -328,6 +405,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(binlog_writer)
+        {
+            int ret = binlog_writer_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(app_message_overflow)
         {
             int ret = app_message_overflow_test();
@@ -356,12 +440,26 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(stream_index)
+        {
+            int ret = stream_index_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(stream_output)
         {
             int ret = stream_output_test();
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(stream_buffers)
+        {
+            int ret = stream_buffers_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         TEST_METHOD(stream_retransmit_copy)
         {
             int ret = test_copy_for_retransmit();
@@ -486,6 +584,7 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
         
         TEST_METHOD(test_pn_enc_1rtt)
         {
@@ -551,6 +650,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
         
+        TEST_METHOD(test_tls_api_open_tables)
+        {
+            int ret = tls_api_open_tables_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(test_silence)
         {
             int ret = tls_api_silence_test();
@@ -684,6 +790,20 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(datagram_ring)
+        {
+            int ret = datagram_ring_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(datagram_queue)
+        {
+            int ret = datagram_queue_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(ddos_amplification)
         {
             int ret = ddos_amplification_test();
@@ -1012,6 +1132,13 @@ namespace UnitTest1
 
             Assert::AreEqual(ret, 0);
         }
+
+        TEST_METHOD(test_sockets_gro)
+        {
+            int ret = socket_gro_test();
+
+            Assert::AreEqual(ret, 0);
+        }
         
         TEST_METHOD(ticket_store)
         {
@@ -1104,6 +1231,27 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(zero_copy_receive)
+        {
+            int ret = zero_copy_receive_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(compact_sent_packets)
+        {
+            int ret = compact_sent_packets_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(incoming_batch)
+        {
+            int ret = incoming_batch_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(mtu_discovery)
         {
             int ret = mtu_discovery_test();
@@ -1793,6 +1941,13 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qlog_worker)
+        {
+            int ret = qlog_worker_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(qlog_error)
         {
             int ret = qlog_error_test();
@@ -2132,6 +2287,41 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(cc_ns_mpsched_default)
+        {
+            int ret = cc_ns_mpsched_default_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_ns_mpsched_minrtt)
+        {
+            int ret = cc_ns_mpsched_minrtt_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_ns_mpsched_ecf)
+        {
+            int ret = cc_ns_mpsched_ecf_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_ns_mpsched_weighted)
+        {
+            int ret = cc_ns_mpsched_weighted_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(cc_ns_mpsched_redundant)
+        {
+            int ret = cc_ns_mpsched_redundant_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(fastcc)
         {
             int ret = fastcc_test();
@@ -2851,6 +3041,24 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(multipath_coupled_shared) {
+            int ret = multipath_coupled_shared_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(multipath_coupled_disjoint) {
+            int ret = multipath_coupled_disjoint_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(multipath_olia_alpha) {
+            int ret = multipath_olia_alpha_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(multipath_callback) {
             int ret = multipath_callback_test();
 
@@ -2917,6 +3125,12 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(path_scheduler) {
+            int ret = path_scheduler_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(config_option_letters) {
             int ret = config_option_letters_test();
 
@@ -2995,6 +3209,12 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(qpack_huffman_encode) {
+            int ret = qpack_huffman_encode_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(h3zero_parse_qpack) {
             int ret = h3zero_parse_qpack_test();
 
@@ -3127,6 +3347,24 @@ namespace UnitTest1
             Assert::AreEqual(ret, 0);
         }
 
+        TEST_METHOD(h3zero_async_file) {
+            int ret = h3zero_async_file_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(h3zero_content_cache) {
+            int ret = h3zero_content_cache_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
+        TEST_METHOD(h3zero_qpack) {
+            int ret = h3zero_qpack_test();
+
+            Assert::AreEqual(ret, 0);
+        }
+
         TEST_METHOD(h3zero_satellite) {
             int ret = h3zero_satellite_test();
 
@@ -24,75 +24,64 @@
 */
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include "logreader.h"
 #include "bytestream.h"
 #include "qlog.h"
 #include "picoquic_internal.h"
 #include "picoquic_binlog.h"
 #include "picoquic.h"
+#include "autoqlog.h"
 
-int autoqlog(picoquic_cnx_t* cnx)
+/* Conversion of a binary log to qlog. If the conversion fails, an
+ * error file is written next to the binary log. */
+static int autoqlog_convert_file(picoquic_connection_id_t* cid, char const* binlog_file_name,
+    char const* qlog_file_name, char const* qlog_dir, int delete_binlog, int error_code)
 {
     int ret = 0;
-    uint64_t log_time = cnx->start_time;
-    uint16_t flags = 0;
-    int error_code = 0;
-    FILE* f_binlog = picoquic_open_cc_log_file_for_read(cnx->binlog_file_name, &flags, &log_time);
-    if (f_binlog == NULL) {
-        DBG_PRINTF("Cannot open file %s for reading.\n", cnx->binlog_file_name);
-        error_code = 1;
-        ret = -1;
-    }
-    else {
-        char filename[512];
-        char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
-        int sprintf_ret = -1;
 
-        (void)picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->initial_cnxid);
-        if (cnx->quic->use_unique_log_names) {
-            sprintf_ret = picoquic_sprintf(filename, sizeof(filename), NULL, "%s%s%s.%x.%s.%s",
-                cnx->quic->qlog_dir, PICOQUIC_FILE_SEPARATOR, cid_name, cnx->log_unique,
-                (cnx->client_mode) ? "client" : "server", "qlog");
-        }
-        else {
-            sprintf_ret = picoquic_sprintf(filename, sizeof(filename), NULL, "%s%s%s.%s.%s",
-                cnx->quic->qlog_dir, PICOQUIC_FILE_SEPARATOR, cid_name,
-                (cnx->client_mode) ? "client" : "server", "qlog");
-        }
-
-        if (sprintf_ret != 0) {
-            DBG_PRINTF("Cannot format file name for connection %s in file %s", cid_name, cnx->binlog_file_name);
+    if (error_code == 0) {
+        uint64_t log_time = 0;
+        uint16_t flags = 0;
+        FILE* f_binlog = picoquic_open_cc_log_file_for_read(binlog_file_name, &flags, &log_time);
+        if (f_binlog == NULL) {
+            DBG_PRINTF("Cannot open file %s for reading.\n", binlog_file_name);
+            error_code = 1;
             ret = -1;
-            error_code = 3;
         }
         else {
-            ret = qlog_convert(&cnx->initial_cnxid, f_binlog, cnx->binlog_file_name, filename, cnx->quic->qlog_dir, flags);
+            ret = qlog_convert(cid, f_binlog, binlog_file_name, qlog_file_name, qlog_dir, flags);
             picoquic_file_close(f_binlog);
             if (ret != 0) {
-                DBG_PRINTF("Cannot convert file %s to qlog, err = %d.\n", cnx->binlog_file_name, ret);
+                DBG_PRINTF("Cannot convert file %s to qlog, err = %d.\n", binlog_file_name, ret);
                 error_code = 4;
             }
             else {
-                if (cnx->quic->binlog_dir == NULL) {
+                if (delete_binlog) {
                     int last_err = 0;
-                    if ((ret = picoquic_file_delete(cnx->binlog_file_name, &last_err)) != 0) {
-                        DBG_PRINTF("Cannot delete file %s to qlog, err = %d.\n", cnx->binlog_file_name, last_err);
+                    if ((ret = picoquic_file_delete(binlog_file_name, &last_err)) != 0) {
+                        DBG_PRINTF("Cannot delete file %s to qlog, err = %d.\n", binlog_file_name, last_err);
                         error_code = 5;
                     }
                 }
             }
         }
     }
+    else {
+        ret = -1;
+    }
+
     if (ret != 0) {
         FILE* F_err = NULL;
         char err_file_name[512];
-        size_t name_len = strlen(cnx->binlog_file_name);
-        memcpy(err_file_name, cnx->binlog_file_name, (name_len>500)?500:name_len);
+        size_t name_len = strlen(binlog_file_name);
+        memcpy(err_file_name, binlog_file_name, (name_len>500)?500:name_len);
         memcpy(err_file_name + name_len, ".errlog", 7);
         err_file_name[name_len + 0] = 0;
         F_err = picoquic_file_open(err_file_name, "wt");
         if (F_err != NULL) {
-            fprintf(F_err, "Cannot create qlog file for %s, error: %d\n", cnx->binlog_file_name, error_code);
+            fprintf(F_err, "Cannot create qlog file for %s, error: %d\n", binlog_file_name, error_code);
         }
         (void)picoquic_file_close(F_err);
     }
@@ -100,9 +89,381 @@ int autoqlog(picoquic_cnx_t* cnx)
     return ret;
 }
 
+/* Background conversion.
+ * The worker threads take jobs from a bounded queue, protected by the
+ * worker mutex. Each job carries copies of the file names, so it does
+ * not depend on the connection or the QUIC context once queued.
+ */
+#define PICOQUIC_QLOG_WORKER_WAIT 10000
+
+typedef struct st_picoquic_qlog_job_t {
+    struct st_picoquic_qlog_job_t* next_job;
+    picoquic_connection_id_t cid;
+    char* binlog_file_name;
+    char* qlog_file_name;
+    char* qlog_dir;
+    int delete_binlog;
+    /* Set if the conversion is deferred to the binlog writer */
+    picoquic_qlog_worker_t* worker;
+} picoquic_qlog_job_t;
+
+struct st_picoquic_qlog_worker_t {
+    picoquic_mutex_t mutex;
+    picoquic_event_t work_event;
+    picoquic_event_t idle_event;
+    picoquic_thread_t* threads;
+    int nb_threads;
+    int should_stop;
+    size_t queue_max;
+    size_t nb_in_progress;
+    picoquic_qlog_job_t* first_job;
+    picoquic_qlog_job_t* last_job;
+    picoquic_qlog_worker_stats_t stats;
+    unsigned int is_mutex_created : 1;
+    unsigned int is_work_event_created : 1;
+    unsigned int is_idle_event_created : 1;
+};
+
+static void picoquic_qlog_job_free(picoquic_qlog_job_t* job)
+{
+    (void)picoquic_string_free(job->binlog_file_name);
+    (void)picoquic_string_free(job->qlog_file_name);
+    (void)picoquic_string_free(job->qlog_dir);
+    free(job);
+}
+
+/* Called with the mutex held */
+static picoquic_qlog_job_t* picoquic_qlog_worker_dequeue(picoquic_qlog_worker_t* worker)
+{
+    picoquic_qlog_job_t* job = worker->first_job;
+
+    if (job != NULL) {
+        worker->first_job = job->next_job;
+        if (worker->first_job == NULL) {
+            worker->last_job = NULL;
+        }
+        worker->stats.queue_length--;
+        worker->nb_in_progress++;
+    }
+    return job;
+}
+
+static void picoquic_qlog_worker_run_job(picoquic_qlog_worker_t* worker, picoquic_qlog_job_t* job)
+{
+    int ret = autoqlog_convert_file(&job->cid, job->binlog_file_name, job->qlog_file_name,
+        job->qlog_dir, job->delete_binlog, 0);
+    int is_idle;
+
+    picoquic_qlog_job_free(job);
+    (void)picoquic_lock_mutex(&worker->mutex);
+    if (ret == 0) {
+        worker->stats.nb_converted++;
+    }
+    else {
+        worker->stats.nb_failed++;
+    }
+    worker->nb_in_progress--;
+    is_idle = (worker->first_job == NULL && worker->nb_in_progress == 0);
+    (void)picoquic_unlock_mutex(&worker->mutex);
+    if (is_idle) {
+        (void)picoquic_signal_event(&worker->idle_event);
+    }
+}
+
+static picoquic_thread_return_t picoquic_qlog_worker_thread(void* arg)
+{
+    picoquic_qlog_worker_t* worker = (picoquic_qlog_worker_t*)arg;
+
+    (void)picoquic_lock_mutex(&worker->mutex);
+    /* Queued jobs are completed before the worker stops */
+    while (!worker->should_stop || worker->first_job != NULL) {
+        picoquic_qlog_job_t* job = picoquic_qlog_worker_dequeue(worker);
+
+        (void)picoquic_unlock_mutex(&worker->mutex);
+        if (job == NULL) {
+            /* The wait is bounded, so a signal sent before the wait starts
+             * only delays the work. */
+            (void)picoquic_wait_for_event(&worker->work_event, PICOQUIC_QLOG_WORKER_WAIT);
+        }
+        else {
+            picoquic_qlog_worker_run_job(worker, job);
+        }
+        (void)picoquic_lock_mutex(&worker->mutex);
+    }
+    (void)picoquic_unlock_mutex(&worker->mutex);
+
+    picoquic_thread_do_return;
+}
+
+picoquic_qlog_worker_t* picoquic_qlog_worker_create(int nb_threads, size_t queue_max)
+{
+    int ret = 0;
+    picoquic_qlog_worker_t* worker = (picoquic_qlog_worker_t*)malloc(sizeof(picoquic_qlog_worker_t));
+
+    if (worker != NULL) {
+        memset(worker, 0, sizeof(picoquic_qlog_worker_t));
+        worker->queue_max = (queue_max == 0) ? PICOQUIC_QLOG_WORKER_QUEUE_DEFAULT : queue_max;
+
+        if ((ret = picoquic_create_mutex(&worker->mutex)) == 0) {
+            worker->is_mutex_created = 1;
+            if ((ret = picoquic_create_event(&worker->work_event)) == 0) {
+                worker->is_work_event_created = 1;
+                if ((ret = picoquic_create_event(&worker->idle_event)) == 0) {
+                    worker->is_idle_event_created = 1;
+                }
+            }
+        }
+
+        if (ret == 0 && nb_threads > 0) {
+            worker->threads = (picoquic_thread_t*)malloc(sizeof(picoquic_thread_t) * nb_threads);
+            if (worker->threads == NULL) {
+                ret = -1;
+            }
+            else {
+                for (int i = 0; ret == 0 && i < nb_threads; i++) {
+                    if ((ret = picoquic_create_thread(&worker->threads[i], picoquic_qlog_worker_thread, worker)) == 0) {
+                        worker->nb_threads++;
+                    }
+                }
+            }
+        }
+
+        if (ret != 0) {
+            picoquic_qlog_worker_delete(worker);
+            worker = NULL;
+        }
+    }
+
+    return worker;
+}
+
+void picoquic_qlog_worker_delete(picoquic_qlog_worker_t* worker)
+{
+    picoquic_qlog_job_t* job;
+
+    if (worker->nb_threads > 0) {
+        (void)picoquic_lock_mutex(&worker->mutex);
+        worker->should_stop = 1;
+        (void)picoquic_unlock_mutex(&worker->mutex);
+        for (int i = 0; i < worker->nb_threads; i++) {
+            (void)picoquic_signal_event(&worker->work_event);
+            (void)picoquic_wait_thread(worker->threads[i]);
+            picoquic_delete_thread(&worker->threads[i]);
+        }
+    }
+    if (worker->threads != NULL) {
+        free(worker->threads);
+    }
+    /* Without threads, the queued jobs are converted now. */
+    if (worker->is_mutex_created) {
+        (void)picoquic_lock_mutex(&worker->mutex);
+        while ((job = picoquic_qlog_worker_dequeue(worker)) != NULL) {
+            (void)picoquic_unlock_mutex(&worker->mutex);
+            picoquic_qlog_worker_run_job(worker, job);
+            (void)picoquic_lock_mutex(&worker->mutex);
+        }
+        (void)picoquic_unlock_mutex(&worker->mutex);
+        (void)picoquic_delete_mutex(&worker->mutex);
+    }
+    if (worker->is_work_event_created) {
+        picoquic_delete_event(&worker->work_event);
+    }
+    if (worker->is_idle_event_created) {
+        picoquic_delete_event(&worker->idle_event);
+    }
+    free(worker);
+}
+
+void picoquic_set_qlog_worker(picoquic_quic_t* quic, picoquic_qlog_worker_t* worker)
+{
+    quic->autoqlog_ctx = worker;
+}
+
+static picoquic_qlog_job_t* picoquic_qlog_job_create(picoquic_connection_id_t* cid,
+    char const* binlog_file_name, char const* qlog_file_name, char const* qlog_dir, int delete_binlog)
+{
+    picoquic_qlog_job_t* job = (picoquic_qlog_job_t*)malloc(sizeof(picoquic_qlog_job_t));
+
+    if (job != NULL) {
+        memset(job, 0, sizeof(picoquic_qlog_job_t));
+        job->cid = *cid;
+        job->delete_binlog = delete_binlog;
+        if ((job->binlog_file_name = picoquic_string_duplicate(binlog_file_name)) == NULL ||
+            (job->qlog_file_name = picoquic_string_duplicate(qlog_file_name)) == NULL ||
+            (job->qlog_dir = picoquic_string_duplicate(qlog_dir)) == NULL) {
+            picoquic_qlog_job_free(job);
+            job = NULL;
+        }
+    }
+
+    return job;
+}
+
+/* Queue a conversion job. If the job is NULL or the queue is full, the
+ * conversion is dropped and the job is freed. */
+static int picoquic_qlog_worker_enqueue(picoquic_qlog_worker_t* worker, picoquic_qlog_job_t* job,
+    char const* binlog_file_name)
+{
+    int ret = 0;
+
+    (void)picoquic_lock_mutex(&worker->mutex);
+    if (job == NULL || worker->stats.queue_length >= worker->queue_max) {
+        worker->stats.nb_dropped++;
+        ret = -1;
+    }
+    else {
+        if (worker->last_job == NULL) {
+            worker->first_job = job;
+        }
+        else {
+            worker->last_job->next_job = job;
+        }
+        worker->last_job = job;
+        worker->stats.nb_queued++;
+        worker->stats.queue_length++;
+        if (worker->stats.queue_length > worker->stats.queue_length_max) {
+            worker->stats.queue_length_max = worker->stats.queue_length;
+        }
+    }
+    (void)picoquic_unlock_mutex(&worker->mutex);
+
+    if (ret == 0) {
+        (void)picoquic_signal_event(&worker->work_event);
+    }
+    else {
+        DBG_PRINTF("Qlog queue full, binary log %s not converted.\n", binlog_file_name);
+        if (job != NULL) {
+            picoquic_qlog_job_free(job);
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_qlog_worker_get_stats(picoquic_qlog_worker_t* worker, picoquic_qlog_worker_stats_t* stats)
+{
+    (void)picoquic_lock_mutex(&worker->mutex);
+    *stats = worker->stats;
+    (void)picoquic_unlock_mutex(&worker->mutex);
+}
+
+int picoquic_qlog_worker_wait_idle(picoquic_qlog_worker_t* worker, uint64_t microsec_wait)
+{
+    uint64_t waited = 0;
+    int is_idle = 0;
+
+    while (!is_idle) {
+        (void)picoquic_lock_mutex(&worker->mutex);
+        is_idle = (worker->first_job == NULL && worker->nb_in_progress == 0);
+        (void)picoquic_unlock_mutex(&worker->mutex);
+        if (!is_idle) {
+            if (waited >= microsec_wait || worker->nb_threads == 0) {
+                break;
+            }
+            (void)picoquic_wait_for_event(&worker->idle_event, PICOQUIC_QLOG_WORKER_WAIT);
+            waited += PICOQUIC_QLOG_WORKER_WAIT;
+        }
+    }
+
+    return (is_idle) ? 0 : -1;
+}
+
+static int autoqlog_file_name(picoquic_cnx_t* cnx, char* filename, size_t filename_size)
+{
+    char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+    int sprintf_ret = -1;
+
+    filename[0] = 0;
+    (void)picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->initial_cnxid);
+    if (cnx->quic->use_unique_log_names) {
+        sprintf_ret = picoquic_sprintf(filename, filename_size, NULL, "%s%s%s.%x.%s.%s",
+            cnx->quic->qlog_dir, PICOQUIC_FILE_SEPARATOR, cid_name, cnx->log_unique,
+            (cnx->client_mode) ? "client" : "server", "qlog");
+    }
+    else {
+        sprintf_ret = picoquic_sprintf(filename, filename_size, NULL, "%s%s%s.%s.%s",
+            cnx->quic->qlog_dir, PICOQUIC_FILE_SEPARATOR, cid_name,
+            (cnx->client_mode) ? "client" : "server", "qlog");
+    }
+
+    if (sprintf_ret != 0) {
+        DBG_PRINTF("Cannot format file name for connection %s in file %s", cid_name, cnx->binlog_file_name);
+    }
+
+    return sprintf_ret;
+}
+
+int autoqlog(picoquic_cnx_t* cnx)
+{
+    int ret = 0;
+    int error_code = 0;
+    char filename[512];
+
+    if (autoqlog_file_name(cnx, filename, sizeof(filename)) != 0) {
+        error_code = 3;
+    }
+    else if (cnx->quic->autoqlog_ctx != NULL) {
+        /* Only queue the conversion, so the network thread is not delayed */
+        ret = picoquic_qlog_worker_enqueue((picoquic_qlog_worker_t*)cnx->quic->autoqlog_ctx,
+            picoquic_qlog_job_create(&cnx->initial_cnxid, cnx->binlog_file_name, filename,
+                cnx->quic->qlog_dir, cnx->quic->binlog_dir == NULL), cnx->binlog_file_name);
+    }
+
+    if (error_code != 0 || cnx->quic->autoqlog_ctx == NULL) {
+        ret = autoqlog_convert_file(&cnx->initial_cnxid, cnx->binlog_file_name, filename,
+            cnx->quic->qlog_dir, cnx->quic->binlog_dir == NULL, error_code);
+    }
+
+    return ret;
+}
+
+/* Conversion of a binary log closed by the binlog writer thread. The job
+ * is prepared when the connection is closed, and is queued to the qlog
+ * worker once the file is complete, so the writer thread is not delayed. */
+static void autoqlog_closed(void* closed_ctx, int is_closed)
+{
+    picoquic_qlog_job_t* job = (picoquic_qlog_job_t*)closed_ctx;
+
+    if (!is_closed) {
+        DBG_PRINTF("Binary log %s not closed, not converted.\n", job->binlog_file_name);
+        picoquic_qlog_job_free(job);
+    }
+    else {
+        (void)picoquic_qlog_worker_enqueue(job->worker, job, job->binlog_file_name);
+    }
+}
+
+static int autoqlog_defer(picoquic_cnx_t* cnx, picoquic_binlog_closed_fn* closed_fn, void** closed_ctx)
+{
+    int ret = 0;
+    char filename[512];
+    picoquic_qlog_job_t* job = NULL;
+
+    if (cnx->quic->autoqlog_ctx == NULL) {
+        /* The conversion would run on the binlog writer thread, and delay
+         * the writing of all the other logs. */
+        DBG_PRINTF("No qlog worker, binary log %s not converted.\n", cnx->binlog_file_name);
+        ret = -1;
+    }
+    else if (autoqlog_file_name(cnx, filename, sizeof(filename)) != 0 ||
+        (job = picoquic_qlog_job_create(&cnx->initial_cnxid, cnx->binlog_file_name, filename,
+            cnx->quic->qlog_dir, cnx->quic->binlog_dir == NULL)) == NULL) {
+        DBG_PRINTF("Cannot prepare the qlog conversion of %s\n", cnx->binlog_file_name);
+        ret = -1;
+    }
+    else {
+        job->worker = (picoquic_qlog_worker_t*)cnx->quic->autoqlog_ctx;
+        *closed_fn = autoqlog_closed;
+        *closed_ctx = job;
+    }
+
+    return ret;
+}
+
 int picoquic_set_qlog(picoquic_quic_t* quic, char const* qlog_dir)
 {
     quic->autoqlog_fn = autoqlog; 
+    quic->autoqlog_defer_fn = autoqlog_defer;
     picoquic_enable_binlog(quic);
     quic->qlog_dir = picoquic_string_free(quic->qlog_dir);
     quic->qlog_dir = picoquic_string_duplicate(qlog_dir);
@@ -38,6 +38,50 @@ extern "C" {
     */
 int picoquic_set_qlog(picoquic_quic_t* quic, char const* qlog_dir);
 
+/* Background qlog conversion.
+ * By default, the binary log of a connection is converted to qlog when the
+ * connection is deleted, on the thread that deletes it. For long connections
+ * this takes many milliseconds, delaying all other connections served by
+ * the network thread.
+ *
+ * A qlog worker moves the conversion to background threads. Once the worker
+ * is set in the QUIC context, deleting a connection only queues the names of
+ * the binary log and qlog files. If the queue already holds `queue_max`
+ * jobs, the conversion is dropped, and the binary log is left on disk so
+ * it can be converted later with picolog. The statistics report the queue
+ * length, its high water mark, and the number of dropped conversions.
+ *
+ * With `nb_threads` set to zero, no thread is created and the queued
+ * conversions are performed when the worker is deleted. Deleting the worker
+ * completes all queued conversions. The worker may be shared by several QUIC
+ * contexts, and shall only be deleted after these contexts are freed.
+ *
+ * With a binlog writer (see picoquic_binlog.h), the job is queued by the
+ * writer thread once the binary log is closed, so the worker shall be
+ * deleted after the binlog writer. A binlog writer requires a worker:
+ * without one, the binary logs are not converted.
+ */
+#define PICOQUIC_QLOG_WORKER_QUEUE_DEFAULT 64
+
+typedef struct st_picoquic_qlog_worker_t picoquic_qlog_worker_t;
+
+typedef struct st_picoquic_qlog_worker_stats_t {
+    uint64_t nb_queued;
+    uint64_t nb_converted;
+    uint64_t nb_failed;
+    uint64_t nb_dropped;
+    size_t queue_length;
+    size_t queue_length_max;
+} picoquic_qlog_worker_stats_t;
+
+picoquic_qlog_worker_t* picoquic_qlog_worker_create(int nb_threads, size_t queue_max);
+void picoquic_qlog_worker_delete(picoquic_qlog_worker_t* worker);
+void picoquic_set_qlog_worker(picoquic_quic_t* quic, picoquic_qlog_worker_t* worker);
+void picoquic_qlog_worker_get_stats(picoquic_qlog_worker_t* worker, picoquic_qlog_worker_stats_t* stats);
+/* Wait until all queued conversions are done. Returns 0 if the queue is
+ * empty, -1 if the delay expired first. */
+int picoquic_qlog_worker_wait_idle(picoquic_qlog_worker_t* worker, uint64_t microsec_wait);
+
 #ifdef __cplusplus
 }
 #endif
@@ -243,6 +243,9 @@ static int picoquic_demo_client_open_stream(picoquic_cnx_t* cnx,
         ctx->first_stream = stream_ctx;
         stream_ctx->stream_id = stream_id + nb_repeat*4u;
         stream_ctx->post_size = post_size;
+        /* Response headers may reference the QPACK dynamic table */
+        stream_ctx->stream_state.h3_ctx = ctx->h3_ctx;
+        stream_ctx->stream_state.stream_id = stream_ctx->stream_id;
 
         if (ctx->no_disk) {
             stream_ctx->F = NULL;
@@ -313,7 +316,8 @@ static int picoquic_demo_client_open_stream(picoquic_cnx_t* cnx,
 
         switch (ctx->alpn) {
         case picoquic_alpn_http_3:
-            ret = h3zero_client_create_stream_request_ex(
+            ret = h3zero_client_create_stream_request_qpack(
+                (ctx->h3_ctx == NULL) ? NULL : &ctx->h3_ctx->qpack, stream_ctx->stream_id,
                 buffer, sizeof(buffer), path, path_len, 
                 range, (range == NULL)?0:strlen(range), post_size,
                 cnx->sni, &request_length);
@@ -333,6 +337,10 @@ static int picoquic_demo_client_open_stream(picoquic_cnx_t* cnx,
             if (post_size > 0) {
                 ret = picoquic_mark_active_stream(cnx, stream_id, 1, stream_ctx);
             }
+            if (ret == 0 && ctx->h3_ctx != NULL) {
+                /* Send the dynamic table entries used by the request */
+                ret = h3zero_qpack_send_instructions(cnx, ctx->h3_ctx);
+            }
         }
 
         if (!ctx->no_print) {
@@ -384,7 +392,12 @@ int picoquic_demo_client_start_streams(picoquic_cnx_t* cnx,
     if (fin_stream_id == PICOQUIC_DEMO_STREAM_ID_INITIAL) {
         switch (ctx->alpn) {
         case picoquic_alpn_http_3:
-            ret = h3zero_protocol_init(cnx);
+            if (ctx->h3_ctx != NULL) {
+                h3zero_callback_delete_context(cnx, ctx->h3_ctx);
+            }
+            if ((ctx->h3_ctx = h3zero_client_protocol_init(cnx)) == NULL) {
+                ret = -1;
+            }
             break;
         default:
             break;
@@ -460,7 +473,11 @@ int picoquic_demo_client_callback(picoquic_cnx_t* cnx,
         if (stream_ctx == NULL) {
             stream_ctx = picoquic_demo_client_find_stream(ctx, stream_id);
         }
-        if (stream_ctx != NULL && stream_ctx->is_open) {
+        if (stream_ctx == NULL && ctx->h3_ctx != NULL && !IS_BIDIR_STREAM_ID(stream_id) && !IS_CLIENT_STREAM_ID(stream_id)) {
+            /* Control and QPACK streams opened by the server */
+            ret = h3zero_client_process_remote_unidir(cnx, ctx->h3_ctx, stream_id, bytes, length);
+        }
+        else if (stream_ctx != NULL && stream_ctx->is_open) {
             if (!stream_ctx->is_file_open && ctx->no_disk == 0) {
                 ret = picoquic_demo_client_open_stream_file(cnx, ctx, stream_ctx);
             }
@@ -501,6 +518,10 @@ int picoquic_demo_client_callback(picoquic_cnx_t* cnx,
                             bytes += available_data;
                         }
                     }
+                    if (ret == 0 && ctx->h3_ctx != NULL) {
+                        /* Acknowledge the header blocks that used the dynamic table */
+                        ret = h3zero_qpack_send_instructions(cnx, ctx->h3_ctx);
+                    }
                     break;
                 }
                 case picoquic_alpn_http_0_9:
@@ -718,6 +739,11 @@ void picoquic_demo_client_delete_context(picoquic_demo_callback_ctx_t* ctx)
     while ((stream_ctx = ctx->first_stream) != NULL) {
         picoquic_demo_client_delete_stream_context(ctx, stream_ctx);
     }
+
+    if (ctx->h3_ctx != NULL) {
+        h3zero_callback_delete_context(NULL, ctx->h3_ctx);
+        ctx->h3_ctx = NULL;
+    }
 }
 
 char const * demo_client_parse_stream_spaces(char const * text) {
@@ -92,6 +92,9 @@ typedef struct st_picoquic_demo_client_callback_ctx_t {
     /* Context extension for handling asynchronous creation of paths */
     void (*handle_path_allowed)(picoquic_cnx_t* cnx, void* ctx);
     void* path_allowed_context;
+
+    /* H3 control and QPACK streams */
+    struct st_h3zero_callback_ctx_t* h3_ctx;
 } picoquic_demo_callback_ctx_t;
 
 picoquic_alpn_enum picoquic_parse_alpn(char const * alpn);
@@ -73,6 +73,7 @@ static picoquic_h09_server_callback_ctx_t* first_server_callback_create_context(
             ctx->path_table = param->path_table;
             ctx->path_table_nb = param->path_table_nb;
             ctx->web_folder = param->web_folder;
+            ctx->content_cache = param->content_cache;
         }
     }
 
@@ -82,7 +83,7 @@ static picoquic_h09_server_callback_ctx_t* first_server_callback_create_context(
 static void picoquic_h09_server_callback_delete_context(picoquic_h09_server_callback_ctx_t* ctx)
 {
 
-    picosplay_empty_tree(&ctx->h3_stream_tree);
+    h3zero_delete_all_streams(ctx);
 
     free(ctx);
 }
@@ -378,8 +379,8 @@ int picoquic_h09_server_process_data(picoquic_cnx_t* cnx,
 
             if (stream_ctx->ps.hq.method == 0) {
                 int file_error = 0;
-                if (h3zero_server_parse_path(stream_ctx->ps.hq.path, stream_ctx->ps.hq.path_length,
-                    &stream_ctx->echo_length, &stream_ctx->file_path, app_ctx->web_folder, &file_error)) {
+                if (h3zero_server_parse_path_ex(stream_ctx->ps.hq.path, stream_ctx->ps.hq.path_length,
+                    &stream_ctx->echo_length, &stream_ctx->file_path, app_ctx->web_folder, &file_error, app_ctx->content_cache)) {
                     char log_text[256];
                     picoquic_log_app_message(cnx, "Cannot find file for path: <%s> in folder <%s>, error: 0x%x",
                         picoquic_uint8_to_str(log_text, 256, stream_ctx->ps.hq.path, stream_ctx->ps.hq.path_length),
@@ -457,7 +458,8 @@ int picoquic_h09_server_process_data(picoquic_cnx_t* cnx,
                     picoquic_add_to_stream_with_ctx(cnx, stream_id, post_response,
                         (size_t)stream_ctx->response_length, 1, (void*)stream_ctx);
                 }
-                else {
+                else if (stream_ctx->echo_length == 0 || stream_ctx->file_path == NULL || app_ctx->content_cache == NULL ||
+                    h3zero_server_queue_cached_content(cnx, stream_ctx, app_ctx->content_cache) != 0) {
                     picoquic_mark_active_stream(cnx, stream_ctx->stream_id, 1, stream_ctx);
                 }
             }
@@ -55,6 +55,11 @@ extern char const* h3zero_server_post_response_page;
 void h3zero_init_stream_tree(picosplay_tree_t* h3_stream_tree);
 int h3zero_server_parse_path(const uint8_t* path, size_t path_length, uint64_t* echo_size,
     char** file_path, char const* web_folder, int* file_error);
+int h3zero_server_parse_path_ex(const uint8_t* path, size_t path_length, uint64_t* echo_size,
+    char** file_path, char const* web_folder, int* file_error, h3zero_content_cache_t* content_cache);
+int h3zero_server_queue_cached_content(picoquic_cnx_t* cnx, h3zero_stream_ctx_t* stream_ctx, h3zero_content_cache_t* content_cache);
+int h3zero_server_queue_cached_content_ex(picoquic_cnx_t* cnx, h3zero_stream_ctx_t* stream_ctx,
+    h3zero_content_cache_t* content_cache, h3zero_file_reader_t* file_reader);
 int h3zero_server_prepare_to_send(void* context, size_t space, h3zero_stream_ctx_t* stream_ctx);
 
 /* Defining then the Http 0.9 variant of the server
@@ -27,14 +27,14 @@
  * - Generate the corresponding document in memory
  * The "request" is expected to be an H3 request header frame, encoded with QPACK
  * The "response" will include a response header frame and one or several data frames.
- * QPACK encoding only uses the static dictionary.
- * The server will start the connection by sending a setting frame, which will
- * specify a zero-length dynamic dictionary for QPACK.
+ * QPACK encoding uses the static dictionary. The dynamic table and the
+ * encoder and decoder streams are managed in h3zero_qpack.c.
  */
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include "h3zero.h"
+#include "h3zero_qpack.h"
 
 /*
  * Transport parameters.
@@ -273,6 +273,93 @@ h3zero_qpack_static_t qpack_static[] = {
 
 size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_static_t);
 
+/*
+ * Names of the headers listed in the static table. The QPACK dynamic
+ * table needs the names to compute the size of entries inserted
+ * with a reference to a static name.
+ */
+
+typedef struct st_h3zero_header_name_t {
+    http_header_enum_t header;
+    char const* name;
+} h3zero_header_name_t;
+
+static const h3zero_header_name_t h3zero_header_names[] = {
+    { http_pseudo_header_authority, ":authority" },
+    { http_pseudo_header_path, ":path" },
+    { http_header_age, "age" },
+    { http_header_content_disposition, "content-disposition" },
+    { http_header_content_length, "content-length" },
+    { http_header_cookie, "cookie" },
+    { http_header_date, "date" },
+    { http_header_etag, "etag" },
+    { http_header_if_modified_since, "if-modified-since" },
+    { http_header_if_none_match, "if-none-match" },
+    { http_header_last_modified, "last-modified" },
+    { http_header_link, "link" },
+    { http_header_location, "location" },
+    { http_header_referer, "referer" },
+    { http_header_set_cookie, "set-cookie" },
+    { http_pseudo_header_method, ":method" },
+    { http_pseudo_header_scheme, ":scheme" },
+    { http_pseudo_header_status, ":status" },
+    { http_pseudo_header_protocol, ":protocol" },
+    { http_header_accept, "accept" },
+    { http_header_accept_encoding, "accept-encoding" },
+    { http_header_accept_ranges, "accept-ranges" },
+    { http_header_access_control_allow_headers, "access-control-allow-headers" },
+    { http_header_access_control_allow_origin, "access-control-allow-origin" },
+    { http_header_cache_control, "cache-control" },
+    { http_header_content_encoding, "content-encoding" },
+    { http_header_content_type, "content-type" },
+    { http_header_range, "range" },
+    { http_header_strict_transport_security, "strict-transport-security" },
+    { http_header_vary, "vary" },
+    { http_header_x_content_type_options, "x-content-type-options" },
+    { http_header_x_xss_protection, "x-xss-protection" },
+    { http_header_accept_language, "accept-language" },
+    { http_header_access_control_allow_credentials, "access-control-allow-credentials" },
+    { http_header_access_control_allow_methods, "access-control-allow-methods" },
+    { http_header_access_control_expose_headers, "access-control-expose-headers" },
+    { http_header_access_control_request_headers, "access-control-request-headers" },
+    { http_header_access_control_request_method, "access-control-request-method" },
+    { http_header_alt_svc, "alt-svc" },
+    { http_header_authorization, "authorization" },
+    { http_header_content_security_policy, "content-security-policy" },
+    { http_header_early_data, "early-data" },
+    { http_header_expect_ct, "expect-ct" },
+    { http_header_forwarded, "forwarded" },
+    { http_header_if_range, "if-range" },
+    { http_header_origin, "origin" },
+    { http_header_purpose, "purpose" },
+    { http_header_server, "server" },
+    { http_header_timing_allow_origin, "timing-allow-origin" },
+    { http_header_upgrade_insecure_requests, "upgrade-insecure-requests" },
+    { http_header_user_agent, "user-agent" },
+    { http_header_x_forwarded_for, "x-forwarded-for" },
+    { http_header_x_frame_options, "x-frame-options" }
+};
+
+static const size_t h3zero_nb_header_names = sizeof(h3zero_header_names) / sizeof(h3zero_header_name_t);
+
+char const* h3zero_qpack_static_name(uint64_t s_index, size_t* name_length, http_header_enum_t* header)
+{
+    char const* name = NULL;
+
+    if (s_index < h3zero_qpack_nb_static) {
+        for (size_t i = 0; i < h3zero_nb_header_names; i++) {
+            if (h3zero_header_names[i].header == qpack_static[s_index].header) {
+                name = h3zero_header_names[i].name;
+                *name_length = strlen(name);
+                *header = qpack_static[s_index].header;
+                break;
+            }
+        }
+    }
+
+    return name;
+}
+
 /* 
  * Minimal QPACK parsing.
  *
@@ -290,9 +377,12 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * |      Compressed Headers     ...
  * +-------------------------------+
  *
- * Since H3zero only support static entries, we expect the required
+ * When parsing without a dynamic table, we expect the required
  * Insert count to be zero, and we always ignore the Base delta.
  * The Base is encoded as sign-and-modulus integer (on 1 byte?)
+ * References to the dynamic table are parsed by
+ * h3zero_parse_qpack_field_lines, using the table and base
+ * decoded in h3zero_qpack_decode_header_block.
  *
  * We expect the following types of compressed content:
  *
@@ -327,8 +417,7 @@ size_t h3zero_qpack_nb_static = sizeof(qpack_static) / sizeof(h3zero_qpack_stati
  * +-------------------------------+
  *
  * Literal Header Field Without Name Reference. The N bit is set to zero on write,
- * ignored on read. The H bit is always zero, since we do not implement Huffman
- * encoding.
+ * ignored on read. The H bit is set if the name or value is Huffman encoded.
  */
 
 h3zero_method_enum h3zero_get_method_by_name(uint8_t * name, size_t name_length) {
@@ -403,6 +492,74 @@ uint8_t* h3zero_parse_qpack_header_value_string(uint8_t * bytes, uint8_t* decode
     return bytes;
 }
 
+/* Document the header parts after decoding a header value, either from
+ * a literal in the header frame or from an entry in the dynamic table.
+ */
+int h3zero_qpack_set_header_value(http_header_enum_t header, uint8_t * decoded,
+    size_t decoded_length, h3zero_header_parts_t * parts)
+{
+    int ret = 0;
+
+    switch (header) {
+    case http_pseudo_header_method:
+        if (parts->method != h3zero_method_none) {
+            /* Duplicate method! */
+            ret = -1;
+        }
+        else {
+            parts->method = h3zero_get_method_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_header_content_type:
+        if (parts->content_type != h3zero_content_type_none) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_status:
+        if (parts->status != 0) {
+            /* Duplicate content type! */
+            ret = -1;
+        }
+        else {
+            /* TODO: decimal to binary */
+            parts->status = h3zero_parse_status(decoded, decoded_length);
+        }
+        break;
+    case http_pseudo_header_path:
+        if (parts->path != NULL ||
+            h3zero_parse_qpack_header_value_string(decoded, decoded,
+                decoded_length, &parts->path, &parts->path_length) == NULL) {
+            /* Duplicate path, or memory error */
+            ret = -1;
+        }
+        break;
+    case http_header_range:
+        if (parts->range != NULL ||
+            h3zero_parse_qpack_header_value_string(decoded, decoded,
+                decoded_length, &parts->range, &parts->range_length) == NULL) {
+            /* Duplicate range, or memory error */
+            ret = -1;
+        }
+        break;
+    case http_pseudo_header_protocol:
+        if (parts->protocol != NULL ||
+            h3zero_parse_qpack_header_value_string(decoded, decoded,
+                decoded_length, &parts->protocol, &parts->protocol_length) == NULL) {
+            /* Duplicate protocol, or memory error */
+            ret = -1;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return ret;
+}
+
 uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
     http_header_enum_t header, h3zero_header_parts_t * parts)
 {
@@ -411,6 +568,7 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t * decoded = NULL;
     size_t decoded_length;
     uint8_t deHuff[256];
+    uint8_t* deHuff_long = NULL;
 
     if (bytes >= bytes_max || bytes == NULL) {
         bytes = NULL;
@@ -423,82 +581,38 @@ uint8_t * h3zero_parse_qpack_header_value(uint8_t * bytes, uint8_t * bytes_max,
         if (bytes + v_length > bytes_max) {
             bytes = NULL;
         } else {
-            if (is_huffman && hzero_qpack_huffman_decode(
-                bytes, bytes + v_length, deHuff, sizeof(deHuff), &decoded_length) == 0)
-            {
+            if (is_huffman) {
+                /* The shortest Huffman code is 5 bits long */
+                size_t max_decoded = (size_t)((v_length * 8) / 5) + 1;
+
                 decoded = deHuff;
+                if (max_decoded > sizeof(deHuff)) {
+                    if ((deHuff_long = (uint8_t*)malloc(max_decoded)) == NULL) {
+                        max_decoded = sizeof(deHuff);
+                    }
+                    else {
+                        decoded = deHuff_long;
+                    }
+                }
+                if (hzero_qpack_huffman_decode(bytes, bytes + v_length, decoded, max_decoded, &decoded_length) != 0) {
+                    decoded = bytes;
+                    decoded_length = (size_t)v_length;
+                }
             }
             else {
                 decoded = bytes;
                 decoded_length = (size_t) v_length;
             }
 
-            switch (header) {
-            case http_pseudo_header_method:
-                if (parts->method != h3zero_method_none) {
-                    /* Duplicate method! */
-                    bytes = 0;
-                }
-                else {
-                    parts->method = h3zero_get_method_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_header_content_type:
-                if (parts->content_type != h3zero_content_type_none) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    parts->content_type = h3zero_get_content_type_by_name(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_status:
-                if (parts->status != 0) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    /* TODO: decimal to binary */
-                    parts->status = h3zero_parse_status(decoded, decoded_length);
-                }
-                break;
-            case http_pseudo_header_path:
-                if (parts->path != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->path, &parts->path_length);
-                }
-                break;
-            case http_header_range:
-                if (parts->range != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->range, &parts->range_length);
-                }
-                break;
-            case http_pseudo_header_protocol:
-                if (parts->protocol != NULL) {
-                    /* Duplicate content type! */
-                    bytes = 0;
-                }
-                else {
-                    bytes = h3zero_parse_qpack_header_value_string(bytes, decoded,
-                        decoded_length, &parts->protocol, &parts->protocol_length);
-                }
-                break;
-            default:
-                break;
+            if (h3zero_qpack_set_header_value(header, decoded, decoded_length, parts) != 0) {
+                bytes = NULL;
             }
-
-            if (bytes != NULL) {
+            else {
                 bytes += v_length;
             }
+            if (deHuff_long != NULL) {
+                free(deHuff_long);
+            }
         }
     }
 
@@ -537,6 +651,45 @@ int h3zero_get_interesting_header_type(uint8_t * name, size_t name_length, int i
     return val;
 }
 
+/* Find the dynamic table entry referenced by a field line. The absolute
+ * index must be lower than the required insert count announced in
+ * the prefix of the header block.
+ */
+static const h3zero_qpack_entry_t* h3zero_qpack_field_entry(const h3zero_qpack_table_t* table,
+    uint64_t required_insert_count, uint64_t base, uint64_t index, int is_post_base)
+{
+    const h3zero_qpack_entry_t* entry = NULL;
+
+    if (table != NULL) {
+        uint64_t absolute_index = UINT64_MAX;
+
+        if (is_post_base) {
+            absolute_index = base + index;
+        }
+        else if (index < base) {
+            absolute_index = base - 1 - index;
+        }
+        if (absolute_index < required_insert_count) {
+            entry = h3zero_qpack_table_get(table, absolute_index);
+        }
+    }
+    return entry;
+}
+
+static uint8_t* h3zero_parse_qpack_dynamic_value(uint8_t* bytes, uint8_t* bytes_max, const h3zero_qpack_entry_t* entry,
+    h3zero_header_parts_t* parts)
+{
+    if (bytes != NULL) {
+        if (entry == NULL) {
+            bytes = NULL;
+        }
+        else {
+            bytes = h3zero_parse_qpack_header_value(bytes, bytes_max, entry->header, parts);
+        }
+    }
+    return bytes;
+}
+
 uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max, 
     h3zero_header_parts_t * parts)
 {
@@ -556,6 +709,17 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
         bytes = h3zero_qpack_int_decode(bytes + 1, bytes_max, 0x7F, &delta_base);
     }
 
+    return h3zero_parse_qpack_field_lines(bytes, bytes_max, parts, NULL, 0, 0);
+}
+
+/* Parse the field lines that follow the prefix of the header block.
+ * References to the dynamic table are only accepted if a table is
+ * provided, and if the absolute index of the entry is lower than
+ * the required insert count.
+ */
+uint8_t* h3zero_parse_qpack_field_lines(uint8_t* bytes, uint8_t* bytes_max, h3zero_header_parts_t* parts,
+    const h3zero_qpack_table_t* table, uint64_t required_insert_count, uint64_t base)
+{
     while (bytes != NULL && bytes < bytes_max) {
         if ((bytes[0] & 0xC0) == 0xC0) {
             /* Index reference with static encoding */
@@ -657,6 +821,50 @@ uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
                 }
             }
         }
+        else if ((bytes[0] & 0xC0) == 0x80) {
+            /* Index reference to the dynamic table, relative to base */
+            uint64_t d_index;
+            const h3zero_qpack_entry_t* entry;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x3F, &d_index);
+            if (bytes != NULL) {
+                entry = h3zero_qpack_field_entry(table, required_insert_count, base, d_index, 0);
+                if (entry == NULL ||
+                    h3zero_qpack_set_header_value(entry->header, entry->value, entry->value_length, parts) != 0) {
+                    bytes = NULL;
+                }
+            }
+        }
+        else if ((bytes[0] & 0xF0) == 0x10) {
+            /* Index reference to the dynamic table, post base */
+            uint64_t d_index;
+            const h3zero_qpack_entry_t* entry;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &d_index);
+            if (bytes != NULL) {
+                entry = h3zero_qpack_field_entry(table, required_insert_count, base, d_index, 1);
+                if (entry == NULL ||
+                    h3zero_qpack_set_header_value(entry->header, entry->value, entry->value_length, parts) != 0) {
+                    bytes = NULL;
+                }
+            }
+        }
+        else if ((bytes[0] & 0xD0) == 0x40) {
+            /* Literal header field with name reference, dynamic table */
+            uint64_t d_index;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x0F, &d_index);
+            bytes = h3zero_parse_qpack_dynamic_value(bytes, bytes_max,
+                h3zero_qpack_field_entry(table, required_insert_count, base, d_index, 0), parts);
+        }
+        else if ((bytes[0] & 0xF0) == 0x00) {
+            /* Literal header field with post base name reference */
+            uint64_t d_index;
+
+            bytes = h3zero_qpack_int_decode(bytes, bytes_max, 0x07, &d_index);
+            bytes = h3zero_parse_qpack_dynamic_value(bytes, bytes_max,
+                h3zero_qpack_field_entry(table, required_insert_count, base, d_index, 1), parts);
+        }
         else {
             /* unexpected encoding */
             bytes = NULL;
@@ -721,16 +929,7 @@ uint8_t * h3zero_qpack_literal_plus_ref_encode(uint8_t * bytes, uint8_t * bytes_
     uint64_t code, uint8_t const * val, size_t val_length)
 {
     bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x50, 0x0F, code);
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F, val_length);
-    if (bytes != NULL && val_length > 0) {
-        if (bytes + val_length > bytes_max) {
-            bytes = NULL;
-        }
-        else {
-            memcpy(bytes, val, val_length);
-            bytes += val_length;
-        }
-    }
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, val, val_length);
 
     return bytes;
 }
@@ -752,46 +951,12 @@ This supposes that the literal is less than 127 bytes.
 * +-------------------------------+
 */
 
-static uint8_t * h3zero_qpack_name_encode(uint8_t * bytes, uint8_t * bytes_max,
-    uint8_t prefix, uint8_t mask, uint8_t const * name, size_t name_length) 
-{
-    if (bytes != NULL) {
-        if (bytes + 1 > bytes_max) {
-            bytes = NULL;
-        }
-        else {
-            *bytes = prefix;
-            bytes = h3zero_qpack_int_encode(bytes, bytes_max, mask, name_length);
-            if (bytes != NULL && name_length > 0) {
-                if (bytes + name_length > bytes_max) {
-                    bytes = NULL;
-                }
-                else {
-                    memcpy(bytes, name, name_length);
-                    bytes += name_length;
-                }
-            }
-        }
-    }
-
-    return bytes;
-}
-
 uint8_t * h3zero_qpack_literal_plus_name_encode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * name, size_t name_length, uint8_t const * val, size_t val_length)
 {
-
-    bytes = h3zero_qpack_name_encode(bytes, bytes_max, 0x20, 0x07, name, name_length);
-    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F, val_length);
-    if (bytes != NULL && val_length > 0) {
-        if (bytes + val_length > bytes_max) {
-            bytes = NULL;
-        }
-        else {
-            memcpy(bytes, val, val_length);
-            bytes += val_length;
-        }
-    }
+    /* Name and value are Huffman encoded if that makes them shorter */
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x20, 0x07, name, name_length);
+    bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, val, val_length);
 
     return bytes;
 }
@@ -1094,6 +1259,13 @@ void h3zero_delete_data_stream_state(h3zero_data_stream_state_t * stream_state)
         free(stream_state->current_frame);
         stream_state->current_frame = NULL;
     }
+
+    if (stream_state->blocked_bytes != NULL) {
+        free(stream_state->blocked_bytes);
+        stream_state->blocked_bytes = NULL;
+        stream_state->blocked_length = 0;
+        stream_state->blocked_size = 0;
+    }
 }
 
 /*
@@ -1126,7 +1298,7 @@ uint8_t const * h3zero_default_setting_frame = h3zero_default_setting_frame_val;
 const size_t h3zero_default_setting_frame_size = sizeof(h3zero_default_setting_frame_val);
 
 /* There is no way in QPACK to prevent sender from using Huffman 
- * encoding. We use a simple decoding function with two tables:
+ * encoding. The reference decoding function uses two tables:
  * - h3zero_qpack_huffman_bit, 64 bytes, 512 bits
  * - h3zero_qpack_huffman_val, 512 bytes.
  * If the bit at position "i" is set in the "bit" table, the code decoded so
@@ -1719,7 +1891,7 @@ const uint8_t h3zero_qpack_huffman_val[512] = {
     /* 511: |11111111|11111111|11111111|111110  V: 22 */ 22
 };
 
-int hzero_qpack_huffman_decode(uint8_t* bytes, uint8_t* bytes_max, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
+int hzero_qpack_huffman_decode_by_bit(uint8_t* bytes, uint8_t* bytes_max, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
 {
     int ret = 0;
     uint64_t val_in = 0;
@@ -1785,3 +1957,718 @@ int hzero_qpack_huffman_decode(uint8_t* bytes, uint8_t* bytes_max, uint8_t* deco
 
     return ret;
 }
+
+/* Table driven Huffman decoding.
+ * The table is indexed by the next 11 bits of the input. Each entry
+ * encodes up to two symbols whose codes fit in these 11 bits:
+ * - bits 0-7: first symbol,
+ * - bits 8-15: second symbol,
+ * - bits 16-23: length of the first code, or 0 if longer than 11 bits,
+ * - bits 24-31: length of both codes, or 0 if there is no second symbol.
+ * All symbols with codes of up to 11 bits, which includes all letters,
+ * digits and usual punctuation, are decoded through the table, most often
+ * two at a time. The rare longer codes are decoded using the bit tables.
+ */
+#define H3ZERO_QPACK_HUFFMAN_LOOKUP_BITS 11
+
+static const uint32_t h3zero_qpack_huffman_table[1 << H3ZERO_QPACK_HUFFMAN_LOOKUP_BITS] = {
+    0x0a053030, 0x0a053030, 0x0a053130, 0x0a053130, 0x0a053230, 0x0a053230, 0x0a056130, 0x0a056130,
+    0x0a056330, 0x0a056330, 0x0a056530, 0x0a056530, 0x0a056930, 0x0a056930, 0x0a056f30, 0x0a056f30,
+    0x0a057330, 0x0a057330, 0x0a057430, 0x0a057430, 0x0b052030, 0x0b052530, 0x0b052d30, 0x0b052e30,
+    0x0b052f30, 0x0b053330, 0x0b053430, 0x0b053530, 0x0b053630, 0x0b053730, 0x0b053830, 0x0b053930,
+    0x0b053d30, 0x0b054130, 0x0b055f30, 0x0b056230, 0x0b056430, 0x0b056630, 0x0b056730, 0x0b056830,
+    0x0b056c30, 0x0b056d30, 0x0b056e30, 0x0b057030, 0x0b057230, 0x0b057530, 0x00050030, 0x00050030,
+    0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030,
+    0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030, 0x00050030,
+    0x0a053031, 0x0a053031, 0x0a053131, 0x0a053131, 0x0a053231, 0x0a053231, 0x0a056131, 0x0a056131,
+    0x0a056331, 0x0a056331, 0x0a056531, 0x0a056531, 0x0a056931, 0x0a056931, 0x0a056f31, 0x0a056f31,
+    0x0a057331, 0x0a057331, 0x0a057431, 0x0a057431, 0x0b052031, 0x0b052531, 0x0b052d31, 0x0b052e31,
+    0x0b052f31, 0x0b053331, 0x0b053431, 0x0b053531, 0x0b053631, 0x0b053731, 0x0b053831, 0x0b053931,
+    0x0b053d31, 0x0b054131, 0x0b055f31, 0x0b056231, 0x0b056431, 0x0b056631, 0x0b056731, 0x0b056831,
+    0x0b056c31, 0x0b056d31, 0x0b056e31, 0x0b057031, 0x0b057231, 0x0b057531, 0x00050031, 0x00050031,
+    0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031,
+    0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031, 0x00050031,
+    0x0a053032, 0x0a053032, 0x0a053132, 0x0a053132, 0x0a053232, 0x0a053232, 0x0a056132, 0x0a056132,
+    0x0a056332, 0x0a056332, 0x0a056532, 0x0a056532, 0x0a056932, 0x0a056932, 0x0a056f32, 0x0a056f32,
+    0x0a057332, 0x0a057332, 0x0a057432, 0x0a057432, 0x0b052032, 0x0b052532, 0x0b052d32, 0x0b052e32,
+    0x0b052f32, 0x0b053332, 0x0b053432, 0x0b053532, 0x0b053632, 0x0b053732, 0x0b053832, 0x0b053932,
+    0x0b053d32, 0x0b054132, 0x0b055f32, 0x0b056232, 0x0b056432, 0x0b056632, 0x0b056732, 0x0b056832,
+    0x0b056c32, 0x0b056d32, 0x0b056e32, 0x0b057032, 0x0b057232, 0x0b057532, 0x00050032, 0x00050032,
+    0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032,
+    0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032, 0x00050032,
+    0x0a053061, 0x0a053061, 0x0a053161, 0x0a053161, 0x0a053261, 0x0a053261, 0x0a056161, 0x0a056161,
+    0x0a056361, 0x0a056361, 0x0a056561, 0x0a056561, 0x0a056961, 0x0a056961, 0x0a056f61, 0x0a056f61,
+    0x0a057361, 0x0a057361, 0x0a057461, 0x0a057461, 0x0b052061, 0x0b052561, 0x0b052d61, 0x0b052e61,
+    0x0b052f61, 0x0b053361, 0x0b053461, 0x0b053561, 0x0b053661, 0x0b053761, 0x0b053861, 0x0b053961,
+    0x0b053d61, 0x0b054161, 0x0b055f61, 0x0b056261, 0x0b056461, 0x0b056661, 0x0b056761, 0x0b056861,
+    0x0b056c61, 0x0b056d61, 0x0b056e61, 0x0b057061, 0x0b057261, 0x0b057561, 0x00050061, 0x00050061,
+    0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061,
+    0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061, 0x00050061,
+    0x0a053063, 0x0a053063, 0x0a053163, 0x0a053163, 0x0a053263, 0x0a053263, 0x0a056163, 0x0a056163,
+    0x0a056363, 0x0a056363, 0x0a056563, 0x0a056563, 0x0a056963, 0x0a056963, 0x0a056f63, 0x0a056f63,
+    0x0a057363, 0x0a057363, 0x0a057463, 0x0a057463, 0x0b052063, 0x0b052563, 0x0b052d63, 0x0b052e63,
+    0x0b052f63, 0x0b053363, 0x0b053463, 0x0b053563, 0x0b053663, 0x0b053763, 0x0b053863, 0x0b053963,
+    0x0b053d63, 0x0b054163, 0x0b055f63, 0x0b056263, 0x0b056463, 0x0b056663, 0x0b056763, 0x0b056863,
+    0x0b056c63, 0x0b056d63, 0x0b056e63, 0x0b057063, 0x0b057263, 0x0b057563, 0x00050063, 0x00050063,
+    0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063,
+    0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063, 0x00050063,
+    0x0a053065, 0x0a053065, 0x0a053165, 0x0a053165, 0x0a053265, 0x0a053265, 0x0a056165, 0x0a056165,
+    0x0a056365, 0x0a056365, 0x0a056565, 0x0a056565, 0x0a056965, 0x0a056965, 0x0a056f65, 0x0a056f65,
+    0x0a057365, 0x0a057365, 0x0a057465, 0x0a057465, 0x0b052065, 0x0b052565, 0x0b052d65, 0x0b052e65,
+    0x0b052f65, 0x0b053365, 0x0b053465, 0x0b053565, 0x0b053665, 0x0b053765, 0x0b053865, 0x0b053965,
+    0x0b053d65, 0x0b054165, 0x0b055f65, 0x0b056265, 0x0b056465, 0x0b056665, 0x0b056765, 0x0b056865,
+    0x0b056c65, 0x0b056d65, 0x0b056e65, 0x0b057065, 0x0b057265, 0x0b057565, 0x00050065, 0x00050065,
+    0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065,
+    0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065, 0x00050065,
+    0x0a053069, 0x0a053069, 0x0a053169, 0x0a053169, 0x0a053269, 0x0a053269, 0x0a056169, 0x0a056169,
+    0x0a056369, 0x0a056369, 0x0a056569, 0x0a056569, 0x0a056969, 0x0a056969, 0x0a056f69, 0x0a056f69,
+    0x0a057369, 0x0a057369, 0x0a057469, 0x0a057469, 0x0b052069, 0x0b052569, 0x0b052d69, 0x0b052e69,
+    0x0b052f69, 0x0b053369, 0x0b053469, 0x0b053569, 0x0b053669, 0x0b053769, 0x0b053869, 0x0b053969,
+    0x0b053d69, 0x0b054169, 0x0b055f69, 0x0b056269, 0x0b056469, 0x0b056669, 0x0b056769, 0x0b056869,
+    0x0b056c69, 0x0b056d69, 0x0b056e69, 0x0b057069, 0x0b057269, 0x0b057569, 0x00050069, 0x00050069,
+    0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069,
+    0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069, 0x00050069,
+    0x0a05306f, 0x0a05306f, 0x0a05316f, 0x0a05316f, 0x0a05326f, 0x0a05326f, 0x0a05616f, 0x0a05616f,
+    0x0a05636f, 0x0a05636f, 0x0a05656f, 0x0a05656f, 0x0a05696f, 0x0a05696f, 0x0a056f6f, 0x0a056f6f,
+    0x0a05736f, 0x0a05736f, 0x0a05746f, 0x0a05746f, 0x0b05206f, 0x0b05256f, 0x0b052d6f, 0x0b052e6f,
+    0x0b052f6f, 0x0b05336f, 0x0b05346f, 0x0b05356f, 0x0b05366f, 0x0b05376f, 0x0b05386f, 0x0b05396f,
+    0x0b053d6f, 0x0b05416f, 0x0b055f6f, 0x0b05626f, 0x0b05646f, 0x0b05666f, 0x0b05676f, 0x0b05686f,
+    0x0b056c6f, 0x0b056d6f, 0x0b056e6f, 0x0b05706f, 0x0b05726f, 0x0b05756f, 0x0005006f, 0x0005006f,
+    0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f,
+    0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f, 0x0005006f,
+    0x0a053073, 0x0a053073, 0x0a053173, 0x0a053173, 0x0a053273, 0x0a053273, 0x0a056173, 0x0a056173,
+    0x0a056373, 0x0a056373, 0x0a056573, 0x0a056573, 0x0a056973, 0x0a056973, 0x0a056f73, 0x0a056f73,
+    0x0a057373, 0x0a057373, 0x0a057473, 0x0a057473, 0x0b052073, 0x0b052573, 0x0b052d73, 0x0b052e73,
+    0x0b052f73, 0x0b053373, 0x0b053473, 0x0b053573, 0x0b053673, 0x0b053773, 0x0b053873, 0x0b053973,
+    0x0b053d73, 0x0b054173, 0x0b055f73, 0x0b056273, 0x0b056473, 0x0b056673, 0x0b056773, 0x0b056873,
+    0x0b056c73, 0x0b056d73, 0x0b056e73, 0x0b057073, 0x0b057273, 0x0b057573, 0x00050073, 0x00050073,
+    0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073,
+    0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073, 0x00050073,
+    0x0a053074, 0x0a053074, 0x0a053174, 0x0a053174, 0x0a053274, 0x0a053274, 0x0a056174, 0x0a056174,
+    0x0a056374, 0x0a056374, 0x0a056574, 0x0a056574, 0x0a056974, 0x0a056974, 0x0a056f74, 0x0a056f74,
+    0x0a057374, 0x0a057374, 0x0a057474, 0x0a057474, 0x0b052074, 0x0b052574, 0x0b052d74, 0x0b052e74,
+    0x0b052f74, 0x0b053374, 0x0b053474, 0x0b053574, 0x0b053674, 0x0b053774, 0x0b053874, 0x0b053974,
+    0x0b053d74, 0x0b054174, 0x0b055f74, 0x0b056274, 0x0b056474, 0x0b056674, 0x0b056774, 0x0b056874,
+    0x0b056c74, 0x0b056d74, 0x0b056e74, 0x0b057074, 0x0b057274, 0x0b057574, 0x00050074, 0x00050074,
+    0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074,
+    0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074, 0x00050074,
+    0x0b063020, 0x0b063120, 0x0b063220, 0x0b066120, 0x0b066320, 0x0b066520, 0x0b066920, 0x0b066f20,
+    0x0b067320, 0x0b067420, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020,
+    0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020,
+    0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020, 0x00060020,
+    0x0b063025, 0x0b063125, 0x0b063225, 0x0b066125, 0x0b066325, 0x0b066525, 0x0b066925, 0x0b066f25,
+    0x0b067325, 0x0b067425, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025,
+    0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025,
+    0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025, 0x00060025,
+    0x0b06302d, 0x0b06312d, 0x0b06322d, 0x0b06612d, 0x0b06632d, 0x0b06652d, 0x0b06692d, 0x0b066f2d,
+    0x0b06732d, 0x0b06742d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d,
+    0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d,
+    0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d, 0x0006002d,
+    0x0b06302e, 0x0b06312e, 0x0b06322e, 0x0b06612e, 0x0b06632e, 0x0b06652e, 0x0b06692e, 0x0b066f2e,
+    0x0b06732e, 0x0b06742e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e,
+    0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e,
+    0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e, 0x0006002e,
+    0x0b06302f, 0x0b06312f, 0x0b06322f, 0x0b06612f, 0x0b06632f, 0x0b06652f, 0x0b06692f, 0x0b066f2f,
+    0x0b06732f, 0x0b06742f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f,
+    0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f,
+    0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f, 0x0006002f,
+    0x0b063033, 0x0b063133, 0x0b063233, 0x0b066133, 0x0b066333, 0x0b066533, 0x0b066933, 0x0b066f33,
+    0x0b067333, 0x0b067433, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033,
+    0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033,
+    0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033, 0x00060033,
+    0x0b063034, 0x0b063134, 0x0b063234, 0x0b066134, 0x0b066334, 0x0b066534, 0x0b066934, 0x0b066f34,
+    0x0b067334, 0x0b067434, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034,
+    0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034,
+    0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034, 0x00060034,
+    0x0b063035, 0x0b063135, 0x0b063235, 0x0b066135, 0x0b066335, 0x0b066535, 0x0b066935, 0x0b066f35,
+    0x0b067335, 0x0b067435, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035,
+    0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035,
+    0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035, 0x00060035,
+    0x0b063036, 0x0b063136, 0x0b063236, 0x0b066136, 0x0b066336, 0x0b066536, 0x0b066936, 0x0b066f36,
+    0x0b067336, 0x0b067436, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036,
+    0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036,
+    0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036, 0x00060036,
+    0x0b063037, 0x0b063137, 0x0b063237, 0x0b066137, 0x0b066337, 0x0b066537, 0x0b066937, 0x0b066f37,
+    0x0b067337, 0x0b067437, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037,
+    0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037,
+    0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037, 0x00060037,
+    0x0b063038, 0x0b063138, 0x0b063238, 0x0b066138, 0x0b066338, 0x0b066538, 0x0b066938, 0x0b066f38,
+    0x0b067338, 0x0b067438, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038,
+    0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038,
+    0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038, 0x00060038,
+    0x0b063039, 0x0b063139, 0x0b063239, 0x0b066139, 0x0b066339, 0x0b066539, 0x0b066939, 0x0b066f39,
+    0x0b067339, 0x0b067439, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039,
+    0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039,
+    0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039, 0x00060039,
+    0x0b06303d, 0x0b06313d, 0x0b06323d, 0x0b06613d, 0x0b06633d, 0x0b06653d, 0x0b06693d, 0x0b066f3d,
+    0x0b06733d, 0x0b06743d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d,
+    0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d,
+    0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d, 0x0006003d,
+    0x0b063041, 0x0b063141, 0x0b063241, 0x0b066141, 0x0b066341, 0x0b066541, 0x0b066941, 0x0b066f41,
+    0x0b067341, 0x0b067441, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041,
+    0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041,
+    0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041, 0x00060041,
+    0x0b06305f, 0x0b06315f, 0x0b06325f, 0x0b06615f, 0x0b06635f, 0x0b06655f, 0x0b06695f, 0x0b066f5f,
+    0x0b06735f, 0x0b06745f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f,
+    0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f,
+    0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f, 0x0006005f,
+    0x0b063062, 0x0b063162, 0x0b063262, 0x0b066162, 0x0b066362, 0x0b066562, 0x0b066962, 0x0b066f62,
+    0x0b067362, 0x0b067462, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062,
+    0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062,
+    0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062, 0x00060062,
+    0x0b063064, 0x0b063164, 0x0b063264, 0x0b066164, 0x0b066364, 0x0b066564, 0x0b066964, 0x0b066f64,
+    0x0b067364, 0x0b067464, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064,
+    0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064,
+    0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064, 0x00060064,
+    0x0b063066, 0x0b063166, 0x0b063266, 0x0b066166, 0x0b066366, 0x0b066566, 0x0b066966, 0x0b066f66,
+    0x0b067366, 0x0b067466, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066,
+    0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066,
+    0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066, 0x00060066,
+    0x0b063067, 0x0b063167, 0x0b063267, 0x0b066167, 0x0b066367, 0x0b066567, 0x0b066967, 0x0b066f67,
+    0x0b067367, 0x0b067467, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067,
+    0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067,
+    0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067, 0x00060067,
+    0x0b063068, 0x0b063168, 0x0b063268, 0x0b066168, 0x0b066368, 0x0b066568, 0x0b066968, 0x0b066f68,
+    0x0b067368, 0x0b067468, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068,
+    0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068,
+    0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068, 0x00060068,
+    0x0b06306c, 0x0b06316c, 0x0b06326c, 0x0b06616c, 0x0b06636c, 0x0b06656c, 0x0b06696c, 0x0b066f6c,
+    0x0b06736c, 0x0b06746c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c,
+    0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c,
+    0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c, 0x0006006c,
+    0x0b06306d, 0x0b06316d, 0x0b06326d, 0x0b06616d, 0x0b06636d, 0x0b06656d, 0x0b06696d, 0x0b066f6d,
+    0x0b06736d, 0x0b06746d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d,
+    0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d,
+    0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d, 0x0006006d,
+    0x0b06306e, 0x0b06316e, 0x0b06326e, 0x0b06616e, 0x0b06636e, 0x0b06656e, 0x0b06696e, 0x0b066f6e,
+    0x0b06736e, 0x0b06746e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e,
+    0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e,
+    0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e, 0x0006006e,
+    0x0b063070, 0x0b063170, 0x0b063270, 0x0b066170, 0x0b066370, 0x0b066570, 0x0b066970, 0x0b066f70,
+    0x0b067370, 0x0b067470, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070,
+    0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070,
+    0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070, 0x00060070,
+    0x0b063072, 0x0b063172, 0x0b063272, 0x0b066172, 0x0b066372, 0x0b066572, 0x0b066972, 0x0b066f72,
+    0x0b067372, 0x0b067472, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072,
+    0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072,
+    0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072, 0x00060072,
+    0x0b063075, 0x0b063175, 0x0b063275, 0x0b066175, 0x0b066375, 0x0b066575, 0x0b066975, 0x0b066f75,
+    0x0b067375, 0x0b067475, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075,
+    0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075,
+    0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075, 0x00060075,
+    0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a,
+    0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a, 0x0007003a,
+    0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042,
+    0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042, 0x00070042,
+    0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043,
+    0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043, 0x00070043,
+    0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044,
+    0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044, 0x00070044,
+    0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045,
+    0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045, 0x00070045,
+    0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046,
+    0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046, 0x00070046,
+    0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047,
+    0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047, 0x00070047,
+    0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048,
+    0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048, 0x00070048,
+    0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049,
+    0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049, 0x00070049,
+    0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a,
+    0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a, 0x0007004a,
+    0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b,
+    0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b, 0x0007004b,
+    0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c,
+    0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c, 0x0007004c,
+    0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d,
+    0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d, 0x0007004d,
+    0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e,
+    0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e, 0x0007004e,
+    0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f,
+    0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f, 0x0007004f,
+    0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050,
+    0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050, 0x00070050,
+    0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051,
+    0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051, 0x00070051,
+    0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052,
+    0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052, 0x00070052,
+    0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053,
+    0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053, 0x00070053,
+    0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054,
+    0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054, 0x00070054,
+    0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055,
+    0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055, 0x00070055,
+    0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056,
+    0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056, 0x00070056,
+    0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057,
+    0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057, 0x00070057,
+    0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059,
+    0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059, 0x00070059,
+    0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a,
+    0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a, 0x0007006a,
+    0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b,
+    0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b, 0x0007006b,
+    0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071,
+    0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071, 0x00070071,
+    0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076,
+    0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076, 0x00070076,
+    0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077,
+    0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077, 0x00070077,
+    0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078,
+    0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078, 0x00070078,
+    0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079,
+    0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079, 0x00070079,
+    0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a,
+    0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a, 0x0007007a,
+    0x00080026, 0x00080026, 0x00080026, 0x00080026, 0x00080026, 0x00080026, 0x00080026, 0x00080026,
+    0x0008002a, 0x0008002a, 0x0008002a, 0x0008002a, 0x0008002a, 0x0008002a, 0x0008002a, 0x0008002a,
+    0x0008002c, 0x0008002c, 0x0008002c, 0x0008002c, 0x0008002c, 0x0008002c, 0x0008002c, 0x0008002c,
+    0x0008003b, 0x0008003b, 0x0008003b, 0x0008003b, 0x0008003b, 0x0008003b, 0x0008003b, 0x0008003b,
+    0x00080058, 0x00080058, 0x00080058, 0x00080058, 0x00080058, 0x00080058, 0x00080058, 0x00080058,
+    0x0008005a, 0x0008005a, 0x0008005a, 0x0008005a, 0x0008005a, 0x0008005a, 0x0008005a, 0x0008005a,
+    0x000a0021, 0x000a0021, 0x000a0022, 0x000a0022, 0x000a0028, 0x000a0028, 0x000a0029, 0x000a0029,
+    0x000a003f, 0x000a003f, 0x000b0027, 0x000b002b, 0x000b007c, 0x00000000, 0x00000000, 0x00000000
+};
+
+/* Decode a single symbol with a code longer than the lookup bits, following
+ * the bit tables. Returns -1 if the input ends before the code is complete,
+ * or if the code is EOS.
+ */
+static int h3zero_qpack_huffman_decode_long(uint64_t val_in, int bits_in, int* nb_bits)
+{
+    int index = 0;
+    int nb_read = 0;
+
+    while ((h3zero_qpack_huffman_bit[index >> 3] >> (7 - (index & 7))) & 1) {
+        if (nb_read >= bits_in) {
+            return -1;
+        }
+        if ((val_in >> (63 - nb_read)) & 1) {
+            index += h3zero_qpack_huffman_val[index];
+        }
+        else {
+            index++;
+        }
+        nb_read++;
+        if (index >= 512) {
+            /* EOS in the middle of the string */
+            return -1;
+        }
+    }
+    *nb_bits = nb_read;
+    return h3zero_qpack_huffman_val[index];
+}
+
+int hzero_qpack_huffman_decode(uint8_t* bytes, uint8_t* bytes_max, uint8_t* decoded, size_t max_decoded, size_t* nb_decoded)
+{
+    int ret = 0;
+    uint64_t val_in = 0;
+    int bits_in = 0;
+    size_t decoded_index = 0;
+
+    while (ret == 0) {
+        uint64_t lookup;
+        uint32_t entry;
+        int nb_bits;
+
+        /* Refill the registry */
+        while (bits_in <= 56 && bytes < bytes_max) {
+            val_in |= ((uint64_t)*bytes++) << (56 - bits_in);
+            bits_in += 8;
+        }
+        if (bits_in == 0) {
+            break;
+        }
+        if (bits_in < H3ZERO_QPACK_HUFFMAN_LOOKUP_BITS) {
+            /* Read the missing bits as ones, as in the EOS padding */
+            lookup = val_in | (UINT64_MAX >> bits_in);
+        }
+        else {
+            lookup = val_in;
+        }
+        entry = h3zero_qpack_huffman_table[lookup >> (64 - H3ZERO_QPACK_HUFFMAN_LOOKUP_BITS)];
+        nb_bits = (entry >> 16) & 0xFF;
+
+        if (nb_bits == 0) {
+            int symbol = h3zero_qpack_huffman_decode_long(val_in, bits_in, &nb_bits);
+            if (symbol < 0) {
+                /* End of input, or EOS: the remaining bits must all be ones */
+                if ((val_in >> (64 - bits_in)) != (UINT64_MAX >> (64 - bits_in))) {
+                    ret = -1;
+                }
+                break;
+            }
+            entry = (uint32_t)symbol;
+        }
+        else if (nb_bits > bits_in) {
+            /* Only padding remains, which must be all ones */
+            if ((val_in >> (64 - bits_in)) != (UINT64_MAX >> (64 - bits_in))) {
+                ret = -1;
+            }
+            break;
+        }
+
+        if (decoded_index >= max_decoded) {
+            ret = -1;
+            break;
+        }
+        decoded[decoded_index++] = (uint8_t)entry;
+        val_in <<= nb_bits;
+        bits_in -= nb_bits;
+
+        if ((entry >> 24) != 0) {
+            int nb_bits_second = (int)(entry >> 24) - nb_bits;
+            if (nb_bits_second <= bits_in) {
+                if (decoded_index >= max_decoded) {
+                    ret = -1;
+                    break;
+                }
+                decoded[decoded_index++] = (uint8_t)(entry >> 8);
+                val_in <<= nb_bits_second;
+                bits_in -= nb_bits_second;
+            }
+        }
+    }
+
+    *nb_decoded = decoded_index;
+
+    return ret;
+}
+
+/* Huffman codes of RFC 7541, appendix B, indexed by symbol.
+ */
+typedef struct st_h3zero_qpack_huffman_code_t {
+    uint32_t code;
+    uint8_t nb_bits;
+} h3zero_qpack_huffman_code_t;
+
+static const h3zero_qpack_huffman_code_t h3zero_qpack_huffman_code[257] = {
+    { 0x1ff8, 13 }, /* 0 */
+    { 0x7fffd8, 23 }, /* 1 */
+    { 0xfffffe2, 28 }, /* 2 */
+    { 0xfffffe3, 28 }, /* 3 */
+    { 0xfffffe4, 28 }, /* 4 */
+    { 0xfffffe5, 28 }, /* 5 */
+    { 0xfffffe6, 28 }, /* 6 */
+    { 0xfffffe7, 28 }, /* 7 */
+    { 0xfffffe8, 28 }, /* 8 */
+    { 0xffffea, 24 }, /* 9 */
+    { 0x3ffffffc, 30 }, /* 10 */
+    { 0xfffffe9, 28 }, /* 11 */
+    { 0xfffffea, 28 }, /* 12 */
+    { 0x3ffffffd, 30 }, /* 13 */
+    { 0xfffffeb, 28 }, /* 14 */
+    { 0xfffffec, 28 }, /* 15 */
+    { 0xfffffed, 28 }, /* 16 */
+    { 0xfffffee, 28 }, /* 17 */
+    { 0xfffffef, 28 }, /* 18 */
+    { 0xffffff0, 28 }, /* 19 */
+    { 0xffffff1, 28 }, /* 20 */
+    { 0xffffff2, 28 }, /* 21 */
+    { 0x3ffffffe, 30 }, /* 22 */
+    { 0xffffff3, 28 }, /* 23 */
+    { 0xffffff4, 28 }, /* 24 */
+    { 0xffffff5, 28 }, /* 25 */
+    { 0xffffff6, 28 }, /* 26 */
+    { 0xffffff7, 28 }, /* 27 */
+    { 0xffffff8, 28 }, /* 28 */
+    { 0xffffff9, 28 }, /* 29 */
+    { 0xffffffa, 28 }, /* 30 */
+    { 0xffffffb, 28 }, /* 31 */
+    { 0x14, 6 }, /* ' ' */
+    { 0x3f8, 10 }, /* '!' */
+    { 0x3f9, 10 }, /* '"' */
+    { 0xffa, 12 }, /* '#' */
+    { 0x1ff9, 13 }, /* '$' */
+    { 0x15, 6 }, /* '%' */
+    { 0xf8, 8 }, /* '&' */
+    { 0x7fa, 11 }, /* 39 */
+    { 0x3fa, 10 }, /* '(' */
+    { 0x3fb, 10 }, /* ')' */
+    { 0xf9, 8 }, /* '*' */
+    { 0x7fb, 11 }, /* '+' */
+    { 0xfa, 8 }, /* ',' */
+    { 0x16, 6 }, /* '-' */
+    { 0x17, 6 }, /* '.' */
+    { 0x18, 6 }, /* '/' */
+    { 0x0, 5 }, /* '0' */
+    { 0x1, 5 }, /* '1' */
+    { 0x2, 5 }, /* '2' */
+    { 0x19, 6 }, /* '3' */
+    { 0x1a, 6 }, /* '4' */
+    { 0x1b, 6 }, /* '5' */
+    { 0x1c, 6 }, /* '6' */
+    { 0x1d, 6 }, /* '7' */
+    { 0x1e, 6 }, /* '8' */
+    { 0x1f, 6 }, /* '9' */
+    { 0x5c, 7 }, /* ':' */
+    { 0xfb, 8 }, /* ';' */
+    { 0x7ffc, 15 }, /* '<' */
+    { 0x20, 6 }, /* '=' */
+    { 0xffb, 12 }, /* '>' */
+    { 0x3fc, 10 }, /* '?' */
+    { 0x1ffa, 13 }, /* '@' */
+    { 0x21, 6 }, /* 'A' */
+    { 0x5d, 7 }, /* 'B' */
+    { 0x5e, 7 }, /* 'C' */
+    { 0x5f, 7 }, /* 'D' */
+    { 0x60, 7 }, /* 'E' */
+    { 0x61, 7 }, /* 'F' */
+    { 0x62, 7 }, /* 'G' */
+    { 0x63, 7 }, /* 'H' */
+    { 0x64, 7 }, /* 'I' */
+    { 0x65, 7 }, /* 'J' */
+    { 0x66, 7 }, /* 'K' */
+    { 0x67, 7 }, /* 'L' */
+    { 0x68, 7 }, /* 'M' */
+    { 0x69, 7 }, /* 'N' */
+    { 0x6a, 7 }, /* 'O' */
+    { 0x6b, 7 }, /* 'P' */
+    { 0x6c, 7 }, /* 'Q' */
+    { 0x6d, 7 }, /* 'R' */
+    { 0x6e, 7 }, /* 'S' */
+    { 0x6f, 7 }, /* 'T' */
+    { 0x70, 7 }, /* 'U' */
+    { 0x71, 7 }, /* 'V' */
+    { 0x72, 7 }, /* 'W' */
+    { 0xfc, 8 }, /* 'X' */
+    { 0x73, 7 }, /* 'Y' */
+    { 0xfd, 8 }, /* 'Z' */
+    { 0x1ffb, 13 }, /* '[' */
+    { 0x7fff0, 19 }, /* 92 */
+    { 0x1ffc, 13 }, /* ']' */
+    { 0x3ffc, 14 }, /* '^' */
+    { 0x22, 6 }, /* '_' */
+    { 0x7ffd, 15 }, /* '`' */
+    { 0x3, 5 }, /* 'a' */
+    { 0x23, 6 }, /* 'b' */
+    { 0x4, 5 }, /* 'c' */
+    { 0x24, 6 }, /* 'd' */
+    { 0x5, 5 }, /* 'e' */
+    { 0x25, 6 }, /* 'f' */
+    { 0x26, 6 }, /* 'g' */
+    { 0x27, 6 }, /* 'h' */
+    { 0x6, 5 }, /* 'i' */
+    { 0x74, 7 }, /* 'j' */
+    { 0x75, 7 }, /* 'k' */
+    { 0x28, 6 }, /* 'l' */
+    { 0x29, 6 }, /* 'm' */
+    { 0x2a, 6 }, /* 'n' */
+    { 0x7, 5 }, /* 'o' */
+    { 0x2b, 6 }, /* 'p' */
+    { 0x76, 7 }, /* 'q' */
+    { 0x2c, 6 }, /* 'r' */
+    { 0x8, 5 }, /* 's' */
+    { 0x9, 5 }, /* 't' */
+    { 0x2d, 6 }, /* 'u' */
+    { 0x77, 7 }, /* 'v' */
+    { 0x78, 7 }, /* 'w' */
+    { 0x79, 7 }, /* 'x' */
+    { 0x7a, 7 }, /* 'y' */
+    { 0x7b, 7 }, /* 'z' */
+    { 0x7ffe, 15 }, /* '{' */
+    { 0x7fc, 11 }, /* '|' */
+    { 0x3ffd, 14 }, /* '}' */
+    { 0x1ffd, 13 }, /* '~' */
+    { 0xffffffc, 28 }, /* 127 */
+    { 0xfffe6, 20 }, /* 128 */
+    { 0x3fffd2, 22 }, /* 129 */
+    { 0xfffe7, 20 }, /* 130 */
+    { 0xfffe8, 20 }, /* 131 */
+    { 0x3fffd3, 22 }, /* 132 */
+    { 0x3fffd4, 22 }, /* 133 */
+    { 0x3fffd5, 22 }, /* 134 */
+    { 0x7fffd9, 23 }, /* 135 */
+    { 0x3fffd6, 22 }, /* 136 */
+    { 0x7fffda, 23 }, /* 137 */
+    { 0x7fffdb, 23 }, /* 138 */
+    { 0x7fffdc, 23 }, /* 139 */
+    { 0x7fffdd, 23 }, /* 140 */
+    { 0x7fffde, 23 }, /* 141 */
+    { 0xffffeb, 24 }, /* 142 */
+    { 0x7fffdf, 23 }, /* 143 */
+    { 0xffffec, 24 }, /* 144 */
+    { 0xffffed, 24 }, /* 145 */
+    { 0x3fffd7, 22 }, /* 146 */
+    { 0x7fffe0, 23 }, /* 147 */
+    { 0xffffee, 24 }, /* 148 */
+    { 0x7fffe1, 23 }, /* 149 */
+    { 0x7fffe2, 23 }, /* 150 */
+    { 0x7fffe3, 23 }, /* 151 */
+    { 0x7fffe4, 23 }, /* 152 */
+    { 0x1fffdc, 21 }, /* 153 */
+    { 0x3fffd8, 22 }, /* 154 */
+    { 0x7fffe5, 23 }, /* 155 */
+    { 0x3fffd9, 22 }, /* 156 */
+    { 0x7fffe6, 23 }, /* 157 */
+    { 0x7fffe7, 23 }, /* 158 */
+    { 0xffffef, 24 }, /* 159 */
+    { 0x3fffda, 22 }, /* 160 */
+    { 0x1fffdd, 21 }, /* 161 */
+    { 0xfffe9, 20 }, /* 162 */
+    { 0x3fffdb, 22 }, /* 163 */
+    { 0x3fffdc, 22 }, /* 164 */
+    { 0x7fffe8, 23 }, /* 165 */
+    { 0x7fffe9, 23 }, /* 166 */
+    { 0x1fffde, 21 }, /* 167 */
+    { 0x7fffea, 23 }, /* 168 */
+    { 0x3fffdd, 22 }, /* 169 */
+    { 0x3fffde, 22 }, /* 170 */
+    { 0xfffff0, 24 }, /* 171 */
+    { 0x1fffdf, 21 }, /* 172 */
+    { 0x3fffdf, 22 }, /* 173 */
+    { 0x7fffeb, 23 }, /* 174 */
+    { 0x7fffec, 23 }, /* 175 */
+    { 0x1fffe0, 21 }, /* 176 */
+    { 0x1fffe1, 21 }, /* 177 */
+    { 0x3fffe0, 22 }, /* 178 */
+    { 0x1fffe2, 21 }, /* 179 */
+    { 0x7fffed, 23 }, /* 180 */
+    { 0x3fffe1, 22 }, /* 181 */
+    { 0x7fffee, 23 }, /* 182 */
+    { 0x7fffef, 23 }, /* 183 */
+    { 0xfffea, 20 }, /* 184 */
+    { 0x3fffe2, 22 }, /* 185 */
+    { 0x3fffe3, 22 }, /* 186 */
+    { 0x3fffe4, 22 }, /* 187 */
+    { 0x7ffff0, 23 }, /* 188 */
+    { 0x3fffe5, 22 }, /* 189 */
+    { 0x3fffe6, 22 }, /* 190 */
+    { 0x7ffff1, 23 }, /* 191 */
+    { 0x3ffffe0, 26 }, /* 192 */
+    { 0x3ffffe1, 26 }, /* 193 */
+    { 0xfffeb, 20 }, /* 194 */
+    { 0x7fff1, 19 }, /* 195 */
+    { 0x3fffe7, 22 }, /* 196 */
+    { 0x7ffff2, 23 }, /* 197 */
+    { 0x3fffe8, 22 }, /* 198 */
+    { 0x1ffffec, 25 }, /* 199 */
+    { 0x3ffffe2, 26 }, /* 200 */
+    { 0x3ffffe3, 26 }, /* 201 */
+    { 0x3ffffe4, 26 }, /* 202 */
+    { 0x7ffffde, 27 }, /* 203 */
+    { 0x7ffffdf, 27 }, /* 204 */
+    { 0x3ffffe5, 26 }, /* 205 */
+    { 0xfffff1, 24 }, /* 206 */
+    { 0x1ffffed, 25 }, /* 207 */
+    { 0x7fff2, 19 }, /* 208 */
+    { 0x1fffe3, 21 }, /* 209 */
+    { 0x3ffffe6, 26 }, /* 210 */
+    { 0x7ffffe0, 27 }, /* 211 */
+    { 0x7ffffe1, 27 }, /* 212 */
+    { 0x3ffffe7, 26 }, /* 213 */
+    { 0x7ffffe2, 27 }, /* 214 */
+    { 0xfffff2, 24 }, /* 215 */
+    { 0x1fffe4, 21 }, /* 216 */
+    { 0x1fffe5, 21 }, /* 217 */
+    { 0x3ffffe8, 26 }, /* 218 */
+    { 0x3ffffe9, 26 }, /* 219 */
+    { 0xffffffd, 28 }, /* 220 */
+    { 0x7ffffe3, 27 }, /* 221 */
+    { 0x7ffffe4, 27 }, /* 222 */
+    { 0x7ffffe5, 27 }, /* 223 */
+    { 0xfffec, 20 }, /* 224 */
+    { 0xfffff3, 24 }, /* 225 */
+    { 0xfffed, 20 }, /* 226 */
+    { 0x1fffe6, 21 }, /* 227 */
+    { 0x3fffe9, 22 }, /* 228 */
+    { 0x1fffe7, 21 }, /* 229 */
+    { 0x1fffe8, 21 }, /* 230 */
+    { 0x7ffff3, 23 }, /* 231 */
+    { 0x3fffea, 22 }, /* 232 */
+    { 0x3fffeb, 22 }, /* 233 */
+    { 0x1ffffee, 25 }, /* 234 */
+    { 0x1ffffef, 25 }, /* 235 */
+    { 0xfffff4, 24 }, /* 236 */
+    { 0xfffff5, 24 }, /* 237 */
+    { 0x3ffffea, 26 }, /* 238 */
+    { 0x7ffff4, 23 }, /* 239 */
+    { 0x3ffffeb, 26 }, /* 240 */
+    { 0x7ffffe6, 27 }, /* 241 */
+    { 0x3ffffec, 26 }, /* 242 */
+    { 0x3ffffed, 26 }, /* 243 */
+    { 0x7ffffe7, 27 }, /* 244 */
+    { 0x7ffffe8, 27 }, /* 245 */
+    { 0x7ffffe9, 27 }, /* 246 */
+    { 0x7ffffea, 27 }, /* 247 */
+    { 0x7ffffeb, 27 }, /* 248 */
+    { 0xffffffe, 28 }, /* 249 */
+    { 0x7ffffec, 27 }, /* 250 */
+    { 0x7ffffed, 27 }, /* 251 */
+    { 0x7ffffee, 27 }, /* 252 */
+    { 0x7ffffef, 27 }, /* 253 */
+    { 0x7fffff0, 27 }, /* 254 */
+    { 0x3ffffee, 26 }, /* 255 */
+    { 0x3fffffff, 30 }  /* EOS */
+};
+
+size_t h3zero_qpack_huffman_length(uint8_t const* val, size_t val_length)
+{
+    uint64_t nb_bits = 0;
+
+    for (size_t i = 0; i < val_length; i++) {
+        nb_bits += h3zero_qpack_huffman_code[val[i]].nb_bits;
+    }
+
+    return (size_t)((nb_bits + 7) >> 3);
+}
+
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t const* val, size_t val_length)
+{
+    uint64_t acc = 0;
+    int acc_bits = 0;
+
+    for (size_t i = 0; bytes != NULL && i < val_length; i++) {
+        acc = (acc << h3zero_qpack_huffman_code[val[i]].nb_bits) | h3zero_qpack_huffman_code[val[i]].code;
+        acc_bits += h3zero_qpack_huffman_code[val[i]].nb_bits;
+        while (acc_bits >= 8) {
+            if (bytes >= bytes_max) {
+                bytes = NULL;
+                break;
+            }
+            acc_bits -= 8;
+            *bytes++ = (uint8_t)(acc >> acc_bits);
+        }
+    }
+    if (bytes != NULL && acc_bits > 0) {
+        /* Pad with the most significant bits of EOS */
+        if (bytes >= bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            *bytes++ = (uint8_t)((acc << (8 - acc_bits)) | (0xFF >> acc_bits));
+        }
+    }
+
+    return bytes;
+}
+
+/* Encode a string literal, with an H bit just above the length prefix.
+ * Huffman encoding is used if it makes the string shorter.
+ */
+uint8_t* h3zero_qpack_string_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t prefix, uint8_t mask,
+    uint8_t const* val, size_t val_length)
+{
+    size_t huffman_length = h3zero_qpack_huffman_length(val, val_length);
+
+    if (huffman_length < val_length) {
+        bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix | (uint8_t)(mask + 1), mask, huffman_length);
+        if (bytes != NULL) {
+            bytes = h3zero_qpack_huffman_encode(bytes, bytes_max, val, val_length);
+        }
+    }
+    else {
+        bytes = h3zero_qpack_code_encode(bytes, bytes_max, prefix, mask, val_length);
+        if (bytes != NULL && val_length > 0) {
+            if (bytes + val_length > bytes_max) {
+                bytes = NULL;
+            }
+            else {
+                memcpy(bytes, val, val_length);
+                bytes += val_length;
+            }
+        }
+    }
+
+    return bytes;
+}
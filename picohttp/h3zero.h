@@ -236,6 +236,10 @@ uint8_t* h3zero_qpack_literal_plus_ref_encode(uint8_t* bytes, uint8_t* bytes_max
 
 uint8_t * h3zero_parse_qpack_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     h3zero_header_parts_t * parts);
+int h3zero_qpack_set_header_value(http_header_enum_t header, uint8_t* decoded,
+    size_t decoded_length, h3zero_header_parts_t* parts);
+int h3zero_get_interesting_header_type(uint8_t* name, size_t name_length, int is_huffman);
+char const* h3zero_qpack_static_name(uint64_t s_index, size_t* name_length, http_header_enum_t* header);
 uint8_t* h3zero_qpack_code_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t prefix, uint8_t mask, uint64_t code);
 uint8_t * h3zero_create_request_header_frame(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t const * path, size_t path_length, char const * host);
@@ -276,6 +280,11 @@ typedef struct st_h3zero_data_stream_state_t {
     uint64_t control_stream_id;
     uint8_t frame_header[16];
     size_t frame_header_read;
+    uint64_t stream_id;
+    /* Bytes received while the header is blocked waiting for QPACK encoder instructions */
+    uint8_t* blocked_bytes;
+    size_t blocked_length;
+    size_t blocked_size;
     unsigned int is_upgrade_requested:1;
     unsigned int is_web_transport : 1;
     unsigned int frame_header_parsed : 1;
@@ -287,6 +296,8 @@ typedef struct st_h3zero_data_stream_state_t {
     /* Keeping track of FIN sent and FIN received, so applications can delete stream contexts that are not useful */
     unsigned int is_fin_received : 1; 
     unsigned int is_fin_sent : 1;
+    unsigned int is_qpack_blocked : 1;
+    unsigned int is_fin_blocked : 1;
 } h3zero_data_stream_state_t;
 
 /* Parsing of a data stream. This is implemented as a filter, with a set of states:
@@ -310,6 +321,13 @@ void h3zero_release_header_parts(h3zero_header_parts_t* header);
 
 int hzero_qpack_huffman_decode(uint8_t * bytes, uint8_t * bytes_max,
     uint8_t * decoded, size_t max_decoded, size_t * nb_decoded);
+/* Reference decoder, one bit at a time, kept for tests and benchmarks */
+int hzero_qpack_huffman_decode_by_bit(uint8_t* bytes, uint8_t* bytes_max,
+    uint8_t* decoded, size_t max_decoded, size_t* nb_decoded);
+size_t h3zero_qpack_huffman_length(uint8_t const* val, size_t val_length);
+uint8_t* h3zero_qpack_huffman_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t const* val, size_t val_length);
+uint8_t* h3zero_qpack_string_encode(uint8_t* bytes, uint8_t* bytes_max, uint8_t prefix, uint8_t mask,
+    uint8_t const* val, size_t val_length);
 
 /* TLV_Buffer_accumulator 
 */
@@ -31,7 +31,10 @@
  * but the client implementation is barebone.
  */
 
-int h3zero_client_create_stream_request_ex(
+/* Create the request, and compress its header with the QPACK dynamic table if
+ * `qpack` is not NULL and the peer enabled the table. The caller then sends the
+ * encoder instructions, e.g., with h3zero_qpack_send_instructions. */
+int h3zero_client_create_stream_request_qpack(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
     uint8_t * buffer, size_t max_bytes, uint8_t const * path, size_t path_len, const char * range, size_t range_len, uint64_t post_size, const char * host, size_t * consumed)
 {
     int ret = 0;
@@ -58,6 +61,9 @@ int h3zero_client_create_stream_request_ex(
             o_bytes = h3zero_create_post_header_frame(o_bytes, o_bytes_max,
                 (const uint8_t *)path, path_len, host, h3zero_content_type_text_plain);
         }
+        if (o_bytes != NULL) {
+            o_bytes = h3zero_qpack_compress_header_block(qpack, stream_id, &buffer[3], o_bytes, o_bytes_max);
+        }
     }
 
     if (o_bytes == NULL) {
@@ -99,6 +105,12 @@ int h3zero_client_create_stream_request_ex(
     return ret;
 }
 
+int h3zero_client_create_stream_request_ex(
+    uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, const char* range, size_t range_len, uint64_t post_size, const char* host, size_t* consumed)
+{
+    return h3zero_client_create_stream_request_qpack(NULL, 0, buffer, max_bytes, path, path_len, range, range_len, post_size, host, consumed);
+}
+
 int h3zero_client_create_stream_request(
     uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, uint64_t post_size, const char* host, size_t* consumed)
 {
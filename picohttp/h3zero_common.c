@@ -71,6 +71,10 @@ static void picohttp_clear_stream_ctx(h3zero_stream_ctx_t* stream_ctx)
 	if (stream_ctx->F != NULL) {
 		stream_ctx->F = picoquic_file_close(stream_ctx->F);
 	}
+	if (stream_ctx->file_read != NULL) {
+		h3zero_file_reader_close(stream_ctx->file_read);
+		stream_ctx->file_read = NULL;
+	}
 
 	if (stream_ctx->path_callback != NULL) {
 		(void)stream_ctx->path_callback(stream_ctx->cnx, NULL, 0, picohttp_callback_free, stream_ctx, stream_ctx->path_callback_ctx);
@@ -96,21 +100,42 @@ static void picohttp_stream_node_delete(void * tree, picosplay_node_t * node)
 
 void h3zero_delete_stream(picoquic_cnx_t * cnx, h3zero_callback_ctx_t* ctx, h3zero_stream_ctx_t* stream_ctx)
 {
+	if (stream_ctx->is_h3 && stream_ctx->ps.stream_state.is_qpack_blocked) {
+		h3zero_qpack_cancel_stream(&ctx->qpack, stream_ctx->stream_id);
+	}
 	if (cnx != NULL) {
 		picoquic_unlink_app_stream_ctx(cnx, stream_ctx->stream_id);
 	}
+	if (stream_ctx->is_not_indexed) {
+		ctx->nb_streams_not_indexed--;
+	}
+	else {
+		picoindex_remove(&ctx->h3_stream_index[stream_ctx->stream_id & 3], stream_ctx->stream_id >> 2);
+	}
 	picosplay_delete(&ctx->h3_stream_tree, &stream_ctx->http_stream_node);
 }
 
+void h3zero_delete_all_streams(h3zero_callback_ctx_t* ctx)
+{
+	picosplay_empty_tree(&ctx->h3_stream_tree);
+	for (int i = 0; i < 4; i++) {
+		picoindex_clear(&ctx->h3_stream_index[i]);
+	}
+	ctx->nb_streams_not_indexed = 0;
+}
+
 h3zero_stream_ctx_t* h3zero_find_stream(h3zero_callback_ctx_t* ctx, uint64_t stream_id)
 {
-	h3zero_stream_ctx_t * ret = NULL;
-	h3zero_stream_ctx_t target;
-	target.stream_id = stream_id;
-	picosplay_node_t * node = picosplay_find(&ctx->h3_stream_tree, (void*)&target);
+	h3zero_stream_ctx_t * ret = (h3zero_stream_ctx_t*)picoindex_get(&ctx->h3_stream_index[stream_id & 3], stream_id >> 2);
+
+	if (ret == NULL && ctx->nb_streams_not_indexed > 0) {
+		h3zero_stream_ctx_t target;
+		target.stream_id = stream_id;
+		picosplay_node_t* node = picosplay_find(&ctx->h3_stream_tree, (void*)&target);
 
-	if (node != NULL) {
-		ret = (h3zero_stream_ctx_t *)picohttp_stream_node_value(node);
+		if (node != NULL) {
+			ret = (h3zero_stream_ctx_t*)picohttp_stream_node_value(node);
+		}
 	}
 
 	return ret;
@@ -141,6 +166,7 @@ h3zero_stream_ctx_t * h3zero_find_or_create_stream(
 			stream_ctx->cnx = cnx;
 			if (is_h3) {
 				stream_ctx->ps.stream_state.h3_ctx = ctx;
+				stream_ctx->ps.stream_state.stream_id = stream_id;
 				stream_ctx->ps.stream_state.stream_type = UINT64_MAX;
 				stream_ctx->ps.stream_state.control_stream_id = UINT64_MAX;
 				if (!IS_BIDIR_STREAM_ID(stream_id)) {
@@ -152,6 +178,10 @@ h3zero_stream_ctx_t * h3zero_find_or_create_stream(
 					}
 				}
 			}
+			if (picoindex_set(&ctx->h3_stream_index[stream_id & 3], stream_id >> 2, stream_ctx) != 0) {
+				stream_ctx->is_not_indexed = 1;
+				ctx->nb_streams_not_indexed++;
+			}
 			picosplay_insert(&ctx->h3_stream_tree, stream_ctx);
 		}
 	}
@@ -286,7 +316,8 @@ uint64_t h3zero_parse_stream_prefix(uint8_t* buffer_8, size_t* nb_in_buffer, uin
 }
 #endif
 
-int h3zero_protocol_init(picoquic_cnx_t* cnx)
+static int h3zero_protocol_init_streams(picoquic_cnx_t* cnx, h3zero_settings_t* settings,
+	uint64_t* encoder_stream_id, uint64_t* decoder_stream_id)
 {
 	uint8_t decoder_stream_head = (uint8_t)h3zero_stream_type_qpack_decoder;
 	uint8_t encoder_stream_head = (uint8_t)h3zero_stream_type_qpack_encoder;
@@ -294,20 +325,19 @@ int h3zero_protocol_init(picoquic_cnx_t* cnx)
 	/* Some of the setting values depend on the presence of connection parameters */
 	uint8_t settings_buffer[256];
 	uint8_t* settings_last = 0;
-	h3zero_settings_t settings = { 0 };
 	int ret = 0;
 
-	settings.enable_connect_protocol = 1;
+	settings->enable_connect_protocol = 1;
 
 	/* Web transport is only enabled if h3 datagrams are supported.
 	 */
 	if (cnx->local_parameters.max_datagram_frame_size > 0) {
-		settings.h3_datagram = 1;
-		settings.webtransport_max_sessions = 1;
+		settings->h3_datagram = 1;
+		settings->webtransport_max_sessions = 1;
 	}
 
 	settings_buffer[0] = (uint8_t)h3zero_stream_type_control;
-	if ((settings_last = h3zero_settings_encode(settings_buffer + 1, settings_buffer + sizeof(settings_buffer), &settings)) == NULL) {
+	if ((settings_last = h3zero_settings_encode(settings_buffer + 1, settings_buffer + sizeof(settings_buffer), settings)) == NULL) {
 		ret = H3ZERO_INTERNAL_ERROR;
 	}
 	else {
@@ -320,25 +350,54 @@ int h3zero_protocol_init(picoquic_cnx_t* cnx)
 	}
 
 	if (ret == 0) {
-		uint64_t encoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
-		/* set the encoder stream, although we do not actually create dynamic codes. */
-		ret = picoquic_add_to_stream(cnx, encoder_stream_id, &encoder_stream_head, 1, 0);
+		*encoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
+		/* set the encoder stream, which carries the dynamic table instructions if enabled. */
+		ret = picoquic_add_to_stream(cnx, *encoder_stream_id, &encoder_stream_head, 1, 0);
 		if (ret == 0) {
-			ret = picoquic_set_stream_priority(cnx, encoder_stream_id, 1);
+			ret = picoquic_set_stream_priority(cnx, *encoder_stream_id, 1);
 		}
 	}
 
 	if (ret == 0) {
-		uint64_t decoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
-		/* set the the decoder stream, although we do not actually create dynamic codes. */
-		ret = picoquic_add_to_stream(cnx, decoder_stream_id, &decoder_stream_head, 1, 0);
+		*decoder_stream_id = picoquic_get_next_local_stream_id(cnx, 1);
+		/* set the the decoder stream, which carries the acknowledgements of dynamic entries. */
+		ret = picoquic_add_to_stream(cnx, *decoder_stream_id, &decoder_stream_head, 1, 0);
 		if (ret == 0) {
-			ret = picoquic_set_stream_priority(cnx, decoder_stream_id, 1);
+			ret = picoquic_set_stream_priority(cnx, *decoder_stream_id, 1);
 		}
 	}
 	return ret;
 }
 
+int h3zero_protocol_init(picoquic_cnx_t* cnx)
+{
+	h3zero_settings_t settings = { 0 };
+	uint64_t encoder_stream_id;
+	uint64_t decoder_stream_id;
+
+	return h3zero_protocol_init_streams(cnx, &settings, &encoder_stream_id, &decoder_stream_id);
+}
+
+/* Variant of h3zero_protocol_init used when the context supports the
+ * QPACK dynamic table. The table capacity and the number of blocked
+ * streams configured in the context are announced in the settings.
+ */
+int h3zero_protocol_init_ex(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx)
+{
+	h3zero_settings_t settings = { 0 };
+	int ret = h3zero_qpack_init(&ctx->qpack, ctx->qpack_table_capacity, ctx->qpack_blocked_streams);
+
+	if (ret != 0) {
+		ret = H3ZERO_INTERNAL_ERROR;
+	}
+	else {
+		settings.table_size = ctx->qpack_table_capacity;
+		settings.blocked_streams = ctx->qpack_blocked_streams;
+		ret = h3zero_protocol_init_streams(cnx, &settings, &ctx->qpack.encoder_stream_id, &ctx->qpack.decoder_stream_id);
+	}
+	return ret;
+}
+
 uint8_t* h3zero_load_frame_content(uint8_t* bytes, uint8_t* bytes_max,
 	h3zero_data_stream_state_t* stream_state, uint64_t* error_found)
 {
@@ -477,6 +536,11 @@ static uint8_t* h3zero_parse_control_stream(uint8_t* bytes, uint8_t* bytes_max,
 					}
 					else {
 						ctx->settings.settings_received = 1;
+						if (ctx->qpack.is_initialized &&
+							h3zero_qpack_set_peer_settings(&ctx->qpack, ctx->settings.table_size, ctx->settings.blocked_streams) != 0) {
+							*error_found = H3ZERO_INTERNAL_ERROR;
+							bytes = NULL;
+						}
 					}
 				}
 				h3zero_reset_control_stream_state(stream_state);
@@ -571,11 +635,23 @@ uint8_t* h3zero_parse_remote_unidir_stream(
 	case h3zero_stream_type_push: /* Push type not supported in current implementation */
 		bytes = bytes_max;
 		break;
-	case h3zero_stream_type_qpack_encoder: /* not required since not using dynamic table */
-		bytes = bytes_max;
+	case h3zero_stream_type_qpack_encoder: /* updates of the dynamic table used by the peer's encoder */
+		if (ctx->qpack.is_initialized && bytes < bytes_max &&
+			h3zero_qpack_encoder_stream_input(&ctx->qpack, bytes, bytes_max - bytes, error_found) != 0) {
+			bytes = NULL;
+		}
+		else {
+			bytes = bytes_max;
+		}
 		break;
-	case h3zero_stream_type_qpack_decoder: /* not required since not using dynamic table */
-		bytes = bytes_max;
+	case h3zero_stream_type_qpack_decoder: /* acknowledgements of the entries sent by the local encoder */
+		if (ctx->qpack.is_initialized && bytes < bytes_max &&
+			h3zero_qpack_decoder_stream_input(&ctx->qpack, bytes, bytes_max - bytes, error_found) != 0) {
+			bytes = NULL;
+		}
+		else {
+			bytes = bytes_max;
+		}
 		break;
 	case h3zero_stream_type_webtransport: /* unidir stream is used as specified in web transport */
 		bytes = h3zero_wt_parse_control_stream_id(bytes, bytes_max, stream_state, stream_ctx, ctx);
@@ -606,6 +682,51 @@ uint8_t* h3zero_parse_incoming_remote_stream(
 	return bytes;
 }
 
+/* Initialization for clients that manage their own request streams, such as
+ * the demo client. The returned context only handles the control and QPACK
+ * streams of the connection. These clients do not resume streams blocked by
+ * QPACK, so the number of blocked streams is set to zero: the peer will only
+ * reference the dynamic entries that the client acknowledged.
+ */
+h3zero_callback_ctx_t* h3zero_client_protocol_init(picoquic_cnx_t* cnx)
+{
+	h3zero_callback_ctx_t* ctx = h3zero_callback_create_context(NULL);
+
+	if (ctx != NULL) {
+		ctx->qpack_blocked_streams = 0;
+		if (h3zero_protocol_init_ex(cnx, ctx) != 0) {
+			h3zero_callback_delete_context(cnx, ctx);
+			ctx = NULL;
+		}
+	}
+	return ctx;
+}
+
+/* Process the data received on a unidirectional stream opened by the server,
+ * for clients initialized with h3zero_client_protocol_init.
+ */
+int h3zero_client_process_remote_unidir(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,
+	uint64_t stream_id, uint8_t* bytes, size_t length)
+{
+	int ret = 0;
+	h3zero_stream_ctx_t* stream_ctx = h3zero_find_or_create_stream(cnx, stream_id, ctx, 1, 1);
+
+	if (stream_ctx == NULL) {
+		ret = -1;
+	}
+	else if (length > 0) {
+		uint64_t error_found = 0;
+
+		if (h3zero_parse_remote_unidir_stream(bytes, bytes + length, stream_ctx, ctx, &error_found) == NULL) {
+			ret = picoquic_close(cnx, (error_found == 0) ? H3ZERO_GENERAL_PROTOCOL_ERROR : error_found);
+		}
+		else {
+			ret = h3zero_qpack_send_instructions(cnx, ctx);
+		}
+	}
+	return ret;
+}
+
 /* Parsing of a data stream. This is implemented as a filter, with a set of states:
 * 
 * - Reading frame length: obtaining the length and type of the next frame.
@@ -619,6 +740,30 @@ uint8_t* h3zero_parse_incoming_remote_stream(
 *   length N. Treat the following N bytes as data.
 */
 
+/* Bytes received on a stream blocked by QPACK are kept until the
+ * header frame can be decoded. */
+static int h3zero_queue_blocked_bytes(h3zero_data_stream_state_t* stream_state, const uint8_t* bytes, size_t length)
+{
+	int ret = 0;
+
+	if (stream_state->blocked_length + length > stream_state->blocked_size) {
+		size_t new_size = stream_state->blocked_length + length + 256;
+		uint8_t* new_bytes = (uint8_t*)realloc(stream_state->blocked_bytes, new_size);
+		if (new_bytes == NULL) {
+			ret = -1;
+		}
+		else {
+			stream_state->blocked_bytes = new_bytes;
+			stream_state->blocked_size = new_size;
+		}
+	}
+	if (ret == 0 && length > 0) {
+		memcpy(stream_state->blocked_bytes + stream_state->blocked_length, bytes, length);
+		stream_state->blocked_length += length;
+	}
+	return ret;
+}
+
 uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
 	h3zero_data_stream_state_t * stream_state, size_t * available_data, uint64_t * error_found)
 {
@@ -748,14 +893,40 @@ uint8_t * h3zero_parse_data_stream(uint8_t * bytes, uint8_t * bytes_max,
 						uint8_t* parsed;
 						h3zero_header_parts_t* parts = (stream_state->header_found) ?
 							&stream_state->trailer : &stream_state->header;
+						h3zero_callback_ctx_t* h3_ctx = stream_state->h3_ctx;
+						int is_blocked = 0;
 						stream_state->trailer_found = stream_state->header_found;
 						stream_state->header_found = 1;
 						/* parse */
-						parsed = h3zero_parse_qpack_header_frame(stream_state->current_frame,
-							stream_state->current_frame + stream_state->current_frame_length, parts);
-						if (parsed == NULL || (size_t)(parsed - stream_state->current_frame) != stream_state->current_frame_length) {
-							/* protocol error */
-							*error_found = H3ZERO_FRAME_ERROR;
+						if (h3_ctx != NULL && h3_ctx->qpack.is_initialized) {
+							parsed = h3zero_qpack_decode_header_block(&h3_ctx->qpack, stream_state->stream_id, stream_state->current_frame,
+								stream_state->current_frame + stream_state->current_frame_length, parts, &is_blocked, error_found);
+						}
+						else {
+							parsed = h3zero_parse_qpack_header_frame(stream_state->current_frame,
+								stream_state->current_frame + stream_state->current_frame_length, parts);
+						}
+						if (is_blocked) {
+							/* Keep the frame and the following bytes until the
+							 * dynamic table entries are received. */
+							stream_state->header_found = stream_state->trailer_found;
+							stream_state->trailer_found = 0;
+							if (h3zero_queue_blocked_bytes(stream_state, stream_state->frame_header, stream_state->frame_header_read) != 0 ||
+								h3zero_queue_blocked_bytes(stream_state, stream_state->current_frame, (size_t)stream_state->current_frame_length) != 0 ||
+								h3zero_queue_blocked_bytes(stream_state, bytes, bytes_max - bytes) != 0) {
+								*error_found = H3ZERO_INTERNAL_ERROR;
+								bytes = NULL;
+							}
+							else {
+								stream_state->is_qpack_blocked = 1;
+								bytes = bytes_max;
+							}
+						}
+						else if (parsed == NULL || (size_t)(parsed - stream_state->current_frame) != stream_state->current_frame_length) {
+							/* protocol error, unless already qualified by the QPACK decoder */
+							if (*error_found == 0) {
+								*error_found = H3ZERO_FRAME_ERROR;
+							}
 							bytes = NULL;
 						}
 						/* free resource */
@@ -812,6 +983,16 @@ h3zero_callback_ctx_t* h3zero_callback_create_context(picohttp_server_parameters
 			ctx->path_table = param->path_table;
 			ctx->path_table_nb = param->path_table_nb;
 			ctx->web_folder = param->web_folder;
+			ctx->file_reader = param->file_reader;
+			ctx->content_cache = param->content_cache;
+			ctx->qpack_table_capacity = param->qpack_table_capacity;
+			ctx->qpack_blocked_streams = param->qpack_blocked_streams;
+		}
+		if (ctx->qpack_table_capacity == 0) {
+			ctx->qpack_table_capacity = H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT;
+		}
+		if (ctx->qpack_blocked_streams == 0) {
+			ctx->qpack_blocked_streams = H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT;
 		}
 	}
 
@@ -821,7 +1002,8 @@ h3zero_callback_ctx_t* h3zero_callback_create_context(picohttp_server_parameters
 void h3zero_callback_delete_context(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx)
 {
 	h3zero_delete_all_stream_prefixes(cnx, ctx);
-	picosplay_empty_tree(&ctx->h3_stream_tree);
+	h3zero_delete_all_streams(ctx);
+	h3zero_qpack_release(&ctx->qpack);
 	free(ctx);
 }
 
@@ -918,6 +1100,10 @@ Picoquic POST Response\
 
 int h3zero_server_parse_path(const uint8_t* path, size_t path_length, uint64_t* echo_size,
 	char** file_path, char const* web_folder, int* file_error);
+int h3zero_server_parse_path_ex(const uint8_t* path, size_t path_length, uint64_t* echo_size,
+	char** file_path, char const* web_folder, int* file_error, h3zero_content_cache_t* content_cache);
+int h3zero_server_queue_cached_content_ex(picoquic_cnx_t* cnx, h3zero_stream_ctx_t* stream_ctx,
+	h3zero_content_cache_t* content_cache, h3zero_file_reader_t* file_reader);
 
 int h3zero_find_path_item(const uint8_t * path, size_t path_length, const picohttp_server_path_item_t * path_table, size_t path_table_nb)
 {
@@ -1005,8 +1191,8 @@ int h3zero_process_request_frame(
 
 	if (stream_ctx->ps.stream_state.header.method == h3zero_method_get) {
 		/* Manage GET */
-		if (h3zero_server_parse_path(stream_ctx->ps.stream_state.header.path, stream_ctx->ps.stream_state.header.path_length,
-			&stream_ctx->echo_length, &stream_ctx->file_path, app_ctx->web_folder, &file_error) != 0) {
+		if (h3zero_server_parse_path_ex(stream_ctx->ps.stream_state.header.path, stream_ctx->ps.stream_state.header.path_length,
+			&stream_ctx->echo_length, &stream_ctx->file_path, app_ctx->web_folder, &file_error, app_ctx->content_cache) != 0) {
 			char log_text[256];
 			picoquic_log_app_message(cnx, "Cannot find file for path: <%s> in folder <%s>, error: 0x%x",
 				picoquic_uint8_to_str(log_text, 256, stream_ctx->ps.stream_state.header.path, stream_ctx->ps.stream_state.header.path_length),
@@ -1095,6 +1281,12 @@ int h3zero_process_request_frame(
 		o_bytes = h3zero_create_error_frame(o_bytes, o_bytes_max, "501", H3ZERO_USER_AGENT_STRING);
 	}
 
+	if (o_bytes != NULL) {
+		/* Replace the literal values by references to the dynamic table */
+		o_bytes = h3zero_qpack_compress_header_block(&app_ctx->qpack, stream_ctx->stream_id,
+			&buffer[3], o_bytes, o_bytes_max);
+	}
+
 	if (o_bytes == NULL) {
 		picoquic_log_app_message(cnx, "Error, resetting stream: %"PRIu64, stream_ctx->stream_id);
 		ret = picoquic_reset_stream(cnx, stream_ctx->stream_id, H3ZERO_INTERNAL_ERROR);
@@ -1151,6 +1343,15 @@ int h3zero_process_request_frame(
 		if (o_bytes == NULL) {
 			ret = picoquic_reset_stream(cnx, stream_ctx->stream_id, H3ZERO_INTERNAL_ERROR);
 		}
+		else if (stream_ctx->echo_length != 0 && stream_ctx->file_path != NULL && app_ctx->content_cache != NULL &&
+			h3zero_server_queue_cached_content_ex(cnx, stream_ctx, app_ctx->content_cache, app_ctx->file_reader) == 0) {
+			/* The whole content is queued from the cache, no need to mark the stream active */
+		}
+		else if (stream_ctx->echo_length != 0 && stream_ctx->file_path != NULL && app_ctx->file_reader != NULL &&
+			(stream_ctx->file_read = h3zero_file_reader_open(app_ctx->file_reader, stream_ctx->file_path,
+				stream_ctx->echo_length, cnx, stream_ctx->stream_id, stream_ctx)) != NULL) {
+			/* The stream will be marked active when the first chunk of the file is ready */
+		}
 		else if (stream_ctx->echo_length != 0 || response_length > sizeof(post_response)) {
 			ret = picoquic_mark_active_stream(cnx, stream_ctx->stream_id, 1, stream_ctx);
 		}
@@ -1277,7 +1478,13 @@ int h3zero_process_h3_server_data(picoquic_cnx_t* cnx,
 		}
 	}
 	/* Process the header if necessary */
-	if (ret == 0 && !process_complete) {
+	if (ret == 0 && stream_ctx->ps.stream_state.is_qpack_blocked) {
+		/* Wait until the header can be decoded */
+		if (fin_or_event == picoquic_callback_stream_fin) {
+			stream_ctx->ps.stream_state.is_fin_blocked = 1;
+		}
+	}
+	else if (ret == 0 && !process_complete) {
 		if (stream_ctx->ps.stream_state.is_web_transport) {
 			if (fin_or_event == picoquic_callback_stream_fin && available_data == 0 && stream_ctx->path_callback != NULL) {
 				ret = stream_ctx->path_callback(cnx, NULL, 0, picohttp_callback_post_fin, stream_ctx, stream_ctx->path_callback_ctx);
@@ -1360,7 +1567,13 @@ int h3zero_process_h3_client_data(picoquic_cnx_t* cnx,
 		}
 	}
 
-	if (fin_or_event == picoquic_callback_stream_fin) {
+	if (ret == 0 && stream_ctx->ps.stream_state.is_qpack_blocked) {
+		/* Wait until the header can be decoded */
+		if (fin_or_event == picoquic_callback_stream_fin) {
+			stream_ctx->ps.stream_state.is_fin_blocked = 1;
+		}
+	}
+	else if (fin_or_event == picoquic_callback_stream_fin) {
 		if (stream_ctx->path_callback != NULL) {
 			stream_ctx->path_callback(cnx, NULL, 0, picohttp_callback_post_fin, stream_ctx, stream_ctx->path_callback_ctx);
 		}
@@ -1387,6 +1600,67 @@ int h3zero_process_h3_client_data(picoquic_cnx_t* cnx,
 	return ret;
 }
 
+/* Send the instructions queued for the encoder and decoder streams.
+ */
+int h3zero_qpack_send_instructions(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx)
+{
+	int ret = 0;
+
+	if (ctx->qpack.encoder_instructions.length > 0 && ctx->qpack.encoder_stream_id != UINT64_MAX) {
+		ret = picoquic_add_to_stream(cnx, ctx->qpack.encoder_stream_id,
+			ctx->qpack.encoder_instructions.bytes, ctx->qpack.encoder_instructions.length, 0);
+		ctx->qpack.encoder_instructions.length = 0;
+	}
+	if (ret == 0 && ctx->qpack.decoder_instructions.length > 0 && ctx->qpack.decoder_stream_id != UINT64_MAX) {
+		ret = picoquic_add_to_stream(cnx, ctx->qpack.decoder_stream_id,
+			ctx->qpack.decoder_instructions.bytes, ctx->qpack.decoder_instructions.length, 0);
+		ctx->qpack.decoder_instructions.length = 0;
+	}
+	return ret;
+}
+
+/* After receiving data, resume the streams that were blocked waiting for
+ * QPACK dynamic table entries, then send the instructions queued for the
+ * encoder and decoder streams.
+ */
+int h3zero_callback_data(picoquic_cnx_t* cnx,
+	uint64_t stream_id, uint8_t* bytes, size_t length,
+	picoquic_call_back_event_t fin_or_event, h3zero_callback_ctx_t* ctx,
+	h3zero_stream_ctx_t* stream_ctx, uint64_t* fin_stream_id);
+
+static int h3zero_process_qpack_updates(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx, uint64_t* fin_stream_id)
+{
+	int ret = 0;
+	uint64_t unblocked_id;
+
+	while (ret == 0 && (unblocked_id = h3zero_qpack_get_unblocked_stream(&ctx->qpack)) != UINT64_MAX) {
+		h3zero_stream_ctx_t* stream_ctx = h3zero_find_stream(ctx, unblocked_id);
+
+		if (stream_ctx != NULL && stream_ctx->ps.stream_state.is_qpack_blocked) {
+			h3zero_data_stream_state_t* stream_state = &stream_ctx->ps.stream_state;
+			uint8_t* blocked_bytes = stream_state->blocked_bytes;
+			size_t blocked_length = stream_state->blocked_length;
+			picoquic_call_back_event_t fin_or_event = (stream_state->is_fin_blocked) ?
+				picoquic_callback_stream_fin : picoquic_callback_stream_data;
+
+			stream_state->blocked_bytes = NULL;
+			stream_state->blocked_length = 0;
+			stream_state->blocked_size = 0;
+			stream_state->is_qpack_blocked = 0;
+			stream_state->is_fin_blocked = 0;
+			ret = h3zero_callback_data(cnx, unblocked_id, blocked_bytes, blocked_length, fin_or_event,
+				ctx, stream_ctx, fin_stream_id);
+			if (blocked_bytes != NULL) {
+				free(blocked_bytes);
+			}
+		}
+	}
+	if (ret == 0) {
+		ret = h3zero_qpack_send_instructions(cnx, ctx);
+	}
+	return ret;
+}
+
 int h3zero_callback_data(picoquic_cnx_t* cnx,
 	uint64_t stream_id, uint8_t* bytes, size_t length,
 	picoquic_call_back_event_t fin_or_event, h3zero_callback_ctx_t* ctx,
@@ -1431,6 +1705,15 @@ int h3zero_callback_data(picoquic_cnx_t* cnx,
 		if (stream_ctx->is_upgraded) {
 			ret = h3zero_post_data_or_fin(cnx, bytes, length, fin_or_event, stream_ctx);
 		}
+		else if (stream_ctx->is_h3 && stream_ctx->ps.stream_state.is_qpack_blocked) {
+			/* Keep the data until the header frame can be decoded */
+			if (h3zero_queue_blocked_bytes(&stream_ctx->ps.stream_state, bytes, length) != 0) {
+				ret = picoquic_close(cnx, H3ZERO_INTERNAL_ERROR);
+			}
+			else if (fin_or_event == picoquic_callback_stream_fin) {
+				stream_ctx->ps.stream_state.is_fin_blocked = 1;
+			}
+		}
 		else if (IS_BIDIR_STREAM_ID(stream_id)) {
 			if (IS_CLIENT_STREAM_ID(stream_id)) {
 				/* If nothing is known about the stream, it is treated by default as an H3 stream
@@ -1468,6 +1751,9 @@ int h3zero_callback_data(picoquic_cnx_t* cnx,
 				fin_or_event, stream_ctx, ctx);
 		}
 	}
+	if (ret == 0 && ctx->qpack.is_initialized) {
+		ret = h3zero_process_qpack_updates(cnx, ctx, fin_stream_id);
+	}
 	return ret;
 }
 
@@ -1522,7 +1808,7 @@ int h3zero_prepare_to_send(int client_mode, void* context, size_t space,
 {
 	int ret = 0;
 
-	if (!client_mode && stream_ctx->F == NULL && stream_ctx->file_path != NULL) {
+	if (!client_mode && stream_ctx->file_read == NULL && stream_ctx->F == NULL && stream_ctx->file_path != NULL) {
 		stream_ctx->F = picoquic_file_open(stream_ctx->file_path, "rb");
 		if (stream_ctx->F == NULL) {
 			ret = -1;
@@ -1530,7 +1816,11 @@ int h3zero_prepare_to_send(int client_mode, void* context, size_t space,
 	}
 
 	if (ret == 0) {
-		if (client_mode) {
+		if (!client_mode && stream_ctx->file_read != NULL) {
+			/* Only send the data already prefetched by the file reader */
+			ret = h3zero_file_reader_provide_data(stream_ctx->file_read, context, space, &stream_ctx->echo_sent);
+		}
+		else if (client_mode) {
 			ret = h3zero_prepare_to_send_buffer(context, space, stream_ctx->post_size, &stream_ctx->post_sent, NULL);
 		}
 		else {
@@ -1788,7 +2078,7 @@ int h3zero_callback(picoquic_cnx_t* cnx,
 		}
 		else {
 			picoquic_set_callback(cnx, h3zero_callback, ctx);
-			ret = h3zero_protocol_init(cnx);
+			ret = h3zero_protocol_init_ex(cnx, ctx);
 		}
 	} else{
 		ctx = (h3zero_callback_ctx_t*)callback_ctx;
@@ -24,8 +24,12 @@
 #include <stdint.h>
 #include <stdio.h>
 #include "picosplay.h"
+#include "picoindex.h"
 #include "picoquic.h"
 #include "h3zero.h"
+#include "h3zero_file_reader.h"
+#include "h3zero_content_cache.h"
+#include "h3zero_qpack.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -88,6 +92,7 @@ extern "C" {
         picoquic_cnx_t* cnx;
         unsigned int is_h3:1;
         unsigned int is_upgraded:1;
+        unsigned int is_not_indexed:1; /* Stream could not be added to h3_stream_index */
         union {
             h3zero_data_stream_state_t stream_state; /* h3 only */
             struct {
@@ -119,6 +124,7 @@ extern "C" {
         /* File state variables, used by both cclient and server */
         char* file_path;
         FILE* F;
+        h3zero_file_read_t* file_read; /* Used instead of F if the server has a file reader */
     } h3zero_stream_ctx_t;
 
     /* Parsing of a data stream. This is implemented as a filter, with a set of states:
@@ -185,11 +191,15 @@ extern "C" {
     } h3zero_stream_prefixes_t;
 
     int h3zero_protocol_init(picoquic_cnx_t* cnx);
+    struct st_h3zero_callback_ctx_t;
+    int h3zero_protocol_init_ex(picoquic_cnx_t* cnx, struct st_h3zero_callback_ctx_t* ctx);
 
     /* CLIENT DEFINITIONS 
      */
     int h3zero_client_create_stream_request_ex(
         uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, const char* range, size_t range_len, uint64_t post_size, const char* host, size_t* consumed);
+    int h3zero_client_create_stream_request_qpack(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+        uint8_t* buffer, size_t max_bytes, uint8_t const* path, size_t path_len, const char* range, size_t range_len, uint64_t post_size, const char* host, size_t* consumed);
     int h3zero_client_create_stream_request(
         uint8_t * buffer, size_t max_bytes, uint8_t const * path, size_t path_len, uint64_t post_size, const char * host, size_t * consumed);
 
@@ -198,15 +208,32 @@ extern "C" {
         char const* web_folder;
         picohttp_server_path_item_t* path_table;
         size_t path_table_nb;
+        h3zero_file_reader_t* file_reader; /* Optional, read files asynchronously */
+        /* Optional, serve files from a shared memory mapped cache. Files missing from
+         * the cache are served by the file reader if set, whose workers then map
+         * them in the cache. Otherwise, they are mapped on the network thread. */
+        h3zero_content_cache_t* content_cache;
+        uint64_t qpack_table_capacity; /* Capacity of the QPACK dynamic table, 0 for the default */
+        uint64_t qpack_blocked_streams; /* Streams that may be blocked by QPACK, 0 for the default */
     } picohttp_server_parameters_t;
 
     typedef struct st_h3zero_callback_ctx_t {
         picosplay_tree_t h3_stream_tree;
+        /* Direct index of the stream contexts by stream type and rank. Streams
+         * that could not be indexed are only found in the tree. */
+        picoindex_t h3_stream_index[4];
+        uint64_t nb_streams_not_indexed;
         picohttp_server_path_item_t * path_table;
         size_t path_table_nb;
         char const* web_folder;
+        h3zero_file_reader_t* file_reader;
+        h3zero_content_cache_t* content_cache;
         /* Settings */
         h3zero_settings_t settings;
+        /* QPACK dynamic tables */
+        uint64_t qpack_table_capacity;
+        uint64_t qpack_blocked_streams;
+        h3zero_qpack_ctx_t qpack;
         /* connection wide tracking of stream prefixes */
         h3zero_stream_prefixes_t stream_prefixes;
         uint64_t last_datagram_prefix;
@@ -222,9 +249,17 @@ extern "C" {
     h3zero_callback_ctx_t* h3zero_callback_create_context(picohttp_server_parameters_t* param);
     void h3zero_callback_delete_context(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx);
 
+    /* Clients that manage their own request streams keep an H3 context for
+     * the control and QPACK streams, and compress their request headers with it. */
+    h3zero_callback_ctx_t* h3zero_client_protocol_init(picoquic_cnx_t* cnx);
+    int h3zero_client_process_remote_unidir(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,
+        uint64_t stream_id, uint8_t* bytes, size_t length);
+    int h3zero_qpack_send_instructions(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx);
+
     int h3zero_post_data_or_fin(picoquic_cnx_t* cnx, uint8_t* bytes, size_t length, picoquic_call_back_event_t fin_or_event, h3zero_stream_ctx_t* stream_ctx);
 
     void h3zero_delete_stream(picoquic_cnx_t * cnx, h3zero_callback_ctx_t* ctx, h3zero_stream_ctx_t* stream_ctx);
+    void h3zero_delete_all_streams(h3zero_callback_ctx_t* ctx);
     
     h3zero_stream_ctx_t* h3zero_find_stream(h3zero_callback_ctx_t* ctx, 
         uint64_t stream_id);
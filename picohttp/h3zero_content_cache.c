@@ -0,0 +1,409 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Static content cache, see h3zero_content_cache.h.
+ *
+ * Entries are found by file path in a hash table, and kept in a doubly
+ * linked LRU list, most recently used first. An entry that is evicted
+ * while still referenced cannot happen: eviction only considers entries
+ * without references. An entry is only detached from the cache while
+ * referenced if the cache itself is deleted, in which case the last
+ * release frees it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef _WINDOWS
+#include "wincompat.h"
+#pragma warning(disable:4100)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "picohash.h"
+#include "picoquic_utils.h"
+#include "h3zero_content_cache.h"
+
+#define H3ZERO_CONTENT_CACHE_NB_BIN 1024
+
+struct st_h3zero_content_t {
+    h3zero_content_cache_t* cache;
+    struct st_h3zero_content_t* lru_previous;
+    struct st_h3zero_content_t* lru_next;
+    char* file_path;
+    uint8_t* bytes;
+    uint64_t length;
+    int nb_references;
+    unsigned int is_mapped : 1;
+};
+
+struct st_h3zero_content_cache_t {
+    picohash_table* table;
+    h3zero_content_t* lru_first;
+    h3zero_content_t* lru_last;
+    uint64_t max_bytes;
+    uint64_t total_bytes;
+    uint64_t nb_entries;
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    uint64_t nb_evicted;
+};
+
+static uint64_t h3zero_content_hash(const void* key, const uint8_t* hash_seed)
+{
+    const h3zero_content_t* content = (const h3zero_content_t*)key;
+    return picohash_bytes((const uint8_t*)content->file_path, strlen(content->file_path), hash_seed);
+}
+
+static int h3zero_content_compare(const void* key1, const void* key2)
+{
+    const h3zero_content_t* content1 = (const h3zero_content_t*)key1;
+    const h3zero_content_t* content2 = (const h3zero_content_t*)key2;
+
+    return strcmp(content1->file_path, content2->file_path);
+}
+
+/* Map the file in memory. If mapping is not possible, read the file
+ * in an allocated buffer instead. */
+static int h3zero_content_load(h3zero_content_t* content)
+{
+    int ret = -1;
+#ifdef _WINDOWS
+    HANDLE file_handle = CreateFileA(content->file_path, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+
+        if (GetFileSizeEx(file_handle, &file_size) && file_size.QuadPart > 0) {
+            HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+            if (mapping_handle != NULL) {
+                /* The view keeps a reference to the mapping, the handles can be closed */
+                content->bytes = (uint8_t*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+                if (content->bytes != NULL) {
+                    content->length = (uint64_t)file_size.QuadPart;
+                    content->is_mapped = 1;
+                    ret = 0;
+                }
+                CloseHandle(mapping_handle);
+            }
+        }
+        CloseHandle(file_handle);
+    }
+#else
+    int fd = open(content->file_path, O_RDONLY);
+
+    if (fd >= 0) {
+        struct stat file_stat;
+
+        if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0) {
+            void* mapped = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (mapped != MAP_FAILED) {
+                content->bytes = (uint8_t*)mapped;
+                content->length = (uint64_t)file_stat.st_size;
+                content->is_mapped = 1;
+                ret = 0;
+            }
+        }
+        (void)close(fd);
+    }
+#endif
+
+    if (ret != 0) {
+        FILE* F = picoquic_file_open(content->file_path, "rb");
+
+        if (F != NULL) {
+            long sz;
+
+            fseek(F, 0, SEEK_END);
+            sz = ftell(F);
+            if (sz > 0 && (content->bytes = (uint8_t*)malloc((size_t)sz)) != NULL) {
+                fseek(F, 0, SEEK_SET);
+                if (fread(content->bytes, 1, (size_t)sz, F) == (size_t)sz) {
+                    content->length = (uint64_t)sz;
+                    ret = 0;
+                }
+                else {
+                    free(content->bytes);
+                    content->bytes = NULL;
+                }
+            }
+            (void)picoquic_file_close(F);
+        }
+    }
+
+    return ret;
+}
+
+static void h3zero_content_free(h3zero_content_t* content)
+{
+    if (content->bytes != NULL) {
+        if (content->is_mapped) {
+#ifdef _WINDOWS
+            (void)UnmapViewOfFile(content->bytes);
+#else
+            (void)munmap(content->bytes, (size_t)content->length);
+#endif
+        }
+        else {
+            free(content->bytes);
+        }
+    }
+    if (content->file_path != NULL) {
+        free(content->file_path);
+    }
+    free(content);
+}
+
+static void h3zero_content_lru_remove(h3zero_content_cache_t* cache, h3zero_content_t* content)
+{
+    if (content->lru_previous == NULL) {
+        cache->lru_first = content->lru_next;
+    }
+    else {
+        content->lru_previous->lru_next = content->lru_next;
+    }
+    if (content->lru_next == NULL) {
+        cache->lru_last = content->lru_previous;
+    }
+    else {
+        content->lru_next->lru_previous = content->lru_previous;
+    }
+    content->lru_previous = NULL;
+    content->lru_next = NULL;
+}
+
+static void h3zero_content_lru_push(h3zero_content_cache_t* cache, h3zero_content_t* content)
+{
+    content->lru_previous = NULL;
+    content->lru_next = cache->lru_first;
+    if (cache->lru_first == NULL) {
+        cache->lru_last = content;
+    }
+    else {
+        cache->lru_first->lru_previous = content;
+    }
+    cache->lru_first = content;
+}
+
+static void h3zero_content_cache_remove(h3zero_content_cache_t* cache, h3zero_content_t* content)
+{
+    h3zero_content_lru_remove(cache, content);
+    picohash_delete_key(cache->table, content, 0);
+    cache->total_bytes -= content->length;
+    cache->nb_entries--;
+    content->cache = NULL;
+}
+
+/* Unmap the least recently used entries that are not in use until the
+ * total size is within the bound. */
+static void h3zero_content_cache_evict(h3zero_content_cache_t* cache)
+{
+    h3zero_content_t* content = cache->lru_last;
+
+    while (cache->total_bytes > cache->max_bytes && content != NULL) {
+        h3zero_content_t* previous = content->lru_previous;
+
+        if (content->nb_references == 0) {
+            h3zero_content_cache_remove(cache, content);
+            h3zero_content_free(content);
+            cache->nb_evicted++;
+        }
+        content = previous;
+    }
+}
+
+h3zero_content_cache_t* h3zero_content_cache_create(uint64_t max_bytes)
+{
+    h3zero_content_cache_t* cache = (h3zero_content_cache_t*)malloc(sizeof(h3zero_content_cache_t));
+
+    if (cache != NULL) {
+        memset(cache, 0, sizeof(h3zero_content_cache_t));
+        cache->max_bytes = (max_bytes == 0) ? H3ZERO_CONTENT_CACHE_MAX_BYTES_DEFAULT : max_bytes;
+        cache->table = picohash_create(H3ZERO_CONTENT_CACHE_NB_BIN, h3zero_content_hash, h3zero_content_compare);
+        if (cache->table == NULL) {
+            free(cache);
+            cache = NULL;
+        }
+    }
+
+    return cache;
+}
+
+void h3zero_content_cache_delete(h3zero_content_cache_t* cache)
+{
+    while (cache->lru_first != NULL) {
+        h3zero_content_t* content = cache->lru_first;
+
+        h3zero_content_cache_remove(cache, content);
+        if (content->nb_references == 0) {
+            h3zero_content_free(content);
+        }
+        /* else: the content is freed when the last reference is released. */
+    }
+    picohash_delete(cache->table, 0);
+    free(cache);
+}
+
+h3zero_content_t* h3zero_content_cache_peek(h3zero_content_cache_t* cache, char const* file_path)
+{
+    h3zero_content_t key;
+    picohash_item* item;
+
+    memset(&key, 0, sizeof(h3zero_content_t));
+    key.file_path = (char*)file_path;
+    item = picohash_retrieve(cache->table, &key);
+
+    return (item == NULL) ? NULL : (h3zero_content_t*)item->key;
+}
+
+h3zero_content_t* h3zero_content_cache_find(h3zero_content_cache_t* cache, char const* file_path)
+{
+    h3zero_content_t* content = h3zero_content_cache_peek(cache, file_path);
+
+    if (content != NULL) {
+        cache->nb_hits++;
+        h3zero_content_lru_remove(cache, content);
+        h3zero_content_lru_push(cache, content);
+        content->nb_references++;
+    }
+    else {
+        cache->nb_misses++;
+    }
+
+    return content;
+}
+
+h3zero_content_t* h3zero_content_load_file(char const* file_path)
+{
+    size_t path_length = strlen(file_path);
+    h3zero_content_t* content = (h3zero_content_t*)malloc(sizeof(h3zero_content_t));
+
+    if (content != NULL) {
+        memset(content, 0, sizeof(h3zero_content_t));
+        content->file_path = (char*)malloc(path_length + 1);
+        if (content->file_path == NULL) {
+            free(content);
+            content = NULL;
+        }
+        else {
+            memcpy(content->file_path, file_path, path_length + 1);
+            if (h3zero_content_load(content) != 0) {
+                h3zero_content_free(content);
+                content = NULL;
+            }
+            else {
+                content->nb_references = 1;
+            }
+        }
+    }
+
+    return content;
+}
+
+/* Add a loaded content to the cache. The content holds a reference, so
+ * it is not evicted when making room for it. */
+static int h3zero_content_cache_add(h3zero_content_cache_t* cache, h3zero_content_t* content)
+{
+    int ret = picohash_insert(cache->table, content);
+
+    if (ret == 0) {
+        content->cache = cache;
+        h3zero_content_lru_push(cache, content);
+        cache->total_bytes += content->length;
+        cache->nb_entries++;
+        h3zero_content_cache_evict(cache);
+    }
+
+    return ret;
+}
+
+void h3zero_content_cache_insert(h3zero_content_cache_t* cache, h3zero_content_t* content)
+{
+    if (h3zero_content_cache_peek(cache, content->file_path) != NULL ||
+        h3zero_content_cache_add(cache, content) != 0) {
+        /* Already cached, or cannot be cached. The release frees the content. */
+        content->cache = NULL;
+    }
+    h3zero_content_release(content);
+}
+
+h3zero_content_t* h3zero_content_cache_get(h3zero_content_cache_t* cache, char const* file_path)
+{
+    h3zero_content_t* content = h3zero_content_cache_find(cache, file_path);
+
+    if (content == NULL && (content = h3zero_content_load_file(file_path)) != NULL &&
+        h3zero_content_cache_add(cache, content) != 0) {
+        h3zero_content_release(content);
+        content = NULL;
+    }
+
+    return content;
+}
+
+void h3zero_content_release(h3zero_content_t* content)
+{
+    h3zero_content_cache_t* cache = content->cache;
+
+    content->nb_references--;
+    if (content->nb_references <= 0) {
+        if (cache == NULL) {
+            h3zero_content_free(content);
+        }
+        else {
+            h3zero_content_cache_evict(cache);
+        }
+    }
+}
+
+void h3zero_content_buffer_release(void* release_ctx, const uint8_t* bytes, size_t length, int is_acknowledged)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(bytes);
+    UNREFERENCED_PARAMETER(length);
+    UNREFERENCED_PARAMETER(is_acknowledged);
+#endif
+    h3zero_content_release((h3zero_content_t*)release_ctx);
+}
+
+const uint8_t* h3zero_content_bytes(const h3zero_content_t* content)
+{
+    return content->bytes;
+}
+
+uint64_t h3zero_content_length(const h3zero_content_t* content)
+{
+    return content->length;
+}
+
+void h3zero_content_cache_get_stats(h3zero_content_cache_t* cache, h3zero_content_cache_stats_t* stats)
+{
+    stats->nb_hits = cache->nb_hits;
+    stats->nb_misses = cache->nb_misses;
+    stats->nb_evicted = cache->nb_evicted;
+    stats->nb_entries = cache->nb_entries;
+    stats->total_bytes = cache->total_bytes;
+}
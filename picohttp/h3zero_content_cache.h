@@ -0,0 +1,108 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef H3ZERO_CONTENT_CACHE_H
+#define H3ZERO_CONTENT_CACHE_H
+
+/* Static content cache for the h3zero and h09 servers.
+ *
+ * Servers that deliver the same objects to many clients would otherwise
+ * open and read the same files for every request. The content cache maps
+ * each file in memory once, using mmap on Unix and a file mapping on
+ * Windows, or reads it in a memory buffer if mapping is not available.
+ * The mapped bytes are queued directly on the response streams with
+ * picoquic_add_buffers_to_stream, so stream frames are copied from the
+ * mapping into the packets.
+ *
+ * Each content entry is reference counted. A reference is held by every
+ * stream that queued the content, until picoquic releases the buffer.
+ * The total size of the cached files is bounded: when the bound is
+ * exceeded, the least recently used entries that are not referenced are
+ * unmapped. Referenced entries are never unmapped, so the bound can be
+ * exceeded temporarily if all entries are in use.
+ *
+ * The cache assumes that the served files do not change. It is not
+ * thread safe, and should be shared only by the connections of a single
+ * network thread. It shall be deleted after these connections. Files can
+ * be mapped by other threads with h3zero_content_load_file, for example
+ * by the workers of the file reader, and then added to the cache by the
+ * network thread with h3zero_content_cache_insert.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H3ZERO_CONTENT_CACHE_MAX_BYTES_DEFAULT 0x10000000ull
+
+typedef struct st_h3zero_content_cache_t h3zero_content_cache_t;
+typedef struct st_h3zero_content_t h3zero_content_t;
+
+h3zero_content_cache_t* h3zero_content_cache_create(uint64_t max_bytes);
+void h3zero_content_cache_delete(h3zero_content_cache_t* cache);
+
+/* Find the content of the file, or map it if not yet present. The
+ * returned content holds a reference, which must be released with
+ * h3zero_content_release. Returns NULL if the file cannot be read
+ * or is empty. */
+h3zero_content_t* h3zero_content_cache_get(h3zero_content_cache_t* cache, char const* file_path);
+/* Find the content if it is already in the cache, without opening the
+ * file. No reference is added. */
+h3zero_content_t* h3zero_content_cache_peek(h3zero_content_cache_t* cache, char const* file_path);
+/* Find the content if it is already in the cache, without opening the
+ * file. If found, the content is counted as a hit and holds a reference,
+ * otherwise the miss is counted. */
+h3zero_content_t* h3zero_content_cache_find(h3zero_content_cache_t* cache, char const* file_path);
+/* Map the file outside of any cache. May be called from any thread. The
+ * returned content holds a reference. Returns NULL if the file cannot be
+ * read or is empty. */
+h3zero_content_t* h3zero_content_load_file(char const* file_path);
+/* Add a content returned by h3zero_content_load_file to the cache, and
+ * release its reference. If the file is already cached, the content is
+ * freed. */
+void h3zero_content_cache_insert(h3zero_content_cache_t* cache, h3zero_content_t* content);
+void h3zero_content_release(h3zero_content_t* content);
+
+const uint8_t* h3zero_content_bytes(const h3zero_content_t* content);
+uint64_t h3zero_content_length(const h3zero_content_t* content);
+
+/* Release function matching picoquic_stream_buffer_release_fn, with the
+ * content as release context */
+void h3zero_content_buffer_release(void* release_ctx, const uint8_t* bytes, size_t length, int is_acknowledged);
+
+/* Statistics, for tests and monitoring */
+typedef struct st_h3zero_content_cache_stats_t {
+    uint64_t nb_hits;
+    uint64_t nb_misses;
+    uint64_t nb_evicted;
+    uint64_t nb_entries;
+    uint64_t total_bytes;
+} h3zero_content_cache_stats_t;
+
+void h3zero_content_cache_get_stats(h3zero_content_cache_t* cache, h3zero_content_cache_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* H3ZERO_CONTENT_CACHE_H */
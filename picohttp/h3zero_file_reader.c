@@ -0,0 +1,683 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Asynchronous file reader, see h3zero_file_reader.h.
+ *
+ * Each read is in at most one of two queues, both protected by the
+ * reader mutex:
+ * - the work queue, if the worker should read the next chunk,
+ * - the ready queue, if the stream is waiting and data (or an error)
+ *   is now available.
+ * A worker removes a read from the work queue before reading a chunk,
+ * and sets `is_in_worker` while doing the file I/O without holding the
+ * mutex. If the stream closes the read during that time, the read is
+ * only marked closed, and the worker frees it when done.
+ *
+ * Cache fills are kept in a separate list, also protected by the mutex.
+ * Workers serve the reads first. A fill is taken by one worker, which
+ * maps the file without holding the mutex, and is then left in the list
+ * until the network thread polls and adds the content to the cache.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef _WINDOWS
+#include "wincompat.h"
+#endif
+#include "picoquic.h"
+#include "picoquic_utils.h"
+#include "h3zero_file_reader.h"
+
+#define H3ZERO_FILE_READER_WORKER_WAIT 10000
+
+typedef struct st_h3zero_file_chunk_t {
+    struct st_h3zero_file_chunk_t* next_chunk;
+    size_t length;
+    size_t consumed;
+    uint8_t* bytes;
+} h3zero_file_chunk_t;
+
+struct st_h3zero_file_read_t {
+    h3zero_file_reader_t* reader;
+    struct st_h3zero_file_read_t* next_work;
+    struct st_h3zero_file_read_t* next_ready;
+    char* file_path;
+    picoquic_cnx_t* cnx;
+    uint64_t stream_id;
+    void* stream_ctx;
+    uint64_t file_length;
+    /* Managed by the worker, only one worker at a time */
+    FILE* F;
+    uint64_t read_offset;
+    /* Protected by the reader mutex */
+    h3zero_file_chunk_t* first_chunk;
+    h3zero_file_chunk_t* last_chunk;
+    int nb_chunks;
+    size_t bytes_ready;
+    unsigned int is_queued : 1;
+    unsigned int is_ready : 1;
+    unsigned int is_in_worker : 1;
+    unsigned int is_waiting : 1;
+    unsigned int is_closed : 1;
+    unsigned int is_error : 1;
+    unsigned int is_read_complete : 1;
+};
+
+typedef struct st_h3zero_file_fill_t {
+    struct st_h3zero_file_fill_t* next_fill;
+    h3zero_content_cache_t* cache;
+    char* file_path;
+    h3zero_content_t* content;
+    unsigned int is_in_worker : 1;
+    unsigned int is_done : 1;
+} h3zero_file_fill_t;
+
+struct st_h3zero_file_reader_t {
+    picoquic_mutex_t mutex;
+    picoquic_event_t work_event;
+    picoquic_event_t ready_event;
+    picoquic_thread_t* threads;
+    int nb_threads;
+    int should_stop;
+    size_t chunk_size;
+    int nb_chunks_max;
+    int nb_waiting;
+    h3zero_file_read_t* first_work;
+    h3zero_file_read_t* last_work;
+    h3zero_file_read_t* first_ready;
+    h3zero_file_fill_t* first_fill;
+    int nb_fills;
+    h3zero_file_reader_wake_up_fn wake_up_fn;
+    void* wake_up_ctx;
+    unsigned int is_mutex_created : 1;
+    unsigned int is_work_event_created : 1;
+    unsigned int is_ready_event_created : 1;
+};
+
+static void h3zero_file_read_free(h3zero_file_read_t* read)
+{
+    while (read->first_chunk != NULL) {
+        h3zero_file_chunk_t* chunk = read->first_chunk;
+        read->first_chunk = chunk->next_chunk;
+        free(chunk);
+    }
+    if (read->F != NULL) {
+        read->F = picoquic_file_close(read->F);
+    }
+    if (read->file_path != NULL) {
+        free(read->file_path);
+    }
+    free(read);
+}
+
+static void h3zero_file_fill_free(h3zero_file_fill_t* fill)
+{
+    if (fill->content != NULL) {
+        h3zero_content_release(fill->content);
+    }
+    if (fill->file_path != NULL) {
+        free(fill->file_path);
+    }
+    free(fill);
+}
+
+/* Queue management. All these functions are called with the mutex held. */
+static void h3zero_file_reader_queue_work(h3zero_file_reader_t* reader, h3zero_file_read_t* read)
+{
+    if (!read->is_queued && !read->is_in_worker && !read->is_read_complete && !read->is_error &&
+        read->nb_chunks < reader->nb_chunks_max) {
+        read->next_work = NULL;
+        if (reader->last_work == NULL) {
+            reader->first_work = read;
+        }
+        else {
+            reader->last_work->next_work = read;
+        }
+        reader->last_work = read;
+        read->is_queued = 1;
+        (void)picoquic_signal_event(&reader->work_event);
+    }
+}
+
+static void h3zero_file_reader_dequeue_work(h3zero_file_reader_t* reader, h3zero_file_read_t* read)
+{
+    h3zero_file_read_t* previous = NULL;
+    h3zero_file_read_t* next = reader->first_work;
+
+    while (next != NULL && next != read) {
+        previous = next;
+        next = next->next_work;
+    }
+    if (next != NULL) {
+        if (previous == NULL) {
+            reader->first_work = read->next_work;
+        }
+        else {
+            previous->next_work = read->next_work;
+        }
+        if (reader->last_work == read) {
+            reader->last_work = previous;
+        }
+        read->next_work = NULL;
+        read->is_queued = 0;
+    }
+}
+
+/* Returns 1 if the read was added to the ready queue, in which case
+ * the network thread should be woken up */
+static int h3zero_file_reader_queue_ready(h3zero_file_reader_t* reader, h3zero_file_read_t* read)
+{
+    int is_new_ready = 0;
+
+    if (read->is_waiting && !read->is_ready && (read->bytes_ready > 0 || read->is_error)) {
+        read->next_ready = reader->first_ready;
+        reader->first_ready = read;
+        read->is_ready = 1;
+        is_new_ready = 1;
+    }
+
+    return is_new_ready;
+}
+
+static h3zero_file_fill_t* h3zero_file_reader_next_fill(h3zero_file_reader_t* reader)
+{
+    h3zero_file_fill_t* fill = reader->first_fill;
+
+    while (fill != NULL && (fill->is_in_worker || fill->is_done)) {
+        fill = fill->next_fill;
+    }
+
+    return fill;
+}
+
+static void h3zero_file_reader_dequeue_ready(h3zero_file_reader_t* reader, h3zero_file_read_t* read)
+{
+    h3zero_file_read_t** pprevious = &reader->first_ready;
+
+    while (*pprevious != NULL) {
+        if (*pprevious == read) {
+            *pprevious = read->next_ready;
+            read->next_ready = NULL;
+            read->is_ready = 0;
+            break;
+        }
+        pprevious = &(*pprevious)->next_ready;
+    }
+}
+
+/* Read one chunk from the file. This is called by the worker without
+ * holding the mutex. */
+static h3zero_file_chunk_t* h3zero_file_reader_read_chunk(h3zero_file_reader_t* reader, h3zero_file_read_t* read)
+{
+    h3zero_file_chunk_t* chunk = NULL;
+    size_t length = reader->chunk_size;
+
+    if (read->F == NULL) {
+        read->F = picoquic_file_open(read->file_path, "rb");
+    }
+    if (read->F != NULL) {
+        if (read->file_length - read->read_offset < (uint64_t)length) {
+            length = (size_t)(read->file_length - read->read_offset);
+        }
+        chunk = (h3zero_file_chunk_t*)malloc(sizeof(h3zero_file_chunk_t) + length);
+        if (chunk != NULL) {
+            memset(chunk, 0, sizeof(h3zero_file_chunk_t));
+            chunk->bytes = ((uint8_t*)chunk) + sizeof(h3zero_file_chunk_t);
+            chunk->length = fread(chunk->bytes, 1, length, read->F);
+            if (chunk->length != length) {
+                free(chunk);
+                chunk = NULL;
+            }
+            else {
+                read->read_offset += length;
+                if (read->read_offset >= read->file_length) {
+                    read->F = picoquic_file_close(read->F);
+                }
+            }
+        }
+    }
+    return chunk;
+}
+
+static picoquic_thread_return_t h3zero_file_reader_worker(void* arg)
+{
+    h3zero_file_reader_t* reader = (h3zero_file_reader_t*)arg;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    while (!reader->should_stop) {
+        h3zero_file_read_t* read = reader->first_work;
+        h3zero_file_fill_t* fill = (read == NULL) ? h3zero_file_reader_next_fill(reader) : NULL;
+
+        if (fill != NULL) {
+            h3zero_content_t* content;
+
+            fill->is_in_worker = 1;
+            (void)picoquic_unlock_mutex(&reader->mutex);
+
+            content = h3zero_content_load_file(fill->file_path);
+
+            (void)picoquic_lock_mutex(&reader->mutex);
+            fill->content = content;
+            fill->is_in_worker = 0;
+            fill->is_done = 1;
+            /* The content is added to the cache by the next poll */
+            (void)picoquic_signal_event(&reader->ready_event);
+            if (reader->wake_up_fn != NULL) {
+                reader->wake_up_fn(reader->wake_up_ctx);
+            }
+        }
+        else if (read == NULL) {
+            (void)picoquic_unlock_mutex(&reader->mutex);
+            /* The wait is bounded, so a signal sent before the wait starts
+             * only delays the work. */
+            (void)picoquic_wait_for_event(&reader->work_event, H3ZERO_FILE_READER_WORKER_WAIT);
+            (void)picoquic_lock_mutex(&reader->mutex);
+        }
+        else {
+            h3zero_file_chunk_t* chunk;
+            int should_wake_up = 0;
+
+            h3zero_file_reader_dequeue_work(reader, read);
+            read->is_in_worker = 1;
+            (void)picoquic_unlock_mutex(&reader->mutex);
+
+            chunk = h3zero_file_reader_read_chunk(reader, read);
+
+            (void)picoquic_lock_mutex(&reader->mutex);
+            read->is_in_worker = 0;
+            if (read->is_closed) {
+                if (chunk != NULL) {
+                    free(chunk);
+                }
+                h3zero_file_read_free(read);
+            }
+            else {
+                if (chunk == NULL) {
+                    read->is_error = 1;
+                }
+                else {
+                    if (read->last_chunk == NULL) {
+                        read->first_chunk = chunk;
+                    }
+                    else {
+                        read->last_chunk->next_chunk = chunk;
+                    }
+                    read->last_chunk = chunk;
+                    read->nb_chunks++;
+                    read->bytes_ready += chunk->length;
+                    read->is_read_complete = (read->read_offset >= read->file_length);
+                }
+                should_wake_up = h3zero_file_reader_queue_ready(reader, read);
+                h3zero_file_reader_queue_work(reader, read);
+            }
+            if (should_wake_up) {
+                (void)picoquic_signal_event(&reader->ready_event);
+                if (reader->wake_up_fn != NULL) {
+                    reader->wake_up_fn(reader->wake_up_ctx);
+                }
+            }
+        }
+    }
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    picoquic_thread_do_return;
+}
+
+h3zero_file_reader_t* h3zero_file_reader_create(int nb_threads, size_t chunk_size, int nb_chunks_max)
+{
+    int ret = 0;
+    h3zero_file_reader_t* reader = (h3zero_file_reader_t*)malloc(sizeof(h3zero_file_reader_t));
+
+    if (reader != NULL) {
+        memset(reader, 0, sizeof(h3zero_file_reader_t));
+        reader->chunk_size = (chunk_size == 0) ? H3ZERO_FILE_READER_CHUNK_SIZE_DEFAULT : chunk_size;
+        reader->nb_chunks_max = (nb_chunks_max <= 0) ? H3ZERO_FILE_READER_NB_CHUNKS_DEFAULT : nb_chunks_max;
+        if (nb_threads <= 0) {
+            nb_threads = 1;
+        }
+
+        if ((ret = picoquic_create_mutex(&reader->mutex)) == 0) {
+            reader->is_mutex_created = 1;
+            if ((ret = picoquic_create_event(&reader->work_event)) == 0) {
+                reader->is_work_event_created = 1;
+                if ((ret = picoquic_create_event(&reader->ready_event)) == 0) {
+                    reader->is_ready_event_created = 1;
+                }
+            }
+        }
+
+        if (ret == 0) {
+            reader->threads = (picoquic_thread_t*)malloc(sizeof(picoquic_thread_t) * nb_threads);
+            if (reader->threads == NULL) {
+                ret = -1;
+            }
+            else {
+                for (int i = 0; ret == 0 && i < nb_threads; i++) {
+                    if ((ret = picoquic_create_thread(&reader->threads[i], h3zero_file_reader_worker, reader)) == 0) {
+                        reader->nb_threads++;
+                    }
+                }
+            }
+        }
+
+        if (ret != 0) {
+            h3zero_file_reader_delete(reader);
+            reader = NULL;
+        }
+    }
+
+    return reader;
+}
+
+void h3zero_file_reader_delete(h3zero_file_reader_t* reader)
+{
+    if (reader->nb_threads > 0) {
+        (void)picoquic_lock_mutex(&reader->mutex);
+        reader->should_stop = 1;
+        (void)picoquic_unlock_mutex(&reader->mutex);
+        (void)picoquic_signal_event(&reader->work_event);
+        for (int i = 0; i < reader->nb_threads; i++) {
+            (void)picoquic_wait_thread(reader->threads[i]);
+            picoquic_delete_thread(&reader->threads[i]);
+        }
+    }
+    if (reader->threads != NULL) {
+        free(reader->threads);
+    }
+    /* Reads still queued at this point were not closed by their streams. */
+    while (reader->first_work != NULL) {
+        h3zero_file_read_t* read = reader->first_work;
+        reader->first_work = read->next_work;
+        h3zero_file_reader_dequeue_ready(reader, read);
+        h3zero_file_read_free(read);
+    }
+    while (reader->first_ready != NULL) {
+        h3zero_file_read_t* read = reader->first_ready;
+        reader->first_ready = read->next_ready;
+        h3zero_file_read_free(read);
+    }
+    while (reader->first_fill != NULL) {
+        h3zero_file_fill_t* fill = reader->first_fill;
+        reader->first_fill = fill->next_fill;
+        h3zero_file_fill_free(fill);
+    }
+    if (reader->is_ready_event_created) {
+        picoquic_delete_event(&reader->ready_event);
+    }
+    if (reader->is_work_event_created) {
+        picoquic_delete_event(&reader->work_event);
+    }
+    if (reader->is_mutex_created) {
+        (void)picoquic_delete_mutex(&reader->mutex);
+    }
+    free(reader);
+}
+
+void h3zero_file_reader_set_wake_up(h3zero_file_reader_t* reader, h3zero_file_reader_wake_up_fn wake_up_fn, void* wake_up_ctx)
+{
+    (void)picoquic_lock_mutex(&reader->mutex);
+    reader->wake_up_fn = wake_up_fn;
+    reader->wake_up_ctx = wake_up_ctx;
+    (void)picoquic_unlock_mutex(&reader->mutex);
+}
+
+h3zero_file_read_t* h3zero_file_reader_open(h3zero_file_reader_t* reader, char const* file_path,
+    uint64_t file_length, picoquic_cnx_t* cnx, uint64_t stream_id, void* stream_ctx)
+{
+    h3zero_file_read_t* read = (h3zero_file_read_t*)malloc(sizeof(h3zero_file_read_t));
+
+    if (read != NULL) {
+        size_t path_length = strlen(file_path);
+
+        memset(read, 0, sizeof(h3zero_file_read_t));
+        read->reader = reader;
+        read->cnx = cnx;
+        read->stream_id = stream_id;
+        read->stream_ctx = stream_ctx;
+        read->file_length = file_length;
+        read->file_path = (char*)malloc(path_length + 1);
+        if (read->file_path == NULL) {
+            free(read);
+            read = NULL;
+        }
+        else {
+            memcpy(read->file_path, file_path, path_length + 1);
+            /* The stream is not active until the first chunk is ready */
+            (void)picoquic_lock_mutex(&reader->mutex);
+            read->is_waiting = 1;
+            reader->nb_waiting++;
+            read->is_read_complete = (file_length == 0);
+            h3zero_file_reader_queue_work(reader, read);
+            (void)picoquic_unlock_mutex(&reader->mutex);
+        }
+    }
+
+    return read;
+}
+
+void h3zero_file_reader_close(h3zero_file_read_t* read)
+{
+    h3zero_file_reader_t* reader = read->reader;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    if (read->is_waiting) {
+        read->is_waiting = 0;
+        reader->nb_waiting--;
+    }
+    if (read->is_queued) {
+        h3zero_file_reader_dequeue_work(reader, read);
+    }
+    if (read->is_ready) {
+        h3zero_file_reader_dequeue_ready(reader, read);
+    }
+    if (read->is_in_worker) {
+        read->is_closed = 1;
+        read = NULL;
+    }
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    if (read != NULL) {
+        h3zero_file_read_free(read);
+    }
+}
+
+int h3zero_file_reader_provide_data(h3zero_file_read_t* read, void* context, size_t space, uint64_t* sent_length)
+{
+    int ret = 0;
+    h3zero_file_reader_t* reader = read->reader;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    if (*sent_length >= read->file_length) {
+        /* Nothing left to send */
+    }
+    else if (read->bytes_ready == 0) {
+        if (read->is_error) {
+            ret = -1;
+        }
+        else {
+            /* Wait until the workers provide more data */
+            (void)picoquic_provide_stream_data_buffer(context, 0, 0, 0);
+            if (!read->is_waiting) {
+                read->is_waiting = 1;
+                reader->nb_waiting++;
+            }
+        }
+    }
+    else {
+        size_t length = (read->bytes_ready < space) ? read->bytes_ready : space;
+        int is_fin = (*sent_length + length >= read->file_length);
+        int is_still_active = !is_fin && length < read->bytes_ready;
+        uint8_t* buffer = picoquic_provide_stream_data_buffer(context, length, is_fin, is_still_active);
+
+        if (buffer == NULL) {
+            ret = -1;
+        }
+        else {
+            size_t copied = 0;
+
+            while (copied < length) {
+                h3zero_file_chunk_t* chunk = read->first_chunk;
+                size_t chunk_available = chunk->length - chunk->consumed;
+                size_t copy_length = length - copied;
+
+                if (copy_length > chunk_available) {
+                    copy_length = chunk_available;
+                }
+                memcpy(buffer + copied, chunk->bytes + chunk->consumed, copy_length);
+                copied += copy_length;
+                chunk->consumed += copy_length;
+                if (chunk->consumed >= chunk->length) {
+                    read->first_chunk = chunk->next_chunk;
+                    if (read->first_chunk == NULL) {
+                        read->last_chunk = NULL;
+                    }
+                    read->nb_chunks--;
+                    free(chunk);
+                }
+            }
+            read->bytes_ready -= length;
+            *sent_length += length;
+            if (!is_fin && !is_still_active && !read->is_waiting) {
+                /* All available data was sent, wait for the next chunk */
+                read->is_waiting = 1;
+                reader->nb_waiting++;
+            }
+            /* Keep the prefetch window full */
+            h3zero_file_reader_queue_work(reader, read);
+        }
+    }
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    return ret;
+}
+
+int h3zero_file_reader_fill_cache(h3zero_file_reader_t* reader, h3zero_content_cache_t* cache, char const* file_path)
+{
+    int ret = 0;
+    h3zero_file_fill_t* fill;
+    size_t path_length = strlen(file_path);
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    fill = reader->first_fill;
+    while (fill != NULL && (fill->cache != cache || strcmp(fill->file_path, file_path) != 0)) {
+        fill = fill->next_fill;
+    }
+    if (fill != NULL || reader->nb_fills >= H3ZERO_FILE_READER_NB_FILLS_MAX) {
+        ret = -1;
+    }
+    else if ((fill = (h3zero_file_fill_t*)malloc(sizeof(h3zero_file_fill_t))) == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(fill, 0, sizeof(h3zero_file_fill_t));
+        fill->cache = cache;
+        if ((fill->file_path = (char*)malloc(path_length + 1)) == NULL) {
+            free(fill);
+            ret = -1;
+        }
+        else {
+            memcpy(fill->file_path, file_path, path_length + 1);
+            fill->next_fill = reader->first_fill;
+            reader->first_fill = fill;
+            reader->nb_fills++;
+            (void)picoquic_signal_event(&reader->work_event);
+        }
+    }
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    return ret;
+}
+
+int h3zero_file_reader_poll(h3zero_file_reader_t* reader)
+{
+    int nb_marked = 0;
+    h3zero_file_fill_t* first_done = NULL;
+    h3zero_file_fill_t** p_next;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    p_next = &reader->first_fill;
+    while (*p_next != NULL) {
+        h3zero_file_fill_t* fill = *p_next;
+        if (fill->is_done) {
+            *p_next = fill->next_fill;
+            fill->next_fill = first_done;
+            first_done = fill;
+            reader->nb_fills--;
+        }
+        else {
+            p_next = &fill->next_fill;
+        }
+    }
+    while (reader->first_ready != NULL) {
+        h3zero_file_read_t* read = reader->first_ready;
+        reader->first_ready = read->next_ready;
+        read->next_ready = NULL;
+        read->is_ready = 0;
+        read->is_waiting = 0;
+        reader->nb_waiting--;
+        /* Marking the stream active does not call back the application,
+         * so this is safe while holding the mutex. */
+        (void)picoquic_mark_active_stream(read->cnx, read->stream_id, 1, read->stream_ctx);
+        nb_marked++;
+    }
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    /* The caches are only used by the network thread */
+    while (first_done != NULL) {
+        h3zero_file_fill_t* fill = first_done;
+        first_done = fill->next_fill;
+        if (fill->content != NULL) {
+            h3zero_content_cache_insert(fill->cache, fill->content);
+            fill->content = NULL;
+        }
+        h3zero_file_fill_free(fill);
+    }
+
+    return nb_marked;
+}
+
+int h3zero_file_reader_nb_waiting(h3zero_file_reader_t* reader)
+{
+    int nb_waiting;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    nb_waiting = reader->nb_waiting;
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    return nb_waiting;
+}
+
+int h3zero_file_reader_wait(h3zero_file_reader_t* reader, uint64_t microsec_wait)
+{
+    int ret = 0;
+    int is_ready;
+
+    (void)picoquic_lock_mutex(&reader->mutex);
+    is_ready = (reader->first_ready != NULL);
+    (void)picoquic_unlock_mutex(&reader->mutex);
+
+    if (!is_ready) {
+        ret = picoquic_wait_for_event(&reader->ready_event, microsec_wait);
+    }
+
+    return ret;
+}
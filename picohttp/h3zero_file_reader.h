@@ -0,0 +1,115 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef H3ZERO_FILE_READER_H
+#define H3ZERO_FILE_READER_H
+
+/* Asynchronous file reader for the h3zero server.
+ *
+ * The default h3zero server reads the content of static files with
+ * blocking calls to fread, inside the "prepare to send" callback of the
+ * network thread. A slow disk then stalls all connections served by
+ * the same QUIC context.
+ *
+ * The file reader moves these reads to a pool of worker threads. When
+ * a response is prepared, the server opens a "file read" for the stream.
+ * The workers open the file and prefetch up to `nb_chunks_max` chunks
+ * of `chunk_size` bytes. The prepare to send callback only copies data
+ * that is already available. If nothing is available, the stream is
+ * marked inactive, and it will be marked active again once a chunk
+ * is ready.
+ *
+ * Calls to picoquic are not thread safe, so the workers never touch the
+ * connections. Instead, the network thread shall call
+ * `h3zero_file_reader_poll` regularly, for example from the packet loop
+ * callback. Poll marks as active the streams for which data became
+ * available. The application may set a wake up function, which will be
+ * called by the workers when a stream is ready -- typically a call to
+ * `picoquic_wake_up_network_thread`, after which the network thread
+ * calls poll in the `picoquic_packet_loop_wake_up` callback. Applications
+ * that do not use wake up can use `h3zero_file_reader_nb_waiting` to
+ * shorten the packet loop timer while streams are waiting for data.
+ *
+ * The workers can also fill a content cache (see h3zero_content_cache.h):
+ * when a file is missing from the cache, the server serves it through the
+ * reader, and asks the workers to map it. The mapped file is added to the
+ * cache by `h3zero_file_reader_poll`, so that the cache is only used by
+ * the network thread, and the next requests are served from the cache.
+ *
+ * The reader is shared by all the connections of a server. It shall only
+ * be deleted after these connections are deleted.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "picoquic.h"
+#include "h3zero_content_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H3ZERO_FILE_READER_CHUNK_SIZE_DEFAULT 0x10000
+#define H3ZERO_FILE_READER_NB_CHUNKS_DEFAULT 4
+#define H3ZERO_FILE_READER_NB_FILLS_MAX 16
+
+typedef struct st_h3zero_file_reader_t h3zero_file_reader_t;
+typedef struct st_h3zero_file_read_t h3zero_file_read_t;
+
+typedef void (*h3zero_file_reader_wake_up_fn)(void* wake_up_ctx);
+
+/* Create a reader with `nb_threads` workers. Chunk size and number of
+ * chunks per stream are set to default values if zero. */
+h3zero_file_reader_t* h3zero_file_reader_create(int nb_threads, size_t chunk_size, int nb_chunks_max);
+void h3zero_file_reader_delete(h3zero_file_reader_t* reader);
+void h3zero_file_reader_set_wake_up(h3zero_file_reader_t* reader, h3zero_file_reader_wake_up_fn wake_up_fn, void* wake_up_ctx);
+
+/* Start reading a file on behalf of a stream. The stream context is
+ * passed to picoquic_mark_active_stream when data becomes available. */
+h3zero_file_read_t* h3zero_file_reader_open(h3zero_file_reader_t* reader, char const* file_path,
+    uint64_t file_length, picoquic_cnx_t* cnx, uint64_t stream_id, void* stream_ctx);
+/* Abandon the read. The read context is freed, possibly after the worker
+ * currently using it is done. */
+void h3zero_file_reader_close(h3zero_file_read_t* read);
+
+/* Called from the prepare to send callback. Provides at most `space`
+ * bytes of available data, or marks the stream inactive if no data
+ * is available yet. Returns -1 if the file could not be read. */
+int h3zero_file_reader_provide_data(h3zero_file_read_t* read, void* context, size_t space, uint64_t* sent_length);
+
+/* Ask the workers to map the file, and add it to the cache at the next
+ * poll. Returns -1 if the file is already being mapped, or if too many
+ * files are pending. */
+int h3zero_file_reader_fill_cache(h3zero_file_reader_t* reader, h3zero_content_cache_t* cache, char const* file_path);
+
+/* Called from the network thread. Marks as active the streams that were
+ * waiting for data and can now make progress, and adds the mapped files
+ * to their cache. Returns the number of streams that were marked active. */
+int h3zero_file_reader_poll(h3zero_file_reader_t* reader);
+/* Number of streams currently waiting for data */
+int h3zero_file_reader_nb_waiting(h3zero_file_reader_t* reader);
+/* Wait until at least one stream is ready, or until the delay expires. */
+int h3zero_file_reader_wait(h3zero_file_reader_t* reader, uint64_t microsec_wait);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* H3ZERO_FILE_READER_H */
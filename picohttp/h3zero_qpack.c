@@ -0,0 +1,1095 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "h3zero.h"
+#include "h3zero_qpack.h"
+
+/*
+ * Instruction buffers.
+ */
+
+static int h3zero_qpack_buffer_reserve(h3zero_qpack_buffer_t* buffer, size_t needed)
+{
+    int ret = 0;
+
+    if (buffer->length + needed > buffer->size) {
+        size_t new_size = (buffer->size == 0) ? 256 : 2 * buffer->size;
+        uint8_t* new_bytes;
+
+        while (new_size < buffer->length + needed) {
+            new_size *= 2;
+        }
+        new_bytes = (uint8_t*)realloc(buffer->bytes, new_size);
+        if (new_bytes == NULL) {
+            ret = -1;
+        }
+        else {
+            buffer->bytes = new_bytes;
+            buffer->size = new_size;
+        }
+    }
+
+    return ret;
+}
+
+static void h3zero_qpack_buffer_consume(h3zero_qpack_buffer_t* buffer, size_t consumed)
+{
+    if (consumed >= buffer->length) {
+        buffer->length = 0;
+    }
+    else if (consumed > 0) {
+        memmove(buffer->bytes, buffer->bytes + consumed, buffer->length - consumed);
+        buffer->length -= consumed;
+    }
+}
+
+static void h3zero_qpack_buffer_release(h3zero_qpack_buffer_t* buffer)
+{
+    if (buffer->bytes != NULL) {
+        free(buffer->bytes);
+    }
+    memset(buffer, 0, sizeof(h3zero_qpack_buffer_t));
+}
+
+static int h3zero_qpack_queue_instruction(h3zero_qpack_buffer_t* buffer, uint8_t prefix, uint8_t mask, uint64_t val)
+{
+    int ret = h3zero_qpack_buffer_reserve(buffer, 16);
+
+    if (ret == 0) {
+        uint8_t* bytes = h3zero_qpack_code_encode(buffer->bytes + buffer->length,
+            buffer->bytes + buffer->size, prefix, mask, val);
+        if (bytes == NULL) {
+            ret = -1;
+        }
+        else {
+            buffer->length = bytes - buffer->bytes;
+        }
+    }
+    return ret;
+}
+
+/* Read an integer or a string from an instruction stream. Return 0 if the
+ * value is available, 1 if more bytes are needed, -1 if the encoding is
+ * not valid.
+ */
+static int h3zero_qpack_read_int(const uint8_t** p, const uint8_t* p_max, uint8_t mask, uint64_t* val)
+{
+    int ret = 0;
+    uint8_t* next = h3zero_qpack_int_decode((uint8_t*)*p, (uint8_t*)p_max, mask, val);
+
+    if (next == NULL) {
+        /* Integers are at most 62 bits long, encoded in at most 10 bytes */
+        ret = (p_max - *p > 10) ? -1 : 1;
+    }
+    else {
+        *p = next;
+    }
+    return ret;
+}
+
+static int h3zero_qpack_read_string(const uint8_t** p, const uint8_t* p_max, uint8_t mask,
+    uint64_t length_max, uint8_t** str, size_t* str_length)
+{
+    int ret = 0;
+    const uint8_t* q = *p;
+    int is_huffman = (q < p_max) ? ((q[0] & (mask + 1)) != 0) : 0;
+    uint64_t length = 0;
+
+    if ((ret = h3zero_qpack_read_int(&q, p_max, mask, &length)) == 0) {
+        if (length > length_max) {
+            ret = -1;
+        }
+        else if (q + length > p_max) {
+            ret = 1;
+        }
+        else if (is_huffman) {
+            /* The shortest Huffman code is 5 bits long */
+            size_t decoded_max = (size_t)((length * 8) / 5) + 1;
+
+            if ((*str = (uint8_t*)malloc(decoded_max)) == NULL ||
+                hzero_qpack_huffman_decode((uint8_t*)q, (uint8_t*)q + length, *str, decoded_max, str_length) != 0) {
+                ret = -1;
+            }
+        }
+        else if ((*str = (uint8_t*)malloc((size_t)length + 1)) == NULL) {
+            ret = -1;
+        }
+        else {
+            memcpy(*str, q, (size_t)length);
+            *str_length = (size_t)length;
+        }
+        if (ret == 0) {
+            *p = q + length;
+        }
+        else if (*str != NULL) {
+            free(*str);
+            *str = NULL;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Dynamic table.
+ * The entries are kept in a circular buffer. The size of each entry is
+ * the length of name and value, plus 32 bytes, so the number of entries
+ * is bounded by the capacity divided by 32.
+ */
+
+static int h3zero_qpack_table_init(h3zero_qpack_table_t* table, uint64_t max_capacity)
+{
+    int ret = 0;
+
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+    table->max_capacity = max_capacity;
+    table->nb_entries_max = (size_t)(max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD);
+    if (table->nb_entries_max > 0) {
+        table->entries = (h3zero_qpack_entry_t*)calloc(table->nb_entries_max, sizeof(h3zero_qpack_entry_t));
+        if (table->entries == NULL) {
+            table->nb_entries_max = 0;
+            table->max_capacity = 0;
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+static uint64_t h3zero_qpack_entry_size(size_t name_length, size_t value_length)
+{
+    return (uint64_t)name_length + (uint64_t)value_length + H3ZERO_QPACK_ENTRY_OVERHEAD;
+}
+
+static void h3zero_qpack_table_evict(h3zero_qpack_table_t* table)
+{
+    h3zero_qpack_entry_t* entry = &table->entries[table->first];
+
+    table->size -= h3zero_qpack_entry_size(entry->name_length, entry->value_length);
+    if (entry->name != NULL) {
+        free(entry->name);
+    }
+    memset(entry, 0, sizeof(h3zero_qpack_entry_t));
+    table->first = (table->first + 1) % table->nb_entries_max;
+    table->nb_entries--;
+}
+
+static void h3zero_qpack_table_release(h3zero_qpack_table_t* table)
+{
+    while (table->nb_entries > 0) {
+        h3zero_qpack_table_evict(table);
+    }
+    if (table->entries != NULL) {
+        free(table->entries);
+    }
+    memset(table, 0, sizeof(h3zero_qpack_table_t));
+}
+
+static int h3zero_qpack_table_set_capacity(h3zero_qpack_table_t* table, uint64_t capacity)
+{
+    int ret = 0;
+
+    if (capacity > table->max_capacity) {
+        ret = -1;
+    }
+    else {
+        while (table->size > capacity) {
+            h3zero_qpack_table_evict(table);
+        }
+        table->capacity = capacity;
+    }
+    return ret;
+}
+
+/* Insert a new entry, evicting the oldest entries if needed. The name and
+ * value are copied before eviction, because they may point to an entry
+ * of the same table, as when duplicating entries.
+ */
+static int h3zero_qpack_table_insert(h3zero_qpack_table_t* table, const uint8_t* name, size_t name_length,
+    const uint8_t* value, size_t value_length, uint64_t static_name_index, http_header_enum_t header)
+{
+    int ret = 0;
+    uint64_t entry_size = h3zero_qpack_entry_size(name_length, value_length);
+    uint8_t* storage = NULL;
+
+    if (entry_size > table->capacity ||
+        (storage = (uint8_t*)malloc(name_length + value_length + 1)) == NULL) {
+        ret = -1;
+    }
+    else {
+        h3zero_qpack_entry_t* entry;
+
+        if (name_length > 0) {
+            memcpy(storage, name, name_length);
+        }
+        if (value_length > 0) {
+            memcpy(storage + name_length, value, value_length);
+        }
+        storage[name_length + value_length] = 0;
+
+        while (table->size + entry_size > table->capacity) {
+            h3zero_qpack_table_evict(table);
+        }
+        entry = &table->entries[(table->first + table->nb_entries) % table->nb_entries_max];
+        entry->name = storage;
+        entry->name_length = name_length;
+        entry->value = storage + name_length;
+        entry->value_length = value_length;
+        entry->static_name_index = static_name_index;
+        entry->header = header;
+        table->nb_entries++;
+        table->size += entry_size;
+        table->insert_count++;
+    }
+    return ret;
+}
+
+const h3zero_qpack_entry_t* h3zero_qpack_table_get(const h3zero_qpack_table_t* table, uint64_t absolute_index)
+{
+    const h3zero_qpack_entry_t* entry = NULL;
+    uint64_t oldest = table->insert_count - table->nb_entries;
+
+    if (absolute_index >= oldest && absolute_index < table->insert_count) {
+        entry = &table->entries[(table->first + (size_t)(absolute_index - oldest)) % table->nb_entries_max];
+    }
+    return entry;
+}
+
+/* The required insert count is encoded modulo twice the maximum number of entries,
+ * see section 4.5.1.1 of RFC 9204.
+ */
+static uint64_t h3zero_qpack_encode_insert_count(uint64_t required_insert_count, uint64_t max_entries)
+{
+    return (required_insert_count == 0) ? 0 : (required_insert_count % (2 * max_entries)) + 1;
+}
+
+static int h3zero_qpack_decode_insert_count(uint64_t encoded_insert_count, uint64_t max_entries,
+    uint64_t total_inserts, uint64_t* required_insert_count)
+{
+    int ret = 0;
+
+    *required_insert_count = 0;
+    if (encoded_insert_count != 0) {
+        uint64_t full_range = 2 * max_entries;
+
+        if (max_entries == 0 || encoded_insert_count > full_range) {
+            ret = -1;
+        }
+        else {
+            uint64_t max_value = total_inserts + max_entries;
+            uint64_t max_wrapped = (max_value / full_range) * full_range;
+
+            *required_insert_count = max_wrapped + encoded_insert_count - 1;
+            if (*required_insert_count > max_value) {
+                if (*required_insert_count <= full_range) {
+                    ret = -1;
+                }
+                else {
+                    *required_insert_count -= full_range;
+                }
+            }
+            if (*required_insert_count == 0) {
+                ret = -1;
+            }
+        }
+    }
+    return ret;
+}
+
+/*
+ * Context management
+ */
+
+int h3zero_qpack_init(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity, uint64_t max_blocked_streams)
+{
+    memset(qpack, 0, sizeof(h3zero_qpack_ctx_t));
+    qpack->local_max_capacity = max_capacity;
+    qpack->local_max_blocked_streams = max_blocked_streams;
+    qpack->encoder_stream_id = UINT64_MAX;
+    qpack->decoder_stream_id = UINT64_MAX;
+    qpack->is_initialized = 1;
+
+    return h3zero_qpack_table_init(&qpack->decoder_table, max_capacity);
+}
+
+void h3zero_qpack_release(h3zero_qpack_ctx_t* qpack)
+{
+    while (qpack->first_section != NULL) {
+        h3zero_qpack_section_t* section = qpack->first_section;
+        qpack->first_section = section->next;
+        free(section);
+    }
+    while (qpack->first_blocked != NULL) {
+        h3zero_qpack_blocked_t* blocked = qpack->first_blocked;
+        qpack->first_blocked = blocked->next;
+        free(blocked);
+    }
+    h3zero_qpack_table_release(&qpack->encoder_table);
+    h3zero_qpack_table_release(&qpack->decoder_table);
+    h3zero_qpack_buffer_release(&qpack->encoder_instructions);
+    h3zero_qpack_buffer_release(&qpack->decoder_stream_input);
+    h3zero_qpack_buffer_release(&qpack->decoder_instructions);
+    h3zero_qpack_buffer_release(&qpack->encoder_stream_input);
+    memset(qpack, 0, sizeof(h3zero_qpack_ctx_t));
+}
+
+int h3zero_qpack_set_peer_settings(h3zero_qpack_ctx_t* qpack, uint64_t peer_max_capacity, uint64_t peer_max_blocked_streams)
+{
+    int ret = 0;
+    uint64_t capacity = (qpack->local_max_capacity < peer_max_capacity) ? qpack->local_max_capacity : peer_max_capacity;
+
+    qpack->peer_max_blocked_streams = peer_max_blocked_streams;
+    if (!qpack->encoder_enabled && capacity >= H3ZERO_QPACK_ENTRY_OVERHEAD) {
+        qpack->peer_max_capacity = peer_max_capacity;
+        if ((ret = h3zero_qpack_table_init(&qpack->encoder_table, capacity)) == 0 &&
+            (ret = h3zero_qpack_table_set_capacity(&qpack->encoder_table, capacity)) == 0 &&
+            (ret = h3zero_qpack_queue_instruction(&qpack->encoder_instructions, 0x20, 0x1F, capacity)) == 0) {
+            qpack->encoder_enabled = 1;
+        }
+    }
+    return ret;
+}
+
+/*
+ * Decoder side: process the peer's encoder stream.
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 0 | 0 | 1 |   Capacity (5+)   |   Set Dynamic Table Capacity
+ * +---+---+---+-------------------+
+ * | 1 | T |    Name Index (6+)    |   Insert with Name Reference
+ * +---+---+-----------------------+
+ * | 0 | 1 | H | Name Length (5+)  |   Insert with Literal Name
+ * +---+---+---+-------------------+
+ * | 0 | 0 | 0 |    Index (5+)     |   Duplicate
+ * +---+---+---+-------------------+
+ *
+ * Values are encoded as an H bit and a 7+ bits length, followed by the string.
+ */
+
+static int h3zero_qpack_parse_encoder_instruction(h3zero_qpack_ctx_t* qpack,
+    const uint8_t* bytes, const uint8_t* bytes_max, size_t* parsed)
+{
+    int ret = 0;
+    const uint8_t* p = bytes;
+    h3zero_qpack_table_t* table = &qpack->decoder_table;
+    const h3zero_qpack_entry_t* entry = NULL;
+    uint64_t index = 0;
+    uint8_t* name = NULL;
+    size_t name_length = 0;
+    uint8_t* value = NULL;
+    size_t value_length = 0;
+
+    *parsed = 0;
+
+    if ((bytes[0] & 0x80) == 0x80) {
+        /* Insert with name reference */
+        int is_static = (bytes[0] & 0x40) != 0;
+        const uint8_t* name_ref = NULL;
+        uint64_t static_name_index = UINT64_MAX;
+        http_header_enum_t header = http_header_unknown;
+
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x3F, &index)) == 0) {
+            if (is_static) {
+                name_ref = (const uint8_t*)h3zero_qpack_static_name(index, &name_length, &header);
+                static_name_index = index;
+            }
+            else if (index < table->insert_count &&
+                (entry = h3zero_qpack_table_get(table, table->insert_count - 1 - index)) != NULL) {
+                name_ref = entry->name;
+                name_length = entry->name_length;
+                static_name_index = entry->static_name_index;
+                header = entry->header;
+            }
+            if (name_ref == NULL) {
+                ret = -1;
+            }
+        }
+        if (ret == 0 &&
+            (ret = h3zero_qpack_read_string(&p, bytes_max, 0x7F, table->capacity, &value, &value_length)) == 0) {
+            ret = h3zero_qpack_table_insert(table, name_ref, name_length, value, value_length, static_name_index, header);
+        }
+    }
+    else if ((bytes[0] & 0xC0) == 0x40) {
+        /* Insert with literal name */
+        if ((ret = h3zero_qpack_read_string(&p, bytes_max, 0x1F, table->capacity, &name, &name_length)) == 0 &&
+            (ret = h3zero_qpack_read_string(&p, bytes_max, 0x7F, table->capacity, &value, &value_length)) == 0) {
+            ret = h3zero_qpack_table_insert(table, name, name_length, value, value_length, UINT64_MAX,
+                h3zero_get_interesting_header_type(name, name_length, 0));
+        }
+    }
+    else if ((bytes[0] & 0xE0) == 0x20) {
+        /* Set dynamic table capacity */
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x1F, &index)) == 0) {
+            ret = h3zero_qpack_table_set_capacity(table, index);
+        }
+    }
+    else {
+        /* Duplicate */
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x1F, &index)) == 0) {
+            if (index >= table->insert_count ||
+                (entry = h3zero_qpack_table_get(table, table->insert_count - 1 - index)) == NULL) {
+                ret = -1;
+            }
+            else {
+                ret = h3zero_qpack_table_insert(table, entry->name, entry->name_length,
+                    entry->value, entry->value_length, entry->static_name_index, entry->header);
+            }
+        }
+    }
+
+    if (name != NULL) {
+        free(name);
+    }
+    if (value != NULL) {
+        free(value);
+    }
+    if (ret == 0) {
+        *parsed = p - bytes;
+    }
+    else if (ret > 0) {
+        /* Incomplete instruction, wait for more bytes */
+        ret = 0;
+    }
+    return ret;
+}
+
+int h3zero_qpack_encoder_stream_input(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length, uint64_t* error_found)
+{
+    int ret = 0;
+    h3zero_qpack_buffer_t* input = &qpack->encoder_stream_input;
+    size_t consumed = 0;
+
+    if (h3zero_qpack_buffer_reserve(input, length) != 0) {
+        *error_found = H3ZERO_INTERNAL_ERROR;
+        return -1;
+    }
+    if (length > 0) {
+        memcpy(input->bytes + input->length, bytes, length);
+        input->length += length;
+    }
+
+    while (ret == 0 && consumed < input->length) {
+        size_t parsed = 0;
+        ret = h3zero_qpack_parse_encoder_instruction(qpack, input->bytes + consumed, input->bytes + input->length, &parsed);
+        if (parsed == 0) {
+            break;
+        }
+        consumed += parsed;
+    }
+    h3zero_qpack_buffer_consume(input, consumed);
+
+    if (ret == 0 && qpack->decoder_table.insert_count > qpack->acknowledged_insert_count) {
+        /* Let the encoder know that the new entries were received */
+        ret = h3zero_qpack_queue_instruction(&qpack->decoder_instructions, 0x00, 0x3F,
+            qpack->decoder_table.insert_count - qpack->acknowledged_insert_count);
+        qpack->acknowledged_insert_count = qpack->decoder_table.insert_count;
+    }
+    if (ret != 0) {
+        *error_found = H3ZERO_QPACK_ENCODER_STREAM_ERROR;
+    }
+    return ret;
+}
+
+/*
+ * Encoder side: process the peer's decoder stream.
+ *
+ *   0   1   2   3   4   5   6   7
+ * +---+---+---+---+---+---+---+---+
+ * | 1 |      Stream ID (7+)       |   Section Acknowledgment
+ * +---+---+-----------------------+
+ * | 0 | 1 |     Stream ID (6+)    |   Stream Cancellation
+ * +---+---+-----------------------+
+ * | 0 | 0 |     Increment (6+)    |   Insert Count Increment
+ * +---+---+-----------------------+
+ */
+
+static int h3zero_qpack_remove_sections(h3zero_qpack_ctx_t* qpack, uint64_t stream_id, int first_only)
+{
+    int nb_removed = 0;
+    h3zero_qpack_section_t** pp = &qpack->first_section;
+    h3zero_qpack_section_t* previous = NULL;
+
+    while (*pp != NULL) {
+        h3zero_qpack_section_t* section = *pp;
+        if (section->stream_id == stream_id) {
+            if (section->required_insert_count > qpack->known_received_count && first_only) {
+                qpack->known_received_count = section->required_insert_count;
+            }
+            *pp = section->next;
+            if (qpack->last_section == section) {
+                qpack->last_section = previous;
+            }
+            free(section);
+            nb_removed++;
+            if (first_only) {
+                break;
+            }
+        }
+        else {
+            previous = section;
+            pp = &section->next;
+        }
+    }
+    return nb_removed;
+}
+
+static int h3zero_qpack_parse_decoder_instruction(h3zero_qpack_ctx_t* qpack,
+    const uint8_t* bytes, const uint8_t* bytes_max, size_t* parsed)
+{
+    int ret = 0;
+    const uint8_t* p = bytes;
+    uint64_t val = 0;
+
+    *parsed = 0;
+    if ((bytes[0] & 0x80) == 0x80) {
+        /* Section acknowledgment */
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x7F, &val)) == 0 &&
+            h3zero_qpack_remove_sections(qpack, val, 1) == 0) {
+            ret = -1;
+        }
+    }
+    else if ((bytes[0] & 0xC0) == 0x40) {
+        /* Stream cancellation */
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x3F, &val)) == 0) {
+            (void)h3zero_qpack_remove_sections(qpack, val, 0);
+        }
+    }
+    else {
+        /* Insert count increment */
+        if ((ret = h3zero_qpack_read_int(&p, bytes_max, 0x3F, &val)) == 0) {
+            if (val == 0 || val > qpack->encoder_table.insert_count - qpack->known_received_count) {
+                ret = -1;
+            }
+            else {
+                qpack->known_received_count += val;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        *parsed = p - bytes;
+    }
+    else if (ret > 0) {
+        ret = 0;
+    }
+    return ret;
+}
+
+int h3zero_qpack_decoder_stream_input(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length, uint64_t* error_found)
+{
+    int ret = 0;
+    h3zero_qpack_buffer_t* input = &qpack->decoder_stream_input;
+    size_t consumed = 0;
+
+    if (h3zero_qpack_buffer_reserve(input, length) != 0) {
+        *error_found = H3ZERO_INTERNAL_ERROR;
+        return -1;
+    }
+    if (length > 0) {
+        memcpy(input->bytes + input->length, bytes, length);
+        input->length += length;
+    }
+
+    while (ret == 0 && consumed < input->length) {
+        size_t parsed = 0;
+        ret = h3zero_qpack_parse_decoder_instruction(qpack, input->bytes + consumed, input->bytes + input->length, &parsed);
+        if (parsed == 0) {
+            break;
+        }
+        consumed += parsed;
+    }
+    h3zero_qpack_buffer_consume(input, consumed);
+
+    if (ret != 0) {
+        *error_found = H3ZERO_QPACK_DECODER_STREAM_ERROR;
+    }
+    return ret;
+}
+
+/*
+ * Encoding of header blocks.
+ */
+
+static uint64_t h3zero_qpack_encoder_find(const h3zero_qpack_table_t* table, const uint8_t* name, size_t name_length,
+    const uint8_t* value, size_t value_length)
+{
+    /* Search from the most recent entry, which is the least likely to be evicted */
+    for (uint64_t i = 0; i < table->nb_entries; i++) {
+        uint64_t absolute_index = table->insert_count - 1 - i;
+        const h3zero_qpack_entry_t* entry = h3zero_qpack_table_get(table, absolute_index);
+
+        if (entry->name_length == name_length && entry->value_length == value_length &&
+            memcmp(entry->name, name, name_length) == 0 &&
+            memcmp(entry->value, value, value_length) == 0) {
+            return absolute_index;
+        }
+    }
+    return UINT64_MAX;
+}
+
+/* Count the streams that may be blocked by sections not yet acknowledged,
+ * not counting the current stream. */
+static uint64_t h3zero_qpack_nb_blocking_streams(h3zero_qpack_ctx_t* qpack, uint64_t stream_id, int* is_stream_blocking)
+{
+    uint64_t nb_blocking = 0;
+
+    for (h3zero_qpack_section_t* section = qpack->first_section; section != NULL; section = section->next) {
+        if (section->required_insert_count > qpack->known_received_count) {
+            if (section->stream_id == stream_id) {
+                *is_stream_blocking = 1;
+            }
+            else {
+                nb_blocking++;
+            }
+        }
+    }
+    return nb_blocking;
+}
+
+/* An entry can only be evicted if the peer received it, and if no
+ * section that the peer has not acknowledged references it. */
+static int h3zero_qpack_encoder_can_insert(h3zero_qpack_ctx_t* qpack, uint64_t entry_size, uint64_t block_min_reference)
+{
+    h3zero_qpack_table_t* table = &qpack->encoder_table;
+    uint64_t size = table->size;
+    uint64_t absolute_index = table->insert_count - table->nb_entries;
+    uint64_t min_reference = block_min_reference;
+
+    for (h3zero_qpack_section_t* section = qpack->first_section; section != NULL; section = section->next) {
+        if (section->min_reference < min_reference) {
+            min_reference = section->min_reference;
+        }
+    }
+
+    if (entry_size > table->capacity) {
+        return 0;
+    }
+    while (size + entry_size > table->capacity) {
+        const h3zero_qpack_entry_t* entry = h3zero_qpack_table_get(table, absolute_index);
+
+        if (absolute_index >= qpack->known_received_count || absolute_index >= min_reference) {
+            return 0;
+        }
+        size -= h3zero_qpack_entry_size(entry->name_length, entry->value_length);
+        absolute_index++;
+    }
+    return 1;
+}
+
+static int h3zero_qpack_encoder_insert(h3zero_qpack_ctx_t* qpack, uint64_t s_index,
+    const uint8_t* name, size_t name_length, const uint8_t* value, size_t value_length)
+{
+    h3zero_qpack_buffer_t* buffer = &qpack->encoder_instructions;
+    int ret = h3zero_qpack_buffer_reserve(buffer, name_length + value_length + 32);
+
+    if (ret == 0) {
+        uint8_t* bytes = buffer->bytes + buffer->length;
+        uint8_t* bytes_max = buffer->bytes + buffer->size;
+
+        if (s_index != UINT64_MAX) {
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0xC0, 0x3F, s_index);
+        }
+        else {
+            bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x40, 0x1F, name, name_length);
+        }
+        bytes = h3zero_qpack_string_encode(bytes, bytes_max, 0x00, 0x7F, value, value_length);
+
+        if (bytes == NULL ||
+            h3zero_qpack_table_insert(&qpack->encoder_table, name, name_length, value, value_length,
+                s_index, http_header_unknown) != 0) {
+            ret = -1;
+        }
+        else {
+            buffer->length = bytes - buffer->bytes;
+        }
+    }
+    return ret;
+}
+
+/* Find or insert the entry for the field, and decide whether to reference it.
+ * Entries that are not acknowledged yet can only be referenced if the stream
+ * is allowed to block. */
+static uint64_t h3zero_qpack_encoder_reference(h3zero_qpack_ctx_t* qpack, uint64_t s_index,
+    const uint8_t* name, size_t name_length, const uint8_t* value, size_t value_length,
+    uint64_t block_min_reference, uint64_t nb_blocking, int* is_stream_blocking)
+{
+    h3zero_qpack_table_t* table = &qpack->encoder_table;
+    uint64_t reference = h3zero_qpack_encoder_find(table, name, name_length, value, value_length);
+
+    if (reference == UINT64_MAX) {
+        uint64_t entry_size = h3zero_qpack_entry_size(name_length, value_length);
+
+        /* Large entries would push all others out of the table */
+        if (entry_size <= table->capacity / 4 &&
+            h3zero_qpack_encoder_can_insert(qpack, entry_size, block_min_reference) &&
+            h3zero_qpack_encoder_insert(qpack, s_index, name, name_length, value, value_length) == 0) {
+            reference = table->insert_count - 1;
+        }
+    }
+    if (reference != UINT64_MAX && reference >= qpack->known_received_count) {
+        if (*is_stream_blocking || nb_blocking < qpack->peer_max_blocked_streams) {
+            *is_stream_blocking = 1;
+        }
+        else {
+            reference = UINT64_MAX;
+        }
+    }
+    return reference;
+}
+
+/* Skip a string in a header block, and get its value. Huffman encoded
+ * strings are decoded in the buffer; the value is set to NULL if they
+ * do not fit. */
+static const uint8_t* h3zero_qpack_skip_string(const uint8_t* p, const uint8_t* p_max, uint8_t mask,
+    uint8_t* buffer, size_t buffer_size, const uint8_t** str, size_t* str_length)
+{
+    uint64_t length = 0;
+    int is_huffman;
+
+    if (p == NULL || p >= p_max) {
+        return NULL;
+    }
+    is_huffman = (p[0] & (mask + 1)) != 0;
+    p = h3zero_qpack_int_decode((uint8_t*)p, (uint8_t*)p_max, mask, &length);
+    if (p != NULL) {
+        if (p + length > p_max) {
+            p = NULL;
+        }
+        else {
+            if (!is_huffman) {
+                *str = p;
+                *str_length = (size_t)length;
+            }
+            else if (hzero_qpack_huffman_decode((uint8_t*)p, (uint8_t*)p + length, buffer, buffer_size, str_length) == 0) {
+                *str = buffer;
+            }
+            else {
+                *str = NULL;
+            }
+            p += length;
+        }
+    }
+    return p;
+}
+
+typedef struct st_h3zero_qpack_field_line_t {
+    const uint8_t* line;
+    size_t line_length;
+    uint64_t reference;
+} h3zero_qpack_field_line_t;
+
+uint8_t* h3zero_qpack_encode_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    const uint8_t* block, const uint8_t* block_max, uint8_t* bytes, uint8_t* bytes_max)
+{
+    h3zero_qpack_field_line_t lines[H3ZERO_QPACK_MAX_FIELDS];
+    size_t nb_lines = 0;
+    const uint8_t* p = block;
+    const uint8_t* tail = NULL;
+    uint64_t required_insert_count = 0;
+    uint64_t min_reference = UINT64_MAX;
+    uint64_t nb_blocking = 0;
+    uint64_t base;
+    uint64_t v = 0;
+    int is_stream_blocking = 0;
+
+    /* The input block only uses the static table: required insert count is 0 */
+    p = h3zero_qpack_int_decode((uint8_t*)p, (uint8_t*)block_max, 0xFF, &v);
+    if (p == NULL || v != 0 ||
+        (p = h3zero_qpack_int_decode((uint8_t*)p, (uint8_t*)block_max, 0x7F, &v)) == NULL) {
+        return NULL;
+    }
+
+    if (qpack->encoder_enabled) {
+        nb_blocking = h3zero_qpack_nb_blocking_streams(qpack, stream_id, &is_stream_blocking);
+    }
+
+    /* First pass: find or insert the dynamic entries */
+    while (p < block_max) {
+        const uint8_t* line = p;
+        const uint8_t* name = NULL;
+        size_t name_length = 0;
+        const uint8_t* value = NULL;
+        size_t value_length = 0;
+        uint64_t s_index = UINT64_MAX;
+        uint8_t name_buffer[128];
+        uint8_t value_buffer[512];
+        int is_candidate = 0;
+
+        if (nb_lines >= H3ZERO_QPACK_MAX_FIELDS) {
+            tail = p;
+            break;
+        }
+        if ((p[0] & 0xC0) == 0xC0) {
+            /* Indexed field line, static table */
+            p = h3zero_qpack_int_decode((uint8_t*)p, (uint8_t*)block_max, 0x3F, &v);
+        }
+        else if ((p[0] & 0xD0) == 0x50) {
+            /* Literal field line with static name reference */
+            int never_indexed = (p[0] & 0x20) != 0;
+            p = h3zero_qpack_int_decode((uint8_t*)p, (uint8_t*)block_max, 0x0F, &s_index);
+            p = h3zero_qpack_skip_string(p, block_max, 0x7F, value_buffer, sizeof(value_buffer), &value, &value_length);
+            if (p != NULL && !never_indexed && value != NULL && s_index != H3ZERO_QPACK_CODE_PATH) {
+                http_header_enum_t header;
+                name = (const uint8_t*)h3zero_qpack_static_name(s_index, &name_length, &header);
+                is_candidate = (name != NULL);
+            }
+        }
+        else if ((p[0] & 0xE0) == 0x20) {
+            /* Literal field line with literal name */
+            int never_indexed = (p[0] & 0x10) != 0;
+            p = h3zero_qpack_skip_string(p, block_max, 0x07, name_buffer, sizeof(name_buffer), &name, &name_length);
+            p = h3zero_qpack_skip_string(p, block_max, 0x7F, value_buffer, sizeof(value_buffer), &value, &value_length);
+            is_candidate = (p != NULL && !never_indexed && name != NULL && value != NULL);
+        }
+        else {
+            p = NULL;
+        }
+
+        if (p == NULL) {
+            return NULL;
+        }
+        lines[nb_lines].line = line;
+        lines[nb_lines].line_length = p - line;
+        lines[nb_lines].reference = UINT64_MAX;
+        if (is_candidate && qpack->encoder_enabled) {
+            uint64_t reference = h3zero_qpack_encoder_reference(qpack, s_index, name, name_length,
+                value, value_length, min_reference, nb_blocking, &is_stream_blocking);
+            if (reference != UINT64_MAX) {
+                lines[nb_lines].reference = reference;
+                if (reference >= required_insert_count) {
+                    required_insert_count = reference + 1;
+                }
+                if (reference < min_reference) {
+                    min_reference = reference;
+                }
+            }
+        }
+        nb_lines++;
+    }
+
+    /* Second pass: encode the prefix and the field lines, with base set
+     * to the current insert count so all references precede the base */
+    base = qpack->encoder_table.insert_count;
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0xFF,
+        h3zero_qpack_encode_insert_count(required_insert_count, qpack->peer_max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD));
+    bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x00, 0x7F,
+        (required_insert_count == 0) ? 0 : base - required_insert_count);
+    for (size_t i = 0; bytes != NULL && i < nb_lines; i++) {
+        if (lines[i].reference != UINT64_MAX) {
+            bytes = h3zero_qpack_code_encode(bytes, bytes_max, 0x80, 0x3F, base - 1 - lines[i].reference);
+        }
+        else if (bytes + lines[i].line_length > bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            memcpy(bytes, lines[i].line, lines[i].line_length);
+            bytes += lines[i].line_length;
+        }
+    }
+    if (bytes != NULL && tail != NULL) {
+        if (bytes + (block_max - tail) > bytes_max) {
+            bytes = NULL;
+        }
+        else {
+            memcpy(bytes, tail, block_max - tail);
+            bytes += block_max - tail;
+        }
+    }
+
+    if (bytes != NULL && required_insert_count > 0) {
+        /* Remember the section until the peer acknowledges it */
+        h3zero_qpack_section_t* section = (h3zero_qpack_section_t*)malloc(sizeof(h3zero_qpack_section_t));
+        if (section == NULL) {
+            bytes = NULL;
+        }
+        else {
+            section->next = NULL;
+            section->stream_id = stream_id;
+            section->required_insert_count = required_insert_count;
+            section->min_reference = min_reference;
+            if (qpack->last_section == NULL) {
+                qpack->first_section = section;
+            }
+            else {
+                qpack->last_section->next = section;
+            }
+            qpack->last_section = section;
+            for (size_t i = 0; i < nb_lines; i++) {
+                if (lines[i].reference != UINT64_MAX) {
+                    qpack->nb_dynamic_references++;
+                }
+            }
+        }
+    }
+
+    return bytes;
+}
+
+/* Compress in place a header block prepared with the static table, if the
+ * encoder is enabled. The block is left unchanged if the dynamic table is
+ * not used or if the compressed block would not fit. */
+uint8_t* h3zero_qpack_compress_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    uint8_t* block, uint8_t* block_last, uint8_t* block_max)
+{
+    if (qpack != NULL && qpack->encoder_enabled) {
+        uint8_t compressed[1024];
+        uint8_t* c_bytes = h3zero_qpack_encode_header_block(qpack, stream_id, block, block_last,
+            compressed, compressed + sizeof(compressed));
+        if (c_bytes != NULL && c_bytes - compressed <= block_max - block) {
+            memcpy(block, compressed, c_bytes - compressed);
+            block_last = block + (c_bytes - compressed);
+        }
+    }
+    return block_last;
+}
+
+/*
+ * Decoding of header blocks.
+ */
+
+static int h3zero_qpack_remove_blocked(h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
+{
+    int is_removed = 0;
+    h3zero_qpack_blocked_t** pp = &qpack->first_blocked;
+
+    while (*pp != NULL) {
+        h3zero_qpack_blocked_t* blocked = *pp;
+        if (blocked->stream_id == stream_id) {
+            *pp = blocked->next;
+            free(blocked);
+            qpack->nb_blocked--;
+            is_removed = 1;
+            break;
+        }
+        pp = &blocked->next;
+    }
+    return is_removed;
+}
+
+uint8_t* h3zero_qpack_decode_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_header_parts_t* parts, int* is_blocked, uint64_t* error_found)
+{
+    h3zero_qpack_table_t* table = &qpack->decoder_table;
+    uint8_t* fields = NULL;
+    uint64_t encoded_insert_count = 0;
+    uint64_t delta_base = 0;
+    uint64_t required_insert_count = 0;
+    int is_negative = 0;
+
+    *is_blocked = 0;
+    memset(parts, 0, sizeof(h3zero_header_parts_t));
+
+    if (bytes != NULL && bytes < bytes_max) {
+        fields = h3zero_qpack_int_decode(bytes, bytes_max, 0xFF, &encoded_insert_count);
+        if (fields != NULL && fields < bytes_max) {
+            is_negative = (fields[0] & 0x80) != 0;
+            fields = h3zero_qpack_int_decode(fields, bytes_max, 0x7F, &delta_base);
+        }
+        else {
+            fields = NULL;
+        }
+    }
+
+    if (fields == NULL || h3zero_qpack_decode_insert_count(encoded_insert_count,
+        table->max_capacity / H3ZERO_QPACK_ENTRY_OVERHEAD, table->insert_count, &required_insert_count) != 0) {
+        fields = NULL;
+    }
+    else if (required_insert_count > table->insert_count) {
+        /* The stream is blocked until the entries are received on the encoder stream */
+        int is_listed = 0;
+
+        for (h3zero_qpack_blocked_t* blocked = qpack->first_blocked; blocked != NULL; blocked = blocked->next) {
+            if (blocked->stream_id == stream_id) {
+                is_listed = 1;
+                break;
+            }
+        }
+        if (!is_listed) {
+            h3zero_qpack_blocked_t* blocked = NULL;
+
+            if (qpack->nb_blocked >= qpack->local_max_blocked_streams ||
+                (blocked = (h3zero_qpack_blocked_t*)malloc(sizeof(h3zero_qpack_blocked_t))) == NULL) {
+                fields = NULL;
+            }
+            else {
+                blocked->stream_id = stream_id;
+                blocked->required_insert_count = required_insert_count;
+                blocked->next = qpack->first_blocked;
+                qpack->first_blocked = blocked;
+                qpack->nb_blocked++;
+                qpack->nb_blocked_sections++;
+            }
+        }
+        if (fields != NULL) {
+            *is_blocked = 1;
+            fields = bytes;
+        }
+    }
+    else {
+        uint64_t base = 0;
+
+        if (!is_negative) {
+            base = required_insert_count + delta_base;
+        }
+        else if (delta_base < required_insert_count) {
+            base = required_insert_count - delta_base - 1;
+        }
+        else {
+            fields = NULL;
+        }
+        (void)h3zero_qpack_remove_blocked(qpack, stream_id);
+        fields = h3zero_parse_qpack_field_lines(fields, bytes_max, parts, table, required_insert_count, base);
+        if (fields != NULL && required_insert_count > 0) {
+            if (h3zero_qpack_queue_instruction(&qpack->decoder_instructions, 0x80, 0x7F, stream_id) != 0) {
+                fields = NULL;
+            }
+            else if (required_insert_count > qpack->acknowledged_insert_count) {
+                qpack->acknowledged_insert_count = required_insert_count;
+            }
+        }
+    }
+
+    if (fields == NULL) {
+        *error_found = H3ZERO_QPACK_DECOMPRESSION_FAILED;
+    }
+    return fields;
+}
+
+uint64_t h3zero_qpack_get_unblocked_stream(h3zero_qpack_ctx_t* qpack)
+{
+    for (h3zero_qpack_blocked_t* blocked = qpack->first_blocked; blocked != NULL; blocked = blocked->next) {
+        if (blocked->required_insert_count <= qpack->decoder_table.insert_count) {
+            uint64_t stream_id = blocked->stream_id;
+            (void)h3zero_qpack_remove_blocked(qpack, stream_id);
+            return stream_id;
+        }
+    }
+    return UINT64_MAX;
+}
+
+void h3zero_qpack_cancel_stream(h3zero_qpack_ctx_t* qpack, uint64_t stream_id)
+{
+    if (h3zero_qpack_remove_blocked(qpack, stream_id)) {
+        (void)h3zero_qpack_queue_instruction(&qpack->decoder_instructions, 0x40, 0x3F, stream_id);
+    }
+}
@@ -0,0 +1,175 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef H3ZERO_QPACK_H
+#define H3ZERO_QPACK_H
+
+/* QPACK dynamic table, as specified in RFC 9204.
+ *
+ * Each HTTP/3 connection holds two dynamic tables. The encoder table
+ * mirrors the table of the peer's decoder: entries are added when the
+ * local encoder sends instructions on its encoder stream, and the peer
+ * acknowledges them on its decoder stream. The decoder table is updated
+ * by the instructions received on the peer's encoder stream.
+ *
+ * The encoder works on header blocks prepared with the static table only,
+ * such as those produced by the `h3zero_create_xxx_header_frame` functions.
+ * Literal fields that are not marked "never indexed" are inserted in the
+ * dynamic table, and are replaced by references to the table once the
+ * entries are present. The :path header is not inserted, because paths
+ * rarely repeat and would push more useful entries out of the table.
+ * References to entries that the peer has not yet acknowledged block the
+ * stream on the peer side; they are only used if the peer's limit of
+ * blocked streams allows it.
+ *
+ * The decoder parses header blocks that reference the decoder table.
+ * If the block requires entries that have not been received yet, the
+ * stream is blocked. The caller keeps the header frame, and retries after
+ * the encoder stream is processed -- `h3zero_qpack_get_unblocked_stream`
+ * returns the streams that can make progress.
+ *
+ * The instructions for the encoder and decoder streams are accumulated in
+ * buffers, which the application sends on its unidirectional streams.
+ * The code does not depend on picoquic.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include "h3zero.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT 4096
+#define H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT 16
+#define H3ZERO_QPACK_ENTRY_OVERHEAD 32
+#define H3ZERO_QPACK_MAX_FIELDS 64
+
+typedef struct st_h3zero_qpack_entry_t {
+    uint8_t* name;
+    size_t name_length;
+    uint8_t* value;
+    size_t value_length;
+    uint64_t static_name_index; /* Static entry with the same name, or UINT64_MAX */
+    http_header_enum_t header; /* Header type, as used when parsing header blocks */
+} h3zero_qpack_entry_t;
+
+typedef struct st_h3zero_qpack_table_t {
+    h3zero_qpack_entry_t* entries; /* circular buffer, oldest entry at index "first" */
+    size_t nb_entries_max;
+    size_t first;
+    size_t nb_entries;
+    uint64_t max_capacity;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t insert_count;
+} h3zero_qpack_table_t;
+
+typedef struct st_h3zero_qpack_buffer_t {
+    uint8_t* bytes;
+    size_t length;
+    size_t size;
+} h3zero_qpack_buffer_t;
+
+/* Header block sent by the encoder, not yet acknowledged by the peer */
+typedef struct st_h3zero_qpack_section_t {
+    struct st_h3zero_qpack_section_t* next;
+    uint64_t stream_id;
+    uint64_t required_insert_count;
+    uint64_t min_reference;
+} h3zero_qpack_section_t;
+
+/* Stream whose header block waits for encoder instructions */
+typedef struct st_h3zero_qpack_blocked_t {
+    struct st_h3zero_qpack_blocked_t* next;
+    uint64_t stream_id;
+    uint64_t required_insert_count;
+} h3zero_qpack_blocked_t;
+
+typedef struct st_h3zero_qpack_ctx_t {
+    /* Local settings, and local unidir streams */
+    uint64_t local_max_capacity;
+    uint64_t local_max_blocked_streams;
+    uint64_t encoder_stream_id;
+    uint64_t decoder_stream_id;
+    /* Encoder state */
+    h3zero_qpack_table_t encoder_table;
+    uint64_t peer_max_capacity;
+    uint64_t known_received_count;
+    uint64_t peer_max_blocked_streams;
+    h3zero_qpack_section_t* first_section;
+    h3zero_qpack_section_t* last_section;
+    h3zero_qpack_buffer_t encoder_instructions; /* to send on the local encoder stream */
+    h3zero_qpack_buffer_t decoder_stream_input; /* partial instructions from the peer's decoder stream */
+    /* Decoder state */
+    h3zero_qpack_table_t decoder_table;
+    uint64_t acknowledged_insert_count;
+    h3zero_qpack_blocked_t* first_blocked;
+    uint64_t nb_blocked;
+    h3zero_qpack_buffer_t decoder_instructions; /* to send on the local decoder stream */
+    h3zero_qpack_buffer_t encoder_stream_input; /* partial instructions from the peer's encoder stream */
+    /* Statistics */
+    uint64_t nb_dynamic_references;
+    uint64_t nb_blocked_sections;
+    unsigned int is_initialized : 1;
+    unsigned int encoder_enabled : 1;
+} h3zero_qpack_ctx_t;
+
+/* Initialize the context with the local settings, i.e., the capacity of
+ * the decoder table and the number of streams that may be blocked.
+ * Zero values mean no dynamic table. */
+int h3zero_qpack_init(h3zero_qpack_ctx_t* qpack, uint64_t max_capacity, uint64_t max_blocked_streams);
+void h3zero_qpack_release(h3zero_qpack_ctx_t* qpack);
+/* Apply the peer's settings. The encoder uses the smallest of the local and
+ * peer capacity, and queues a "set dynamic table capacity" instruction. */
+int h3zero_qpack_set_peer_settings(h3zero_qpack_ctx_t* qpack, uint64_t peer_max_capacity, uint64_t peer_max_blocked_streams);
+
+/* Process data received on the peer's encoder or decoder stream.
+ * Return 0 if OK, or -1 and an H3 error code. */
+int h3zero_qpack_encoder_stream_input(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length, uint64_t* error_found);
+int h3zero_qpack_decoder_stream_input(h3zero_qpack_ctx_t* qpack, const uint8_t* bytes, size_t length, uint64_t* error_found);
+
+/* Re-encode a header block prepared with the static table, using references to
+ * the dynamic table. Returns a pointer to the end of the encoded block, or NULL. */
+uint8_t* h3zero_qpack_encode_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    const uint8_t* block, const uint8_t* block_max, uint8_t* bytes, uint8_t* bytes_max);
+/* Same, but compress the block in place if the encoder is enabled. Returns the
+ * new end of the block, or `block_last` if the block is unchanged. */
+uint8_t* h3zero_qpack_compress_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    uint8_t* block, uint8_t* block_last, uint8_t* block_max);
+/* Decode a header block. If the block references entries not yet received,
+ * `is_blocked` is set and the function returns `bytes`. Returns NULL on error. */
+uint8_t* h3zero_qpack_decode_header_block(h3zero_qpack_ctx_t* qpack, uint64_t stream_id,
+    uint8_t* bytes, uint8_t* bytes_max, h3zero_header_parts_t* parts, int* is_blocked, uint64_t* error_found);
+/* Return the ID of a blocked stream that can now be decoded, or UINT64_MAX */
+uint64_t h3zero_qpack_get_unblocked_stream(h3zero_qpack_ctx_t* qpack);
+/* Abandon decoding of the stream, e.g., after a reset */
+void h3zero_qpack_cancel_stream(h3zero_qpack_ctx_t* qpack, uint64_t stream_id);
+
+const h3zero_qpack_entry_t* h3zero_qpack_table_get(const h3zero_qpack_table_t* table, uint64_t absolute_index);
+uint8_t* h3zero_parse_qpack_field_lines(uint8_t* bytes, uint8_t* bytes_max, h3zero_header_parts_t* parts,
+    const h3zero_qpack_table_t* table, uint64_t required_insert_count, uint64_t base);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* H3ZERO_QPACK_H */
@@ -88,14 +88,15 @@ int demo_server_is_path_sane(const uint8_t* path, size_t path_length)
     return ret;
 }
 
-int demo_server_try_file_path(const uint8_t* path, size_t path_length, uint64_t* echo_size,
-    char** file_path, char const* web_folder, int * file_error)
+static int demo_server_try_file_path_ex(const uint8_t* path, size_t path_length, uint64_t* echo_size,
+    char** file_path, char const* web_folder, int * file_error, h3zero_content_cache_t* content_cache)
 {
     int ret = -1;
     size_t len = strlen(web_folder);
     size_t file_name_len = len + path_length + 1;
     char* file_name = malloc(file_name_len);
     FILE* F;
+    h3zero_content_t* content;
 
     if (file_name != NULL && demo_server_is_path_sane(path, path_length) == 0) {
         memcpy(file_name, web_folder, len);
@@ -114,9 +115,13 @@ int demo_server_try_file_path(const uint8_t* path, size_t path_length, uint64_t*
         len += path_length - 1;
         file_name[len] = 0;
 
-        F = picoquic_file_open_ex(file_name, "rb", file_error);
-
-        if (F != NULL) {
+        if (content_cache != NULL && (content = h3zero_content_cache_peek(content_cache, file_name)) != NULL) {
+            /* Hot file, no need to open it again */
+            *echo_size = h3zero_content_length(content);
+            *file_path = file_name;
+            ret = 0;
+        }
+        else if ((F = picoquic_file_open_ex(file_name, "rb", file_error)) != NULL) {
             long sz;
             fseek(F, 0, SEEK_END);
             sz = ftell(F);
@@ -138,8 +143,14 @@ int demo_server_try_file_path(const uint8_t* path, size_t path_length, uint64_t*
     return ret;
 }
 
-int h3zero_server_parse_path(const uint8_t * path, size_t path_length, uint64_t * echo_size, 
-    char ** file_path, char const * web_folder, int * file_error)
+int demo_server_try_file_path(const uint8_t* path, size_t path_length, uint64_t* echo_size,
+    char** file_path, char const* web_folder, int* file_error)
+{
+    return demo_server_try_file_path_ex(path, path_length, echo_size, file_path, web_folder, file_error, NULL);
+}
+
+int h3zero_server_parse_path_ex(const uint8_t * path, size_t path_length, uint64_t * echo_size, 
+    char ** file_path, char const * web_folder, int * file_error, h3zero_content_cache_t* content_cache)
 {
     int ret = 0;
 
@@ -155,8 +166,8 @@ int h3zero_server_parse_path(const uint8_t * path, size_t path_length, uint64_t
     if (path == NULL || path_length == 0 || path[0] != '/') {
         ret = -1;
     }
-    else if (web_folder != NULL && demo_server_try_file_path(path, path_length, echo_size,
-        file_path, web_folder, file_error) == 0) {
+    else if (web_folder != NULL && demo_server_try_file_path_ex(path, path_length, echo_size,
+        file_path, web_folder, file_error, content_cache) == 0) {
         ret = 0;
     }
     else if (path_length > 1 && (path_length != 11 || memcmp(path, "/index.html", 11) != 0)) {
@@ -183,6 +194,12 @@ int h3zero_server_parse_path(const uint8_t * path, size_t path_length, uint64_t
     return ret;
 }
 
+int h3zero_server_parse_path(const uint8_t * path, size_t path_length, uint64_t * echo_size, 
+    char ** file_path, char const * web_folder, int * file_error)
+{
+    return h3zero_server_parse_path_ex(path, path_length, echo_size, file_path, web_folder, file_error, NULL);
+}
+
 /* Prepare to send. This is the same code as on the client side, except for the
  * delayed opening of the data file */
 int h3zero_server_prepare_to_send(void* context, size_t space, h3zero_stream_ctx_t* stream_ctx)
@@ -204,6 +221,52 @@ int h3zero_server_prepare_to_send(void* context, size_t space, h3zero_stream_ctx
     return ret;
 }
 
+/* Queue the whole content of the file on the stream, by reference to the
+ * bytes mapped in the content cache. The cache entry is released when the
+ * transport releases the buffer. Returns -1 if the content is not available,
+ * in which case the file will be sent through the prepare to send callback.
+ * If a file reader is provided, a missing file is not mapped by the network
+ * thread: the reader workers are asked to map it for the next requests, and
+ * the caller shall serve this request through the reader. */
+int h3zero_server_queue_cached_content_ex(picoquic_cnx_t* cnx, h3zero_stream_ctx_t* stream_ctx,
+    h3zero_content_cache_t* content_cache, h3zero_file_reader_t* file_reader)
+{
+    int ret = -1;
+    h3zero_content_t* content;
+
+    if (file_reader == NULL) {
+        content = h3zero_content_cache_get(content_cache, stream_ctx->file_path);
+    }
+    else if ((content = h3zero_content_cache_find(content_cache, stream_ctx->file_path)) == NULL) {
+        (void)h3zero_file_reader_fill_cache(file_reader, content_cache, stream_ctx->file_path);
+    }
+
+    if (content != NULL) {
+        /* The response headers announce the length found when parsing the path */
+        if (h3zero_content_length(content) == stream_ctx->echo_length) {
+            picoquic_iovec_t iov;
+
+            iov.base = h3zero_content_bytes(content);
+            iov.len = (size_t)h3zero_content_length(content);
+            ret = picoquic_add_buffers_to_stream(cnx, stream_ctx->stream_id, &iov, 1, 1,
+                h3zero_content_buffer_release, content, stream_ctx);
+        }
+        if (ret == 0) {
+            stream_ctx->echo_sent = stream_ctx->echo_length;
+        }
+        else {
+            h3zero_content_release(content);
+        }
+    }
+
+    return ret;
+}
+
+int h3zero_server_queue_cached_content(picoquic_cnx_t* cnx, h3zero_stream_ctx_t* stream_ctx, h3zero_content_cache_t* content_cache)
+{
+    return h3zero_server_queue_cached_content_ex(cnx, stream_ctx, content_cache, NULL);
+}
+
 /* TODO:
  * - Establish processing of CONNECT
  * 
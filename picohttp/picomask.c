@@ -119,12 +119,16 @@ int h3zero_queue_connect_header_frame(
     uint8_t buffer[1024];
     uint8_t* bytes = buffer;
     uint8_t* bytes_max = bytes + 1024;
+    h3zero_callback_ctx_t* h3_ctx = stream_ctx->ps.stream_state.h3_ctx;
 
     *bytes++ = h3zero_frame_header;
     bytes += 2; /* reserve two bytes for frame length */
 
     bytes = h3zero_create_connect_header_frame(bytes, bytes_max, authority, path, path_length, protocol, NULL,
         ua_string);
+    if (bytes != NULL && h3_ctx != NULL) {
+        bytes = h3zero_qpack_compress_header_block(&h3_ctx->qpack, stream_ctx->stream_id, &buffer[3], bytes, bytes_max);
+    }
 
     if (bytes == NULL) {
         ret = -1;
@@ -145,6 +149,9 @@ int h3zero_queue_connect_header_frame(
         stream_ctx->ps.stream_state.is_upgrade_requested = 1;
         ret = picoquic_add_to_stream_with_ctx(cnx, stream_ctx->stream_id, buffer, connect_length,
             0, stream_ctx);
+        if (ret == 0 && h3_ctx != NULL) {
+            ret = h3zero_qpack_send_instructions(cnx, h3_ctx);
+        }
     }
 
     return ret;
@@ -413,7 +420,7 @@ int picomask_register_proxy(picoquic_quic_t * quic, char const * proxy_sni, size
         }
         else {
             picoquic_set_callback(picomask_ctx->cnx, h3zero_callback, picomask_ctx->h3_ctx);
-            ret = h3zero_protocol_init(picomask_ctx->cnx);
+            ret = h3zero_protocol_init_ex(picomask_ctx->cnx, picomask_ctx->h3_ctx);
         }
     }
     /* TODO: release picomask_ctx on error */
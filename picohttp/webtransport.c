@@ -208,7 +208,7 @@ int picowt_prepare_client_cnx(picoquic_quic_t* quic, struct sockaddr* server_add
         picoquic_set_callback(*p_cnx, h3zero_callback, *p_h3_ctx);
         /* Perform the initialization, settings and QPACK streams
          */
-        ret = h3zero_protocol_init(*p_cnx);
+        ret = h3zero_protocol_init_ex(*p_cnx, *p_h3_ctx);
     }
     return ret;
 }
@@ -245,6 +245,9 @@ int picowt_connect(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,  h3zero_stre
 
         bytes = h3zero_create_connect_header_frame(bytes, bytes_max, authority, (const uint8_t*)path, strlen(path), "webtransport", NULL,
             H3ZERO_USER_AGENT_STRING);
+        if (bytes != NULL) {
+            bytes = h3zero_qpack_compress_header_block(&ctx->qpack, stream_ctx->stream_id, &buffer[3], bytes, bytes_max);
+        }
 
         if (bytes == NULL) {
             ret = -1;
@@ -265,6 +268,9 @@ int picowt_connect(picoquic_cnx_t* cnx, h3zero_callback_ctx_t* ctx,  h3zero_stre
             stream_ctx->ps.stream_state.is_upgrade_requested = 1;
             ret = picoquic_add_to_stream_with_ctx(cnx, stream_ctx->stream_id, buffer, connect_length,
                     0, stream_ctx);
+            if (ret == 0) {
+                ret = h3zero_qpack_send_instructions(cnx, ctx);
+            }
         }
 
         if (ret != 0) {
@@ -442,7 +448,7 @@ void picowt_deregister(picoquic_cnx_t* cnx,
                 stream_ctx->path_callback = NULL;
                 stream_ctx->path_callback_ctx = NULL;
                 h3zero_forget_stream(cnx, stream_ctx);
-                picosplay_delete_hint(&h3_ctx->h3_stream_tree, next);
+                h3zero_delete_stream(cnx, h3_ctx, stream_ctx);
             }
             else {
                 previous = next;
@@ -54,6 +54,7 @@ static const picoquic_test_def_t test_table[] = {
     { "h3zero_client_data", h3zero_client_data_test },
     { "qpack_huffman", qpack_huffman_test },
     { "qpack_huffman_base", qpack_huffman_base_test},
+    { "qpack_huffman_encode", qpack_huffman_encode_test },
     { "h3zero_parse_qpack", h3zero_parse_qpack_test },
     { "h3zero_prepare_qpack", h3zero_prepare_qpack_test },
     { "h3zero_user_agent", h3zero_user_agent_test },
@@ -76,6 +77,9 @@ static const picoquic_test_def_t test_table[] = {
     { "demo_file_sanitize", demo_file_sanitize_test },
     { "demo_file_access", demo_file_access_test },
     { "demo_server_file", demo_server_file_test },
+    { "h3zero_async_file", h3zero_async_file_test },
+    { "h3zero_content_cache", h3zero_content_cache_test },
+    { "h3zero_qpack", h3zero_qpack_test },
     { "h3zero_satellite", h3zero_satellite_test },
     { "h09_satellite", h09_satellite_test },
     { "h09_lone_fin", h09_lone_fin_test },
@@ -124,24 +128,38 @@ static const picoquic_test_def_t test_table[] = {
     { "cc_ns_wifi_bad_bbr", cc_ns_wifi_bad_bbr_test },
     { "cc_ns_varylink", cc_ns_varylink_test },
     { "cc_ns_satellite", cc_ns_satellite_test },
-    { "cc_ns_media", cc_ns_media_test }
+    { "cc_ns_media", cc_ns_media_test },
+    { "cc_ns_mpsched_default", cc_ns_mpsched_default_test },
+    { "cc_ns_mpsched_minrtt", cc_ns_mpsched_minrtt_test },
+    { "cc_ns_mpsched_ecf", cc_ns_mpsched_ecf_test },
+    { "cc_ns_mpsched_weighted", cc_ns_mpsched_weighted_test },
+    { "cc_ns_mpsched_redundant", cc_ns_mpsched_redundant_test }
 };
 
 static size_t const nb_tests = sizeof(test_table) / sizeof(picoquic_test_def_t);
 
-static int do_one_test(size_t i, FILE* F)
+/* Benchmarks are not part of the default run. They are executed with "-b",
+ * or when named explicitly on the command line.
+ */
+static const picoquic_test_def_t bench_table[] = {
+    { "qpack_huffman_bench", qpack_huffman_bench_test }
+};
+
+#define NB_BENCHES (sizeof(bench_table) / sizeof(picoquic_test_def_t))
+
+static int do_one_test_def(picoquic_test_def_t const* table, size_t nb_table, size_t i, FILE* F)
 {
     int ret = 0;
 
-    if (i >= nb_tests) {
+    if (i >= nb_table) {
         fprintf(F, "Invalid test number %" PRIst "\n", i);
         ret = -1;
     } else {
-        fprintf(F, "Starting test number %" PRIst ", %s\n", i, test_table[i].test_name);
+        fprintf(F, "Starting test number %" PRIst ", %s\n", i, table[i].test_name);
 
         fflush(F);
 
-        ret = test_table[i].test_fn();
+        ret = table[i].test_fn();
         if (ret == 0) {
             fprintf(F, "    Success.\n");
         } else {
@@ -154,6 +172,11 @@ static int do_one_test(size_t i, FILE* F)
     return ret;
 }
 
+static int do_one_test(size_t i, FILE* F)
+{
+    return do_one_test_def(test_table, nb_tests, i, F);
+}
+
 int usage(char const * argv0)
 {
     fprintf(stderr, "PicoQUIC test execution\n");
@@ -169,7 +192,17 @@ int usage(char const * argv0)
         }
         fprintf(stderr, "\n");
     }
+    fprintf(stderr, "Benchmarks, only run with -b or when named: \n");
+    for (size_t x = 0; x < NB_BENCHES; x++) {
+        fprintf(stderr, "    ");
+
+        for (int j = 0; j < 4 && x < NB_BENCHES; j++, x++) {
+            fprintf(stderr, "%s, ", bench_table[x].test_name);
+        }
+        fprintf(stderr, "\n");
+    }
     fprintf(stderr, "Options: \n");
+    fprintf(stderr, "  -b                Run the benchmarks instead of the tests.\n");
     fprintf(stderr, "  -x test           Do not run the specified test.\n");
     fprintf(stderr, "  -s nnn            Set the number of stress clients to nnn.\n");
     fprintf(stderr, "  -R xxxxxxxx       Set seed for stress tests to xxxxxxxx.\n");
@@ -208,6 +241,36 @@ int get_test_number(char const * test_name)
     return test_number;
 }
 
+int get_bench_number(char const * bench_name)
+{
+    int bench_number = -1;
+
+    for (size_t i = 0; i < NB_BENCHES; i++) {
+        if (strcmp(bench_name, bench_table[i].test_name) == 0) {
+            bench_number = (int)i;
+        }
+    }
+
+    return bench_number;
+}
+
+static int do_one_bench(size_t i, test_status_t* bench_status, int* nb_test_tried, int* nb_test_failed)
+{
+    int ret = 0;
+
+    (*nb_test_tried)++;
+    if (do_one_test_def(bench_table, NB_BENCHES, i, stdout) != 0) {
+        bench_status[i] = test_failed;
+        (*nb_test_failed)++;
+        ret = -1;
+    }
+    else {
+        bench_status[i] = test_success;
+    }
+
+    return ret;
+}
+
 int main(int argc, char** argv)
 {
     int ret = 0;
@@ -215,7 +278,9 @@ int main(int argc, char** argv)
     int nb_test_failed = 0;
     int stress_clients = 0;
     test_status_t * test_status = (test_status_t *) calloc(nb_tests, sizeof(test_status_t));
+    test_status_t bench_status[NB_BENCHES] = { test_not_run };
     int opt;
+    int do_bench = 0;
     int random_seed = 0;
     int nb_multi_file = 0;
     int disable_debug = 0;
@@ -228,8 +293,11 @@ int main(int argc, char** argv)
     }
     else
     {
-        while (ret == 0 && (opt = getopt(argc, argv, "R:s:m:S:x:nrh")) != -1) {
+        while (ret == 0 && (opt = getopt(argc, argv, "R:s:m:S:x:bnrh")) != -1) {
             switch (opt) {
+            case 'b':
+                do_bench = 1;
+                break;
             case 'x': {
                 int test_number = get_test_number(optarg);
 
@@ -300,7 +368,14 @@ int main(int argc, char** argv)
 
         if (ret == 0)
         {
-            if (optind >= argc) {
+            if (do_bench) {
+                for (size_t i = 0; i < NB_BENCHES; i++) {
+                    if (do_one_bench(i, bench_status, &nb_test_tried, &nb_test_failed) != 0) {
+                        ret = -1;
+                    }
+                }
+            }
+            else if (optind >= argc) {
                 for (size_t i = 0; i < nb_tests; i++) {
                     if (test_status[i] == test_not_run) {
                         nb_test_tried++;
@@ -321,8 +396,15 @@ int main(int argc, char** argv)
             else {
                 for (int arg_num = optind; arg_num < argc; arg_num++) {
                     int test_number = get_test_number(argv[arg_num]);
+                    int bench_number;
 
-                    if (test_number < 0) {
+                    if (test_number < 0 && (bench_number = get_bench_number(argv[arg_num])) >= 0) {
+                        if (do_one_bench(bench_number, bench_status, &nb_test_tried, &nb_test_failed) != 0) {
+                            ret = -1;
+                        }
+                        break;
+                    }
+                    else if (test_number < 0) {
                         fprintf(stderr, "Incorrect test name: %s\n", argv[arg_num]);
                         ret = usage(argv[0]);
                     }
@@ -354,12 +436,23 @@ int main(int argc, char** argv)
                     fprintf(stdout, "%s ", test_table[i].test_name);
                 }
             }
+            for (size_t i = 0; i < NB_BENCHES; i++) {
+                if (bench_status[i] == test_failed) {
+                    fprintf(stdout, "%s ", bench_table[i].test_name);
+                }
+            }
             fprintf(stdout, "\n");
 
             if (disable_debug && retry_failed_test) {
                 /* debug_printf_push_stream(stderr); */
                 debug_printf_resume();
                 ret = 0;
+                for (size_t i = 0; i < NB_BENCHES; i++) {
+                    if (bench_status[i] == test_failed) {
+                        fprintf(stdout, "Cannot retry %s:\n", bench_table[i].test_name);
+                        ret = -1;
+                    }
+                }
                 for (size_t i = 0; i < nb_tests; i++) {
                     int is_stress = 0;
                     if (strcmp("http_stress", test_table[i].test_name) == 0) {
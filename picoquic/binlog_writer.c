@@ -0,0 +1,527 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Asynchronous writer for the binary logs, see picoquic_binlog.h.
+ *
+ * Each QUIC context owns a ring. The network thread is the only producer,
+ * and the writer thread the only consumer. The producer only updates
+ * `head`, the consumer only updates `tail`, so the ring is managed without
+ * locks. Records are aligned on 8 bytes, and start with a header
+ * identifying the file. A header with `is_close` set asks the writer to
+ * close the file after writing the previous records. The close record
+ * may carry a callback, called by the writer once the file is closed,
+ * e.g., to convert the complete log to qlog.
+ *
+ * The writer mutex protects the list of rings, the `is_released` flag,
+ * and the writer statistics. Rings are only freed by the writer thread,
+ * or by the deletion of the writer, so the writer can walk the list
+ * without holding the mutex.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef _WINDOWS
+#include "wincompat.h"
+#endif
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_binlog.h"
+
+#define PICOQUIC_BINLOG_WRITER_WAIT 5000
+
+#ifdef _WINDOWS
+#define binlog_ring_load(x) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(x), 0, 0))
+#define binlog_ring_store(x, v) ((void)InterlockedExchange64((volatile LONG64*)(x), (LONG64)(v)))
+#else
+#define binlog_ring_load(x) __atomic_load_n((x), __ATOMIC_ACQUIRE)
+#define binlog_ring_store(x, v) __atomic_store_n((x), (v), __ATOMIC_RELEASE)
+#endif
+
+typedef struct st_picoquic_binlog_record_t {
+    FILE* f;
+    uint32_t length;
+    uint32_t is_close;
+} picoquic_binlog_record_t;
+
+#define PICOQUIC_BINLOG_ALIGN(l) (((l) + 7) & ~((size_t)7))
+#define PICOQUIC_BINLOG_RECORD_HEADER PICOQUIC_BINLOG_ALIGN(sizeof(picoquic_binlog_record_t))
+
+typedef struct st_picoquic_binlog_close_job_t {
+    picoquic_binlog_closed_fn closed_fn;
+    void* closed_ctx;
+} picoquic_binlog_close_job_t;
+
+typedef struct st_picoquic_binlog_close_t {
+    struct st_picoquic_binlog_close_t* next_close;
+    FILE* f;
+    picoquic_binlog_close_job_t job;
+} picoquic_binlog_close_t;
+
+struct st_picoquic_binlog_ring_t {
+    struct st_picoquic_binlog_ring_t* next_ring;
+    picoquic_binlog_writer_t* writer;
+    uint8_t* buffer;
+    size_t size;
+    uint64_t head;
+    uint64_t tail;
+    /* Managed by the producer */
+    uint64_t last_signal;
+    picoquic_binlog_close_t* first_pending_close;
+    picoquic_binlog_close_t* last_pending_close;
+    picoquic_binlog_ring_stats_t stats;
+    /* Protected by the writer mutex */
+    int is_released;
+};
+
+struct st_picoquic_binlog_writer_t {
+    picoquic_mutex_t mutex;
+    picoquic_event_t work_event;
+    picoquic_thread_t thread;
+    size_t ring_size;
+    int should_stop;
+    picoquic_binlog_ring_t* first_ring;
+    picoquic_binlog_writer_stats_t stats;
+    unsigned int is_mutex_created : 1;
+    unsigned int is_work_event_created : 1;
+    unsigned int is_thread_created : 1;
+};
+
+static void picoquic_binlog_ring_copy_in(picoquic_binlog_ring_t* ring, uint64_t position, const uint8_t* data, size_t length)
+{
+    size_t offset = (size_t)(position & (ring->size - 1));
+    size_t first = ring->size - offset;
+
+    if (first >= length) {
+        memcpy(ring->buffer + offset, data, length);
+    }
+    else {
+        memcpy(ring->buffer + offset, data, first);
+        memcpy(ring->buffer, data + first, length - first);
+    }
+}
+
+static void picoquic_binlog_ring_copy_out(picoquic_binlog_ring_t* ring, uint64_t position, uint8_t* data, size_t length)
+{
+    size_t offset = (size_t)(position & (ring->size - 1));
+    size_t first = ring->size - offset;
+
+    if (first >= length) {
+        memcpy(data, ring->buffer + offset, length);
+    }
+    else {
+        memcpy(data, ring->buffer + offset, first);
+        memcpy(data + first, ring->buffer, length - first);
+    }
+}
+
+/* Called by the producer. Returns 0 if the record was queued, -1 if the ring is full. */
+static int picoquic_binlog_ring_push(picoquic_binlog_ring_t* ring, FILE* f, int is_close,
+    const uint8_t* head, size_t head_length, const uint8_t* data, size_t length)
+{
+    int ret = 0;
+    size_t record_length = PICOQUIC_BINLOG_RECORD_HEADER + PICOQUIC_BINLOG_ALIGN(head_length + length);
+    uint64_t tail = binlog_ring_load(&ring->tail);
+    uint64_t used = ring->head - tail;
+
+    if (used + record_length > ring->size) {
+        ret = -1;
+    }
+    else {
+        picoquic_binlog_record_t record;
+        uint64_t position = ring->head;
+
+        memset(&record, 0, sizeof(record));
+        record.f = f;
+        record.length = (uint32_t)(head_length + length);
+        record.is_close = (uint32_t)is_close;
+        picoquic_binlog_ring_copy_in(ring, position, (uint8_t*)&record, sizeof(record));
+        position += PICOQUIC_BINLOG_RECORD_HEADER;
+        if (head_length > 0) {
+            picoquic_binlog_ring_copy_in(ring, position, head, head_length);
+            position += head_length;
+        }
+        if (length > 0) {
+            picoquic_binlog_ring_copy_in(ring, position, data, length);
+        }
+        binlog_ring_store(&ring->head, ring->head + record_length);
+
+        used += record_length;
+        if (used > ring->stats.ring_fill_max) {
+            ring->stats.ring_fill_max = (size_t)used;
+        }
+        /* Wake up the writer when the ring fills up, or when a file shall be closed.
+         * Otherwise, the writer runs on its own timer. */
+        if (is_close || ring->head - ring->last_signal > ring->size / 4) {
+            ring->last_signal = ring->head;
+            (void)picoquic_signal_event(&ring->writer->work_event);
+        }
+    }
+
+    return ret;
+}
+
+/* Retry the close requests that did not fit in the ring. They are queued
+ * in order, after all the events for the same file. */
+static void picoquic_binlog_ring_push_pending(picoquic_binlog_ring_t* ring)
+{
+    while (ring->first_pending_close != NULL) {
+        picoquic_binlog_close_t* close_request = ring->first_pending_close;
+        if (picoquic_binlog_ring_push(ring, close_request->f, 1,
+            (uint8_t*)&close_request->job, sizeof(picoquic_binlog_close_job_t), NULL, 0) != 0) {
+            break;
+        }
+        ring->first_pending_close = close_request->next_close;
+        if (ring->first_pending_close == NULL) {
+            ring->last_pending_close = NULL;
+        }
+        free(close_request);
+    }
+}
+
+int picoquic_binlog_ring_write(picoquic_binlog_ring_t* ring, FILE* f,
+    const uint8_t* head, size_t head_length, const uint8_t* data, size_t length)
+{
+    int ret = 0;
+
+    if (ring->first_pending_close != NULL) {
+        picoquic_binlog_ring_push_pending(ring);
+    }
+    if (head_length + length > UINT32_MAX ||
+        picoquic_binlog_ring_push(ring, f, 0, head, head_length, data, length) != 0) {
+        /* Never block the network thread: drop the event, and count it. */
+        ring->stats.nb_dropped_events++;
+        ring->stats.nb_dropped_bytes += head_length + length;
+        ret = -1;
+    }
+    else {
+        ring->stats.nb_events++;
+        ring->stats.nb_bytes += head_length + length;
+    }
+
+    return ret;
+}
+
+void picoquic_binlog_ring_close_file(picoquic_binlog_ring_t* ring, FILE* f,
+    picoquic_binlog_closed_fn closed_fn, void* closed_ctx)
+{
+    picoquic_binlog_close_t* close_request = NULL;
+    picoquic_binlog_close_job_t job;
+
+    job.closed_fn = closed_fn;
+    job.closed_ctx = closed_ctx;
+
+    if (ring->first_pending_close != NULL) {
+        picoquic_binlog_ring_push_pending(ring);
+    }
+    if (ring->first_pending_close == NULL &&
+        picoquic_binlog_ring_push(ring, f, 1, (uint8_t*)&job, sizeof(job), NULL, 0) == 0) {
+        /* Queued */
+    }
+    else if ((close_request = (picoquic_binlog_close_t*)malloc(sizeof(picoquic_binlog_close_t))) != NULL) {
+        close_request->next_close = NULL;
+        close_request->f = f;
+        close_request->job = job;
+        if (ring->last_pending_close == NULL) {
+            ring->first_pending_close = close_request;
+        }
+        else {
+            ring->last_pending_close->next_close = close_request;
+        }
+        ring->last_pending_close = close_request;
+        ring->stats.nb_pending_closes++;
+    }
+    else {
+        /* Cannot queue the request. Leaking the file is better than closing
+         * it while the writer may still be using it. */
+        DBG_PRINTF("%s", "Cannot queue the closing of a binary log.\n");
+        if (closed_fn != NULL) {
+            closed_fn(closed_ctx, 0);
+        }
+    }
+}
+
+/* Called by the writer. Write or close the files for all the records
+ * present in the ring. Returns the number of records processed. */
+static int picoquic_binlog_ring_drain(picoquic_binlog_writer_t* writer, picoquic_binlog_ring_t* ring)
+{
+    int nb_records = 0;
+    uint64_t head = binlog_ring_load(&ring->head);
+    uint64_t tail = ring->tail;
+    uint64_t nb_bytes = 0;
+    uint64_t nb_closed = 0;
+
+    while (tail < head) {
+        picoquic_binlog_record_t record;
+        size_t offset;
+        size_t first;
+
+        picoquic_binlog_ring_copy_out(ring, tail, (uint8_t*)&record, sizeof(record));
+        if (record.is_close) {
+            picoquic_binlog_close_job_t job;
+
+            picoquic_binlog_ring_copy_out(ring, tail + PICOQUIC_BINLOG_RECORD_HEADER, (uint8_t*)&job, sizeof(job));
+            (void)picoquic_file_close(record.f);
+            nb_closed++;
+            if (job.closed_fn != NULL) {
+                /* The file is complete, e.g., it can be converted to qlog */
+                job.closed_fn(job.closed_ctx, 1);
+            }
+        }
+        else if (record.length > 0) {
+            offset = (size_t)((tail + PICOQUIC_BINLOG_RECORD_HEADER) & (ring->size - 1));
+            first = ring->size - offset;
+            if (first >= record.length) {
+                (void)fwrite(ring->buffer + offset, record.length, 1, record.f);
+            }
+            else {
+                (void)fwrite(ring->buffer + offset, first, 1, record.f);
+                (void)fwrite(ring->buffer, record.length - first, 1, record.f);
+            }
+            nb_bytes += record.length;
+        }
+        tail += PICOQUIC_BINLOG_RECORD_HEADER + PICOQUIC_BINLOG_ALIGN(record.length);
+        binlog_ring_store(&ring->tail, tail);
+        nb_records++;
+    }
+
+    if (nb_records > 0) {
+        (void)picoquic_lock_mutex(&writer->mutex);
+        writer->stats.nb_records += nb_records;
+        writer->stats.nb_bytes_written += nb_bytes;
+        writer->stats.nb_files_closed += nb_closed;
+        (void)picoquic_unlock_mutex(&writer->mutex);
+    }
+
+    return nb_records;
+}
+
+/* Close the files that could not be queued before the ring was released.
+ * Called without holding the writer mutex, since the close callbacks may
+ * take time or call back into the writer. */
+static void picoquic_binlog_ring_free(picoquic_binlog_writer_t* writer, picoquic_binlog_ring_t* ring)
+{
+    uint64_t nb_closed = 0;
+
+    while (ring->first_pending_close != NULL) {
+        picoquic_binlog_close_t* close_request = ring->first_pending_close;
+        ring->first_pending_close = close_request->next_close;
+        (void)picoquic_file_close(close_request->f);
+        nb_closed++;
+        if (close_request->job.closed_fn != NULL) {
+            close_request->job.closed_fn(close_request->job.closed_ctx, 1);
+        }
+        free(close_request);
+    }
+    if (nb_closed > 0) {
+        (void)picoquic_lock_mutex(&writer->mutex);
+        writer->stats.nb_files_closed += nb_closed;
+        (void)picoquic_unlock_mutex(&writer->mutex);
+    }
+    if (ring->buffer != NULL) {
+        free(ring->buffer);
+    }
+    free(ring);
+}
+
+/* Remove from the list the rings released by their QUIC context, once they
+ * have been drained, and free them after releasing the mutex. */
+static void picoquic_binlog_writer_collect(picoquic_binlog_writer_t* writer)
+{
+    picoquic_binlog_ring_t** p_next;
+    picoquic_binlog_ring_t* first_collected = NULL;
+
+    (void)picoquic_lock_mutex(&writer->mutex);
+    p_next = &writer->first_ring;
+    while (*p_next != NULL) {
+        picoquic_binlog_ring_t* ring = *p_next;
+        if (ring->is_released && ring->tail == binlog_ring_load(&ring->head)) {
+            *p_next = ring->next_ring;
+            ring->next_ring = first_collected;
+            first_collected = ring;
+        }
+        else {
+            p_next = &ring->next_ring;
+        }
+    }
+    (void)picoquic_unlock_mutex(&writer->mutex);
+
+    while (first_collected != NULL) {
+        picoquic_binlog_ring_t* ring = first_collected;
+        first_collected = ring->next_ring;
+        picoquic_binlog_ring_free(writer, ring);
+    }
+}
+
+static picoquic_thread_return_t picoquic_binlog_writer_thread(void* arg)
+{
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)arg;
+    int should_stop = 0;
+
+    while (!should_stop) {
+        picoquic_binlog_ring_t* ring;
+        int nb_records = 0;
+
+        (void)picoquic_lock_mutex(&writer->mutex);
+        should_stop = writer->should_stop;
+        ring = writer->first_ring;
+        (void)picoquic_unlock_mutex(&writer->mutex);
+
+        /* Rings added after reading the list are handled in the next pass */
+        while (ring != NULL) {
+            nb_records += picoquic_binlog_ring_drain(writer, ring);
+            ring = ring->next_ring;
+        }
+        picoquic_binlog_writer_collect(writer);
+
+        if (nb_records == 0 && !should_stop) {
+            (void)picoquic_wait_for_event(&writer->work_event, PICOQUIC_BINLOG_WRITER_WAIT);
+        }
+    }
+
+    picoquic_thread_do_return;
+}
+
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size)
+{
+    int ret = 0;
+    picoquic_binlog_writer_t* writer = (picoquic_binlog_writer_t*)malloc(sizeof(picoquic_binlog_writer_t));
+
+    if (writer != NULL) {
+        memset(writer, 0, sizeof(picoquic_binlog_writer_t));
+        /* The ring size must be a power of 2 */
+        writer->ring_size = 0x1000;
+        while (writer->ring_size < ring_size && writer->ring_size < ((size_t)1 << 30)) {
+            writer->ring_size <<= 1;
+        }
+        if (ring_size == 0) {
+            writer->ring_size = PICOQUIC_BINLOG_RING_SIZE_DEFAULT;
+        }
+
+        if ((ret = picoquic_create_mutex(&writer->mutex)) == 0) {
+            writer->is_mutex_created = 1;
+            if ((ret = picoquic_create_event(&writer->work_event)) == 0) {
+                writer->is_work_event_created = 1;
+            }
+        }
+        if (ret == 0 && (ret = picoquic_create_thread(&writer->thread, picoquic_binlog_writer_thread, writer)) == 0) {
+            writer->is_thread_created = 1;
+        }
+
+        if (ret != 0) {
+            picoquic_binlog_writer_delete(writer);
+            writer = NULL;
+        }
+    }
+
+    return writer;
+}
+
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer)
+{
+    if (writer->is_thread_created) {
+        (void)picoquic_lock_mutex(&writer->mutex);
+        writer->should_stop = 1;
+        (void)picoquic_unlock_mutex(&writer->mutex);
+        (void)picoquic_signal_event(&writer->work_event);
+        (void)picoquic_wait_thread(writer->thread);
+        picoquic_delete_thread(&writer->thread);
+    }
+    /* The QUIC contexts should have been freed before the writer. If not,
+     * write what is left, and close the files. */
+    while (writer->first_ring != NULL) {
+        picoquic_binlog_ring_t* ring = writer->first_ring;
+        writer->first_ring = ring->next_ring;
+        (void)picoquic_binlog_ring_drain(writer, ring);
+        picoquic_binlog_ring_free(writer, ring);
+    }
+    if (writer->is_mutex_created) {
+        (void)picoquic_delete_mutex(&writer->mutex);
+    }
+    if (writer->is_work_event_created) {
+        picoquic_delete_event(&writer->work_event);
+    }
+    free(writer);
+}
+
+void picoquic_binlog_writer_get_stats(picoquic_binlog_writer_t* writer, picoquic_binlog_writer_stats_t* stats)
+{
+    (void)picoquic_lock_mutex(&writer->mutex);
+    *stats = writer->stats;
+    (void)picoquic_unlock_mutex(&writer->mutex);
+}
+
+int picoquic_set_binlog_writer(picoquic_quic_t* quic, picoquic_binlog_writer_t* writer)
+{
+    int ret = 0;
+    picoquic_binlog_ring_t* ring;
+
+    if (quic->binlog_ring != NULL) {
+        ret = -1;
+    }
+    else if ((ring = (picoquic_binlog_ring_t*)malloc(sizeof(picoquic_binlog_ring_t))) == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        memset(ring, 0, sizeof(picoquic_binlog_ring_t));
+        ring->writer = writer;
+        ring->size = writer->ring_size;
+        ring->stats.ring_size = ring->size;
+        if ((ring->buffer = (uint8_t*)malloc(ring->size)) == NULL) {
+            free(ring);
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            (void)picoquic_lock_mutex(&writer->mutex);
+            ring->next_ring = writer->first_ring;
+            writer->first_ring = ring;
+            (void)picoquic_unlock_mutex(&writer->mutex);
+            quic->binlog_ring = ring;
+        }
+    }
+
+    return ret;
+}
+
+void picoquic_binlog_ring_release(picoquic_quic_t* quic)
+{
+    picoquic_binlog_ring_t* ring = quic->binlog_ring;
+
+    if (ring != NULL) {
+        picoquic_binlog_ring_push_pending(ring);
+        quic->binlog_ring = NULL;
+        /* From now on, the ring belongs to the writer */
+        (void)picoquic_lock_mutex(&ring->writer->mutex);
+        ring->is_released = 1;
+        (void)picoquic_unlock_mutex(&ring->writer->mutex);
+        (void)picoquic_signal_event(&ring->writer->work_event);
+    }
+}
+
+void picoquic_get_binlog_ring_stats(picoquic_quic_t* quic, picoquic_binlog_ring_stats_t* stats)
+{
+    memset(stats, 0, sizeof(picoquic_binlog_ring_stats_t));
+    if (quic->binlog_ring != NULL) {
+        picoquic_binlog_ring_t* ring = quic->binlog_ring;
+        *stats = ring->stats;
+        stats->ring_fill = (size_t)(ring->head - binlog_ring_load(&ring->tail));
+    }
+}
@@ -0,0 +1,554 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "picoquic_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "cc_common.h"
+#include "picoquic_coupledcc.h"
+
+/* Coupled congestion control for multipath connections.
+ *
+ * When each path runs its own congestion controller, a multipath
+ * connection behaves like several independent flows, and takes more
+ * than its fair share of a bottleneck shared by its paths. The
+ * coupled algorithms keep the slow start, hystart and recovery logic
+ * of New Reno on each path, but compute the congestion avoidance
+ * increase from the windows and RTT of all the active paths:
+ *
+ * - LIA (RFC 6356) caps the increase of each path so that the aggregate
+ *   is no more aggressive than a single flow on the best path.
+ * - OLIA (Khalili et al.) uses a rate based increase, plus a term that
+ *   moves window from the paths with the largest window to the paths
+ *   that appear best, as measured by the number of bytes delivered
+ *   between losses.
+ * - BALIA (Peng et al.) balances responsiveness and friendliness by
+ *   scaling both the increase and the decrease with the ratio between
+ *   the best path rate and the rate of the current path.
+ *
+ * The formulas are expressed in packets in the literature. With windows
+ * in bytes, the increase per byte acknowledged is multiplied by the
+ * path MTU, which gives the classic "mtu/cwin" increase of New Reno
+ * when the connection has a single path.
+ */
+
+typedef enum {
+    picoquic_coupledcc_lia = 0,
+    picoquic_coupledcc_olia,
+    picoquic_coupledcc_balia
+} picoquic_coupledcc_variant_t;
+
+typedef struct st_picoquic_coupledcc_state_t {
+    picoquic_coupledcc_variant_t variant;
+    picoquic_newreno_alg_state_t alg_state;
+    uint64_t ssthresh;
+    uint64_t recovery_start;
+    uint64_t recovery_sequence;
+    uint64_t cwin_before_recovery;
+    uint64_t bytes_since_loss; /* Bytes acknowledged since the last loss, for OLIA */
+    uint64_t bytes_between_losses; /* Bytes acknowledged between the two last losses, for OLIA */
+    double residual_increase;
+    picoquic_min_max_rtt_t rtt_filter;
+} picoquic_coupledcc_state_t;
+
+/* Summary of the active paths of the connection, computed each time
+ * the increase is evaluated. Rates are expressed in bytes per microsecond.
+ */
+typedef struct st_picoquic_coupledcc_summary_t {
+    int nb_paths;
+    double total_cwin;
+    double total_rate;
+    double max_cwin_rtt2;
+    double max_rate;
+    uint64_t min_retransmit;
+} picoquic_coupledcc_summary_t;
+
+static void picoquic_coupledcc_reset(picoquic_coupledcc_state_t* cc_state, picoquic_coupledcc_variant_t variant, picoquic_path_t* path_x)
+{
+    memset(cc_state, 0, sizeof(picoquic_coupledcc_state_t));
+    cc_state->variant = variant;
+    cc_state->alg_state = picoquic_newreno_alg_slow_start;
+    cc_state->ssthresh = UINT64_MAX;
+    path_x->cwin = PICOQUIC_CWIN_INITIAL;
+}
+
+static void picoquic_coupledcc_init(picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_coupledcc_variant_t variant)
+{
+    picoquic_coupledcc_state_t* cc_state = (picoquic_coupledcc_state_t*)malloc(sizeof(picoquic_coupledcc_state_t));
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(cnx);
+#endif
+
+    if (cc_state != NULL) {
+        picoquic_coupledcc_reset(cc_state, variant, path_x);
+    }
+    path_x->congestion_alg_state = cc_state;
+}
+
+/* Only the paths that carry traffic are coupled, using the same test as
+ * picoquic_sort_available_paths for scheduler candidates. Backup, unvalidated,
+ * demoted or retransmitting paths would otherwise inflate the aggregate window.
+ */
+static int picoquic_coupledcc_is_available(picoquic_path_t* path_x)
+{
+    return path_x->congestion_alg_state != NULL && !path_x->path_is_backup &&
+        path_x->first_tuple->challenge_verified && !path_x->path_is_demoted;
+}
+
+static int picoquic_coupledcc_is_coupled(picoquic_path_t* path_x, picoquic_path_t* path_ref, uint64_t min_retransmit)
+{
+    return path_x == path_ref ||
+        (picoquic_coupledcc_is_available(path_x) && path_x->nb_retransmit <= min_retransmit);
+}
+
+static double picoquic_coupledcc_rtt(picoquic_path_t* path_x)
+{
+    return (double)((path_x->smoothed_rtt > 0) ? path_x->smoothed_rtt : PICOQUIC_INITIAL_RTT);
+}
+
+static void picoquic_coupledcc_summarize(picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary)
+{
+    memset(summary, 0, sizeof(picoquic_coupledcc_summary_t));
+    summary->min_retransmit = UINT64_MAX;
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        picoquic_path_t* path_i = cnx->path[i];
+
+        if (picoquic_coupledcc_is_available(path_i) && path_i->nb_retransmit < summary->min_retransmit) {
+            summary->min_retransmit = path_i->nb_retransmit;
+        }
+    }
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        picoquic_path_t* path_i = cnx->path[i];
+
+        if (picoquic_coupledcc_is_coupled(path_i, path_x, summary->min_retransmit)) {
+            double cwin = (double)path_i->cwin;
+            double rtt = picoquic_coupledcc_rtt(path_i);
+            double rate = cwin / rtt;
+            double cwin_rtt2 = rate / rtt;
+
+            summary->nb_paths++;
+            summary->total_cwin += cwin;
+            summary->total_rate += rate;
+            if (cwin_rtt2 > summary->max_cwin_rtt2) {
+                summary->max_cwin_rtt2 = cwin_rtt2;
+            }
+            if (rate > summary->max_rate) {
+                summary->max_rate = rate;
+            }
+        }
+    }
+}
+
+/* LIA: increase = min(alpha*mtu/total_cwin, mtu/cwin) per byte acknowledged, with
+ * alpha = total_cwin * max(cwin_i/rtt_i^2) / (sum(cwin_i/rtt_i))^2
+ */
+static double picoquic_lia_increase(picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary, double acked)
+{
+    double uncoupled = acked / (double)path_x->cwin;
+    double coupled = acked * summary->max_cwin_rtt2 / (summary->total_rate * summary->total_rate);
+
+    return (coupled < uncoupled) ? coupled : uncoupled;
+}
+
+/* OLIA: increase = (cwin_r/rtt_r^2)/(sum(cwin_i/rtt_i))^2 + alpha_r/cwin_r per byte acknowledged.
+ * The best paths are those with the largest l_r/rtt_r^2, where l_r is the larger of the
+ * number of bytes acknowledged since the last loss and between the last two losses.
+ * If some best paths do not have the largest window, alpha_r moves window towards them:
+ * alpha_r = 1/(n*|best\max|) on these paths, -1/(n*|max|) on the paths of largest window,
+ * and zero otherwise.
+ */
+static double picoquic_olia_quality(picoquic_path_t* path_x)
+{
+    picoquic_coupledcc_state_t* cc_state = (picoquic_coupledcc_state_t*)path_x->congestion_alg_state;
+    double l_r = 0;
+
+    if (cc_state != NULL) {
+        l_r = (double)((cc_state->bytes_since_loss > cc_state->bytes_between_losses) ?
+            cc_state->bytes_since_loss : cc_state->bytes_between_losses);
+    }
+
+    double rtt = picoquic_coupledcc_rtt(path_x);
+
+    return l_r / (rtt * rtt);
+}
+
+static double picoquic_olia_coupled_alpha(picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary)
+{
+    double alpha = 0;
+    double best_quality = 0;
+    uint64_t max_cwin = 0;
+    int nb_max_cwin = 0;
+    int nb_collected = 0;
+    int is_collected = 0;
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        picoquic_path_t* path_i = cnx->path[i];
+
+        if (picoquic_coupledcc_is_coupled(path_i, path_x, summary->min_retransmit)) {
+            double quality = picoquic_olia_quality(path_i);
+
+            if (quality > best_quality) {
+                best_quality = quality;
+            }
+            if (path_i->cwin > max_cwin) {
+                max_cwin = path_i->cwin;
+            }
+        }
+    }
+
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        picoquic_path_t* path_i = cnx->path[i];
+
+        if (picoquic_coupledcc_is_coupled(path_i, path_x, summary->min_retransmit)) {
+            if (path_i->cwin == max_cwin) {
+                nb_max_cwin++;
+            }
+            else if (picoquic_olia_quality(path_i) >= best_quality) {
+                nb_collected++;
+                if (path_i == path_x) {
+                    is_collected = 1;
+                }
+            }
+        }
+    }
+
+    if (nb_collected > 0) {
+        if (is_collected) {
+            alpha = 1.0 / (double)(summary->nb_paths * nb_collected);
+        }
+        else if (path_x->cwin == max_cwin) {
+            alpha = -1.0 / (double)(summary->nb_paths * nb_max_cwin);
+        }
+    }
+
+    return alpha;
+}
+
+double picoquic_olia_alpha(picoquic_cnx_t* cnx, picoquic_path_t* path_x)
+{
+    picoquic_coupledcc_summary_t summary;
+
+    picoquic_coupledcc_summarize(cnx, path_x, &summary);
+
+    return picoquic_olia_coupled_alpha(cnx, path_x, &summary);
+}
+
+static double picoquic_olia_increase(picoquic_cnx_t* cnx, picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary, double acked)
+{
+    double rtt = picoquic_coupledcc_rtt(path_x);
+    double cwin = (double)path_x->cwin;
+    double rate_term = (cwin / (rtt * rtt)) / (summary->total_rate * summary->total_rate);
+    double alpha_term = picoquic_olia_coupled_alpha(cnx, path_x, summary) / cwin;
+
+    return acked * (rate_term + alpha_term);
+}
+
+/* BALIA: with x_r = cwin_r/rtt_r and alpha_r = max(x_i)/x_r, the increase per byte
+ * acknowledged is (x_r/rtt_r)/(sum(x_i))^2 * ((1+alpha_r)/2) * ((4+alpha_r)/5),
+ * and the decrease on loss is cwin_r/2 * min(alpha_r, 1.5).
+ */
+static double picoquic_balia_alpha(picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary)
+{
+    double rate = (double)path_x->cwin / picoquic_coupledcc_rtt(path_x);
+
+    return (rate > 0) ? summary->max_rate / rate : 1.0;
+}
+
+static double picoquic_balia_increase(picoquic_path_t* path_x, picoquic_coupledcc_summary_t* summary, double acked)
+{
+    double rtt = picoquic_coupledcc_rtt(path_x);
+    double rate = (double)path_x->cwin / rtt;
+    double alpha = picoquic_balia_alpha(path_x, summary);
+
+    return acked * (rate / rtt) / (summary->total_rate * summary->total_rate) *
+        ((1.0 + alpha) / 2.0) * ((4.0 + alpha) / 5.0);
+}
+
+/* Congestion avoidance. The fractional part of the increase is kept in the
+ * residual, so that small increases per acknowledgement add up over time.
+ */
+static void picoquic_coupledcc_avoidance(picoquic_coupledcc_state_t* cc_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, uint64_t nb_bytes_acknowledged)
+{
+    picoquic_coupledcc_summary_t summary;
+    double acked = (double)nb_bytes_acknowledged * (double)path_x->send_mtu;
+    double delta = 0;
+
+    picoquic_coupledcc_summarize(cnx, path_x, &summary);
+
+    if (summary.nb_paths <= 1 || summary.total_rate <= 0) {
+        delta = acked / (double)path_x->cwin;
+    }
+    else {
+        switch (cc_state->variant) {
+        case picoquic_coupledcc_olia:
+            delta = picoquic_olia_increase(cnx, path_x, &summary, acked);
+            break;
+        case picoquic_coupledcc_balia:
+            delta = picoquic_balia_increase(path_x, &summary, acked);
+            break;
+        case picoquic_coupledcc_lia:
+        default:
+            delta = picoquic_lia_increase(path_x, &summary, acked);
+            break;
+        }
+    }
+
+    cc_state->residual_increase += delta;
+    if (cc_state->residual_increase >= 1.0) {
+        uint64_t increase = (uint64_t)cc_state->residual_increase;
+        path_x->cwin += increase;
+        cc_state->residual_increase -= (double)increase;
+    }
+    else if (cc_state->residual_increase <= -1.0) {
+        uint64_t decrease = (uint64_t)(-cc_state->residual_increase);
+        cc_state->residual_increase += (double)decrease;
+        if (path_x->cwin > cnx->quic->cwin_min + decrease) {
+            path_x->cwin -= decrease;
+        }
+        else {
+            path_x->cwin = cnx->quic->cwin_min;
+        }
+    }
+}
+
+/* On loss, LIA and OLIA halve the window like New Reno. BALIA removes
+ * cwin/2 * min(alpha, 1.5), so that paths much slower than the best path
+ * back off more.
+ */
+static uint64_t picoquic_coupledcc_decreased_cwin(picoquic_coupledcc_state_t* cc_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x)
+{
+    uint64_t cwin = path_x->cwin / 2;
+
+    if (cc_state->variant == picoquic_coupledcc_balia) {
+        picoquic_coupledcc_summary_t summary;
+        double alpha;
+
+        picoquic_coupledcc_summarize(cnx, path_x, &summary);
+        alpha = picoquic_balia_alpha(path_x, &summary);
+        if (alpha > 1.5) {
+            alpha = 1.5;
+        }
+        cwin = path_x->cwin - (uint64_t)(((double)path_x->cwin / 2.0) * alpha);
+    }
+
+    if (cwin < cnx->quic->cwin_min) {
+        cwin = cnx->quic->cwin_min;
+    }
+
+    return cwin;
+}
+
+static void picoquic_coupledcc_enter_recovery(picoquic_coupledcc_state_t* cc_state, picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x, picoquic_congestion_notification_t notification, uint64_t current_time)
+{
+    cc_state->cwin_before_recovery = path_x->cwin;
+    cc_state->ssthresh = picoquic_coupledcc_decreased_cwin(cc_state, cnx, path_x);
+
+    if (notification == picoquic_congestion_notification_timeout) {
+        path_x->cwin = cnx->quic->cwin_min;
+        cc_state->alg_state = picoquic_newreno_alg_slow_start;
+    }
+    else {
+        path_x->cwin = cc_state->ssthresh;
+        cc_state->alg_state = picoquic_newreno_alg_congestion_avoidance;
+    }
+
+    cc_state->bytes_between_losses = cc_state->bytes_since_loss;
+    cc_state->bytes_since_loss = 0;
+    cc_state->residual_increase = 0;
+    cc_state->recovery_start = current_time;
+    cc_state->recovery_sequence = picoquic_cc_get_sequence_number(cnx, path_x);
+    path_x->is_ssthresh_initialized = 1;
+}
+
+static void picoquic_coupledcc_notify(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    picoquic_congestion_notification_t notification,
+    picoquic_per_ack_state_t* ack_state,
+    uint64_t current_time)
+{
+    picoquic_coupledcc_state_t* cc_state = (picoquic_coupledcc_state_t*)path_x->congestion_alg_state;
+
+    path_x->is_cc_data_updated = 1;
+
+    if (cc_state != NULL) {
+        switch (notification) {
+        case picoquic_congestion_notification_acknowledgement:
+            cc_state->bytes_since_loss += ack_state->nb_bytes_acknowledged;
+            if (cc_state->alg_state == picoquic_newreno_alg_slow_start &&
+                cc_state->ssthresh == UINT64_MAX) {
+                /* Increase cwin based on bandwidth estimation. */
+                path_x->cwin = picoquic_cc_update_target_cwin_estimation(path_x);
+            }
+
+            if (path_x->last_time_acked_data_frame_sent > path_x->last_sender_limited_time) {
+                if (cc_state->alg_state == picoquic_newreno_alg_slow_start) {
+                    /* Slow start is not coupled, as in RFC 6356 */
+                    path_x->cwin += ack_state->nb_bytes_acknowledged;
+                    if (path_x->cwin >= cc_state->ssthresh) {
+                        cc_state->alg_state = picoquic_newreno_alg_congestion_avoidance;
+                    }
+                }
+                else {
+                    picoquic_coupledcc_avoidance(cc_state, cnx, path_x, ack_state->nb_bytes_acknowledged);
+                }
+            }
+            break;
+        case picoquic_congestion_notification_seed_cwin:
+            if (cc_state->alg_state == picoquic_newreno_alg_slow_start &&
+                cc_state->ssthresh == UINT64_MAX &&
+                ack_state->nb_bytes_acknowledged > path_x->cwin) {
+                path_x->cwin = ack_state->nb_bytes_acknowledged;
+                cc_state->ssthresh = path_x->cwin;
+                cc_state->alg_state = picoquic_newreno_alg_congestion_avoidance;
+            }
+            break;
+        case picoquic_congestion_notification_ecn_ec:
+        case picoquic_congestion_notification_repeat:
+        case picoquic_congestion_notification_timeout:
+            /* if the loss happened in this period, enter recovery */
+            if (cc_state->recovery_sequence <= ack_state->lost_packet_number) {
+                picoquic_coupledcc_enter_recovery(cc_state, cnx, path_x, notification, current_time);
+            }
+            break;
+        case picoquic_congestion_notification_spurious_repeat:
+            /* If spurious repeat of initial loss detected,
+             * exit recovery and restore the window.
+             */
+            if (current_time - cc_state->recovery_start < path_x->smoothed_rtt &&
+                ((!cnx->is_multipath_enabled && cc_state->recovery_sequence > picoquic_cc_get_ack_number(cnx, path_x)) ||
+                (cnx->is_multipath_enabled && cc_state->recovery_start > picoquic_cc_get_ack_sent_time(cnx, path_x))) &&
+                cc_state->ssthresh != UINT64_MAX && path_x->cwin < cc_state->cwin_before_recovery) {
+                path_x->cwin = cc_state->cwin_before_recovery;
+                cc_state->alg_state = picoquic_newreno_alg_congestion_avoidance;
+            }
+            break;
+        case picoquic_congestion_notification_rtt_measurement:
+            if (cc_state->alg_state == picoquic_newreno_alg_slow_start &&
+                cc_state->ssthresh == UINT64_MAX) {
+                /* if in slow start, increase the window for long delay RTT */
+                if (path_x->rtt_min > PICOQUIC_TARGET_RENO_RTT) {
+                    path_x->cwin = picoquic_cc_update_cwin_for_long_rtt(path_x);
+                }
+
+                /* HyStart. */
+                if (picoquic_cc_hystart_test(&cc_state->rtt_filter, (cnx->is_time_stamp_enabled) ? ack_state->one_way_delay : ack_state->rtt_measurement,
+                    cnx->path[0]->pacing.packet_time_microsec, current_time, cnx->is_time_stamp_enabled)) {
+                    /* RTT increased too much, get out of slow start! */
+                    cc_state->ssthresh = path_x->cwin;
+                    cc_state->alg_state = picoquic_newreno_alg_congestion_avoidance;
+                    path_x->is_ssthresh_initialized = 1;
+                }
+            }
+            break;
+        case picoquic_congestion_notification_reset:
+            picoquic_coupledcc_reset(cc_state, cc_state->variant, path_x);
+            break;
+        default:
+            /* ignore */
+            break;
+        }
+
+        /* Compute pacing data */
+        picoquic_update_pacing_data(cnx, path_x, cc_state->alg_state == picoquic_newreno_alg_slow_start &&
+            cc_state->ssthresh == UINT64_MAX);
+    }
+}
+
+static void picoquic_lia_init(picoquic_cnx_t* cnx, picoquic_path_t* path_x, char const* option_string, uint64_t current_time)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+    UNREFERENCED_PARAMETER(option_string);
+#endif
+    picoquic_coupledcc_init(cnx, path_x, picoquic_coupledcc_lia);
+}
+
+static void picoquic_olia_init(picoquic_cnx_t* cnx, picoquic_path_t* path_x, char const* option_string, uint64_t current_time)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+    UNREFERENCED_PARAMETER(option_string);
+#endif
+    picoquic_coupledcc_init(cnx, path_x, picoquic_coupledcc_olia);
+}
+
+static void picoquic_balia_init(picoquic_cnx_t* cnx, picoquic_path_t* path_x, char const* option_string, uint64_t current_time)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+    UNREFERENCED_PARAMETER(option_string);
+#endif
+    picoquic_coupledcc_init(cnx, path_x, picoquic_coupledcc_balia);
+}
+
+/* Release the state of the congestion control algorithm */
+static void picoquic_coupledcc_delete(picoquic_path_t* path_x)
+{
+    if (path_x->congestion_alg_state != NULL) {
+        free(path_x->congestion_alg_state);
+        path_x->congestion_alg_state = NULL;
+    }
+}
+
+/* Observe the state of congestion control */
+static void picoquic_coupledcc_observe(picoquic_path_t* path_x, uint64_t* cc_state, uint64_t* cc_param)
+{
+    picoquic_coupledcc_state_t* coupled_state = (picoquic_coupledcc_state_t*)path_x->congestion_alg_state;
+    *cc_state = (uint64_t)coupled_state->alg_state;
+    *cc_param = (coupled_state->ssthresh == UINT64_MAX) ? 0 : coupled_state->ssthresh;
+}
+
+/* Definition records for the coupled algorithms */
+
+picoquic_congestion_algorithm_t picoquic_lia_algorithm_struct = {
+    PICOQUIC_LIA_ID, PICOQUIC_CC_ALGO_NUMBER_LIA,
+    picoquic_lia_init,
+    picoquic_coupledcc_notify,
+    picoquic_coupledcc_delete,
+    picoquic_coupledcc_observe
+};
+
+picoquic_congestion_algorithm_t picoquic_olia_algorithm_struct = {
+    PICOQUIC_OLIA_ID, PICOQUIC_CC_ALGO_NUMBER_OLIA,
+    picoquic_olia_init,
+    picoquic_coupledcc_notify,
+    picoquic_coupledcc_delete,
+    picoquic_coupledcc_observe
+};
+
+picoquic_congestion_algorithm_t picoquic_balia_algorithm_struct = {
+    PICOQUIC_BALIA_ID, PICOQUIC_CC_ALGO_NUMBER_BALIA,
+    picoquic_balia_init,
+    picoquic_coupledcc_notify,
+    picoquic_coupledcc_delete,
+    picoquic_coupledcc_observe
+};
+
+picoquic_congestion_algorithm_t* picoquic_lia_algorithm = &picoquic_lia_algorithm_struct;
+picoquic_congestion_algorithm_t* picoquic_olia_algorithm = &picoquic_olia_algorithm_struct;
+picoquic_congestion_algorithm_t* picoquic_balia_algorithm = &picoquic_balia_algorithm_struct;
@@ -0,0 +1,264 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "datagram_ring.h"
+
+/* Zero length datagrams use one byte of the ring, so that the position
+ * of each entry in the byte ring is unique. */
+#define PICOQUIC_DATAGRAM_RING_ALLOC(length) (((length) == 0) ? 1 : (length))
+
+static picoquic_datagram_ring_entry_t* picoquic_datagram_ring_entry(picoquic_datagram_ring_t* ring, size_t rank)
+{
+    return &ring->entries[(ring->first_entry + rank) % ring->entries_max];
+}
+
+/* Copy the queued datagrams in new rings of the specified sizes, which
+ * must be large enough to hold them. */
+static int picoquic_datagram_ring_resize(picoquic_datagram_ring_t* ring, size_t entries_max, size_t buffer_size)
+{
+    int ret = 0;
+    picoquic_datagram_ring_entry_t* entries = (picoquic_datagram_ring_entry_t*)malloc(entries_max * sizeof(picoquic_datagram_ring_entry_t));
+    uint8_t* buffer = (uint8_t*)malloc(buffer_size);
+
+    if (entries == NULL || buffer == NULL) {
+        if (entries != NULL) {
+            free(entries);
+        }
+        if (buffer != NULL) {
+            free(buffer);
+        }
+        ret = -1;
+    }
+    else {
+        size_t offset = 0;
+
+        for (size_t i = 0; i < ring->nb_entries; i++) {
+            picoquic_datagram_ring_entry_t* old_entry = picoquic_datagram_ring_entry(ring, i);
+
+            entries[i] = *old_entry;
+            entries[i].offset = offset;
+            memcpy(buffer + offset, ring->buffer + old_entry->offset, old_entry->length);
+            offset += PICOQUIC_DATAGRAM_RING_ALLOC(old_entry->length);
+        }
+        if (ring->entries != NULL) {
+            free(ring->entries);
+        }
+        if (ring->buffer != NULL) {
+            free(ring->buffer);
+        }
+        ring->entries = entries;
+        ring->entries_max = entries_max;
+        ring->first_entry = 0;
+        ring->buffer = buffer;
+        ring->buffer_size = buffer_size;
+    }
+
+    return ret;
+}
+
+static void picoquic_datagram_ring_remove_first(picoquic_datagram_ring_t* ring)
+{
+    ring->nb_bytes -= PICOQUIC_DATAGRAM_RING_ALLOC(ring->entries[ring->first_entry].length);
+    ring->first_entry = (ring->first_entry + 1) % ring->entries_max;
+    ring->nb_entries--;
+    if (ring->nb_entries == 0) {
+        ring->first_entry = 0;
+    }
+}
+
+/* Find a contiguous space for the data of a new entry, after the last
+ * entry or, if that does not fit, at the beginning of the byte ring. */
+static int picoquic_datagram_ring_find_space(picoquic_datagram_ring_t* ring, size_t alloc, size_t* offset)
+{
+    int ret = -1;
+
+    if (ring->nb_entries >= ring->entries_max) {
+        ret = -1;
+    }
+    else if (ring->nb_entries == 0) {
+        if (alloc <= ring->buffer_size) {
+            *offset = 0;
+            ret = 0;
+        }
+    }
+    else {
+        size_t head = ring->entries[ring->first_entry].offset;
+        picoquic_datagram_ring_entry_t* last = picoquic_datagram_ring_entry(ring, ring->nb_entries - 1);
+        size_t tail = last->offset + PICOQUIC_DATAGRAM_RING_ALLOC(last->length);
+
+        if (last->offset >= head) {
+            if (ring->buffer_size - tail >= alloc) {
+                *offset = tail;
+                ret = 0;
+            }
+            else if (head >= alloc) {
+                *offset = 0;
+                ret = 0;
+            }
+        }
+        else if (head - tail >= alloc) {
+            *offset = tail;
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_datagram_ring_set_limits(picoquic_datagram_ring_t* ring, size_t max_entries, size_t max_bytes)
+{
+    int ret = 0;
+
+    ring->max_entries_limit = max_entries;
+    ring->max_bytes_limit = max_bytes;
+
+    if (max_entries > 0 || max_bytes > 0) {
+        /* Allocate the rings at the maximum size, dropping the oldest
+         * datagrams if they do not fit. */
+        size_t entries_max = (max_entries > 0) ? max_entries : ring->entries_max;
+        size_t buffer_size = (max_bytes > 0) ? max_bytes : ring->buffer_size;
+
+        if (entries_max < PICOQUIC_DATAGRAM_RING_ENTRIES_MIN && max_entries == 0) {
+            entries_max = PICOQUIC_DATAGRAM_RING_ENTRIES_MIN;
+        }
+        if (buffer_size < PICOQUIC_DATAGRAM_RING_BYTES_MIN && max_bytes == 0) {
+            buffer_size = PICOQUIC_DATAGRAM_RING_BYTES_MIN;
+        }
+        while (ring->nb_entries > entries_max || ring->nb_bytes > buffer_size) {
+            picoquic_datagram_ring_remove_first(ring);
+            ring->nb_overflow++;
+        }
+        ret = picoquic_datagram_ring_resize(ring, entries_max, buffer_size);
+    }
+
+    return ret;
+}
+
+uint8_t* picoquic_datagram_ring_push(picoquic_datagram_ring_t* ring, size_t length, uint64_t queue_time, uint64_t deadline)
+{
+    uint8_t* data = NULL;
+    size_t alloc = PICOQUIC_DATAGRAM_RING_ALLOC(length);
+    size_t offset = 0;
+
+    while (picoquic_datagram_ring_find_space(ring, alloc, &offset) != 0) {
+        if (ring->nb_entries >= ring->entries_max &&
+            (ring->max_entries_limit == 0 || ring->entries_max < ring->max_entries_limit)) {
+            size_t entries_max = (ring->entries_max < PICOQUIC_DATAGRAM_RING_ENTRIES_MIN) ?
+                PICOQUIC_DATAGRAM_RING_ENTRIES_MIN : 2 * ring->entries_max;
+            if (ring->max_entries_limit > 0 && entries_max > ring->max_entries_limit) {
+                entries_max = ring->max_entries_limit;
+            }
+            if (picoquic_datagram_ring_resize(ring, entries_max, ring->buffer_size) != 0) {
+                return NULL;
+            }
+        }
+        else if (ring->nb_entries < ring->entries_max &&
+            (ring->max_bytes_limit == 0 || ring->buffer_size < ring->max_bytes_limit)) {
+            size_t buffer_size = (ring->buffer_size < PICOQUIC_DATAGRAM_RING_BYTES_MIN) ?
+                PICOQUIC_DATAGRAM_RING_BYTES_MIN : 2 * ring->buffer_size;
+            while (buffer_size < ring->nb_bytes + alloc) {
+                buffer_size *= 2;
+            }
+            if (ring->max_bytes_limit > 0 && buffer_size > ring->max_bytes_limit) {
+                buffer_size = ring->max_bytes_limit;
+            }
+            if (picoquic_datagram_ring_resize(ring, ring->entries_max, buffer_size) != 0) {
+                return NULL;
+            }
+        }
+        else if (ring->nb_entries > 0) {
+            /* The rings are at their maximum size. Drop the oldest datagram. */
+            picoquic_datagram_ring_remove_first(ring);
+            ring->nb_overflow++;
+        }
+        else {
+            /* The datagram is larger than the maximum size of the byte ring */
+            return NULL;
+        }
+    }
+
+    if (ring->entries_max > 0) {
+        picoquic_datagram_ring_entry_t* entry = &ring->entries[(ring->first_entry + ring->nb_entries) % ring->entries_max];
+
+        entry->queue_time = queue_time;
+        entry->deadline = deadline;
+        entry->offset = offset;
+        entry->length = length;
+        ring->nb_entries++;
+        ring->nb_bytes += alloc;
+        ring->nb_queued++;
+        data = ring->buffer + offset;
+    }
+
+    return data;
+}
+
+picoquic_datagram_ring_entry_t* picoquic_datagram_ring_first(picoquic_datagram_ring_t* ring, uint64_t current_time)
+{
+    picoquic_datagram_ring_entry_t* entry = NULL;
+
+    while (ring->nb_entries > 0) {
+        entry = &ring->entries[ring->first_entry];
+        if (entry->deadline >= current_time) {
+            break;
+        }
+        /* Expired datagrams are dropped without being sent */
+        picoquic_datagram_ring_remove_first(ring);
+        ring->nb_expired++;
+        entry = NULL;
+    }
+
+    return entry;
+}
+
+uint8_t* picoquic_datagram_ring_data(picoquic_datagram_ring_t* ring, picoquic_datagram_ring_entry_t* entry)
+{
+    return ring->buffer + entry->offset;
+}
+
+void picoquic_datagram_ring_pop(picoquic_datagram_ring_t* ring, uint64_t current_time)
+{
+    if (ring->nb_entries > 0) {
+        uint64_t queue_time = ring->entries[ring->first_entry].queue_time;
+        uint64_t delay = (current_time > queue_time) ? current_time - queue_time : 0;
+
+        ring->queue_delay_total += delay;
+        if (delay > ring->queue_delay_max) {
+            ring->queue_delay_max = delay;
+        }
+        ring->nb_sent++;
+        picoquic_datagram_ring_remove_first(ring);
+    }
+}
+
+void picoquic_datagram_ring_release(picoquic_datagram_ring_t* ring)
+{
+    if (ring->entries != NULL) {
+        free(ring->entries);
+    }
+    if (ring->buffer != NULL) {
+        free(ring->buffer);
+    }
+    memset(ring, 0, sizeof(picoquic_datagram_ring_t));
+}
@@ -0,0 +1,93 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PICOQUIC_DATAGRAM_RING_H
+#define PICOQUIC_DATAGRAM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Datagram send ring.
+ *
+ * Datagrams queued by the application are copied in a byte ring, and
+ * described by a ring of entries holding the offset and length of the
+ * data, the time at which the datagram was queued and the deadline
+ * after which it shall not be sent anymore. Both rings are allocated
+ * once and grow by doubling when needed, so that queuing a datagram
+ * does not require a memory allocation.
+ *
+ * If limits are set, the rings do not grow beyond them. The oldest
+ * datagrams are dropped to make room for new ones, which is the right
+ * policy for real time data.
+ *
+ * The data of each datagram is contiguous in the byte ring. Datagrams
+ * are removed in order from the head of the ring, either when sent or
+ * when their deadline has passed.
+ *
+ * A ring set to all zeroes is empty and ready for use.
+ */
+#define PICOQUIC_DATAGRAM_RING_ENTRIES_MIN 64
+#define PICOQUIC_DATAGRAM_RING_BYTES_MIN 16384
+#define PICOQUIC_DATAGRAM_NO_DEADLINE UINT64_MAX
+
+typedef struct st_picoquic_datagram_ring_entry_t {
+    uint64_t queue_time;
+    uint64_t deadline;
+    size_t offset;
+    size_t length;
+} picoquic_datagram_ring_entry_t;
+
+typedef struct st_picoquic_datagram_ring_t {
+    uint8_t* buffer;
+    size_t buffer_size;
+    picoquic_datagram_ring_entry_t* entries;
+    size_t entries_max;
+    size_t first_entry;
+    size_t nb_entries;
+    size_t nb_bytes;
+    size_t max_entries_limit; /* 0 if no limit */
+    size_t max_bytes_limit; /* 0 if no limit */
+    /* Statistics */
+    uint64_t nb_queued;
+    uint64_t nb_sent;
+    uint64_t nb_expired;
+    uint64_t nb_overflow;
+    uint64_t queue_delay_total;
+    uint64_t queue_delay_max;
+} picoquic_datagram_ring_t;
+
+int picoquic_datagram_ring_set_limits(picoquic_datagram_ring_t* ring, size_t max_entries, size_t max_bytes);
+uint8_t* picoquic_datagram_ring_push(picoquic_datagram_ring_t* ring, size_t length, uint64_t queue_time, uint64_t deadline);
+picoquic_datagram_ring_entry_t* picoquic_datagram_ring_first(picoquic_datagram_ring_t* ring, uint64_t current_time);
+uint8_t* picoquic_datagram_ring_data(picoquic_datagram_ring_t* ring, picoquic_datagram_ring_entry_t* entry);
+void picoquic_datagram_ring_pop(picoquic_datagram_ring_t* ring, uint64_t current_time);
+void picoquic_datagram_ring_release(picoquic_datagram_ring_t* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_DATAGRAM_RING_H */
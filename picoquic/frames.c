@@ -245,15 +245,7 @@ uint8_t * picoquic_format_stream_reset_frame(picoquic_cnx_t* cnx, picoquic_strea
             picoquic_update_max_stream_ID_local(cnx, stream);
 
             /* Free the queued data */
-            while (stream->send_queue != NULL) {
-                picoquic_stream_queue_node_t* next = stream->send_queue->next_stream_data;
-
-                if (stream->send_queue->bytes != NULL) {
-                    free(stream->send_queue->bytes);
-                }
-                free(stream->send_queue);
-                stream->send_queue = next;
-            }
+            picoquic_stream_clear_send_data(stream);
             (void)picoquic_delete_stream_if_closed(cnx, stream);
         }
         else {
@@ -1050,6 +1042,60 @@ int picoquic_parse_stream_header(const uint8_t* bytes, size_t bytes_max,
     return ret;
 }
 
+/* Stream references replace stream frames in the compact records of sent
+ * packets. They are never sent on the wire. The format is the frame type,
+ * stream ID, offset and data length encoded as varints, then the FIN bit.
+ */
+int picoquic_is_stream_ref_frame(const uint8_t* bytes, size_t bytes_max)
+{
+    uint64_t ftype = 0;
+
+    return (picoquic_frames_varint_decode(bytes, bytes + bytes_max, &ftype) != NULL &&
+        ftype == picoquic_frame_type_stream_ref);
+}
+
+uint8_t* picoquic_format_stream_ref_frame(uint8_t* bytes, uint8_t* bytes_max,
+    uint64_t stream_id, uint64_t offset, size_t data_length, int fin)
+{
+    if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, picoquic_frame_type_stream_ref)) != NULL &&
+        (bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id)) != NULL &&
+        (bytes = picoquic_frames_varint_encode(bytes, bytes_max, offset)) != NULL &&
+        (bytes = picoquic_frames_varint_encode(bytes, bytes_max, data_length)) != NULL) {
+        bytes = picoquic_frames_uint8_encode(bytes, bytes_max, (uint8_t)(fin != 0));
+    }
+
+    return bytes;
+}
+
+int picoquic_parse_stream_ref_frame(const uint8_t* bytes, size_t bytes_max,
+    uint64_t* stream_id, uint64_t* offset, size_t* data_length, int* fin,
+    size_t* consumed)
+{
+    const uint8_t* bytes_end = bytes + bytes_max;
+    const uint8_t* bytes_next;
+    uint64_t ftype = 0;
+    uint64_t length = 0;
+    uint8_t fin_byte = 0;
+
+    if ((bytes_next = picoquic_frames_varint_decode(bytes, bytes_end, &ftype)) != NULL &&
+        (bytes_next = picoquic_frames_varint_decode(bytes_next, bytes_end, stream_id)) != NULL &&
+        (bytes_next = picoquic_frames_varint_decode(bytes_next, bytes_end, offset)) != NULL &&
+        (bytes_next = picoquic_frames_varint_decode(bytes_next, bytes_end, &length)) != NULL) {
+        bytes_next = picoquic_frames_uint8_decode(bytes_next, bytes_end, &fin_byte);
+    }
+
+    if (bytes_next == NULL || ftype != picoquic_frame_type_stream_ref) {
+        *consumed = bytes_max;
+        *data_length = 0;
+        return -1;
+    }
+
+    *data_length = (size_t)length;
+    *fin = fin_byte;
+    *consumed = bytes_next - bytes;
+    return 0;
+}
+
 static void picoquic_stream_data_chunk_callback(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream,
     const uint8_t * bytes, size_t data_length)
 {
@@ -1098,7 +1144,20 @@ static int add_chunk_node(picoquic_quic_t * quic, picosplay_tree_t* tree, uint64
 
     picoquic_stream_data_node_t* node = received_data;
     
-    if (received_data == NULL || received_data->bytes != NULL || !is_last_frame) {
+    if (received_data != NULL && quic->use_zero_copy_receive) {
+        /* The chunk points inside the received data packet, which
+         * remains allocated until all its chunks are consumed. */
+        node = picoquic_stream_data_ref_alloc(received_data);
+        if (node == NULL) {
+            ret = PICOQUIC_ERROR_MEMORY;
+        }
+        else {
+            node->bytes = bytes;
+            node->offset = offset;
+            node->length = length;
+        }
+    }
+    else if (received_data == NULL || received_data->bytes != NULL || !is_last_frame) {
         node = picoquic_stream_data_node_alloc(quic);
         if (node == NULL) {
             ret = PICOQUIC_ERROR_MEMORY;
@@ -1343,26 +1402,29 @@ const uint8_t* picoquic_decode_stream_frame(picoquic_cnx_t* cnx, const uint8_t*
     return bytes;
 }
 
+/* Find the next stream that can send.
+ * The output list is ordered by priority level, and within each level either
+ * by stream ID (FIFO, odd priorities) or by time of last data sent (round
+ * robin, even priorities). The first stream that has data to send is thus
+ * the right choice, and the search stops there. Streams that have nothing to
+ * send are removed from the list on the way, and inserted again when the
+ * application provides data, marks them active, or resets them.
+ */
 picoquic_stream_head_t* picoquic_find_ready_stream_path(picoquic_cnx_t* cnx, picoquic_path_t * path_x)
 {
-    picoquic_stream_head_t* first_stream = cnx->first_output_stream;
-    picoquic_stream_head_t* stream = first_stream;
+    picoquic_stream_head_t* stream = cnx->first_output_stream;
     picoquic_stream_head_t* found_stream = NULL;
 
-
     /* Look for a ready stream */
     while (stream != NULL) {
         int has_data = 0;
+        int has_pending = 0;
         picoquic_stream_head_t* next_stream = stream->next_output_stream;
 
-        if (found_stream != NULL && stream->stream_priority > found_stream->stream_priority) {
-            /* All the streams at that priority level have been examined,
-             * the current selection is validated */
-            break;
-        }
-        has_data = (cnx->maxdata_remote > cnx->data_sent && stream->sent_offset < stream->maxdata_remote && (stream->is_active ||
-                (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset) ||
-                (stream->fin_requested && !stream->fin_sent)));
+        has_pending = (stream->is_active ||
+            (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset));
+        has_data = (cnx->maxdata_remote > cnx->data_sent && stream->sent_offset < stream->maxdata_remote &&
+            (has_pending || (stream->fin_requested && !stream->fin_sent)));
         if (has_data && path_x != NULL && stream->affinity_path != path_x && stream->affinity_path != NULL) {
             /* Only consider the streams that meet path affinity requirements */
             has_data = 0;
@@ -1382,15 +1444,21 @@ picoquic_stream_head_t* picoquic_find_ready_stream_path(picoquic_cnx_t* cnx, pic
                 }
             }
             if (has_data) {
-                /* Something can be sent */
-                if ((stream->stream_priority & 1) != 0) {
-                    /* This priority level requests FIFO processing, so we return the first available stream */
-                    found_stream = stream;
-                    break;
+                if (stream->is_output_head) {
+                    /* The stream was blocked by flow control and queued at the
+                     * head of its round robin level. Put it back in its place,
+                     * after the streams at the head, and resume the search
+                     * from the same position. */
+                    picoquic_stream_head_t* previous = stream->previous_output_stream;
+
+                    picoquic_reorder_output_stream(cnx, stream);
+                    next_stream = (previous == NULL) ? cnx->first_output_stream : previous->next_output_stream;
                 }
-                else if (found_stream == NULL || stream->last_time_data_sent < found_stream->last_time_data_sent) {
-                    /* Select this stream, but need to check if another stream should go before in round robin order */
+                else {
+                    /* Something can be sent. The stream is either the first
+                     * in FIFO order, or the one that waited longest. */
                     found_stream = stream;
+                    break;
                 }
             }
         }
@@ -1400,16 +1468,19 @@ picoquic_stream_head_t* picoquic_find_ready_stream_path(picoquic_cnx_t* cnx, pic
 
             picoquic_delete_stream_if_closed(cnx, stream);
         }
-        else {
-            if (stream->is_active ||
-                (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset)) {
-                if (stream->sent_offset >= stream->maxdata_remote) {
-                    cnx->stream_blocked = 1;
-                }
-                else if (cnx->maxdata_remote <= cnx->data_sent) {
-                    cnx->flow_blocked = 1;
-                }
+        else if (has_pending) {
+            if (stream->sent_offset >= stream->maxdata_remote) {
+                cnx->stream_blocked = 1;
+                /* Blocked streams move to the head of round robin levels */
+                picoquic_reorder_output_stream(cnx, stream);
             }
+            else if (cnx->maxdata_remote <= cnx->data_sent) {
+                cnx->flow_blocked = 1;
+            }
+        }
+        else if (!stream->fin_requested) {
+            /* Nothing to send until the application provides data */
+            picoquic_remove_output_stream(cnx, stream);
         }
         stream = next_stream;
     }
@@ -1718,6 +1789,7 @@ uint8_t * picoquic_format_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head
                     bytes = bytes0 + stream_data_context.byte_index + stream_data_context.length;
                     stream->sent_offset += stream_data_context.length;
                     stream->last_time_data_sent = picoquic_get_quic_time(cnx->quic);
+                    picoquic_reorder_output_stream(cnx, stream);
                     cnx->data_sent += stream_data_context.length;
 
                     if (stream_data_context.length > 0) {
@@ -1778,14 +1850,12 @@ uint8_t * picoquic_format_stream_frame(picoquic_cnx_t* cnx, picoquic_stream_head
 
                     stream->send_queue->offset += length;
                     if (stream->send_queue->offset >= stream->send_queue->length) {
-                        picoquic_stream_queue_node_t* next = stream->send_queue->next_stream_data;
-                        free(stream->send_queue->bytes);
-                        free(stream->send_queue);
-                        stream->send_queue = next;
+                        picoquic_stream_queue_node_sent(stream, stream->sent_offset + length);
                     }
 
                     stream->sent_offset += length;
                     stream->last_time_data_sent = picoquic_get_quic_time(cnx->quic);
+                    picoquic_reorder_output_stream(cnx, stream);
                     cnx->data_sent += length;
                 }
 
@@ -1949,22 +2019,34 @@ void picoquic_dequeue_data_repeat_packet(
 int picoquic_queue_data_repeat_adjust(picoquic_cnx_t* cnx, picoquic_packet_t* packet)
 {
     int ret = 0;
-    while (packet->data_repeat_frame < packet->length) {
+    size_t frames_end = PICOQUIC_PACKET_FRAMES_END(packet);
+    while (packet->data_repeat_frame < frames_end) {
         uint8_t* data_byte = packet->bytes + packet->data_repeat_frame;
-        if (*data_byte >= picoquic_frame_type_stream_range_min && *data_byte <= picoquic_frame_type_stream_range_max) {
+        int is_ref = picoquic_is_stream_ref_frame(data_byte, frames_end - packet->data_repeat_frame);
+        if (is_ref || (*data_byte >= picoquic_frame_type_stream_range_min && *data_byte <= picoquic_frame_type_stream_range_max)) {
             /* next frame is a stream data frame. Make sure that the pointers point to it,
             * and adjust the packet priority */
             size_t consumed;
             int fin;
+            int parse_ret;
 
             packet->data_repeat_priority = 0;
             packet->data_repeat_stream_id = 0;
             packet->data_repeat_stream_offset = 0;
             packet->data_repeat_stream_data_length = 0;
 
-            if (picoquic_parse_stream_header(data_byte, packet->length - packet->data_repeat_frame,
-                &packet->data_repeat_stream_id, &packet->data_repeat_stream_offset, 
-                &packet->data_repeat_stream_data_length, &fin, &consumed) == 0) {
+            if (is_ref) {
+                parse_ret = picoquic_parse_stream_ref_frame(data_byte, frames_end - packet->data_repeat_frame,
+                    &packet->data_repeat_stream_id, &packet->data_repeat_stream_offset,
+                    &packet->data_repeat_stream_data_length, &fin, &consumed);
+            }
+            else {
+                parse_ret = picoquic_parse_stream_header(data_byte, frames_end - packet->data_repeat_frame,
+                    &packet->data_repeat_stream_id, &packet->data_repeat_stream_offset,
+                    &packet->data_repeat_stream_data_length, &fin, &consumed);
+            }
+
+            if (parse_ret == 0) {
                 /* Find the stream and its priority */
                 picoquic_stream_head_t* stream = picoquic_find_stream(cnx, packet->data_repeat_stream_id);
                 if (stream == NULL) {
@@ -1983,7 +2065,7 @@ int picoquic_queue_data_repeat_adjust(picoquic_cnx_t* cnx, picoquic_packet_t* pa
         else {
             int forget_about_ack = 0;
             size_t consumed = 0;
-            if (picoquic_skip_frame(data_byte, packet->length - packet->data_repeat_frame, &consumed, &forget_about_ack) != 0) {
+            if (picoquic_skip_frame(data_byte, frames_end - packet->data_repeat_frame, &consumed, &forget_about_ack) != 0) {
                 /* Malformed frame, internal error! */
                 ret = -1;
                 break;
@@ -2006,7 +2088,7 @@ void picoquic_queue_data_repeat_packet(
         packet->data_repeat_frame = packet->offset;
         packet->data_repeat_index = packet->offset;
         if (picoquic_queue_data_repeat_adjust(cnx, packet) == 0 &&
-            packet->data_repeat_frame < packet->length) {
+            packet->data_repeat_frame < PICOQUIC_PACKET_FRAMES_END(packet)) {
             picosplay_insert(&cnx->queue_data_repeat_tree, packet);
             packet->is_queued_for_data_repeat = 1;
         }
@@ -2020,6 +2102,27 @@ picoquic_packet_t* picoquic_first_data_repeat_packet(picoquic_cnx_t* cnx)
     return first_packet;
 }
 
+/* Copy the data of a repeated stream frame, either from the packet copy,
+ * or from the stream if the packet record only holds a stream reference.
+ */
+static int picoquic_copy_stream_data_for_retransmit(picoquic_stream_head_t* stream,
+    const uint8_t* frame_bytes, uint64_t offset, size_t length, uint8_t* bytes)
+{
+    int ret = 0;
+
+    if (frame_bytes != NULL) {
+        memcpy(bytes, frame_bytes, length);
+    }
+    else if (stream == NULL) {
+        ret = -1;
+    }
+    else {
+        ret = picoquic_stream_copy_sent_data(stream, offset, length, bytes);
+    }
+
+    return ret;
+}
+
 /* Copy stream frame from packet to specified buffer, and update the
  * packet retransmission pointers
  */
@@ -2028,15 +2131,24 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
     uint8_t* bytes_next, uint8_t* bytes_max)
 {
     uint8_t* frame = packet->bytes + packet->data_repeat_frame;
-    size_t frame_length_max = packet->length - packet->data_repeat_frame;
+    size_t frame_length_max = PICOQUIC_PACKET_FRAMES_END(packet) - packet->data_repeat_frame;
     uint64_t stream_id;
     uint64_t offset;
     size_t data_length;
     size_t consumed;
     size_t bytes_not_sent = 0;
     int fin;
+    int is_ref = picoquic_is_stream_ref_frame(frame, frame_length_max);
+    int parse_ret;
 
-    if (picoquic_parse_stream_header(frame, frame_length_max, &stream_id, &offset, &data_length, &fin, &consumed) != 0) {
+    if (is_ref) {
+        parse_ret = picoquic_parse_stream_ref_frame(frame, frame_length_max, &stream_id, &offset, &data_length, &fin, &consumed);
+    }
+    else {
+        parse_ret = picoquic_parse_stream_header(frame, frame_length_max, &stream_id, &offset, &data_length, &fin, &consumed);
+    }
+
+    if (parse_ret != 0) {
         /* Malformed stream frame. Error. */
         bytes_next = NULL;
     }
@@ -2044,19 +2156,26 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
         uint8_t* bytes_first = bytes_next;
         /* Need to find out how much is really available, based on the index in the packet */
         size_t data_available = data_length;
-        uint8_t* frame_bytes = frame + consumed;
+        /* Stream references do not carry the data, which is retained in the stream */
+        size_t frame_size = consumed + ((is_ref) ? 0 : data_length);
+        uint8_t* frame_bytes = (is_ref) ? NULL : frame + consumed;
+        picoquic_stream_head_t* stream = NULL;
         int is_needed = 1;
         if (packet->data_repeat_index > packet->data_repeat_frame + consumed) {
             size_t already_sent = packet->data_repeat_index - packet->data_repeat_frame - consumed;
             if (already_sent <= data_length) {
                 offset += already_sent;
-                frame_bytes += already_sent;
+                if (frame_bytes != NULL) {
+                    frame_bytes += already_sent;
+                }
                 data_available -= already_sent;
             }
             else {
                 /* This is really an internal error! */
                 offset += data_length;
-                frame_bytes += data_length;
+                if (frame_bytes != NULL) {
+                    frame_bytes += data_length;
+                }
                 data_available = 0;
             }
         }
@@ -2068,7 +2187,7 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
          * also no need to send the frame again.
          */
         if (cnx != NULL) {
-            picoquic_stream_head_t* stream = picoquic_find_stream(cnx, stream_id);
+            stream = picoquic_find_stream(cnx, stream_id);
             if (stream == NULL || stream->reset_sent || 
                 picoquic_check_sack_list(&stream->sack_list, offset, offset + data_available - ((fin) ? 0 : 1))) {
                 /* That frame is not needed anymore */
@@ -2092,8 +2211,12 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
                     /* Can encode everything in a natural way */
                     *bytes_first |= 2; /* length is present */
                     *bytes_first |= fin; /* fin OK */
-                    memcpy(bytes_next, frame_bytes, data_available);
-                    bytes_next += data_available;
+                    if (picoquic_copy_stream_data_for_retransmit(stream, frame_bytes, offset, data_available, bytes_next) != 0) {
+                        bytes_next = NULL;
+                    }
+                    else {
+                        bytes_next += data_available;
+                    }
                 }
                 else if (before_length + data_available <= bytes_max) {
                     /* everything fits if we remove the length, but we may need to insert initial padding */
@@ -2108,8 +2231,12 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
                         }
                         bytes_next += pad_required;
                     }
-                    memcpy(bytes_next, frame_bytes, data_available);
-                    bytes_next += data_available;
+                    if (picoquic_copy_stream_data_for_retransmit(stream, frame_bytes, offset, data_available, bytes_next) != 0) {
+                        bytes_next = NULL;
+                    }
+                    else {
+                        bytes_next += data_available;
+                    }
                 }
                 else {
                     /* buffer is too short -- do not send the FIN bit, do not set the length, just copy bytes */
@@ -2118,24 +2245,27 @@ uint8_t* picoquic_copy_stream_frame_for_retransmit(
                         bytes_not_sent = data_available;
                         bytes_next = bytes_first;
                     }
+                    else if (picoquic_copy_stream_data_for_retransmit(stream, frame_bytes, offset, available, before_length) != 0) {
+                        bytes_next = NULL;
+                    }
                     else {
-                        bytes_next = before_length;
-                        memcpy(bytes_next, frame_bytes, available);
-                        bytes_next += available;
+                        bytes_next = before_length + available;
                         bytes_not_sent = data_available - available;
                     }
                 }
             }
         }
 
-        if (bytes_not_sent == 0) {
-            /* Progress frame index to next byte after data frame */
-            packet->data_repeat_index = packet->data_repeat_frame + consumed + data_length;
-            packet->data_repeat_frame = packet->data_repeat_index;
-        }
-        else if (bytes_not_sent < data_length) {
-            /* Progress index to next byte not sent */
-            packet->data_repeat_index = packet->data_repeat_frame + consumed + data_length - bytes_not_sent;
+        if (bytes_next != NULL) {
+            if (bytes_not_sent == 0) {
+                /* Progress frame index to next byte after data frame */
+                packet->data_repeat_index = packet->data_repeat_frame + frame_size;
+                packet->data_repeat_frame = packet->data_repeat_index;
+            }
+            else if (bytes_not_sent < data_length) {
+                /* Progress index to next byte not sent */
+                packet->data_repeat_index = packet->data_repeat_frame + consumed + data_length - bytes_not_sent;
+            }
         }
     }
 
@@ -2162,10 +2292,12 @@ uint8_t* picoquic_copy_single_stream_frame_for_retransmit(picoquic_cnx_t* cnx, p
     /* Assume that the "data_repeat_frame" and "data_repeat_index are
     * properly initialized when the packet is placed in the queue */
     size_t last_frame = packet->data_repeat_frame;
-    if (packet->data_repeat_frame < packet->length) {
+    size_t frames_end = PICOQUIC_PACKET_FRAMES_END(packet);
+    if (packet->data_repeat_frame < frames_end) {
         /* Copy the current stream frame. */
         uint8_t* data_byte = packet->bytes + packet->data_repeat_frame;
-        if (*data_byte >= picoquic_frame_type_stream_range_min && *data_byte <= picoquic_frame_type_stream_range_max) {
+        if ((*data_byte >= picoquic_frame_type_stream_range_min && *data_byte <= picoquic_frame_type_stream_range_max) ||
+            picoquic_is_stream_ref_frame(data_byte, frames_end - packet->data_repeat_frame)) {
             /* next frame is a stream data frame. Try to add its content */
             uint8_t* bytes_first = bytes_next;
             bytes_next = picoquic_copy_stream_frame_for_retransmit(cnx, packet, bytes_next, bytes_max);
@@ -2176,13 +2308,13 @@ uint8_t* picoquic_copy_single_stream_frame_for_retransmit(picoquic_cnx_t* cnx, p
         }
     }
     /* Adjust to the next stream data boundary */
-    if (packet->data_repeat_frame < packet->length &&
+    if (packet->data_repeat_frame < frames_end &&
         picoquic_queue_data_repeat_adjust(cnx, packet) != 0) {
         /* signal an error */
         bytes_next = NULL;
     }
     /* Check whether the packet is completely processed, and can be dequeued */
-    if (packet->data_repeat_frame >= packet->length) {
+    if (packet->data_repeat_frame >= frames_end) {
         /* Nothing left in this pasket. It can be safely dequeued */
         picoquic_dequeue_data_repeat_packet(cnx, packet);
         *packet_dequeued = 1;
@@ -2988,8 +3120,12 @@ static picoquic_packet_t* picoquic_find_acked_packet(picoquic_cnx_t* cnx, picoqu
         pkt_ctx->ack_of_ack_requested = 0;
         *is_new_ack = 1;
 
-        while (packet != NULL && packet->packet_next != NULL && packet->sequence_number < largest) {
-            packet = packet->packet_next;
+        if ((packet = picoquic_pn_index_find(pkt_ctx, largest)) == NULL || !packet->is_queued_for_retransmit) {
+            /* Not in the index, search the retransmit queue */
+            packet = pkt_ctx->pending_first;
+            while (packet != NULL && packet->packet_next != NULL && packet->sequence_number < largest) {
+                packet = packet->packet_next;
+            }
         }
     }
 
@@ -3168,12 +3304,19 @@ int picoquic_check_frame_needs_repeat(picoquic_cnx_t* cnx, const uint8_t* bytes,
     uint64_t max_stream_rank;
     picoquic_stream_head_t* stream = NULL;
     size_t consumed = 0;
+    int is_ref = picoquic_is_stream_ref_frame(bytes, bytes_max);
 
     *no_need_to_repeat = 0;
 
-    if (PICOQUIC_IN_RANGE(bytes[0], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-        ret = picoquic_parse_stream_header(bytes, bytes_max,
-            &stream_id, &offset, &data_length, &fin, &consumed);
+    if (is_ref || PICOQUIC_IN_RANGE(bytes[0], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+        if (is_ref) {
+            ret = picoquic_parse_stream_ref_frame(bytes, bytes_max,
+                &stream_id, &offset, &data_length, &fin, &consumed);
+        }
+        else {
+            ret = picoquic_parse_stream_header(bytes, bytes_max,
+                &stream_id, &offset, &data_length, &fin, &consumed);
+        }
 
         if (ret == 0) {
             stream = picoquic_find_stream(cnx, stream_id);
@@ -3426,12 +3569,17 @@ int picoquic_process_ack_of_stream_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
     uint64_t offset;
     picoquic_stream_head_t* stream = NULL;
 
-    /* skip stream frame */
-    ret = picoquic_parse_stream_header(bytes, bytes_max,
-        &stream_id, &offset, &data_length, &fin, consumed);
+    /* skip stream frame, or stream reference in compact packet records */
+    if (picoquic_is_stream_ref_frame(bytes, bytes_max)) {
+        ret = picoquic_parse_stream_ref_frame(bytes, bytes_max,
+            &stream_id, &offset, &data_length, &fin, consumed);
+    }
+    else if ((ret = picoquic_parse_stream_header(bytes, bytes_max,
+        &stream_id, &offset, &data_length, &fin, consumed)) == 0) {
+        *consumed += data_length;
+    }
 
     if (ret == 0) {
-        *consumed += data_length;
 
         /* record the ack range for the stream */
         stream = picoquic_find_stream(cnx, stream_id);
@@ -3439,6 +3587,10 @@ int picoquic_process_ack_of_stream_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
             (void)picoquic_update_sack_list(&stream->sack_list,
                 offset, offset + data_length - ((fin) ? 0 : 1), 0);
 
+            if (stream->release_queue != NULL) {
+                picoquic_stream_release_acked_buffers(stream);
+            }
+
             picoquic_delete_stream_if_closed(cnx, stream);
         }
     }
@@ -3456,6 +3608,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
     size_t byte_index;
     int frame_is_pure_ack = 0;
     size_t frame_length = 0;
+    size_t frames_end = PICOQUIC_PACKET_FRAMES_END(p);
 
     if (p->ptype == picoquic_packet_0rtt_protected) {
         cnx->nb_zero_rtt_acked++;
@@ -3463,9 +3616,9 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
 
     byte_index = p->offset;
 
-    while (ret == 0 && byte_index < p->length) {
+    while (ret == 0 && byte_index < frames_end) {
         uint64_t ftype;
-        size_t l_ftype = picoquic_varint_decode(&p->bytes[byte_index], p->length - byte_index, &ftype);
+        size_t l_ftype = picoquic_varint_decode(&p->bytes[byte_index], frames_end - byte_index, &ftype);
         if (l_ftype == 0) {
             break;
         }
@@ -3473,20 +3626,20 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
         switch (ftype) {
         case picoquic_frame_type_ack:
             ret = picoquic_process_ack_of_ack_frame(&cnx->ack_ctx[p->pc].sack_list,
-                &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+                &p->bytes[byte_index], frames_end - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_ack_ecn:
             ret = picoquic_process_ack_of_ack_frame(&cnx->ack_ctx[p->pc].sack_list,
-                &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+                &p->bytes[byte_index], frames_end - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_ack:
-            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_ack_ecn:
-            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+            ret = picoquic_process_ack_of_path_ack_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_handshake_done:
@@ -3494,68 +3647,69 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
             byte_index += l_ftype;
             break;
         case picoquic_frame_type_new_connection_id:
-            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], p->length - byte_index, 0, &frame_length);
+            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, 0, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_new_connection_id:
-            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], p->length - byte_index, 1, &frame_length);
+            ret = picoquic_process_ack_of_new_cid_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, 1, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_retire_connection_id:
-            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 0);
+            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length, 0);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_retire_connection_id:
-            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length, 1);
+            ret = picoquic_process_ack_of_retire_connection_id_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length, 1);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_crypto_hs:
-            ret = picoquic_process_ack_of_crypto_frame(cnx, &p->bytes[byte_index], p->length - byte_index, p->ptype, &frame_length);
+            ret = picoquic_process_ack_of_crypto_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, p->ptype, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_new_token:
             ret = picoquic_skip_frame(&p->bytes[byte_index],
-                p->length - byte_index, &frame_length, &frame_is_pure_ack);
+                frames_end - byte_index, &frame_length, &frame_is_pure_ack);
             byte_index += frame_length;
             cnx->is_new_token_acked = 1;
             break;
         case picoquic_frame_type_max_data:
-            ret = picoquic_process_ack_of_max_data_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_data_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_stream_data:
-            ret = picoquic_process_ack_of_max_stream_data_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_stream_data_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_streams_bidir:
         case picoquic_frame_type_max_streams_unidir:
-            ret = picoquic_process_ack_of_max_streams_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_streams_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_reset_stream:
-            ret = picoquic_process_ack_of_reset_stream_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_reset_stream_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_max_path_id:
-            ret = picoquic_process_ack_of_max_path_id_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_max_path_id_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_paths_blocked:
-            ret = picoquic_process_ack_of_paths_blocked_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_paths_blocked_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_path_cid_blocked:
-            ret = picoquic_process_ack_of_path_cid_blocked_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            ret = picoquic_process_ack_of_path_cid_blocked_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
             byte_index += frame_length;
             break;
         case picoquic_frame_type_observed_address_v4:
         case picoquic_frame_type_observed_address_v6:
-            ret = picoquic_process_ack_of_observed_address_frame(cnx, p->send_path, &p->bytes[byte_index], p->length - byte_index, ftype, &frame_length);
+            ret = picoquic_process_ack_of_observed_address_frame(cnx, p->send_path, &p->bytes[byte_index], frames_end - byte_index, ftype, &frame_length);
             byte_index += frame_length;
             break;
         default:
-            if (PICOQUIC_IN_RANGE(ftype, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-                ret = picoquic_process_ack_of_stream_frame(cnx, &p->bytes[byte_index], p->length - byte_index, &frame_length);
+            if (PICOQUIC_IN_RANGE(ftype, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max) ||
+                ftype == picoquic_frame_type_stream_ref) {
+                ret = picoquic_process_ack_of_stream_frame(cnx, &p->bytes[byte_index], frames_end - byte_index, &frame_length);
                 byte_index += frame_length;
                 if (p->send_path != NULL) {
                     if (p->send_time > p->send_path->last_time_acked_data_frame_sent) {
@@ -3574,7 +3728,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
                         uint8_t* content_bytes;
 
                         /* Parse and skip type and length */
-                        content_bytes = picoquic_decode_datagram_frame_header(&p->bytes[byte_index], &p->bytes[p->length],
+                        content_bytes = picoquic_decode_datagram_frame_header(&p->bytes[byte_index], &p->bytes[frames_end],
                             &frame_id, &content_length);
 
                         ret = (cnx->callback_fn)(cnx, p->send_time, content_bytes, (size_t)content_length,
@@ -3584,7 +3738,7 @@ void picoquic_process_ack_of_frames(picoquic_cnx_t* cnx, picoquic_packet_t* p,
                 }
 
                 ret = picoquic_skip_frame(&p->bytes[byte_index],
-                    p->length - byte_index, &frame_length, &frame_is_pure_ack);
+                    frames_end - byte_index, &frame_length, &frame_is_pure_ack);
                 byte_index += frame_length;
             }
             break;
@@ -3603,7 +3757,22 @@ static int picoquic_process_ack_range(
     /* Compare the range to the retransmit queue */
     while (p != NULL && range > 0) {
         if (p->sequence_number > highest) {
-            p = p->packet_previous;
+            /* Jump directly to the top of the range if it is queued,
+             * instead of walking through the packets in the gap */
+            picoquic_packet_t* p_top = picoquic_pn_index_find(pkt_ctx, highest);
+
+            p = (p_top != NULL && p_top->is_queued_for_retransmit) ? p_top : p->packet_previous;
+        } else if (p->sequence_number < highest) {
+            /* Skip the numbers of packets that are not queued */
+            uint64_t delta = highest - p->sequence_number;
+
+            if (delta >= range) {
+                range = 0;
+            }
+            else {
+                range -= delta;
+                highest = p->sequence_number;
+            }
         } else {
             if (p->sequence_number == highest) {
                 picoquic_packet_t* next = p->packet_previous;
@@ -5021,30 +5190,90 @@ uint8_t * picoquic_format_datagram_frame(uint8_t* bytes, uint8_t* bytes_max, int
     return bytes;
 }
 
-int picoquic_queue_datagram_frame(picoquic_cnx_t * cnx, size_t length, const uint8_t * src)
+/* Queued datagrams are copied in the datagram ring of the connection,
+ * and the datagram frames are formatted when the packets are prepared.
+ */
+static int picoquic_push_datagram(picoquic_cnx_t* cnx, size_t length, const uint8_t* src, uint64_t ttl, uint64_t current_time)
+{
+    int ret = 0;
+    uint64_t deadline = (ttl == 0 || ttl >= PICOQUIC_DATAGRAM_NO_DEADLINE - current_time) ?
+        PICOQUIC_DATAGRAM_NO_DEADLINE : current_time + ttl;
+    uint8_t* data = picoquic_datagram_ring_push(&cnx->datagram_ring, length, current_time, deadline);
+
+    if (data == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else if (length > 0) {
+        memcpy(data, src, length);
+    }
+
+    return ret;
+}
+
+int picoquic_queue_datagram_frame_ex(picoquic_cnx_t* cnx, size_t length, const uint8_t* src, uint64_t ttl)
 {
     int ret;
+
     if (length > PICOQUIC_DATAGRAM_QUEUE_MAX_LENGTH) {
         ret = PICOQUIC_ERROR_DATAGRAM_TOO_LONG;
     }
     else {
-        size_t consumed = 0;
-        uint8_t frame_buffer[PICOQUIC_MAX_PACKET_SIZE];
-        int more_data = 0;
-        int is_pure_ack = 1;
-        uint8_t* bytes_next = picoquic_format_datagram_frame(frame_buffer, frame_buffer + sizeof(frame_buffer), &more_data, &is_pure_ack, length, src);
+        uint64_t current_time = picoquic_get_quic_time(cnx->quic);
 
-        if ((consumed = bytes_next - frame_buffer) > 0) {
-            ret = picoquic_queue_misc_or_dg_frame(cnx, &cnx->first_datagram, &cnx->last_datagram,
-                frame_buffer, consumed, 0, picoquic_packet_context_application);
+        if ((ret = picoquic_push_datagram(cnx, length, src, ttl, current_time)) == 0) {
+            picoquic_reinsert_by_wake_time(cnx->quic, cnx, current_time);
         }
-        else {
-            ret = PICOQUIC_ERROR_FRAME_BUFFER_TOO_SMALL;
+    }
+    return ret;
+}
+
+int picoquic_queue_datagram_frame(picoquic_cnx_t * cnx, size_t length, const uint8_t * src)
+{
+    return picoquic_queue_datagram_frame_ex(cnx, length, src, 0);
+}
+
+int picoquic_queue_datagram_batch(picoquic_cnx_t* cnx, const picoquic_outgoing_datagram_t* datagrams, size_t nb_datagrams)
+{
+    int ret = 0;
+    uint64_t current_time = picoquic_get_quic_time(cnx->quic);
+
+    /* Check all datagrams before queuing any of them */
+    for (size_t i = 0; i < nb_datagrams; i++) {
+        if (datagrams[i].length > PICOQUIC_DATAGRAM_QUEUE_MAX_LENGTH) {
+            ret = PICOQUIC_ERROR_DATAGRAM_TOO_LONG;
+            break;
         }
     }
+
+    for (size_t i = 0; ret == 0 && i < nb_datagrams; i++) {
+        ret = picoquic_push_datagram(cnx, datagrams[i].length, datagrams[i].bytes, datagrams[i].ttl, current_time);
+    }
+
+    if (nb_datagrams > 0) {
+        picoquic_reinsert_by_wake_time(cnx->quic, cnx, current_time);
+    }
+
     return ret;
 }
 
+int picoquic_set_datagram_queue_limits(picoquic_cnx_t* cnx, size_t max_datagrams, size_t max_bytes)
+{
+    return (picoquic_datagram_ring_set_limits(&cnx->datagram_ring, max_datagrams, max_bytes) == 0) ? 0 : PICOQUIC_ERROR_MEMORY;
+}
+
+void picoquic_get_datagram_queue_stats(picoquic_cnx_t* cnx, picoquic_datagram_queue_stats_t* stats)
+{
+    picoquic_datagram_ring_t* ring = &cnx->datagram_ring;
+
+    stats->nb_queued = ring->nb_queued;
+    stats->nb_sent = ring->nb_sent;
+    stats->nb_expired = ring->nb_expired;
+    stats->nb_overflow = ring->nb_overflow;
+    stats->nb_waiting = ring->nb_entries;
+    stats->queue_delay_total = ring->queue_delay_total;
+    stats->queue_delay_max = ring->queue_delay_max;
+}
+
 uint8_t * picoquic_format_first_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
     uint8_t *bytes_max, int * more_data, int * is_pure_ack)
 {
@@ -5059,6 +5288,27 @@ uint8_t * picoquic_format_first_datagram_frame(picoquic_cnx_t* cnx, uint8_t* byt
     return bytes;
 }
 
+/* Format the first datagram in the ring, after dropping the datagrams
+ * whose deadline has passed.
+ */
+uint8_t* picoquic_format_first_queued_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
+    uint8_t* bytes_max, int* more_data, int* is_pure_ack, uint64_t current_time)
+{
+    picoquic_datagram_ring_entry_t* entry = picoquic_datagram_ring_first(&cnx->datagram_ring, current_time);
+
+    if (entry != NULL) {
+        uint8_t* bytes0 = bytes;
+
+        bytes = picoquic_format_datagram_frame(bytes, bytes_max, more_data, is_pure_ack,
+            entry->length, picoquic_datagram_ring_data(&cnx->datagram_ring, entry));
+        if (bytes > bytes0) {
+            picoquic_datagram_ring_pop(&cnx->datagram_ring, current_time);
+        }
+    }
+
+    return bytes;
+}
+
 /* Provide a datagram buffer for the length specified by the application.
  * The stack called with a pointer to the available space, which may extend
  * to the end of the packet. There are several interesting cases:
@@ -6959,6 +7209,15 @@ int picoquic_skip_frame(const uint8_t* bytes, size_t bytes_maxsize, size_t* cons
                     bytes = picoquic_skip_observed_address_frame(bytes, bytes_max, frame_id64);
                     *pure_ack = 0;
                     break;
+                case picoquic_frame_type_stream_ref:
+                    /* Only found in compact packet records */
+                    if ((bytes = picoquic_frames_varint_skip(bytes, bytes_max)) != NULL &&
+                        (bytes = picoquic_frames_varint_skip(bytes, bytes_max)) != NULL &&
+                        (bytes = picoquic_frames_varint_skip(bytes, bytes_max)) != NULL) {
+                        bytes = picoquic_frames_fixed_skip(bytes, bytes_max, 1);
+                    }
+                    *pure_ack = 0;
+                    break;
                 default:
                     /* Not implemented yet! */
                     bytes = NULL;
@@ -715,11 +715,12 @@ int picoquic_copy_before_retransmit(picoquic_packet_t * old_p,
     }
     else {
         /* Copy the relevant bytes from one packet to the next */
+        size_t frames_end = PICOQUIC_PACKET_FRAMES_END(old_p);
         byte_index = old_p->offset;
 
-        while (ret == 0 && byte_index < old_p->length) {
+        while (ret == 0 && byte_index < frames_end) {
             ret = picoquic_skip_frame(&old_p->bytes[byte_index],
-                old_p->length - byte_index, &frame_length, &frame_is_pure_ack);
+                frames_end - byte_index, &frame_length, &frame_is_pure_ack);
 
             /* Check whether the data was already acked, which may happen in
             * case of spurious retransmissions */
@@ -750,7 +751,8 @@ int picoquic_copy_before_retransmit(picoquic_packet_t * old_p,
             /* Prepare retransmission if needed */
             if (ret == 0) {
                 if (!frame_is_pure_ack) {
-                    if (PICOQUIC_IN_RANGE(old_p->bytes[byte_index], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
+                    if (PICOQUIC_IN_RANGE(old_p->bytes[byte_index], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max) ||
+                        picoquic_is_stream_ref_frame(&old_p->bytes[byte_index], frame_length)) {
                         * add_to_data_repeat_queue = 1;
                     }
                     else {
@@ -943,11 +945,12 @@ static int picoquic_is_packet_ack_eliciting(picoquic_packet_t * packet)
         if (!packet->is_ack_trap) {
             size_t frame_length = 0;
             size_t byte_index = packet->offset;
+            size_t frames_end = PICOQUIC_PACKET_FRAMES_END(packet);
 
-            while (byte_index < packet->length) {
+            while (byte_index < frames_end) {
                 int frame_is_pure_ack = 0;
                 if (picoquic_skip_frame(&packet->bytes[byte_index],
-                    packet->length - byte_index, &frame_length, &frame_is_pure_ack) != 0) {
+                    frames_end - byte_index, &frame_length, &frame_is_pure_ack) != 0) {
                     /* Malformed packet. Ignore it. Do not expect an ack */
                     break;
                 }
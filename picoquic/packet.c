@@ -31,6 +31,8 @@
 #include "picoquic_binlog.h"
 #include "picoquic_unified_log.h"
 #include "tls_api.h"
+#include "picotls.h"
+#include "picoquic_crypto_provider_api.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -516,6 +518,53 @@ uint64_t picoquic_get_packet_number64(uint64_t highest, uint64_t mask, uint32_t
 /*
  * Remove header protection 
  */
+static void picoquic_apply_header_protection_mask_incoming(
+    const uint8_t* bytes,
+    uint8_t* decrypted_bytes,
+    picoquic_packet_header* ph,
+    const uint8_t* mask_bytes,
+    unsigned int is_loss_bit_enabled_incoming,
+    uint64_t sack_list_last)
+{
+    uint8_t first_byte = bytes[0];
+    uint8_t first_mask = ((first_byte & 0x80) == 0x80) ? 0x0F : (is_loss_bit_enabled_incoming)?0x07:0x1F;
+    uint8_t pn_l;
+    uint32_t pn_val = 0;
+
+    memcpy(decrypted_bytes, bytes, ph->pn_offset);
+    /* Decode the first byte */
+    first_byte ^= (mask_bytes[0] & first_mask);
+    pn_l = (first_byte & 3) + 1;
+    ph->pnmask = (0xFFFFFFFFFFFFFFFFull);
+    decrypted_bytes[0] = first_byte;
+
+    /* Packet encoding is 1 to 4 bytes */
+    for (uint8_t i = 1; i <= pn_l; i++) {
+        pn_val <<= 8;
+        decrypted_bytes[ph->offset] = bytes[ph->offset]^mask_bytes[i];
+        pn_val += decrypted_bytes[ph->offset++];
+        ph->pnmask <<= 8;
+    }
+
+    ph->pn = pn_val;
+    ph->payload_length -= pn_l;
+    /* Only set the key phase byte if short header */
+    if (ph->ptype == picoquic_packet_1rtt_protected) {
+        ph->key_phase = ((first_byte >> 2) & 1);
+    }
+
+    /* Build a packet number to 64 bits */
+    ph->pn64 = picoquic_get_packet_number64(sack_list_last, ph->pnmask, ph->pn);
+
+    /* Check the reserved bits */
+    if ((first_byte & 0x80) == 0) {
+        ph->has_reserved_bit_set = !is_loss_bit_enabled_incoming && (first_byte & 0x18) != 0;
+    }
+    else{
+        ph->has_reserved_bit_set = (first_byte & 0x0c) != 0;
+    }
+}
+
 int picoquic_remove_header_protection_inner(
     uint8_t* bytes,
     size_t length,
@@ -548,44 +597,9 @@ int picoquic_remove_header_protection_inner(
         }
         else
         {   /* Decode */
-            uint8_t first_byte = bytes[0];
-            uint8_t first_mask = ((first_byte & 0x80) == 0x80) ? 0x0F : (is_loss_bit_enabled_incoming)?0x07:0x1F;
-            uint8_t pn_l;
-            uint32_t pn_val = 0;
-
-            memcpy(decrypted_bytes, bytes, ph->pn_offset);
             picoquic_pn_encrypt(pn_enc, bytes + sample_offset, mask_bytes, mask_bytes, mask_length);
-            /* Decode the first byte */
-            first_byte ^= (mask_bytes[0] & first_mask);
-            pn_l = (first_byte & 3) + 1;
-            ph->pnmask = (0xFFFFFFFFFFFFFFFFull);
-            decrypted_bytes[0] = first_byte;
-
-            /* Packet encoding is 1 to 4 bytes */
-            for (uint8_t i = 1; i <= pn_l; i++) {
-                pn_val <<= 8;
-                decrypted_bytes[ph->offset] = bytes[ph->offset]^mask_bytes[i];
-                pn_val += decrypted_bytes[ph->offset++];
-                ph->pnmask <<= 8;
-            }
-
-            ph->pn = pn_val;
-            ph->payload_length -= pn_l;
-            /* Only set the key phase byte if short header */
-            if (ph->ptype == picoquic_packet_1rtt_protected) {
-                ph->key_phase = ((first_byte >> 2) & 1);
-            }
-
-            /* Build a packet number to 64 bits */
-            ph->pn64 = picoquic_get_packet_number64(sack_list_last, ph->pnmask, ph->pn);
-
-            /* Check the reserved bits */
-            if ((first_byte & 0x80) == 0) {
-                ph->has_reserved_bit_set = !is_loss_bit_enabled_incoming && (first_byte & 0x18) != 0;
-            }
-            else{
-                ph->has_reserved_bit_set = (first_byte & 0x0c) != 0;
-            }
+            picoquic_apply_header_protection_mask_incoming(bytes, decrypted_bytes, ph, mask_bytes,
+                is_loss_bit_enabled_incoming, sack_list_last);
         }
     }
     else {
@@ -2041,6 +2055,192 @@ int  picoquic_incoming_not_decrypted(
     return buffered;
 }
 
+/*
+ * Batch processing of incoming datagrams.
+ * The short header packets of the batch are prepared before any of the
+ * datagrams is processed: consecutive datagrams with the same connection ID
+ * share a single connection lookup, the header protection masks are all
+ * computed in one pass, and the payloads are decrypted with a single call
+ * to the batched AEAD API. The datagrams are then processed in order. Since
+ * processing a packet may change the state of the connection, the prepared
+ * result is only used if the connection was not deleted, the key phase did
+ * not change and the packet number decodes to the same value. Otherwise, the
+ * datagram is processed as if it had been received alone.
+ */
+#define PICOQUIC_INCOMING_BATCH_MAX 64
+
+typedef struct st_picoquic_incoming_batch_entry_t {
+    picoquic_cnx_t* cnx;
+    picoquic_packet_header ph;
+    picoquic_stream_data_node_t* decrypted_data;
+    size_t decrypted_length;
+    unsigned int is_candidate : 1;
+    unsigned int is_decrypted : 1;
+} picoquic_incoming_batch_entry_t;
+
+static void picoquic_incoming_batch_prepare(picoquic_quic_t* quic, picoquic_incoming_datagram_t* datagrams,
+    picoquic_incoming_batch_entry_t* entries, size_t nb_datagrams)
+{
+    picoquic_connection_id_t cached_id = picoquic_null_connection_id;
+    picoquic_cnx_t* cached_cnx = NULL;
+    picoquic_local_cnxid_t* cached_l_cid = NULL;
+    uint8_t mask_bytes[PICOQUIC_INCOMING_BATCH_MAX][5];
+    picoquic_aead_decrypt_batch_entry_t aead_entries[PICOQUIC_INCOMING_BATCH_MAX];
+    size_t aead_index[PICOQUIC_INCOMING_BATCH_MAX];
+    size_t nb_aead = 0;
+
+    /* Find the connection of each short header packet */
+    for (size_t i = 0; i < nb_datagrams; i++) {
+        picoquic_incoming_datagram_t* datagram = &datagrams[i];
+        picoquic_incoming_batch_entry_t* entry = &entries[i];
+
+        memset(entry, 0, sizeof(picoquic_incoming_batch_entry_t));
+        if (quic->local_cnxid_length > 0 && datagram->length > (size_t)1 + quic->local_cnxid_length &&
+            datagram->length <= PICOQUIC_MAX_PACKET_SIZE && (datagram->bytes[0] & 0x80) == 0) {
+            picoquic_connection_id_t dest_id;
+            picoquic_cnx_t* cnx = NULL;
+            int is_cached;
+
+            (void)picoquic_parse_connection_id(datagram->bytes + 1, quic->local_cnxid_length, &dest_id);
+            is_cached = (cached_cnx != NULL && picoquic_compare_connection_id(&dest_id, &cached_id) == 0);
+            if (is_cached) {
+                cnx = cached_cnx;
+            }
+            if (picoquic_parse_packet_header(quic, datagram->bytes, datagram->length, datagram->addr_from,
+                &entry->ph, &cnx, 1) == 0 && cnx != NULL && entry->ph.ptype == picoquic_packet_1rtt_protected) {
+                if (is_cached) {
+                    entry->ph.l_cid = cached_l_cid;
+                }
+                else {
+                    cached_id = dest_id;
+                    cached_cnx = cnx;
+                    cached_l_cid = entry->ph.l_cid;
+                }
+                if (cnx->crypto_context[picoquic_epoch_1rtt].pn_dec != NULL &&
+                    cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt != NULL &&
+                    (!cnx->is_multipath_enabled || entry->ph.l_cid != NULL) &&
+                    entry->ph.pn_offset + 4 + picoquic_pn_iv_size(cnx->crypto_context[picoquic_epoch_1rtt].pn_dec) <= datagram->length) {
+                    entry->cnx = cnx;
+                    entry->is_candidate = 1;
+                }
+            }
+        }
+    }
+
+    /* Compute the header protection masks of all candidates */
+    for (size_t i = 0; i < nb_datagrams; i++) {
+        if (entries[i].is_candidate) {
+            memset(mask_bytes[i], 0, sizeof(mask_bytes[i]));
+            picoquic_pn_encrypt(entries[i].cnx->crypto_context[picoquic_epoch_1rtt].pn_dec,
+                datagrams[i].bytes + entries[i].ph.pn_offset + 4, mask_bytes[i], mask_bytes[i], sizeof(mask_bytes[i]));
+        }
+    }
+
+    /* Remove the header protection, and prepare the decryption of packets
+     * encrypted with the current key. */
+    for (size_t i = 0; i < nb_datagrams; i++) {
+        picoquic_incoming_batch_entry_t* entry = &entries[i];
+
+        if (entry->is_candidate) {
+            picoquic_cnx_t* cnx = entry->cnx;
+            picoquic_sack_list_t* sack_list = picoquic_sack_list_from_cnx_context(cnx, entry->ph.pc, entry->ph.l_cid);
+
+            if ((entry->decrypted_data = picoquic_stream_data_node_alloc(quic)) == NULL) {
+                entry->is_candidate = 0;
+                continue;
+            }
+            entry->decrypted_data->nb_references = 1;
+            picoquic_apply_header_protection_mask_incoming(datagrams[i].bytes, entry->decrypted_data->data, &entry->ph,
+                mask_bytes[i], cnx->is_loss_bit_enabled_incoming, picoquic_sack_list_last(sack_list));
+
+            if (entry->ph.key_phase == cnx->key_phase_dec) {
+                picoquic_aead_decrypt_batch_entry_t* aead_entry = &aead_entries[nb_aead];
+
+                aead_entry->output = entry->decrypted_data->data + entry->ph.offset;
+                aead_entry->input = datagrams[i].bytes + entry->ph.offset;
+                aead_entry->input_length = entry->ph.payload_length;
+                aead_entry->aad = entry->decrypted_data->data;
+                aead_entry->aad_length = entry->ph.offset;
+                aead_entry->sequence_number = entry->ph.pn64;
+                aead_entry->is_multipath = cnx->is_multipath_enabled;
+                aead_entry->path_id = (cnx->is_multipath_enabled) ? entry->ph.l_cid->path_id : 0;
+                aead_entry->aead_ctx = cnx->crypto_context[picoquic_epoch_1rtt].aead_decrypt;
+                aead_index[nb_aead++] = i;
+            }
+            else {
+                /* Key rotation is handled on the regular path */
+                picoquic_stream_data_node_release(entry->decrypted_data);
+                entry->decrypted_data = NULL;
+                entry->is_candidate = 0;
+            }
+        }
+    }
+
+    /* Decrypt all the prepared packets */
+    picoquic_aead_decrypt_batch(aead_entries, nb_aead);
+
+    for (size_t j = 0; j < nb_aead; j++) {
+        picoquic_incoming_batch_entry_t* entry = &entries[aead_index[j]];
+
+        if (aead_entries[j].decrypted_length <= aead_entries[j].input_length) {
+            entry->decrypted_length = aead_entries[j].decrypted_length;
+            entry->is_decrypted = 1;
+        }
+        else {
+            /* Failures, including stateless resets, are handled on the regular path */
+            picoquic_stream_data_node_release(entry->decrypted_data);
+            entry->decrypted_data = NULL;
+            entry->is_candidate = 0;
+        }
+    }
+}
+
+/* Check that a packet prepared in a batch can still be used after the
+ * previous datagrams of the batch were processed. */
+static int picoquic_incoming_batch_is_valid(picoquic_quic_t* quic, picoquic_incoming_batch_entry_t* entry,
+    uint64_t nb_cnx_removed)
+{
+    int is_valid = 0;
+
+    if (entry->is_decrypted && quic->nb_cnx_removed == nb_cnx_removed &&
+        entry->ph.key_phase == entry->cnx->key_phase_dec) {
+        picoquic_sack_list_t* sack_list = picoquic_sack_list_from_cnx_context(entry->cnx, entry->ph.pc, entry->ph.l_cid);
+
+        is_valid = (picoquic_get_packet_number64(picoquic_sack_list_last(sack_list), entry->ph.pnmask, entry->ph.pn) ==
+            entry->ph.pn64);
+    }
+
+    return is_valid;
+}
+
+/* Complete the decryption of a packet prepared in a batch, with the same
+ * side effects as picoquic_parse_header_and_decrypt */
+static int picoquic_incoming_batch_complete(picoquic_incoming_batch_entry_t* entry, size_t length,
+    picoquic_packet_header* ph, picoquic_cnx_t** pcnx, size_t* consumed)
+{
+    int ret = 0;
+    picoquic_cnx_t* cnx = entry->cnx;
+    picoquic_ack_context_t* ack_ctx = picoquic_ack_ctx_from_cnx_context(cnx, picoquic_packet_context_application, entry->ph.l_cid);
+
+    *ph = entry->ph;
+    *pcnx = cnx;
+    *consumed = length;
+
+    if (ph->pn64 < ack_ctx->crypto_rotation_sequence) {
+        ack_ctx->crypto_rotation_sequence = ph->pn64;
+    }
+
+    if (picoquic_is_pn_already_received(cnx, ph->pc, ph->l_cid, ph->pn64) != 0) {
+        ret = PICOQUIC_ERROR_DUPLICATE;
+    }
+    else {
+        ph->payload_length = (uint16_t)entry->decrypted_length;
+        cnx->nb_packets_batch_decrypted++;
+    }
+
+    return ret;
+}
+
 /*
 * Processing of the packet that was just received from the network.
 */
@@ -2058,7 +2258,8 @@ int picoquic_incoming_segment(
     uint64_t current_time,
     uint64_t receive_time,
     picoquic_connection_id_t* previous_dest_id,
-    picoquic_cnx_t** first_cnx)
+    picoquic_cnx_t** first_cnx,
+    picoquic_incoming_batch_entry_t* batch_entry)
 {
     int ret = 0;
     picoquic_cnx_t* cnx = NULL;
@@ -2069,14 +2270,25 @@ int picoquic_incoming_segment(
     int path_id = -1;
     int path_is_not_allocated = 0;
     uint8_t* bytes = NULL;
-    picoquic_stream_data_node_t* decrypted_data = picoquic_stream_data_node_alloc(quic);
+    picoquic_stream_data_node_t* decrypted_data = (batch_entry != NULL) ?
+        batch_entry->decrypted_data : picoquic_stream_data_node_alloc(quic);
 
     if (decrypted_data == NULL) {
         return -1;
     }
-    /* Parse the header and decrypt the segment */
-    ret = picoquic_parse_header_and_decrypt(quic, raw_bytes, length, packet_length, addr_from,
-        current_time, decrypted_data, &ph, &cnx, consumed, &new_context_created);
+    /* Hold a reference to the decrypted data while the segment is processed,
+     * so that it is not recycled if stream data pointing into it is
+     * consumed immediately. */
+    decrypted_data->nb_references = 1;
+    /* Parse the header and decrypt the segment, unless that was already
+     * done as part of a batch */
+    if (batch_entry != NULL) {
+        ret = picoquic_incoming_batch_complete(batch_entry, length, &ph, &cnx, consumed);
+    }
+    else {
+        ret = picoquic_parse_header_and_decrypt(quic, raw_bytes, length, packet_length, addr_from,
+            current_time, decrypted_data, &ph, &cnx, consumed, &new_context_created);
+    }
     bytes = decrypted_data->data;
 
     if (ret == 0 && cnx != NULL) {
@@ -2353,13 +2565,13 @@ int picoquic_incoming_segment(
     }
 
     if (decrypted_data != NULL && decrypted_data->bytes == NULL) {
-        picoquic_stream_data_node_recycle(decrypted_data);
+        picoquic_stream_data_node_release(decrypted_data);
     }
 
     return ret;
 }
 
-int picoquic_incoming_packet_ex(
+static int picoquic_incoming_datagram(
     picoquic_quic_t* quic,
     uint8_t* bytes,
     size_t packet_length,
@@ -2368,7 +2580,8 @@ int picoquic_incoming_packet_ex(
     int if_index_to,
     unsigned char received_ecn,
     picoquic_cnx_t** first_cnx,
-    uint64_t current_time)
+    uint64_t current_time,
+    picoquic_incoming_batch_entry_t* batch_entry)
 {
     size_t consumed_index = 0;
     int ret = 0;
@@ -2377,10 +2590,11 @@ int picoquic_incoming_packet_ex(
     while (consumed_index < packet_length) {
         size_t consumed = 0;
 
+        /* A batch entry is a short header packet, which is always the only segment */
         ret = picoquic_incoming_segment(quic, bytes + consumed_index, 
             packet_length - consumed_index, packet_length,
             &consumed, addr_from, addr_to, if_index_to, received_ecn, current_time, current_time,
-            &previous_destid, first_cnx);
+            &previous_destid, first_cnx, (consumed_index == 0) ? batch_entry : NULL);
 
         if (ret == 0) {
             consumed_index += consumed;
@@ -2401,6 +2615,68 @@ int picoquic_incoming_packet_ex(
     return ret;
 }
 
+int picoquic_incoming_packet_ex(
+    picoquic_quic_t* quic,
+    uint8_t* bytes,
+    size_t packet_length,
+    struct sockaddr* addr_from,
+    struct sockaddr* addr_to,
+    int if_index_to,
+    unsigned char received_ecn,
+    picoquic_cnx_t** first_cnx,
+    uint64_t current_time)
+{
+    return picoquic_incoming_datagram(quic, bytes, packet_length, addr_from, addr_to, if_index_to,
+        received_ecn, first_cnx, current_time, NULL);
+}
+
+int picoquic_incoming_packet_batch(
+    picoquic_quic_t* quic,
+    picoquic_incoming_datagram_t* datagrams,
+    size_t nb_datagrams,
+    picoquic_cnx_t** last_cnx,
+    uint64_t current_time)
+{
+    int ret = 0;
+    size_t first = 0;
+    picoquic_incoming_batch_entry_t entries[PICOQUIC_INCOMING_BATCH_MAX];
+
+    while (first < nb_datagrams) {
+        size_t nb_entries = nb_datagrams - first;
+        uint64_t nb_cnx_removed = quic->nb_cnx_removed;
+
+        if (nb_entries > PICOQUIC_INCOMING_BATCH_MAX) {
+            nb_entries = PICOQUIC_INCOMING_BATCH_MAX;
+        }
+        picoquic_incoming_batch_prepare(quic, datagrams + first, entries, nb_entries);
+
+        for (size_t i = 0; i < nb_entries; i++) {
+            picoquic_incoming_datagram_t* datagram = &datagrams[first + i];
+            picoquic_incoming_batch_entry_t* entry = &entries[i];
+            picoquic_cnx_t* first_cnx = NULL;
+            int datagram_ret;
+
+            if (entry->is_decrypted && !picoquic_incoming_batch_is_valid(quic, entry, nb_cnx_removed)) {
+                picoquic_stream_data_node_release(entry->decrypted_data);
+                entry->decrypted_data = NULL;
+                entry->is_decrypted = 0;
+            }
+            datagram_ret = picoquic_incoming_datagram(quic, datagram->bytes, datagram->length,
+                datagram->addr_from, datagram->addr_to, datagram->if_index_to, datagram->received_ecn,
+                &first_cnx, current_time, (entry->is_decrypted) ? entry : NULL);
+            if (ret == 0) {
+                ret = datagram_ret;
+            }
+            if (last_cnx != NULL) {
+                *last_cnx = first_cnx;
+            }
+        }
+        first += nb_entries;
+    }
+
+    return ret;
+}
+
 int picoquic_incoming_packet(
     picoquic_quic_t* quic,
     uint8_t* bytes,
@@ -2457,7 +2733,7 @@ void picoquic_process_sooner_packets(picoquic_cnx_t* cnx, uint64_t current_time)
                 ret = picoquic_incoming_segment(cnx->quic, packet->bytes + consumed_index,
                     packet->length - consumed_index, packet->length,
                     &consumed, (struct sockaddr*) & packet->addr_to, (struct sockaddr*) & packet->addr_local, packet->if_index_local,
-                    packet->received_ecn, current_time, packet->receive_time, &previous_destid, &first_cnx);
+                    packet->received_ecn, current_time, packet->receive_time, &previous_destid, &first_cnx, NULL);
 
                 if (ret == 0 && consumed > 0) {
                     consumed_index += consumed;
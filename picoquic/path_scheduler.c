@@ -0,0 +1,251 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "picoquic_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_path_scheduler.h"
+
+/* Multipath schedulers.
+ * The path selection code in "paths.c" marks the candidate paths and
+ * handles ACK, affinity and datagrams before calling the scheduler, see
+ * the description of picoquic_path_scheduler_t in picoquic.h. A path is
+ * "ready" if both pacing and congestion control allow sending on it.
+ */
+
+static int picoquic_path_scheduler_is_ready(picoquic_path_t* path_x)
+{
+    return path_x->is_scheduler_candidate && path_x->is_scheduler_pacing_ok && path_x->is_scheduler_cwin_ok;
+}
+
+/* Default scheduler: send on the ready path that was least recently used,
+ * which spreads the traffic over all paths in proportion of the rate at
+ * which congestion control opens their windows.
+ */
+static picoquic_path_t* picoquic_default_path_select(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_path_t* selected = NULL;
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+#endif
+
+    for (int path_index = 0; path_index < cnx->nb_paths; path_index++) {
+        picoquic_path_t* path_x = cnx->path[path_index];
+        if (picoquic_path_scheduler_is_ready(path_x) &&
+            (selected == NULL || path_x->last_sent_time < selected->last_sent_time)) {
+            selected = path_x;
+        }
+    }
+    return selected;
+}
+
+/* Min RTT scheduler: send on the ready path with the lowest smoothed RTT.
+ * Slower paths are only used when the congestion window of the faster
+ * paths is full.
+ */
+static picoquic_path_t* picoquic_minrtt_path_select(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_path_t* selected = NULL;
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+#endif
+
+    for (int path_index = 0; path_index < cnx->nb_paths; path_index++) {
+        picoquic_path_t* path_x = cnx->path[path_index];
+        if (picoquic_path_scheduler_is_ready(path_x) &&
+            (selected == NULL || path_x->smoothed_rtt < selected->smoothed_rtt ||
+            (path_x->smoothed_rtt == selected->smoothed_rtt && path_x->last_sent_time < selected->last_sent_time))) {
+            selected = path_x;
+        }
+    }
+    return selected;
+}
+
+/* Earliest Completion First scheduler.
+ * When the fastest path is ready, use it. If it is not, consider the fastest
+ * of the ready paths, and only use it if sending there would complete the
+ * transfer sooner than waiting for the fastest path to be available. This
+ * requires an estimate of the amount of data queued. The estimate counts the
+ * bytes queued on the output streams. If a stream is "active", i.e., if the
+ * application provides data on demand, the backlog is assumed to be large.
+ */
+#define PICOQUIC_ECF_BETA_INVERSE 4 /* beta = 0.25, hysteresis when waiting */
+
+static uint64_t picoquic_ecf_queued_bytes(picoquic_cnx_t* cnx, uint64_t bytes_max)
+{
+    uint64_t queued = 0;
+    picoquic_stream_head_t* stream = cnx->first_output_stream;
+
+    while (stream != NULL && queued < bytes_max) {
+        if (stream->is_active) {
+            queued = bytes_max;
+        }
+        else {
+            picoquic_stream_queue_node_t* node = stream->send_queue;
+            while (node != NULL) {
+                queued += node->length - node->offset;
+                node = node->next_stream_data;
+            }
+        }
+        stream = stream->next_output_stream;
+    }
+    return queued;
+}
+
+static picoquic_path_t* picoquic_ecf_path_select(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_path_t* fastest = NULL;
+    picoquic_path_t* selected = NULL;
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+#endif
+
+    for (int path_index = 0; path_index < cnx->nb_paths; path_index++) {
+        picoquic_path_t* path_x = cnx->path[path_index];
+        if (path_x->is_scheduler_candidate) {
+            if (fastest == NULL || path_x->smoothed_rtt < fastest->smoothed_rtt) {
+                fastest = path_x;
+            }
+            if (picoquic_path_scheduler_is_ready(path_x) &&
+                (selected == NULL || path_x->smoothed_rtt < selected->smoothed_rtt)) {
+                selected = path_x;
+            }
+        }
+    }
+
+    if (selected == fastest) {
+        cnx->is_path_scheduler_waiting = 0;
+    }
+    else if (selected != NULL) {
+        uint64_t rtt_f = fastest->smoothed_rtt;
+        uint64_t rtt_s = selected->smoothed_rtt;
+        uint64_t delta = (fastest->rtt_variant > selected->rtt_variant) ? fastest->rtt_variant : selected->rtt_variant;
+        uint64_t cwin_f = (fastest->cwin > fastest->send_mtu) ? fastest->cwin : fastest->send_mtu;
+        uint64_t cwin_s = (selected->cwin > selected->send_mtu) ? selected->cwin : selected->send_mtu;
+        uint64_t bytes_max = cwin_f * (2 + (2 * (rtt_s + delta)) / ((rtt_f > 0) ? rtt_f : 1));
+        uint64_t queued = picoquic_ecf_queued_bytes(cnx, bytes_max);
+        uint64_t n = 1 + queued / cwin_f;
+
+        if (PICOQUIC_ECF_BETA_INVERSE * n * rtt_f <
+            (PICOQUIC_ECF_BETA_INVERSE + cnx->is_path_scheduler_waiting) * (rtt_s + delta)) {
+            if (queued * rtt_s >= cwin_s * (2 * rtt_f + delta)) {
+                /* Waiting for the fastest path completes sooner */
+                cnx->is_path_scheduler_waiting = 1;
+                selected = fastest;
+            }
+        }
+        else {
+            cnx->is_path_scheduler_waiting = 0;
+        }
+    }
+    return selected;
+}
+
+/* Weighted round robin scheduler.
+ * Each ready path is credited with a weight proportional to its capacity,
+ * estimated as the congestion window divided by the smoothed RTT. The path
+ * with the highest credit is selected, and its credit is decreased by the
+ * sum of the weights. This "smooth" round robin interleaves the paths
+ * instead of sending bursts on each of them.
+ */
+static int64_t picoquic_weighted_path_capacity(picoquic_path_t* path_x)
+{
+    uint64_t rtt = (path_x->smoothed_rtt > 0) ? path_x->smoothed_rtt : PICOQUIC_INITIAL_RTT;
+    /* Capacity in kilobytes per second */
+    uint64_t capacity = (path_x->cwin * 1000) / rtt;
+
+    return (capacity > 0) ? (int64_t)capacity : 1;
+}
+
+static picoquic_path_t* picoquic_weighted_path_select(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    picoquic_path_t* selected = NULL;
+    int64_t total_weight = 0;
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(current_time);
+#endif
+
+    for (int path_index = 0; path_index < cnx->nb_paths; path_index++) {
+        picoquic_path_t* path_x = cnx->path[path_index];
+        if (picoquic_path_scheduler_is_ready(path_x)) {
+            int64_t weight = picoquic_weighted_path_capacity(path_x);
+            path_x->scheduler_credit += weight;
+            total_weight += weight;
+            if (selected == NULL || path_x->scheduler_credit > selected->scheduler_credit) {
+                selected = path_x;
+            }
+        }
+    }
+    if (selected != NULL) {
+        selected->scheduler_credit -= total_weight;
+    }
+    return selected;
+}
+
+picoquic_path_scheduler_t picoquic_default_path_scheduler_struct = {
+    PICOQUIC_DEFAULT_PATH_SCHEDULER_ID, picoquic_default_path_select, 0
+};
+
+picoquic_path_scheduler_t picoquic_minrtt_path_scheduler_struct = {
+    PICOQUIC_MINRTT_PATH_SCHEDULER_ID, picoquic_minrtt_path_select, 0
+};
+
+picoquic_path_scheduler_t picoquic_ecf_path_scheduler_struct = {
+    PICOQUIC_ECF_PATH_SCHEDULER_ID, picoquic_ecf_path_select, 0
+};
+
+picoquic_path_scheduler_t picoquic_weighted_path_scheduler_struct = {
+    PICOQUIC_WEIGHTED_PATH_SCHEDULER_ID, picoquic_weighted_path_select, 0
+};
+
+/* The redundant scheduler uses the same selection as the default scheduler,
+ * but the sender repeats the packets sent on one path on the other paths. */
+picoquic_path_scheduler_t picoquic_redundant_path_scheduler_struct = {
+    PICOQUIC_REDUNDANT_PATH_SCHEDULER_ID, picoquic_default_path_select, 1
+};
+
+picoquic_path_scheduler_t const* picoquic_default_path_scheduler = &picoquic_default_path_scheduler_struct;
+picoquic_path_scheduler_t const* picoquic_minrtt_path_scheduler = &picoquic_minrtt_path_scheduler_struct;
+picoquic_path_scheduler_t const* picoquic_ecf_path_scheduler = &picoquic_ecf_path_scheduler_struct;
+picoquic_path_scheduler_t const* picoquic_weighted_path_scheduler = &picoquic_weighted_path_scheduler_struct;
+picoquic_path_scheduler_t const* picoquic_redundant_path_scheduler = &picoquic_redundant_path_scheduler_struct;
+
+picoquic_path_scheduler_t const* picoquic_get_path_scheduler(char const* scheduler_id)
+{
+    picoquic_path_scheduler_t const* schedulers[] = {
+        &picoquic_default_path_scheduler_struct,
+        &picoquic_minrtt_path_scheduler_struct,
+        &picoquic_ecf_path_scheduler_struct,
+        &picoquic_weighted_path_scheduler_struct,
+        &picoquic_redundant_path_scheduler_struct
+    };
+    picoquic_path_scheduler_t const* scheduler = NULL;
+
+    if (scheduler_id != NULL) {
+        for (size_t i = 0; i < sizeof(schedulers) / sizeof(picoquic_path_scheduler_t const*); i++) {
+            if (strcmp(scheduler_id, schedulers[i]->path_scheduler_id) == 0) {
+                scheduler = schedulers[i];
+                break;
+            }
+        }
+    }
+    return scheduler;
+}
@@ -375,22 +375,26 @@ int picoquic_verify_path_available(picoquic_cnx_t* cnx, picoquic_path_t** next_p
 }
 
 /*
- * Produce a sorting of available paths
+ * Produce a sorting of available paths.
+ * Handle first the decisions that do not depend on the scheduling policy:
+ * ACK on the min RTT path, streams with path affinity and datagrams on the
+ * first path that can carry them. Then, let the path scheduler of the
+ * connection pick a path. If no path is ready, fall back to the least
+ * recently used path allowed by pacing, or wait until pacing allows sending.
  */
 
 void picoquic_sort_available_paths(picoquic_cnx_t* cnx, uint64_t current_time, uint64_t* next_wake_time,
     picoquic_path_t** next_path, uint64_t min_retransmit, picoquic_tuple_t** next_tuple)
 {
-    int data_path_cwin = -1;
     int data_path_pacing = -1;
     uint64_t pacing_time_next = UINT64_MAX;
     uint64_t last_sent_pacing = UINT64_MAX;
-    uint64_t last_sent_cwin = UINT64_MAX;
     int i_min_rtt = -1;
     int is_min_rtt_pacing_ok = 0;
     int is_ack_needed = 0;
     picoquic_stream_head_t* next_stream = picoquic_find_ready_stream(cnx);
     int affinity_path_id = -1;
+    picoquic_path_t* scheduled_path = NULL;
 
     /* Several paths are available. We will chose from that.
      */
@@ -398,10 +402,14 @@ void picoquic_sort_available_paths(picoquic_cnx_t* cnx, uint64_t current_time, u
         picoquic_path_t* path_x = cnx->path[path_index];
         /* Clear the nominal ack path flag from all path -- it will be reset to the low RTT path later */
         path_x->is_nominal_ack_path = 0;
+        path_x->is_scheduler_candidate = 0;
+        path_x->is_scheduler_pacing_ok = 0;
+        path_x->is_scheduler_cwin_ok = 0;
         /* Only continue processing if the path is available */
         if (path_x->path_is_backup || !path_x->first_tuple->challenge_verified || path_x->path_is_demoted || path_x->nb_retransmit > min_retransmit) {
             continue;
         }
+        path_x->is_scheduler_candidate = 1;
         /* This path is a candidate for min rtt */
         if (i_min_rtt < 0 ||
             path_x->nb_retransmit < cnx->path[i_min_rtt]->nb_retransmit ||
@@ -411,10 +419,15 @@ void picoquic_sort_available_paths(picoquic_cnx_t* cnx, uint64_t current_time, u
             is_min_rtt_pacing_ok = 0;
         }
         path_x->polled++;
+        if (path_x->bytes_in_transit < path_x->cwin &&
+            path_x->bytes_in_transit < cnx->quic->cwin_max) {
+            path_x->is_scheduler_cwin_ok = 1;
+        }
         /* Find the best path authorized by pacing and then by congestion control,
          * taking into account affinity, datagrams, etc.
          */
         if (picoquic_is_sending_authorized_by_pacing(cnx, path_x, current_time, &pacing_time_next)) {
+            path_x->is_scheduler_pacing_ok = 1;
             if (path_x->last_sent_time < last_sent_pacing) {
                 last_sent_pacing = path_x->last_sent_time;
                 data_path_pacing = path_index;
@@ -422,12 +435,7 @@ void picoquic_sort_available_paths(picoquic_cnx_t* cnx, uint64_t current_time, u
                     is_min_rtt_pacing_ok = 1;
                 }
             }
-            if (path_x->bytes_in_transit < path_x->cwin &&
-                path_x->bytes_in_transit < cnx->quic->cwin_max) {
-                if (path_x->last_sent_time < last_sent_cwin) {
-                    last_sent_cwin = path_x->last_sent_time;
-                    data_path_cwin = path_index;
-                }
+            if (path_x->is_scheduler_cwin_ok) {
                 if (affinity_path_id < 0) {
                     /* we select here the first path that is either ready to send on
                         * the highest priority stream with affinity on this path, or
@@ -461,14 +469,12 @@ void picoquic_sort_available_paths(picoquic_cnx_t* cnx, uint64_t current_time, u
     if (is_ack_needed && is_min_rtt_pacing_ok) {
         *next_path = cnx->path[i_min_rtt];
     }
-    else if (data_path_cwin >= 0) {
+    else if (affinity_path_id >= 0) {
         /* if there is a path ready to send the most urgent data, select it */
-        if (affinity_path_id >= 0) {
-            *next_path = cnx->path[affinity_path_id];
-        }
-        else {
-            *next_path = cnx->path[data_path_cwin];
-        }
+        *next_path = cnx->path[affinity_path_id];
+    }
+    else if ((scheduled_path = cnx->path_scheduler->scheduler_select(cnx, current_time)) != NULL) {
+        *next_path = scheduled_path;
     }
     else if (data_path_pacing >= 0) {
         *next_path = cnx->path[data_path_pacing];
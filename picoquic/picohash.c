@@ -52,6 +52,12 @@ picohash_table* picohash_create_ex(size_t nb_bin,
         t->picohash_compare = picohash_compare;
         t->picohash_key_to_item = picohash_key_to_item;
         t->hash_seed = (hash_seed == NULL)? null_seed: hash_seed;
+        t->slots = NULL;
+        t->nb_slots = 0;
+        t->old_slots = NULL;
+        t->old_nb_slots = 0;
+        t->migrate_index = 0;
+        t->picohash_key_inline = NULL;
     }
 
     return t;
@@ -64,11 +70,290 @@ picohash_table* picohash_create(size_t nb_bin,
     return picohash_create_ex(nb_bin, picohash_hash, picohash_compare, NULL, NULL);
 }
 
+/* Open addressing tables, using Robin Hood hashing. The number of slots
+ * is a power of 2. Each entry is placed at or after its home slot
+ * (derived from the hash), and entries further from their home slot take priority
+ * over entries closer to it. Lookups stop at the first empty slot, or at
+ * the first entry closer to its home than the searched key would be.
+ * Deletions shift the following entries back by one slot, so there is
+ * no need for tombstones.
+ *
+ * When the table is 3/4 full, a new array of twice the size is allocated.
+ * The old array is kept and searched until all its entries have been
+ * moved, PICOHASH_MIGRATE_STEP slots at each insertion or deletion.
+ * All slots of the old array below migrate_index are empty.
+ */
+#define PICOHASH_OPEN_MIN_SLOTS 16
+#define PICOHASH_MIGRATE_STEP 8
+
+/* The hash functions used for CID return the CID bytes when they are
+ * short enough, so the bits are mixed before selecting the home slot. */
+static size_t picohash_open_home(uint64_t hash, size_t mask)
+{
+    uint64_t x = hash * 0x9E3779B97F4A7C15ull;
+
+    return (size_t)(x ^ (x >> 32)) & mask;
+}
+
+static size_t picohash_open_distance(size_t index, uint64_t hash, size_t mask)
+{
+    return (index - picohash_open_home(hash, mask)) & mask;
+}
+
+/* Return the index of the matching slot, or nb_slots if not found. If target
+ * is not NULL, look for the slot holding that item instead of comparing keys. */
+static size_t picohash_open_find(const picohash_table* hash_table, const picohash_slot* slots, size_t nb_slots,
+    uint64_t hash, const void* key, const uint8_t* inline_key, size_t key_length, const picohash_item* target)
+{
+    size_t mask = nb_slots - 1;
+    size_t index = picohash_open_home(hash, mask);
+    size_t distance = 0;
+
+    while (slots[index].item != NULL && picohash_open_distance(index, slots[index].hash, mask) >= distance) {
+        const picohash_slot* slot = &slots[index];
+        if (slot->hash == hash) {
+            if (target != NULL) {
+                if (slot->item == target) {
+                    return index;
+                }
+            }
+            else if (key_length > 0) {
+                if (slot->key_length == key_length && memcmp(slot->key, inline_key, PICOHASH_INLINE_KEY_MAX) == 0) {
+                    return index;
+                }
+            }
+            else if (hash_table->picohash_compare(key, slot->item->key) == 0) {
+                return index;
+            }
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+
+    return nb_slots;
+}
+
+static void picohash_open_place(picohash_slot* slots, size_t nb_slots, const picohash_slot* entry)
+{
+    size_t mask = nb_slots - 1;
+    picohash_slot current = *entry;
+    size_t index = picohash_open_home(current.hash, mask);
+    size_t distance = 0;
+
+    while (slots[index].item != NULL) {
+        size_t slot_distance = picohash_open_distance(index, slots[index].hash, mask);
+        if (slot_distance < distance) {
+            picohash_slot tmp = slots[index];
+            slots[index] = current;
+            current = tmp;
+            distance = slot_distance;
+        }
+        index = (index + 1) & mask;
+        distance++;
+    }
+    slots[index] = current;
+}
+
+static void picohash_open_remove(picohash_slot* slots, size_t nb_slots, size_t index)
+{
+    size_t mask = nb_slots - 1;
+    size_t next = (index + 1) & mask;
+
+    while (slots[next].item != NULL && picohash_open_distance(next, slots[next].hash, mask) > 0) {
+        slots[index] = slots[next];
+        index = next;
+        next = (next + 1) & mask;
+    }
+    memset(&slots[index], 0, sizeof(picohash_slot));
+}
+
+static void picohash_open_migrate(picohash_table* hash_table, size_t nb_steps)
+{
+    while (hash_table->old_slots != NULL && nb_steps > 0) {
+        if (hash_table->migrate_index >= hash_table->old_nb_slots) {
+            free(hash_table->old_slots);
+            hash_table->old_slots = NULL;
+            hash_table->old_nb_slots = 0;
+            hash_table->migrate_index = 0;
+        }
+        else {
+            picohash_slot* slot = &hash_table->old_slots[hash_table->migrate_index];
+            if (slot->item == NULL) {
+                hash_table->migrate_index++;
+            }
+            else {
+                /* The removal shifts the next entries back, so the same
+                 * index is examined again until it is empty. */
+                picohash_open_place(hash_table->slots, hash_table->nb_slots, slot);
+                picohash_open_remove(hash_table->old_slots, hash_table->old_nb_slots, hash_table->migrate_index);
+            }
+            nb_steps--;
+        }
+    }
+}
+
+static int picohash_open_grow(picohash_table* hash_table)
+{
+    int ret = 0;
+    size_t nb_slots = 2 * hash_table->nb_slots;
+    picohash_slot* slots = NULL;
+
+    /* Finish the previous migration before starting a new one */
+    picohash_open_migrate(hash_table, SIZE_MAX);
+
+    if (nb_slots < hash_table->nb_slots || nb_slots > SIZE_MAX / sizeof(picohash_slot) ||
+        (slots = (picohash_slot*)calloc(nb_slots, sizeof(picohash_slot))) == NULL) {
+        ret = -1;
+    }
+    else {
+        hash_table->old_slots = hash_table->slots;
+        hash_table->old_nb_slots = hash_table->nb_slots;
+        hash_table->migrate_index = 0;
+        hash_table->slots = slots;
+        hash_table->nb_slots = nb_slots;
+        hash_table->nb_bin = nb_slots;
+    }
+
+    return ret;
+}
+
+picohash_table* picohash_create_open(size_t nb_bin,
+    uint64_t(*picohash_hash)(const void*, const uint8_t*),
+    int (*picohash_compare)(const void*, const void*),
+    picohash_item* (*picohash_key_to_item)(const void*),
+    size_t (*picohash_key_inline)(const void*, uint8_t*),
+    const uint8_t* hash_seed)
+{
+    picohash_table* t = picohash_create_ex(1, picohash_hash, picohash_compare, picohash_key_to_item, hash_seed);
+
+    if (t != NULL) {
+        size_t nb_slots = PICOHASH_OPEN_MIN_SLOTS;
+
+        while (nb_slots < nb_bin && nb_slots < SIZE_MAX / (4 * sizeof(picohash_slot))) {
+            nb_slots *= 2;
+        }
+        free(t->hash_bin);
+        t->hash_bin = NULL;
+        t->slots = (picohash_slot*)calloc(nb_slots, sizeof(picohash_slot));
+        if (t->slots == NULL) {
+            free(t);
+            t = NULL;
+        }
+        else {
+            t->nb_slots = nb_slots;
+            t->nb_bin = nb_slots;
+            t->picohash_key_inline = picohash_key_inline;
+        }
+    }
+
+    return t;
+}
+
+static size_t picohash_open_inline_key(picohash_table* hash_table, const void* key, uint8_t* inline_key)
+{
+    size_t key_length = 0;
+
+    if (hash_table->picohash_key_inline != NULL) {
+        key_length = hash_table->picohash_key_inline(key, inline_key);
+        if (key_length > PICOHASH_INLINE_KEY_MAX) {
+            key_length = 0;
+        }
+    }
+    return key_length;
+}
+
+static picohash_item* picohash_open_retrieve(picohash_table* hash_table, const void* key, uint64_t hash)
+{
+    picohash_item* item = NULL;
+    uint8_t inline_key[PICOHASH_INLINE_KEY_MAX] = { 0 };
+    size_t key_length = picohash_open_inline_key(hash_table, key, inline_key);
+    size_t index = picohash_open_find(hash_table, hash_table->slots, hash_table->nb_slots, hash, key, inline_key, key_length, NULL);
+
+    if (index < hash_table->nb_slots) {
+        item = hash_table->slots[index].item;
+    }
+    else if (hash_table->old_slots != NULL) {
+        index = picohash_open_find(hash_table, hash_table->old_slots, hash_table->old_nb_slots, hash, key, inline_key, key_length, NULL);
+        if (index < hash_table->old_nb_slots) {
+            item = hash_table->old_slots[index].item;
+        }
+    }
+
+    return item;
+}
+
+static int picohash_open_insert(picohash_table* hash_table, picohash_item* item)
+{
+    int ret = 0;
+
+    picohash_open_migrate(hash_table, PICOHASH_MIGRATE_STEP);
+
+    if (hash_table->count + 1 > hash_table->nb_slots - hash_table->nb_slots / 4) {
+        ret = picohash_open_grow(hash_table);
+    }
+
+    if (ret == 0) {
+        picohash_slot entry;
+
+        memset(&entry, 0, sizeof(entry));
+        entry.hash = item->hash;
+        entry.item = item;
+        entry.key_length = (uint8_t)picohash_open_inline_key(hash_table, item->key, entry.key);
+        picohash_open_place(hash_table->slots, hash_table->nb_slots, &entry);
+        hash_table->count++;
+    }
+
+    return ret;
+}
+
+static void picohash_open_delete_item(picohash_table* hash_table, picohash_item* item)
+{
+    size_t index = picohash_open_find(hash_table, hash_table->slots, hash_table->nb_slots, item->hash, NULL, NULL, 0, item);
+
+    if (index < hash_table->nb_slots) {
+        picohash_open_remove(hash_table->slots, hash_table->nb_slots, index);
+        hash_table->count--;
+    }
+    else if (hash_table->old_slots != NULL) {
+        index = picohash_open_find(hash_table, hash_table->old_slots, hash_table->old_nb_slots, item->hash, NULL, NULL, 0, item);
+        if (index < hash_table->old_nb_slots) {
+            picohash_open_remove(hash_table->old_slots, hash_table->old_nb_slots, index);
+            hash_table->count--;
+        }
+    }
+
+    picohash_open_migrate(hash_table, PICOHASH_MIGRATE_STEP);
+}
+
+static void picohash_open_delete_slots(picohash_table* hash_table, picohash_slot* slots, size_t nb_slots, int delete_key_too)
+{
+    for (size_t i = 0; i < nb_slots; i++) {
+        if (slots[i].item != NULL) {
+            const void* key_to_delete = slots[i].item->key;
+
+            if (hash_table->picohash_key_to_item == NULL) {
+                free(slots[i].item);
+            }
+            if (delete_key_too) {
+                free((void*)key_to_delete);
+            }
+        }
+    }
+    free(slots);
+}
+
 picohash_item* picohash_retrieve(picohash_table* hash_table, const void* key)
 {
     uint64_t hash = hash_table->picohash_hash(key, hash_table->hash_seed);
-    uint32_t bin = (uint32_t)(hash % hash_table->nb_bin);
-    picohash_item* item = hash_table->hash_bin[bin];
+    uint32_t bin;
+    picohash_item* item;
+
+    if (hash_table->slots != NULL) {
+        return picohash_open_retrieve(hash_table, key, hash);
+    }
+
+    bin = (uint32_t)(hash % hash_table->nb_bin);
+    item = hash_table->hash_bin[bin];
 
     while (item != NULL) {
         if (hash_table->picohash_compare(key, item->key) == 0) {
@@ -84,7 +369,6 @@ picohash_item* picohash_retrieve(picohash_table* hash_table, const void* key)
 int picohash_insert(picohash_table* hash_table, const void* key)
 {
     uint64_t hash = hash_table->picohash_hash(key, hash_table->hash_seed);
-    uint32_t bin = (uint32_t)(hash % hash_table->nb_bin);
     int ret = 0;
     picohash_item* item;
     
@@ -100,9 +384,19 @@ int picohash_insert(picohash_table* hash_table, const void* key)
     } else {
         item->hash = hash;
         item->key = key;
-        item->next_in_bin = hash_table->hash_bin[bin];
-        hash_table->hash_bin[bin] = item;
-        hash_table->count++;
+        if (hash_table->slots != NULL) {
+            item->next_in_bin = NULL;
+            ret = picohash_open_insert(hash_table, item);
+            if (ret != 0 && hash_table->picohash_key_to_item == NULL) {
+                free(item);
+            }
+        }
+        else {
+            uint32_t bin = (uint32_t)(hash % hash_table->nb_bin);
+            item->next_in_bin = hash_table->hash_bin[bin];
+            hash_table->hash_bin[bin] = item;
+            hash_table->count++;
+        }
     }
 
     return ret;
@@ -110,21 +404,27 @@ int picohash_insert(picohash_table* hash_table, const void* key)
 
 void picohash_delete_item(picohash_table* hash_table, picohash_item* item, int delete_key_too)
 {
-    uint32_t bin = (uint32_t)(item->hash % hash_table->nb_bin);
-    picohash_item* previous = hash_table->hash_bin[bin];
     const void* shall_delete = NULL;
 
-    if (previous == item) {
-        hash_table->hash_bin[bin] = item->next_in_bin;
-        hash_table->count--;
-    } else {
-        while (previous != NULL) {
-            if (previous->next_in_bin == item) {
-                previous->next_in_bin = item->next_in_bin;
-                hash_table->count--;
-                break;
-            } else {
-                previous = previous->next_in_bin;
+    if (hash_table->slots != NULL) {
+        picohash_open_delete_item(hash_table, item);
+    }
+    else {
+        uint32_t bin = (uint32_t)(item->hash % hash_table->nb_bin);
+        picohash_item* previous = hash_table->hash_bin[bin];
+
+        if (previous == item) {
+            hash_table->hash_bin[bin] = item->next_in_bin;
+            hash_table->count--;
+        } else {
+            while (previous != NULL) {
+                if (previous->next_in_bin == item) {
+                    previous->next_in_bin = item->next_in_bin;
+                    hash_table->count--;
+                    break;
+                } else {
+                    previous = previous->next_in_bin;
+                }
             }
         }
     }
@@ -154,7 +454,13 @@ void picohash_delete_key(picohash_table* hash_table, void* key, int delete_key_t
 
 void picohash_delete(picohash_table* hash_table, int delete_key_too)
 {
-    if (hash_table->count > 0) {
+    if (hash_table->slots != NULL) {
+        picohash_open_delete_slots(hash_table, hash_table->slots, hash_table->nb_slots, delete_key_too);
+        if (hash_table->old_slots != NULL) {
+            picohash_open_delete_slots(hash_table, hash_table->old_slots, hash_table->old_nb_slots, delete_key_too);
+        }
+    }
+    else if (hash_table->count > 0) {
         for (uint32_t i = 0; i < hash_table->nb_bin; i++) {
             picohash_item* item = hash_table->hash_bin[i];
             while (item != NULL) {
@@ -39,6 +39,19 @@ typedef struct _picohash_item {
     const void* key;
 } picohash_item;
 
+/* Slot of the open addressing tables. The full hash and, for short keys,
+ * a copy of the key are kept in the slot, so most lookups do not need to
+ * dereference the item. Slots are 32 bytes long, two per cache line.
+ */
+#define PICOHASH_INLINE_KEY_MAX 15
+
+typedef struct st_picohash_slot_t {
+    uint64_t hash;
+    picohash_item* item;
+    uint8_t key_length;
+    uint8_t key[PICOHASH_INLINE_KEY_MAX];
+} picohash_slot;
+
 typedef struct picohash_table {
     /* TODO: lock ! */
     picohash_item** hash_bin;
@@ -48,6 +61,15 @@ typedef struct picohash_table {
     uint64_t (*picohash_hash)(const void*, const uint8_t*);
     int (*picohash_compare)(const void*, const void*);
     picohash_item* (*picohash_key_to_item)(const void*);
+    /* Open addressing backend, used if slots != NULL. While the table is
+     * being resized, entries are moved a few at a time from old_slots to
+     * slots, starting at migrate_index. */
+    picohash_slot* slots;
+    size_t nb_slots;
+    picohash_slot* old_slots;
+    size_t old_nb_slots;
+    size_t migrate_index;
+    size_t (*picohash_key_inline)(const void*, uint8_t*);
 } picohash_table;
 
 picohash_table* picohash_create(size_t nb_bin,
@@ -60,6 +82,23 @@ picohash_table* picohash_create_ex(size_t nb_bin,
     picohash_item* (*picohash_key_to_item)(const void*),
     const uint8_t* hash_seed);
 
+/* Create a table using open addressing with Robin Hood probing instead of
+ * chained bins. The table starts with at least nb_bin slots, and doubles
+ * in size when it is 3/4 full, moving entries incrementally to the new
+ * slots so that no single insertion pays for the whole resize.
+ * If picohash_key_inline is not NULL, it is called to copy the key into
+ * a buffer of PICOHASH_INLINE_KEY_MAX bytes and return its length. Keys
+ * with identical inline copies are then considered equal without calling
+ * picohash_compare. The function returns 0 if the key is too long, in
+ * which case picohash_compare is used.
+ */
+picohash_table* picohash_create_open(size_t nb_bin,
+    uint64_t(*picohash_hash)(const void*, const uint8_t*),
+    int (*picohash_compare)(const void*, const void*),
+    picohash_item* (*picohash_key_to_item)(const void*),
+    size_t (*picohash_key_inline)(const void*, uint8_t*),
+    const uint8_t* hash_seed);
+
 picohash_item* picohash_retrieve(picohash_table* hash_table, const void* key);
 
 int picohash_insert(picohash_table* hash_table, const void* key);
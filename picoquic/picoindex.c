@@ -0,0 +1,226 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoindex.h"
+
+static picoindex_page_t* picoindex_page_get(const picoindex_t* index, uint64_t page_number)
+{
+    picoindex_page_t* page = NULL;
+
+    if (page_number >= index->first_page && page_number - index->first_page < index->nb_pages) {
+        page = index->pages[index->page_offset + (size_t)(page_number - index->first_page)];
+    }
+
+    return page;
+}
+
+/* Extend the range of pages covered by the table so that it includes
+ * the specified page number. The table is reallocated when there is not
+ * enough room, with at least twice the number of pages needed, so that
+ * the cost of sliding or growing the table is amortized. */
+static int picoindex_extend(picoindex_t* index, uint64_t page_number)
+{
+    int ret = 0;
+    uint64_t new_first;
+    uint64_t new_last;
+    uint64_t new_nb;
+    size_t front_shift;
+
+    if (index->nb_pages == 0) {
+        index->first_page = page_number;
+        index->page_offset = 0;
+    }
+    new_first = (page_number < index->first_page) ? page_number : index->first_page;
+    new_last = index->first_page + index->nb_pages;
+    if (new_last <= page_number) {
+        new_last = page_number + 1;
+    }
+    new_nb = new_last - new_first;
+
+    if (new_nb > PICOINDEX_NB_PAGES_MAX) {
+        ret = -1;
+    }
+    else {
+        front_shift = (size_t)(index->first_page - new_first);
+
+        if (front_shift <= index->page_offset && index->page_offset - front_shift + new_nb <= index->pages_max) {
+            /* The new range fits in the current table */
+            size_t old_end = index->page_offset + index->nb_pages;
+
+            index->page_offset -= front_shift;
+            memset(&index->pages[index->page_offset], 0, front_shift * sizeof(picoindex_page_t*));
+            memset(&index->pages[old_end], 0, (index->page_offset + (size_t)new_nb - old_end) * sizeof(picoindex_page_t*));
+        }
+        else {
+            size_t new_max = (index->pages_max >= 2 * (size_t)new_nb) ? index->pages_max : 2 * (size_t)new_nb;
+            picoindex_page_t** new_pages = (picoindex_page_t**)malloc(new_max * sizeof(picoindex_page_t*));
+
+            if (new_pages == NULL) {
+                ret = -1;
+            }
+            else {
+                memset(new_pages, 0, new_max * sizeof(picoindex_page_t*));
+                if (index->nb_pages > 0) {
+                    memcpy(&new_pages[front_shift], &index->pages[index->page_offset], index->nb_pages * sizeof(picoindex_page_t*));
+                }
+                if (index->pages != NULL) {
+                    free(index->pages);
+                }
+                index->pages = new_pages;
+                index->pages_max = new_max;
+                index->page_offset = 0;
+            }
+        }
+
+        if (ret == 0) {
+            index->first_page = new_first;
+            index->nb_pages = (size_t)new_nb;
+        }
+    }
+
+    return ret;
+}
+
+static picoindex_page_t* picoindex_page_alloc(picoindex_t* index)
+{
+    picoindex_page_t* page = index->free_pages;
+
+    if (page != NULL) {
+        index->free_pages = page->next_free;
+        index->nb_free_pages--;
+    }
+    else {
+        page = (picoindex_page_t*)malloc(sizeof(picoindex_page_t));
+    }
+    if (page != NULL) {
+        memset(page, 0, sizeof(picoindex_page_t));
+    }
+
+    return page;
+}
+
+static void picoindex_page_release(picoindex_t* index, picoindex_page_t* page)
+{
+    if (index->nb_free_pages < PICOINDEX_FREE_PAGES_MAX) {
+        page->next_free = index->free_pages;
+        index->free_pages = page;
+        index->nb_free_pages++;
+    }
+    else {
+        free(page);
+    }
+}
+
+void* picoindex_get(const picoindex_t* index, uint64_t key)
+{
+    picoindex_page_t* page = picoindex_page_get(index, key >> PICOINDEX_PAGE_BITS);
+
+    return (page == NULL) ? NULL : page->value[key & (PICOINDEX_PAGE_SIZE - 1)];
+}
+
+int picoindex_set(picoindex_t* index, uint64_t key, void* value)
+{
+    int ret = 0;
+    uint64_t page_number = key >> PICOINDEX_PAGE_BITS;
+    picoindex_page_t* page = picoindex_page_get(index, page_number);
+
+    if (page == NULL && value != NULL) {
+        if ((page = picoindex_page_alloc(index)) == NULL) {
+            ret = -1;
+        }
+        else if (picoindex_extend(index, page_number) != 0) {
+            picoindex_page_release(index, page);
+            page = NULL;
+            ret = -1;
+        }
+        else {
+            index->pages[index->page_offset + (size_t)(page_number - index->first_page)] = page;
+        }
+    }
+
+    if (page != NULL) {
+        void** entry = &page->value[key & (PICOINDEX_PAGE_SIZE - 1)];
+
+        if (value == NULL) {
+            picoindex_remove(index, key);
+        }
+        else {
+            if (*entry == NULL) {
+                page->nb_values++;
+                index->nb_values++;
+            }
+            *entry = value;
+        }
+    }
+
+    return ret;
+}
+
+void picoindex_remove(picoindex_t* index, uint64_t key)
+{
+    uint64_t page_number = key >> PICOINDEX_PAGE_BITS;
+    picoindex_page_t* page = picoindex_page_get(index, page_number);
+
+    if (page != NULL && page->value[key & (PICOINDEX_PAGE_SIZE - 1)] != NULL) {
+        page->value[key & (PICOINDEX_PAGE_SIZE - 1)] = NULL;
+        page->nb_values--;
+        index->nb_values--;
+
+        if (page->nb_values == 0) {
+            /* Release the page, and trim the empty pages at both ends of the range */
+            index->pages[index->page_offset + (size_t)(page_number - index->first_page)] = NULL;
+            picoindex_page_release(index, page);
+
+            while (index->nb_pages > 0 && index->pages[index->page_offset] == NULL) {
+                index->page_offset++;
+                index->first_page++;
+                index->nb_pages--;
+            }
+            while (index->nb_pages > 0 && index->pages[index->page_offset + index->nb_pages - 1] == NULL) {
+                index->nb_pages--;
+            }
+            if (index->nb_pages == 0) {
+                index->page_offset = 0;
+            }
+        }
+    }
+}
+
+void picoindex_clear(picoindex_t* index)
+{
+    for (size_t i = 0; i < index->nb_pages; i++) {
+        picoindex_page_t* page = index->pages[index->page_offset + i];
+        if (page != NULL) {
+            free(page);
+        }
+    }
+    while (index->free_pages != NULL) {
+        picoindex_page_t* page = index->free_pages;
+        index->free_pages = page->next_free;
+        free(page);
+    }
+    if (index->pages != NULL) {
+        free(index->pages);
+    }
+    memset(index, 0, sizeof(picoindex_t));
+}
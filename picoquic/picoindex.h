@@ -0,0 +1,78 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PICOINDEX_H
+#define PICOINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Paged direct index.
+ *
+ * Maps dense integer keys, such as stream ranks, to pointers. The keys
+ * are grouped in pages of 64 entries. The index keeps a table of pointers
+ * to the pages covering the range of keys in use, so that retrieving,
+ * setting or removing a key costs O(1).
+ *
+ * A page is released when its last entry is removed, and the table
+ * slides forward when the first pages are released, so that the memory
+ * used is proportional to the range of keys currently in use, not to
+ * the total number of keys ever inserted. A few released pages are
+ * kept for reuse.
+ *
+ * An index set to all zeroes is empty and ready for use.
+ */
+#define PICOINDEX_PAGE_BITS 6
+#define PICOINDEX_PAGE_SIZE (1 << PICOINDEX_PAGE_BITS)
+#define PICOINDEX_FREE_PAGES_MAX 4
+#define PICOINDEX_NB_PAGES_MAX (((size_t)1) << 20)
+
+typedef struct st_picoindex_page_t {
+    void* value[PICOINDEX_PAGE_SIZE];
+    size_t nb_values;
+    struct st_picoindex_page_t* next_free;
+} picoindex_page_t;
+
+typedef struct st_picoindex_t {
+    picoindex_page_t** pages;
+    size_t pages_max;
+    size_t page_offset; /* position of first_page in the pages table */
+    size_t nb_pages;
+    uint64_t first_page;
+    size_t nb_values;
+    picoindex_page_t* free_pages;
+    size_t nb_free_pages;
+} picoindex_t;
+
+void* picoindex_get(const picoindex_t* index, uint64_t key);
+int picoindex_set(picoindex_t* index, uint64_t key, void* value);
+void picoindex_remove(picoindex_t* index, uint64_t key);
+void picoindex_clear(picoindex_t* index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOINDEX_H */
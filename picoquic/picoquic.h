@@ -578,6 +578,37 @@ void picoquic_free(picoquic_quic_t* quic);
  * which is a bit faster but requires an additional 7KB of data per connection */
 int picoquic_set_low_memory_mode(picoquic_quic_t* quic, int low_memory_mode);
 
+/* Zero copy receive mode.
+ * By default, stream data received out of order, or in frames that are not
+ * the last of their packet, is copied into a newly allocated data node. When
+ * zero copy receive is set, the decrypted packets are reference counted, the
+ * queued stream data points inside them, and each packet is recycled once
+ * all the data that it carries has been delivered to the application.
+ * This saves copies, but a small chunk of data can keep a whole packet
+ * buffer in use until it is delivered. */
+void picoquic_set_zero_copy_receive(picoquic_quic_t* quic, int zero_copy_receive);
+
+/* Compact sent packet records.
+ * By default, each packet waiting for acknowledgement keeps a copy of its
+ * plaintext, so that its frames can be repeated if it is lost. When compact
+ * records are set, the stream data that was sent is kept in the stream
+ * until acknowledged, and the sent packets only keep a short manifest of their
+ * frames. Lost stream data is then copied from the stream. This reduces the
+ * memory used per packet in flight, which matters for high bandwidth delay
+ * products. It does not apply to data provided through the
+ * "prepare to send" callback, which is not retained by the stack. */
+void picoquic_set_compact_sent_packets(picoquic_quic_t* quic, int compact_sent_packets);
+
+/* Connection tables.
+ * By default, the tables used to find connections by CID, address, initial
+ * CID or reset secret use chained bins, with a fixed number of bins sized
+ * from the maximum number of connections. Setting open addressing replaces
+ * them with open addressing tables, which keep short keys in the table
+ * slots and grow as connections are added. This speeds up the lookups of
+ * servers with many connections. Must be called before creating
+ * connections, returns -1 otherwise. */
+int picoquic_set_open_addressing_tables(picoquic_quic_t* quic, int use_open_addressing);
+
 /* management of retry policy.
  * The cookie mode can be used to force the following behavior:
  * - if cookie_mode&1, check the token and force a retry for each incoming connection.
@@ -1137,6 +1168,47 @@ int picoquic_queue_misc_frame(picoquic_cnx_t* cnx, const uint8_t* bytes, size_t
 #define PICOQUIC_DATAGRAM_QUEUE_MAX_LENGTH 1200
 int picoquic_queue_datagram_frame(picoquic_cnx_t* cnx, size_t length, const uint8_t* bytes);
 
+/* Queued datagrams are copied in a per connection ring, without
+ * per datagram memory allocation. A time to live can be specified, in
+ * microseconds: if the datagram could not be sent before the TTL
+ * expires, it is dropped without being sent. A TTL of 0 means that
+ * the datagram does not expire.
+ *
+ * The batch API queues several datagrams in a single call. If one of
+ * the datagrams is too long, none of them is queued.
+ */
+int picoquic_queue_datagram_frame_ex(picoquic_cnx_t* cnx, size_t length, const uint8_t* bytes, uint64_t ttl);
+
+typedef struct st_picoquic_outgoing_datagram_t {
+    const uint8_t* bytes;
+    size_t length;
+    uint64_t ttl;
+} picoquic_outgoing_datagram_t;
+
+int picoquic_queue_datagram_batch(picoquic_cnx_t* cnx, const picoquic_outgoing_datagram_t* datagrams, size_t nb_datagrams);
+
+/* By default, the datagram ring grows as needed. Setting limits allocates
+ * the ring at the specified size, after which it does not grow anymore.
+ * When the ring is full, the oldest datagrams are dropped to make room
+ * for the new ones. A limit of 0 means no limit.
+ */
+int picoquic_set_datagram_queue_limits(picoquic_cnx_t* cnx, size_t max_datagrams, size_t max_bytes);
+
+/* Statistics of the datagram queue. The queue delay is measured between
+ * the queuing of a datagram and the formatting of the packet that carries it.
+ */
+typedef struct st_picoquic_datagram_queue_stats_t {
+    uint64_t nb_queued;
+    uint64_t nb_sent;
+    uint64_t nb_expired;
+    uint64_t nb_overflow;
+    uint64_t nb_waiting;
+    uint64_t queue_delay_total;
+    uint64_t queue_delay_max;
+} picoquic_datagram_queue_stats_t;
+
+void picoquic_get_datagram_queue_stats(picoquic_cnx_t* cnx, picoquic_datagram_queue_stats_t* stats);
+
 /* The incoming packet API is used to pass incoming packets to a 
  * Quic context. The API handles the decryption of the packets
  * and their processing in the context of connections.
@@ -1165,6 +1237,31 @@ int picoquic_incoming_packet_ex(
     picoquic_cnx_t** first_cnx,
     uint64_t current_time);
 
+/* The batch variant of the incoming packet API processes an array of
+ * datagrams received together, such as the segments of a GRO super-packet
+ * or the messages returned by a single recvmmsg call. The short header
+ * packets are grouped by connection, their header protection is removed
+ * and they are decrypted in a single pass, and then all datagrams are
+ * processed in order. The result is the same as calling
+ * picoquic_incoming_packet_ex for each datagram. If `last_cnx` is not NULL,
+ * it is set to the connection of the last datagram in the batch.
+ */
+typedef struct st_picoquic_incoming_datagram_t {
+    uint8_t* bytes;
+    size_t length;
+    struct sockaddr* addr_from;
+    struct sockaddr* addr_to;
+    int if_index_to;
+    unsigned char received_ecn;
+} picoquic_incoming_datagram_t;
+
+int picoquic_incoming_packet_batch(
+    picoquic_quic_t* quic,
+    picoquic_incoming_datagram_t* datagrams,
+    size_t nb_datagrams,
+    picoquic_cnx_t** last_cnx,
+    uint64_t current_time);
+
 /* Applications must regularly poll the "next packet" API to obtain the
  * next packet that will be set over the network. The API for that is
  * picoquic_prepare_next_packet", which operates on a "quic context".
@@ -1383,6 +1480,30 @@ void picoquic_reset_stream_ctx(picoquic_cnx_t* cnx, uint64_t stream_id);
  */
 int picoquic_add_to_stream_with_ctx(picoquic_cnx_t * cnx, uint64_t stream_id, const uint8_t * data, size_t length, int set_fin, void * app_stream_ctx);
 
+/* Queue application owned buffers on a stream, without copying them.
+ * The transport reads the data directly from the buffers listed in "iov"
+ * when it formats stream frames. The buffers must remain valid and unchanged
+ * until the transport releases them. If "release_fn" is not NULL, it is
+ * called once for each buffer, after all the bytes of that buffer have
+ * been acknowledged by the peer, or with "is_acknowledged" set to 0 if the
+ * stream is reset or deleted first. If "release_fn" is NULL, the application
+ * must keep the buffers valid until the stream is deleted.
+ * If the call fails, none of the buffers is queued, and the application
+ * keeps the ownership of all of them.
+ * As with picoquic_add_to_stream, this erases the "active mark" of the stream
+ * and sets the "app_stream_ctx" value.
+ */
+typedef struct st_picoquic_iovec_t {
+    const uint8_t* base;
+    size_t len;
+} picoquic_iovec_t;
+
+typedef void (*picoquic_stream_buffer_release_fn)(void* release_ctx, const uint8_t* bytes, size_t length, int is_acknowledged);
+
+int picoquic_add_buffers_to_stream(picoquic_cnx_t* cnx, uint64_t stream_id,
+    const picoquic_iovec_t* iov, size_t iov_count, int set_fin,
+    picoquic_stream_buffer_release_fn release_fn, void* release_ctx, void* app_stream_ctx);
+
 /* Reset a stream, indicating that no more data will be sent on 
  * that stream and that any data currently queued can be abandoned. */
 int picoquic_reset_stream(picoquic_cnx_t* cnx,
@@ -1610,6 +1731,43 @@ void picoquic_set_default_congestion_algorithm_by_name(picoquic_quic_t* quic, ch
 void picoquic_set_congestion_algorithm(picoquic_cnx_t* cnx, picoquic_congestion_algorithm_t const* algo);
 void picoquic_set_congestion_algorithm_ex(picoquic_cnx_t* cnx, picoquic_congestion_algorithm_t const* alg, char const* alg_option_string);
 
+/* Multipath scheduler.
+ * When several paths are available, the stack first handles the decisions
+ * that do not depend on the scheduling policy: ACKs are sent on the path
+ * with the lowest RTT, streams with a path affinity and datagrams are sent on
+ * the first path that can carry them. Otherwise, the stack calls the
+ * "select" function of the path scheduler to pick the path on which the
+ * next packet will be sent.
+ *
+ * Before calling "select", the stack marks the candidate paths, i.e., the
+ * paths that are validated, not standby and not demoted, by setting the path
+ * flag `is_scheduler_candidate`. The flag `is_scheduler_pacing_ok` tells
+ * whether the pacing allows sending on that path now, and the flag
+ * `is_scheduler_cwin_ok` tells whether there is space in the congestion
+ * window. The scheduler should return one of the candidate paths. It may
+ * return a path on which the congestion window is full, which means that the
+ * stack will wait for that path to become available instead of sending on
+ * another one. If the scheduler returns NULL, the stack picks the least
+ * recently used path that is allowed by pacing, or waits until one is.
+ *
+ * If "is_redundant" is set, the stack repeats each data packet sent on a path
+ * on every other available path, before sending new data on these paths.
+ */
+typedef picoquic_path_t* (*picoquic_path_scheduler_select)(picoquic_cnx_t* cnx, uint64_t current_time);
+
+typedef struct st_picoquic_path_scheduler_t {
+    char const* path_scheduler_id;
+    picoquic_path_scheduler_select scheduler_select;
+    int is_redundant;
+} picoquic_path_scheduler_t;
+
+#define PICOQUIC_DEFAULT_PATH_SCHEDULER picoquic_default_path_scheduler
+
+picoquic_path_scheduler_t const* picoquic_get_path_scheduler(char const* scheduler_id);
+
+void picoquic_set_default_path_scheduler(picoquic_quic_t* quic, picoquic_path_scheduler_t const* scheduler);
+void picoquic_set_path_scheduler(picoquic_cnx_t* cnx, picoquic_path_scheduler_t const* scheduler);
+
 /* The experimental API 'picoquic_set_priority_limit_for_bypass' 
 * instruct the stack to send the high priority streams or datagrams
 * immediately, even if congestion control would normally prevent it.
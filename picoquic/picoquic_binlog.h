@@ -113,6 +113,61 @@ int picoquic_set_binlog(picoquic_quic_t* quic, char const* binlog_dir);
 /* Enable binary logs, e.g. if autoqlog is requests */
 void picoquic_enable_binlog(picoquic_quic_t* quic);
 
+/* Asynchronous binary log writer.
+ * By default, the binary log events are written to the per connection
+ * log files by the network thread, with one or two calls to fwrite per
+ * event. Under load, the file locks and the disk writes slow down the
+ * processing of packets.
+ *
+ * With a binlog writer, each QUIC context gets a ring buffer with a
+ * single producer, the network thread. The events are copied to the ring,
+ * and a writer thread copies them to the files, using large file buffers.
+ * If the ring is full, the event is dropped and counted in the ring
+ * statistics: logging never blocks the network thread. The automatic
+ * conversion to qlog needs the complete file, so it is handed to the writer
+ * thread with the close request, which queues it to the qlog worker after
+ * the file is closed (see autoqlog.h). Without a qlog worker, the binary
+ * logs are not converted.
+ *
+ * Set the writer before creating connections. One writer can serve
+ * several QUIC contexts, and shall be deleted after these contexts
+ * are freed.
+ */
+#define PICOQUIC_BINLOG_RING_SIZE_DEFAULT 0x100000
+#define PICOQUIC_BINLOG_FILE_BUFFER_SIZE 0x10000
+
+typedef struct st_picoquic_binlog_writer_t picoquic_binlog_writer_t;
+
+typedef struct st_picoquic_binlog_ring_stats_t {
+    uint64_t nb_events;
+    uint64_t nb_bytes;
+    uint64_t nb_dropped_events;
+    uint64_t nb_dropped_bytes;
+    uint64_t nb_pending_closes;
+    size_t ring_size;
+    size_t ring_fill;
+    size_t ring_fill_max;
+} picoquic_binlog_ring_stats_t;
+
+typedef struct st_picoquic_binlog_writer_stats_t {
+    uint64_t nb_records;
+    uint64_t nb_bytes_written;
+    uint64_t nb_files_closed;
+} picoquic_binlog_writer_stats_t;
+
+picoquic_binlog_writer_t* picoquic_binlog_writer_create(size_t ring_size);
+void picoquic_binlog_writer_delete(picoquic_binlog_writer_t* writer);
+void picoquic_binlog_writer_get_stats(picoquic_binlog_writer_t* writer, picoquic_binlog_writer_stats_t* stats);
+int picoquic_set_binlog_writer(picoquic_quic_t* quic, picoquic_binlog_writer_t* writer);
+/* Statistics of the ring of the QUIC context. Call from the network thread. */
+void picoquic_get_binlog_ring_stats(picoquic_quic_t* quic, picoquic_binlog_ring_stats_t* stats);
+
+/* Used by the log writer */
+int picoquic_binlog_ring_write(picoquic_binlog_ring_t* ring, FILE* f,
+    const uint8_t* head, size_t head_length, const uint8_t* data, size_t length);
+void picoquic_binlog_ring_close_file(picoquic_binlog_ring_t* ring, FILE* f,
+    picoquic_binlog_closed_fn closed_fn, void* closed_ctx);
+
 #ifdef __cplusplus
 }
 #endif
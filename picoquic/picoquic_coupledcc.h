@@ -0,0 +1,54 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef PICOQUIC_COUPLEDCC_H
+#define PICOQUIC_COUPLEDCC_H
+
+#include "picoquic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Coupled congestion control for multipath connections. The three
+ * algorithms share the slow start and recovery logic of New Reno,
+ * but couple the congestion avoidance increase of each path with
+ * the windows and RTT of all the other paths of the connection.
+ * For single path connections, they behave like New Reno.
+ */
+#define PICOQUIC_LIA_ID "lia"
+#define PICOQUIC_OLIA_ID "olia"
+#define PICOQUIC_BALIA_ID "balia"
+
+extern picoquic_congestion_algorithm_t* picoquic_lia_algorithm;
+extern picoquic_congestion_algorithm_t* picoquic_olia_algorithm;
+extern picoquic_congestion_algorithm_t* picoquic_balia_algorithm;
+
+/* Following declaration is used for unit tests. It returns the
+ * OLIA alpha term of the path, which moves window towards the
+ * best paths. */
+double picoquic_olia_alpha(picoquic_cnx_t* cnx, picoquic_path_t* path_x);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -72,6 +72,55 @@ extern "C" {
     void picoquic_register_keyex_from_key_file_fn(picoquic_keyex_from_key_file_t keyex_from_key_file_fn, 
         picoquic_keyex_dispose_t keyex_dispose_fn);
 
+    /* Batched packet protection.
+     * Each entry describes one packet of a send train. The header is already
+     * formatted in `packet`, and the plaintext payload is placed just after it.
+     * The batch function encrypts the payload in place, appending the AEAD
+     * checksum, and computes the header protection mask from the sample
+     * located 4 bytes after `pn_offset`. The mask is placed in `hp_mask`;
+     * it is applied to the header by the caller.
+     */
+    typedef struct st_picoquic_aead_batch_entry_t {
+        uint8_t* packet;
+        size_t header_length;
+        size_t payload_length;
+        size_t pn_offset;
+        uint64_t sequence_number;
+        uint64_t path_id;
+        void* aead_ctx;
+        void* pn_enc;
+        unsigned int is_multipath : 1;
+        uint8_t first_mask;
+        uint8_t hp_mask[16];
+    } picoquic_aead_batch_entry_t;
+
+    typedef void (*picoquic_aead_encrypt_batch_t)(picoquic_aead_batch_entry_t* entries, size_t nb_entries);
+
+    void picoquic_register_aead_encrypt_batch_fn(ptls_aead_algorithm_t* aead, picoquic_aead_encrypt_batch_t encrypt_batch_fn);
+
+    /* Batched packet decryption.
+     * Each entry describes one received packet. The batch function decrypts
+     * `input` into `output`, authenticating the unprotected header passed in
+     * `aad`, and sets `decrypted_length`. By convention, a value larger than
+     * `input_length` indicates a decryption failure.
+     */
+    typedef struct st_picoquic_aead_decrypt_batch_entry_t {
+        uint8_t* output;
+        const uint8_t* input;
+        size_t input_length;
+        const uint8_t* aad;
+        size_t aad_length;
+        uint64_t sequence_number;
+        uint64_t path_id;
+        void* aead_ctx;
+        unsigned int is_multipath : 1;
+        size_t decrypted_length;
+    } picoquic_aead_decrypt_batch_entry_t;
+
+    typedef void (*picoquic_aead_decrypt_batch_t)(picoquic_aead_decrypt_batch_entry_t* entries, size_t nb_entries);
+
+    void picoquic_register_aead_decrypt_batch_fn(ptls_aead_algorithm_t* aead, picoquic_aead_decrypt_batch_t decrypt_batch_fn);
+
 /* Additional definitions required for testing and verification */
 
 #define PICOQUIC_CIPHER_SUITES_NB_MAX 8
@@ -89,6 +138,13 @@ extern "C" {
     extern ptls_hpke_cipher_suite_t* picoquic_hpke_cipher_suites[PICOQUIC_HPKE_CIPHER_SUITE_NB_MAX + 1];
 #define PICOQUIC_HPKE_KEM_NB_MAX 3
     extern ptls_hpke_kem_t* picoquic_hpke_kems[PICOQUIC_HPKE_KEM_NB_MAX + 1];
+#define PICOQUIC_AEAD_BATCH_FN_NB_MAX 4
+    struct st_picoquic_aead_batch_fn_t {
+        ptls_aead_algorithm_t* aead;
+        picoquic_aead_encrypt_batch_t encrypt_batch_fn;
+        picoquic_aead_decrypt_batch_t decrypt_batch_fn;
+    };
+    extern struct st_picoquic_aead_batch_fn_t picoquic_aead_batch_fns[PICOQUIC_AEAD_BATCH_FN_NB_MAX + 1];
     extern picoquic_set_private_key_from_file_t picoquic_set_private_key_from_file_fn;
     extern picoquic_dispose_sign_certificate_t picoquic_dispose_sign_certificate_fn;
     extern picoquic_get_certs_from_file_t picoquic_get_certs_from_file_fn;
@@ -28,6 +28,9 @@
 
 #include "picohash.h"
 #include "picosplay.h"
+#include "picowheel.h"
+#include "picoindex.h"
+#include "datagram_ring.h"
 #include "picoquic.h"
 #include "picoquic_utils.h"
 
@@ -116,6 +119,9 @@ extern "C" {
 #define PICOQUIC_CC_ALGO_NUMBER_BBR 5
 #define PICOQUIC_CC_ALGO_NUMBER_PRAGUE 6
 #define PICOQUIC_CC_ALGO_NUMBER_BBR1 7
+#define PICOQUIC_CC_ALGO_NUMBER_LIA 8
+#define PICOQUIC_CC_ALGO_NUMBER_OLIA 9
+#define PICOQUIC_CC_ALGO_NUMBER_BALIA 10
 
 #define PICOQUIC_MAX_ACK_RANGE_REPEAT 4
 #define PICOQUIC_MIN_ACK_RANGE_REPEAT 2
@@ -168,7 +174,8 @@ typedef enum {
     picoquic_frame_type_paths_blocked = 0x15228c0d,
     picoquic_frame_type_path_cid_blocked = 0x15228c0e,
     picoquic_frame_type_observed_address_v4 = 0x9f81a6,
-    picoquic_frame_type_observed_address_v6 = 0x9f81a7
+    picoquic_frame_type_observed_address_v6 = 0x9f81a7,
+    picoquic_frame_type_stream_ref = 0x3fff5e01 /* Internal, only found in compact packet records */
 } picoquic_frame_type_enum_t;
 
 /* PMTU discovery requirement status */
@@ -359,24 +366,41 @@ void picoquic_queue_stateless_packet(picoquic_quic_t* quic, picoquic_stateless_p
 picoquic_stateless_packet_t* picoquic_dequeue_stateless_packet(picoquic_quic_t* quic);
 void picoquic_delete_stateless_packet(picoquic_stateless_packet_t* sp);
 
-/* Data structure used to hold chunk of stream data before in sequence delivery */
+/* Data structure used to hold chunk of stream data before in sequence delivery.
+ * In zero copy receive mode, chunks are held in "reference" nodes, which are
+ * allocated without the "data" array. The bytes of these nodes point inside
+ * the decrypted packet held by "packet_node", and that packet node is only
+ * recycled when all references to it are released.
+ */
 typedef struct st_picoquic_stream_data_node_t {
     picosplay_node_t stream_data_node;
     picoquic_quic_t* quic;
     struct st_picoquic_stream_data_node_t* next_stream_data;
+    struct st_picoquic_stream_data_node_t* packet_node; /* If reference node, packet holding the bytes */
+    int nb_references; /* If packet node, number of references to that packet */
     uint64_t offset;  /* Stream offset of the first octet in "bytes" */
     size_t length;    /* Number of octets in "bytes" */
     const uint8_t* bytes;
     uint8_t data[PICOQUIC_MAX_PACKET_SIZE];
 } picoquic_stream_data_node_t;
 
-/* Data structure used to hold chunk of stream data queued by application */
+#define PICOQUIC_STREAM_DATA_REF_SIZE offsetof(picoquic_stream_data_node_t, data)
+
+/* Data structure used to hold chunk of stream data queued by application.
+ * If "is_app_owned" is set, the bytes belong to the application. The node is
+ * not freed after the data is sent, but moved to the stream's release queue
+ * until the peer acknowledges the data, and then "release_fn" is called.
+ */
 typedef struct st_picoquic_stream_queue_node_t {
     picoquic_quic_t* quic;
     struct st_picoquic_stream_queue_node_t* next_stream_data;
-    uint64_t offset;  /* Stream offset of the first octet in "bytes" */
+    uint64_t offset;  /* Number of octets of "bytes" already sent */
     size_t length;    /* Number of octets in "bytes" */
     uint8_t* bytes;
+    uint64_t stream_offset; /* Stream offset of the first octet in "bytes", set when all bytes are sent */
+    picoquic_stream_buffer_release_fn release_fn;
+    void* release_ctx;
+    unsigned int is_app_owned : 1;
 } picoquic_stream_queue_node_t;
 
 /*
@@ -384,6 +408,12 @@ typedef struct st_picoquic_stream_queue_node_t {
  * have been sent but are not yet acknowledged.
  * Packets are stored in unencrypted format.
  * The checksum length is the difference between encrypted and unencrypted.
+ *
+ * If "is_compact" is set, the record was allocated with only "compact_length"
+ * bytes after the header, and holds a manifest of the frames instead of the
+ * packet copy: stream frames are replaced by stream references, which
+ * point to the data retained in the stream, other frames are copied.
+ * The packet length remains the length of the packet that was sent.
  */
 
 typedef struct st_picoquic_packet_t {
@@ -412,6 +442,8 @@ typedef struct st_picoquic_packet_t {
     size_t length;
     size_t checksum_overhead;
     size_t offset;
+    size_t compact_length;
+    uint64_t redundant_path_mask; /* Paths on which the redundant scheduler repeated the packet */
     picoquic_packet_type_enum ptype;
     picoquic_packet_context_enum pc;
     unsigned int is_evaluated : 1;
@@ -427,10 +459,14 @@ typedef struct st_picoquic_packet_t {
     unsigned int is_queued_for_retransmit : 1;
     unsigned int is_queued_for_spurious_detection : 1;
     unsigned int is_queued_for_data_repeat : 1;
+    unsigned int is_compact : 1;
 
     uint8_t bytes[PICOQUIC_MAX_PACKET_SIZE];
 } picoquic_packet_t;
 
+#define PICOQUIC_PACKET_COMPACT_SIZE offsetof(picoquic_packet_t, bytes)
+#define PICOQUIC_PACKET_FRAMES_END(p) (((p)->is_compact) ? (p)->compact_length : (p)->length)
+
 picoquic_packet_t* picoquic_create_packet(picoquic_quic_t* quic);
 void picoquic_recycle_packet(picoquic_quic_t* quic, picoquic_packet_t* packet);
 size_t picoquic_pad_to_policy(picoquic_cnx_t* cnx, uint8_t* bytes, size_t length, uint32_t max_length);
@@ -601,6 +637,14 @@ typedef uint64_t picoquic_tp_enum;
  * API.
  */
 typedef int (*picoquic_autoqlog_fn)(picoquic_cnx_t * cnx);
+typedef struct st_picoquic_binlog_ring_t picoquic_binlog_ring_t;
+/* With a binlog writer, the file is closed by the writer thread, which then
+ * calls the "closed" callback. If the file could not be closed, the callback
+ * is called with `is_closed` set to 0, and shall only release the context.
+ * The "defer" function prepares that callback when the connection is closed.
+ */
+typedef void (*picoquic_binlog_closed_fn)(void* closed_ctx, int is_closed);
+typedef int (*picoquic_autoqlog_defer_fn)(picoquic_cnx_t* cnx, picoquic_binlog_closed_fn* closed_fn, void** closed_ctx);
 
 /* Callback used for the performance log
  */
@@ -675,14 +719,18 @@ typedef struct st_picoquic_quic_t {
     unsigned int is_port_blocking_disabled : 1; /* Do not check client port on incoming connections */
     unsigned int are_path_callbacks_enabled : 1; /* Enable path specific callbacks by default */
     unsigned int use_predictable_random : 1; /* For logging tests */
+    unsigned int use_zero_copy_receive : 1; /* Stream data nodes point into the decrypted packets */
+    unsigned int use_compact_sent_packets : 1; /* Sent packets keep a manifest of frames instead of a copy */
+    unsigned int is_protect_batch_open : 1; /* 1-RTT packets are encrypted at the end of the send train */
     picoquic_stateless_packet_t* pending_stateless_packet;
 
     picoquic_congestion_algorithm_t const* default_congestion_alg;
     char const* default_congestion_alg_option_string;
+    picoquic_path_scheduler_t const* default_path_scheduler;
 
     struct st_picoquic_cnx_t* cnx_list;
     struct st_picoquic_cnx_t* cnx_last;
-    picosplay_tree_t cnx_wake_tree;
+    picowheel_t cnx_wake_wheel;
 
     struct st_picoquic_cnx_t* cnx_in_progress;
 
@@ -701,11 +749,20 @@ typedef struct st_picoquic_quic_t {
     int nb_packets_allocated;
     int nb_packets_allocated_max;
 
+    struct st_picoquic_aead_batch_entry_t* protect_batch; /* Packets of the train waiting for encryption */
+    size_t protect_batch_nb;
+    uint64_t nb_cnx_removed; /* Connections or connection IDs removed from the lookup tables */
+
     picoquic_stream_data_node_t* p_first_data_node;
     int nb_data_nodes_in_pool;
     int nb_data_nodes_allocated;
     int nb_data_nodes_allocated_max;
 
+    picoquic_stream_data_node_t* p_first_data_ref;
+    int nb_data_refs_in_pool;
+    int nb_data_refs_allocated;
+    int nb_data_refs_allocated_max;
+
     picoquic_connection_id_cb_fn cnx_id_callback_fn;
     void* cnx_id_callback_ctx;
 
@@ -738,6 +795,9 @@ typedef struct st_picoquic_quic_t {
     char* binlog_dir;
     char* qlog_dir;
     picoquic_autoqlog_fn autoqlog_fn;
+    picoquic_autoqlog_defer_fn autoqlog_defer_fn;
+    void* autoqlog_ctx;
+    picoquic_binlog_ring_t* binlog_ring;
     struct st_picoquic_unified_logging_t* text_log_fns;
     struct st_picoquic_unified_logging_t* bin_log_fns;
     struct st_picoquic_unified_logging_t* qlog_fns;
@@ -825,12 +885,16 @@ typedef struct st_picoquic_stream_head_t {
     picosplay_tree_t stream_data_tree; /* splay of received stream segments */
     uint64_t sent_offset; /* Amount of data sent in the stream */
     picoquic_stream_queue_node_t* send_queue; /* if the stream is not "active", list of data segments ready to send */
+    picoquic_stream_queue_node_t* release_queue; /* application owned segments sent but not yet acknowledged */
+    picoquic_stream_queue_node_t* release_queue_last;
+    picoquic_stream_queue_node_t* release_queue_cursor; /* segment where the last copy of sent data ended */
     void * app_stream_ctx;
     picoquic_stream_direct_receive_fn direct_receive_fn; /* direct receive function, if not NULL */
     void* direct_receive_ctx; /* direct receive context */
     picoquic_sack_list_t sack_list; /* Track which parts of the stream were acknowledged by the peer */
     /* Stream priority -- lowest is most urgent */
     uint8_t stream_priority;
+    uint8_t output_priority; /* Priority level of the output list in which the stream is queued */
     /* Flags describing the state of the stream */
     unsigned int is_active : 1; /* The application is actively managing data sending through callbacks */
     unsigned int fin_requested : 1; /* Application has requested Fin of sending stream */
@@ -849,9 +913,11 @@ typedef struct st_picoquic_stream_head_t {
     unsigned int max_stream_updated : 1; /* After stream was closed in both directions, the max stream id number was updated */
     unsigned int stream_data_blocked_sent : 1; /* If stream_data_blocked has been sent to peer, and no data sent on stream since */
     unsigned int is_output_stream : 1; /* If stream is listed in the output list */
+    unsigned int is_output_head : 1; /* Stream queued ahead of round robin order, because it is blocked or needs a reset */
     unsigned int is_closed : 1; /* Stream is closed, closure is accouted for */
     unsigned int is_discarded : 1; /* There should be no more callback for that stream, the application has discarded it */
     unsigned int use_app_flow_control : 1; /* Do not automatically increment the flow control window, wait for app calls. */
+    unsigned int is_not_indexed : 1; /* Stream could not be added to the stream index of the connection */
 } picoquic_stream_head_t;
 
 #define IS_CLIENT_STREAM_ID(id) (unsigned int)(((id) & 1) == 0)
@@ -903,6 +969,17 @@ typedef struct st_picoquic_packet_context_t {
     picoquic_packet_t* retransmitted_newest;
     picoquic_packet_t* retransmitted_oldest;
     picoquic_packet_t* preemptive_repeat_ptr;
+    picoquic_packet_t* redundant_repeat_ptr;
+    /* Index of the packets in the pending and retransmitted queues, by sequence number.
+     * The index is a ring of pn_index_size entries, a power of 2. All indexed packets
+     * have numbers between pn_index_min and pn_index_max, and the ring grows if
+     * that range becomes larger than the ring. If the ring cannot grow, the
+     * index is disabled and the queues are searched linearly. */
+    picoquic_packet_t** pn_index;
+    uint64_t pn_index_size;
+    uint64_t pn_index_min;
+    uint64_t pn_index_max;
+    uint64_t pn_index_count;
     /* monitor size of queues */
     uint64_t retransmitted_queue_size;
     /* ECN Counters */
@@ -911,6 +988,7 @@ typedef struct st_picoquic_packet_context_t {
     uint64_t ecn_ce_total_remote;
     /* Flags */
     unsigned int ack_of_ack_requested : 1; /* TODO: Initialized, unused */
+    unsigned int is_pn_index_disabled : 1; /* The index could not be allocated */
 } picoquic_packet_context_t;
 
 /* Per epoch ack context.
@@ -1142,6 +1220,9 @@ typedef struct st_picoquic_path_t {
     unsigned int is_cca_probing_up : 1; /* congestion control algorithm is seeking more bandwidth */
     unsigned int rtt_is_initialized : 1; /* RTT was measured at least once. */
     unsigned int sending_path_cid_blocked_frame : 1; /* Sending a path CID blocked, not acked yet. */
+    unsigned int is_scheduler_candidate : 1; /* Path can be selected by the path scheduler */
+    unsigned int is_scheduler_pacing_ok : 1; /* Candidate path is not blocked by pacing */
+    unsigned int is_scheduler_cwin_ok : 1; /* Candidate path is not blocked by congestion control */
     
     /* Management of retransmissions in a path.
      * The "path_packet" variables are used for the RACK algorithm, per path, to avoid
@@ -1228,6 +1309,9 @@ typedef struct st_picoquic_path_t {
     int selected;
     int nb_delay_outliers;
 
+    /* Path scheduler state */
+    int64_t scheduler_credit; /* Weighted round robin credit */
+
     /* Path quality callback. These variables store the delta set for signaling
      * and the threshold computed based on these deltas and the latest published value.
      */ 
@@ -1397,7 +1481,7 @@ typedef struct st_picoquic_cnx_t {
 
     /* Next time sending data is expected */
     uint64_t next_wake_time;
-    picosplay_node_t cnx_wake_node;
+    picowheel_node_t cnx_wake_node;
     /* Wakeup time requested by the application */
     uint64_t app_wake_time;
     /* TLS context, TLS Send Buffer, streams, epochs */
@@ -1444,6 +1528,8 @@ typedef struct st_picoquic_cnx_t {
     uint64_t nb_spurious;
     uint64_t nb_crypto_key_rotations;
     uint64_t nb_packet_holes_inserted;
+    uint64_t nb_packets_compacted;
+    uint64_t nb_packets_batch_decrypted;
     uint64_t max_ack_delay_remote;
     uint64_t max_ack_gap_remote;
     uint64_t max_ack_delay_local;
@@ -1456,6 +1542,9 @@ typedef struct st_picoquic_cnx_t {
     /* Congestion algorithm */
     picoquic_congestion_algorithm_t const* congestion_alg;
     char const* congestion_alg_option_string;
+    /* Multipath scheduler */
+    picoquic_path_scheduler_t const* path_scheduler;
+    unsigned int is_path_scheduler_waiting : 1; /* ECF decided to wait for the fastest path */
     /* Management of quality signalling updates */
     uint64_t rtt_update_delta;
     uint64_t pacing_rate_update_delta;
@@ -1491,8 +1580,20 @@ typedef struct st_picoquic_cnx_t {
 
     /* Management of streams */
     picosplay_tree_t stream_tree;
+    /* Direct index of the streams of each type by stream rank, used by
+     * picoquic_find_stream. Streams that could not be indexed, e.g., because
+     * their ID is very far from the other streams, are only found in the tree. */
+    picoindex_t stream_index[4];
+    uint64_t nb_streams_not_indexed;
     picoquic_stream_head_t * first_output_stream;
     picoquic_stream_head_t * last_output_stream;
+    /* The output list is ordered by priority levels. The streams of each level are
+     * contiguous in the list, in stream ID order for FIFO levels (odd priority) or
+     * in order of last data sent for round robin levels (even priority). The bitmap
+     * lists the non empty levels, and the last stream of each level is remembered,
+     * so streams can be inserted without walking the list. */
+    uint64_t output_stream_levels[4];
+    picoquic_stream_head_t * output_stream_level_last[256];
     uint64_t high_priority_stream_id;
     uint64_t next_stream_id[4];
     uint64_t priority_limit_for_bypass; /* Bypass CC if dtagram or stream priority lower than this, 0 means never */
@@ -1507,9 +1608,11 @@ typedef struct st_picoquic_cnx_t {
      * picoquic will try sending stream data before the next datagram.
      * This is provisional -- we need to consider managing datagram
      * priorities in a way similar to stream priorities.
+     * Datagrams queued by the application are held in the datagram ring.
      */
     picoquic_misc_frame_header_t* first_datagram;
     picoquic_misc_frame_header_t* last_datagram;
+    picoquic_datagram_ring_t datagram_ring;
     uint64_t datagram_priority;
     int datagram_conflicts_count;
     int datagram_conflicts_max;
@@ -1667,6 +1770,10 @@ picoquic_packet_t* picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx, picoq
     picoquic_packet_t* p, int should_free,
     int add_to_data_repeat_queue);
 void picoquic_dequeue_retransmitted_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p);
+picoquic_packet_t* picoquic_pn_index_find(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number);
+void picoquic_pn_index_free(picoquic_packet_context_t* pkt_ctx);
+int picoquic_redundant_retransmit_as_needed(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time,
+    uint8_t* new_bytes, size_t send_buffer_max_minus_checksum, size_t* length, int* more_data, int* is_pure_ack);
 
 /* Reset the connection context, e.g. after retry */
 int picoquic_reset_cnx(picoquic_cnx_t* cnx, uint64_t current_time);
@@ -1775,6 +1882,11 @@ size_t picoquic_get_checksum_length(picoquic_cnx_t* cnx, picoquic_epoch_enum is_
 
 void picoquic_protect_packet_header(uint8_t* send_buffer, size_t pn_offset, uint8_t first_mask, void* pn_enc);
 
+#define PICOQUIC_PROTECT_BATCH_MAX 64
+void picoquic_protect_batch_open(picoquic_quic_t* quic);
+void picoquic_protect_batch_flush(picoquic_quic_t* quic);
+void picoquic_protect_batch_close(picoquic_quic_t* quic);
+
 size_t picoquic_protect_packet(picoquic_cnx_t* cnx, picoquic_packet_type_enum ptype, uint8_t* bytes, uint64_t sequence_number, size_t length, size_t header_length, uint8_t* send_buffer, size_t send_buffer_max, void* aead_context, void* pn_enc,
     picoquic_path_t* path_x, picoquic_tuple_t* tuple, uint64_t current_time);
 
@@ -2006,11 +2118,21 @@ int picoquic_parse_stream_header(
     uint64_t* stream_id, uint64_t* offset, size_t* data_length, int* fin,
     size_t* consumed);
 
+int picoquic_is_stream_ref_frame(const uint8_t* bytes, size_t bytes_max);
+uint8_t* picoquic_format_stream_ref_frame(uint8_t* bytes, uint8_t* bytes_max,
+    uint64_t stream_id, uint64_t offset, size_t data_length, int fin);
+int picoquic_parse_stream_ref_frame(
+    const uint8_t* bytes, size_t bytes_max,
+    uint64_t* stream_id, uint64_t* offset, size_t* data_length, int* fin,
+    size_t* consumed);
+
 int picoquic_parse_ack_header(
     uint8_t const* bytes, size_t bytes_max,
     uint64_t* num_block, uint64_t* path_id, uint64_t* largest,
     uint64_t* ack_delay, size_t* consumed,
     uint8_t ack_delay_exponent);
+const uint8_t* picoquic_decode_ack_frame(picoquic_cnx_t* cnx, const uint8_t* bytes,
+    const uint8_t* bytes_max, uint64_t current_time, int epoch, int is_ecn, int has_path_id, picoquic_packet_data_t* packet_data);
 const uint8_t* picoquic_decode_crypto_hs_frame(picoquic_cnx_t* cnx, const uint8_t* bytes,
     const uint8_t* bytes_max, picoquic_stream_data_node_t* received_data, int epoch);
 uint8_t* picoquic_format_crypto_hs_frame(picoquic_stream_head_t* stream, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
@@ -2024,7 +2146,14 @@ uint64_t picoquic_cc_increased_window(picoquic_cnx_t* cnx, uint64_t previous_win
 uint8_t* picoquic_format_max_streams_frame_if_needed(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
 void picoquic_stream_data_node_recycle(picoquic_stream_data_node_t* stream_data);
 picoquic_stream_data_node_t* picoquic_stream_data_node_alloc(picoquic_quic_t* quic);
+picoquic_stream_data_node_t* picoquic_stream_data_ref_alloc(picoquic_stream_data_node_t* packet_node);
+void picoquic_stream_data_node_release(picoquic_stream_data_node_t* packet_node);
 void picoquic_clear_stream(picoquic_stream_head_t* stream);
+void picoquic_stream_queue_node_sent(picoquic_stream_head_t* stream, uint64_t end_offset);
+void picoquic_stream_queue_node_free(picoquic_stream_queue_node_t* stream_data, int is_acknowledged);
+void picoquic_stream_release_acked_buffers(picoquic_stream_head_t* stream);
+void picoquic_stream_clear_send_data(picoquic_stream_head_t* stream);
+int picoquic_stream_copy_sent_data(picoquic_stream_head_t* stream, uint64_t offset, size_t length, uint8_t* bytes);
 void picoquic_delete_stream(picoquic_cnx_t * cnx, picoquic_stream_head_t * stream);
 picoquic_local_cnxid_list_t* picoquic_find_or_create_local_cnxid_list(picoquic_cnx_t* cnx, uint64_t unique_path_id, int do_create);
 picoquic_local_cnxid_t* picoquic_create_local_cnxid(picoquic_cnx_t* cnx,
@@ -2058,6 +2187,8 @@ void picoquic_clear_ack_ctx(picoquic_ack_context_t* ack_ctx);
 void picoquic_reset_ack_context(picoquic_ack_context_t* ack_ctx);
 int picoquic_queue_handshake_done_frame(picoquic_cnx_t* cnx);
 uint8_t* picoquic_format_first_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
+uint8_t* picoquic_format_first_queued_datagram_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
+    uint8_t* bytes_max, int* more_data, int* is_pure_ack, uint64_t current_time);
 uint8_t* picoquic_format_ready_datagram_frame(picoquic_cnx_t* cnx, picoquic_path_t * path_x, uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack, int* ret);
 uint8_t* picoquic_decode_datagram_frame_header(uint8_t* bytes, const uint8_t* bytes_max,
     uint8_t* frame_id, uint64_t* length);
@@ -386,108 +386,135 @@ int picoquic_lb_compat_cid_config_parse(picoquic_load_balancer_config_t* lb_conf
     return ret;
 }
 
-int picoquic_lb_compat_cid_config(picoquic_quic_t* quic, picoquic_load_balancer_config_t * lb_config)
+/* Create a CID context from a load balancer configuration. This context is
+ * used by picoquic_lb_compat_cid_generate and picoquic_lb_compat_cid_verify.
+ * Returns NULL if the configuration is not valid or if allocation fails. */
+picoquic_load_balancer_cid_context_t* picoquic_lb_compat_cid_context_create(picoquic_load_balancer_config_t* lb_config)
 {
     int ret = 0;
+    picoquic_load_balancer_cid_context_t* lb_ctx = NULL;
 
-    if (quic->cnx_list != NULL && quic->local_cnxid_length != lb_config->connection_id_length) {
-        /* Error. Changing the CID length now will break existing connections */
-        ret = -1;
-    }
-    else if (quic->cnx_id_callback_fn != NULL && quic->cnx_id_callback_ctx != NULL){
-        /* Error. Some other CID generation is configured, cannot be changed */
+    /* Verify that the method is supported and the parameters are compatible. */
+    if (lb_config->connection_id_length > PICOQUIC_CONNECTION_ID_MAX_SIZE) {
         ret = -1;
     }
     else {
-        /* Verify that the method is supported and the parameters are compatible.
-         * If valid, configure the connection ID generation */
-        if (lb_config->connection_id_length > PICOQUIC_CONNECTION_ID_MAX_SIZE) {
-            ret = -1;
-        }
-        else {
-            switch (lb_config->method) {
-            case picoquic_load_balancer_cid_clear:
-                if (lb_config->server_id_length + 1 > lb_config->connection_id_length) {
-                    ret = -1;
-                }
-                break;
-            case picoquic_load_balancer_cid_stream_cipher:
-                /* Nonce length must be 8 to 16 bytes, CID should be long enough */
-                if (lb_config->nonce_length < 8 || lb_config->nonce_length > 16 ||
-                    lb_config->nonce_length + lb_config->server_id_length + 1 > lb_config->connection_id_length) {
-                    ret = -1;
-                }
-                break;
-            case picoquic_load_balancer_cid_block_cipher:
-                /* CID should include a whole AES-ECB block,
-                 * there should be at least 2 bytes available for uniqueness,
-                 * zero padding length should be 4 bytes for security */
-                if (lb_config->connection_id_length < 17 ||
-                    lb_config->server_id_length > 15) {
-                    ret = -1;
-                }
-                break;
-            default:
-                /* Error, unknown method */
+        switch (lb_config->method) {
+        case picoquic_load_balancer_cid_clear:
+            if (lb_config->server_id_length + 1 > lb_config->connection_id_length) {
+                ret = -1;
+            }
+            break;
+        case picoquic_load_balancer_cid_stream_cipher:
+            /* Nonce length must be 8 to 16 bytes, CID should be long enough */
+            if (lb_config->nonce_length < 8 || lb_config->nonce_length > 16 ||
+                lb_config->nonce_length + lb_config->server_id_length + 1 > lb_config->connection_id_length) {
                 ret = -1;
-                break;
             }
+            break;
+        case picoquic_load_balancer_cid_block_cipher:
+            /* CID should include a whole AES-ECB block,
+             * there should be at least 2 bytes available for uniqueness,
+             * zero padding length should be 4 bytes for security */
+            if (lb_config->connection_id_length < 17 ||
+                lb_config->server_id_length > 15) {
+                ret = -1;
+            }
+            break;
+        default:
+            /* Error, unknown method */
+            ret = -1;
+            break;
         }
-        if (ret == 0) {
-            /* Create a copy */
-            picoquic_load_balancer_cid_context_t* lb_ctx = (picoquic_load_balancer_cid_context_t*)malloc(sizeof(picoquic_load_balancer_cid_context_t));
+    }
+    if (ret == 0) {
+        /* Create a copy */
+        lb_ctx = (picoquic_load_balancer_cid_context_t*)malloc(sizeof(picoquic_load_balancer_cid_context_t));
 
-            if (lb_ctx == NULL) {
-                ret = -1;
+        if (lb_ctx != NULL) {
+            /* if allocated, create the necessary encryption contexts or variables */
+            uint64_t s_id64 = lb_config->server_id64;
+            memset(lb_ctx, 0, sizeof(picoquic_load_balancer_cid_context_t));
+            lb_ctx->method = lb_config->method;
+            lb_ctx->rotation_bits = lb_config->rotation_bits;
+            lb_ctx->first_byte_encodes_length = lb_config->first_byte_encodes_length;
+            lb_ctx->server_id_length = lb_config->server_id_length;
+            lb_ctx->nonce_length = lb_config->nonce_length;
+            lb_ctx->connection_id_length = lb_config->connection_id_length;
+            lb_ctx->server_id64 = lb_config->server_id64;
+            lb_ctx->cid_encryption_context = NULL;
+            lb_ctx->cid_decryption_context = NULL;
+            /* Compute the server ID bytes and set encryption contexts */
+            for (size_t i = 0; i < lb_ctx->server_id_length; i++) {
+                size_t j = lb_ctx->server_id_length - i - 1;
+                lb_ctx->server_id[j] = (uint8_t)s_id64;
+                s_id64 >>= 8;
             }
-            else {
-                /* if allocated, create the necessary encryption contexts or variables */
-                uint64_t s_id64 = lb_config->server_id64;
-                memset(lb_ctx, 0, sizeof(picoquic_load_balancer_cid_context_t));
-                lb_ctx->method = lb_config->method;
-                lb_ctx->rotation_bits = lb_config->rotation_bits;
-                lb_ctx->first_byte_encodes_length = lb_config->first_byte_encodes_length;
-                lb_ctx->server_id_length = lb_config->server_id_length;
-                lb_ctx->nonce_length = lb_config->nonce_length;
-                lb_ctx->connection_id_length = lb_config->connection_id_length;
-                lb_ctx->server_id64 = lb_config->server_id64;
-                lb_ctx->cid_encryption_context = NULL;
-                lb_ctx->cid_decryption_context = NULL;
-                /* Compute the server ID bytes and set encryption contexts */
-                for (size_t i = 0; i < lb_ctx->server_id_length; i++) {
-                    size_t j = lb_ctx->server_id_length - i - 1;
-                    lb_ctx->server_id[j] = (uint8_t)s_id64;
-                    s_id64 >>= 8;
-                }
-                if (s_id64 != 0) {
-                    /* Server ID not long enough to encode actual value */
+            if (s_id64 != 0) {
+                /* Server ID not long enough to encode actual value */
+                ret = -1;
+            } else if (lb_config->method == picoquic_load_balancer_cid_stream_cipher ||
+                lb_config->method == picoquic_load_balancer_cid_block_cipher) {
+                lb_ctx->cid_encryption_context = picoquic_aes128_ecb_create(1, lb_config->cid_encryption_key);
+                if (lb_ctx->cid_encryption_context == NULL) {
                     ret = -1;
-                } else if (lb_config->method == picoquic_load_balancer_cid_stream_cipher ||
-                    lb_config->method == picoquic_load_balancer_cid_block_cipher) {
-                    lb_ctx->cid_encryption_context = picoquic_aes128_ecb_create(1, lb_config->cid_encryption_key);
-                    if (lb_ctx->cid_encryption_context == NULL) {
+                }
+                else if (lb_config->method == picoquic_load_balancer_cid_block_cipher) {
+                    lb_ctx->cid_decryption_context = picoquic_aes128_ecb_create(0, lb_config->cid_encryption_key);
+                    if (lb_ctx->cid_decryption_context == NULL) {
+                        picoquic_aes128_ecb_free(lb_ctx->cid_encryption_context);
+                        lb_ctx->cid_encryption_context = NULL;
                         ret = -1;
                     }
-                    else if (lb_config->method == picoquic_load_balancer_cid_block_cipher) {
-                        lb_ctx->cid_decryption_context = picoquic_aes128_ecb_create(0, lb_config->cid_encryption_key);
-                        if (lb_ctx->cid_decryption_context == NULL) {
-                            picoquic_aes128_ecb_free(lb_ctx->cid_encryption_context);
-                            lb_ctx->cid_encryption_context = NULL;
-                            ret = -1;
-                        }
-                    }
-                }
-                if (ret != 0) {
-                    /* if context allocation failed, free the copy */
-                    free(lb_ctx);
-                    lb_ctx = NULL;
-                } else {
-                    /* Configure the CID generation */
-                    quic->local_cnxid_length = lb_ctx->connection_id_length;
-                    quic->cnx_id_callback_fn = picoquic_lb_compat_cid_generate;
-                    quic->cnx_id_callback_ctx = (void*)lb_ctx;
                 }
             }
+            if (ret != 0) {
+                /* if context allocation failed, free the copy */
+                free(lb_ctx);
+                lb_ctx = NULL;
+            }
+        }
+    }
+
+    return lb_ctx;
+}
+
+void picoquic_lb_compat_cid_context_free(picoquic_load_balancer_cid_context_t* lb_ctx)
+{
+    /* Release the encryption contexts so as to avoid memory leaks */
+    if (lb_ctx->cid_encryption_context != NULL) {
+        picoquic_aes128_ecb_free(lb_ctx->cid_encryption_context);
+    }
+    if (lb_ctx->cid_decryption_context != NULL) {
+        picoquic_aes128_ecb_free(lb_ctx->cid_decryption_context);
+    }
+    /* Free the data */
+    free(lb_ctx);
+}
+
+int picoquic_lb_compat_cid_config(picoquic_quic_t* quic, picoquic_load_balancer_config_t * lb_config)
+{
+    int ret = 0;
+
+    if (quic->cnx_list != NULL && quic->local_cnxid_length != lb_config->connection_id_length) {
+        /* Error. Changing the CID length now will break existing connections */
+        ret = -1;
+    }
+    else if (quic->cnx_id_callback_fn != NULL && quic->cnx_id_callback_ctx != NULL){
+        /* Error. Some other CID generation is configured, cannot be changed */
+        ret = -1;
+    }
+    else {
+        picoquic_load_balancer_cid_context_t* lb_ctx = picoquic_lb_compat_cid_context_create(lb_config);
+
+        if (lb_ctx == NULL) {
+            ret = -1;
+        }
+        else {
+            /* Configure the CID generation */
+            quic->local_cnxid_length = lb_ctx->connection_id_length;
+            quic->cnx_id_callback_fn = picoquic_lb_compat_cid_generate;
+            quic->cnx_id_callback_ctx = (void*)lb_ctx;
         }
     }
 
@@ -498,18 +525,9 @@ void picoquic_lb_compat_cid_config_free(picoquic_quic_t* quic)
 {
     if (quic->cnx_id_callback_fn == picoquic_lb_compat_cid_generate &&
         quic->cnx_id_callback_ctx != NULL) {
-        picoquic_load_balancer_cid_context_t* lb_ctx = (picoquic_load_balancer_cid_context_t*)quic->cnx_id_callback_ctx;
-        /* Release the encryption contexts so as to avoid memory leaks */
-        if (lb_ctx->cid_encryption_context != NULL) {
-            picoquic_aes128_ecb_free(lb_ctx->cid_encryption_context);
-        }
-        if (lb_ctx->cid_decryption_context != NULL) {
-            picoquic_aes128_ecb_free(lb_ctx->cid_decryption_context);
-        }
-        /* Free the data */
-        free(lb_ctx);
+        picoquic_lb_compat_cid_context_free((picoquic_load_balancer_cid_context_t*)quic->cnx_id_callback_ctx);
         /* Reset the Quic context */
         quic->cnx_id_callback_fn = NULL;
         quic->cnx_id_callback_ctx = NULL;
     }
-}
\ No newline at end of file
+}
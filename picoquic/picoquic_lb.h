@@ -73,6 +73,9 @@ typedef struct st_picoquic_load_balancer_cid_context_t {
     void* cid_decryption_context; /* used in block cipher mode */
 } picoquic_load_balancer_cid_context_t;
 
+picoquic_load_balancer_cid_context_t* picoquic_lb_compat_cid_context_create(picoquic_load_balancer_config_t* lb_config);
+void picoquic_lb_compat_cid_context_free(picoquic_load_balancer_cid_context_t* lb_ctx);
+
 void picoquic_lb_compat_cid_generate(picoquic_quic_t* quic, picoquic_connection_id_t cnx_id_local, picoquic_connection_id_t cnx_id_remote, void* cnx_id_cb_data, picoquic_connection_id_t* cnx_id_returned);
 uint64_t picoquic_lb_compat_cid_verify(picoquic_quic_t* quic, void* cnx_id_cb_data, picoquic_connection_id_t const* cnx_id);
 #ifdef __cplusplus
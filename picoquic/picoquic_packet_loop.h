@@ -34,6 +34,9 @@ extern "C" {
 #define PICOQUIC_PACKET_LOOP_RECV_MAX 10
 #define PICOQUIC_PACKET_LOOP_SEND_MAX 10
 #define PICOQUIC_PACKET_LOOP_SEND_DELAY_MAX 2500
+#define PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX 64
+#define PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX 64
+#define PICOQUIC_PACKET_LOOP_RECV_COALESCED_MAX 0x10000
 
 typedef struct st_picoquic_socket_ctx_t {
     SOCKET_TYPE fd;
@@ -45,6 +48,7 @@ typedef struct st_picoquic_socket_ctx_t {
     unsigned int is_started : 1;
     unsigned int supports_udp_send_coalesced : 1;
     unsigned int supports_udp_recv_coalesced : 1;
+    unsigned int reuse_port : 1;
     /* Receive data buffer and fields */
     size_t recv_buffer_size;
     uint8_t* recv_buffer;
@@ -75,7 +79,7 @@ typedef struct st_picoquic_socket_ctx_t {
  */
 typedef enum {
     picoquic_packet_loop_ready = 0, /* Argument type: packet loop options */
-    picoquic_packet_loop_after_receive, /* Argument type size_t*: nb packets received */
+    picoquic_packet_loop_after_receive, /* Argument type size_t*: nb bytes received, or nb packets if recv_batch_size > 1 */
     picoquic_packet_loop_after_send, /* Argument type size_t*: nb packets sent */
     picoquic_packet_loop_port_update, /* argument type struct_sockaddr*: new address for wakeup */
     picoquic_packet_loop_time_check, /* argument type packet_loop_time_check_arg_t*. Optional. */
@@ -111,6 +115,13 @@ typedef struct st_packet_loop_time_check_arg_t {
 
 typedef int (*picoquic_packet_loop_cb_fn)(picoquic_quic_t * quic, picoquic_packet_loop_cb_enum cb_mode, void * callback_ctx, void * callback_argv);
 
+/* Packet steering function, called for each received packet before it is
+ * submitted to the stack. Returns 0 if the packet should be processed by the
+ * local QUIC context, or a non zero value if the packet was consumed, for
+ * example forwarded to the thread that owns the connection. */
+typedef int (*picoquic_packet_loop_steer_fn)(void* steer_ctx, uint8_t* bytes, size_t length,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to, unsigned char received_ecn);
+
 /* Packet loop option list shows support by application of optional features.
  * It is set to null initially, and then passed to the socket as argument to
  * the "ready" callback. Application should set the flags corresponding to
@@ -135,6 +146,40 @@ typedef struct st_picoquic_packet_loop_param_t {
     int prefer_extra_socket;
     int simulate_eio;
     size_t send_length_max;
+    /* Batched receive, Linux only. If recv_batch_size > 1, the loop receives
+     * up to that many datagrams per system call using recvmmsg, capped at
+     * PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX. The after_receive callback is
+     * then issued once per batch, with the number of datagrams as argument.
+     * On other platforms the value is ignored. */
+    int recv_batch_size;
+    /* Linux only. If use_epoll is set, the loop registers the sockets and
+     * the wake up pipe once in an epoll set, and waits with microsecond
+     * precision timeouts instead of calling select at each iteration.
+     * On other platforms, or if epoll cannot be set up, the loop uses select. */
+    int use_epoll;
+    /* Linux only. If use_io_uring is set and the kernel supports it, the
+     * loop uses multishot receive with a provided buffer ring and queues
+     * the sendmsg requests in an io_uring instead of calling the socket API.
+     * If io_uring is not available, the other settings apply. The loop
+     * sets is_io_uring_used if it runs the io_uring version. */
+    int use_io_uring;
+    int is_io_uring_used;
+    /* Batched send, Linux only. If send_batch_size > 1, the packets or trains
+     * of packets prepared in one pass of the loop are accumulated, possibly
+     * for many different peers, and sent with sendmmsg, up to that many
+     * messages per system call, capped at PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX.
+     * On other platforms the value is ignored. */
+    int send_batch_size;
+    /* Test hook for batched sends: the next simulate_partial_send calls
+     * to sendmmsg with several messages only send half of them. */
+    int simulate_partial_send;
+    /* If reuse_port is set, the sockets bound to local_port are opened with
+     * SO_REUSEPORT, so that several loops can share the same port. This is
+     * used by the sharded server, see picoquic_shard.h. */
+    int reuse_port;
+    /* Optional packet steering, see picoquic_packet_loop_steer_fn */
+    picoquic_packet_loop_steer_fn steer_fn;
+    void* steer_ctx;
 } picoquic_packet_loop_param_t;
 
 int picoquic_packet_loop_v2(picoquic_quic_t* quic,
@@ -176,9 +221,12 @@ typedef struct st_picoquic_network_thread_ctx_t {
     HANDLE wake_up_event;
 #else
     int wake_up_pipe_fd[2];
+    int epoll_fd;
+    int timer_fd;
 #endif
     int is_threaded;
     int wake_up_defined;
+    int epoll_defined;
     volatile int thread_is_ready;
     volatile int thread_should_close;
     volatile int thread_is_closed;
@@ -305,10 +353,35 @@ int picoquic_packet_loop_win(picoquic_quic_t* quic,
     void* loop_callback_ctx);
 #endif
 
+#ifdef PICOQUIC_HAVE_IO_URING
+/* io_uring version of the packet loop, see uringloop.c. It is called by
+ * picoquic_packet_loop_v3 if use_io_uring is set and supported. */
+int picoquic_packet_loop_uring_supported(void);
+void* picoquic_packet_loop_uring(void* v_ctx);
+#endif
+
+/* Split a coalesced receive buffer in segments and submit them to the stack */
+int picoquic_packet_loop_submit_coalesced(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+    uint8_t* bytes, size_t length, size_t segment_size,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to,
+    unsigned char received_ecn, picoquic_cnx_t** last_cnx, uint64_t current_time);
+
+/* Error handling shared by the send paths of the packet loops */
+void picoquic_packet_loop_get_cnx_key(picoquic_cnx_t* cnx, picoquic_connection_id_t* cnx_key);
+picoquic_cnx_t* picoquic_packet_loop_find_cnx(picoquic_quic_t* quic, picoquic_cnx_t* cnx,
+    picoquic_connection_id_t* cnx_key, struct sockaddr* peer_addr);
+void picoquic_packet_loop_send_error(picoquic_quic_t* quic, picoquic_cnx_t* cnx,
+    picoquic_connection_id_t* log_cid, SOCKET_TYPE send_socket,
+    struct sockaddr_storage* peer_addr, struct sockaddr_storage* local_addr, int if_index,
+    uint8_t* send_buffer, size_t send_length, size_t send_msg_size,
+    int sock_ret, int sock_err, size_t** send_msg_ptr, uint64_t current_time);
+
 /* Following declarations are used for unit tests. */
 void picoquic_packet_loop_close_socket(picoquic_socket_ctx_t* s_ctx);
 int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
     int do_not_use_gso, picoquic_socket_ctx_t* s_ctx);
+int picoquic_packet_loop_open_sockets_ex(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
+    int do_not_use_gso, int reuse_port, picoquic_socket_ctx_t* s_ctx);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,46 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PICOQUIC_PATH_SCHEDULER_H
+#define PICOQUIC_PATH_SCHEDULER_H
+
+#include "picoquic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PICOQUIC_DEFAULT_PATH_SCHEDULER_ID "default"
+#define PICOQUIC_MINRTT_PATH_SCHEDULER_ID "minrtt"
+#define PICOQUIC_ECF_PATH_SCHEDULER_ID "ecf"
+#define PICOQUIC_WEIGHTED_PATH_SCHEDULER_ID "weighted"
+#define PICOQUIC_REDUNDANT_PATH_SCHEDULER_ID "redundant"
+
+extern picoquic_path_scheduler_t const* picoquic_default_path_scheduler;
+extern picoquic_path_scheduler_t const* picoquic_minrtt_path_scheduler;
+extern picoquic_path_scheduler_t const* picoquic_ecf_path_scheduler;
+extern picoquic_path_scheduler_t const* picoquic_weighted_path_scheduler;
+extern picoquic_path_scheduler_t const* picoquic_redundant_path_scheduler;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
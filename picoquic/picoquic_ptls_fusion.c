@@ -28,6 +28,7 @@
 #include "ws2ipdef.h"
 #pragma warning(disable:4100)
 #endif
+#include <string.h>
 #include <picotls.h>
 #include "picoquic_crypto_provider_api.h"
 
@@ -57,6 +58,41 @@ NULL };
 struct st_ptls_cipher_suite_t picoquic_fusion_aes256gcmsha384 = { PTLS_CIPHER_SUITE_AES_256_GCM_SHA384, &ptls_fusion_aes256gcm,
 NULL };
 
+/* Batched encryption with fusion.
+ * The fusion AES-GCM engine can compute the header protection mask as a
+ * "supplementary" AES block, interleaved with the AES-CTR and GHASH
+ * pipeline that encrypts the payload. The masks of the whole train are
+ * thus obtained without any separate call to the header protection cipher.
+ */
+static void picoquic_fusion_aead_encrypt_batch(picoquic_aead_batch_entry_t* entries, size_t nb_entries)
+{
+    for (size_t i = 0; i < nb_entries; i++) {
+        picoquic_aead_batch_entry_t* entry = &entries[i];
+        ptls_aead_context_t* aead = (ptls_aead_context_t*)entry->aead_ctx;
+        uint8_t* payload = entry->packet + entry->header_length;
+        ptls_aead_supplementary_encryption_t supp = {
+            (ptls_cipher_context_t*)entry->pn_enc, entry->packet + entry->pn_offset + 4 };
+
+        if (entry->is_multipath) {
+            uint8_t path_id32[4];
+
+            path_id32[0] = (uint8_t)(entry->path_id >> 24);
+            path_id32[1] = (uint8_t)(entry->path_id >> 16);
+            path_id32[2] = (uint8_t)(entry->path_id >> 8);
+            path_id32[3] = (uint8_t)(entry->path_id);
+            ptls_aead_xor_iv(aead, path_id32, sizeof(path_id32));
+            ptls_aead_encrypt_s(aead, payload, payload, entry->payload_length, entry->sequence_number,
+                entry->packet, entry->header_length, &supp);
+            ptls_aead_xor_iv(aead, path_id32, sizeof(path_id32));
+        }
+        else {
+            ptls_aead_encrypt_s(aead, payload, payload, entry->payload_length, entry->sequence_number,
+                entry->packet, entry->header_length, &supp);
+        }
+        memcpy(entry->hp_mask, supp.output, sizeof(entry->hp_mask));
+    }
+}
+
 void picoquic_ptls_fusion_load(int unload)
 {
     if (unload) {
@@ -70,6 +106,8 @@ void picoquic_ptls_fusion_load(int unload)
             if ((picoquic_fusion_aes256gcmsha384.hash = picoquic_get_hash_algorithm_by_name("SHA384")) != NULL) {
                 picoquic_register_ciphersuite(&picoquic_fusion_aes256gcmsha384, 0);
             }
+            picoquic_register_aead_encrypt_batch_fn(&ptls_fusion_aes128gcm, picoquic_fusion_aead_encrypt_batch);
+            picoquic_register_aead_encrypt_batch_fn(&ptls_fusion_aes256gcm, picoquic_fusion_aead_encrypt_batch);
         }
     }
 }
@@ -0,0 +1,104 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PICOQUIC_SHARD_H
+#define PICOQUIC_SHARD_H
+
+#include "picoquic.h"
+#include "picoquic_packet_loop.h"
+#include "picoquic_lb.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sharded server.
+ *
+ * A sharded server runs N network threads, each with its own QUIC context
+ * and its own set of sockets, all bound to the same port with SO_REUSEPORT.
+ * The kernel distributes incoming packets between the sockets based on
+ * the addresses and ports, so that all packets of a 4-tuple reach the
+ * same shard, which handles the handshake.
+ *
+ * Each QUIC context is configured to generate connection IDs with the
+ * load balancer encoding of picoquic_lb.h, using the shard index as
+ * server ID. When a packet with a short header arrives at the wrong shard,
+ * for example after a NAT rebinding or a migration, the shard decodes the
+ * server ID from the destination CID and forwards the packet to the
+ * shard that owns the connection.
+ *
+ * Each shard runs the loop callback provided by the application, with
+ * the callback context provided for that shard. Other threads can post
+ * work to a shard with picoquic_shard_post, or to the shard that owns a
+ * connection with picoquic_shard_post_by_cid. The work function is then
+ * called in the shard's network thread, when it processes the wake up
+ * event, before the application's wake up callback.
+ *
+ * SO_REUSEPORT must be supported by the platform, and the local port
+ * must be specified in the loop parameters.
+ */
+
+typedef struct st_picoquic_sharded_server_t picoquic_sharded_server_t;
+
+/* Work function, called in the network thread of the shard with the
+ * QUIC context of that shard. The return code is handled like the
+ * return code of the loop callback, i.e., a non zero value stops the loop.
+ * If the server is deleted before the work was executed, the function
+ * is called with a NULL QUIC context, so the work context can be freed. */
+typedef int (*picoquic_shard_work_fn)(picoquic_quic_t* quic, void* work_ctx);
+
+/* Start the sharded server.
+ * - quic: array of nb_shards QUIC contexts, owned by the application.
+ * - lb_config: CID encoding used to route packets. The server ID in the
+ *   configuration is replaced by the shard index. If NULL, the server
+ *   uses the clear encoding with a one byte server ID and CID of the
+ *   length configured in the first QUIC context.
+ * - param: loop parameters, copied for each shard.
+ * - loop_callback_ctx: array of nb_shards callback contexts, or NULL.
+ * Returns NULL and sets *ret if the server cannot be started.
+ */
+picoquic_sharded_server_t* picoquic_start_sharded_server(int nb_shards, picoquic_quic_t** quic,
+    picoquic_load_balancer_config_t* lb_config, picoquic_packet_loop_param_t* param,
+    picoquic_packet_loop_cb_fn loop_callback, void** loop_callback_ctx, int* ret);
+void picoquic_delete_sharded_server(picoquic_sharded_server_t* server);
+
+int picoquic_sharded_server_nb_shards(picoquic_sharded_server_t* server);
+picoquic_network_thread_ctx_t* picoquic_sharded_server_thread(picoquic_sharded_server_t* server, int shard_id);
+
+/* Find the shard that owns a connection ID. Returns -1 if the CID was
+ * not generated by one of the shards. Can be called from any thread. */
+int picoquic_shard_from_cid(picoquic_sharded_server_t* server, const picoquic_connection_id_t* cid);
+
+/* Thread safe API to post work to a shard. These functions must not be
+ * called after, or concurrently with, picoquic_delete_sharded_server. */
+int picoquic_shard_post(picoquic_sharded_server_t* server, int shard_id, picoquic_shard_work_fn work_fn, void* work_ctx);
+int picoquic_shard_post_by_cid(picoquic_sharded_server_t* server, const picoquic_connection_id_t* cid,
+    picoquic_shard_work_fn work_fn, void* work_ctx);
+
+/* Statistics, used in tests */
+void picoquic_shard_get_forwarding_stats(picoquic_sharded_server_t* server, int shard_id,
+    uint64_t* nb_forwarded, uint64_t* nb_received_forwarded, uint64_t* nb_dropped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOQUIC_SHARD_H */
@@ -137,6 +137,8 @@ void picoquic_log_quic_pdu(picoquic_quic_t* quic, int receiving, uint64_t curren
 
 /* Close the resource allocated for logs in quic context */
 void picoquic_log_close_logs(picoquic_quic_t* quic);
+/* Hand the ring of the asynchronous binlog writer back to the writer thread */
+void picoquic_binlog_ring_release(picoquic_quic_t* quic);
 
 /* Log an event relating to a specific connection */
 void picoquic_log_app_message(picoquic_cnx_t* cnx, const char* fmt, ...);
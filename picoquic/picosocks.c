@@ -486,6 +486,18 @@ void picoquic_socks_cmsg_parse(
             }
 #endif
         }
+#ifdef UDP_GRO
+        else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            /* The kernel coalesced several datagrams, all of the same
+             * size except possibly the last one. The segment size is
+             * passed as an int. */
+            if (udp_coalesced_size != NULL) {
+                int gso_size = 0;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(int));
+                *udp_coalesced_size = (gso_size > 0) ? (size_t)gso_size : 0;
+            }
+        }
+#endif
     }
 #endif
 }
@@ -960,6 +972,18 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     int* dest_if,
     unsigned char* received_ecn,
     uint8_t* buffer, int buffer_max)
+{
+    return picoquic_recvmsg_ex(fd, addr_from, addr_dest, dest_if, received_ecn,
+        buffer, buffer_max, NULL);
+}
+
+int picoquic_recvmsg_ex(SOCKET_TYPE fd,
+    struct sockaddr_storage* addr_from,
+    struct sockaddr_storage* addr_dest,
+    int* dest_if,
+    unsigned char* received_ecn,
+    uint8_t* buffer, int buffer_max,
+    size_t* udp_coalesced_size)
 #ifdef _WINDOWS
 {
     GUID WSARecvMsg_GUID = WSAID_WSARECVMSG;
@@ -981,6 +1005,10 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
         *received_ecn = 0;
     }
 
+    if (udp_coalesced_size != NULL) {
+        *udp_coalesced_size = 0;
+    }
+
     nResult = WSAIoctl(fd, SIO_GET_EXTENSION_FUNCTION_POINTER,
         &WSARecvMsg_GUID, sizeof WSARecvMsg_GUID,
         &WSARecvMsg, sizeof WSARecvMsg,
@@ -1012,7 +1040,7 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
             bytes_recv = -1;
         } else {
             bytes_recv = NumberOfBytes;
-            picoquic_socks_cmsg_parse(&msg, addr_dest, dest_if, received_ecn, NULL);
+            picoquic_socks_cmsg_parse(&msg, addr_dest, dest_if, received_ecn, udp_coalesced_size);
         }
     }
 
@@ -1029,6 +1057,10 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
         *dest_if = 0;
     }
 
+    if (udp_coalesced_size != NULL) {
+        *udp_coalesced_size = 0;
+    }
+
     dataBuf.iov_base = (char*)buffer;
     dataBuf.iov_len = buffer_max;
 
@@ -1045,7 +1077,7 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     if (bytes_recv <= 0) {
         addr_from->ss_family = 0;
     } else {
-        picoquic_socks_cmsg_parse(&msg, addr_dest, dest_if, received_ecn, NULL);
+        picoquic_socks_cmsg_parse(&msg, addr_dest, dest_if, received_ecn, udp_coalesced_size);
     }
 
     return bytes_recv;
@@ -216,6 +216,18 @@ int picoquic_recvmsg(SOCKET_TYPE fd,
     unsigned char* received_ecn,
     uint8_t* buffer, int buffer_max);
 
+/* Same as picoquic_recvmsg, but also returns the segment size if the
+ * network stack coalesced several datagrams in the buffer (GRO on Linux,
+ * URO on Windows), or 0 if the buffer holds a single datagram.
+ */
+int picoquic_recvmsg_ex(SOCKET_TYPE fd,
+    struct sockaddr_storage* addr_from,
+    struct sockaddr_storage* addr_dest,
+    int* dest_if,
+    unsigned char* received_ecn,
+    uint8_t* buffer, int buffer_max,
+    size_t* udp_coalesced_size);
+
 int picoquic_sendmsg(SOCKET_TYPE fd,
     struct sockaddr* addr_dest,
     struct sockaddr* addr_from,
@@ -0,0 +1,262 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include "picowheel.h"
+#include "picoquic_utils.h"
+
+/* Slot numbers are stored in the node as 1 + level*64 + index,
+ * so that a node set to zero is not in the wheel. */
+#define PICOWHEEL_LATE_SLOT (PICOWHEEL_NB_LEVELS * PICOWHEEL_NB_SLOTS + 1)
+
+static unsigned int picowheel_msb(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - (unsigned int)__builtin_clzll(x);
+#else
+    unsigned int n = 0;
+    if (x >= ((uint64_t)1 << 32)) { n += 32; x >>= 32; }
+    if (x >= ((uint64_t)1 << 16)) { n += 16; x >>= 16; }
+    if (x >= ((uint64_t)1 << 8)) { n += 8; x >>= 8; }
+    if (x >= ((uint64_t)1 << 4)) { n += 4; x >>= 4; }
+    if (x >= ((uint64_t)1 << 2)) { n += 2; x >>= 2; }
+    if (x >= ((uint64_t)1 << 1)) { n += 1; }
+    return n;
+#endif
+}
+
+static unsigned int picowheel_lsb(uint64_t x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned int)__builtin_ctzll(x);
+#else
+    return picowheel_msb(x & (~x + 1));
+#endif
+}
+
+static void picowheel_list_append(picowheel_list_t* list, picowheel_node_t* node)
+{
+    node->next = NULL;
+    node->previous = list->last;
+    if (list->last == NULL) {
+        list->first = node;
+    }
+    else {
+        list->last->next = node;
+    }
+    list->last = node;
+}
+
+static void picowheel_list_unlink(picowheel_list_t* list, picowheel_node_t* node)
+{
+    if (node->previous == NULL) {
+        list->first = node->next;
+    }
+    else {
+        node->previous->next = node->next;
+    }
+    if (node->next == NULL) {
+        list->last = node->previous;
+    }
+    else {
+        node->next->previous = node->previous;
+    }
+    node->next = NULL;
+    node->previous = NULL;
+}
+
+/* Place a node whose wake time is not lower than the wheel time. */
+static void picowheel_place(picowheel_t* wheel, picowheel_node_t* node)
+{
+    uint64_t delta = node->wake_time ^ wheel->wheel_time;
+    unsigned int level = (delta == 0) ? 0 : picowheel_msb(delta) / PICOWHEEL_SLOT_BITS;
+    unsigned int index = (unsigned int)(node->wake_time >> (level * PICOWHEEL_SLOT_BITS)) & (PICOWHEEL_NB_SLOTS - 1);
+    unsigned int slot = level * PICOWHEEL_NB_SLOTS + index;
+
+    picowheel_list_append(&wheel->slots[slot], node);
+    wheel->occupied[level] |= ((uint64_t)1) << index;
+    node->slot = slot + 1;
+}
+
+/* Nodes inserted before the wheel time are kept in a splay tree. Nodes
+ * with the same wake time stay in insertion order. */
+static void* picowheel_late_node_value(picosplay_node_t* late_node)
+{
+    return (late_node == NULL) ? NULL : (void*)((char*)late_node - offsetof(struct st_picowheel_node_t, late_node));
+}
+
+static int64_t picowheel_late_compare(void* l, void* r)
+{
+    const uint64_t ltime = ((picowheel_node_t*)l)->wake_time;
+    const uint64_t rtime = ((picowheel_node_t*)r)->wake_time;
+    if (ltime < rtime) return -1;
+    if (ltime > rtime) return 1;
+    return 0;
+}
+
+static picosplay_node_t* picowheel_late_create_node(void* v_node)
+{
+    return &((picowheel_node_t*)v_node)->late_node;
+}
+
+static void picowheel_late_delete_node(void* tree, picosplay_node_t* late_node)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(tree);
+#endif
+    memset(late_node, 0, sizeof(picosplay_node_t));
+}
+
+/* Start of the first occupied slot at the given level */
+static uint64_t picowheel_slot_start(picowheel_t* wheel, unsigned int level)
+{
+    unsigned int index = picowheel_lsb(wheel->occupied[level]);
+    unsigned int shift = level * PICOWHEEL_SLOT_BITS;
+    uint64_t high_mask = (shift + PICOWHEEL_SLOT_BITS >= 64) ? 0 :
+        ~((((uint64_t)1) << (shift + PICOWHEEL_SLOT_BITS)) - 1);
+
+    return (wheel->wheel_time & high_mask) | (((uint64_t)index) << shift);
+}
+
+/* Move the wheel to the beginning of the first occupied slot at
+ * the given level, and place the nodes of that slot in the lower levels.
+ * Only called when all lower levels are empty. */
+static void picowheel_cascade(picowheel_t* wheel, unsigned int level)
+{
+    unsigned int index = picowheel_lsb(wheel->occupied[level]);
+    picowheel_list_t* list = &wheel->slots[level * PICOWHEEL_NB_SLOTS + index];
+    picowheel_node_t* node = list->first;
+
+    wheel->wheel_time = picowheel_slot_start(wheel, level);
+    wheel->occupied[level] &= ~(((uint64_t)1) << index);
+    wheel->slot_first = NULL;
+    list->first = NULL;
+    list->last = NULL;
+
+    while (node != NULL) {
+        picowheel_node_t* next = node->next;
+        picowheel_place(wheel, node);
+        node = next;
+    }
+}
+
+void picowheel_init(picowheel_t* wheel)
+{
+    memset(wheel, 0, sizeof(picowheel_t));
+    picosplay_init_tree(&wheel->late, picowheel_late_compare, picowheel_late_create_node,
+        picowheel_late_delete_node, picowheel_late_node_value);
+}
+
+/* Find the earliest node of the first occupied slot at the given level,
+ * without moving the wheel. The first of several nodes with the same
+ * wake time is the first inserted. */
+static picowheel_node_t* picowheel_scan_slot(picowheel_t* wheel, unsigned int level)
+{
+    unsigned int slot = level * PICOWHEEL_NB_SLOTS + picowheel_lsb(wheel->occupied[level]);
+
+    if (wheel->slot_first == NULL || wheel->slot_first->slot != slot + 1) {
+        picowheel_node_t* node = wheel->slots[slot].first;
+
+        wheel->slot_first = node;
+        while (node != NULL) {
+            if (node->wake_time < wheel->slot_first->wake_time) {
+                wheel->slot_first = node;
+            }
+            node = node->next;
+        }
+    }
+
+    return wheel->slot_first;
+}
+
+void picowheel_insert(picowheel_t* wheel, picowheel_node_t* node, uint64_t wake_time)
+{
+    node->wake_time = wake_time;
+    if (wheel->size == 0 && wake_time < wheel->wheel_time) {
+        /* The wheel is empty, so it can move back */
+        wheel->wheel_time = wake_time;
+    }
+    if (wake_time < wheel->wheel_time) {
+        picosplay_insert(&wheel->late, node);
+        node->slot = PICOWHEEL_LATE_SLOT;
+    }
+    else {
+        picowheel_place(wheel, node);
+        if (wheel->slot_first != NULL && wheel->slot_first->slot == node->slot &&
+            wake_time < wheel->slot_first->wake_time) {
+            wheel->slot_first = node;
+        }
+    }
+    wheel->size++;
+}
+
+void picowheel_remove(picowheel_t* wheel, picowheel_node_t* node)
+{
+    if (node->slot == PICOWHEEL_LATE_SLOT) {
+        picosplay_delete_hint(&wheel->late, &node->late_node);
+    }
+    else if (node->slot != 0) {
+        unsigned int slot = node->slot - 1;
+        picowheel_list_t* list = &wheel->slots[slot];
+
+        picowheel_list_unlink(list, node);
+        if (list->first == NULL) {
+            wheel->occupied[slot / PICOWHEEL_NB_SLOTS] &= ~(((uint64_t)1) << (slot % PICOWHEEL_NB_SLOTS));
+        }
+    }
+    else {
+        return;
+    }
+    if (wheel->slot_first == node) {
+        wheel->slot_first = NULL;
+    }
+    node->slot = 0;
+    wheel->size--;
+}
+
+picowheel_node_t* picowheel_first(picowheel_t* wheel, uint64_t current_time)
+{
+    picowheel_node_t* node = (picowheel_node_t*)picowheel_late_node_value(picosplay_first(&wheel->late));
+
+    while (node == NULL) {
+        unsigned int level = 0;
+
+        while (level < PICOWHEEL_NB_LEVELS && wheel->occupied[level] == 0) {
+            level++;
+        }
+        if (level >= PICOWHEEL_NB_LEVELS) {
+            break;
+        }
+        else if (level == 0) {
+            node = wheel->slots[picowheel_lsb(wheel->occupied[0])].first;
+        }
+        else if (picowheel_slot_start(wheel, level) > current_time) {
+            /* Do not move the wheel past the current time */
+            node = picowheel_scan_slot(wheel, level);
+        }
+        else {
+            picowheel_cascade(wheel, level);
+        }
+    }
+
+    return node;
+}
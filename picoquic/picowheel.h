@@ -0,0 +1,99 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef PICOWHEEL_H
+#define PICOWHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "picosplay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Hierarchical timing wheel.
+ *
+ * The wheel keeps nodes sorted by wake time, with microsecond resolution.
+ * Level 0 has 64 slots of 1 microsecond, level 1 has 64 slots of 64
+ * microseconds, and so on, each level being 64 times coarser than the
+ * previous one, until the 11th level covers the full 64 bits range.
+ *
+ * A node is placed at the level of the highest 6 bits group in which its
+ * wake time differs from the current position of the wheel. When
+ * all the lower levels are empty, the first occupied slot of the lowest
+ * level is "cascaded": the wheel position moves to the beginning of that
+ * slot, and the nodes are placed again in the lower levels. Each node
+ * thus moves at most 10 times, and insertion, deletion and retrieval
+ * of the first node cost O(1).
+ *
+ * The wheel position never moves past the current time passed to
+ * picowheel_first. If the first occupied slot starts later, it is not
+ * cascaded, and its earliest node is found by scanning the slot. The
+ * result of the scan is kept until the slot changes. Nodes inserted later
+ * with a wake time before that slot thus still go in the wheel.
+ *
+ * Nodes with the same wake time are retrieved in the order in which they
+ * were inserted, which is the same order as with a splay tree. Nodes
+ * inserted with a wake time earlier than the position of the wheel, i.e.,
+ * already late, are rare. They are kept in a splay tree, which is always
+ * served first.
+ *
+ * The node structure is meant to be embedded in the object being
+ * scheduled. A node set to all zeroes is not in the wheel, and it is
+ * safe to remove it.
+ */
+#define PICOWHEEL_SLOT_BITS 6
+#define PICOWHEEL_NB_SLOTS (1 << PICOWHEEL_SLOT_BITS)
+#define PICOWHEEL_NB_LEVELS ((64 + PICOWHEEL_SLOT_BITS - 1) / PICOWHEEL_SLOT_BITS)
+
+typedef struct st_picowheel_node_t {
+    struct st_picowheel_node_t* next;
+    struct st_picowheel_node_t* previous;
+    uint64_t wake_time;
+    unsigned int slot; /* 0 if not in the wheel */
+    picosplay_node_t late_node;
+} picowheel_node_t;
+
+typedef struct st_picowheel_list_t {
+    picowheel_node_t* first;
+    picowheel_node_t* last;
+} picowheel_list_t;
+
+typedef struct st_picowheel_t {
+    uint64_t wheel_time;
+    uint64_t occupied[PICOWHEEL_NB_LEVELS];
+    picowheel_list_t slots[PICOWHEEL_NB_LEVELS * PICOWHEEL_NB_SLOTS];
+    picosplay_tree_t late;
+    picowheel_node_t* slot_first; /* Earliest node of a slot that was scanned, or NULL */
+    size_t size;
+} picowheel_t;
+
+void picowheel_init(picowheel_t* wheel);
+void picowheel_insert(picowheel_t* wheel, picowheel_node_t* node, uint64_t wake_time);
+void picowheel_remove(picowheel_t* wheel, picowheel_node_t* node);
+picowheel_node_t* picowheel_first(picowheel_t* wheel, uint64_t current_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PICOWHEEL_H */
@@ -34,6 +34,7 @@
 #include <errno.h>
 #endif
 #include "picoquic_newreno.h"
+#include "picoquic_path_scheduler.h"
 
 /*
  * Supported versions. Specific versions may mandate different processing of different
@@ -280,6 +281,20 @@ static picohash_item * picoquic_local_cnxid_to_item(const void* key)
     return &l_cid->hash_item;
 }
 
+static size_t picoquic_local_cnxid_inline(const void* key, uint8_t* inline_key)
+{
+    const picoquic_local_cnxid_t* l_cid = (const picoquic_local_cnxid_t*)key;
+    size_t key_length = 0;
+
+    /* Short CID are copied in the table slots, so the lookup does not
+     * need to access the CID context. */
+    if (l_cid->cnx_id.id_len <= PICOHASH_INLINE_KEY_MAX) {
+        key_length = l_cid->cnx_id.id_len;
+        memcpy(inline_key, l_cid->cnx_id.id, key_length);
+    }
+    return key_length;
+}
+
 static uint64_t picoquic_net_id_hash(const void* key, const uint8_t* hash_seed)
 {
     const picoquic_path_t* path_x = (const picoquic_path_t*)key;
@@ -617,6 +632,87 @@ uint32_t picoquic_current_number_connections(picoquic_quic_t * quic)
     return quic->current_number_connections;
 }
 
+/* Create the tables used to find connections by CID, address, initial CID
+ * and reset secret. The chained tables have a fixed number of bins, 4 per
+ * connection except for the initial CID table. The open addressing tables
+ * grow as needed, so they start with enough slots for one entry per
+ * connection below the 3/4 load factor that triggers a resize. */
+static int picoquic_create_cnx_tables(picoquic_quic_t* quic, int use_open_addressing,
+    picohash_table** by_id, picohash_table** by_net, picohash_table** by_icid, picohash_table** by_secret)
+{
+    int ret = 0;
+    size_t nb_cnx = (size_t)quic->max_number_connections;
+
+    *by_id = NULL;
+    *by_net = NULL;
+    *by_icid = NULL;
+    *by_secret = NULL;
+
+    if (use_open_addressing) {
+        size_t nb_slots = nb_cnx + nb_cnx / 3 + 1;
+
+        if ((*by_id = picohash_create_open(nb_slots, picoquic_local_cnxid_hash, picoquic_local_cnxid_compare,
+                picoquic_local_cnxid_to_item, picoquic_local_cnxid_inline, quic->hash_seed)) == NULL ||
+            (*by_net = picohash_create_open(nb_slots, picoquic_net_id_hash, picoquic_net_id_compare,
+                picoquic_local_netid_to_item, NULL, quic->hash_seed)) == NULL ||
+            (*by_icid = picohash_create_open(nb_slots, picoquic_net_icid_hash, picoquic_net_icid_compare,
+                picoquic_net_icid_to_item, NULL, quic->hash_seed)) == NULL ||
+            (*by_secret = picohash_create_open(nb_slots, picoquic_net_secret_hash, picoquic_net_secret_compare,
+                picoquic_net_secret_to_item, NULL, quic->hash_seed)) == NULL) {
+            ret = -1;
+        }
+    }
+    else if ((*by_id = picohash_create_ex(nb_cnx * 4, picoquic_local_cnxid_hash, picoquic_local_cnxid_compare,
+            picoquic_local_cnxid_to_item, quic->hash_seed)) == NULL ||
+        (*by_net = picohash_create_ex(nb_cnx * 4, picoquic_net_id_hash, picoquic_net_id_compare,
+            picoquic_local_netid_to_item, quic->hash_seed)) == NULL ||
+        (*by_icid = picohash_create_ex(nb_cnx, picoquic_net_icid_hash, picoquic_net_icid_compare,
+            picoquic_net_icid_to_item, quic->hash_seed)) == NULL ||
+        (*by_secret = picohash_create_ex(nb_cnx * 4, picoquic_net_secret_hash, picoquic_net_secret_compare,
+            picoquic_net_secret_to_item, quic->hash_seed)) == NULL) {
+        ret = -1;
+    }
+
+    if (ret != 0) {
+        picohash_table** tables[4] = { by_id, by_net, by_icid, by_secret };
+
+        for (int i = 0; i < 4; i++) {
+            if (*tables[i] != NULL) {
+                picohash_delete(*tables[i], 0);
+                *tables[i] = NULL;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int picoquic_set_open_addressing_tables(picoquic_quic_t* quic, int use_open_addressing)
+{
+    int ret = 0;
+    picohash_table* by_id;
+    picohash_table* by_net;
+    picohash_table* by_icid;
+    picohash_table* by_secret;
+
+    if (quic->cnx_list != NULL) {
+        /* The tables cannot be replaced while connections are registered */
+        ret = -1;
+    }
+    else if ((ret = picoquic_create_cnx_tables(quic, use_open_addressing, &by_id, &by_net, &by_icid, &by_secret)) == 0) {
+        picohash_delete(quic->table_cnx_by_id, 0);
+        picohash_delete(quic->table_cnx_by_net, 0);
+        picohash_delete(quic->table_cnx_by_icid, 0);
+        picohash_delete(quic->table_cnx_by_secret, 0);
+        quic->table_cnx_by_id = by_id;
+        quic->table_cnx_by_net = by_net;
+        quic->table_cnx_by_icid = by_icid;
+        quic->table_cnx_by_secret = by_secret;
+    }
+
+    return ret;
+}
+
 /* Forward reference */
 static void picoquic_wake_list_init(picoquic_quic_t* quic);
 
@@ -648,6 +744,7 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
         quic->default_callback_fn = default_callback_fn;
         quic->default_callback_ctx = default_callback_ctx;
         quic->default_congestion_alg = PICOQUIC_DEFAULT_CONGESTION_ALGORITHM;
+        quic->default_path_scheduler = PICOQUIC_DEFAULT_PATH_SCHEDULER;
         quic->default_alpn = picoquic_string_duplicate(default_alpn);
         quic->cnx_id_callback_fn = cnx_id_callback;
         quic->cnx_id_callback_ctx = cnx_id_callback_ctx;
@@ -693,14 +790,8 @@ picoquic_quic_t* picoquic_create(uint32_t max_nb_connections,
 
 
             if (max_cnx4 < (size_t)max_nb_connections ||
-                (quic->table_cnx_by_id = picohash_create_ex((size_t)max_nb_connections * 4,
-                picoquic_local_cnxid_hash, picoquic_local_cnxid_compare, picoquic_local_cnxid_to_item, quic->hash_seed)) == NULL ||
-                (quic->table_cnx_by_net = picohash_create_ex((size_t)max_nb_connections * 4,
-                    picoquic_net_id_hash, picoquic_net_id_compare, picoquic_local_netid_to_item, quic->hash_seed)) == NULL ||
-                (quic->table_cnx_by_icid = picohash_create_ex((size_t)max_nb_connections,
-                    picoquic_net_icid_hash, picoquic_net_icid_compare, picoquic_net_icid_to_item, quic->hash_seed)) == NULL ||
-                (quic->table_cnx_by_secret = picohash_create_ex((size_t)max_nb_connections * 4,
-                    picoquic_net_secret_hash, picoquic_net_secret_compare, picoquic_net_secret_to_item, quic->hash_seed)) == NULL ||
+                picoquic_create_cnx_tables(quic, 0, &quic->table_cnx_by_id, &quic->table_cnx_by_net,
+                    &quic->table_cnx_by_icid, &quic->table_cnx_by_secret) != 0 ||
                 (quic->table_issued_tickets = picohash_create_ex((size_t)max_nb_connections,
                     picoquic_issued_ticket_hash, picoquic_issued_ticket_compare, picoquic_issued_ticket_key_to_item, quic->hash_seed)) == NULL) {
                 ret = -1;
@@ -993,6 +1084,11 @@ void picoquic_free(picoquic_quic_t* quic)
         /* Deelete the reused tokens tree */
         picosplay_empty_tree(&quic->token_reuse_tree);
 
+        if (quic->protect_batch != NULL) {
+            free(quic->protect_batch);
+            quic->protect_batch = NULL;
+        }
+
         /* delete packets in pool */
         while (quic->p_first_packet != NULL) {
             picoquic_packet_t * p = quic->p_first_packet->packet_previous;
@@ -1011,6 +1107,15 @@ void picoquic_free(picoquic_quic_t* quic)
             quic->nb_data_nodes_in_pool--;
         }
 
+        /* delete data references in pool */
+        while (quic->p_first_data_ref != NULL) {
+            picoquic_stream_data_node_t* p = quic->p_first_data_ref->next_stream_data;
+            free(quic->p_first_data_ref);
+            quic->p_first_data_ref = p;
+            quic->nb_data_refs_allocated--;
+            quic->nb_data_refs_in_pool--;
+        }
+
         /* delete all pending stateless packets */
         while (quic->pending_stateless_packet != NULL) {
             picoquic_stateless_packet_t* to_delete = quic->pending_stateless_packet;
@@ -1052,6 +1157,9 @@ void picoquic_free(picoquic_quic_t* quic)
 
         /* Close the logs */
         picoquic_log_close_logs(quic);
+        if (quic->binlog_ring != NULL) {
+            picoquic_binlog_ring_release(quic);
+        }
 
         quic->binlog_dir = picoquic_string_free(quic->binlog_dir);
         quic->qlog_dir = picoquic_string_free(quic->qlog_dir);
@@ -1070,6 +1178,16 @@ int picoquic_set_low_memory_mode(picoquic_quic_t* quic, int low_memory_mode)
     return picoquic_set_cipher_suite(quic, 0);
 }
 
+void picoquic_set_zero_copy_receive(picoquic_quic_t* quic, int zero_copy_receive)
+{
+    quic->use_zero_copy_receive = (zero_copy_receive == 0) ? 0 : 1;
+}
+
+void picoquic_set_compact_sent_packets(picoquic_quic_t* quic, int compact_sent_packets)
+{
+    quic->use_compact_sent_packets = (compact_sent_packets == 0) ? 0 : 1;
+}
+
 void picoquic_set_null_verifier(picoquic_quic_t* quic) {
     picoquic_dispose_verify_certificate_callback(quic);
 }
@@ -1355,48 +1473,27 @@ static void picoquic_remove_cnx_from_list(picoquic_cnx_t* cnx)
     cnx->quic->current_number_connections--;
 }
 
-/* Management of the list of connections, sorted by wake time */
+/* Management of the list of connections, sorted by wake time.
+ * The connections are kept in a timing wheel, see picowheel.h */
 
-static void* picoquic_wake_list_node_value(picosplay_node_t* cnx_wake_node)
+static picoquic_cnx_t* picoquic_wake_list_node_value(picowheel_node_t* cnx_wake_node)
 {
-    return (cnx_wake_node == NULL)?NULL:(void*)((char*)cnx_wake_node - offsetof(struct st_picoquic_cnx_t, cnx_wake_node));
-}
-
-static int64_t picoquic_wake_list_compare(void* l, void* r) {
-    const uint64_t ltime = ((picoquic_cnx_t*)l)->next_wake_time;
-    const uint64_t rtime = ((picoquic_cnx_t*)r)->next_wake_time;
-    if (ltime < rtime) return -1;
-    if (ltime > rtime) return 1;
-    return 0;
-}
-
-static picosplay_node_t* picoquic_wake_list_create_node(void* v_cnx)
-{
-    return &((picoquic_cnx_t*)v_cnx)->cnx_wake_node;
-}
-
-static void picoquic_wake_list_delete_node(void* tree, picosplay_node_t* node)
-{
-#ifdef _WINDOWS
-    UNREFERENCED_PARAMETER(tree);
-#endif
-    memset(node, 0, sizeof(picosplay_node_t));
+    return (cnx_wake_node == NULL)?NULL:(picoquic_cnx_t*)((char*)cnx_wake_node - offsetof(struct st_picoquic_cnx_t, cnx_wake_node));
 }
 
 static void picoquic_wake_list_init(picoquic_quic_t * quic)
 {
-    picosplay_init_tree(&quic->cnx_wake_tree, picoquic_wake_list_compare,
-        picoquic_wake_list_create_node, picoquic_wake_list_delete_node, picoquic_wake_list_node_value);
+    picowheel_init(&quic->cnx_wake_wheel);
 }
 
 static void picoquic_remove_cnx_from_wake_list(picoquic_cnx_t* cnx)
 {
-    picosplay_delete_hint(&cnx->quic->cnx_wake_tree, &cnx->cnx_wake_node);
+    picowheel_remove(&cnx->quic->cnx_wake_wheel, &cnx->cnx_wake_node);
 }
 
 static void picoquic_insert_cnx_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx)
 {
-    picosplay_insert(&quic->cnx_wake_tree, cnx);
+    picowheel_insert(&quic->cnx_wake_wheel, &cnx->cnx_wake_node, cnx->next_wake_time);
 }
 
 void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx, uint64_t next_time)
@@ -1408,7 +1505,8 @@ void picoquic_reinsert_by_wake_time(picoquic_quic_t* quic, picoquic_cnx_t* cnx,
 
 picoquic_cnx_t* picoquic_get_earliest_cnx_to_wake(picoquic_quic_t* quic, uint64_t max_wake_time)
 {
-    picoquic_cnx_t* cnx = (picoquic_cnx_t *)picoquic_wake_list_node_value(picosplay_first(&quic->cnx_wake_tree));
+    picoquic_cnx_t* cnx = picoquic_wake_list_node_value(
+        picowheel_first(&quic->cnx_wake_wheel, picoquic_get_quic_time(quic)));
     if (cnx != NULL && max_wake_time != 0 && cnx->next_wake_time > max_wake_time)
     {
         cnx = NULL;
@@ -1425,8 +1523,8 @@ uint64_t picoquic_get_next_wake_time(picoquic_quic_t* quic, uint64_t current_tim
         wake_time = current_time;
     }
     else{
-        picoquic_cnx_t* cnx_wake_first = (picoquic_cnx_t*)picoquic_wake_list_node_value(
-            picosplay_first(&quic->cnx_wake_tree));
+        picoquic_cnx_t* cnx_wake_first = picoquic_wake_list_node_value(
+            picowheel_first(&quic->cnx_wake_wheel, current_time));
 
         if (cnx_wake_first != NULL) {
             wake_time = cnx_wake_first->next_wake_time;
@@ -2721,6 +2819,11 @@ void picoquic_init_packet_ctx(picoquic_cnx_t* cnx, picoquic_packet_context_t* pk
     }
     pkt_ctx->pending_last = NULL;
     pkt_ctx->pending_first = NULL;
+    /* The context may be a copy of a previous one, so the index is not freed */
+    pkt_ctx->pn_index = NULL;
+    pkt_ctx->pn_index_size = 0;
+    pkt_ctx->pn_index_count = 0;
+    pkt_ctx->is_pn_index_disabled = 0;
     pkt_ctx->highest_acknowledged = pkt_ctx->send_sequence - 1;
     pkt_ctx->latest_time_acknowledged = cnx->start_time;
     pkt_ctx->highest_acknowledged_time = cnx->start_time;
@@ -3188,7 +3291,24 @@ void* picoquic_stream_data_node_value(picosplay_node_t* node)
 
 void picoquic_stream_data_node_recycle(picoquic_stream_data_node_t* stream_data)
 {
-    if (stream_data->quic->nb_data_nodes_in_pool < PICOQUIC_MAX_PACKETS_IN_POOL) {
+    if (stream_data->packet_node != NULL) {
+        /* This is a reference node. Release the packet, then keep the
+         * reference node in its own pool, since it is much smaller. */
+        picoquic_quic_t* quic = stream_data->quic;
+
+        picoquic_stream_data_node_release(stream_data->packet_node);
+        stream_data->packet_node = NULL;
+        if (quic->nb_data_refs_in_pool < PICOQUIC_MAX_PACKETS_IN_POOL) {
+            stream_data->next_stream_data = quic->p_first_data_ref;
+            quic->p_first_data_ref = stream_data;
+            quic->nb_data_refs_in_pool++;
+        }
+        else {
+            quic->nb_data_refs_allocated--;
+            free(stream_data);
+        }
+    }
+    else if (stream_data->quic->nb_data_nodes_in_pool < PICOQUIC_MAX_PACKETS_IN_POOL) {
         stream_data->next_stream_data = stream_data->quic->p_first_data_node;
         stream_data->quic->p_first_data_node = stream_data;
         stream_data->quic->nb_data_nodes_in_pool++;
@@ -3232,10 +3352,60 @@ picoquic_stream_data_node_t* picoquic_stream_data_node_alloc(picoquic_quic_t* qu
         stream_data->bytes = NULL;
         quic->nb_data_nodes_in_pool--;
     }
+    if (stream_data != NULL) {
+        stream_data->nb_references = 0;
+    }
 
     return stream_data;
 }
 
+/* Allocate a reference to stream data held in a decrypted packet.
+ * The node is only PICOQUIC_STREAM_DATA_REF_SIZE bytes long, and its
+ * "data" array must never be accessed. The packet node will not be recycled
+ * until the reference node is.
+ */
+picoquic_stream_data_node_t* picoquic_stream_data_ref_alloc(picoquic_stream_data_node_t* packet_node)
+{
+    picoquic_quic_t* quic = packet_node->quic;
+    picoquic_stream_data_node_t* stream_data = quic->p_first_data_ref;
+
+    if (stream_data == NULL) {
+        stream_data = (picoquic_stream_data_node_t*)malloc(PICOQUIC_STREAM_DATA_REF_SIZE);
+
+        if (stream_data != NULL) {
+            memset(stream_data, 0, PICOQUIC_STREAM_DATA_REF_SIZE);
+            stream_data->quic = quic;
+            quic->nb_data_refs_allocated++;
+            if (quic->nb_data_refs_allocated > quic->nb_data_refs_allocated_max) {
+                quic->nb_data_refs_allocated_max = quic->nb_data_refs_allocated;
+            }
+        }
+    }
+    else {
+        quic->p_first_data_ref = stream_data->next_stream_data;
+        stream_data->next_stream_data = NULL;
+        stream_data->bytes = NULL;
+        quic->nb_data_refs_in_pool--;
+    }
+    if (stream_data != NULL) {
+        stream_data->packet_node = packet_node;
+        packet_node->nb_references++;
+    }
+
+    return stream_data;
+}
+
+/* Release one reference to a decrypted packet, and recycle the packet
+ * once no reference remains.
+ */
+void picoquic_stream_data_node_release(picoquic_stream_data_node_t* packet_node)
+{
+    packet_node->nb_references--;
+    if (packet_node->nb_references <= 0) {
+        picoquic_stream_data_node_recycle(packet_node);
+    }
+}
+
 
 /* Stream splay management */
 
@@ -3256,19 +3426,157 @@ static void * picoquic_stream_node_value(picosplay_node_t * node)
     return (void*)((char*)node - offsetof(struct st_picoquic_stream_head_t, stream_node));
 }
 
-void picoquic_clear_stream(picoquic_stream_head_t* stream)
+/* Free a segment of queued data. Application owned bytes are not freed,
+ * but handed back to the application through the release callback.
+ */
+void picoquic_stream_queue_node_free(picoquic_stream_queue_node_t* stream_data, int is_acknowledged)
+{
+    if (stream_data->is_app_owned) {
+        if (stream_data->release_fn != NULL) {
+            stream_data->release_fn(stream_data->release_ctx, stream_data->bytes, stream_data->length, is_acknowledged);
+        }
+    }
+    else if (stream_data->bytes != NULL) {
+        free(stream_data->bytes);
+    }
+    free(stream_data);
+}
+
+/* Remove the first segment from the send queue after all its bytes were sent.
+ * Application owned segments are kept in the release queue until the
+ * peer acknowledges them. The release queue is in stream offset order.
+ * With compact sent packets, all segments are kept in the release queue,
+ * because lost data will be copied from there.
+ */
+void picoquic_stream_queue_node_sent(picoquic_stream_head_t* stream, uint64_t end_offset)
+{
+    picoquic_stream_queue_node_t* stream_data = stream->send_queue;
+
+    stream->send_queue = stream_data->next_stream_data;
+    if (stream_data->is_app_owned || stream->cnx->quic->use_compact_sent_packets) {
+        stream_data->stream_offset = end_offset - stream_data->length;
+        stream_data->next_stream_data = NULL;
+        if (stream->release_queue_last == NULL) {
+            stream->release_queue = stream_data;
+        }
+        else {
+            stream->release_queue_last->next_stream_data = stream_data;
+        }
+        stream->release_queue_last = stream_data;
+    }
+    else {
+        picoquic_stream_queue_node_free(stream_data, 0);
+    }
+}
+
+/* Release the application owned segments that the peer fully acknowledged.
+ * Segments are released in order, so a segment acknowledged early waits
+ * until the previous ones are also acknowledged.
+ */
+void picoquic_stream_release_acked_buffers(picoquic_stream_head_t* stream)
+{
+    picoquic_stream_queue_node_t* stream_data;
+
+    while ((stream_data = stream->release_queue) != NULL &&
+        picoquic_check_sack_list(&stream->sack_list, stream_data->stream_offset,
+            stream_data->stream_offset + stream_data->length - 1) != 0) {
+        stream->release_queue = stream_data->next_stream_data;
+        if (stream->release_queue == NULL) {
+            stream->release_queue_last = NULL;
+        }
+        if (stream->release_queue_cursor == stream_data) {
+            stream->release_queue_cursor = NULL;
+        }
+        picoquic_stream_queue_node_free(stream_data, 1);
+    }
+}
+
+/* Free all the data queued for sending, for example after a reset.
+ * Segments still waiting for acknowledgement are released as well.
+ */
+void picoquic_stream_clear_send_data(picoquic_stream_head_t* stream)
 {
-    picoquic_stream_queue_node_t* ready = stream->send_queue;
     picoquic_stream_queue_node_t* next;
 
-    while ((next = ready) != NULL) {
-        ready = next->next_stream_data;
-        if (next->bytes != NULL) {
-            free(next->bytes);
+    while ((next = stream->send_queue) != NULL) {
+        stream->send_queue = next->next_stream_data;
+        picoquic_stream_queue_node_free(next, 0);
+    }
+
+    picoquic_stream_release_acked_buffers(stream);
+    while ((next = stream->release_queue) != NULL) {
+        stream->release_queue = next->next_stream_data;
+        picoquic_stream_queue_node_free(next, 0);
+    }
+    stream->release_queue_last = NULL;
+    stream->release_queue_cursor = NULL;
+}
+
+/* Copy stream data that was already sent, and is retained in the release
+ * queue or in the partially sent first segment of the send queue.
+ * If "bytes" is NULL, only check that the data is available.
+ * Returns -1 if some of the data is not available.
+ * Lost frames are mostly retransmitted in offset order, so the search
+ * starts from the segment where the previous copy ended if it is not
+ * past the requested offset, instead of the head of the release queue.
+ */
+int picoquic_stream_copy_sent_data(picoquic_stream_head_t* stream, uint64_t offset, size_t length, uint8_t* bytes)
+{
+    picoquic_stream_queue_node_t* stream_data = stream->release_queue;
+    uint64_t end_offset = offset + length;
+
+    if (stream->release_queue_cursor != NULL && stream->release_queue_cursor->stream_offset <= offset) {
+        stream_data = stream->release_queue_cursor;
+    }
+
+    while (offset < end_offset) {
+        uint64_t node_offset;
+        uint64_t node_length;
+
+        if (stream_data == NULL) {
+            /* Only the sent part of the first segment in the send queue can be used */
+            stream_data = stream->send_queue;
+            if (stream_data == NULL || stream->sent_offset < stream_data->offset) {
+                break;
+            }
+            node_offset = stream->sent_offset - stream_data->offset;
+            node_length = stream_data->offset;
+        }
+        else {
+            node_offset = stream_data->stream_offset;
+            node_length = stream_data->length;
+        }
+
+        if (offset < node_offset) {
+            /* Data not retained */
+            break;
+        }
+        else if (offset < node_offset + node_length) {
+            size_t copied = (size_t)(node_offset + node_length - offset);
+
+            if (copied > end_offset - offset) {
+                copied = (size_t)(end_offset - offset);
+            }
+            if (bytes != NULL) {
+                memcpy(bytes, stream_data->bytes + (offset - node_offset), copied);
+                bytes += copied;
+            }
+            offset += copied;
+        }
+
+        if (stream_data == stream->send_queue) {
+            break;
         }
-        free(next);
+        stream->release_queue_cursor = stream_data;
+        stream_data = stream_data->next_stream_data;
     }
-    stream->send_queue = NULL;
+
+    return (offset < end_offset) ? -1 : 0;
+}
+
+void picoquic_clear_stream(picoquic_stream_head_t* stream)
+{
+    picoquic_stream_clear_send_data(stream);
     if (stream->is_output_stream) {
         picoquic_remove_output_stream(stream->cnx, stream);
     }
@@ -3315,13 +3623,21 @@ picoquic_stream_head_t * picoquic_last_stream(picoquic_cnx_t* cnx)
 #endif
 }
 
+/* Streams in the same FIFO level (odd priority) are ordered by stream ID.
+ * Streams in the same round robin level (even priority) are ordered by
+ * time of last data sent, then by stream ID, so the first stream that can
+ * send is the one that waited longest.
+ */
 int picoquic_compare_stream_priority(picoquic_stream_head_t * stream, picoquic_stream_head_t * other) {
     int ret = 1;
     if (stream->stream_priority < other->stream_priority) {
         ret = -1;
     }
     else if (stream->stream_priority == other->stream_priority) {
-        if (stream->stream_id < other->stream_id) {
+        if ((stream->stream_priority & 1) == 0 && stream->last_time_data_sent != other->last_time_data_sent) {
+            ret = (stream->last_time_data_sent < other->last_time_data_sent) ? -1 : 1;
+        }
+        else if (stream->stream_id < other->stream_id) {
             ret = -1;
         }
         else if (stream->stream_id == other->stream_id) {
@@ -3331,72 +3647,166 @@ int picoquic_compare_stream_priority(picoquic_stream_head_t * stream, picoquic_s
     return ret;
 }
 
-/* This code assumes that the stream is not currently present in the output stream.
+/* In round robin levels, streams that need to send a reset or stop sending
+ * request, or that have data but are blocked by stream flow control, are
+ * queued at the head of the level. The reset is then sent before any data,
+ * and the blocked state is noticed without scanning the whole level.
  */
-void picoquic_insert_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+static int picoquic_is_output_stream_ahead(picoquic_stream_head_t* stream)
 {
-    if (stream->is_output_stream == 0)  
-    {
-        if (IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode) {
-            if (stream->stream_id > ((IS_BIDIR_STREAM_ID(stream->stream_id)) ? cnx->max_stream_id_bidir_remote : cnx->max_stream_id_unidir_remote)) {
-                return;
-            }
-        }
+    return (stream->reset_requested && !stream->reset_sent) ||
+        (stream->stop_sending_requested && !stream->stop_sending_sent) ||
+        ((stream->is_active || (stream->send_queue != NULL && stream->send_queue->length > stream->send_queue->offset)) &&
+            stream->sent_offset >= stream->maxdata_remote);
+}
+
+/* Return the highest non empty level below the specified level, or -1 if there is none */
+static int picoquic_output_level_previous(picoquic_cnx_t* cnx, int level)
+{
+    int word = level >> 6;
+    uint64_t bits = cnx->output_stream_levels[word] & ((1ull << (level & 63)) - 1);
 
-        if (cnx->last_output_stream == NULL) {
-            /* insert first stream */
-            cnx->last_output_stream = stream;
-            cnx->first_output_stream = stream;
+    while (bits == 0) {
+        if (word == 0) {
+            return -1;
         }
-        else if (picoquic_compare_stream_priority(stream, cnx->last_output_stream) >= 0) {
-            /* insert after last stream. Common case for most applications. */
-            stream->previous_output_stream = cnx->last_output_stream;
-            cnx->last_output_stream->next_output_stream = stream;
-            cnx->last_output_stream = stream;
+        word--;
+        bits = cnx->output_stream_levels[word];
+    }
+    level = word << 6;
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        if ((bits >> shift) != 0) {
+            bits >>= shift;
+            level += shift;
         }
-        else {
-            picoquic_stream_head_t* current = cnx->first_output_stream;
+    }
+    return level;
+}
 
-            while (current != NULL) {
-                int cmp = picoquic_compare_stream_priority(stream, current);
+static picoquic_stream_head_t* picoquic_first_output_stream_in_level(picoquic_cnx_t* cnx, uint8_t level)
+{
+    picoquic_stream_head_t* first = NULL;
 
-                if (cmp < 0) {
-                    /* insert before the current stream, then break */
-                    stream->previous_output_stream = current->previous_output_stream;
-                    if (stream->previous_output_stream == NULL) {
-                        cnx->first_output_stream = stream;
-                    }
-                    else {
-                        stream->previous_output_stream->next_output_stream = stream;
-                    }
-                    current->previous_output_stream = stream;
-                    stream->next_output_stream = current;
+    if (cnx->output_stream_level_last[level] != NULL) {
+        int previous_level = picoquic_output_level_previous(cnx, level);
+        first = (previous_level < 0) ? cnx->first_output_stream :
+            cnx->output_stream_level_last[previous_level]->next_output_stream;
+    }
+    return first;
+}
+
+static void picoquic_link_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream, picoquic_stream_head_t* previous)
+{
+    uint8_t level = stream->output_priority;
+
+    stream->previous_output_stream = previous;
+    if (previous == NULL) {
+        stream->next_output_stream = cnx->first_output_stream;
+        cnx->first_output_stream = stream;
+    }
+    else {
+        stream->next_output_stream = previous->next_output_stream;
+        previous->next_output_stream = stream;
+    }
+    if (stream->next_output_stream == NULL) {
+        cnx->last_output_stream = stream;
+    }
+    else {
+        stream->next_output_stream->previous_output_stream = stream;
+    }
+    if (cnx->output_stream_level_last[level] == NULL || cnx->output_stream_level_last[level] == previous) {
+        cnx->output_stream_level_last[level] = stream;
+        cnx->output_stream_levels[level >> 6] |= (1ull << (level & 63));
+    }
+    stream->is_output_stream = 1;
+}
+
+static void picoquic_insert_output_stream_in_level(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+{
+    uint8_t level = stream->stream_priority;
+    picoquic_stream_head_t* previous = NULL;
+
+    stream->output_priority = level;
+    stream->is_output_head = 0;
+
+    if (cnx->output_stream_level_last[level] == NULL) {
+        /* First stream at that level, insert after the previous level */
+        int previous_level = picoquic_output_level_previous(cnx, level);
+        if (previous_level >= 0) {
+            previous = cnx->output_stream_level_last[previous_level];
+        }
+    }
+    else {
+        picoquic_stream_head_t* first = picoquic_first_output_stream_in_level(cnx, level);
+        picoquic_stream_head_t* back = cnx->output_stream_level_last[level];
+        picoquic_stream_head_t* front = first;
+
+        if ((level & 1) == 0 && picoquic_is_output_stream_ahead(stream)) {
+            stream->is_output_head = 1;
+            previous = first->previous_output_stream;
+        }
+        else {
+            /* Search from both ends of the level. New streams are usually
+             * inserted at the end, and streams that were idle for a while
+             * near the beginning. */
+            while (1) {
+                if (back->is_output_head || picoquic_compare_stream_priority(stream, back) > 0) {
+                    previous = back;
                     break;
                 }
-                else if (cmp == 0) {
-                    /* Stream is already there. This is unexpected */
+                if (back == first) {
+                    previous = first->previous_output_stream;
                     break;
                 }
-                else {
-                    current = current->next_output_stream;
+                back = back->previous_output_stream;
+                if (!front->is_output_head && picoquic_compare_stream_priority(stream, front) < 0) {
+                    previous = front->previous_output_stream;
+                    break;
                 }
-            }
-            if (current == NULL) {
-                /* insert after last stream */
-                stream->previous_output_stream = cnx->last_output_stream;
-                cnx->last_output_stream->next_output_stream = stream;
-                cnx->last_output_stream = stream;
+                front = front->next_output_stream;
             }
         }
+    }
 
-        stream->is_output_stream = 1;
+    picoquic_link_output_stream(cnx, stream, previous);
+}
+
+/* Insert a stream in the output list, or if it is already there, make sure
+ * that it is at the right place.
+ */
+void picoquic_insert_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
+{
+    if (stream->is_output_stream == 0)
+    {
+        if (IS_CLIENT_STREAM_ID(stream->stream_id) == cnx->client_mode) {
+            if (stream->stream_id > ((IS_BIDIR_STREAM_ID(stream->stream_id)) ? cnx->max_stream_id_bidir_remote : cnx->max_stream_id_unidir_remote)) {
+                return;
+            }
+        }
+        picoquic_insert_output_stream_in_level(cnx, stream);
+    }
+    else {
+        picoquic_reorder_output_stream(cnx, stream);
     }
 }
 
 void picoquic_remove_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t * stream)
 {
     if (stream->is_output_stream) {
+        uint8_t level = stream->output_priority;
+
         stream->is_output_stream = 0;
+        stream->is_output_head = 0;
+
+        if (cnx->output_stream_level_last[level] == stream) {
+            if (stream->previous_output_stream != NULL && stream->previous_output_stream->output_priority == level) {
+                cnx->output_stream_level_last[level] = stream->previous_output_stream;
+            }
+            else {
+                cnx->output_stream_level_last[level] = NULL;
+                cnx->output_stream_levels[level >> 6] &= ~(1ull << (level & 63));
+            }
+        }
 
         if (stream->previous_output_stream == NULL) {
             cnx->first_output_stream = stream->next_output_stream;
@@ -3418,19 +3828,34 @@ void picoquic_remove_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t *
 
 /* Reorder streams by priorities and rank.
  * A stream is deemed out of order if:
- * - the previous stream in the list has a higher priority, or
- * - the new stream has a lower priority.
+ * - its priority changed, or
+ * - in a round robin level, it should move to or from the head of the level,
+ *   or it was sent after the next stream in the level.
  */
 void picoquic_reorder_output_stream(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream)
 {
     if (stream->is_output_stream) {
-        if ((stream->previous_output_stream != NULL &&
-            picoquic_compare_stream_priority(stream, stream->previous_output_stream) < 0) ||
-            (stream->next_output_stream != NULL &&
-                picoquic_compare_stream_priority(stream, stream->next_output_stream) > 0)) {
+        int is_out_of_order = stream->stream_priority != stream->output_priority;
+
+        if (!is_out_of_order && (stream->output_priority & 1) == 0) {
+            if (stream->is_output_head) {
+                is_out_of_order = !picoquic_is_output_stream_ahead(stream);
+            }
+            else {
+                picoquic_stream_head_t* previous = stream->previous_output_stream;
+                picoquic_stream_head_t* next = stream->next_output_stream;
+
+                is_out_of_order = picoquic_is_output_stream_ahead(stream) ||
+                    (previous != NULL && previous->output_priority == stream->output_priority && !previous->is_output_head &&
+                        picoquic_compare_stream_priority(stream, previous) < 0) ||
+                    (next != NULL && next->output_priority == stream->output_priority &&
+                        picoquic_compare_stream_priority(stream, next) > 0);
+            }
+        }
+
+        if (is_out_of_order) {
             picoquic_remove_output_stream(cnx, stream);
-            stream->is_output_stream = 0;
-            picoquic_insert_output_stream(cnx, stream);
+            picoquic_insert_output_stream_in_level(cnx, stream);
         }
     }
 }
@@ -3442,10 +3867,17 @@ picoquic_stream_head_t * picoquic_next_stream(picoquic_stream_head_t * stream)
 
 picoquic_stream_head_t* picoquic_find_stream(picoquic_cnx_t* cnx, uint64_t stream_id)
 {
-    picoquic_stream_head_t target;
-    target.stream_id = stream_id;
+    picoquic_stream_head_t* stream = (picoquic_stream_head_t*)picoindex_get(
+        &cnx->stream_index[STREAM_TYPE_FROM_ID(stream_id)], STREAM_RANK_FROM_ID(stream_id));
+
+    if (stream == NULL && cnx->nb_streams_not_indexed > 0) {
+        picoquic_stream_head_t target;
+        target.stream_id = stream_id;
 
-    return (picoquic_stream_head_t *)picosplay_find(&cnx->stream_tree, (void*)&target);
+        stream = (picoquic_stream_head_t*)picosplay_find(&cnx->stream_tree, (void*)&target);
+    }
+
+    return stream;
 }
 
 void picoquic_add_output_streams(picoquic_cnx_t* cnx, uint64_t old_limit, uint64_t new_limit, unsigned int is_bidir)
@@ -3510,6 +3942,10 @@ picoquic_stream_head_t* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t str
 
         picosplay_init_tree(&stream->stream_data_tree, picoquic_stream_data_node_compare, picoquic_stream_data_node_create, picoquic_stream_data_node_delete, picoquic_stream_data_node_value);
 
+        if (picoindex_set(&cnx->stream_index[STREAM_TYPE_FROM_ID(stream_id)], STREAM_RANK_FROM_ID(stream_id), stream) != 0) {
+            stream->is_not_indexed = 1;
+            cnx->nb_streams_not_indexed++;
+        }
         picosplay_insert(&cnx->stream_tree, stream);
         if (is_output_stream) {
             picoquic_insert_output_stream(cnx, stream);
@@ -3529,6 +3965,12 @@ picoquic_stream_head_t* picoquic_create_stream(picoquic_cnx_t* cnx, uint64_t str
 
 void picoquic_delete_stream(picoquic_cnx_t * cnx, picoquic_stream_head_t* stream)
 {
+    if (stream->is_not_indexed) {
+        cnx->nb_streams_not_indexed--;
+    }
+    else {
+        picoindex_remove(&cnx->stream_index[STREAM_TYPE_FROM_ID(stream->stream_id)], STREAM_RANK_FROM_ID(stream->stream_id));
+    }
     picosplay_delete(&cnx->stream_tree, stream);
 }
 
@@ -3713,6 +4155,7 @@ void picoquic_delete_local_cnxid_listed(picoquic_cnx_t* cnx,
         if (l_cid->registered_cnx != NULL) {
             picohash_item* item = &l_cid->hash_item;
             picohash_delete_item(cnx->quic->table_cnx_by_id, item, 0);
+            cnx->quic->nb_cnx_removed++;
         }
         l_cid->registered_cnx = NULL;
     }
@@ -3994,6 +4437,7 @@ picoquic_cnx_t* picoquic_create_cnx(picoquic_quic_t* quic,
         cnx->callback_fn = quic->default_callback_fn;
         cnx->callback_ctx = quic->default_callback_ctx;
         cnx->congestion_alg = quic->default_congestion_alg;
+        cnx->path_scheduler = quic->default_path_scheduler;
         cnx->is_preemptive_repeat_enabled = quic->is_preemptive_repeat_enabled;
 
         /* Initialize key rotation interval to default value */
@@ -4636,6 +5080,7 @@ void picoquic_reset_packet_context(picoquic_cnx_t* cnx,
     }
 
     pkt_ctx->retransmitted_oldest = NULL;
+    picoquic_pn_index_free(pkt_ctx);
 
     /* Reset the ECN data */
     pkt_ctx->ecn_ect0_total_remote = 0;
@@ -4770,6 +5215,8 @@ int picoquic_start_key_rotation(picoquic_cnx_t* cnx)
     }
 
     if (ret == 0) {
+        /* Packets staged with the previous key must be encrypted before it is freed */
+        picoquic_protect_batch_flush(cnx->quic);
         picoquic_apply_rotated_keys(cnx, 1);
         picoquic_crypto_context_free(&cnx->crypto_context_old);
         cnx->crypto_epoch_sequence = cnx->pkt_ctx[picoquic_packet_context_application].send_sequence;
@@ -4793,6 +5240,7 @@ void picoquic_delete_sooner_packets(picoquic_cnx_t* cnx)
 void picoquic_delete_cnx(picoquic_cnx_t* cnx)
 {
     if (cnx != NULL) {
+        cnx->quic->nb_cnx_removed++;
         if (cnx->memlog_call_back != NULL) {
             cnx->memlog_call_back(cnx, NULL, cnx->memlog_ctx, 1, 0);
         }
@@ -4852,6 +5300,7 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
         while (cnx->first_datagram != NULL) {
             picoquic_delete_misc_or_dg(&cnx->first_datagram, &cnx->last_datagram, cnx->first_datagram);
         }
+        picoquic_datagram_ring_release(&cnx->datagram_ring);
 
         picosplay_empty_tree(&cnx->queue_data_repeat_tree);
 
@@ -4860,6 +5309,10 @@ void picoquic_delete_cnx(picoquic_cnx_t* cnx)
         }
 
         picosplay_empty_tree(&cnx->stream_tree);
+        for (int i = 0; i < 4; i++) {
+            picoindex_clear(&cnx->stream_index[i]);
+        }
+        cnx->nb_streams_not_indexed = 0;
 
         if (cnx->tls_ctx != NULL) {
             picoquic_tlscontext_free(cnx->tls_ctx, cnx->client_mode);
@@ -5103,6 +5556,21 @@ void picoquic_set_congestion_algorithm(picoquic_cnx_t* cnx, picoquic_congestion_
     picoquic_set_congestion_algorithm_ex(cnx, alg, NULL);
 }
 
+/*
+ * Set the multipath scheduler. Setting NULL restores the default scheduler.
+ */
+
+void picoquic_set_default_path_scheduler(picoquic_quic_t* quic, picoquic_path_scheduler_t const* scheduler)
+{
+    quic->default_path_scheduler = (scheduler == NULL) ? PICOQUIC_DEFAULT_PATH_SCHEDULER : scheduler;
+}
+
+void picoquic_set_path_scheduler(picoquic_cnx_t* cnx, picoquic_path_scheduler_t const* scheduler)
+{
+    cnx->path_scheduler = (scheduler == NULL) ? PICOQUIC_DEFAULT_PATH_SCHEDULER : scheduler;
+    cnx->is_path_scheduler_waiting = 0;
+}
+
 void picoquic_set_priority_limit_for_bypass(picoquic_cnx_t* cnx, uint8_t priority_limit)
 {
     cnx->priority_limit_for_bypass = priority_limit;
@@ -25,6 +25,7 @@
 #include "picoquic_bbr1.h"
 #include "picoquic_fastcc.h"
 #include "picoquic_prague.h"
+#include "picoquic_coupledcc.h"
 
 
 /* Register a complete list of congestion control algorithms, which
@@ -32,8 +33,8 @@
 * and picoquic_create_and_configure(). 
  */
 
-picoquic_congestion_algorithm_t const* getter_test_cc_algo_list[7] = {
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL
+picoquic_congestion_algorithm_t const* getter_test_cc_algo_list[10] = {
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
 };
 
 void picoquic_register_all_congestion_control_algorithms()
@@ -45,5 +46,8 @@ void picoquic_register_all_congestion_control_algorithms()
     getter_test_cc_algo_list[4] = picoquic_bbr_algorithm;
     getter_test_cc_algo_list[5] = picoquic_prague_algorithm;
     getter_test_cc_algo_list[6] = picoquic_bbr1_algorithm;
-    picoquic_register_congestion_control_algorithms(getter_test_cc_algo_list, 7);
+    getter_test_cc_algo_list[7] = picoquic_lia_algorithm;
+    getter_test_cc_algo_list[8] = picoquic_olia_algorithm;
+    getter_test_cc_algo_list[9] = picoquic_balia_algorithm;
+    picoquic_register_congestion_control_algorithms(getter_test_cc_algo_list, 10);
 }
\ No newline at end of file
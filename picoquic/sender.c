@@ -22,6 +22,8 @@
 #include "picoquic_internal.h"
 #include "picoquic_unified_log.h"
 #include "tls_api.h"
+#include "picotls.h"
+#include "picoquic_crypto_provider_api.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -147,6 +149,7 @@ int picoquic_mark_active_stream(picoquic_cnx_t* cnx,
                 stream->app_stream_ctx = app_stream_ctx;
                 if (!stream->is_active) {
                     stream->is_active = 1;
+                    picoquic_insert_output_stream(cnx, stream);
                     picoquic_reinsert_by_wake_time(cnx->quic, cnx, picoquic_get_quic_time(cnx->quic));
                 }
             }
@@ -208,17 +211,16 @@ int picoquic_mark_high_priority_stream(picoquic_cnx_t * cnx, uint64_t stream_id,
     return ret;
 }
 
-int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
-    const uint8_t* data, size_t length, int set_fin, void * app_stream_ctx)
+static picoquic_stream_head_t* picoquic_find_stream_for_adding(picoquic_cnx_t* cnx, uint64_t stream_id,
+    size_t length, int set_fin, int* ret)
 {
-    int ret = 0;
-    picoquic_stream_head_t* stream = picoquic_find_stream_for_writing(cnx, stream_id, &ret);
+    picoquic_stream_head_t* stream = picoquic_find_stream_for_writing(cnx, stream_id, ret);
 
-    if (ret == 0 && set_fin) {
+    if (*ret == 0 && set_fin) {
         if (stream->fin_requested) {
             /* app error, notified the fin twice*/
             if (length > 0) {
-                ret = -1;
+                *ret = -1;
             }
         } else {
             stream->fin_requested = 1;
@@ -226,16 +228,40 @@ int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
     }
 
     /* If our side has sent RST_STREAM or received STOP_SENDING, we should not send anymore data. */
-    if (ret == 0 && (stream->reset_sent || stream->stop_sending_received)) {
-        ret = -1;
+    if (*ret == 0 && (stream->reset_sent || stream->stop_sending_received)) {
+        *ret = -1;
     }
 
+    return stream;
+}
+
+static void picoquic_append_stream_queue_node(picoquic_stream_head_t* stream, picoquic_stream_queue_node_t* stream_data)
+{
+    picoquic_stream_queue_node_t** pprevious = &stream->send_queue;
+    picoquic_stream_queue_node_t* next = stream->send_queue;
+
+    while (next != NULL) {
+        pprevious = &next->next_stream_data;
+        next = next->next_stream_data;
+    }
+
+    *pprevious = stream_data;
+}
+
+int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
+    const uint8_t* data, size_t length, int set_fin, void * app_stream_ctx)
+{
+    int ret = 0;
+    picoquic_stream_head_t* stream = picoquic_find_stream_for_adding(cnx, stream_id, length, set_fin, &ret);
+
     if (ret == 0 && length > 0) {
         picoquic_stream_queue_node_t* stream_data = (picoquic_stream_queue_node_t*)
             malloc(sizeof(picoquic_stream_queue_node_t));
         if (stream_data == 0) {
             ret = -1;
         } else {
+            memset(stream_data, 0, sizeof(picoquic_stream_queue_node_t));
+            stream_data->quic = cnx->quic;
             stream_data->bytes = (uint8_t*)malloc(length);
 
             if (stream_data->bytes == NULL) {
@@ -243,20 +269,9 @@ int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
                 stream_data = NULL;
                 ret = -1;
             } else {
-                picoquic_stream_queue_node_t** pprevious = &stream->send_queue;
-                picoquic_stream_queue_node_t* next = stream->send_queue;
-
                 memcpy(stream_data->bytes, data, length);
                 stream_data->length = length;
-                stream_data->offset = 0;
-                stream_data->next_stream_data = NULL;
-
-                while (next != NULL) {
-                    pprevious = &next->next_stream_data;
-                    next = next->next_stream_data;
-                }
-
-                *pprevious = stream_data;
+                picoquic_append_stream_queue_node(stream, stream_data);
             }
         }
 
@@ -267,6 +282,75 @@ int picoquic_add_to_stream_with_ctx(picoquic_cnx_t* cnx, uint64_t stream_id,
         cnx->nb_bytes_queued += length;
         stream->is_active = 0;
         stream->app_stream_ctx = app_stream_ctx;
+        picoquic_insert_output_stream(cnx, stream);
+    }
+
+    return ret;
+}
+
+int picoquic_add_buffers_to_stream(picoquic_cnx_t* cnx, uint64_t stream_id,
+    const picoquic_iovec_t* iov, size_t iov_count, int set_fin,
+    picoquic_stream_buffer_release_fn release_fn, void* release_ctx, void* app_stream_ctx)
+{
+    int ret = 0;
+    size_t length = 0;
+    picoquic_stream_head_t* stream = NULL;
+    picoquic_stream_queue_node_t* first_data = NULL;
+    picoquic_stream_queue_node_t** p_last_data = &first_data;
+
+    /* Allocate all the segments before modifying the stream, so that
+     * nothing is queued and the FIN is not set if an allocation fails.
+     * The application keeps the ownership of the buffers in case of error. */
+    for (size_t i = 0; ret == 0 && i < iov_count; i++) {
+        if (iov[i].len > 0) {
+            picoquic_stream_queue_node_t* stream_data = (picoquic_stream_queue_node_t*)
+                malloc(sizeof(picoquic_stream_queue_node_t));
+            if (stream_data == NULL) {
+                ret = -1;
+            }
+            else {
+                memset(stream_data, 0, sizeof(picoquic_stream_queue_node_t));
+                stream_data->quic = cnx->quic;
+                stream_data->bytes = (uint8_t*)iov[i].base;
+                stream_data->length = iov[i].len;
+                stream_data->release_fn = release_fn;
+                stream_data->release_ctx = release_ctx;
+                stream_data->is_app_owned = 1;
+                *p_last_data = stream_data;
+                p_last_data = &stream_data->next_stream_data;
+                length += iov[i].len;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        stream = picoquic_find_stream_for_adding(cnx, stream_id, length, set_fin, &ret);
+    }
+
+    if (ret != 0) {
+        while (first_data != NULL) {
+            picoquic_stream_queue_node_t* next = first_data->next_stream_data;
+            free(first_data);
+            first_data = next;
+        }
+    }
+    else {
+        if (first_data != NULL) {
+            picoquic_append_stream_queue_node(stream, first_data);
+            cnx->nb_bytes_queued += length;
+        }
+        /* Empty buffers have nothing to send, and can be released immediately */
+        for (size_t i = 0; release_fn != NULL && i < iov_count; i++) {
+            if (iov[i].len == 0) {
+                release_fn(release_ctx, iov[i].base, 0, 1);
+            }
+        }
+        if (length > 0) {
+            picoquic_reinsert_by_wake_time(cnx->quic, cnx, picoquic_get_quic_time(cnx->quic));
+        }
+        stream->is_active = 0;
+        stream->app_stream_ctx = app_stream_ctx;
+        picoquic_insert_output_stream(cnx, stream);
     }
 
     return ret;
@@ -355,6 +439,7 @@ int picoquic_reset_stream(picoquic_cnx_t* cnx,
         else if (!stream->reset_requested) {
             stream->local_error = local_stream_error;
             stream->reset_requested = 1;
+            picoquic_insert_output_stream(cnx, stream);
         }
     }
 
@@ -509,7 +594,8 @@ picoquic_packet_t* picoquic_create_packet(picoquic_quic_t * quic)
 void picoquic_recycle_packet(picoquic_quic_t * quic, picoquic_packet_t* packet)
 {
     if (packet != NULL) {
-        if (quic->nb_packets_in_pool >= PICOQUIC_MAX_PACKETS_IN_POOL) {
+        if (packet->is_compact || quic->nb_packets_in_pool >= PICOQUIC_MAX_PACKETS_IN_POOL) {
+            /* Compact records are too short to be reused */
             free(packet);
             quic->nb_packets_allocated--;
         }
@@ -819,6 +905,18 @@ size_t picoquic_get_checksum_length(picoquic_cnx_t* cnx, picoquic_epoch_enum epo
     return ret;
 }
 
+static void picoquic_apply_header_protection_mask(uint8_t* send_buffer, size_t pn_offset, uint8_t first_mask, const uint8_t* mask_bytes)
+{
+    /* Encode the first byte */
+    uint8_t pn_l = (send_buffer[0] & 3) + 1;
+    send_buffer[0] ^= (mask_bytes[0] & first_mask);
+
+    /* Packet encoding is 1 to 4 bytes */
+    for (uint8_t i = 0; i < pn_l; i++) {
+        send_buffer[pn_offset + i] ^= mask_bytes[i + 1];
+    }
+}
+
 void picoquic_protect_packet_header(uint8_t * send_buffer, size_t pn_offset, uint8_t first_mask, void* pn_enc)
 {
     /* The sample is located after the pn_offset */
@@ -828,20 +926,74 @@ void picoquic_protect_packet_header(uint8_t * send_buffer, size_t pn_offset, uin
     {
         /* This is always true, as we use pn_length = 4 */
         uint8_t mask_bytes[5] = { 0, 0, 0, 0, 0 };
-        uint8_t pn_l;
 
         picoquic_pn_encrypt(pn_enc, send_buffer + sample_offset, mask_bytes, mask_bytes, 5);
-        /* Encode the first byte */
-        pn_l = (send_buffer[0] & 3) + 1;
-        send_buffer[0] ^= (mask_bytes[0] & first_mask);
+        picoquic_apply_header_protection_mask(send_buffer, pn_offset, first_mask, mask_bytes);
+    }
+}
+
+/*
+ * Batched packet protection.
+ * While a train of packets is being prepared, the 1-RTT packets are staged
+ * in the send buffer, with a clear text header followed by the plaintext
+ * payload. They are all encrypted when the train is complete, or when the
+ * batch is full, and the header protection is applied after that.
+ */
+void picoquic_protect_batch_open(picoquic_quic_t* quic)
+{
+    if (quic->protect_batch == NULL) {
+        quic->protect_batch = (picoquic_aead_batch_entry_t*)malloc(
+            sizeof(picoquic_aead_batch_entry_t) * PICOQUIC_PROTECT_BATCH_MAX);
+    }
+    quic->protect_batch_nb = 0;
+    /* If the allocation failed, packets are protected one at a time */
+    quic->is_protect_batch_open = (quic->protect_batch != NULL);
+}
 
-        /* Packet encoding is 1 to 4 bytes */
-        for (uint8_t i = 0; i < pn_l; i++) {
-            send_buffer[pn_offset+i] ^= mask_bytes[i+1];
+void picoquic_protect_batch_flush(picoquic_quic_t* quic)
+{
+    if (quic->protect_batch_nb > 0) {
+        picoquic_aead_encrypt_batch(quic->protect_batch, quic->protect_batch_nb);
+
+        for (size_t i = 0; i < quic->protect_batch_nb; i++) {
+            picoquic_aead_batch_entry_t* entry = &quic->protect_batch[i];
+
+            picoquic_apply_header_protection_mask(entry->packet, entry->pn_offset, entry->first_mask, entry->hp_mask);
         }
+        quic->protect_batch_nb = 0;
     }
 }
 
+void picoquic_protect_batch_close(picoquic_quic_t* quic)
+{
+    picoquic_protect_batch_flush(quic);
+    quic->is_protect_batch_open = 0;
+}
+
+static void picoquic_protect_batch_stage(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    uint8_t* send_buffer, size_t h_length, const uint8_t* payload, size_t payload_length,
+    size_t pn_offset, uint8_t first_mask, uint64_t sequence_number, void* aead_context, void* pn_enc)
+{
+    picoquic_quic_t* quic = cnx->quic;
+    picoquic_aead_batch_entry_t* entry;
+
+    if (quic->protect_batch_nb >= PICOQUIC_PROTECT_BATCH_MAX) {
+        picoquic_protect_batch_flush(quic);
+    }
+    entry = &quic->protect_batch[quic->protect_batch_nb++];
+    memmove(send_buffer + h_length, payload, payload_length);
+    entry->packet = send_buffer;
+    entry->header_length = h_length;
+    entry->payload_length = payload_length;
+    entry->pn_offset = pn_offset;
+    entry->sequence_number = sequence_number;
+    entry->path_id = path_x->unique_path_id;
+    entry->aead_ctx = aead_context;
+    entry->pn_enc = pn_enc;
+    entry->is_multipath = cnx->is_multipath_enabled;
+    entry->first_mask = first_mask;
+}
+
 size_t picoquic_protect_packet(picoquic_cnx_t* cnx, 
     picoquic_packet_type_enum ptype,
     uint8_t * bytes, 
@@ -916,8 +1068,13 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         }
     }
 
-    /* Encrypt the packet */
-    if (cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected) {
+    /* Encrypt the packet, or stage it if the train is protected as a batch */
+    if (cnx->quic->is_protect_batch_open && ptype == picoquic_packet_1rtt_protected) {
+        picoquic_protect_batch_stage(cnx, path_x, send_buffer, h_length, bytes + header_length, length - header_length,
+            pn_offset, first_mask, sequence_number, aead_context, pn_enc);
+        send_length = length - header_length + aead_checksum_length;
+    }
+    else if (cnx->is_multipath_enabled && ptype == picoquic_packet_1rtt_protected) {
         send_length = picoquic_aead_encrypt_mp(send_buffer + /* header_length */ h_length,
             bytes + header_length, length - header_length, path_x->unique_path_id,
             sequence_number, send_buffer, /* header_length */ h_length, aead_context);
@@ -935,12 +1092,254 @@ size_t picoquic_protect_packet(picoquic_cnx_t* cnx,
         bytes, sequence_number, pn_length, length,
         send_buffer, send_length, current_time);
 
-    /* Next, encrypt the PN -- The sample is located after the pn_offset */
-    picoquic_protect_packet_header(send_buffer, pn_offset, first_mask, pn_enc);
+    /* Next, encrypt the PN -- The sample is located after the pn_offset.
+     * For staged packets, this is done when the batch is flushed. */
+    if (!cnx->quic->is_protect_batch_open || ptype != picoquic_packet_1rtt_protected) {
+        picoquic_protect_packet_header(send_buffer, pn_offset, first_mask, pn_enc);
+    }
 
     return send_length;
 }
 
+/*
+ * Index of the packets in the retransmit and retransmitted queues, by
+ * sequence number. The index is a ring of pointers, in which the packet
+ * number N is stored at position N modulo the ring size. The ring is
+ * resized when the range of indexed numbers exceeds its size.
+ */
+#define PICOQUIC_PN_INDEX_SIZE_MIN 256
+
+static void picoquic_pn_index_place_list(picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p)
+{
+    uint64_t mask = pkt_ctx->pn_index_size - 1;
+
+    while (p != NULL) {
+        pkt_ctx->pn_index[p->sequence_number & mask] = p;
+        pkt_ctx->pn_index_count++;
+        if (p->sequence_number < pkt_ctx->pn_index_min) {
+            pkt_ctx->pn_index_min = p->sequence_number;
+        }
+        if (p->sequence_number > pkt_ctx->pn_index_max) {
+            pkt_ctx->pn_index_max = p->sequence_number;
+        }
+        p = p->packet_next;
+    }
+}
+
+static void picoquic_pn_index_resize(picoquic_packet_context_t* pkt_ctx, uint64_t range)
+{
+    uint64_t new_size = (pkt_ctx->pn_index_size == 0) ? PICOQUIC_PN_INDEX_SIZE_MIN : pkt_ctx->pn_index_size;
+    picoquic_packet_t** new_index;
+
+    while (new_size <= range) {
+        new_size *= 2;
+    }
+
+    new_index = (picoquic_packet_t**)malloc(sizeof(picoquic_packet_t*) * (size_t)new_size);
+    if (new_index == NULL) {
+        /* Give up on the index, use the linear search instead */
+        picoquic_pn_index_free(pkt_ctx);
+        pkt_ctx->is_pn_index_disabled = 1;
+    }
+    else {
+        memset(new_index, 0, sizeof(picoquic_packet_t*) * (size_t)new_size);
+        if (pkt_ctx->pn_index != NULL) {
+            free(pkt_ctx->pn_index);
+        }
+        pkt_ctx->pn_index = new_index;
+        pkt_ctx->pn_index_size = new_size;
+        pkt_ctx->pn_index_count = 0;
+        pkt_ctx->pn_index_min = UINT64_MAX;
+        pkt_ctx->pn_index_max = 0;
+        picoquic_pn_index_place_list(pkt_ctx, pkt_ctx->pending_first);
+        picoquic_pn_index_place_list(pkt_ctx, pkt_ctx->retransmitted_newest);
+    }
+}
+
+/* Add a packet to the index, after it was added to the retransmit queue */
+static void picoquic_pn_index_insert(picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* packet)
+{
+    uint64_t sequence_number = packet->sequence_number;
+
+    if (pkt_ctx->is_pn_index_disabled) {
+        return;
+    }
+
+    if (pkt_ctx->pn_index_count == 0) {
+        pkt_ctx->pn_index_min = sequence_number;
+        pkt_ctx->pn_index_max = sequence_number;
+    }
+    else if (sequence_number > pkt_ctx->pn_index_max) {
+        pkt_ctx->pn_index_max = sequence_number;
+    }
+    else if (sequence_number < pkt_ctx->pn_index_min) {
+        pkt_ctx->pn_index_min = sequence_number;
+    }
+
+    if (pkt_ctx->pn_index_max - pkt_ctx->pn_index_min >= pkt_ctx->pn_index_size) {
+        /* Resizing places all the queued packets, including this one */
+        picoquic_pn_index_resize(pkt_ctx, pkt_ctx->pn_index_max - pkt_ctx->pn_index_min);
+    }
+    else {
+        pkt_ctx->pn_index[sequence_number & (pkt_ctx->pn_index_size - 1)] = packet;
+        pkt_ctx->pn_index_count++;
+    }
+}
+
+/* Remove a packet from the index, when it leaves both queues.
+ * The lowest indexed number moves up to the next indexed packet. Packet
+ * numbers only grow, so each number is skipped at most once. The highest
+ * number is not lowered, it remains a valid upper bound.
+ */
+static void picoquic_pn_index_remove(picoquic_packet_context_t* pkt_ctx, picoquic_packet_t* p)
+{
+    if (pkt_ctx->pn_index != NULL) {
+        uint64_t mask = pkt_ctx->pn_index_size - 1;
+
+        if (pkt_ctx->pn_index[p->sequence_number & mask] == p) {
+            pkt_ctx->pn_index[p->sequence_number & mask] = NULL;
+            pkt_ctx->pn_index_count--;
+            if (pkt_ctx->pn_index_count == 0) {
+                pkt_ctx->pn_index_min = pkt_ctx->pn_index_max + 1;
+            }
+            else if (p->sequence_number == pkt_ctx->pn_index_min) {
+                while (pkt_ctx->pn_index[pkt_ctx->pn_index_min & mask] == NULL) {
+                    pkt_ctx->pn_index_min++;
+                }
+            }
+        }
+    }
+}
+
+/* Find a packet in the retransmit or retransmitted queue. Returns NULL if the
+ * packet is not queued, or if the index is not available. */
+picoquic_packet_t* picoquic_pn_index_find(picoquic_packet_context_t* pkt_ctx, uint64_t sequence_number)
+{
+    picoquic_packet_t* p = NULL;
+
+    if (pkt_ctx->pn_index != NULL && pkt_ctx->pn_index_count > 0 &&
+        sequence_number >= pkt_ctx->pn_index_min && sequence_number <= pkt_ctx->pn_index_max) {
+        p = pkt_ctx->pn_index[sequence_number & (pkt_ctx->pn_index_size - 1)];
+        if (p != NULL && p->sequence_number != sequence_number) {
+            p = NULL;
+        }
+    }
+
+    return p;
+}
+
+void picoquic_pn_index_free(picoquic_packet_context_t* pkt_ctx)
+{
+    if (pkt_ctx->pn_index != NULL) {
+        free(pkt_ctx->pn_index);
+        pkt_ctx->pn_index = NULL;
+    }
+    pkt_ctx->pn_index_size = 0;
+    pkt_ctx->pn_index_count = 0;
+    pkt_ctx->pn_index_min = 0;
+    pkt_ctx->pn_index_max = 0;
+    pkt_ctx->is_pn_index_disabled = 0;
+}
+
+/*
+ * Compact records of sent packets.
+ * The packet copy is replaced by a manifest of its frames, in which stream
+ * frames are replaced by references to the data retained in the stream.
+ * Padding is dropped, other frames are copied. The record is only compacted
+ * after the next packet is queued, because the code that prepared the packet
+ * still uses it until then. Returns the compact record, or the original packet
+ * if the record cannot be compacted.
+ */
+static picoquic_packet_t* picoquic_compact_sent_packet(picoquic_cnx_t* cnx, picoquic_packet_context_t* pkt_ctx,
+    picoquic_packet_t* packet)
+{
+    uint8_t manifest[PICOQUIC_MAX_PACKET_SIZE];
+    uint8_t* bytes_next = manifest;
+    uint8_t* bytes_max = manifest + sizeof(manifest);
+    size_t byte_index = packet->offset;
+    picoquic_packet_t* compact = NULL;
+
+    while (bytes_next != NULL && byte_index < packet->length) {
+        uint8_t* frame = &packet->bytes[byte_index];
+        size_t frame_length = 0;
+        int frame_is_pure_ack = 0;
+        uint64_t stream_id;
+        uint64_t offset;
+        size_t data_length;
+        size_t consumed;
+        int fin;
+        picoquic_stream_head_t* stream;
+
+        if (picoquic_skip_frame(frame, packet->length - byte_index, &frame_length, &frame_is_pure_ack) != 0) {
+            bytes_next = NULL;
+        }
+        else if (PICOQUIC_IN_RANGE(frame[0], picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max) &&
+            picoquic_parse_stream_header(frame, frame_length, &stream_id, &offset, &data_length, &fin, &consumed) == 0 &&
+            (stream = picoquic_find_stream(cnx, stream_id)) != NULL &&
+            picoquic_stream_copy_sent_data(stream, offset, data_length, NULL) == 0) {
+            bytes_next = picoquic_format_stream_ref_frame(bytes_next, bytes_max, stream_id, offset, data_length, fin);
+        }
+        else if (frame[0] != picoquic_frame_type_padding) {
+            if (bytes_next + frame_length <= bytes_max) {
+                memcpy(bytes_next, frame, frame_length);
+                bytes_next += frame_length;
+            }
+            else {
+                bytes_next = NULL;
+            }
+        }
+        byte_index += frame_length;
+    }
+
+    if (bytes_next != NULL) {
+        size_t compact_length = bytes_next - manifest;
+
+        compact = (picoquic_packet_t*)malloc(PICOQUIC_PACKET_COMPACT_SIZE + compact_length);
+    }
+
+    if (compact == NULL) {
+        compact = packet;
+    }
+    else {
+        memcpy(compact, packet, PICOQUIC_PACKET_COMPACT_SIZE);
+        compact->compact_length = bytes_next - manifest;
+        memcpy(compact->bytes, manifest, compact->compact_length);
+        compact->offset = 0;
+        compact->is_compact = 1;
+        cnx->nb_packets_compacted++;
+        cnx->quic->nb_packets_allocated++;
+        if (cnx->quic->nb_packets_allocated > cnx->quic->nb_packets_allocated_max) {
+            cnx->quic->nb_packets_allocated_max = cnx->quic->nb_packets_allocated;
+        }
+        /* Replace the packet in the retransmit queue and in the index */
+        if (compact->packet_previous == NULL) {
+            pkt_ctx->pending_first = compact;
+        }
+        else {
+            compact->packet_previous->packet_next = compact;
+        }
+        if (compact->packet_next == NULL) {
+            pkt_ctx->pending_last = compact;
+        }
+        else {
+            compact->packet_next->packet_previous = compact;
+        }
+        if (pkt_ctx->preemptive_repeat_ptr == packet) {
+            pkt_ctx->preemptive_repeat_ptr = compact;
+        }
+        if (pkt_ctx->redundant_repeat_ptr == packet) {
+            pkt_ctx->redundant_repeat_ptr = compact;
+        }
+        if (pkt_ctx->pn_index != NULL &&
+            pkt_ctx->pn_index[packet->sequence_number & (pkt_ctx->pn_index_size - 1)] == packet) {
+            pkt_ctx->pn_index[packet->sequence_number & (pkt_ctx->pn_index_size - 1)] = compact;
+        }
+        picoquic_recycle_packet(cnx->quic, packet);
+    }
+
+    return compact;
+}
+
 /*
  * Final steps in packet transmission: queue for retransmission, etc
  */
@@ -957,6 +1356,16 @@ void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x
         pkt_ctx = &cnx->pkt_ctx[packet->pc];
     }
 
+    /* The previous packet is not used anymore by the sending code */
+    if (cnx->quic->use_compact_sent_packets && pkt_ctx->pending_last != NULL) {
+        picoquic_packet_t* last = pkt_ctx->pending_last;
+
+        if (!last->is_compact && last->ptype == picoquic_packet_1rtt_protected &&
+            !last->is_ack_trap && !last->is_mtu_probe && !last->is_multipath_probe) {
+            (void)picoquic_compact_sent_packet(cnx, pkt_ctx, last);
+        }
+    }
+
     /* Manage the double linked packet list for retransmissions */
     packet->packet_next = NULL;
     if (pkt_ctx->pending_last == NULL) {
@@ -968,6 +1377,7 @@ void picoquic_queue_for_retransmit(picoquic_cnx_t* cnx, picoquic_path_t * path_x
     }
     pkt_ctx->pending_last = packet;
     packet->is_queued_for_retransmit = 1;
+    picoquic_pn_index_insert(pkt_ctx, packet);
 
     if (!packet->is_ack_trap) {
         /* Account for bytes in transit, for congestion control */
@@ -1018,8 +1428,12 @@ picoquic_packet_t* picoquic_dequeue_retransmit_packet(picoquic_cnx_t* cnx,
     if (pkt_ctx->preemptive_repeat_ptr == p) {
         pkt_ctx->preemptive_repeat_ptr = p->packet_next;
     }
+    if (pkt_ctx->redundant_repeat_ptr == p) {
+        pkt_ctx->redundant_repeat_ptr = p->packet_next;
+    }
 
     if (should_free || p->is_ack_trap) {
+        picoquic_pn_index_remove(pkt_ctx, p);
         if (add_to_data_repeat_queue) {
             picoquic_queue_data_repeat_packet(cnx, p);
         }
@@ -1069,6 +1483,8 @@ void picoquic_dequeue_retransmitted_packet(picoquic_cnx_t* cnx, picoquic_packet_
         p->packet_next->packet_previous = p->packet_previous;
     }
 
+    picoquic_pn_index_remove(pkt_ctx, p);
+
     /* Packets can be queued simultaneously for data repeat and 
     * for detection of spurious losses, so should only be recycled
     * when removed from both queues */
@@ -1225,9 +1641,10 @@ int picoquic_is_pkt_ctx_backlog_empty(picoquic_packet_context_t* pkt_ctx)
         byte_index = p->offset;
 
         if (!p->is_ack_trap && !p->is_multipath_probe && !p->is_mtu_probe) {
-            while (ret == 0 && byte_index < p->length) {
+            size_t frames_end = PICOQUIC_PACKET_FRAMES_END(p);
+            while (ret == 0 && byte_index < frames_end) {
                 ret = picoquic_skip_frame(&p->bytes[byte_index],
-                    p->length - p->offset, &frame_length, &frame_is_pure_ack);
+                    frames_end - byte_index, &frame_length, &frame_is_pure_ack);
 
                 if (!frame_is_pure_ack) {
                     backlog_empty = 0;
@@ -1275,13 +1692,18 @@ int picoquic_is_cnx_backlog_empty(picoquic_cnx_t* cnx)
  * could be repeated, e.g., because of packet size, then the old packet
  * must not be marked as preemptively repeated, because otherwise these
  * non-repeated frames would be lost forever.
+ * If the packet is repeated for the redundant path scheduler, all
+ * frames that are not "pure ack" are repeated, even if they do not
+ * trigger preemptive repeat, and the old packet is not marked as
+ * preemptively repeated: it is still retransmitted if lost.
  */
 static int picoquic_preemptive_retransmit_packet(picoquic_packet_t* old_p,
     picoquic_cnx_t* cnx,
     uint8_t* new_bytes,
     size_t send_buffer_max_minus_checksum,
     size_t* length,
-    int * has_data)
+    int * has_data,
+    int is_redundant)
 {
     /* check if this is an ACK only packet */
     int ret = 0;
@@ -1297,8 +1719,11 @@ static int picoquic_preemptive_retransmit_packet(picoquic_packet_t* old_p,
 
     if (!old_p->is_mtu_probe &&
         !old_p->is_ack_trap &&
-        !old_p->is_multipath_probe) {
-        /* Copy the relevant bytes from one packet to the next */
+        !old_p->is_multipath_probe &&
+        !old_p->is_compact) {
+        /* Copy the relevant bytes from one packet to the next.
+         * Compact records do not hold the stream data, and are only
+         * repeated if they are lost. */
         byte_index = old_p->offset;
 
         while (ret == 0 && byte_index < old_p->length) {
@@ -1340,12 +1765,12 @@ static int picoquic_preemptive_retransmit_packet(picoquic_packet_t* old_p,
     }
 
     if (*has_data) {
-        if (!is_preemptive_needed) {
+        if (!is_preemptive_needed && !is_redundant) {
             /* If the packet does not contain any frame requiring preemptive repeat, do not repeat it. */
             *length = initial_length;
             *has_data = 0;
             is_repeated = 0;
-        } else if (is_repeated) {
+        } else if (is_repeated && !is_redundant) {
             old_p->was_preemptively_repeated = 1;
         }
     }
@@ -1409,7 +1834,7 @@ int picoquic_preemptive_retransmit_in_context(
                 break;
             }
             ret = picoquic_preemptive_retransmit_packet(pkt_ctx->preemptive_repeat_ptr, cnx,
-                new_bytes, send_buffer_max_minus_checksum, length, has_data);
+                new_bytes, send_buffer_max_minus_checksum, length, has_data, 0);
             if (ret != 0) {
                 break;
             }
@@ -1477,6 +1902,113 @@ int picoquic_preemptive_retransmit_as_needed(
     return ret;
 }
 
+/* Redundant scheduling: before sending new data on a path, repeat on that
+ * path the packets recently sent on other paths. Each packet records in
+ * `redundant_path_mask` the paths on which it was repeated, so that it is
+ * sent once on every path that the scheduler may use. Packets that were
+ * sent more than half an RTT ago on their original path are not repeated,
+ * so that a slow path does not fall behind indefinitely repeating packets
+ * that were already delivered.
+ * Each packet context has its own cursor, `redundant_repeat_ptr`, separate
+ * from the preemptive repeat cursor. The cursor moves past the packets that
+ * are too old, or that were repeated on all the candidate paths.
+ */
+static uint64_t picoquic_redundant_path_bit(picoquic_path_t* path_x)
+{
+    /* Paths whose identifiers differ by 64 share a bit, which at worst
+     * causes a missing copy. */
+    return ((uint64_t)1) << (path_x->unique_path_id & 63);
+}
+
+static int picoquic_redundant_retransmit_in_context(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* old_path,
+    picoquic_path_t* path_x,
+    uint64_t candidate_mask,
+    uint64_t current_time,
+    uint8_t* new_bytes,
+    size_t send_buffer_max_minus_checksum,
+    size_t* length,
+    int* has_data,
+    int* more_data)
+{
+    int ret = 0;
+    picoquic_packet_context_t* pkt_ctx = &old_path->pkt_ctx;
+    uint64_t old_path_bit = picoquic_redundant_path_bit(old_path);
+    uint64_t path_bit = picoquic_redundant_path_bit(path_x);
+    picoquic_packet_t* old_p;
+
+    if (pkt_ctx->redundant_repeat_ptr == NULL) {
+        pkt_ctx->redundant_repeat_ptr = pkt_ctx->pending_first;
+    }
+    old_p = pkt_ctx->redundant_repeat_ptr;
+
+    while (ret == 0 && old_p != NULL) {
+        /* Never repeat a repetition, or a packet that is too old */
+        int is_done = old_p->is_preemptive_repeat || old_p->is_compact ||
+            old_p->send_time + old_path->smoothed_rtt / 2 < current_time;
+
+        if (!is_done && (old_p->redundant_path_mask & path_bit) == 0) {
+            if (*has_data) {
+                /* Only one packet is repeated at a time */
+                *more_data = 1;
+                break;
+            }
+            ret = picoquic_preemptive_retransmit_packet(old_p, cnx,
+                new_bytes, send_buffer_max_minus_checksum, length, has_data, 1);
+            old_p->redundant_path_mask |= path_bit;
+            if (*has_data) {
+                cnx->nb_preemptive_repeat++;
+            }
+        }
+        if (!is_done) {
+            is_done = ((old_p->redundant_path_mask | old_path_bit) & candidate_mask) == candidate_mask;
+        }
+        /* Keep the cursor on the last packet, so that new packets are found
+         * without scanning the whole queue again. */
+        if (is_done && old_p == pkt_ctx->redundant_repeat_ptr && old_p->packet_next != NULL) {
+            pkt_ctx->redundant_repeat_ptr = old_p->packet_next;
+        }
+        old_p = old_p->packet_next;
+    }
+
+    return ret;
+}
+
+int picoquic_redundant_retransmit_as_needed(
+    picoquic_cnx_t* cnx,
+    picoquic_path_t* path_x,
+    uint64_t current_time,
+    uint8_t* new_bytes,
+    size_t send_buffer_max_minus_checksum,
+    size_t* length,
+    int* more_data,
+    int* is_pure_ack)
+{
+    int ret = 0;
+    int has_data = 0;
+    uint64_t candidate_mask = picoquic_redundant_path_bit(path_x);
+
+    /* The candidate flags were just set by picoquic_sort_available_paths */
+    for (int i = 0; i < cnx->nb_paths; i++) {
+        if (cnx->path[i]->is_scheduler_candidate) {
+            candidate_mask |= picoquic_redundant_path_bit(cnx->path[i]);
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < cnx->nb_paths; i++) {
+        if (cnx->path[i] != path_x) {
+            ret = picoquic_redundant_retransmit_in_context(cnx, cnx->path[i], path_x, candidate_mask, current_time,
+                new_bytes, send_buffer_max_minus_checksum, length, &has_data, more_data);
+        }
+    }
+    if (ret == 0) {
+        *is_pure_ack &= !has_data;
+    }
+
+    return ret;
+}
+
 /* Compute the next logical probe length */
 static size_t picoquic_next_mtu_probe_length(picoquic_cnx_t* cnx, picoquic_path_t * path_x)
 {
@@ -2651,6 +3183,7 @@ void picoquic_client_almost_ready_transition(picoquic_cnx_t* cnx)
         picoquic_packet_context_t* o_pkt_ctx = &cnx->pkt_ctx[0];
         picoquic_packet_context_t* n_pkt_ctx = &cnx->path[0]->pkt_ctx;
 
+        picoquic_pn_index_free(n_pkt_ctx);
         *n_pkt_ctx = *o_pkt_ctx;
         picoquic_init_packet_ctx(cnx, o_pkt_ctx, picoquic_packet_context_application);
     }
@@ -2737,7 +3270,7 @@ void picoquic_ready_state_transition(picoquic_cnx_t* cnx, uint64_t current_time)
 
 /* sending of datagrams */
 static uint8_t* picoquic_prepare_datagram_ready(picoquic_cnx_t* cnx, picoquic_path_t * path_x, uint8_t* bytes_next, uint8_t* bytes_max,
-    int* more_data, int* is_pure_ack, int* datagram_tried_and_failed, int* datagram_sent, int * ret)
+    int* more_data, int* is_pure_ack, int* datagram_tried_and_failed, int* datagram_sent, uint64_t current_time, int * ret)
 {
     uint8_t* bytes0 = bytes_next;
 
@@ -2745,6 +3278,10 @@ static uint8_t* picoquic_prepare_datagram_ready(picoquic_cnx_t* cnx, picoquic_pa
         bytes_next = picoquic_format_first_datagram_frame(cnx, bytes_next, bytes_max, more_data, is_pure_ack);
         *more_data |= (cnx->first_datagram != NULL);
     }
+    else if (cnx->datagram_ring.nb_entries > 0) {
+        bytes_next = picoquic_format_first_queued_datagram_frame(cnx, bytes_next, bytes_max, more_data, is_pure_ack, current_time);
+        *more_data |= (cnx->datagram_ring.nb_entries > 0);
+    }
     else {
         while (cnx->is_datagram_ready || path_x->is_datagram_ready) {
             uint8_t* dg_start = bytes_next;
@@ -2820,7 +3357,9 @@ static uint8_t* picoquic_prepare_stream_and_datagrams(picoquic_cnx_t* cnx, picoq
         /* Find the highest priority level for which there is something to send, then
         * format the frames to send at that level. Repeat in a loop until the
         * packet is full or there is nothing more to send. */
-        uint64_t datagram_present = cnx->first_datagram != NULL || cnx->is_datagram_ready || path_x->is_datagram_ready;
+        uint64_t datagram_present = cnx->first_datagram != NULL ||
+            picoquic_datagram_ring_first(&cnx->datagram_ring, current_time) != NULL ||
+            cnx->is_datagram_ready || path_x->is_datagram_ready;
         picoquic_stream_head_t* first_stream = picoquic_find_ready_stream_path(cnx,
             (cnx->is_multipath_enabled) ? path_x : NULL);
         picoquic_packet_t* first_repeat = picoquic_first_data_repeat_packet(cnx);
@@ -2857,7 +3396,7 @@ static uint8_t* picoquic_prepare_stream_and_datagrams(picoquic_cnx_t* cnx, picoq
             cnx->datagram_priority == current_priority &&
             (cnx->datagram_priority < stream_priority || datagram_first)) {
             bytes_next = picoquic_prepare_datagram_ready(cnx, path_x, bytes_next, bytes_max,
-                &more_data_this_round, is_pure_ack, &datagram_tried_and_failed, &datagram_sent, ret);
+                &more_data_this_round, is_pure_ack, &datagram_tried_and_failed, &datagram_sent, current_time, ret);
             something_sent = datagram_sent;
         }
 
@@ -2903,7 +3442,7 @@ static uint8_t* picoquic_prepare_stream_and_datagrams(picoquic_cnx_t* cnx, picoq
             cnx->datagram_priority <= stream_priority &&
             !datagram_first) {
             bytes_next = picoquic_prepare_datagram_ready(cnx, path_x, bytes_next, bytes_max,
-                more_data, is_pure_ack, &datagram_tried_and_failed, &datagram_sent, ret);
+                more_data, is_pure_ack, &datagram_tried_and_failed, &datagram_sent, current_time, ret);
             something_sent = datagram_sent;
         }
 
@@ -3475,7 +4014,20 @@ int picoquic_prepare_packet_ready(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
                         if (ret == 0 && cnx->is_ack_frequency_updated && cnx->is_ack_frequency_negotiated) {
                             bytes_next = picoquic_format_ack_frequency_frame(cnx, bytes_next, bytes_max, &more_data);
                         }
-                        if (ret == 0) {
+                        if (ret == 0 && cnx->path_scheduler->is_redundant && cnx->is_multipath_enabled &&
+                            cnx->nb_paths > 1 && pc == picoquic_packet_context_application) {
+                            /* Repeat on this path the data recently sent on other paths */
+                            length = bytes_next - bytes;
+                            ret = picoquic_redundant_retransmit_as_needed(cnx, path_x, current_time, bytes_next,
+                                bytes_max - bytes_next, &length, &more_data, &is_pure_ack);
+                            if (length > (size_t)(bytes_next - bytes)) {
+                                preemptive_repeat = 1;
+                                no_data_to_send = 0;
+                                packet->is_preemptive_repeat = 1;
+                                bytes_next = bytes + length;
+                            }
+                        }
+                        if (ret == 0 && !preemptive_repeat) {
                             bytes_next = picoquic_prepare_stream_and_datagrams(cnx, path_x, bytes_next, bytes_max,
                                 UINT64_MAX, current_time, &more_data, &is_pure_ack, &no_data_to_send, &ret);
                         }
@@ -3966,6 +4518,7 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
             &path_x, &tuple, p_addr_to, p_addr_from, if_index,
             send_buffer_max, send_msg_size);
         initial_next_time = next_wake_time;
+        picoquic_protect_batch_open(cnx->quic);
 
         while (ret == 0)
         {
@@ -4106,6 +4659,8 @@ int picoquic_prepare_packet_ex(picoquic_cnx_t* cnx,
                 break;
             }
         }
+        /* Encrypt the packets staged during the train */
+        picoquic_protect_batch_close(cnx->quic);
         if (*send_length > 0) {
             picoquic_handle_send_train_statistics(cnx, path_x, coalesced_packet_size, send_length, send_msg_size);
         }
@@ -4222,7 +4777,7 @@ int picoquic_prepare_next_packet_ex(picoquic_quic_t* quic,
                     fflush(quic->F_log);
                 }
 
-                if (cnx->f_binlog != NULL) {
+                if (cnx->f_binlog != NULL && quic->binlog_ring == NULL) {
                     fflush(cnx->f_binlog);
                 }
 
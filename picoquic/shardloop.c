@@ -0,0 +1,483 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* Sharded server, see picoquic_shard.h.
+ *
+ * Each shard has a queue of pending items, protected by a mutex. An item
+ * is either a packet forwarded by another shard, or a work function posted
+ * by the application. Items are added by any thread, and the shard's network
+ * thread is woken up when the queue goes from empty to non empty. The network
+ * thread processes the whole queue when it handles the wake up event.
+ *
+ * The fields of a shard that other threads read or write, i.e., the queue,
+ * the thread context used for wake up, the closing flag and the statistics,
+ * are only accessed while holding the shard's queue mutex.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_packet_loop.h"
+#include "picoquic_lb.h"
+#include "picoquic_shard.h"
+
+/* Maximum number of forwarded packets waiting in a shard's queue.
+ * Packets beyond that are dropped, and will be repaired by the QUIC
+ * loss recovery. Posted work items are never dropped. */
+#define PICOQUIC_SHARD_QUEUE_PACKETS_MAX 4096
+
+typedef struct st_picoquic_shard_item_t {
+    struct st_picoquic_shard_item_t* next;
+    picoquic_shard_work_fn work_fn; /* NULL if the item is a forwarded packet */
+    void* work_ctx;
+    struct sockaddr_storage addr_from;
+    struct sockaddr_storage addr_to;
+    int if_index_to;
+    unsigned char received_ecn;
+    size_t length;
+    uint8_t* bytes;
+} picoquic_shard_item_t;
+
+typedef struct st_picoquic_shard_t {
+    picoquic_sharded_server_t* server;
+    int shard_id;
+    picoquic_quic_t* quic;
+    picoquic_packet_loop_param_t param;
+    picoquic_network_thread_ctx_t* thread_ctx;
+    void* loop_callback_ctx;
+    picoquic_mutex_t queue_mutex;
+    int queue_mutex_created;
+    picoquic_shard_item_t* first_item;
+    picoquic_shard_item_t* last_item;
+    size_t nb_queued_packets;
+    int is_closing;
+    /* Statistics */
+    uint64_t nb_forwarded;
+    uint64_t nb_received_forwarded;
+    uint64_t nb_dropped;
+} picoquic_shard_t;
+
+struct st_picoquic_sharded_server_t {
+    int nb_shards;
+    picoquic_shard_t* shards;
+    picoquic_packet_loop_cb_fn loop_callback;
+    /* Context used to decode CIDs outside of the network threads, because
+     * the encryption contexts of the shards' QUIC contexts are not thread safe. */
+    picoquic_load_balancer_cid_context_t* lb_ctx;
+    picoquic_mutex_t lb_mutex;
+    int lb_mutex_created;
+};
+
+static int picoquic_shard_enqueue(picoquic_shard_t* shard, picoquic_shard_item_t* item)
+{
+    int ret = 0;
+
+    item->next = NULL;
+    picoquic_lock_mutex(&shard->queue_mutex);
+    if (shard->is_closing ||
+        (item->work_fn == NULL && shard->nb_queued_packets >= PICOQUIC_SHARD_QUEUE_PACKETS_MAX)) {
+        ret = -1;
+    }
+    else {
+        int was_empty = (shard->first_item == NULL);
+        if (shard->last_item == NULL) {
+            shard->first_item = item;
+        }
+        else {
+            shard->last_item->next = item;
+        }
+        shard->last_item = item;
+        if (item->work_fn == NULL) {
+            shard->nb_queued_packets++;
+        }
+        if (was_empty && shard->thread_ctx != NULL) {
+            /* The wake up is done while holding the mutex, so the thread context
+             * cannot be deleted concurrently. If the wake up fails, or if the
+             * thread is not started yet, the items will be processed at the
+             * next wake up */
+            (void)picoquic_wake_up_network_thread(shard->thread_ctx);
+        }
+    }
+    picoquic_unlock_mutex(&shard->queue_mutex);
+
+    return ret;
+}
+
+/* Statistics of the forwarding shard, updated in its network thread */
+static void picoquic_shard_count_forwarding(picoquic_shard_t* shard, int is_dropped)
+{
+    picoquic_lock_mutex(&shard->queue_mutex);
+    if (is_dropped) {
+        shard->nb_dropped++;
+    }
+    else {
+        shard->nb_forwarded++;
+    }
+    picoquic_unlock_mutex(&shard->queue_mutex);
+}
+
+static void picoquic_shard_free_items(picoquic_shard_item_t* item)
+{
+    while (item != NULL) {
+        picoquic_shard_item_t* next = item->next;
+        if (item->work_fn != NULL) {
+            (void)item->work_fn(NULL, item->work_ctx);
+        }
+        free(item);
+        item = next;
+    }
+}
+
+/* Process the queued items, in the network thread of the shard */
+static int picoquic_shard_process_queue(picoquic_shard_t* shard)
+{
+    int ret = 0;
+    picoquic_shard_item_t* item;
+    picoquic_cnx_t* last_cnx = NULL;
+    uint64_t current_time = picoquic_get_quic_time(shard->quic);
+
+    picoquic_lock_mutex(&shard->queue_mutex);
+    item = shard->first_item;
+    shard->first_item = NULL;
+    shard->last_item = NULL;
+    shard->nb_received_forwarded += shard->nb_queued_packets;
+    shard->nb_queued_packets = 0;
+    picoquic_unlock_mutex(&shard->queue_mutex);
+
+    while (item != NULL && ret == 0) {
+        picoquic_shard_item_t* next = item->next;
+
+        if (item->work_fn != NULL) {
+            ret = item->work_fn(shard->quic, item->work_ctx);
+        }
+        else {
+            ret = picoquic_incoming_packet_ex(shard->quic, item->bytes, item->length,
+                (struct sockaddr*)&item->addr_from, (struct sockaddr*)&item->addr_to,
+                item->if_index_to, item->received_ecn, &last_cnx, current_time);
+        }
+        free(item);
+        item = next;
+    }
+    /* If the loop stops on error, the remaining work items are released */
+    picoquic_shard_free_items(item);
+
+    return ret;
+}
+
+static int picoquic_shard_loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode,
+    void* callback_ctx, void* callback_argv)
+{
+    int ret = 0;
+    picoquic_shard_t* shard = (picoquic_shard_t*)callback_ctx;
+
+    if (cb_mode == picoquic_packet_loop_wake_up) {
+        ret = picoquic_shard_process_queue(shard);
+    }
+    if (ret == 0 && shard->server->loop_callback != NULL) {
+        ret = shard->server->loop_callback(quic, cb_mode, shard->loop_callback_ctx, callback_argv);
+    }
+    return ret;
+}
+
+/* Packet steering, called in the network thread of the shard for each
+ * incoming packet. Only packets with short headers are steered: the
+ * destination CID of long header packets may be chosen by the client,
+ * and these packets arrive at the shard that handles the handshake. */
+static int picoquic_shard_steer(void* steer_ctx, uint8_t* bytes, size_t length,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to, unsigned char received_ecn)
+{
+    int consumed = 0;
+    picoquic_shard_t* shard = (picoquic_shard_t*)steer_ctx;
+    uint8_t cid_length = shard->quic->local_cnxid_length;
+
+    if ((bytes[0] & 0x80) == 0 && cid_length > 0 && length > (size_t)cid_length + 1) {
+        picoquic_connection_id_t cid;
+        uint64_t server_id;
+
+        (void)picoquic_parse_connection_id(bytes + 1, cid_length, &cid);
+        server_id = picoquic_lb_compat_cid_verify(shard->quic, shard->quic->cnx_id_callback_ctx, &cid);
+        if (server_id < (uint64_t)shard->server->nb_shards && server_id != (uint64_t)shard->shard_id) {
+            picoquic_shard_t* target = &shard->server->shards[server_id];
+            picoquic_shard_item_t* item = (picoquic_shard_item_t*)malloc(sizeof(picoquic_shard_item_t) + length);
+
+            /* The packet is consumed even if it cannot be forwarded, because
+             * the local context would not recognize the connection. */
+            consumed = 1;
+            if (item == NULL) {
+                picoquic_shard_count_forwarding(shard, 1);
+            }
+            else {
+                memset(item, 0, sizeof(picoquic_shard_item_t));
+                picoquic_store_addr(&item->addr_from, addr_from);
+                picoquic_store_addr(&item->addr_to, addr_to);
+                item->if_index_to = if_index_to;
+                item->received_ecn = received_ecn;
+                item->length = length;
+                item->bytes = (uint8_t*)(item + 1);
+                memcpy(item->bytes, bytes, length);
+                if (picoquic_shard_enqueue(target, item) != 0) {
+                    free(item);
+                    picoquic_shard_count_forwarding(shard, 1);
+                }
+                else {
+                    picoquic_shard_count_forwarding(shard, 0);
+                }
+            }
+        }
+    }
+    return consumed;
+}
+
+void picoquic_delete_sharded_server(picoquic_sharded_server_t* server)
+{
+    if (server != NULL) {
+        if (server->shards != NULL) {
+            /* Stop all queues before deleting any thread, since the threads
+             * still running may forward packets to the other shards. */
+            for (int i = 0; i < server->nb_shards; i++) {
+                picoquic_shard_t* shard = &server->shards[i];
+                if (shard->queue_mutex_created) {
+                    picoquic_lock_mutex(&shard->queue_mutex);
+                    shard->is_closing = 1;
+                    picoquic_unlock_mutex(&shard->queue_mutex);
+                }
+            }
+            for (int i = 0; i < server->nb_shards; i++) {
+                picoquic_shard_t* shard = &server->shards[i];
+                if (shard->thread_ctx != NULL) {
+                    picoquic_delete_network_thread(shard->thread_ctx);
+                    shard->thread_ctx = NULL;
+                }
+            }
+            for (int i = 0; i < server->nb_shards; i++) {
+                picoquic_shard_t* shard = &server->shards[i];
+                picoquic_shard_free_items(shard->first_item);
+                shard->first_item = NULL;
+                shard->last_item = NULL;
+                if (shard->queue_mutex_created) {
+                    (void)picoquic_delete_mutex(&shard->queue_mutex);
+                }
+                if (shard->quic != NULL) {
+                    picoquic_lb_compat_cid_config_free(shard->quic);
+                }
+            }
+            free(server->shards);
+        }
+        if (server->lb_ctx != NULL) {
+            picoquic_lb_compat_cid_context_free(server->lb_ctx);
+        }
+        if (server->lb_mutex_created) {
+            (void)picoquic_delete_mutex(&server->lb_mutex);
+        }
+        free(server);
+    }
+}
+
+picoquic_sharded_server_t* picoquic_start_sharded_server(int nb_shards, picoquic_quic_t** quic,
+    picoquic_load_balancer_config_t* lb_config, picoquic_packet_loop_param_t* param,
+    picoquic_packet_loop_cb_fn loop_callback, void** loop_callback_ctx, int* ret)
+{
+    picoquic_sharded_server_t* server = NULL;
+    picoquic_load_balancer_config_t shard_config;
+
+    *ret = 0;
+    if (nb_shards <= 0 || nb_shards > 256 || param->local_port == 0) {
+        DBG_PRINTF("Cannot start %d shards on port %d", nb_shards, param->local_port);
+        *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+        return NULL;
+    }
+
+    if (lb_config != NULL) {
+        shard_config = *lb_config;
+    }
+    else {
+        memset(&shard_config, 0, sizeof(shard_config));
+        shard_config.method = picoquic_load_balancer_cid_clear;
+        shard_config.connection_id_length = quic[0]->local_cnxid_length;
+    }
+    if (shard_config.connection_id_length == 0) {
+        shard_config.connection_id_length = quic[0]->local_cnxid_length;
+    }
+    if (shard_config.server_id_length == 0) {
+        shard_config.server_id_length = 1;
+    }
+    shard_config.server_id64 = 0;
+
+    server = (picoquic_sharded_server_t*)malloc(sizeof(picoquic_sharded_server_t));
+    if (server == NULL) {
+        *ret = PICOQUIC_ERROR_MEMORY;
+        return NULL;
+    }
+    memset(server, 0, sizeof(picoquic_sharded_server_t));
+    server->nb_shards = nb_shards;
+    server->loop_callback = loop_callback;
+    server->shards = (picoquic_shard_t*)malloc(sizeof(picoquic_shard_t) * nb_shards);
+    if (server->shards == NULL) {
+        *ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        memset(server->shards, 0, sizeof(picoquic_shard_t) * nb_shards);
+        if ((server->lb_ctx = picoquic_lb_compat_cid_context_create(&shard_config)) == NULL ||
+            picoquic_create_mutex(&server->lb_mutex) != 0) {
+            DBG_PRINTF("%s", "Cannot create the CID decoding context");
+            *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+        }
+        else {
+            server->lb_mutex_created = 1;
+        }
+    }
+
+    /* Configure the shards */
+    for (int i = 0; *ret == 0 && i < nb_shards; i++) {
+        picoquic_shard_t* shard = &server->shards[i];
+
+        shard->server = server;
+        shard->shard_id = i;
+        shard->loop_callback_ctx = (loop_callback_ctx == NULL) ? NULL : loop_callback_ctx[i];
+        shard->param = *param;
+        shard->param.reuse_port = 1;
+        shard->param.steer_fn = picoquic_shard_steer;
+        shard->param.steer_ctx = shard;
+        shard_config.server_id64 = (uint64_t)i;
+        if (picoquic_create_mutex(&shard->queue_mutex) != 0) {
+            *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+        }
+        else {
+            shard->queue_mutex_created = 1;
+            if (picoquic_lb_compat_cid_config(quic[i], &shard_config) != 0) {
+                DBG_PRINTF("Cannot configure the CID generation of shard %d", i);
+                *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+            }
+            else {
+                shard->quic = quic[i];
+            }
+        }
+    }
+
+    /* Start the network threads, after all shards are configured so that
+     * packets can be forwarded as soon as they arrive. */
+    for (int i = 0; *ret == 0 && i < nb_shards; i++) {
+        picoquic_shard_t* shard = &server->shards[i];
+        picoquic_network_thread_ctx_t* thread_ctx = picoquic_start_network_thread(shard->quic, &shard->param,
+            picoquic_shard_loop_cb, shard, ret);
+
+        if (thread_ctx == NULL) {
+            if (*ret == 0) {
+                *ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+            }
+        }
+        else {
+            /* Publish the thread context to the other shards. Packets forwarded
+             * before that are still waiting in the queue. */
+            picoquic_lock_mutex(&shard->queue_mutex);
+            shard->thread_ctx = thread_ctx;
+            if (shard->first_item != NULL) {
+                (void)picoquic_wake_up_network_thread(thread_ctx);
+            }
+            picoquic_unlock_mutex(&shard->queue_mutex);
+        }
+    }
+
+    if (*ret != 0) {
+        picoquic_delete_sharded_server(server);
+        server = NULL;
+    }
+
+    return server;
+}
+
+int picoquic_sharded_server_nb_shards(picoquic_sharded_server_t* server)
+{
+    return server->nb_shards;
+}
+
+picoquic_network_thread_ctx_t* picoquic_sharded_server_thread(picoquic_sharded_server_t* server, int shard_id)
+{
+    picoquic_network_thread_ctx_t* thread_ctx = NULL;
+
+    if (shard_id >= 0 && shard_id < server->nb_shards) {
+        picoquic_shard_t* shard = &server->shards[shard_id];
+
+        picoquic_lock_mutex(&shard->queue_mutex);
+        thread_ctx = shard->thread_ctx;
+        picoquic_unlock_mutex(&shard->queue_mutex);
+    }
+    return thread_ctx;
+}
+
+int picoquic_shard_from_cid(picoquic_sharded_server_t* server, const picoquic_connection_id_t* cid)
+{
+    int shard_id = -1;
+    uint64_t server_id;
+
+    picoquic_lock_mutex(&server->lb_mutex);
+    server_id = picoquic_lb_compat_cid_verify(NULL, server->lb_ctx, cid);
+    picoquic_unlock_mutex(&server->lb_mutex);
+    if (server_id < (uint64_t)server->nb_shards) {
+        shard_id = (int)server_id;
+    }
+    return shard_id;
+}
+
+int picoquic_shard_post(picoquic_sharded_server_t* server, int shard_id, picoquic_shard_work_fn work_fn, void* work_ctx)
+{
+    int ret = 0;
+    picoquic_shard_item_t* item;
+
+    if (shard_id < 0 || shard_id >= server->nb_shards || work_fn == NULL) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+    }
+    else if ((item = (picoquic_shard_item_t*)malloc(sizeof(picoquic_shard_item_t))) == NULL) {
+        ret = PICOQUIC_ERROR_MEMORY;
+    }
+    else {
+        memset(item, 0, sizeof(picoquic_shard_item_t));
+        item->work_fn = work_fn;
+        item->work_ctx = work_ctx;
+        if (picoquic_shard_enqueue(&server->shards[shard_id], item) != 0) {
+            /* The shard is closing */
+            free(item);
+            ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+        }
+    }
+    return ret;
+}
+
+int picoquic_shard_post_by_cid(picoquic_sharded_server_t* server, const picoquic_connection_id_t* cid,
+    picoquic_shard_work_fn work_fn, void* work_ctx)
+{
+    return picoquic_shard_post(server, picoquic_shard_from_cid(server, cid), work_fn, work_ctx);
+}
+
+void picoquic_shard_get_forwarding_stats(picoquic_sharded_server_t* server, int shard_id,
+    uint64_t* nb_forwarded, uint64_t* nb_received_forwarded, uint64_t* nb_dropped)
+{
+    picoquic_shard_t* shard = &server->shards[shard_id];
+
+    picoquic_lock_mutex(&shard->queue_mutex);
+    *nb_forwarded = shard->nb_forwarded;
+    *nb_received_forwarded = shard->nb_received_forwarded;
+    *nb_dropped = shard->nb_dropped;
+    picoquic_unlock_mutex(&shard->queue_mutex);
+}
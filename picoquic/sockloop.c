@@ -59,6 +59,9 @@
 
 #else /* Linux */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* required for recvmmsg */
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -101,6 +104,14 @@
 #ifndef WSA_LAST_ERROR
 #define WSA_LAST_ERROR(x) ((long)(x))
 #endif
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+#define PICOQUIC_USE_RECVMMSG
+#define PICOQUIC_USE_SENDMMSG
+#define PICOQUIC_USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#endif
 #endif
 
 #include "picosocks.h"
@@ -342,6 +353,24 @@ void picoquic_packet_loop_close_socket(picoquic_socket_ctx_t* s_ctx)
 #endif
 }
 
+/* Allow several sockets to bind to the same port. On Linux, the kernel
+ * then distributes the incoming packets between these sockets based on
+ * a hash of the source and destination addresses and ports. */
+static int picoquic_packet_loop_set_reuse_port(SOCKET_TYPE fd)
+{
+#ifdef SO_REUSEPORT
+    int val = 1;
+    int ret = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const char*)&val, sizeof(val));
+    if (ret != 0) {
+        DBG_PRINTF("setsockopt SO_REUSEPORT fails, errno: %d\n", errno);
+    }
+    return ret;
+#else
+    DBG_PRINTF("%s", "SO_REUSEPORT is not supported on this platform.\n");
+    return -1;
+#endif
+}
+
 int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
     picoquic_socket_ctx_t* s_ctx)
 {
@@ -373,6 +402,7 @@ int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
         picoquic_socket_set_ecn_options(s_ctx->fd, s_ctx->af, &recv_set, &send_set) != 0 ||
 #endif
         picoquic_socket_set_pkt_info(s_ctx->fd, s_ctx->af) != 0 ||
+        (s_ctx->reuse_port && picoquic_packet_loop_set_reuse_port(s_ctx->fd) != 0) ||
         picoquic_bind_to_port(s_ctx->fd,s_ctx->af, s_ctx->port) != 0 ||
         picoquic_get_local_address(s_ctx->fd, &local_address) != 0 ||
         picoquic_socket_set_pmtud_options(s_ctx->fd, s_ctx->af) != 0)
@@ -445,6 +475,21 @@ int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
         if (ret == 0) {
             ret = picoquic_packet_set_windows_socket(send_coalesced, recv_coalesced, s_ctx);
         }
+#else
+#ifdef UDP_GRO
+        /* Ask the kernel to coalesce incoming datagrams of the same flow.
+         * Failure is not an error, the socket will just receive one datagram
+         * at a time. */
+        if (ret == 0 && !do_not_use_gso) {
+            int gro = 1;
+            if (setsockopt(s_ctx->fd, SOL_UDP, UDP_GRO, &gro, sizeof(gro)) == 0) {
+                s_ctx->supports_udp_recv_coalesced = 1;
+            }
+            else {
+                DBG_PRINTF("setsockopt UDP_GRO fails, errno: %d\n", errno);
+            }
+        }
+#endif
 #endif
     }
 
@@ -453,6 +498,13 @@ int picoquic_packet_loop_open_socket(int socket_buffer_size, int do_not_use_gso,
 
 int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
     int do_not_use_gso, picoquic_socket_ctx_t* s_ctx)
+{
+    return picoquic_packet_loop_open_sockets_ex(local_port, local_af, socket_buffer_size, extra_socket_required,
+        do_not_use_gso, 0, s_ctx);
+}
+
+int picoquic_packet_loop_open_sockets_ex(uint16_t local_port, int local_af, int socket_buffer_size, int extra_socket_required,
+    int do_not_use_gso, int reuse_port, picoquic_socket_ctx_t* s_ctx)
 {
     /* Compute how many sockets are necessary, and set the intial value of AF and port per socket */
     int nb_sockets = 0;
@@ -480,6 +532,8 @@ int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int soc
             s_ctx[nb_sockets].af = af[i_af];
             s_ctx[nb_sockets].port = current_port;
             s_ctx[nb_sockets].n_port = htons(current_port);
+            /* Only the sockets bound to the specified local port are shared */
+            s_ctx[nb_sockets].reuse_port = (reuse_port && iteration == 0 && local_port != 0);
             if ((sock_ret = picoquic_packet_loop_open_socket(socket_buffer_size, do_not_use_gso, &s_ctx[nb_sockets])) == 0) {
                 if (current_port == 0) {
                     current_port = s_ctx[nb_sockets].port;
@@ -500,6 +554,74 @@ int picoquic_packet_loop_open_sockets(uint16_t local_port, int local_af, int soc
     return nb_sockets;
 }
 
+/* Submit a received buffer to the stack. If the network stack coalesced
+ * several datagrams in the buffer (URO on Windows, GRO on Linux), the
+ * segment size is not zero and the buffer is split in segments of that
+ * size, except possibly the last one. Each segment is submitted in
+ * place, without copy, unless the steering function of the loop
+ * parameters consumes it. The segments are passed to the stack as a
+ * batch, so that their decryption can be amortized.
+ */
+#define PICOQUIC_PACKET_LOOP_BATCH_MAX 64
+
+/* Add the segments of a coalesced buffer to a pending batch of datagrams,
+ * which is passed to the stack when full. The caller submits the
+ * remaining datagrams once all its buffers have been added.
+ */
+static int picoquic_packet_loop_add_coalesced(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+    picoquic_incoming_datagram_t* datagrams, size_t* nb_datagrams,
+    uint8_t* bytes, size_t length, size_t segment_size,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to,
+    unsigned char received_ecn, picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    int ret = 0;
+    size_t recv_bytes = 0;
+
+    while (recv_bytes < length && ret == 0) {
+        size_t recv_length = length - recv_bytes;
+
+        if (segment_size > 0 && recv_length > segment_size) {
+            recv_length = segment_size;
+        }
+        if (param->steer_fn == NULL ||
+            param->steer_fn(param->steer_ctx, bytes + recv_bytes, recv_length,
+                addr_from, addr_to, if_index_to, received_ecn) == 0) {
+            picoquic_incoming_datagram_t* datagram = &datagrams[(*nb_datagrams)++];
+
+            datagram->bytes = bytes + recv_bytes;
+            datagram->length = recv_length;
+            datagram->addr_from = addr_from;
+            datagram->addr_to = addr_to;
+            datagram->if_index_to = if_index_to;
+            datagram->received_ecn = received_ecn;
+            if (*nb_datagrams >= PICOQUIC_PACKET_LOOP_BATCH_MAX) {
+                ret = picoquic_incoming_packet_batch(quic, datagrams, *nb_datagrams, last_cnx, current_time);
+                *nb_datagrams = 0;
+            }
+        }
+        recv_bytes += recv_length;
+    }
+
+    return ret;
+}
+
+int picoquic_packet_loop_submit_coalesced(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+    uint8_t* bytes, size_t length, size_t segment_size,
+    struct sockaddr* addr_from, struct sockaddr* addr_to, int if_index_to,
+    unsigned char received_ecn, picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    picoquic_incoming_datagram_t datagrams[PICOQUIC_PACKET_LOOP_BATCH_MAX];
+    size_t nb_datagrams = 0;
+    int ret = picoquic_packet_loop_add_coalesced(quic, param, datagrams, &nb_datagrams, bytes, length, segment_size,
+        addr_from, addr_to, if_index_to, received_ecn, last_cnx, current_time);
+
+    if (ret == 0 && nb_datagrams > 0) {
+        ret = picoquic_incoming_packet_batch(quic, datagrams, nb_datagrams, last_cnx, current_time);
+    }
+
+    return ret;
+}
+
 /*
 * Windows: use asynchronous receive. Asynchronous receive requires
 * declaring an overlap context and event per socket, as well as a
@@ -602,28 +724,24 @@ int picoquic_packet_loop_wait(picoquic_socket_ctx_t* s_ctx,
     return bytes_recv;
 }
 #else
-int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
+/* Wait until one of the sockets or the wake up pipe is readable, or until
+ * the timer expires. Returns a negative value if an error occured, 0 if
+ * the timer expired, or a positive value if something is ready. If the
+ * wake up pipe was full, it is emptied and is_wake_up_event is set.
+ * Otherwise, socket_rank is set to the rank of the first readable socket.
+ */
+static int picoquic_packet_loop_wait_select(picoquic_socket_ctx_t* s_ctx,
     int nb_sockets,
-    struct sockaddr_storage* addr_from,
-    struct sockaddr_storage* addr_dest,
-    int* dest_if,
-    unsigned char * received_ecn,
-    uint8_t* buffer, int buffer_max,
     int64_t delta_t,
-    int * is_wake_up_event,
-    picoquic_network_thread_ctx_t * thread_ctx,
-    int * socket_rank)
+    int* is_wake_up_event,
+    picoquic_network_thread_ctx_t* thread_ctx,
+    int* socket_rank)
 {
     fd_set readfds;
     struct timeval tv;
     int ret_select = 0;
-    int bytes_recv = 0;
     int sockmax = 0;
 
-    if (received_ecn != NULL) {
-        *received_ecn = 0;
-    }
-
     FD_ZERO(&readfds);
 
     for (int i = 0; i < nb_sockets; i++) {
@@ -657,7 +775,6 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
     ret_select = select(sockmax + 1, &readfds, NULL, NULL, &tv);
 
     if (ret_select < 0) {
-        bytes_recv = -1;
         DBG_PRINTF("Error: select returns %d\n", ret_select);
     } else if (ret_select > 0) {
         /* Check if the 'wake up' pipe is full. If it is, read the data on it,
@@ -667,7 +784,7 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
             uint8_t eventbuf[8];
             int pipe_recv;
             if ((pipe_recv = read(thread_ctx->wake_up_pipe_fd[0], eventbuf, sizeof(eventbuf))) <= 0) {
-                bytes_recv = -1;
+                ret_select = -1;
                 DBG_PRINTF("Error: read pipe returns %d\n", (pipe_recv == 0)?EPIPE:errno);
             }
             else {
@@ -679,32 +796,460 @@ int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
             for (int i = 0; i < nb_sockets; i++) {
                 if (FD_ISSET(s_ctx[i].fd, &readfds)) {
                     *socket_rank = i;
-                    bytes_recv = picoquic_recvmsg(s_ctx[i].fd, addr_from,
-                        addr_dest, dest_if, received_ecn,
-                        buffer, buffer_max);
-
-                    if (bytes_recv <= 0) {
-                        DBG_PRINTF("Could not receive packet on UDP socket[%d]= %d!\n",
-                            i, (int)s_ctx[i].fd);
-                        break;
-                    }
-                    else {
-                        /* Document incoming port */
-                        if (addr_dest->ss_family == AF_INET6) {
-                            ((struct sockaddr_in6*)addr_dest)->sin6_port = s_ctx[i].n_port;
-                        }
-                        else if (addr_dest->ss_family == AF_INET) {
-                            ((struct sockaddr_in*)addr_dest)->sin_port = s_ctx[i].n_port;
-                        }
-                        break;
-                    }
+                    break;
                 }
             }
         }
     }
 
+    return ret_select;
+}
+
+#ifdef PICOQUIC_USE_EPOLL
+/* Epoll based wait.
+ * The sockets and the wake up pipe are registered once in the epoll set,
+ * when the loop starts, instead of rebuilding an fd_set at each iteration.
+ * The event data is the socket rank, or PICOQUIC_EPOLL_WAKE_UP_RANK for
+ * the wake up pipe. Timeouts are expressed in microseconds. If epoll_pwait2
+ * is available, the timeout is passed directly in a timespec. Otherwise,
+ * or if the kernel does not support it, a timerfd registered in the set
+ * is armed before each wait.
+ */
+#define PICOQUIC_EPOLL_WAKE_UP_RANK 0x10000
+#define PICOQUIC_EPOLL_TIMER_RANK 0x10001
+
+static void picoquic_packet_loop_close_epoll(picoquic_network_thread_ctx_t* thread_ctx)
+{
+    if (thread_ctx->epoll_defined) {
+        if (thread_ctx->timer_fd >= 0) {
+            (void)close(thread_ctx->timer_fd);
+            thread_ctx->timer_fd = -1;
+        }
+        (void)close(thread_ctx->epoll_fd);
+        thread_ctx->epoll_fd = -1;
+        thread_ctx->epoll_defined = 0;
+    }
+}
+
+static int picoquic_packet_loop_open_epoll_timer(picoquic_network_thread_ctx_t* thread_ctx)
+{
+    int ret = 0;
+    struct epoll_event ev = { 0 };
+
+    if ((thread_ctx->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        ret = errno;
+    }
+    else {
+        ev.events = EPOLLIN;
+        ev.data.u32 = PICOQUIC_EPOLL_TIMER_RANK;
+        if (epoll_ctl(thread_ctx->epoll_fd, EPOLL_CTL_ADD, thread_ctx->timer_fd, &ev) != 0) {
+            ret = errno;
+            (void)close(thread_ctx->timer_fd);
+            thread_ctx->timer_fd = -1;
+        }
+    }
+    return ret;
+}
+
+static int picoquic_packet_loop_open_epoll(picoquic_socket_ctx_t* s_ctx, int nb_sockets,
+    picoquic_network_thread_ctx_t* thread_ctx)
+{
+    int ret = 0;
+
+    thread_ctx->timer_fd = -1;
+    if ((thread_ctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        ret = errno;
+    }
+    else {
+        thread_ctx->epoll_defined = 1;
+        for (int i = 0; ret == 0 && i < nb_sockets; i++) {
+            struct epoll_event ev = { 0 };
+            ev.events = EPOLLIN;
+            ev.data.u32 = (uint32_t)i;
+            if (epoll_ctl(thread_ctx->epoll_fd, EPOLL_CTL_ADD, s_ctx[i].fd, &ev) != 0) {
+                ret = errno;
+            }
+        }
+        if (ret == 0 && thread_ctx->wake_up_defined) {
+            struct epoll_event ev = { 0 };
+            ev.events = EPOLLIN;
+            ev.data.u32 = PICOQUIC_EPOLL_WAKE_UP_RANK;
+            if (epoll_ctl(thread_ctx->epoll_fd, EPOLL_CTL_ADD, thread_ctx->wake_up_pipe_fd[0], &ev) != 0) {
+                ret = errno;
+            }
+        }
+#ifndef PICOQUIC_HAVE_EPOLL_PWAIT2
+        if (ret == 0) {
+            ret = picoquic_packet_loop_open_epoll_timer(thread_ctx);
+        }
+#endif
+        if (ret != 0) {
+            DBG_PRINTF("Cannot set up epoll, error %d", ret);
+            picoquic_packet_loop_close_epoll(thread_ctx);
+        }
+    }
+    return ret;
+}
+
+/* Stop polling the sockets of rank nb_sockets and above. */
+static void picoquic_packet_loop_epoll_remove_sockets(picoquic_socket_ctx_t* s_ctx, int nb_sockets,
+    int nb_sockets_max, picoquic_network_thread_ctx_t* thread_ctx)
+{
+    if (thread_ctx->epoll_defined) {
+        for (int i = nb_sockets; i < nb_sockets_max; i++) {
+            (void)epoll_ctl(thread_ctx->epoll_fd, EPOLL_CTL_DEL, s_ctx[i].fd, NULL);
+        }
+    }
+}
+
+static int picoquic_packet_loop_wait_epoll(picoquic_socket_ctx_t* s_ctx,
+    int nb_sockets,
+    int64_t delta_t,
+    int* is_wake_up_event,
+    picoquic_network_thread_ctx_t* thread_ctx,
+    int* socket_rank)
+{
+    struct epoll_event events[PICOQUIC_PACKET_LOOP_SOCKETS_MAX + 2];
+    struct timespec ts;
+    int nb_events = -1;
+    int is_waiting = 1;
+    int ret_wait = 0;
+
+    *is_wake_up_event = 0;
+    if (delta_t < 0) {
+        delta_t = 0;
+    }
+    else if (delta_t > 10000000) {
+        delta_t = 10000000;
+    }
+    ts.tv_sec = (time_t)(delta_t / 1000000);
+    ts.tv_nsec = (long)((delta_t % 1000000) * 1000);
+
+#ifdef PICOQUIC_HAVE_EPOLL_PWAIT2
+    if (thread_ctx->timer_fd < 0) {
+        nb_events = epoll_pwait2(thread_ctx->epoll_fd, events, PICOQUIC_PACKET_LOOP_SOCKETS_MAX + 2, &ts, NULL);
+        if (nb_events < 0 && errno == ENOSYS) {
+            /* Kernel older than 5.11. Use the timer instead, from now on. */
+            if (picoquic_packet_loop_open_epoll_timer(thread_ctx) != 0) {
+                DBG_PRINTF("%s", "Cannot create timerfd for epoll");
+                is_waiting = 0;
+            }
+        }
+        else {
+            is_waiting = 0;
+        }
+    }
+#endif
+    if (is_waiting) {
+        if (delta_t == 0) {
+            nb_events = epoll_wait(thread_ctx->epoll_fd, events, PICOQUIC_PACKET_LOOP_SOCKETS_MAX + 2, 0);
+        }
+        else {
+            /* Arming the timer also resets its expiration count, so there is
+             * no need to read the timerfd after it fires. */
+            struct itimerspec its = { 0 };
+            its.it_value = ts;
+            if (timerfd_settime(thread_ctx->timer_fd, 0, &its, NULL) != 0) {
+                DBG_PRINTF("timerfd_settime fails, errno: %d", errno);
+            }
+            else {
+                nb_events = epoll_wait(thread_ctx->epoll_fd, events, PICOQUIC_PACKET_LOOP_SOCKETS_MAX + 2, -1);
+            }
+        }
+    }
+
+    if (nb_events < 0) {
+        ret_wait = -1;
+        DBG_PRINTF("Error: epoll wait returns %d, errno %d\n", nb_events, errno);
+    }
+    else {
+        int first_rank = -1;
+
+        for (int i = 0; i < nb_events; i++) {
+            uint32_t rank = events[i].data.u32;
+
+            if (rank == PICOQUIC_EPOLL_WAKE_UP_RANK) {
+                *is_wake_up_event = 1;
+            }
+            else if (rank < (uint32_t)nb_sockets && (first_rank < 0 || (int)rank < first_rank)) {
+                first_rank = (int)rank;
+            }
+        }
+
+        if (*is_wake_up_event) {
+            /* As in the select version, the wake up event has priority. */
+            uint8_t eventbuf[8];
+            int pipe_recv;
+            if ((pipe_recv = read(thread_ctx->wake_up_pipe_fd[0], eventbuf, sizeof(eventbuf))) <= 0) {
+                ret_wait = -1;
+                *is_wake_up_event = 0;
+                DBG_PRINTF("Error: read pipe returns %d\n", (pipe_recv == 0) ? EPIPE : errno);
+            }
+            else {
+                ret_wait = 1;
+            }
+        }
+        else if (first_rank >= 0) {
+            *socket_rank = first_rank;
+            ret_wait = 1;
+        }
+    }
+
+    return ret_wait;
+}
+#endif
+
+static int picoquic_packet_loop_wait_readable(picoquic_socket_ctx_t* s_ctx,
+    int nb_sockets,
+    int64_t delta_t,
+    int* is_wake_up_event,
+    picoquic_network_thread_ctx_t* thread_ctx,
+    int* socket_rank)
+{
+#ifdef PICOQUIC_USE_EPOLL
+    if (thread_ctx->epoll_defined) {
+        return picoquic_packet_loop_wait_epoll(s_ctx, nb_sockets, delta_t,
+            is_wake_up_event, thread_ctx, socket_rank);
+    }
+#endif
+    return picoquic_packet_loop_wait_select(s_ctx, nb_sockets, delta_t,
+        is_wake_up_event, thread_ctx, socket_rank);
+}
+
+int picoquic_packet_loop_select(picoquic_socket_ctx_t* s_ctx,
+    int nb_sockets,
+    struct sockaddr_storage* addr_from,
+    struct sockaddr_storage* addr_dest,
+    int* dest_if,
+    unsigned char * received_ecn,
+    uint8_t* buffer, int buffer_max,
+    int64_t delta_t,
+    int * is_wake_up_event,
+    picoquic_network_thread_ctx_t * thread_ctx,
+    int * socket_rank)
+{
+    int ret_select = 0;
+    int bytes_recv = 0;
+
+    if (received_ecn != NULL) {
+        *received_ecn = 0;
+    }
+
+    *socket_rank = -1;
+    ret_select = picoquic_packet_loop_wait_readable(s_ctx, nb_sockets, delta_t,
+        is_wake_up_event, thread_ctx, socket_rank);
+
+    if (ret_select < 0) {
+        bytes_recv = -1;
+    }
+    else if (ret_select > 0 && !*is_wake_up_event && *socket_rank >= 0) {
+        int i = *socket_rank;
+        bytes_recv = picoquic_recvmsg_ex(s_ctx[i].fd, addr_from,
+            addr_dest, dest_if, received_ecn,
+            buffer, buffer_max, &s_ctx[i].udp_coalesced_size);
+
+        if (bytes_recv <= 0) {
+            DBG_PRINTF("Could not receive packet on UDP socket[%d]= %d!\n",
+                i, (int)s_ctx[i].fd);
+        }
+        else {
+            /* Document incoming port */
+            if (addr_dest->ss_family == AF_INET6) {
+                ((struct sockaddr_in6*)addr_dest)->sin6_port = s_ctx[i].n_port;
+            }
+            else if (addr_dest->ss_family == AF_INET) {
+                ((struct sockaddr_in*)addr_dest)->sin_port = s_ctx[i].n_port;
+            }
+        }
+    }
+
+    return bytes_recv;
+}
+
+#ifdef PICOQUIC_USE_RECVMMSG
+/* Batched receive, using recvmmsg.
+ * The batch holds a ring of receive buffers, each with its own message header,
+ * peer address and control buffer. A single call to recvmmsg fills as many
+ * slots as there are datagrams queued on the socket, up to the number of slots.
+ * The metadata of each datagram (addresses, ECN, interface index) is parsed
+ * when the datagram is submitted to the stack. The destination addresses
+ * are kept per slot, so that all the datagrams of the batch can be passed
+ * to the stack together.
+ */
+#define PICOQUIC_RECV_BATCH_CMSG_SIZE 256
+
+typedef struct st_picoquic_recv_batch_t {
+    int nb_slots;
+    int nb_received;
+    size_t buffer_size;
+    uint8_t* buffers;
+    char* cmsg_buffers;
+    struct mmsghdr* msgs;
+    struct iovec* iov;
+    struct sockaddr_storage* addr_from;
+    struct sockaddr_storage* addr_to;
+} picoquic_recv_batch_t;
+
+static void picoquic_recv_batch_delete(picoquic_recv_batch_t* batch)
+{
+    if (batch != NULL) {
+        if (batch->buffers != NULL) {
+            free(batch->buffers);
+        }
+        if (batch->cmsg_buffers != NULL) {
+            free(batch->cmsg_buffers);
+        }
+        if (batch->msgs != NULL) {
+            free(batch->msgs);
+        }
+        if (batch->iov != NULL) {
+            free(batch->iov);
+        }
+        if (batch->addr_from != NULL) {
+            free(batch->addr_from);
+        }
+        if (batch->addr_to != NULL) {
+            free(batch->addr_to);
+        }
+        free(batch);
+    }
+}
+
+static picoquic_recv_batch_t* picoquic_recv_batch_create(int nb_slots, size_t buffer_size)
+{
+    picoquic_recv_batch_t* batch = (picoquic_recv_batch_t*)malloc(sizeof(picoquic_recv_batch_t));
+
+    if (batch != NULL) {
+        memset(batch, 0, sizeof(picoquic_recv_batch_t));
+        if (nb_slots > PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX) {
+            nb_slots = PICOQUIC_PACKET_LOOP_RECV_BATCH_MAX;
+        }
+        batch->nb_slots = nb_slots;
+        batch->buffer_size = buffer_size;
+        batch->buffers = (uint8_t*)malloc(buffer_size * nb_slots);
+        batch->cmsg_buffers = (char*)malloc(PICOQUIC_RECV_BATCH_CMSG_SIZE * nb_slots);
+        batch->msgs = (struct mmsghdr*)malloc(sizeof(struct mmsghdr) * nb_slots);
+        batch->iov = (struct iovec*)malloc(sizeof(struct iovec) * nb_slots);
+        batch->addr_from = (struct sockaddr_storage*)malloc(sizeof(struct sockaddr_storage) * nb_slots);
+        batch->addr_to = (struct sockaddr_storage*)malloc(sizeof(struct sockaddr_storage) * nb_slots);
+        if (batch->buffers == NULL || batch->cmsg_buffers == NULL || batch->msgs == NULL ||
+            batch->iov == NULL || batch->addr_from == NULL || batch->addr_to == NULL) {
+            DBG_PRINTF("Cannot allocate receive batch of %d x %zu bytes", nb_slots, buffer_size);
+            picoquic_recv_batch_delete(batch);
+            batch = NULL;
+        }
+    }
+    return batch;
+}
+
+/* Receive up to nb_slots datagrams from the socket in a single call.
+ * Returns the total number of bytes received, or -1 in case of error.
+ */
+static int picoquic_recv_batch_receive(picoquic_recv_batch_t* batch, SOCKET_TYPE fd)
+{
+    int bytes_recv = 0;
+    int nb_msgs;
+
+    for (int i = 0; i < batch->nb_slots; i++) {
+        batch->iov[i].iov_base = batch->buffers + i * batch->buffer_size;
+        batch->iov[i].iov_len = batch->buffer_size;
+        memset(&batch->msgs[i], 0, sizeof(struct mmsghdr));
+        batch->msgs[i].msg_hdr.msg_name = &batch->addr_from[i];
+        batch->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_control = batch->cmsg_buffers + i * PICOQUIC_RECV_BATCH_CMSG_SIZE;
+        batch->msgs[i].msg_hdr.msg_controllen = PICOQUIC_RECV_BATCH_CMSG_SIZE;
+    }
+
+    nb_msgs = recvmmsg(fd, batch->msgs, (unsigned int)batch->nb_slots, MSG_DONTWAIT, NULL);
+
+    if (nb_msgs <= 0) {
+        batch->nb_received = 0;
+        bytes_recv = -1;
+    }
+    else {
+        batch->nb_received = nb_msgs;
+        for (int i = 0; i < nb_msgs; i++) {
+            bytes_recv += (int)batch->msgs[i].msg_len;
+        }
+    }
+
     return bytes_recv;
 }
+
+static int picoquic_packet_loop_select_batch(picoquic_socket_ctx_t* s_ctx,
+    int nb_sockets,
+    picoquic_recv_batch_t* batch,
+    int64_t delta_t,
+    int* is_wake_up_event,
+    picoquic_network_thread_ctx_t* thread_ctx,
+    int* socket_rank)
+{
+    int bytes_recv = 0;
+    int ret_select;
+
+    batch->nb_received = 0;
+    *socket_rank = -1;
+    ret_select = picoquic_packet_loop_wait_readable(s_ctx, nb_sockets, delta_t,
+        is_wake_up_event, thread_ctx, socket_rank);
+
+    if (ret_select < 0) {
+        bytes_recv = -1;
+    }
+    else if (ret_select > 0 && !*is_wake_up_event && *socket_rank >= 0) {
+        bytes_recv = picoquic_recv_batch_receive(batch, s_ctx[*socket_rank].fd);
+        if (bytes_recv <= 0) {
+            DBG_PRINTF("Could not receive batch on UDP socket[%d]= %d!\n",
+                *socket_rank, (int)s_ctx[*socket_rank].fd);
+        }
+    }
+
+    return bytes_recv;
+}
+
+/* Submit all the datagrams received in a batch to the stack, in arrival order.
+ * The datagrams of all the messages, including the GRO segments, are passed
+ * to the stack together, so that their decryption is amortized over the
+ * whole batch. */
+static int picoquic_packet_loop_submit_batch(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param, picoquic_recv_batch_t* batch,
+    picoquic_socket_ctx_t* s_ctx, picoquic_cnx_t** last_cnx, uint64_t current_time)
+{
+    int ret = 0;
+    picoquic_incoming_datagram_t datagrams[PICOQUIC_PACKET_LOOP_BATCH_MAX];
+    size_t nb_datagrams = 0;
+
+    for (int i = 0; ret == 0 && i < batch->nb_received; i++) {
+        struct sockaddr_storage* addr_to = &batch->addr_to[i];
+        int if_index_to = 0;
+        unsigned char received_ecn = 0;
+        size_t udp_coalesced_size = 0;
+
+        if (batch->msgs[i].msg_len == 0) {
+            continue;
+        }
+        addr_to->ss_family = AF_UNSPEC;
+        picoquic_socks_cmsg_parse(&batch->msgs[i].msg_hdr, addr_to, &if_index_to, &received_ecn, &udp_coalesced_size);
+        /* Document incoming port */
+        if (addr_to->ss_family == AF_INET6) {
+            ((struct sockaddr_in6*)addr_to)->sin6_port = s_ctx->n_port;
+        }
+        else if (addr_to->ss_family == AF_INET) {
+            ((struct sockaddr_in*)addr_to)->sin_port = s_ctx->n_port;
+        }
+        ret = picoquic_packet_loop_add_coalesced(quic, param, datagrams, &nb_datagrams, (uint8_t*)batch->iov[i].iov_base,
+            (size_t)batch->msgs[i].msg_len, udp_coalesced_size, (struct sockaddr*)&batch->addr_from[i],
+            (struct sockaddr*)addr_to, if_index_to, received_ecn,
+            last_cnx, current_time);
+    }
+
+    if (ret == 0 && nb_datagrams > 0) {
+        ret = picoquic_incoming_packet_batch(quic, datagrams, nb_datagrams, last_cnx, current_time);
+    }
+
+    return ret;
+}
+#endif
 #endif
 
 static int monitor_system_call_duration(packet_loop_system_call_duration_t* sc_duration, uint64_t current_time, uint64_t previous_time)
@@ -736,6 +1281,293 @@ static int monitor_system_call_duration(packet_loop_system_call_duration_t* sc_d
 }
 
 
+/* Check that a connection context is still present. When packets are sent
+ * in batches or asynchronously, the connection that prepared a packet may
+ * be deleted before the send completes, and errors should then not be
+ * reported to it. The deferred send remembers a key for the connection,
+ * the local CID of its default path, which stays in the CID table until
+ * the connection is deleted. Connections using zero length CIDs are
+ * found through the address table instead. The pointer is only compared,
+ * never dereferenced, until the lookup confirms that the connection exists.
+ */
+void picoquic_packet_loop_get_cnx_key(picoquic_cnx_t* cnx, picoquic_connection_id_t* cnx_key)
+{
+    memset(cnx_key, 0, sizeof(picoquic_connection_id_t));
+    if (cnx != NULL && cnx->path != NULL && cnx->path[0]->first_tuple != NULL &&
+        cnx->path[0]->first_tuple->p_local_cnxid != NULL) {
+        *cnx_key = cnx->path[0]->first_tuple->p_local_cnxid->cnx_id;
+    }
+}
+
+picoquic_cnx_t* picoquic_packet_loop_find_cnx(picoquic_quic_t* quic, picoquic_cnx_t* cnx,
+    picoquic_connection_id_t* cnx_key, struct sockaddr* peer_addr)
+{
+    picoquic_cnx_t* found = NULL;
+
+    if (cnx != NULL) {
+        if (cnx_key->id_len > 0) {
+            found = picoquic_cnx_by_id(quic, *cnx_key, NULL);
+        }
+        else {
+            found = picoquic_cnx_by_net(quic, peer_addr);
+        }
+        if (found != cnx) {
+            found = NULL;
+        }
+    }
+    return found;
+}
+
+/* Process a failure to send a packet or a train of packets. The error is logged.
+ * If the error implies that the destination is unreachable, the connection
+ * is notified. If the error is EIO, the system supports GSO but the specific
+ * interface driver does not, the main example being Mininet. In that case,
+ * the train is resent packet by packet, and GSO is disabled for the rest
+ * of the run by resetting *send_msg_ptr.
+ */
+void picoquic_packet_loop_send_error(picoquic_quic_t* quic, picoquic_cnx_t* cnx,
+    picoquic_connection_id_t* log_cid, SOCKET_TYPE send_socket,
+    struct sockaddr_storage* peer_addr, struct sockaddr_storage* local_addr, int if_index,
+    uint8_t* send_buffer, size_t send_length, size_t send_msg_size,
+    int sock_ret, int sock_err, size_t** send_msg_ptr, uint64_t current_time)
+{
+    if (cnx == NULL) {
+        picoquic_log_context_free_app_message(quic, log_cid, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
+            peer_addr->ss_family, local_addr->ss_family, if_index, sock_ret, sock_err);
+    }
+    else {
+        picoquic_log_app_message(cnx, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
+            peer_addr->ss_family, local_addr->ss_family, if_index, sock_ret, sock_err);
+
+        if (picoquic_socket_error_implies_unreachable(sock_err)) {
+            picoquic_notify_destination_unreachable(cnx, current_time,
+                (struct sockaddr*)peer_addr, (struct sockaddr*)local_addr, if_index,
+                sock_err);
+        }
+        else if (sock_err == EIO) {
+            size_t packet_index = 0;
+            size_t packet_size = send_msg_size;
+
+            if (packet_size == 0) {
+                packet_size = send_length;
+            }
+            while (packet_index < send_length) {
+                if (packet_index + packet_size > send_length) {
+                    packet_size = send_length - packet_index;
+                }
+                sock_ret = picoquic_sendmsg(send_socket,
+                    (struct sockaddr*)peer_addr, (struct sockaddr*)local_addr, if_index,
+                    (const char*)(send_buffer + packet_index), (int)packet_size, 0, &sock_err);
+                if (sock_ret > 0) {
+                    packet_index += packet_size;
+                }
+                else {
+                    picoquic_log_app_message(cnx, "Retry with packet size=%zu fails at index %zu, ret=%d, err=%d.",
+                        packet_size, packet_index, sock_ret, sock_err);
+                    break;
+                }
+            }
+            if (sock_ret > 0) {
+                picoquic_log_app_message(cnx, "Retry of %zu bytes by chunks of %zu bytes succeeds.",
+                    send_length, send_msg_size);
+            }
+            if (*send_msg_ptr != NULL) {
+                /* Make sure that we do not use GSO anymore in this run */
+                *send_msg_ptr = NULL;
+                picoquic_log_app_message(cnx, "%s", "UDP GSO was disabled");
+            }
+        }
+    }
+}
+
+#ifdef PICOQUIC_USE_SENDMMSG
+/* Batched send, using sendmmsg.
+ * On a server with many connections, successive calls to
+ * picoquic_prepare_next_packet_ex usually return packets for different
+ * peers, which cannot be coalesced with GSO. The send batch accumulates
+ * these packets or trains of packets, each with its own message header
+ * and control data (including UDP_SEGMENT if needed), and sends them
+ * with one call to sendmmsg per run of messages on the same socket.
+ */
+#define PICOQUIC_SEND_BATCH_CMSG_SIZE 256
+
+typedef struct st_picoquic_send_batch_entry_t {
+    SOCKET_TYPE fd;
+    size_t send_length;
+    size_t send_msg_size;
+    int if_index;
+    picoquic_cnx_t* cnx;
+    picoquic_connection_id_t cnx_key;
+    picoquic_connection_id_t log_cid;
+    struct sockaddr_storage peer_addr;
+    struct sockaddr_storage local_addr;
+} picoquic_send_batch_entry_t;
+
+typedef struct st_picoquic_send_batch_t {
+    int nb_slots;
+    int nb_queued;
+    size_t buffer_size;
+    uint8_t* buffers;
+    char* cmsg_buffers;
+    struct mmsghdr* msgs;
+    struct iovec* iov;
+    picoquic_send_batch_entry_t* entries;
+} picoquic_send_batch_t;
+
+static void picoquic_send_batch_delete(picoquic_send_batch_t* batch)
+{
+    if (batch != NULL) {
+        if (batch->buffers != NULL) {
+            free(batch->buffers);
+        }
+        if (batch->cmsg_buffers != NULL) {
+            free(batch->cmsg_buffers);
+        }
+        if (batch->msgs != NULL) {
+            free(batch->msgs);
+        }
+        if (batch->iov != NULL) {
+            free(batch->iov);
+        }
+        if (batch->entries != NULL) {
+            free(batch->entries);
+        }
+        free(batch);
+    }
+}
+
+static picoquic_send_batch_t* picoquic_send_batch_create(int nb_slots, size_t buffer_size)
+{
+    picoquic_send_batch_t* batch = (picoquic_send_batch_t*)malloc(sizeof(picoquic_send_batch_t));
+
+    if (batch != NULL) {
+        memset(batch, 0, sizeof(picoquic_send_batch_t));
+        if (nb_slots > PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX) {
+            nb_slots = PICOQUIC_PACKET_LOOP_SEND_BATCH_MAX;
+        }
+        batch->nb_slots = nb_slots;
+        batch->buffer_size = buffer_size;
+        batch->buffers = (uint8_t*)malloc(buffer_size * nb_slots);
+        batch->cmsg_buffers = (char*)malloc(PICOQUIC_SEND_BATCH_CMSG_SIZE * nb_slots);
+        batch->msgs = (struct mmsghdr*)malloc(sizeof(struct mmsghdr) * nb_slots);
+        batch->iov = (struct iovec*)malloc(sizeof(struct iovec) * nb_slots);
+        batch->entries = (picoquic_send_batch_entry_t*)malloc(sizeof(picoquic_send_batch_entry_t) * nb_slots);
+        if (batch->buffers == NULL || batch->cmsg_buffers == NULL || batch->msgs == NULL ||
+            batch->iov == NULL || batch->entries == NULL) {
+            picoquic_send_batch_delete(batch);
+            batch = NULL;
+        }
+    }
+    return batch;
+}
+
+/* The packets are prepared directly in the next free slot of the batch */
+static uint8_t* picoquic_send_batch_next_buffer(picoquic_send_batch_t* batch)
+{
+    return batch->buffers + batch->nb_queued * batch->buffer_size;
+}
+
+static void picoquic_send_batch_queue(picoquic_send_batch_t* batch, SOCKET_TYPE fd,
+    size_t send_length, size_t send_msg_size,
+    struct sockaddr_storage* peer_addr, struct sockaddr_storage* local_addr, int if_index,
+    picoquic_cnx_t* cnx, picoquic_connection_id_t* log_cid)
+{
+    int i = batch->nb_queued;
+    picoquic_send_batch_entry_t* entry = &batch->entries[i];
+    struct msghdr* msg = &batch->msgs[i].msg_hdr;
+
+    entry->fd = fd;
+    entry->send_length = send_length;
+    entry->send_msg_size = send_msg_size;
+    entry->if_index = if_index;
+    entry->cnx = cnx;
+    picoquic_packet_loop_get_cnx_key(cnx, &entry->cnx_key);
+    entry->log_cid = *log_cid;
+    picoquic_store_addr(&entry->peer_addr, (struct sockaddr*)peer_addr);
+    memcpy(&entry->local_addr, local_addr, sizeof(struct sockaddr_storage));
+
+    batch->iov[i].iov_base = picoquic_send_batch_next_buffer(batch);
+    batch->iov[i].iov_len = send_length;
+    memset(&batch->msgs[i], 0, sizeof(struct mmsghdr));
+    msg->msg_name = &entry->peer_addr;
+    msg->msg_namelen = picoquic_addr_length((struct sockaddr*)&entry->peer_addr);
+    msg->msg_iov = &batch->iov[i];
+    msg->msg_iovlen = 1;
+    msg->msg_control = batch->cmsg_buffers + i * PICOQUIC_SEND_BATCH_CMSG_SIZE;
+    msg->msg_controllen = PICOQUIC_SEND_BATCH_CMSG_SIZE;
+    picoquic_socks_cmsg_format(msg, send_length, send_msg_size, (struct sockaddr*)&entry->local_addr, if_index);
+
+    batch->nb_queued++;
+}
+
+/* Send all the queued messages. If sendmmsg sends fewer messages than
+ * requested, the next call starts with the first message not sent, and
+ * will fail with the corresponding error. Messages that fail are processed
+ * as in the single send case, and the batch continues with the next one.
+ */
+static void picoquic_send_batch_flush(picoquic_quic_t* quic, picoquic_packet_loop_param_t* param,
+    picoquic_send_batch_t* batch, size_t** send_msg_ptr, uint64_t current_time)
+{
+    int first = 0;
+
+    while (first < batch->nb_queued) {
+        SOCKET_TYPE fd = batch->entries[first].fd;
+        int nb_msg = 1;
+        int nb_sent;
+        int sock_err = 0;
+
+        while (first + nb_msg < batch->nb_queued && batch->entries[first + nb_msg].fd == fd) {
+            nb_msg++;
+        }
+        if (param->simulate_partial_send > 0 && nb_msg > 1) {
+            /* Test hook, simulating a socket that accepts part of the messages */
+            nb_msg /= 2;
+            param->simulate_partial_send--;
+        }
+        if (param->simulate_eio) {
+            /* Test hook, simulating a driver that does not support GSO. The
+             * messages before the first train are sent, and the train fails. */
+            for (int i = 0; i < nb_msg; i++) {
+                if (batch->entries[first + i].send_length > PICOQUIC_MAX_PACKET_SIZE) {
+                    nb_msg = i;
+                    break;
+                }
+            }
+        }
+        if (nb_msg == 0) {
+            nb_sent = -1;
+            sock_err = EIO;
+            param->simulate_eio = 0;
+        }
+        else {
+            nb_sent = sendmmsg(fd, &batch->msgs[first], nb_msg, 0);
+            if (nb_sent <= 0) {
+                sock_err = errno;
+            }
+        }
+        if (nb_sent > 0) {
+            first += nb_sent;
+        }
+        else {
+            if (sock_err != EINTR) {
+                picoquic_send_batch_entry_t* entry = &batch->entries[first];
+                picoquic_cnx_t* cnx = picoquic_packet_loop_find_cnx(quic, entry->cnx, &entry->cnx_key,
+                    (struct sockaddr*)&entry->peer_addr);
+
+                DBG_PRINTF("Could not send packet on UDP socket[AF=%d]= %d!\n",
+                    entry->peer_addr.ss_family, sock_err);
+                picoquic_packet_loop_send_error(quic, cnx,
+                    &entry->log_cid, fd, &entry->peer_addr, &entry->local_addr, entry->if_index,
+                    (uint8_t*)batch->iov[first].iov_base, entry->send_length, entry->send_msg_size,
+                    nb_sent, sock_err, send_msg_ptr, current_time);
+                first++;
+            }
+        }
+    }
+    batch->nb_queued = 0;
+}
+#endif
+
 #ifdef _WINDOWS
     DWORD WINAPI picoquic_packet_loop_v3(LPVOID v_ctx)
 #else
@@ -755,6 +1587,14 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     int if_index_to;
 #ifndef _WINDOWS
     uint8_t buffer[1536];
+    uint8_t* recv_buffer = buffer;
+    size_t recv_buffer_size = sizeof(buffer);
+#endif
+#ifdef PICOQUIC_USE_RECVMMSG
+    picoquic_recv_batch_t* recv_batch = NULL;
+#endif
+#ifdef PICOQUIC_USE_SENDMMSG
+    picoquic_send_batch_t* send_batch = NULL;
 #endif
     uint8_t* send_buffer = NULL;
     size_t send_length = 0;
@@ -777,6 +1617,14 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     WSADATA wsaData = { 0 };
     (void)WSA_START(MAKEWORD(2, 2), &wsaData);
 #endif
+#ifdef PICOQUIC_HAVE_IO_URING
+    if (param->use_io_uring) {
+        if (picoquic_packet_loop_uring_supported()) {
+            return picoquic_packet_loop_uring(v_ctx);
+        }
+        DBG_PRINTF("%s", "Cannot use io_uring, using the socket loop instead.");
+    }
+#endif
 
     if (thread_ctx->thread_name != NULL) {
         thread_ctx->thread_setname_fn(thread_ctx->thread_name);
@@ -787,9 +1635,9 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     }
 
     memset(s_ctx, 0, sizeof(s_ctx));
-    if ((nb_sockets = picoquic_packet_loop_open_sockets(param->local_port,
+    if ((nb_sockets = picoquic_packet_loop_open_sockets_ex(param->local_port,
         param->local_af, param->socket_buffer_size,
-        param->extra_socket_required, param->do_not_use_gso, s_ctx)) <= 0) {
+        param->extra_socket_required, param->do_not_use_gso, param->reuse_port, s_ctx)) <= 0) {
         ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
         DBG_PRINTF("%s", "Thread cannot run:picoquic_packet_loop_open_sockets error ");
     }
@@ -825,6 +1673,48 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             DBG_PRINTF("%s", "Thread cannot run:. malloc error");
             ret = -1;
         }
+#ifndef _WINDOWS
+        else {
+            /* If the sockets support receive coalescing, the receive buffer
+             * must be large enough to hold the coalesced datagrams. */
+            for (int i = 0; i < nb_sockets; i++) {
+                if (s_ctx[i].supports_udp_recv_coalesced) {
+                    recv_buffer_size = PICOQUIC_PACKET_LOOP_RECV_COALESCED_MAX;
+                    break;
+                }
+            }
+            if (recv_buffer_size > sizeof(buffer) &&
+                (recv_buffer = (uint8_t*)malloc(recv_buffer_size)) == NULL) {
+                DBG_PRINTF("%s", "Thread cannot run:. cannot allocate receive buffer");
+                ret = -1;
+            }
+        }
+#endif
+#ifdef PICOQUIC_USE_EPOLL
+        if (ret == 0 && param->use_epoll &&
+            picoquic_packet_loop_open_epoll(s_ctx, nb_sockets, thread_ctx) != 0) {
+            /* Not fatal, fall back to select */
+            DBG_PRINTF("%s", "Cannot use epoll, using select instead.");
+        }
+#endif
+#ifdef PICOQUIC_USE_RECVMMSG
+        if (ret == 0 && param->recv_batch_size > 1) {
+            recv_batch = picoquic_recv_batch_create(param->recv_batch_size, recv_buffer_size);
+            if (recv_batch == NULL) {
+                DBG_PRINTF("%s", "Thread cannot run:. cannot allocate receive batch");
+                ret = -1;
+            }
+        }
+#endif
+#ifdef PICOQUIC_USE_SENDMMSG
+        if (ret == 0 && param->send_batch_size > 1) {
+            send_batch = picoquic_send_batch_create(param->send_batch_size, send_buffer_size);
+            if (send_batch == NULL) {
+                DBG_PRINTF("%s", "Thread cannot run:. cannot allocate send batch");
+                ret = -1;
+            }
+        }
+#endif
     }
 
     if (ret == 0) {
@@ -885,12 +1775,19 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             &addr_from, &addr_to, &if_index_to, &received_ecn, &received_buffer,
             delta_t, &is_wake_up_event, thread_ctx, &socket_rank);
 #else
+#ifdef PICOQUIC_USE_RECVMMSG
+        if (recv_batch != NULL) {
+            bytes_recv = picoquic_packet_loop_select_batch(s_ctx, nb_sockets_available,
+                recv_batch, delta_t, &is_wake_up_event, thread_ctx, &socket_rank);
+        }
+        else
+#endif
         bytes_recv = picoquic_packet_loop_select(s_ctx, nb_sockets_available,
             &addr_from,
             &addr_to, &if_index_to, &received_ecn,
-            buffer, sizeof(buffer),
+            recv_buffer, (int)recv_buffer_size,
             delta_t, &is_wake_up_event, thread_ctx, &socket_rank);
-        received_buffer = buffer;
+        received_buffer = recv_buffer;
 #endif
         current_time = picoquic_current_time();
         if (options.do_system_call_duration && delta_t == 0 &&
@@ -910,39 +1807,54 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             uint64_t loop_time = current_time;
             size_t bytes_sent = 0;
             size_t nb_packets_sent = 0;
+            size_t nb_packets_max = PICOQUIC_PACKET_LOOP_SEND_MAX;
+            int count_messages = 0;
+
+#ifdef PICOQUIC_USE_SENDMMSG
+            if (send_batch != NULL) {
+                /* With batched sends, the loop counts messages instead of packets,
+                 * and fills at most one batch, which is flushed when full or
+                 * at the end of the loop. */
+                nb_packets_max = (size_t)send_batch->nb_slots;
+                count_messages = 1;
+            }
+#endif
 
             if (bytes_recv > 0) {
 #ifdef _WINDOWS
-                size_t recv_bytes = 0;
-                while (recv_bytes < (size_t)bytes_recv && ret == 0) {
-                    size_t recv_length = (size_t)(bytes_recv - recv_bytes);
-
-                    if (s_ctx[socket_rank].udp_coalesced_size > 0 &&
-                        recv_length > s_ctx[socket_rank].udp_coalesced_size) {
-                        recv_length = s_ctx[socket_rank].udp_coalesced_size;
-                    }
-                    /* Submit the packet to the client */
-                    ret = picoquic_incoming_packet_ex(quic, s_ctx[socket_rank].recv_buffer + recv_bytes,
-                        recv_length, (struct sockaddr*)&addr_from,
-                        (struct sockaddr*)&addr_to,
-                        s_ctx[socket_rank].dest_if,
-                        s_ctx[socket_rank].received_ecn, &last_cnx, current_time);
-                    recv_bytes += recv_length;
-                }
+                /* Submit the packet to the client */
+                ret = picoquic_packet_loop_submit_coalesced(quic, param, s_ctx[socket_rank].recv_buffer,
+                    (size_t)bytes_recv, s_ctx[socket_rank].udp_coalesced_size,
+                    (struct sockaddr*)&addr_from, (struct sockaddr*)&addr_to,
+                    s_ctx[socket_rank].dest_if, s_ctx[socket_rank].received_ecn,
+                    &last_cnx, current_time);
                 if (ret == 0) {
                     ret = picoquic_win_recvmsg_async_start(&s_ctx[socket_rank]);
                 }
 #else
+#ifdef PICOQUIC_USE_RECVMMSG
+                if (recv_batch != NULL) {
+                    /* Submit all the packets in the batch */
+                    ret = picoquic_packet_loop_submit_batch(quic, param, recv_batch, &s_ctx[socket_rank],
+                        &last_cnx, current_time);
+                }
+                else
+#endif
                 /* Submit the packet to the server */
-                ret = picoquic_incoming_packet_ex(quic, received_buffer,
-                    (size_t)bytes_recv, (struct sockaddr*)&addr_from,
-                    (struct sockaddr*)&addr_to, if_index_to, received_ecn,
-                    &last_cnx, current_time);
+                ret = picoquic_packet_loop_submit_coalesced(quic, param, received_buffer,
+                    (size_t)bytes_recv, s_ctx[socket_rank].udp_coalesced_size,
+                    (struct sockaddr*)&addr_from, (struct sockaddr*)&addr_to,
+                    if_index_to, received_ecn, &last_cnx, current_time);
 #endif
 
 
                 if (loop_callback != NULL) {
                     size_t b_recvd = (size_t)bytes_recv;
+#ifdef PICOQUIC_USE_RECVMMSG
+                    if (recv_batch != NULL) {
+                        b_recvd = (size_t)recv_batch->nb_received;
+                    }
+#endif
                     ret = loop_callback(quic, picoquic_packet_loop_after_receive, loop_callback_ctx, &b_recvd);
                 }
 
@@ -969,6 +1881,9 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                      * memorized for that path.
                      */
                     nb_sockets_available = nb_sockets / 2;
+#ifdef PICOQUIC_USE_EPOLL
+                    picoquic_packet_loop_epoll_remove_sockets(s_ctx, nb_sockets_available, nb_sockets, thread_ctx);
+#endif
                 }
                 ret = 0;
             }
@@ -977,15 +1892,21 @@ void* picoquic_packet_loop_v3(void* v_ctx)
             * packets may be adding in the receive queue.
              */
 
-            while (ret == 0 && nb_packets_sent < PICOQUIC_PACKET_LOOP_SEND_MAX) {
+            while (ret == 0 && nb_packets_sent < nb_packets_max) {
                 struct sockaddr_storage peer_addr;
                 struct sockaddr_storage local_addr = { 0 };
                 int if_index = param->dest_if;
                 int sock_ret = 0;
                 int sock_err = 0;
+                uint8_t* next_buffer = send_buffer;
 
+#ifdef PICOQUIC_USE_SENDMMSG
+                if (send_batch != NULL) {
+                    next_buffer = picoquic_send_batch_next_buffer(send_batch);
+                }
+#endif
                 ret = picoquic_prepare_next_packet_ex(quic, loop_time,
-                    send_buffer, send_buffer_size, &send_length,
+                    next_buffer, send_buffer_size, &send_length,
                     &peer_addr, &local_addr, &if_index, &log_cid, &last_cnx,
                     send_msg_ptr);
 
@@ -993,7 +1914,7 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                     /* If send_msg_size is defined, sendmsg may send more than one packet.
                      * We compute that to update the number of packets sent in the loop.
                      */
-                    nb_packets_sent += (send_msg_size == 0) ? 1 :
+                    nb_packets_sent += (send_msg_size == 0 || count_messages) ? 1 :
                         (send_length + send_msg_size - 1) / (send_msg_size);
                     if (send_length > param->send_length_max) {
                         param->send_length_max = send_length;
@@ -1030,7 +1951,17 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                     }
                     else
                     {
-
+#ifdef PICOQUIC_USE_SENDMMSG
+                        if (send_batch != NULL) {
+                            picoquic_send_batch_queue(send_batch, send_socket, send_length, send_msg_size,
+                                &peer_addr, &local_addr, if_index, last_cnx, &log_cid);
+                            if (send_batch->nb_queued >= send_batch->nb_slots) {
+                                picoquic_send_batch_flush(quic, param, send_batch, &send_msg_ptr, current_time);
+                            }
+                            sock_ret = (int)send_length;
+                        }
+                        else
+#endif
                         if (param->simulate_eio && send_length > PICOQUIC_MAX_PACKET_SIZE) {
                             /* Test hook, simulating a driver that does not support GSO */
                             sock_ret = -1;
@@ -1044,62 +1975,20 @@ void* picoquic_packet_loop_v3(void* v_ctx)
                         }
                     }
                     if (sock_ret <= 0) {
-                        /* TODO: add a test in which the socket fails. */
-                        if (last_cnx == NULL) {
-                            picoquic_log_context_free_app_message(quic, &log_cid, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
-                                peer_addr.ss_family, local_addr.ss_family, if_index, sock_ret, sock_err);
-                        }
-                        else {
-                            picoquic_log_app_message(last_cnx, "Could not send message to AF_to=%d, AF_from=%d, if=%d, ret=%d, err=%d",
-                                peer_addr.ss_family, local_addr.ss_family, if_index, sock_ret, sock_err);
-
-                            if (picoquic_socket_error_implies_unreachable(sock_err)) {
-                                picoquic_notify_destination_unreachable(last_cnx, current_time,
-                                    (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                    sock_err);
-                            }
-                            else if (sock_err == EIO) {
-                                /* TODO: this is an error encountered if the system supports GSO, but
-                                 * the specific interface driver does not. Main example is Mininet.
-                                 * Not sure that we can treat that correctly. Try to minimize the
-                                 * amount of untested code? Rely on config flag? Rely on error
-                                 * recovery? */
-                                size_t packet_index = 0;
-                                size_t packet_size = send_msg_size;
-
-                                while (packet_index < send_length) {
-                                    if (packet_index + packet_size > send_length) {
-                                        packet_size = send_length - packet_index;
-                                    }
-                                    sock_ret = picoquic_sendmsg(send_socket,
-                                        (struct sockaddr*)&peer_addr, (struct sockaddr*)&local_addr, if_index,
-                                        (const char*)(send_buffer + packet_index), (int)packet_size, 0, &sock_err);
-                                    if (sock_ret > 0) {
-                                        packet_index += packet_size;
-                                    }
-                                    else {
-                                        picoquic_log_app_message(last_cnx, "Retry with packet size=%zu fails at index %zu, ret=%d, err=%d.",
-                                            packet_size, packet_index, sock_ret, sock_err);
-                                        break;
-                                    }
-                                }
-                                if (sock_ret > 0) {
-                                    picoquic_log_app_message(last_cnx, "Retry of %zu bytes by chunks of %zu bytes succeeds.",
-                                        send_length, send_msg_size);
-                                }
-                                if (send_msg_ptr != NULL) {
-                                    /* Make sure that we do not use GSO anymore in this run */
-                                    send_msg_ptr = NULL;
-                                    picoquic_log_app_message(last_cnx, "%s", "UDP GSO was disabled");
-                                }
-                            }
-                        }
+                        picoquic_packet_loop_send_error(quic, last_cnx, &log_cid, send_socket,
+                            &peer_addr, &local_addr, if_index, next_buffer, send_length, send_msg_size,
+                            sock_ret, sock_err, &send_msg_ptr, current_time);
                     }
                 }
                 else {
                     break;
                 }
             }
+#ifdef PICOQUIC_USE_SENDMMSG
+            if (send_batch != NULL && send_batch->nb_queued > 0) {
+                picoquic_send_batch_flush(quic, param, send_batch, &send_msg_ptr, current_time);
+            }
+#endif
 
             if (ret == 0 && loop_callback != NULL) {
                 ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
@@ -1114,6 +2003,9 @@ void* picoquic_packet_loop_v3(void* v_ctx)
         ret = 0;
     }
 
+#ifdef PICOQUIC_USE_EPOLL
+    picoquic_packet_loop_close_epoll(thread_ctx);
+#endif
     /* Close the sockets */
     for (int i = 0; i < nb_sockets; i++) {
         picoquic_packet_loop_close_socket(&s_ctx[i]);
@@ -1122,6 +2014,17 @@ void* picoquic_packet_loop_v3(void* v_ctx)
     if (send_buffer != NULL) {
         free(send_buffer);
     }
+#ifndef _WINDOWS
+    if (recv_buffer != buffer) {
+        free(recv_buffer);
+    }
+#endif
+#ifdef PICOQUIC_USE_RECVMMSG
+    picoquic_recv_batch_delete(recv_batch);
+#endif
+#ifdef PICOQUIC_USE_SENDMMSG
+    picoquic_send_batch_delete(send_batch);
+#endif
     thread_ctx->return_code = ret;
 #ifdef _WINDOWS
     return (DWORD)ret;
@@ -1231,7 +2134,9 @@ static void picoquic_close_network_wake_up(picoquic_network_thread_ctx_t* thread
         CloseHandle(thread_ctx->wake_up_event);
 #else
         for (int i = 0; i < 2; i++) {
-            (void)close(thread_ctx->wake_up_pipe_fd[i]);
+            if (thread_ctx->wake_up_pipe_fd[i] >= 0) {
+                (void)close(thread_ctx->wake_up_pipe_fd[i]);
+            }
         }
 #endif
         thread_ctx->wake_up_defined = 0;
@@ -1384,6 +2289,20 @@ void picoquic_delete_network_thread(picoquic_network_thread_ctx_t* thread_ctx)
 {
     /* set the should_close flag, so the thread knows the loop should stop */
     thread_ctx->thread_should_close = 1;
+#ifdef PICOQUIC_USE_EPOLL
+    /* Closing a descriptor silently removes it from an epoll set, so
+     * closing the read end of the wake up pipe would not wake up a thread
+     * waiting in epoll. Close the write end instead: the read end then
+     * signals end of file, which wakes up both the select and the epoll
+     * versions of the wait. The read end is closed after the thread exits.
+     */
+    if (thread_ctx->wake_up_defined && thread_ctx->is_threaded) {
+        (void)close(thread_ctx->wake_up_pipe_fd[1]);
+        thread_ctx->wake_up_pipe_fd[1] = -1;
+        thread_ctx->thread_delete_fn((void**)&thread_ctx->pthread);
+        thread_ctx->is_threaded = 0;
+    }
+#endif
     /* Delete the wake up event. This ought to create a fault
      * in the wait for event call, causing the thread to wake up,
      * notice the flag, and exit.
@@ -97,6 +97,7 @@ ptls_key_exchange_algorithm_t* picoquic_key_exchanges[PICOQUIC_KEY_EXCHANGES_NB_
 ptls_key_exchange_algorithm_t* picoquic_key_exchange_secp256r1[2] = { 0 };
 ptls_hpke_cipher_suite_t* picoquic_hpke_cipher_suites[PICOQUIC_HPKE_CIPHER_SUITE_NB_MAX + 1] = { 0 };
 ptls_hpke_kem_t* picoquic_hpke_kems[PICOQUIC_HPKE_KEM_NB_MAX + 1] = { 0 };
+struct st_picoquic_aead_batch_fn_t picoquic_aead_batch_fns[PICOQUIC_AEAD_BATCH_FN_NB_MAX + 1] = { 0 };
 picoquic_set_private_key_from_file_t picoquic_set_private_key_from_file_fn = NULL;
 picoquic_dispose_sign_certificate_t picoquic_dispose_sign_certificate_fn = NULL;
 picoquic_get_certs_from_file_t picoquic_get_certs_from_file_fn = NULL;
@@ -182,6 +183,7 @@ static void picoquic_tls_api_zero()
     memset(picoquic_cipher_suites, 0, sizeof(picoquic_cipher_suites));
     memset((void*)picoquic_key_exchanges, 0, sizeof(picoquic_key_exchanges));
     memset((void*)picoquic_key_exchange_secp256r1, 0, sizeof(picoquic_key_exchange_secp256r1));
+    memset(picoquic_aead_batch_fns, 0, sizeof(picoquic_aead_batch_fns));
 
     picoquic_set_private_key_from_file_fn = NULL;
     picoquic_dispose_sign_certificate_fn = NULL;
@@ -245,6 +247,45 @@ void picoquic_register_ciphersuite(ptls_cipher_suite_t* suite, int is_low_memory
     }
 }
 
+/* Registration of batched encryption functions.
+ * This API is called by crypto providers that can encrypt a train of packets
+ * faster than a sequence of individual calls.
+ */
+static struct st_picoquic_aead_batch_fn_t* picoquic_find_aead_batch_fn(const ptls_aead_algorithm_t* aead, int create)
+{
+    for (int i = 0; i < PICOQUIC_AEAD_BATCH_FN_NB_MAX; i++) {
+        if (picoquic_aead_batch_fns[i].aead == aead) {
+            return &picoquic_aead_batch_fns[i];
+        }
+        if (picoquic_aead_batch_fns[i].aead == NULL) {
+            if (create) {
+                picoquic_aead_batch_fns[i].aead = (ptls_aead_algorithm_t*)aead;
+                return &picoquic_aead_batch_fns[i];
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+void picoquic_register_aead_encrypt_batch_fn(ptls_aead_algorithm_t* aead, picoquic_aead_encrypt_batch_t encrypt_batch_fn)
+{
+    struct st_picoquic_aead_batch_fn_t* batch_fn = picoquic_find_aead_batch_fn(aead, 1);
+
+    if (batch_fn != NULL) {
+        batch_fn->encrypt_batch_fn = encrypt_batch_fn;
+    }
+}
+
+void picoquic_register_aead_decrypt_batch_fn(ptls_aead_algorithm_t* aead, picoquic_aead_decrypt_batch_t decrypt_batch_fn)
+{
+    struct st_picoquic_aead_batch_fn_t* batch_fn = picoquic_find_aead_batch_fn(aead, 1);
+
+    if (batch_fn != NULL) {
+        batch_fn->decrypt_batch_fn = decrypt_batch_fn;
+    }
+}
+
 /* Registration of key exchange algorithms */
 void picoquic_register_key_exchange_algorithm(ptls_key_exchange_algorithm_t* key_exchange)
 {
@@ -2110,6 +2151,7 @@ static int picoquic_add_to_tls_stream(picoquic_cnx_t* cnx, const uint8_t* data,
             ret = -1;
         }
         else {
+            memset(stream_data, 0, sizeof(picoquic_stream_queue_node_t));
             stream_data->bytes = (uint8_t*)malloc(length);
 
             if (stream_data->bytes == NULL) {
@@ -2441,6 +2483,105 @@ size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t in
     return encrypted;
 }
 
+/* Batched encryption of a train of packets.
+ * The generic version first encrypts all the payloads, then computes all the
+ * header protection masks, so that each key schedule is used for a complete
+ * pass over the train instead of alternating between AEAD and PN contexts.
+ */
+void picoquic_aead_encrypt_batch_generic(picoquic_aead_batch_entry_t* entries, size_t nb_entries)
+{
+    for (size_t i = 0; i < nb_entries; i++) {
+        picoquic_aead_batch_entry_t* entry = &entries[i];
+        uint8_t* payload = entry->packet + entry->header_length;
+
+        if (entry->is_multipath) {
+            (void)picoquic_aead_encrypt_mp(payload, payload, entry->payload_length, entry->path_id,
+                entry->sequence_number, entry->packet, entry->header_length, entry->aead_ctx);
+        }
+        else {
+            (void)picoquic_aead_encrypt_generic(payload, payload, entry->payload_length,
+                entry->sequence_number, entry->packet, entry->header_length, entry->aead_ctx);
+        }
+    }
+
+    for (size_t i = 0; i < nb_entries; i++) {
+        picoquic_aead_batch_entry_t* entry = &entries[i];
+
+        memset(entry->hp_mask, 0, sizeof(entry->hp_mask));
+        picoquic_pn_encrypt(entry->pn_enc, entry->packet + entry->pn_offset + 4, entry->hp_mask, entry->hp_mask, 5);
+    }
+}
+
+/* Encrypt the train with the batch function registered for the
+ * AEAD algorithm, if any, or with the generic version. Consecutive
+ * entries that use the same AEAD context are passed in a single call.
+ * The same logic applies to decryption.
+ */
+void picoquic_aead_encrypt_batch(picoquic_aead_batch_entry_t* entries, size_t nb_entries)
+{
+    size_t first = 0;
+
+    while (first < nb_entries) {
+        size_t last = first + 1;
+        struct st_picoquic_aead_batch_fn_t* batch_fn = picoquic_find_aead_batch_fn(
+            ((ptls_aead_context_t*)entries[first].aead_ctx)->algo, 0);
+
+        while (last < nb_entries && entries[last].aead_ctx == entries[first].aead_ctx) {
+            last++;
+        }
+
+        if (batch_fn != NULL && batch_fn->encrypt_batch_fn != NULL) {
+            batch_fn->encrypt_batch_fn(entries + first, last - first);
+        }
+        else {
+            picoquic_aead_encrypt_batch_generic(entries + first, last - first);
+        }
+        first = last;
+    }
+}
+
+/* Batched decryption of received packets. The generic version
+ * decrypts the packets one after the other.
+ */
+void picoquic_aead_decrypt_batch_generic(picoquic_aead_decrypt_batch_entry_t* entries, size_t nb_entries)
+{
+    for (size_t i = 0; i < nb_entries; i++) {
+        picoquic_aead_decrypt_batch_entry_t* entry = &entries[i];
+
+        if (entry->is_multipath) {
+            entry->decrypted_length = picoquic_aead_decrypt_mp(entry->output, entry->input, entry->input_length,
+                entry->path_id, entry->sequence_number, entry->aad, entry->aad_length, entry->aead_ctx);
+        }
+        else {
+            entry->decrypted_length = picoquic_aead_decrypt_generic(entry->output, entry->input, entry->input_length,
+                entry->sequence_number, entry->aad, entry->aad_length, entry->aead_ctx);
+        }
+    }
+}
+
+void picoquic_aead_decrypt_batch(picoquic_aead_decrypt_batch_entry_t* entries, size_t nb_entries)
+{
+    size_t first = 0;
+
+    while (first < nb_entries) {
+        size_t last = first + 1;
+        struct st_picoquic_aead_batch_fn_t* batch_fn = picoquic_find_aead_batch_fn(
+            ((ptls_aead_context_t*)entries[first].aead_ctx)->algo, 0);
+
+        while (last < nb_entries && entries[last].aead_ctx == entries[first].aead_ctx) {
+            last++;
+        }
+
+        if (batch_fn != NULL && batch_fn->decrypt_batch_fn != NULL) {
+            batch_fn->decrypt_batch_fn(entries + first, last - first);
+        }
+        else {
+            picoquic_aead_decrypt_batch_generic(entries + first, last - first);
+        }
+        first = last;
+    }
+}
+
 /* management of version specific salt, for initial packet encryption.
  */
 
@@ -86,6 +86,13 @@ size_t picoquic_aead_decrypt_mp(uint8_t* output, const uint8_t* input, size_t in
 size_t picoquic_aead_encrypt_mp(uint8_t* output, const uint8_t* input, size_t input_length, uint64_t path_id,
     uint64_t seq_num, const uint8_t* auth_data, size_t auth_data_length, void* aead_context);
 
+struct st_picoquic_aead_batch_entry_t;
+void picoquic_aead_encrypt_batch_generic(struct st_picoquic_aead_batch_entry_t* entries, size_t nb_entries);
+void picoquic_aead_encrypt_batch(struct st_picoquic_aead_batch_entry_t* entries, size_t nb_entries);
+struct st_picoquic_aead_decrypt_batch_entry_t;
+void picoquic_aead_decrypt_batch_generic(struct st_picoquic_aead_decrypt_batch_entry_t* entries, size_t nb_entries);
+void picoquic_aead_decrypt_batch(struct st_picoquic_aead_decrypt_batch_entry_t* entries, size_t nb_entries);
+
 uint64_t picoquic_aead_integrity_limit(void* aead_ctx);
 uint64_t picoquic_aead_confidentiality_limit(void* aead_ctx);
 
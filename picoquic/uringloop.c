@@ -0,0 +1,991 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/* io_uring version of the packet loop.
+ *
+ * This is a third implementation of the packet loop, next to sockloop.c
+ * and winsockloop.c, for Linux systems that support io_uring. It uses
+ * the same thread context, parameters and callbacks as picoquic_packet_loop_v3,
+ * and is selected by setting use_io_uring in the loop parameters.
+ *
+ * - Each socket has a multishot recvmsg request outstanding. The kernel
+ *   picks receive buffers from a "provided buffer ring", so that there
+ *   is no system call per received packet. The buffers are returned to
+ *   the ring as soon as the packet has been processed.
+ * - Packets prepared by picoquic_prepare_next_packet_ex are placed in
+ *   send slots, and the corresponding sendmsg requests (with UDP_SEGMENT
+ *   if GSO is available) are submitted in a single call, together with
+ *   the wait for the next completion.
+ * - The wake up pipe is monitored with a multishot poll request.
+ * - If all the send slots are in flight, the loop waits for a completion
+ *   instead of polling the ring.
+ * - Before the ring is deleted, the pending requests are cancelled, and
+ *   the loop waits until the kernel has completed them, so that it does
+ *   not write in released receive buffers.
+ *
+ * The implementation uses the raw system calls defined in <linux/io_uring.h>,
+ * so that there is no dependency on liburing. It is only compiled if the
+ * build system found io_uring multishot support in the kernel headers
+ * (PICOQUIC_HAVE_IO_URING). If the kernel does not support the required
+ * features at run time, picoquic_packet_loop_v3 uses the select or epoll
+ * version instead.
+ */
+
+#ifdef PICOQUIC_HAVE_IO_URING
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+
+#include "picosocks.h"
+#include "picoquic.h"
+#include "picoquic_internal.h"
+#include "picoquic_packet_loop.h"
+#include "picoquic_unified_log.h"
+
+#define PICOQUIC_URING_ENTRIES 256
+#define PICOQUIC_URING_BGID 0
+#define PICOQUIC_URING_NB_BUFFERS 256
+#define PICOQUIC_URING_NB_BUFFERS_COALESCED 64
+#define PICOQUIC_URING_CMSG_SIZE 256
+#define PICOQUIC_URING_SEND_SLOTS 16
+#define PICOQUIC_URING_SEND_WAIT_MAX 1000
+#define PICOQUIC_URING_CANCEL_WAIT 100000
+#define PICOQUIC_URING_CANCEL_WAIT_NB 10
+
+#define PICOQUIC_URING_TAG_RECV 1
+#define PICOQUIC_URING_TAG_SEND 2
+#define PICOQUIC_URING_TAG_WAKE_UP 3
+#define PICOQUIC_URING_TAG_CANCEL 4
+#define PICOQUIC_URING_TAG(type, index) ((((uint64_t)(type)) << 32) | (uint32_t)(index))
+#define PICOQUIC_URING_TAG_TYPE(tag) ((uint32_t)((tag) >> 32))
+#define PICOQUIC_URING_TAG_INDEX(tag) ((uint32_t)((tag) & 0xFFFFFFFF))
+
+typedef struct st_picoquic_uring_send_slot_t {
+    int is_busy;
+    SOCKET_TYPE fd;
+    size_t send_length;
+    size_t send_msg_size;
+    int if_index;
+    picoquic_cnx_t* cnx;
+    picoquic_connection_id_t cnx_key;
+    picoquic_connection_id_t log_cid;
+    struct sockaddr_storage peer_addr;
+    struct sockaddr_storage local_addr;
+    struct msghdr msg;
+    struct iovec iov;
+    char cmsg_buffer[PICOQUIC_URING_CMSG_SIZE];
+    uint8_t* buffer;
+} picoquic_uring_send_slot_t;
+
+typedef struct st_picoquic_uring_t {
+    int ring_fd;
+    /* Submission queue */
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned sqe_tail;
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+    /* Completion queue */
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    /* Provided buffer ring for receive */
+    struct io_uring_buf_ring* buf_ring;
+    size_t buf_ring_size;
+    uint8_t* buffers;
+    size_t buffer_size;
+    unsigned nb_buffers;
+    uint16_t buf_tail;
+    /* Receive message templates, one per socket */
+    struct msghdr recv_msg[PICOQUIC_PACKET_LOOP_SOCKETS_MAX];
+    int recv_armed[PICOQUIC_PACKET_LOOP_SOCKETS_MAX];
+    int wake_up_armed;
+    /* Send slots */
+    picoquic_uring_send_slot_t send_slot[PICOQUIC_URING_SEND_SLOTS];
+    uint8_t* send_buffers;
+    size_t send_buffer_size;
+} picoquic_uring_t;
+
+static int picoquic_uring_setup(unsigned entries, struct io_uring_params* p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int picoquic_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete,
+    unsigned flags, void* arg, size_t arg_size)
+{
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int picoquic_uring_register(int ring_fd, unsigned opcode, void* arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static void picoquic_uring_cancel_pending(picoquic_uring_t* uring);
+
+static void picoquic_uring_delete(picoquic_uring_t* uring)
+{
+    if (uring->ring_fd >= 0 && uring->sq_ring_ptr != NULL && uring->sqes != NULL) {
+        picoquic_uring_cancel_pending(uring);
+    }
+    if (uring->buf_ring != NULL) {
+        if (uring->ring_fd >= 0) {
+            struct io_uring_buf_reg reg;
+            memset(&reg, 0, sizeof(reg));
+            reg.bgid = PICOQUIC_URING_BGID;
+            (void)picoquic_uring_register(uring->ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+        munmap(uring->buf_ring, uring->buf_ring_size);
+        uring->buf_ring = NULL;
+    }
+    if (uring->sqes != NULL) {
+        munmap(uring->sqes, uring->sqes_size);
+        uring->sqes = NULL;
+    }
+    if (uring->sq_ring_ptr != NULL) {
+        munmap(uring->sq_ring_ptr, uring->sq_ring_size);
+        uring->sq_ring_ptr = NULL;
+    }
+    if (uring->ring_fd >= 0) {
+        close(uring->ring_fd);
+        uring->ring_fd = -1;
+    }
+    if (uring->buffers != NULL) {
+        free(uring->buffers);
+        uring->buffers = NULL;
+    }
+    if (uring->send_buffers != NULL) {
+        free(uring->send_buffers);
+        uring->send_buffers = NULL;
+    }
+}
+
+static void picoquic_uring_recycle_buffer(picoquic_uring_t* uring, uint16_t bid)
+{
+    struct io_uring_buf* buf = &uring->buf_ring->bufs[uring->buf_tail & (uring->nb_buffers - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(uring->buffers + (size_t)bid * uring->buffer_size);
+    buf->len = (uint32_t)uring->buffer_size;
+    buf->bid = bid;
+    uring->buf_tail++;
+    __atomic_store_n(&uring->buf_ring->tail, uring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int picoquic_uring_create(picoquic_uring_t* uring, size_t payload_size, unsigned nb_buffers,
+    size_t send_buffer_size)
+{
+    int ret = 0;
+    struct io_uring_params p;
+
+    memset(uring, 0, sizeof(picoquic_uring_t));
+    uring->ring_fd = -1;
+    memset(&p, 0, sizeof(p));
+
+    if ((uring->ring_fd = picoquic_uring_setup(PICOQUIC_URING_ENTRIES, &p)) < 0) {
+        DBG_PRINTF("io_uring_setup fails, errno: %d", errno);
+        ret = -1;
+    }
+    else if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0 || (p.features & IORING_FEAT_EXT_ARG) == 0) {
+        DBG_PRINTF("io_uring features not supported: 0x%x", p.features);
+        ret = -1;
+    }
+    else {
+        uring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        uring->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (uring->cq_ring_size > uring->sq_ring_size) {
+            uring->sq_ring_size = uring->cq_ring_size;
+        }
+        uring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+        uring->sq_ring_ptr = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQ_RING);
+        if (uring->sq_ring_ptr == MAP_FAILED) {
+            uring->sq_ring_ptr = NULL;
+            ret = -1;
+        }
+        else {
+            uring->sqes = (struct io_uring_sqe*)mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQES);
+            if (uring->sqes == MAP_FAILED) {
+                uring->sqes = NULL;
+                ret = -1;
+            }
+        }
+        if (ret == 0) {
+            uint8_t* sq = (uint8_t*)uring->sq_ring_ptr;
+            uring->cq_ring_ptr = uring->sq_ring_ptr;
+            uring->sq_head = (unsigned*)(sq + p.sq_off.head);
+            uring->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+            uring->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+            uring->sq_array = (unsigned*)(sq + p.sq_off.array);
+            uring->sq_entries = p.sq_entries;
+            uring->sqe_tail = *uring->sq_tail;
+            uring->cq_head = (unsigned*)(sq + p.cq_off.head);
+            uring->cq_tail = (unsigned*)(sq + p.cq_off.tail);
+            uring->cq_mask = (unsigned*)(sq + p.cq_off.ring_mask);
+            uring->cqes = (struct io_uring_cqe*)(sq + p.cq_off.cqes);
+        }
+        else {
+            DBG_PRINTF("Cannot map io_uring queues, errno: %d", errno);
+        }
+    }
+
+    if (ret == 0) {
+        /* Allocate the receive buffers and register the provided buffer ring */
+        struct io_uring_buf_reg reg;
+
+        uring->nb_buffers = nb_buffers;
+        uring->buffer_size = sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) +
+            PICOQUIC_URING_CMSG_SIZE + payload_size;
+        uring->buf_ring_size = nb_buffers * sizeof(struct io_uring_buf);
+        uring->buf_ring = (struct io_uring_buf_ring*)mmap(NULL, uring->buf_ring_size, PROT_READ | PROT_WRITE,
+            MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+        uring->buffers = (uint8_t*)malloc(uring->buffer_size * nb_buffers);
+        if (uring->buf_ring == MAP_FAILED || uring->buffers == NULL) {
+            if (uring->buf_ring == MAP_FAILED) {
+                uring->buf_ring = NULL;
+            }
+            DBG_PRINTF("Cannot allocate %u receive buffers of %zu bytes", nb_buffers, uring->buffer_size);
+            ret = -1;
+        }
+        else {
+            memset(&reg, 0, sizeof(reg));
+            reg.ring_addr = (uint64_t)(uintptr_t)uring->buf_ring;
+            reg.ring_entries = nb_buffers;
+            reg.bgid = PICOQUIC_URING_BGID;
+            if (picoquic_uring_register(uring->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+                DBG_PRINTF("Cannot register buffer ring, errno: %d", errno);
+                munmap(uring->buf_ring, uring->buf_ring_size);
+                uring->buf_ring = NULL;
+                ret = -1;
+            }
+            else {
+                for (unsigned i = 0; i < nb_buffers; i++) {
+                    picoquic_uring_recycle_buffer(uring, (uint16_t)i);
+                }
+            }
+        }
+    }
+
+    if (ret == 0) {
+        /* Allocate the send slots */
+        uring->send_buffer_size = send_buffer_size;
+        uring->send_buffers = (uint8_t*)malloc(send_buffer_size * PICOQUIC_URING_SEND_SLOTS);
+        if (uring->send_buffers == NULL) {
+            ret = -1;
+        }
+        else {
+            for (int i = 0; i < PICOQUIC_URING_SEND_SLOTS; i++) {
+                uring->send_slot[i].buffer = uring->send_buffers + i * send_buffer_size;
+            }
+        }
+    }
+
+    if (ret != 0) {
+        picoquic_uring_delete(uring);
+    }
+
+    return ret;
+}
+
+/* Test whether the kernel supports the io_uring features used in this loop.
+ * The result is cached, as it will not change while the process runs. */
+int picoquic_packet_loop_uring_supported(void)
+{
+    static int is_supported = -1;
+
+    if (is_supported < 0) {
+        picoquic_uring_t uring;
+        is_supported = (picoquic_uring_create(&uring, PICOQUIC_MAX_PACKET_SIZE, 2, PICOQUIC_MAX_PACKET_SIZE) == 0);
+        if (is_supported) {
+            picoquic_uring_delete(&uring);
+        }
+    }
+    return is_supported;
+}
+
+static struct io_uring_sqe* picoquic_uring_get_sqe(picoquic_uring_t* uring)
+{
+    struct io_uring_sqe* sqe = NULL;
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+
+    if (uring->sqe_tail - head < uring->sq_entries) {
+        sqe = &uring->sqes[uring->sqe_tail & *uring->sq_mask];
+        uring->sqe_tail++;
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+    }
+    return sqe;
+}
+
+/* Publish the prepared entries to the kernel, return the number of entries to submit */
+static unsigned picoquic_uring_flush(picoquic_uring_t* uring)
+{
+    unsigned tail = *uring->sq_tail;
+    unsigned to_submit = uring->sqe_tail - tail;
+
+    while (tail != uring->sqe_tail) {
+        uring->sq_array[tail & *uring->sq_mask] = tail & *uring->sq_mask;
+        tail++;
+    }
+    __atomic_store_n(uring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    return to_submit;
+}
+
+/* Submit the pending entries, and wait for at least one completion or for the
+ * timer to expire. The timer is expressed in microseconds. */
+static int picoquic_uring_submit_and_wait(picoquic_uring_t* uring, int64_t delta_t)
+{
+    int ret = 0;
+    unsigned to_submit = picoquic_uring_flush(uring);
+    unsigned head = *uring->cq_head;
+    unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (delta_t <= 0 || head != tail) {
+        if (to_submit > 0) {
+            ret = picoquic_uring_enter(uring->ring_fd, to_submit, 0, 0, NULL, 0);
+        }
+    }
+    else {
+        struct io_uring_getevents_arg arg;
+        struct __kernel_timespec ts;
+
+        if (delta_t > 10000000) {
+            delta_t = 10000000;
+        }
+        ts.tv_sec = delta_t / 1000000;
+        ts.tv_nsec = (delta_t % 1000000) * 1000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        ret = picoquic_uring_enter(uring->ring_fd, to_submit, 1,
+            IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+
+    if (ret < 0) {
+        if (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+            ret = 0;
+        }
+        else {
+            DBG_PRINTF("io_uring_enter fails, errno: %d", errno);
+        }
+    }
+    else {
+        ret = 0;
+    }
+    return ret;
+}
+
+/* Cancel the pending receive and poll requests, then wait until the kernel
+ * has completed them, as well as the pending sends. The wait is bounded, in
+ * case the kernel does not deliver the completions. Sends that were queued
+ * but not yet executed are lost, as they would be if the socket was closed. */
+static int picoquic_uring_is_pending(picoquic_uring_t* uring)
+{
+    int is_pending = uring->wake_up_armed;
+
+    for (int i = 0; !is_pending && i < PICOQUIC_PACKET_LOOP_SOCKETS_MAX; i++) {
+        is_pending = uring->recv_armed[i];
+    }
+    for (int i = 0; !is_pending && i < PICOQUIC_URING_SEND_SLOTS; i++) {
+        is_pending = uring->send_slot[i].is_busy;
+    }
+    return is_pending;
+}
+
+static void picoquic_uring_cancel(picoquic_uring_t* uring, uint64_t user_data)
+{
+    struct io_uring_sqe* sqe = picoquic_uring_get_sqe(uring);
+
+    if (sqe == NULL) {
+        unsigned to_submit = picoquic_uring_flush(uring);
+        if (to_submit > 0) {
+            (void)picoquic_uring_enter(uring->ring_fd, to_submit, 0, 0, NULL, 0);
+        }
+        sqe = picoquic_uring_get_sqe(uring);
+    }
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = user_data;
+        sqe->user_data = PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_CANCEL, 0);
+    }
+}
+
+static void picoquic_uring_cancel_pending(picoquic_uring_t* uring)
+{
+    int nb_waits = 0;
+
+    for (int i = 0; i < PICOQUIC_PACKET_LOOP_SOCKETS_MAX; i++) {
+        if (uring->recv_armed[i]) {
+            picoquic_uring_cancel(uring, PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_RECV, i));
+        }
+    }
+    if (uring->wake_up_armed) {
+        picoquic_uring_cancel(uring, PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_WAKE_UP, 0));
+    }
+
+    while (picoquic_uring_is_pending(uring) && nb_waits < PICOQUIC_URING_CANCEL_WAIT_NB) {
+        unsigned head;
+        unsigned tail;
+
+        if (picoquic_uring_submit_and_wait(uring, PICOQUIC_URING_CANCEL_WAIT) != 0) {
+            break;
+        }
+        head = *uring->cq_head;
+        tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &uring->cqes[head & *uring->cq_mask];
+            uint32_t tag_type = PICOQUIC_URING_TAG_TYPE(cqe->user_data);
+            uint32_t tag_index = PICOQUIC_URING_TAG_INDEX(cqe->user_data);
+
+            if (tag_type == PICOQUIC_URING_TAG_RECV && tag_index < PICOQUIC_PACKET_LOOP_SOCKETS_MAX) {
+                if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                    uring->recv_armed[tag_index] = 0;
+                }
+            }
+            else if (tag_type == PICOQUIC_URING_TAG_SEND && tag_index < PICOQUIC_URING_SEND_SLOTS) {
+                uring->send_slot[tag_index].is_busy = 0;
+                uring->send_slot[tag_index].cnx = NULL;
+            }
+            else if (tag_type == PICOQUIC_URING_TAG_WAKE_UP) {
+                if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                    uring->wake_up_armed = 0;
+                }
+            }
+            head++;
+            __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+        }
+        nb_waits++;
+    }
+    if (picoquic_uring_is_pending(uring)) {
+        DBG_PRINTF("%s", "io_uring requests still pending after cancel");
+    }
+}
+
+static int picoquic_uring_arm_recv(picoquic_uring_t* uring, picoquic_socket_ctx_t* s_ctx, int rank)
+{
+    int ret = 0;
+    struct io_uring_sqe* sqe = picoquic_uring_get_sqe(uring);
+
+    if (sqe == NULL) {
+        ret = -1;
+    }
+    else {
+        struct msghdr* msg = &uring->recv_msg[rank];
+        /* With multishot receive, the kernel uses the name and control
+         * lengths of the template to lay out the received buffer. */
+        memset(msg, 0, sizeof(struct msghdr));
+        msg->msg_namelen = sizeof(struct sockaddr_storage);
+        msg->msg_controllen = PICOQUIC_URING_CMSG_SIZE;
+
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = s_ctx[rank].fd;
+        sqe->addr = (uint64_t)(uintptr_t)msg;
+        sqe->len = 1;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = PICOQUIC_URING_BGID;
+        sqe->user_data = PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_RECV, rank);
+        uring->recv_armed[rank] = 1;
+    }
+    return ret;
+}
+
+static int picoquic_uring_arm_wake_up(picoquic_uring_t* uring, picoquic_network_thread_ctx_t* thread_ctx)
+{
+    int ret = 0;
+    struct io_uring_sqe* sqe = picoquic_uring_get_sqe(uring);
+
+    if (sqe == NULL) {
+        ret = -1;
+    }
+    else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = thread_ctx->wake_up_pipe_fd[0];
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_WAKE_UP, 0);
+        uring->wake_up_armed = 1;
+    }
+    return ret;
+}
+
+static picoquic_uring_send_slot_t* picoquic_uring_get_send_slot(picoquic_uring_t* uring, int* slot_index)
+{
+    for (int i = 0; i < PICOQUIC_URING_SEND_SLOTS; i++) {
+        if (!uring->send_slot[i].is_busy) {
+            *slot_index = i;
+            return &uring->send_slot[i];
+        }
+    }
+    return NULL;
+}
+
+static int picoquic_uring_queue_send(picoquic_uring_t* uring, picoquic_uring_send_slot_t* slot, int slot_index)
+{
+    int ret = 0;
+    struct io_uring_sqe* sqe = picoquic_uring_get_sqe(uring);
+
+    if (sqe == NULL) {
+        /* Queue full. Publish the pending entries and try again */
+        unsigned to_submit = picoquic_uring_flush(uring);
+        if (to_submit > 0) {
+            (void)picoquic_uring_enter(uring->ring_fd, to_submit, 0, 0, NULL, 0);
+        }
+        sqe = picoquic_uring_get_sqe(uring);
+    }
+    if (sqe == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(&slot->msg, 0, sizeof(struct msghdr));
+        slot->iov.iov_base = slot->buffer;
+        slot->iov.iov_len = slot->send_length;
+        slot->msg.msg_name = &slot->peer_addr;
+        slot->msg.msg_namelen = picoquic_addr_length((struct sockaddr*)&slot->peer_addr);
+        slot->msg.msg_iov = &slot->iov;
+        slot->msg.msg_iovlen = 1;
+        slot->msg.msg_control = slot->cmsg_buffer;
+        slot->msg.msg_controllen = sizeof(slot->cmsg_buffer);
+        picoquic_socks_cmsg_format(&slot->msg, slot->send_length, slot->send_msg_size,
+            (struct sockaddr*)&slot->local_addr, slot->if_index);
+
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = slot->fd;
+        sqe->addr = (uint64_t)(uintptr_t)&slot->msg;
+        sqe->len = 1;
+        sqe->user_data = PICOQUIC_URING_TAG(PICOQUIC_URING_TAG_SEND, slot_index);
+        slot->is_busy = 1;
+    }
+    return ret;
+}
+
+/* Process the completion of a send request. Errors are handled as in the
+ * socket loop, but the connection may have been deleted between the time
+ * the packet was prepared and the time the send completed. */
+static void picoquic_uring_send_complete(picoquic_quic_t* quic, picoquic_uring_send_slot_t* slot,
+    int res, size_t** send_msg_ptr, uint64_t current_time)
+{
+    if (res < 0) {
+        picoquic_packet_loop_send_error(quic,
+            picoquic_packet_loop_find_cnx(quic, slot->cnx, &slot->cnx_key, (struct sockaddr*)&slot->peer_addr),
+            &slot->log_cid, slot->fd, &slot->peer_addr, &slot->local_addr, slot->if_index,
+            slot->buffer, slot->send_length, slot->send_msg_size, res, -res, send_msg_ptr, current_time);
+    }
+    slot->is_busy = 0;
+    slot->cnx = NULL;
+}
+
+void* picoquic_packet_loop_uring(void* v_ctx)
+{
+    picoquic_network_thread_ctx_t* thread_ctx = (picoquic_network_thread_ctx_t*)v_ctx;
+    picoquic_quic_t* quic = thread_ctx->quic;
+    picoquic_packet_loop_param_t* param = thread_ctx->param;
+    picoquic_packet_loop_cb_fn loop_callback = thread_ctx->loop_callback;
+    void* loop_callback_ctx = thread_ctx->loop_callback_ctx;
+    int ret = 0;
+    uint64_t current_time = picoquic_get_quic_time(quic);
+    int64_t delay_max = 10000000;
+    size_t send_msg_size = 0;
+    size_t send_buffer_size = PICOQUIC_MAX_PACKET_SIZE;
+    size_t* send_msg_ptr = NULL;
+    picoquic_connection_id_t log_cid;
+    picoquic_socket_ctx_t s_ctx[PICOQUIC_PACKET_LOOP_SOCKETS_MAX];
+    int nb_sockets = 0;
+    int nb_sockets_available = 0;
+    picoquic_cnx_t* last_cnx = NULL;
+    int loop_immediate = 0;
+    unsigned int nb_loop_immediate = 0;
+    picoquic_packet_loop_options_t options = { 0 };
+    picoquic_uring_t uring;
+    int uring_created = 0;
+    int send_slots_full = 0;
+
+    if (thread_ctx->thread_name != NULL) {
+        thread_ctx->thread_setname_fn(thread_ctx->thread_name);
+    }
+
+    memset(s_ctx, 0, sizeof(s_ctx));
+    if ((nb_sockets = picoquic_packet_loop_open_sockets_ex(param->local_port,
+        param->local_af, param->socket_buffer_size,
+        param->extra_socket_required, param->do_not_use_gso, param->reuse_port, s_ctx)) <= 0) {
+        ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
+        DBG_PRINTF("%s", "Thread cannot run:picoquic_packet_loop_open_sockets error ");
+    }
+    else if (loop_callback != NULL) {
+        struct sockaddr_storage l_addr;
+        ret = loop_callback(quic, picoquic_packet_loop_ready, loop_callback_ctx, &options);
+
+        if (ret == 0 && picoquic_store_loopback_addr(&l_addr, s_ctx[0].af, s_ctx[0].port) == 0) {
+            ret = loop_callback(quic, picoquic_packet_loop_port_update, loop_callback_ctx, &l_addr);
+        }
+        if (ret == 0 && options.provide_alt_port) {
+            int alt_sock = (nb_sockets > 2 && param->local_af == 0) ? 2 : 1;
+            uint16_t alt_port = s_ctx[alt_sock].port;
+            ret = loop_callback(quic, picoquic_packet_loop_alt_port, loop_callback_ctx, &alt_port);
+        }
+    }
+
+    if (ret == 0) {
+        size_t payload_size = PICOQUIC_MAX_PACKET_SIZE;
+        unsigned nb_buffers = PICOQUIC_URING_NB_BUFFERS;
+
+        nb_sockets_available = nb_sockets;
+        for (int i = 0; i < nb_sockets; i++) {
+            if (s_ctx[i].supports_udp_recv_coalesced) {
+                payload_size = PICOQUIC_PACKET_LOOP_RECV_COALESCED_MAX;
+                nb_buffers = PICOQUIC_URING_NB_BUFFERS_COALESCED;
+                break;
+            }
+        }
+        if (!param->do_not_use_gso) {
+#if defined(UDP_SEGMENT)
+            send_buffer_size = 0xFFFF;
+            send_msg_ptr = &send_msg_size;
+#endif
+        }
+        if (picoquic_uring_create(&uring, payload_size, nb_buffers, send_buffer_size) != 0) {
+            DBG_PRINTF("%s", "Thread cannot run: cannot create io_uring");
+            ret = -1;
+        }
+        else {
+            uring_created = 1;
+            param->is_io_uring_used = 1;
+            for (int i = 0; ret == 0 && i < nb_sockets; i++) {
+                ret = picoquic_uring_arm_recv(&uring, s_ctx, i);
+            }
+            if (ret == 0 && thread_ctx->wake_up_defined) {
+                ret = picoquic_uring_arm_wake_up(&uring, thread_ctx);
+            }
+        }
+    }
+
+    if (ret == 0) {
+        thread_ctx->thread_is_ready = 1;
+    }
+    else {
+        DBG_PRINTF("%s", "Thread cannot run");
+    }
+
+    while (ret == 0 && !thread_ctx->thread_should_close) {
+        int64_t delta_t = 0;
+        size_t nb_packets_received = 0;
+        size_t bytes_received = 0;
+        int is_wake_up_event = 0;
+        unsigned head;
+        unsigned tail;
+
+        /* As in the select version, the loop checks for more incoming packets
+         * before sending if packets were just received, up to a limit. */
+        current_time = picoquic_current_time();
+        if (!loop_immediate) {
+            nb_loop_immediate = 1;
+            delta_t = picoquic_get_next_wake_delay(quic, current_time, delay_max);
+            if (options.do_time_check) {
+                packet_loop_time_check_arg_t time_check_arg;
+                time_check_arg.current_time = current_time;
+                time_check_arg.delta_t = delta_t;
+                ret = loop_callback(quic, picoquic_packet_loop_time_check, loop_callback_ctx, &time_check_arg);
+                if (time_check_arg.delta_t < delta_t) {
+                    delta_t = time_check_arg.delta_t;
+                }
+            }
+        }
+        else {
+            nb_loop_immediate++;
+        }
+        loop_immediate = 0;
+        if (send_slots_full && delta_t <= 0) {
+            /* All send slots are in flight, wait for a completion */
+            delta_t = PICOQUIC_URING_SEND_WAIT_MAX;
+        }
+
+        if (ret == 0) {
+            ret = picoquic_uring_submit_and_wait(&uring, delta_t);
+        }
+        if (ret != 0) {
+            ret = (thread_ctx->thread_should_close) ? PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP : -1;
+            break;
+        }
+        current_time = picoquic_current_time();
+
+        /* Process the completions */
+        head = *uring.cq_head;
+        tail = __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &uring.cqes[head & *uring.cq_mask];
+            uint32_t tag_type = PICOQUIC_URING_TAG_TYPE(cqe->user_data);
+            uint32_t tag_index = PICOQUIC_URING_TAG_INDEX(cqe->user_data);
+
+            if (tag_type == PICOQUIC_URING_TAG_RECV && tag_index < (uint32_t)nb_sockets) {
+                if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                    uring.recv_armed[tag_index] = 0;
+                }
+                if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER) != 0) {
+                    uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                    uint8_t* buf = uring.buffers + (size_t)bid * uring.buffer_size;
+                    struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)buf;
+                    uint8_t* name = buf + sizeof(struct io_uring_recvmsg_out);
+                    uint8_t* control = name + uring.recv_msg[tag_index].msg_namelen;
+                    uint8_t* payload = control + uring.recv_msg[tag_index].msg_controllen;
+
+                    if (ret == 0 && (int)tag_index < nb_sockets_available && out->payloadlen > 0 &&
+                        (out->flags & MSG_TRUNC) == 0 && out->namelen <= sizeof(struct sockaddr_storage)) {
+                        struct sockaddr_storage addr_from;
+                        struct sockaddr_storage addr_to;
+                        struct msghdr msg;
+                        int if_index_to = 0;
+                        unsigned char received_ecn = 0;
+                        size_t udp_coalesced_size = 0;
+
+                        memset(&addr_from, 0, sizeof(addr_from));
+                        memcpy(&addr_from, name, out->namelen);
+                        addr_to.ss_family = AF_UNSPEC;
+                        memset(&msg, 0, sizeof(msg));
+                        msg.msg_control = control;
+                        msg.msg_controllen = out->controllen;
+                        picoquic_socks_cmsg_parse(&msg, &addr_to, &if_index_to, &received_ecn, &udp_coalesced_size);
+                        /* Document incoming port */
+                        if (addr_to.ss_family == AF_INET6) {
+                            ((struct sockaddr_in6*)&addr_to)->sin6_port = s_ctx[tag_index].n_port;
+                        }
+                        else if (addr_to.ss_family == AF_INET) {
+                            ((struct sockaddr_in*)&addr_to)->sin_port = s_ctx[tag_index].n_port;
+                        }
+                        ret = picoquic_packet_loop_submit_coalesced(quic, param, payload, out->payloadlen,
+                            udp_coalesced_size, (struct sockaddr*)&addr_from, (struct sockaddr*)&addr_to,
+                            if_index_to, received_ecn, &last_cnx, current_time);
+                        nb_packets_received++;
+                        bytes_received += out->payloadlen;
+                    }
+                    picoquic_uring_recycle_buffer(&uring, bid);
+                }
+            }
+            else if (tag_type == PICOQUIC_URING_TAG_SEND && tag_index < PICOQUIC_URING_SEND_SLOTS) {
+                picoquic_uring_send_complete(quic, &uring.send_slot[tag_index], cqe->res, &send_msg_ptr, current_time);
+                send_slots_full = 0;
+            }
+            else if (tag_type == PICOQUIC_URING_TAG_WAKE_UP) {
+                if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                    uring.wake_up_armed = 0;
+                }
+                if (cqe->res >= 0) {
+                    uint8_t eventbuf[8];
+                    ssize_t pipe_recv = read(thread_ctx->wake_up_pipe_fd[0], eventbuf, sizeof(eventbuf));
+                    if (pipe_recv > 0) {
+                        is_wake_up_event = 1;
+                    }
+                    else if (pipe_recv == 0 || errno != EAGAIN) {
+                        /* The pipe was closed, which happens when the thread is deleted */
+                        DBG_PRINTF("Error: read pipe returns %d\n", (pipe_recv == 0) ? EPIPE : errno);
+                        if (ret == 0) {
+                            ret = -1;
+                        }
+                        uring.wake_up_armed = 1;
+                    }
+                }
+            }
+            head++;
+            __atomic_store_n(uring.cq_head, head, __ATOMIC_RELEASE);
+            if (head == tail) {
+                tail = __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE);
+            }
+        }
+
+        if (ret != 0 && ret != PICOQUIC_NO_ERROR_SIMULATE_NAT) {
+            if (ret == -1 && thread_ctx->thread_should_close) {
+                ret = PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP;
+            }
+            break;
+        }
+
+        /* Rearm the requests that the kernel terminated, e.g., after running
+         * out of receive buffers. */
+        for (int i = 0; ret == 0 && i < nb_sockets_available; i++) {
+            if (!uring.recv_armed[i]) {
+                ret = picoquic_uring_arm_recv(&uring, s_ctx, i);
+            }
+        }
+        if (ret == 0 && thread_ctx->wake_up_defined && !uring.wake_up_armed) {
+            ret = picoquic_uring_arm_wake_up(&uring, thread_ctx);
+        }
+
+        if (is_wake_up_event && loop_callback != NULL && (ret == 0 || ret == PICOQUIC_NO_ERROR_SIMULATE_NAT)) {
+            int wake_ret = loop_callback(quic, picoquic_packet_loop_wake_up, loop_callback_ctx, NULL);
+            if (wake_ret != 0) {
+                ret = wake_ret;
+            }
+        }
+
+        if (nb_packets_received > 0 && (ret == 0 || ret == PICOQUIC_NO_ERROR_SIMULATE_NAT)) {
+            if (loop_callback != NULL) {
+                int recv_ret = loop_callback(quic, picoquic_packet_loop_after_receive, loop_callback_ctx, &bytes_received);
+                if (recv_ret != 0) {
+                    ret = recv_ret;
+                }
+            }
+            if (ret == 0 && nb_loop_immediate < PICOQUIC_PACKET_LOOP_RECV_MAX) {
+                loop_immediate = 1;
+                continue;
+            }
+        }
+
+        if (ret == PICOQUIC_NO_ERROR_SIMULATE_NAT) {
+            if (param->extra_socket_required) {
+                /* Stop using the extra socket, see picoquic_packet_loop_v3. Packets
+                 * that still arrive on the extra sockets are ignored. */
+                nb_sockets_available = nb_sockets / 2;
+            }
+            ret = 0;
+        }
+
+        if (ret == 0) {
+            uint64_t loop_time = current_time;
+            size_t bytes_sent = 0;
+            size_t nb_packets_sent = 0;
+
+            while (ret == 0 && nb_packets_sent < PICOQUIC_PACKET_LOOP_SEND_MAX) {
+                int slot_index = -1;
+                picoquic_uring_send_slot_t* slot = picoquic_uring_get_send_slot(&uring, &slot_index);
+                size_t send_length = 0;
+
+                if (slot == NULL) {
+                    /* All slots are in flight. Wait for completions. */
+                    send_slots_full = 1;
+                    break;
+                }
+                memset(&slot->local_addr, 0, sizeof(slot->local_addr));
+                slot->if_index = param->dest_if;
+                send_msg_size = 0;
+
+                ret = picoquic_prepare_next_packet_ex(quic, loop_time,
+                    slot->buffer, uring.send_buffer_size, &send_length,
+                    &slot->peer_addr, &slot->local_addr, &slot->if_index, &log_cid, &last_cnx,
+                    send_msg_ptr);
+
+                if (ret == 0 && send_length > 0) {
+                    SOCKET_TYPE send_socket = INVALID_SOCKET;
+                    uint16_t send_port = (slot->peer_addr.ss_family == AF_INET) ?
+                        ((struct sockaddr_in*)&slot->local_addr)->sin_port :
+                        ((struct sockaddr_in6*)&slot->local_addr)->sin6_port;
+
+                    nb_packets_sent += (send_msg_size == 0) ? 1 :
+                        (send_length + send_msg_size - 1) / (send_msg_size);
+                    if (send_length > param->send_length_max) {
+                        param->send_length_max = send_length;
+                    }
+                    bytes_sent += send_length;
+
+                    for (int i = 0; i < nb_sockets_available; i++) {
+                        if (s_ctx[i].af == slot->peer_addr.ss_family) {
+                            send_socket = s_ctx[i].fd;
+                            if (send_port == 0 && !param->prefer_extra_socket) {
+                                break;
+                            }
+                            if (s_ctx[i].n_port == send_port) {
+                                break;
+                            }
+                        }
+                    }
+
+                    if (send_socket == INVALID_SOCKET) {
+                        picoquic_log_context_free_app_message(quic, &log_cid, "Could not send message to AF_to=%d, AF_from=%d, if=%d, no socket",
+                            slot->peer_addr.ss_family, slot->local_addr.ss_family, slot->if_index);
+                    }
+                    else if (param->simulate_eio && send_length > PICOQUIC_MAX_PACKET_SIZE) {
+                        /* Test hook, simulating a driver that does not support GSO */
+                        slot->fd = send_socket;
+                        slot->send_length = send_length;
+                        slot->send_msg_size = send_msg_size;
+                        slot->cnx = last_cnx;
+                        picoquic_packet_loop_get_cnx_key(last_cnx, &slot->cnx_key);
+                        slot->log_cid = log_cid;
+                        param->simulate_eio = 0;
+                        picoquic_uring_send_complete(quic, slot, -EIO, &send_msg_ptr, current_time);
+                    }
+                    else {
+                        slot->fd = send_socket;
+                        slot->send_length = send_length;
+                        slot->send_msg_size = send_msg_size;
+                        slot->cnx = last_cnx;
+                        picoquic_packet_loop_get_cnx_key(last_cnx, &slot->cnx_key);
+                        slot->log_cid = log_cid;
+                        if (picoquic_uring_queue_send(&uring, slot, slot_index) != 0) {
+                            DBG_PRINTF("%s", "Cannot queue sendmsg request");
+                            ret = -1;
+                        }
+                    }
+                }
+                else {
+                    break;
+                }
+            }
+
+            if (ret == 0 && loop_callback != NULL) {
+                ret = loop_callback(quic, picoquic_packet_loop_after_send, loop_callback_ctx, &bytes_sent);
+            }
+        }
+    }
+
+    thread_ctx->thread_is_ready = 0;
+
+    if (ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP) {
+        /* Normal termination requested by the application, returns no error */
+        ret = 0;
+    }
+
+    if (uring_created) {
+        /* Cancel the pending requests, then release the ring */
+        picoquic_uring_delete(&uring);
+    }
+
+    /* Close the sockets */
+    for (int i = 0; i < nb_sockets; i++) {
+        picoquic_packet_loop_close_socket(&s_ctx[i]);
+    }
+
+    thread_ctx->return_code = ret;
+    if (thread_ctx->is_threaded) {
+        pthread_exit((void*)&thread_ctx->return_code);
+    }
+    return(NULL);
+}
+#endif
@@ -52,6 +52,7 @@ static const picoquic_test_def_t test_table[] = {
     { "threading", util_threading_test },
     { "picohash", picohash_test },
     { "picohash_embedded", picohash_embedded_test },
+    { "picohash_open", picohash_open_test },
     { "picohash_bytes", picohash_bytes_test },
     { "siphash", siphash_test },
     { "picolog_basic", picolog_basic_test },
@@ -64,7 +65,17 @@ static const picoquic_test_def_t test_table[] = {
     { "sockloop_nat", sockloop_nat_test },
     { "sockloop_thread", sockloop_thread_test },
     { "sockloop_thread_name", sockloop_thread_name_test },
+    { "sockloop_recv_batch", sockloop_recv_batch_test },
+    { "sockloop_epoll", sockloop_epoll_test },
+    { "sockloop_uring", sockloop_uring_test },
+    { "sockloop_send_batch", sockloop_send_batch_test },
+    { "sockloop_send_batch_peers", sockloop_send_batch_peers_test },
+    { "sockloop_send_batch_partial", sockloop_send_batch_partial_test },
+    { "sockloop_send_batch_eio", sockloop_send_batch_eio_test },
+    { "sockloop_shard", sockloop_shard_test },
     { "splay", splay_test },
+    { "wheel", wheel_test },
+    { "picoindex", picoindex_test },
     { "create_cnx", create_cnx_test },
     { "create_quic", create_quic_test },
     { "parseheader", parseheadertest },
@@ -82,11 +93,14 @@ static const picoquic_test_def_t test_table[] = {
     { "frames_format", frames_format_test },
     { "logger", logger_test },
     { "binlog", binlog_test },
+    { "binlog_writer", binlog_writer_test },
     { "app_message_overflow", app_message_overflow_test },
     { "TlsStreamFrame", TlsStreamFrameTest },
     { "StreamZeroFrame", StreamZeroFrameTest },
     { "stream_splay", stream_splay_test },
+    { "stream_index", stream_index_test },
     { "stream_output", stream_output_test },
+    { "stream_buffers", stream_buffers_test },
     { "stream_retransmit_copy", test_copy_for_retransmit },
     { "dataqueue_copy", dataqueue_copy_test },
     { "dataqueue_packet", dataqueue_packet_test },
@@ -123,6 +137,7 @@ static const picoquic_test_def_t test_table[] = {
 #endif
     { "tls_api", tls_api_test },
     { "tls_api_inject_hs_ack", tls_api_inject_hs_ack_test },
+    { "tls_api_open_tables", tls_api_open_tables_test },
     { "null_sni", null_sni_test },
     { "silence_test", tls_api_silence_test },
     { "code_version", code_version_test },
@@ -147,6 +162,8 @@ static const picoquic_test_def_t test_table[] = {
     { "datagram_small_new", datagram_small_new_test },
     { "datagram_small_packet", datagram_small_packet_test },
     { "datagram_wifi", datagram_wifi_test },
+    { "datagram_ring", datagram_ring_test },
+    { "datagram_queue", datagram_queue_test },
     { "ddos_amplification", ddos_amplification_test },
     { "ddos_amplification_0rtt", ddos_amplification_0rtt_test },
     { "ddos_amplification_8k", ddos_amplification_8k_test },
@@ -176,6 +193,9 @@ static const picoquic_test_def_t test_table[] = {
     { "tls_api_very_long_with_err", tls_api_very_long_with_err_test },
     { "tls_api_very_long_congestion", tls_api_very_long_congestion_test },
     { "many_short_loss", many_short_loss_test },
+    { "zero_copy_receive", zero_copy_receive_test },
+    { "compact_sent_packets", compact_sent_packets_test },
+    { "incoming_batch", incoming_batch_test },
     { "retry", tls_api_retry_test },
     { "retry_large", tls_api_retry_large_test},
     { "retry_token", tls_retry_token_test },
@@ -190,6 +210,7 @@ static const picoquic_test_def_t test_table[] = {
     { "nat_attack", nat_attack_test },
     { "sockets", socket_test },
     { "socket_ecn", socket_ecn_test },
+    { "socket_gro", socket_gro_test },
     { "ticket_store", ticket_store_test },
     { "ticket_seed", ticket_seed_test },
     { "ticket_seed_from_bdp_frame", ticket_seed_from_bdp_frame_test },
@@ -298,6 +319,7 @@ static const picoquic_test_def_t test_table[] = {
     { "padding_zero_min", padding_zero_min_test },
     { "packet_trace", packet_trace_test },
     { "qlog_auto", qlog_auto_test },
+    { "qlog_worker", qlog_worker_test },
     { "qlog_error", qlog_error_test },
     { "qlog_trace", qlog_trace_test },
     { "qlog_trace_auto", qlog_trace_auto_test },
@@ -488,6 +510,9 @@ static const picoquic_test_def_t test_table[] = {
     { "multipath_nat", multipath_nat_test },
     { "multipath_nat_challenge", multipath_nat_challenge_test },
     { "multipath_perf", multipath_perf_test },
+    { "multipath_coupled_shared", multipath_coupled_shared_test },
+    { "multipath_coupled_disjoint", multipath_coupled_disjoint_test },
+    { "multipath_olia_alpha", multipath_olia_alpha_test },
     { "multipath_callback", multipath_callback_test },
     { "multipath_quality", multipath_quality_test },
     { "multipath_stream_af", multipath_stream_af_test },
@@ -499,6 +524,7 @@ static const picoquic_test_def_t test_table[] = {
     { "multipath_keep_alive", multipath_keep_alive_test },
     { "multipath_qlog", multipath_qlog_test },
     { "multipath_tunnel", multipath_tunnel_test },
+    { "path_scheduler", path_scheduler_test },
     { "monopath_0rtt", monopath_0rtt_test },
     { "monopath_0rtt_loss", monopath_0rtt_loss_test },
     { "get_hash", get_hash_test },
@@ -527,19 +553,34 @@ static const picoquic_test_def_t test_table[] = {
 
 static size_t const nb_tests = sizeof(test_table) / sizeof(picoquic_test_def_t);
 
-static int do_one_test(size_t i, FILE* F)
+/* Benchmarks take much longer than the unit tests and only report timings,
+ * so they are not part of the default run. They are executed with "-b",
+ * or when named explicitly on the command line.
+ */
+static const picoquic_test_def_t bench_table[] = {
+    { "picohash_bench", picohash_bench_test },
+    { "wheel_bench", wheel_bench_test },
+    { "stream_index_bench", stream_index_bench_test },
+    { "stream_output_bench", stream_output_bench_test },
+    { "ack_index_bench", ack_index_bench_test },
+    { "aead_batch_bench", aead_batch_bench_test }
+};
+
+#define NB_BENCHES (sizeof(bench_table) / sizeof(picoquic_test_def_t))
+
+static int do_one_test_def(picoquic_test_def_t const* table, size_t nb_table, size_t i, FILE* F)
 {
     int ret = 0;
 
-    if (i >= nb_tests) {
+    if (i >= nb_table) {
         fprintf(F, "Invalid test number %" PRIst "\n", i);
         ret = -1;
     } else {
-        fprintf(F, "Starting test number %" PRIst ", %s\n", i, test_table[i].test_name);
+        fprintf(F, "Starting test number %" PRIst ", %s\n", i, table[i].test_name);
 
         fflush(F);
 
-        ret = test_table[i].test_fn();
+        ret = table[i].test_fn();
         if (ret == 0) {
             fprintf(F, "    Success.\n");
         } else {
@@ -552,6 +593,11 @@ static int do_one_test(size_t i, FILE* F)
     return ret;
 }
 
+static int do_one_test(size_t i, FILE* F)
+{
+    return do_one_test_def(test_table, nb_tests, i, F);
+}
+
 int usage(char const * argv0)
 {
     fprintf(stderr, "PicoQUIC test execution\n");
@@ -567,7 +613,17 @@ int usage(char const * argv0)
         }
         fprintf(stderr, "\n");
     }
+    fprintf(stderr, "Benchmarks, only run with -b or when named: \n");
+    for (size_t x = 0; x < NB_BENCHES; x++) {
+        fprintf(stderr, "    ");
+
+        for (int j = 0; j < 4 && x < NB_BENCHES; j++, x++) {
+            fprintf(stderr, "%s, ", bench_table[x].test_name);
+        }
+        fprintf(stderr, "\n");
+    }
     fprintf(stderr, "Options: \n");
+    fprintf(stderr, "  -b                Run all the benchmarks.\n");
     fprintf(stderr, "  -x test           Do not run the specified test.\n");
     fprintf(stderr, "  -o n1 n2          Only run test numbers in range [n1,n2]");
     fprintf(stderr, "  -s nnn            Run stress for nnn minutes.\n");
@@ -598,6 +654,19 @@ int get_test_number(char const * test_name)
     return test_number;
 }
 
+int get_bench_number(char const * bench_name)
+{
+    int bench_number = -1;
+
+    for (size_t i = 0; i < NB_BENCHES; i++) {
+        if (strcmp(bench_name, bench_table[i].test_name) == 0) {
+            bench_number = (int)i;
+        }
+    }
+
+    return bench_number;
+}
+
 int main(int argc, char** argv)
 {
     int ret = 0;
@@ -608,7 +677,9 @@ int main(int argc, char** argv)
     int auto_bypass = 0;
     int cf_rounds = 0;
     test_status_t * test_status = (test_status_t *) calloc(nb_tests, sizeof(test_status_t));
+    test_status_t bench_status[NB_BENCHES];
     int opt;
+    int do_bench = 0;
     int do_fuzz = 0;
     int do_stress = 0;
     int do_cnx_stress = 0;
@@ -635,9 +706,18 @@ int main(int argc, char** argv)
     else
     {
         memset(test_status, 0, nb_tests * sizeof(test_status_t));
+        for (size_t i = 0; i < NB_BENCHES; i++) {
+            bench_status[i] = test_excluded;
+        }
 
-        while (ret == 0 && (opt = getopt(argc, argv, "c:C:d:f:F:s:S:x:o:nrh")) != -1) {
+        while (ret == 0 && (opt = getopt(argc, argv, "c:C:d:f:F:s:S:x:o:bnrh")) != -1) {
             switch (opt) {
+            case 'b':
+                do_bench = 1;
+                for (size_t i = 0; i < NB_BENCHES; i++) {
+                    bench_status[i] = test_not_run;
+                }
+                break;
             case 'x': {
                 optind--;
                 while (optind < argc) {
@@ -764,8 +844,8 @@ int main(int argc, char** argv)
                 break;
             }
         }
-        /* If one of the stressers was specified, do not run any other test by default */
-        if (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz) {
+        /* If one of the stressers or the benchmarks was specified, do not run any other test by default */
+        if (do_stress || do_fuzz || do_cnx_stress || do_cnx_ddos || do_cf_fuzz || do_bench) {
             auto_bypass = 1;
             for (size_t i = 0; i < nb_tests; i++) {
                 test_status[i] = test_excluded;
@@ -781,12 +861,15 @@ int main(int argc, char** argv)
             while (optind < argc) {
                 int test_number = get_test_number(argv[optind]);
 
-                if (test_number < 0) {
-                    fprintf(stderr, "Incorrect test name: %s\n", optarg);
-                    ret = usage(argv[0]);
+                if (test_number >= 0) {
+                    test_status[test_number] = 0;
+                }
+                else if ((test_number = get_bench_number(argv[optind])) >= 0) {
+                    bench_status[test_number] = 0;
                 }
                 else {
-                    test_status[test_number] = 0;
+                    fprintf(stderr, "Incorrect test name: %s\n", optarg);
+                    ret = usage(argv[0]);
                 }
                 optind++;
             }
@@ -886,6 +969,19 @@ int main(int argc, char** argv)
                     fprintf(stdout, "Test number %d (%s) is bypassed.\n", (int)i, test_table[i].test_name);
                 }
             }
+            for (size_t i = 0; i < NB_BENCHES; i++) {
+                if (bench_status[i] == test_not_run) {
+                    nb_test_tried++;
+                    if (do_one_test_def(bench_table, NB_BENCHES, i, stdout) != 0) {
+                        bench_status[i] = test_failed;
+                        nb_test_failed++;
+                        ret = -1;
+                    }
+                    else {
+                        bench_status[i] = test_success;
+                    }
+                }
+            }
         }
 
         /* Report status, and if specified retry 
@@ -903,11 +999,22 @@ int main(int argc, char** argv)
                     fprintf(stdout, "%s ", test_table[i].test_name);
                 }
             }
+            for (size_t i = 0; i < NB_BENCHES; i++) {
+                if (bench_status[i] == test_failed) {
+                    fprintf(stdout, "%s ", bench_table[i].test_name);
+                }
+            }
             fprintf(stdout, "\n");
 
             if (disable_debug && retry_failed_test) {
                 debug_printf_resume();
                 ret = 0;
+                for (size_t i = 0; i < NB_BENCHES; i++) {
+                    if (bench_status[i] == test_failed) {
+                        fprintf(stdout, "Cannot retry %s:\n", bench_table[i].test_name);
+                        ret = -1;
+                    }
+                }
                 for (size_t i = 0; i < nb_tests; i++) {
                     if (test_status[i] == test_failed) {
                         if (strcmp("stress", test_table[i].test_name) == 0 ||
@@ -943,6 +1050,11 @@ int main(int argc, char** argv)
                             fprintf(stdout, "%s ", test_table[i].test_name);
                         }
                     }
+                    for (size_t i = 0; i < NB_BENCHES; i++) {
+                        if (bench_status[i] == test_failed) {
+                            fprintf(stdout, "%s ", bench_table[i].test_name);
+                        }
+                    }
                     fprintf(stdout, "\n");
                 }
             }
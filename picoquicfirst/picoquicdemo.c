@@ -107,8 +107,12 @@ typedef struct st_server_loop_cb_t {
     int just_once;
     int first_connection_seen;
     int connection_done;
+    h3zero_file_reader_t* file_reader;
 } server_loop_cb_t;
 
+/* Maximum delay before polling the file reader again if streams are waiting for data */
+#define SERVER_FILE_READER_POLL_DELAY 1000
+
 static int server_loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb_mode,
     void* callback_ctx, void * callback_arg)
 {
@@ -122,13 +126,30 @@ static int server_loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb
         switch (cb_mode) {
         case picoquic_packet_loop_ready:
             fprintf(stdout, "Waiting for packets.\n");
+            if (cb_ctx->file_reader != NULL && callback_arg != NULL) {
+                ((picoquic_packet_loop_options_t*)callback_arg)->do_time_check = 1;
+            }
             break;
         case picoquic_packet_loop_after_receive:
-            break;
         case picoquic_packet_loop_after_send:
+            if (cb_ctx->file_reader != NULL) {
+                (void)h3zero_file_reader_poll(cb_ctx->file_reader);
+            }
             break;
         case picoquic_packet_loop_port_update:
             break;
+        case picoquic_packet_loop_time_check:
+            if (cb_ctx->file_reader != NULL) {
+                packet_loop_time_check_arg_t* time_check_arg = (packet_loop_time_check_arg_t*)callback_arg;
+                if (h3zero_file_reader_poll(cb_ctx->file_reader) > 0) {
+                    time_check_arg->delta_t = 0;
+                }
+                else if (h3zero_file_reader_nb_waiting(cb_ctx->file_reader) > 0 &&
+                    time_check_arg->delta_t > SERVER_FILE_READER_POLL_DELAY) {
+                    time_check_arg->delta_t = SERVER_FILE_READER_POLL_DELAY;
+                }
+            }
+            break;
         default:
             ret = PICOQUIC_ERROR_UNEXPECTED_ERROR;
             break;
@@ -297,6 +318,18 @@ int quic_server(const char* server_name, picoquic_quic_config_t * config, int ju
     memset(&loop_cb_ctx, 0, sizeof(server_loop_cb_t));
     loop_cb_ctx.just_once = just_once;
 
+    if (config->www_dir != NULL) {
+        /* Serve files from worker threads, so slow disks do not stall the network thread.
+         * The workers also map the files served on a cache miss, so hot files are
+         * mapped once and shared across connections. */
+        loop_cb_ctx.file_reader = h3zero_file_reader_create(2, 0, 0);
+        if (loop_cb_ctx.file_reader == NULL) {
+            fprintf(stdout, "Cannot create the file reader, files will be read synchronously.\n");
+        }
+        picoquic_file_param.file_reader = loop_cb_ctx.file_reader;
+        picoquic_file_param.content_cache = h3zero_content_cache_create(0);
+    }
+
     /* Setup the server context */
     if (ret == 0) {
         current_time = picoquic_current_time();
@@ -369,6 +402,12 @@ int quic_server(const char* server_name, picoquic_quic_config_t * config, int ju
     if (qserver != NULL) {
         picoquic_free(qserver);
     }
+    if (loop_cb_ctx.file_reader != NULL) {
+        h3zero_file_reader_delete(loop_cb_ctx.file_reader);
+    }
+    if (picoquic_file_param.content_cache != NULL) {
+        h3zero_content_cache_delete(picoquic_file_param.content_cache);
+    }
 
     return ret;
 }
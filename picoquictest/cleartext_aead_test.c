@@ -27,8 +27,17 @@
 #include "picoquic_utils.h"
 #include "picotls.h"
 #include "picoquic_lb.h"
+#include "picoquic_crypto_provider_api.h"
 #include <string.h>
 #include "picoquictest_internal.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#ifdef _WINDOWS
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define AEAD_BATCH_BENCH_TSC
+#endif
 
 static uint8_t const addr1[4] = { 10, 0, 0, 1 };
 static uint8_t const addr2[4] = { 10, 0, 0, 2 };
@@ -1360,4 +1369,169 @@ int retry_protection_v2_test()
     }
 
     return ret;
-}
\ No newline at end of file
+}
+/* Benchmark of batched packet protection.
+ * A train of 1-RTT packets is protected once packet by packet, as done by
+ * picoquic_protect_packet, and once through the batch API. The test verifies
+ * that both methods produce the same bytes, and reports the cost per byte.
+ * The cost is measured in CPU cycles when a time stamp counter is available,
+ * in nanoseconds otherwise.
+ */
+#define AEAD_BATCH_BENCH_HEADER 13
+#define AEAD_BATCH_BENCH_PN_OFFSET 9
+#define AEAD_BATCH_BENCH_PAYLOAD 1200
+#define AEAD_BATCH_BENCH_PACKET (AEAD_BATCH_BENCH_HEADER + AEAD_BATCH_BENCH_PAYLOAD + 16)
+#define AEAD_BATCH_BENCH_BYTES (1 << 22)
+
+static uint64_t aead_batch_bench_ticks()
+{
+#ifdef AEAD_BATCH_BENCH_TSC
+    return __rdtsc();
+#else
+    return picoquic_current_time() * 1000;
+#endif
+}
+
+static void aead_batch_bench_init_packet(uint8_t* bytes, uint64_t sequence_number)
+{
+    uint64_t seed = 0x0123456789abcdefull ^ sequence_number;
+
+    bytes[0] = 0x43;
+    for (size_t i = 1; i < AEAD_BATCH_BENCH_PN_OFFSET; i++) {
+        bytes[i] = (uint8_t)(0xc0 + i);
+    }
+    picoformat_32(bytes + AEAD_BATCH_BENCH_PN_OFFSET, (uint32_t)sequence_number);
+    for (size_t i = AEAD_BATCH_BENCH_HEADER; i < AEAD_BATCH_BENCH_HEADER + AEAD_BATCH_BENCH_PAYLOAD; i++) {
+        seed *= 101;
+        bytes[i] = (uint8_t)(seed >> 32);
+    }
+}
+
+static uint64_t aead_batch_bench_serial(uint8_t* train, size_t nb_packets, uint64_t base, void* aead_ctx, void* pn_enc)
+{
+    uint64_t start = aead_batch_bench_ticks();
+
+    for (size_t i = 0; i < nb_packets; i++) {
+        uint8_t* packet = train + i * AEAD_BATCH_BENCH_PACKET;
+
+        (void)picoquic_aead_encrypt_generic(packet + AEAD_BATCH_BENCH_HEADER, packet + AEAD_BATCH_BENCH_HEADER,
+            AEAD_BATCH_BENCH_PAYLOAD, base + i, packet, AEAD_BATCH_BENCH_HEADER, aead_ctx);
+        picoquic_protect_packet_header(packet, AEAD_BATCH_BENCH_PN_OFFSET, 0x1F, pn_enc);
+    }
+
+    return aead_batch_bench_ticks() - start;
+}
+
+static uint64_t aead_batch_bench_batch(picoquic_quic_t* quic, uint8_t* train, size_t nb_packets, uint64_t base,
+    void* aead_ctx, void* pn_enc)
+{
+    uint64_t start = aead_batch_bench_ticks();
+
+    picoquic_protect_batch_open(quic);
+    for (size_t i = 0; i < nb_packets; i++) {
+        picoquic_aead_batch_entry_t* entry = &quic->protect_batch[quic->protect_batch_nb++];
+
+        entry->packet = train + i * AEAD_BATCH_BENCH_PACKET;
+        entry->header_length = AEAD_BATCH_BENCH_HEADER;
+        entry->payload_length = AEAD_BATCH_BENCH_PAYLOAD;
+        entry->pn_offset = AEAD_BATCH_BENCH_PN_OFFSET;
+        entry->sequence_number = base + i;
+        entry->path_id = 0;
+        entry->aead_ctx = aead_ctx;
+        entry->pn_enc = pn_enc;
+        entry->is_multipath = 0;
+        entry->first_mask = 0x1F;
+    }
+    picoquic_protect_batch_close(quic);
+
+    return aead_batch_bench_ticks() - start;
+}
+
+static int aead_batch_bench_one(picoquic_quic_t* quic, size_t nb_packets, void* aead_ctx, void* pn_enc,
+    uint8_t* serial_train, uint8_t* batch_train)
+{
+    int ret = 0;
+    size_t nb_trains = AEAD_BATCH_BENCH_BYTES / (nb_packets * AEAD_BATCH_BENCH_PAYLOAD);
+    uint64_t serial_ticks = 0;
+    uint64_t batch_ticks = 0;
+    double nb_bytes = (double)nb_trains * (double)nb_packets * (double)AEAD_BATCH_BENCH_PAYLOAD;
+
+    for (size_t t = 0; ret == 0 && t < nb_trains; t++) {
+        uint64_t base = (uint64_t)t * nb_packets;
+
+        for (size_t i = 0; i < nb_packets; i++) {
+            aead_batch_bench_init_packet(serial_train + i * AEAD_BATCH_BENCH_PACKET, base + i);
+        }
+        memcpy(batch_train, serial_train, nb_packets * AEAD_BATCH_BENCH_PACKET);
+
+        serial_ticks += aead_batch_bench_serial(serial_train, nb_packets, base, aead_ctx, pn_enc);
+        batch_ticks += aead_batch_bench_batch(quic, batch_train, nb_packets, base, aead_ctx, pn_enc);
+
+        if (memcmp(serial_train, batch_train, nb_packets * AEAD_BATCH_BENCH_PACKET) != 0) {
+            DBG_PRINTF("Batch and serial protection differ, train of %zu packets", nb_packets);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        DBG_PRINTF("Train of %zu packets: %.2f %s per byte batched, %.2f per packet",
+            nb_packets, (double)batch_ticks / nb_bytes,
+#ifdef AEAD_BATCH_BENCH_TSC
+            "cycles",
+#else
+            "ns",
+#endif
+            (double)serial_ticks / nb_bytes);
+    }
+
+    return ret;
+}
+
+int aead_batch_bench_test()
+{
+    int ret = 0;
+    uint8_t secret[32];
+    const size_t nb_packets[3] = { 1, 10, 64 };
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, 0, NULL, NULL, NULL, 0);
+    uint8_t* serial_train = (uint8_t*)malloc(PICOQUIC_PROTECT_BATCH_MAX * AEAD_BATCH_BENCH_PACKET);
+    uint8_t* batch_train = (uint8_t*)malloc(PICOQUIC_PROTECT_BATCH_MAX * AEAD_BATCH_BENCH_PACKET);
+    void* aead_ctx = NULL;
+    void* pn_enc = NULL;
+
+    for (size_t i = 0; i < sizeof(secret); i++) {
+        secret[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    if (quic == NULL || serial_train == NULL || batch_train == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the bench context");
+        ret = -1;
+    }
+    else if ((aead_ctx = picoquic_setup_test_aead_context(1, secret, PICOQUIC_LABEL_QUIC_V1_KEY_BASE)) == NULL ||
+        (pn_enc = picoquic_pn_enc_create_for_test(secret, PICOQUIC_LABEL_QUIC_V1_KEY_BASE)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the encryption contexts");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < 3; i++) {
+        ret = aead_batch_bench_one(quic, nb_packets[i], aead_ctx, pn_enc, serial_train, batch_train);
+    }
+
+    if (aead_ctx != NULL) {
+        picoquic_aead_free(aead_ctx);
+    }
+    if (pn_enc != NULL) {
+        picoquic_cipher_free(pn_enc);
+    }
+    if (serial_train != NULL) {
+        free(serial_train);
+    }
+    if (batch_train != NULL) {
+        free(batch_train);
+    }
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
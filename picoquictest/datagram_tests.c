@@ -638,4 +638,263 @@ int datagram_small_packet_test()
     dg_ctx.duration_max = 2060000;
 
     return datagram_test_one(9, &dg_ctx, 0);
-}
\ No newline at end of file
+}
+/* Unit test of the datagram ring: datagrams are retrieved in order, the
+ * ring grows as needed, wraps around, drops the oldest datagrams when
+ * full, and drops the expired datagrams without sending them.
+ */
+static int datagram_ring_check_first(picoquic_datagram_ring_t* ring, uint64_t current_time, uint64_t expected)
+{
+    int ret = 0;
+    picoquic_datagram_ring_entry_t* entry = picoquic_datagram_ring_first(ring, current_time);
+
+    if (entry == NULL) {
+        DBG_PRINTF("Expected datagram %" PRIu64 ", ring is empty", expected);
+        ret = -1;
+    }
+    else {
+        uint8_t* data = picoquic_datagram_ring_data(ring, entry);
+        uint64_t number = 0;
+
+        if (entry->length != 8 + (size_t)(expected % 1000) ||
+            picoquic_frames_uint64_decode(data, data + entry->length, &number) == NULL ||
+            number != expected) {
+            DBG_PRINTF("Expected datagram %" PRIu64 ", got %" PRIu64 ", length %zu", expected, number, entry->length);
+            ret = -1;
+        }
+        else {
+            picoquic_datagram_ring_pop(ring, current_time);
+        }
+    }
+
+    return ret;
+}
+
+static int datagram_ring_push_number(picoquic_datagram_ring_t* ring, uint64_t number, uint64_t current_time, uint64_t deadline)
+{
+    int ret = 0;
+    size_t length = 8 + (size_t)(number % 1000);
+    uint8_t* data = picoquic_datagram_ring_push(ring, length, current_time, deadline);
+
+    if (data == NULL) {
+        DBG_PRINTF("Cannot push datagram %" PRIu64, number);
+        ret = -1;
+    }
+    else {
+        picoquic_frames_uint64_encode(data, data + length, number);
+        memset(data + 8, (int)(number & 0xff), length - 8);
+    }
+
+    return ret;
+}
+
+int datagram_ring_test()
+{
+    int ret = 0;
+    picoquic_datagram_ring_t ring;
+    uint64_t next_push = 0;
+    uint64_t next_pop = 0;
+    uint64_t current_time = 0;
+
+    memset(&ring, 0, sizeof(ring));
+
+    /* Push and pop with a variable backlog, so the ring grows and wraps */
+    for (int round = 0; ret == 0 && round < 100; round++) {
+        int nb_push = 1 + (round * 7) % 300;
+        int nb_pop = 1 + (round * 11) % 300;
+
+        for (int i = 0; ret == 0 && i < nb_push; i++) {
+            ret = datagram_ring_push_number(&ring, next_push++, current_time, PICOQUIC_DATAGRAM_NO_DEADLINE);
+        }
+        current_time += 1000;
+        for (int i = 0; ret == 0 && i < nb_pop && next_pop < next_push; i++) {
+            ret = datagram_ring_check_first(&ring, current_time, next_pop++);
+        }
+    }
+    while (ret == 0 && next_pop < next_push) {
+        ret = datagram_ring_check_first(&ring, current_time, next_pop++);
+    }
+    if (ret == 0 && (ring.nb_entries != 0 || ring.nb_bytes != 0 || ring.nb_sent != next_push ||
+        ring.nb_queued != next_push || ring.nb_overflow != 0 || ring.nb_expired != 0 ||
+        ring.queue_delay_max == 0)) {
+        DBG_PRINTF("Unexpected ring state, %zu entries, %" PRIu64 " sent, %" PRIu64 " queued",
+            ring.nb_entries, ring.nb_sent, ring.nb_queued);
+        ret = -1;
+    }
+
+    /* With limits, the oldest datagrams are dropped and the ring does not grow */
+    if (ret == 0 && picoquic_datagram_ring_set_limits(&ring, 32, 8192) != 0) {
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && i < 1000; i++) {
+        ret = datagram_ring_push_number(&ring, next_push++, current_time, PICOQUIC_DATAGRAM_NO_DEADLINE);
+        if (ret == 0 && (ring.entries_max != 32 || ring.buffer_size != 8192 || ring.nb_entries > 32)) {
+            DBG_PRINTF("Ring grew beyond limits, %zu entries, %zu bytes", ring.entries_max, ring.buffer_size);
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        uint64_t nb_overflow = ring.nb_overflow;
+
+        next_pop = next_push - ring.nb_entries;
+        if (nb_overflow + ring.nb_entries != 1000) {
+            DBG_PRINTF("Expected %d datagrams, %" PRIu64 " overflow, %zu queued", 1000, nb_overflow, ring.nb_entries);
+            ret = -1;
+        }
+    }
+    while (ret == 0 && next_pop < next_push) {
+        ret = datagram_ring_check_first(&ring, current_time, next_pop++);
+    }
+
+    /* Datagrams past their deadline are dropped without being sent.
+     * Remove the limits first, so no datagram is dropped for overflow. */
+    if (ret == 0 && picoquic_datagram_ring_set_limits(&ring, 0, 0) != 0) {
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && i < 20; i++) {
+        ret = datagram_ring_push_number(&ring, next_push++, current_time, (i % 2 == 0) ? current_time + 500 : PICOQUIC_DATAGRAM_NO_DEADLINE);
+    }
+    current_time += 1000;
+    for (int i = 0; ret == 0 && i < 20; i++) {
+        uint64_t number = next_push - 20 + i;
+        if (i % 2 == 1) {
+            ret = datagram_ring_check_first(&ring, current_time, number);
+        }
+    }
+    if (ret == 0 && (ring.nb_expired != 10 || picoquic_datagram_ring_first(&ring, current_time) != NULL)) {
+        DBG_PRINTF("Expected 10 expired datagrams, got %" PRIu64, ring.nb_expired);
+        ret = -1;
+    }
+
+    /* A datagram larger than the ring cannot be queued */
+    if (ret == 0 && picoquic_datagram_ring_set_limits(&ring, 32, 8192) != 0) {
+        ret = -1;
+    }
+    if (ret == 0 && picoquic_datagram_ring_push(&ring, 8193, current_time, PICOQUIC_DATAGRAM_NO_DEADLINE) != NULL) {
+        DBG_PRINTF("%s", "Datagram larger than the ring was queued");
+        ret = -1;
+    }
+
+    picoquic_datagram_ring_release(&ring);
+
+    return ret;
+}
+
+/* Queue datagrams through the API, on a slow link. Verify that the ring
+ * limits are applied, that expired datagrams are not sent, and that all
+ * the datagrams sent are received.
+ */
+/* Run the simulation until the datagram queue of the client is empty and
+ * all the datagrams that were sent have been received. Waiting for the
+ * loop to become inactive does not work, since the connection stays
+ * active until the idle timeout. */
+static int datagram_queue_run(picoquic_test_tls_api_ctx_t* test_ctx, test_datagram_send_recv_ctx_t* dg_ctx,
+    uint64_t* simulated_time)
+{
+    int ret = 0;
+    int nb_trials = 0;
+    uint64_t time_out = *simulated_time + 4000000;
+
+    while (ret == 0 && nb_trials < 100000 && *simulated_time < time_out && TEST_CLIENT_READY) {
+        int was_active = 0;
+        picoquic_datagram_queue_stats_t stats;
+
+        picoquic_get_datagram_queue_stats(test_ctx->cnx_client, &stats);
+        if (stats.nb_waiting == 0 && (uint64_t)dg_ctx->dg_recv[0] == stats.nb_sent) {
+            break;
+        }
+        nb_trials++;
+        ret = tls_api_one_sim_round(test_ctx, simulated_time, time_out, &was_active);
+    }
+
+    return ret;
+}
+
+int datagram_queue_test()
+{
+    uint64_t simulated_time = 0;
+    uint64_t loss_mask = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    picoquic_connection_id_t initial_cid = { {0xda, 0xda, 0x0e, 0, 0, 0, 0, 0}, 8 };
+    test_datagram_send_recv_ctx_t dg_ctx = { 0 };
+    picoquic_tp_t client_parameters;
+    picoquic_datagram_queue_stats_t stats;
+    picoquic_outgoing_datagram_t datagrams[200];
+    uint8_t payload[1000];
+    int ret;
+
+    memset(payload, 0, sizeof(payload));
+    dg_ctx.dg_max_size = PICOQUIC_MAX_PACKET_SIZE;
+
+    ret = tls_api_init_ctx_ex(&test_ctx, PICOQUIC_INTERNAL_TEST_VERSION_1,
+        PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, &simulated_time, NULL, NULL, 0, 1, 0,
+        &initial_cid);
+
+    if (ret == 0) {
+        test_ctx->datagram_ctx = &dg_ctx;
+        test_ctx->datagram_recv_fn = test_datagram_recv;
+        test_ctx->datagram_ack_fn = test_datagram_ack;
+        /* 1 Mbps link, so that the datagrams are queued */
+        test_ctx->c_to_s_link->picosec_per_byte = 8000000;
+        picoquic_init_transport_parameters(&client_parameters, 1);
+        client_parameters.max_datagram_frame_size = dg_ctx.dg_max_size;
+        picoquic_set_transport_parameters(test_ctx->cnx_client, &client_parameters);
+        ret = picoquic_start_client_cnx(test_ctx->cnx_client);
+    }
+
+    if (ret == 0) {
+        ret = tls_api_connection_loop(test_ctx, &loss_mask, 0, &simulated_time);
+    }
+
+    /* Queue more datagrams than the ring can hold */
+    if (ret == 0) {
+        ret = picoquic_set_datagram_queue_limits(test_ctx->cnx_client, 64, 64 * sizeof(payload));
+    }
+    if (ret == 0) {
+        for (int i = 0; i < 200; i++) {
+            datagrams[i].bytes = payload;
+            datagrams[i].length = sizeof(payload);
+            datagrams[i].ttl = 0;
+        }
+        ret = picoquic_queue_datagram_batch(test_ctx->cnx_client, datagrams, 200);
+    }
+    if (ret == 0) {
+        ret = datagram_queue_run(test_ctx, &dg_ctx, &simulated_time);
+    }
+    if (ret == 0) {
+        picoquic_get_datagram_queue_stats(test_ctx->cnx_client, &stats);
+        if (stats.nb_queued != 200 || stats.nb_overflow != 136 || stats.nb_sent != 64 ||
+            stats.nb_expired != 0 || stats.nb_waiting != 0 || dg_ctx.dg_recv[0] != 64) {
+            DBG_PRINTF("Queued %" PRIu64 ", overflow %" PRIu64 ", sent %" PRIu64 ", received %d",
+                stats.nb_queued, stats.nb_overflow, stats.nb_sent, dg_ctx.dg_recv[0]);
+            ret = -1;
+        }
+    }
+
+    /* Queue datagrams with a TTL shorter than the time needed to send them all */
+    if (ret == 0) {
+        for (int i = 0; ret == 0 && i < 64; i++) {
+            ret = picoquic_queue_datagram_frame_ex(test_ctx->cnx_client, sizeof(payload), payload, 20000);
+        }
+    }
+    if (ret == 0) {
+        ret = datagram_queue_run(test_ctx, &dg_ctx, &simulated_time);
+    }
+    if (ret == 0) {
+        picoquic_get_datagram_queue_stats(test_ctx->cnx_client, &stats);
+        if (stats.nb_queued != 264 || stats.nb_expired == 0 || stats.nb_waiting != 0 ||
+            stats.nb_sent + stats.nb_expired + stats.nb_overflow != stats.nb_queued ||
+            (uint64_t)dg_ctx.dg_recv[0] != stats.nb_sent || stats.queue_delay_max == 0) {
+            DBG_PRINTF("Queued %" PRIu64 ", expired %" PRIu64 ", sent %" PRIu64 ", received %d",
+                stats.nb_queued, stats.nb_expired, stats.nb_sent, dg_ctx.dg_recv[0]);
+            ret = -1;
+        }
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
@@ -537,6 +537,189 @@ int qpack_huffman_base_test()
 }
 
 
+/* Header values typical of browser requests and server responses,
+ * used to test the Huffman encoder and to benchmark the decoders.
+ */
+static char const* qpack_huffman_corpus[] = {
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36",
+    "Mozilla/5.0 (iPhone; CPU iPhone OS 17_1 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.1 Mobile/15E148 Safari/604.1",
+    "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8",
+    "gzip, deflate, br",
+    "en-US,en;q=0.9,fr;q=0.8",
+    "www.example.com",
+    "/static/js/main.4f3c2a1b.chunk.js",
+    "/api/v2/users/1234567/notifications?limit=50&since=1700000000",
+    "Mon, 21 Oct 2024 07:28:00 GMT",
+    "max-age=31536000, immutable",
+    "\"33a64df551425fcc55e4d42a148795d9f25f89d4\"",
+    "session_id=8f2b1c3d4e5f6a7b; theme=dark; _ga=GA1.2.1234567890.1700000000",
+    "https://www.example.com/index.html?ref=home",
+    "application/json; charset=utf-8",
+    "bytes=0-1048575",
+    "h3=\":443\"; ma=86400",
+    "no-cache",
+    "picoquic-h3zero/1.0",
+    "{\"id\":[1,2,3],\"tag\":\"<none>\"}\\~^`|"
+};
+
+static const size_t nb_qpack_huffman_corpus = sizeof(qpack_huffman_corpus) / sizeof(char const*);
+
+static int qpack_huffman_round_trip(uint8_t const* val, size_t val_length)
+{
+    int ret = 0;
+    uint8_t encoded[1024];
+    uint8_t decoded[1024];
+    uint8_t decoded_by_bit[1024];
+    size_t nb_decoded = 0;
+    size_t nb_decoded_by_bit = 0;
+    uint8_t* encoded_last = h3zero_qpack_huffman_encode(encoded, encoded + sizeof(encoded), val, val_length);
+
+    if (encoded_last == NULL || (size_t)(encoded_last - encoded) != h3zero_qpack_huffman_length(val, val_length)) {
+        DBG_PRINTF("Huffman encoding of %zu bytes fails", val_length);
+        ret = -1;
+    }
+    else if (hzero_qpack_huffman_decode(encoded, encoded_last, decoded, sizeof(decoded), &nb_decoded) != 0 ||
+        nb_decoded != val_length || memcmp(decoded, val, val_length) != 0) {
+        DBG_PRINTF("Huffman table decoding of %zu bytes fails", val_length);
+        ret = -1;
+    }
+    else if (hzero_qpack_huffman_decode_by_bit(encoded, encoded_last, decoded_by_bit, sizeof(decoded_by_bit), &nb_decoded_by_bit) != 0 ||
+        nb_decoded_by_bit != val_length || memcmp(decoded_by_bit, val, val_length) != 0) {
+        DBG_PRINTF("Huffman bit decoding of %zu bytes fails", val_length);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int qpack_huffman_encode_test()
+{
+    int ret = 0;
+    uint8_t all_values[256];
+    uint8_t buffer[256];
+    uint8_t* bytes;
+    size_t nb_data = 0;
+
+    /* Test vectors of the decoding test */
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_test_case; i++) {
+        bytes = h3zero_qpack_huffman_encode(buffer, buffer + sizeof(buffer),
+            qpack_huffman_test_case[i].result, qpack_huffman_test_case[i].result_size);
+        if (bytes == NULL || (size_t)(bytes - buffer) != qpack_huffman_test_case[i].test_size ||
+            memcmp(buffer, qpack_huffman_test_case[i].test, qpack_huffman_test_case[i].test_size) != 0) {
+            DBG_PRINTF("Huffman encoding test %d does not match", (int)i);
+            ret = -1;
+        }
+    }
+
+    /* All octet values, including those with codes longer than the lookup table */
+    for (int i = 0; i < 256; i++) {
+        all_values[i] = (uint8_t)i;
+    }
+    if (ret == 0) {
+        ret = qpack_huffman_round_trip(all_values, sizeof(all_values));
+    }
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_corpus; i++) {
+        ret = qpack_huffman_round_trip((uint8_t const*)qpack_huffman_corpus[i], strlen(qpack_huffman_corpus[i]));
+    }
+
+    /* Output too short, or padding that is not all ones */
+    if (ret == 0) {
+        bytes = h3zero_qpack_huffman_encode(buffer, buffer + sizeof(buffer), (uint8_t const*)"www.example.com", 15);
+        if (bytes == NULL || hzero_qpack_huffman_decode(buffer, bytes, all_values, 14, &nb_data) == 0) {
+            DBG_PRINTF("%s", "Huffman decoding overflow not detected");
+            ret = -1;
+        }
+        else {
+            bytes[-1] &= 0xFE;
+            if (hzero_qpack_huffman_decode(buffer, bytes, all_values, sizeof(all_values), &nb_data) == 0) {
+                DBG_PRINTF("%s", "Huffman bad padding not detected");
+                ret = -1;
+            }
+        }
+    }
+
+    /* Literal names and values are Huffman encoded when shorter */
+    if (ret == 0) {
+        h3zero_header_parts_t parts;
+        uint8_t* parsed;
+
+        memset(&parts, 0, sizeof(parts));
+        bytes = h3zero_create_connect_header_frame(buffer, buffer + sizeof(buffer), "example.com",
+            (uint8_t const*)"/wt", 3, "webtransport", NULL, NULL);
+        if (bytes == NULL || (parsed = h3zero_parse_qpack_header_frame(buffer, bytes, &parts)) != bytes) {
+            DBG_PRINTF("%s", "Cannot parse connect frame with Huffman literals");
+            ret = -1;
+        }
+        else if (parts.protocol_length != 12 || memcmp(parts.protocol, "webtransport", 12) != 0) {
+            DBG_PRINTF("%s", "Huffman encoded protocol does not match");
+            ret = -1;
+        }
+        h3zero_release_header_parts(&parts);
+    }
+
+    return ret;
+}
+
+/* Compare the table driven decoder to the bit by bit decoder on the
+ * header corpus. The table driven decoder should be several times faster.
+ */
+#define QPACK_HUFFMAN_BENCH_ROUNDS 2000
+
+int qpack_huffman_bench_test()
+{
+    int ret = 0;
+    uint8_t encoded[32][256];
+    uint8_t* encoded_last[32];
+    uint8_t decoded[512];
+    size_t nb_decoded;
+    size_t nb_bytes = 0;
+    size_t nb_encoded_bytes = 0;
+    uint64_t table_time = 0;
+    uint64_t bit_time = 0;
+
+    for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_corpus; i++) {
+        size_t length = strlen(qpack_huffman_corpus[i]);
+        encoded_last[i] = h3zero_qpack_huffman_encode(encoded[i], encoded[i] + sizeof(encoded[i]),
+            (uint8_t const*)qpack_huffman_corpus[i], length);
+        if (encoded_last[i] == NULL) {
+            ret = -1;
+        }
+        else {
+            nb_bytes += length;
+            nb_encoded_bytes += encoded_last[i] - encoded[i];
+        }
+    }
+
+    for (int pass = 0; ret == 0 && pass < 2; pass++) {
+        uint64_t start_time = picoquic_current_time();
+
+        for (int r = 0; ret == 0 && r < QPACK_HUFFMAN_BENCH_ROUNDS; r++) {
+            for (size_t i = 0; ret == 0 && i < nb_qpack_huffman_corpus; i++) {
+                ret = (pass == 0) ?
+                    hzero_qpack_huffman_decode(encoded[i], encoded_last[i], decoded, sizeof(decoded), &nb_decoded) :
+                    hzero_qpack_huffman_decode_by_bit(encoded[i], encoded_last[i], decoded, sizeof(decoded), &nb_decoded);
+            }
+        }
+        if (pass == 0) {
+            table_time = picoquic_current_time() - start_time;
+        }
+        else {
+            bit_time = picoquic_current_time() - start_time;
+        }
+    }
+
+    if (ret == 0) {
+        double total_bytes = (double)nb_bytes * QPACK_HUFFMAN_BENCH_ROUNDS;
+        DBG_PRINTF("Huffman corpus %zu bytes encoded in %zu, table decode %.2f ns/byte, bit decode %.2f ns/byte",
+            nb_bytes, nb_encoded_bytes, (1000.0 * (double)table_time) / total_bytes, (1000.0 * (double)bit_time) / total_bytes);
+    }
+    else {
+        DBG_PRINTF("%s", "Huffman bench decoding fails");
+    }
+
+    return ret;
+}
+
 #define QPACK_HUFFMAN_TXT "qpack_huffman.txt"
 
 /* Test decoding of basic QPACK messages */
@@ -553,10 +736,12 @@ int qpack_huffman_base_test()
 #define QPACK_TEST_HEADER_STATUS_LEN 7
 #define QPACK_TEST_HEADER_QPACK_PATH 0xFD, 0xFD, 0xFD 
 #define QPACK_TEST_HEADER_DEQPACK_PATH 'Z', 'Z', 'Z'
-#define QPACK_TEST_HEADER_HOST 0x50, 0x0b, 'e', 'x', 'a', 'm', 'p', 'l', 'e', '.', 'c', 'o', 'm'
+/* Authority "example.com", Huffman encoded */
+#define QPACK_TEST_HEADER_HOST 0x50, 0x80 | 8, 0x2f, 0x91, 0xd3, 0x5d, 0x05, 0x5c, 0x87, 0xa7
 #define QPACK_TEST_HEADER_ALLOW_GET_POST 
-#define QPACK_TEST_ALLOWED_METHODS 'G', 'E', 'T', ',', ' ', 'P', 'O', 'S', 'T', ',', ' ', 'C', 'O', 'N', 'N', 'E', 'C', 'T'
-#define QPACK_TEST_ALLOWED_METHODS_LEN 18
+/* "GET, POST, CONNECT", Huffman encoded */
+#define QPACK_TEST_ALLOWED_METHODS 0xc5, 0x83, 0x7f, 0xd2, 0x9a, 0xf5, 0x6e, 0xdf, 0xf4, 0xa5, 0xed, 0x5a, 0x74, 0xe0, 0xbd, 0xbf
+#define QPACK_TEST_ALLOWED_METHODS_LEN (0x80 | 16)
 #define QPACK_TEST_VALUE_RANGE10 'b', 'y', 't', 'e', 's', '=', '1', '-', '1', '0'
 #define QPACK_TEST_VALUE_RANGE10_LEN 10
 static uint8_t qpack_test_get_slash[] = {
@@ -959,10 +1144,12 @@ int h3zero_prepare_qpack_test()
 /* Check that the user agent string is correctly set.
  */
 
-#define QPACK_TEST_UA_STRING 'H', '3', 'Z', 'e', 'r', 'o', '/', '1', '.', '0'
-#define QPACK_TEST_UA_STRING_LEN 10
 #define QPACK_TEST_UA_STRING_TEST 'T', 'e', 's', 't', '/', '1', '.', '0'
-#define QPACK_TEST_UA_STRING_TEST_LEN 8
+/* "H3Zero/1.0" and "Test/1.0", Huffman encoded */
+#define QPACK_TEST_UA_STRING_HUFFMAN 0xc6, 0xcf, 0xe9, 0x6c, 0x3b, 0x01, 0x5c, 0x1f
+#define QPACK_TEST_UA_STRING_HUFFMAN_LEN (0x80 | 8)
+#define QPACK_TEST_UA_STRING_TEST_HUFFMAN 0xde, 0x54, 0x25, 0x80, 0xae, 0x0f
+#define QPACK_TEST_UA_STRING_TEST_HUFFMAN_LEN (0x80 | 6)
 char const h3zero_test_ua_string[] = { QPACK_TEST_UA_STRING_TEST, 0 };
 char const h3zero_test_ua_post_path[] = { QPACK_TEST_HEADER_DEQPACK_PATH, 0 };
 
@@ -970,42 +1157,42 @@ static uint8_t qpack_test_get_slash_ua[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 17, 0xC0 | 23,
     0x51, 1, '/',
     QPACK_TEST_HEADER_HOST,
-    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_LEN, QPACK_TEST_UA_STRING
+    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_HUFFMAN_LEN, QPACK_TEST_UA_STRING_HUFFMAN
 };
 static uint8_t qpack_test_post_zzz_ua[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 20, 0xC0 | 23,
     0x50 | 1, 3, QPACK_TEST_HEADER_DEQPACK_PATH,
     QPACK_TEST_HEADER_HOST,
-    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_LEN, QPACK_TEST_UA_STRING, 0xF5
+    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_HUFFMAN_LEN, QPACK_TEST_UA_STRING_HUFFMAN, 0xF5
 };
 static uint8_t qpack_test_status_404_srv[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 27,
-    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_LEN, QPACK_TEST_UA_STRING
+    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_HUFFMAN_LEN, QPACK_TEST_UA_STRING_HUFFMAN
 };
 static uint8_t qpack_test_status_405_srv[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0x50 | 0x0F,  H3ZERO_QPACK_CODE_404 - 0x0F, 3, '4', '0', '5',
-    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_LEN, QPACK_TEST_UA_STRING,
+    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_HUFFMAN_LEN, QPACK_TEST_UA_STRING_HUFFMAN,
     0x50 | 0x0F, H3ZERO_QPACK_ALLOW_GET - 0x0F,
     QPACK_TEST_ALLOWED_METHODS_LEN, QPACK_TEST_ALLOWED_METHODS };
 static uint8_t qpack_test_get_slash_ua2[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 17, 0xC0 | 23,
     0x51, 1, '/',
     QPACK_TEST_HEADER_HOST,
-    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_TEST_LEN, QPACK_TEST_UA_STRING_TEST
+    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_TEST_HUFFMAN_LEN, QPACK_TEST_UA_STRING_TEST_HUFFMAN
 };
 static uint8_t qpack_test_post_zzz_ua2[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 20, 0xC0 | 23,
     0x50 | 1, 3, QPACK_TEST_HEADER_DEQPACK_PATH,
     QPACK_TEST_HEADER_HOST,
-    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_TEST_LEN, QPACK_TEST_UA_STRING_TEST, 0xF5
+    0x5f, 95 - 0x0f, QPACK_TEST_UA_STRING_TEST_HUFFMAN_LEN, QPACK_TEST_UA_STRING_TEST_HUFFMAN, 0xF5
 };
 static uint8_t qpack_test_status_404_srv2[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0xC0 | 27,
-    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_TEST_LEN, QPACK_TEST_UA_STRING_TEST
+    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_TEST_HUFFMAN_LEN, QPACK_TEST_UA_STRING_TEST_HUFFMAN
 };
 static uint8_t qpack_test_status_405_srv2[] = {
     QPACK_TEST_HEADER_BLOCK_PREFIX, 0x50 | 0x0F, H3ZERO_QPACK_CODE_404 - 0x0F, 3, '4', '0', '5',
-    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_TEST_LEN, QPACK_TEST_UA_STRING_TEST,
+    0x5f, 92 - 0x0f, QPACK_TEST_UA_STRING_TEST_HUFFMAN_LEN, QPACK_TEST_UA_STRING_TEST_HUFFMAN,
     0x50 | 0x0F, H3ZERO_QPACK_ALLOW_GET - 0x0F,
     QPACK_TEST_ALLOWED_METHODS_LEN, QPACK_TEST_ALLOWED_METHODS };
 
@@ -1775,10 +1962,10 @@ static size_t const demo_test_stream_length[] = {
     190
 };
 
-static int demo_server_test(char const * alpn, picoquic_stream_data_cb_fn server_callback_fn, void * server_param,
+static int demo_server_test_ex(char const * alpn, picoquic_stream_data_cb_fn server_callback_fn, void * server_param,
     const picoquic_demo_stream_desc_t * demo_scenario, size_t nb_scenario, size_t const * demo_length,
     int do_sat, uint64_t do_losses, uint64_t completion_target, int delay_fin, const char * out_dir, const char * client_bin,
-    const char * server_bin, int do_preemptive_repeat)
+    const char * server_bin, int do_preemptive_repeat, h3zero_file_reader_t * file_reader)
 {
     uint64_t simulated_time = 0;
     uint64_t loss_mask = do_losses;
@@ -1878,6 +2065,14 @@ static int demo_server_test(char const * alpn, picoquic_stream_data_cb_fn server
     /* Simulate the connection from the client side. */
     time_out = simulated_time + 30000000;
     while (ret == 0 && picoquic_get_cnx_state(test_ctx->cnx_client) != picoquic_state_disconnected) {
+        if (file_reader != NULL) {
+            /* The simulation does not wait for the worker threads, so wait here if a stream needs data */
+            if (h3zero_file_reader_nb_waiting(file_reader) > 0) {
+                (void)h3zero_file_reader_wait(file_reader, 10000);
+            }
+            (void)h3zero_file_reader_poll(file_reader);
+        }
+
         ret = tls_api_one_sim_round(test_ctx, &simulated_time, time_out, &was_active);
 
         if (ret == -1) {
@@ -1952,6 +2147,15 @@ static int demo_server_test(char const * alpn, picoquic_stream_data_cb_fn server
     return ret;
 }
 
+static int demo_server_test(char const * alpn, picoquic_stream_data_cb_fn server_callback_fn, void * server_param,
+    const picoquic_demo_stream_desc_t * demo_scenario, size_t nb_scenario, size_t const * demo_length,
+    int do_sat, uint64_t do_losses, uint64_t completion_target, int delay_fin, const char * out_dir, const char * client_bin,
+    const char * server_bin, int do_preemptive_repeat)
+{
+    return demo_server_test_ex(alpn, server_callback_fn, server_param, demo_scenario, nb_scenario, demo_length,
+        do_sat, do_losses, completion_target, delay_fin, out_dir, client_bin, server_bin, do_preemptive_repeat, NULL);
+}
+
 int h3zero_server_test()
 {
     return demo_server_test(PICOHTTP_ALPN_H3_LATEST, h3zero_callback, NULL, 
@@ -2554,6 +2758,435 @@ int demo_server_file_test()
     return ret;
 }
 
+/* Serve the test file through the asynchronous file reader, using small
+ * chunks and a short prefetch window so that the streams have to wait
+ * several times for the worker threads. */
+int h3zero_async_file_test()
+{
+    int ret = 0;
+    char file_name_buffer[1024];
+    picohttp_server_parameters_t file_param;
+
+    ret = serve_file_test_set_param(&file_param, file_name_buffer, sizeof(file_name_buffer));
+
+    if (ret == 0 && (file_param.file_reader = h3zero_file_reader_create(2, 1000, 2)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the file reader\n");
+        ret = -1;
+    }
+
+    if (ret == 0 && (ret = demo_server_test_ex(PICOHTTP_ALPN_H3_LATEST, h3zero_callback, (void*)&file_param,
+        file_test_scenario, nb_file_test_scenario, demo_file_test_stream_length, 0, 0, 0, 0, NULL, NULL, NULL, 0,
+        file_param.file_reader)) != 0) {
+        DBG_PRINTF("H3 server (%s) async file test fails, ret = %d\n", PICOHTTP_ALPN_H3_LATEST, ret);
+    }
+    else if (ret == 0) {
+        ret = file_test_compare(&file_param, &file_test_scenario[0]);
+    }
+
+    if (ret == 0 && (ret = demo_server_test_ex(PICOHTTP_ALPN_H3_LATEST, picoquic_demo_server_callback, (void*)&file_param,
+        file_test_scenario, nb_file_test_scenario, demo_file_test_stream_length, 0, 0x7080, 0, 0, NULL, NULL, NULL, 0,
+        file_param.file_reader)) != 0) {
+        DBG_PRINTF("Demo server (%s) async file test with losses fails, ret = %d\n", PICOHTTP_ALPN_H3_LATEST, ret);
+    }
+    else if (ret == 0) {
+        ret = file_test_compare(&file_param, &file_test_scenario[0]);
+    }
+
+    if (ret == 0 && h3zero_file_reader_nb_waiting(file_param.file_reader) != 0) {
+        DBG_PRINTF("%s", "Streams still waiting for the file reader\n");
+        ret = -1;
+    }
+
+    /* With a content cache, the first request is served by the reader, whose
+     * workers map the file in the cache. The second request is served from
+     * the cache. */
+    if (ret == 0 && (file_param.content_cache = h3zero_content_cache_create(0)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the content cache\n");
+        ret = -1;
+    }
+
+    for (int pass = 0; ret == 0 && pass < 2; pass++) {
+        h3zero_content_cache_stats_t stats;
+
+        if ((ret = demo_server_test_ex(PICOHTTP_ALPN_H3_LATEST, h3zero_callback, (void*)&file_param,
+            file_test_scenario, nb_file_test_scenario, demo_file_test_stream_length, 0, 0, 0, 0, NULL, NULL, NULL, 0,
+            file_param.file_reader)) != 0) {
+            DBG_PRINTF("H3 server (%s) async file test with cache fails, pass %d, ret = %d\n", PICOHTTP_ALPN_H3_LATEST, pass, ret);
+        }
+        else if ((ret = file_test_compare(&file_param, &file_test_scenario[0])) == 0) {
+            for (int i = 0; i < 100; i++) {
+                (void)h3zero_file_reader_poll(file_param.file_reader);
+                h3zero_content_cache_get_stats(file_param.content_cache, &stats);
+                if (stats.nb_entries > 0) {
+                    break;
+                }
+                (void)h3zero_file_reader_wait(file_param.file_reader, 10000);
+            }
+            if (stats.nb_entries != 1 || stats.nb_misses != 1 || stats.nb_hits != (uint64_t)pass) {
+                DBG_PRINTF("Unexpected cache use, pass %d, misses %" PRIu64 ", hits %" PRIu64 ", entries %" PRIu64,
+                    pass, stats.nb_misses, stats.nb_hits, stats.nb_entries);
+                ret = -1;
+            }
+        }
+    }
+
+    if (file_param.file_reader != NULL) {
+        h3zero_file_reader_delete(file_param.file_reader);
+    }
+    if (file_param.content_cache != NULL) {
+        h3zero_content_cache_delete(file_param.content_cache);
+    }
+
+    return ret;
+}
+
+/* Serve the test file from the content cache, first with h3 and then
+ * with h09, and verify that the second request is served from the cached
+ * mapping. Then verify that the LRU bound evicts the unused entries. */
+static int h3zero_content_cache_lru_test(const char * web_folder)
+{
+    int ret = 0;
+    char path_a[1024];
+    char path_b[1024];
+    size_t l;
+    h3zero_content_cache_t* cache = NULL;
+    h3zero_content_t* content_a = NULL;
+    h3zero_content_t* content_b = NULL;
+    h3zero_content_cache_stats_t stats;
+
+    if (picoquic_sprintf(path_a, sizeof(path_a), &l, "%s%s%s", web_folder, PICOQUIC_FILE_SEPARATOR, "file_test_ref.txt") != 0 ||
+        picoquic_sprintf(path_b, sizeof(path_b), &l, "%s%s%s", web_folder, PICOQUIC_FILE_SEPARATOR, "config_usage_ref.txt") != 0) {
+        ret = -1;
+    }
+    else if ((cache = h3zero_content_cache_create(12000)) == NULL) {
+        ret = -1;
+    }
+    else if ((content_a = h3zero_content_cache_get(cache, path_a)) == NULL) {
+        DBG_PRINTF("Cannot load %s", path_a);
+        ret = -1;
+    }
+    else {
+        h3zero_content_release(content_a);
+        if (h3zero_content_cache_peek(cache, path_a) != content_a) {
+            DBG_PRINTF("%s", "Released content should stay in the cache\n");
+            ret = -1;
+        }
+        else if ((content_b = h3zero_content_cache_get(cache, path_b)) == NULL) {
+            DBG_PRINTF("Cannot load %s", path_b);
+            ret = -1;
+        }
+        else {
+            /* Verify that the mapped bytes match the file content */
+            FILE* F = picoquic_file_open(path_b, "rb");
+            uint64_t length = h3zero_content_length(content_b);
+            uint8_t* buffer = (uint8_t*)malloc((size_t)length + 1);
+
+            if (F == NULL || buffer == NULL || fread(buffer, 1, (size_t)length + 1, F) != length ||
+                memcmp(buffer, h3zero_content_bytes(content_b), (size_t)length) != 0) {
+                DBG_PRINTF("%s", "Cached bytes do not match the file\n");
+                ret = -1;
+            }
+            if (F != NULL) {
+                (void)picoquic_file_close(F);
+            }
+            if (buffer != NULL) {
+                free(buffer);
+            }
+            h3zero_content_buffer_release(content_b, NULL, 0, 1);
+        }
+    }
+
+    if (ret == 0) {
+        h3zero_content_cache_get_stats(cache, &stats);
+        if (stats.nb_misses != 2 || stats.nb_evicted != 1 || stats.nb_entries != 1 ||
+            h3zero_content_cache_peek(cache, path_a) != NULL || h3zero_content_cache_peek(cache, path_b) != content_b) {
+            DBG_PRINTF("Unexpected LRU state, misses %" PRIu64 ", evicted %" PRIu64 ", entries %" PRIu64,
+                stats.nb_misses, stats.nb_evicted, stats.nb_entries);
+            ret = -1;
+        }
+    }
+
+    if (cache != NULL) {
+        h3zero_content_cache_delete(cache);
+    }
+
+    return ret;
+}
+
+int h3zero_content_cache_test()
+{
+    int ret = 0;
+    char file_name_buffer[1024];
+    picohttp_server_parameters_t file_param;
+    h3zero_content_cache_stats_t stats;
+
+    ret = serve_file_test_set_param(&file_param, file_name_buffer, sizeof(file_name_buffer));
+
+    if (ret == 0 && (file_param.content_cache = h3zero_content_cache_create(0)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the content cache\n");
+        ret = -1;
+    }
+
+    if (ret == 0 && (ret = demo_server_test(PICOHTTP_ALPN_H3_LATEST, h3zero_callback, (void*)&file_param,
+        file_test_scenario, nb_file_test_scenario, demo_file_test_stream_length, 0, 0x7080, 0, 0, NULL, NULL, NULL, 0)) != 0) {
+        DBG_PRINTF("H3 server (%s) content cache test fails, ret = %d\n", PICOHTTP_ALPN_H3_LATEST, ret);
+    }
+    else if (ret == 0) {
+        ret = file_test_compare(&file_param, &file_test_scenario[0]);
+    }
+
+    if (ret == 0 && (ret = demo_server_test(PICOHTTP_ALPN_HQ_LATEST, picoquic_h09_server_callback, (void*)&file_param,
+        file_test_scenario, nb_file_test_scenario, demo_file_test_stream_length, 0, 0, 0, 0, NULL, NULL, NULL, 0)) != 0) {
+        DBG_PRINTF("H09 server (%s) content cache test fails, ret = %d\n", PICOHTTP_ALPN_HQ_LATEST, ret);
+    }
+    else if (ret == 0) {
+        ret = file_test_compare(&file_param, &file_test_scenario[0]);
+    }
+
+    if (ret == 0) {
+        h3zero_content_cache_get_stats(file_param.content_cache, &stats);
+        if (stats.nb_misses != 1 || stats.nb_hits != 1 || stats.nb_entries != 1) {
+            DBG_PRINTF("Unexpected cache use, misses %" PRIu64 ", hits %" PRIu64 ", entries %" PRIu64,
+                stats.nb_misses, stats.nb_hits, stats.nb_entries);
+            ret = -1;
+        }
+    }
+
+    if (file_param.content_cache != NULL) {
+        h3zero_content_cache_delete(file_param.content_cache);
+    }
+
+    if (ret == 0) {
+        ret = h3zero_content_cache_lru_test(file_param.web_folder);
+    }
+
+    return ret;
+}
+
+/* Exchange of header blocks between a QPACK encoder and a QPACK decoder.
+ * The first request inserts the authority and user agent in the dynamic
+ * table, and is blocked until the decoder receives the encoder instructions.
+ * The next requests reference the acknowledged entries, and are decoded
+ * immediately. The decoded headers must match those decoded from the
+ * static encoding.
+ */
+static int h3zero_qpack_exchange_one(h3zero_qpack_ctx_t* encoder, h3zero_qpack_ctx_t* decoder,
+    uint64_t stream_id, char const* path, int expect_blocked, size_t* encoded_length, size_t* static_length)
+{
+    int ret = 0;
+    uint8_t static_block[512];
+    uint8_t encoded_block[512];
+    uint8_t* static_last;
+    uint8_t* encoded_last = NULL;
+    uint8_t* decoded_last;
+    h3zero_header_parts_t expected;
+    h3zero_header_parts_t parts;
+    uint64_t error_found = 0;
+    int is_blocked = 0;
+
+    memset(&expected, 0, sizeof(expected));
+    memset(&parts, 0, sizeof(parts));
+
+    static_last = h3zero_create_request_header_frame_ex(static_block, static_block + sizeof(static_block),
+        (uint8_t const*)path, strlen(path), NULL, 0, "example.com", "qpack-test-agent/1.0");
+    if (static_last == NULL ||
+        h3zero_parse_qpack_header_frame(static_block, static_last, &expected) != static_last) {
+        DBG_PRINTF("Cannot prepare static header block for %s", path);
+        ret = -1;
+    }
+    else if ((encoded_last = h3zero_qpack_encode_header_block(encoder, stream_id, static_block, static_last,
+        encoded_block, encoded_block + sizeof(encoded_block))) == NULL) {
+        DBG_PRINTF("Cannot encode header block for %s", path);
+        ret = -1;
+    }
+    else {
+        *static_length = static_last - static_block;
+        *encoded_length = encoded_last - encoded_block;
+        decoded_last = h3zero_qpack_decode_header_block(decoder, stream_id, encoded_block, encoded_last,
+            &parts, &is_blocked, &error_found);
+        if (decoded_last == NULL || is_blocked != expect_blocked) {
+            DBG_PRINTF("Decode %s, blocked: %d vs %d, error 0x%" PRIx64, path, is_blocked, expect_blocked, error_found);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        /* Deliver the encoder instructions, which may unblock the stream */
+        if (encoder->encoder_instructions.length > 0) {
+            ret = h3zero_qpack_encoder_stream_input(decoder, encoder->encoder_instructions.bytes,
+                encoder->encoder_instructions.length, &error_found);
+            encoder->encoder_instructions.length = 0;
+        }
+        if (ret == 0 && is_blocked) {
+            if (h3zero_qpack_get_unblocked_stream(decoder) != stream_id) {
+                DBG_PRINTF("Stream %" PRIu64 " not unblocked", stream_id);
+                ret = -1;
+            }
+            else if (h3zero_qpack_decode_header_block(decoder, stream_id, encoded_block, encoded_last,
+                &parts, &is_blocked, &error_found) != encoded_last || is_blocked) {
+                DBG_PRINTF("Cannot decode unblocked stream %" PRIu64 ", error 0x%" PRIx64, stream_id, error_found);
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        /* Deliver the acknowledgements */
+        if (decoder->decoder_instructions.length > 0) {
+            ret = h3zero_qpack_decoder_stream_input(encoder, decoder->decoder_instructions.bytes,
+                decoder->decoder_instructions.length, &error_found);
+            decoder->decoder_instructions.length = 0;
+        }
+        if (ret == 0 && (encoder->first_section != NULL ||
+            encoder->known_received_count != encoder->encoder_table.insert_count)) {
+            DBG_PRINTF("Sections not acknowledged after %s", path);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && (parts.method != expected.method ||
+        parts.path_length != expected.path_length ||
+        memcmp(parts.path, expected.path, parts.path_length) != 0)) {
+        DBG_PRINTF("Decoded headers do not match for %s", path);
+        ret = -1;
+    }
+
+    h3zero_release_header_parts(&expected);
+    h3zero_release_header_parts(&parts);
+
+    return ret;
+}
+
+/* Clients that do not resume blocked streams announce zero blocked streams.
+ * The encoder must then only reference acknowledged entries, and the
+ * compressed blocks must be decoded without blocking.
+ */
+static int h3zero_qpack_no_blocking_test()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    uint64_t error_found = 0;
+
+    if (h3zero_qpack_init(&encoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT) != 0 ||
+        h3zero_qpack_init(&decoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, 0) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, 0) != 0) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (int i = 0; ret == 0 && i < 3; i++) {
+        uint8_t block[256];
+        uint8_t* block_last = h3zero_create_response_header_frame_ex(block, block + sizeof(block),
+            h3zero_content_type_text_html, "qpack-test-agent/1.0");
+        size_t static_length = (block_last == NULL) ? 0 : block_last - block;
+        h3zero_header_parts_t parts;
+        int is_blocked = 0;
+
+        memset(&parts, 0, sizeof(parts));
+        if (block_last == NULL) {
+            ret = -1;
+        }
+        else {
+            block_last = h3zero_qpack_compress_header_block(&encoder, 4 * (uint64_t)i, block, block_last, block + sizeof(block));
+            if (h3zero_qpack_decode_header_block(&decoder, 4 * (uint64_t)i, block, block_last,
+                &parts, &is_blocked, &error_found) != block_last || is_blocked || parts.status != 200) {
+                DBG_PRINTF("Cannot decode response %d, blocked: %d", i, is_blocked);
+                ret = -1;
+            }
+            else if ((i == 0 && (size_t)(block_last - block) != static_length) ||
+                (i > 0 && (size_t)(block_last - block) >= static_length)) {
+                DBG_PRINTF("Unexpected length for response %d, %zu vs %zu bytes", i, (size_t)(block_last - block), static_length);
+                ret = -1;
+            }
+        }
+        h3zero_release_header_parts(&parts);
+        /* Deliver the instructions of each side to the other */
+        if (ret == 0 && encoder.encoder_instructions.length > 0) {
+            ret = h3zero_qpack_encoder_stream_input(&decoder, encoder.encoder_instructions.bytes,
+                encoder.encoder_instructions.length, &error_found);
+            encoder.encoder_instructions.length = 0;
+        }
+        if (ret == 0 && decoder.decoder_instructions.length > 0) {
+            ret = h3zero_qpack_decoder_stream_input(&encoder, decoder.decoder_instructions.bytes,
+                decoder.decoder_instructions.length, &error_found);
+            decoder.decoder_instructions.length = 0;
+        }
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    return ret;
+}
+
+int h3zero_qpack_test()
+{
+    int ret = 0;
+    h3zero_qpack_ctx_t encoder;
+    h3zero_qpack_ctx_t decoder;
+    char const* paths[] = { "/", "/index.html", "/10000", "/main.css" };
+    size_t nb_paths = sizeof(paths) / sizeof(char const*);
+    size_t encoded_length = 0;
+    size_t static_length = 0;
+    uint64_t error_found = 0;
+
+    if (h3zero_qpack_init(&encoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT) != 0 ||
+        h3zero_qpack_init(&decoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT) != 0 ||
+        h3zero_qpack_set_peer_settings(&encoder, H3ZERO_QPACK_TABLE_CAPACITY_DEFAULT, H3ZERO_QPACK_BLOCKED_STREAMS_DEFAULT) != 0 ||
+        !encoder.encoder_enabled) {
+        DBG_PRINTF("%s", "Cannot initialize the QPACK contexts");
+        ret = -1;
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_paths; i++) {
+        ret = h3zero_qpack_exchange_one(&encoder, &decoder, 4 * i, paths[i], i == 0, &encoded_length, &static_length);
+        if (ret == 0 && i > 0 && encoded_length + 20 > static_length) {
+            DBG_PRINTF("Block for %s not compressed, %zu vs %zu bytes", paths[i], encoded_length, static_length);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && encoder.nb_dynamic_references != 2 * nb_paths) {
+        DBG_PRINTF("Expected %zu dynamic references, got %" PRIu64, 2 * nb_paths, encoder.nb_dynamic_references);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* A reference to an entry that does not exist must be rejected */
+        uint8_t bad_block[] = { 0x00, 0x00, 0x80 };
+        h3zero_header_parts_t parts;
+        int is_blocked = 0;
+
+        if (h3zero_qpack_decode_header_block(&decoder, 0, bad_block, bad_block + sizeof(bad_block),
+            &parts, &is_blocked, &error_found) != NULL || error_found != H3ZERO_QPACK_DECOMPRESSION_FAILED) {
+            DBG_PRINTF("%s", "Invalid reference not detected");
+            ret = -1;
+        }
+        h3zero_release_header_parts(&parts);
+    }
+
+    if (ret == 0) {
+        /* Setting a capacity above the announced maximum is an encoder stream error */
+        uint8_t bad_instruction[] = { 0x3f, 0xe2, 0x1f };
+
+        if (h3zero_qpack_encoder_stream_input(&decoder, bad_instruction, sizeof(bad_instruction), &error_found) == 0 ||
+            error_found != H3ZERO_QPACK_ENCODER_STREAM_ERROR) {
+            DBG_PRINTF("%s", "Invalid capacity not detected");
+            ret = -1;
+        }
+    }
+
+    h3zero_qpack_release(&encoder);
+    h3zero_qpack_release(&decoder);
+
+    if (ret == 0) {
+        ret = h3zero_qpack_no_blocking_test();
+    }
+
+    return ret;
+}
+
 static const picoquic_demo_stream_desc_t satellite_test_scenario[] = {
     { 0, 0, PICOQUIC_DEMO_STREAM_ID_INITIAL, "/10000000", "bin10M.txt", 0 }
 };
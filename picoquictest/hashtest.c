@@ -69,14 +69,26 @@ static struct hashtestkey* hashtest_item(uint64_t x)
     return p;
 }
 
-int picohash_test_one(int embedded_item)
+static size_t hashtest_key_inline(const void* key, uint8_t* inline_key)
+{
+    const struct hashtestkey* k = (const struct hashtestkey*)key;
+
+    memcpy(inline_key, &k->x, sizeof(k->x));
+    return sizeof(k->x);
+}
+
+int picohash_test_one(int embedded_item, int open_table)
 {
     /* Create a hash table */
     int ret = 0;
     picohash_table* t = NULL;
     uint8_t hash_seed[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
     
-    if (!embedded_item) {
+    if (open_table) {
+        t = picohash_create_open(32, hashtest_hash, hashtest_compare, (embedded_item) ? hashtest_key_to_item : NULL,
+            (embedded_item) ? hashtest_key_inline : NULL, hash_seed);
+    }
+    else if (!embedded_item) {
         t = picohash_create(32, hashtest_hash, hashtest_compare);
     }
     else {
@@ -196,12 +208,238 @@ int picohash_test_one(int embedded_item)
 
 int picohash_test()
 {
-    return(picohash_test_one(0));
+    return(picohash_test_one(0, 0));
 }
 
 int picohash_embedded_test()
 {
-    return(picohash_test_one(1));
+    return(picohash_test_one(1, 0));
+}
+
+/* Test the open addressing tables, including the incremental resizing.
+ * The table starts with 16 slots and grows to hold 5000 entries. Entries
+ * are deleted while the migration is in progress, and the remaining ones
+ * are verified after each step.
+ */
+static int picohash_open_check(picohash_table* t, uint64_t nb_inserted, uint64_t nb_deleted)
+{
+    int ret = 0;
+    struct hashtestkey hk;
+
+    if (t->count != nb_inserted - nb_deleted) {
+        DBG_PRINTF("picohash table count != %"PRIu64" (count=%"PRIst")\n", nb_inserted - nb_deleted, t->count);
+        ret = -1;
+    }
+
+    for (uint64_t i = 0; ret == 0 && i < nb_inserted + 16; i++) {
+        picohash_item* pi;
+
+        hk.x = i;
+        pi = picohash_retrieve(t, &hk);
+        if (i < nb_deleted || i >= nb_inserted) {
+            if (pi != NULL) {
+                DBG_PRINTF("picohash_retrieve(%"PRIu64") returned deleted item\n", i);
+                ret = -1;
+            }
+        }
+        else if (pi == NULL || ((struct hashtestkey*)pi->key)->x != i) {
+            DBG_PRINTF("picohash_retrieve(%"PRIu64") failed\n", i);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+int picohash_open_test()
+{
+    int ret = picohash_test_one(0, 1);
+
+    if (ret == 0) {
+        ret = picohash_test_one(1, 1);
+    }
+
+    for (int embedded_item = 0; ret == 0 && embedded_item < 2; embedded_item++) {
+        uint8_t hash_seed[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+        picohash_table* t = picohash_create_open(0, hashtest_hash, hashtest_compare,
+            (embedded_item) ? hashtest_key_to_item : NULL, (embedded_item) ? hashtest_key_inline : NULL, hash_seed);
+        uint64_t nb_inserted = 0;
+        uint64_t nb_deleted = 0;
+
+        if (t == NULL) {
+            DBG_PRINTF("%s", "picohash_create_open() failed\n");
+            ret = -1;
+            break;
+        }
+
+        while (ret == 0 && nb_inserted < 5000) {
+            size_t nb_slots = t->nb_slots;
+
+            if (picohash_insert(t, hashtest_item(nb_inserted)) != 0) {
+                DBG_PRINTF("picohash_insert(%"PRIu64") failed\n", nb_inserted);
+                ret = -1;
+            }
+            else {
+                nb_inserted++;
+                if (t->old_slots != NULL) {
+                    /* Delete the oldest entry while the migration is in progress */
+                    struct hashtestkey hk;
+                    picohash_item* pi;
+
+                    hk.x = nb_deleted;
+                    pi = picohash_retrieve(t, &hk);
+                    if (pi == NULL) {
+                        DBG_PRINTF("picohash_retrieve(%"PRIu64") failed\n", nb_deleted);
+                        ret = -1;
+                    }
+                    else {
+                        picohash_delete_item(t, pi, 1);
+                        nb_deleted++;
+                    }
+                }
+                if (ret == 0 && (t->nb_slots != nb_slots || t->old_slots != NULL || (nb_inserted % 512) == 0)) {
+                    ret = picohash_open_check(t, nb_inserted, nb_deleted);
+                }
+            }
+        }
+
+        if (ret == 0 && (t->nb_slots < 4096 || 4 * t->count > 3 * t->nb_slots)) {
+            DBG_PRINTF("picohash table not resized, %"PRIst" slots for %"PRIst" items\n", t->nb_slots, t->count);
+            ret = -1;
+        }
+
+        picohash_delete(t, 1);
+    }
+
+    return ret;
+}
+
+/* Compare the cost of insertion and lookup in chained tables and in
+ * open addressing tables, for 10K, 100K and 1M connection IDs. The chained
+ * table is sized once, as picoquic_create would for 10,000 connections.
+ * The open table starts small and grows as needed.
+ */
+#define PICOHASH_BENCH_CHAINED_BINS 40000
+
+typedef struct st_picohash_bench_key_t {
+    picoquic_connection_id_t cid;
+    picohash_item chained_item;
+    picohash_item open_item;
+} picohash_bench_key_t;
+
+static uint64_t picohash_bench_hash(const void* key, const uint8_t* hash_seed)
+{
+    return picoquic_connection_id_hash(&((const picohash_bench_key_t*)key)->cid, hash_seed);
+}
+
+static int picohash_bench_compare(const void* key1, const void* key2)
+{
+    return picoquic_compare_connection_id(&((const picohash_bench_key_t*)key1)->cid,
+        &((const picohash_bench_key_t*)key2)->cid);
+}
+
+static picohash_item* picohash_bench_chained_item(const void* key)
+{
+    return &((picohash_bench_key_t*)key)->chained_item;
+}
+
+static picohash_item* picohash_bench_open_item(const void* key)
+{
+    return &((picohash_bench_key_t*)key)->open_item;
+}
+
+static size_t picohash_bench_inline(const void* key, uint8_t* inline_key)
+{
+    const picohash_bench_key_t* k = (const picohash_bench_key_t*)key;
+
+    memcpy(inline_key, k->cid.id, k->cid.id_len);
+    return k->cid.id_len;
+}
+
+static int picohash_bench_one(picohash_table* t, picohash_bench_key_t* keys, size_t nb_keys,
+    uint64_t* insert_time, uint64_t* lookup_time)
+{
+    int ret = 0;
+    uint64_t start_time = picoquic_current_time();
+    uint64_t inserted_time;
+
+    for (size_t i = 0; ret == 0 && i < nb_keys; i++) {
+        if (picohash_insert(t, &keys[i]) != 0) {
+            DBG_PRINTF("picohash_insert(%zu) failed\n", i);
+            ret = -1;
+        }
+    }
+    inserted_time = picoquic_current_time();
+
+    for (size_t i = 0; ret == 0 && i < nb_keys; i++) {
+        /* Look up the keys in a different order than insertion */
+        size_t x = (i * 7919) % nb_keys;
+        picohash_item* item = picohash_retrieve(t, &keys[x]);
+
+        if (item == NULL || item->key != &keys[x]) {
+            DBG_PRINTF("picohash_retrieve(%zu) failed\n", x);
+            ret = -1;
+        }
+    }
+
+    *insert_time = inserted_time - start_time;
+    *lookup_time = picoquic_current_time() - inserted_time;
+
+    return ret;
+}
+
+int picohash_bench_test()
+{
+    int ret = 0;
+    const size_t nb_keys[3] = { 10000, 100000, 1000000 };
+    uint8_t hash_seed[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+    for (size_t n = 0; ret == 0 && n < sizeof(nb_keys) / sizeof(size_t); n++) {
+        picohash_bench_key_t* keys = (picohash_bench_key_t*)calloc(nb_keys[n], sizeof(picohash_bench_key_t));
+        picohash_table* chained = picohash_create_ex(PICOHASH_BENCH_CHAINED_BINS, picohash_bench_hash,
+            picohash_bench_compare, picohash_bench_chained_item, hash_seed);
+        picohash_table* open = picohash_create_open(PICOHASH_BENCH_CHAINED_BINS / 4, picohash_bench_hash,
+            picohash_bench_compare, picohash_bench_open_item, picohash_bench_inline, hash_seed);
+
+        if (keys == NULL || chained == NULL || open == NULL) {
+            DBG_PRINTF("Cannot allocate %zu keys\n", nb_keys[n]);
+            ret = -1;
+        }
+        else {
+            uint64_t chained_insert = 0;
+            uint64_t chained_lookup = 0;
+            uint64_t open_insert = 0;
+            uint64_t open_lookup = 0;
+            uint64_t random_ctx = 0xDEADBEEFCAFEBABEull;
+
+            for (size_t i = 0; i < nb_keys[n]; i++) {
+                keys[i].cid.id_len = 8;
+                picoformat_64(keys[i].cid.id, picoquic_test_random(&random_ctx));
+            }
+
+            ret = picohash_bench_one(chained, keys, nb_keys[n], &chained_insert, &chained_lookup);
+            if (ret == 0) {
+                ret = picohash_bench_one(open, keys, nb_keys[n], &open_insert, &open_lookup);
+            }
+            if (ret == 0) {
+                DBG_PRINTF("%zu CID, chained: insert %.3f us, lookup %.3f us; open: insert %.3f us, lookup %.3f us\n",
+                    nb_keys[n], ((double)chained_insert) / nb_keys[n], ((double)chained_lookup) / nb_keys[n],
+                    ((double)open_insert) / nb_keys[n], ((double)open_lookup) / nb_keys[n]);
+            }
+        }
+
+        if (chained != NULL) {
+            picohash_delete(chained, 0);
+        }
+        if (open != NULL) {
+            picohash_delete(open, 0);
+        }
+        if (keys != NULL) {
+            free(keys);
+        }
+    }
+
+    return ret;
 }
 
 /* Test the behavior of the basic hash
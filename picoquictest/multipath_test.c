@@ -29,6 +29,8 @@
 #include "logreader.h"
 #include "qlog.h"
 #include "picoquic_bbr.h"
+#include "picoquic_coupledcc.h"
+#include "picoquic_newreno.h"
 
 /* Add the additional links for multipath scenario */
 static int multipath_test_add_links(picoquic_test_tls_api_ctx_t* test_ctx, int mtu_drop)
@@ -158,6 +160,33 @@ static void multipath_test_perf_links(picoquic_test_tls_api_ctx_t* test_ctx, int
     }
 }
 
+/* Route the second path through the same links as the first one, so
+ * both paths compete for a single bottleneck. The client accepts packets
+ * for both of its addresses on the shared link.
+ */
+static void multipath_test_shared_links(picoquic_test_tls_api_ctx_t* test_ctx)
+{
+    if (test_ctx->c_to_s_link_2 != NULL) {
+        picoquictest_sim_link_delete(test_ctx->c_to_s_link_2);
+    }
+    if (test_ctx->s_to_c_link_2 != NULL) {
+        picoquictest_sim_link_delete(test_ctx->s_to_c_link_2);
+    }
+    test_ctx->c_to_s_link_2 = test_ctx->c_to_s_link;
+    test_ctx->s_to_c_link_2 = test_ctx->s_to_c_link;
+    test_ctx->client_use_multiple_addresses = 1;
+}
+
+static void multipath_test_unshare_links(picoquic_test_tls_api_ctx_t* test_ctx)
+{
+    if (test_ctx->c_to_s_link_2 == test_ctx->c_to_s_link) {
+        test_ctx->c_to_s_link_2 = NULL;
+    }
+    if (test_ctx->s_to_c_link_2 == test_ctx->s_to_c_link) {
+        test_ctx->s_to_c_link_2 = NULL;
+    }
+}
+
 /* wait until the migration completes */
 int wait_client_migration_done(picoquic_test_tls_api_ctx_t* test_ctx,
     uint64_t* simulated_time)
@@ -453,7 +482,9 @@ typedef enum {
     multipath_test_fail,
     multipath_test_ab1,
     multipath_test_discovery,
-    multipath_test_keep_alive
+    multipath_test_keep_alive,
+    multipath_test_coupled_shared,
+    multipath_test_coupled_disjoint
 } multipath_test_enum_t;
 
 #ifdef _WINDOWS
@@ -745,7 +776,8 @@ int multipath_datagram_send_loop(picoquic_test_tls_api_ctx_t* test_ctx,
     return ret;
 }
 
-int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t test_id)
+int multipath_test_one_ex(uint64_t max_completion_microsec, multipath_test_enum_t test_id,
+    picoquic_congestion_algorithm_t const* cc_algo, uint64_t* bottleneck_drops)
 {
     uint64_t simulated_time = 0;
     uint64_t loss_mask = 0;
@@ -759,7 +791,8 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
 
     initial_cid.id[2] = (int)test_id;
 
-    if (test_id == multipath_test_perf) {
+    if (test_id == multipath_test_perf || test_id == multipath_test_coupled_shared ||
+        test_id == multipath_test_coupled_disjoint) {
         send_buffer_size = 65536;
     }
 
@@ -784,6 +817,10 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
             multipath_test_perf_links(test_ctx, 0);
             picoquic_set_default_congestion_algorithm(test_ctx->qserver, picoquic_bbr_algorithm);
         }
+        else if (test_id == multipath_test_coupled_shared || test_id == multipath_test_coupled_disjoint) {
+            multipath_test_perf_links(test_ctx, 0);
+            picoquic_set_default_congestion_algorithm(test_ctx->qserver, cc_algo);
+        }
         test_ctx->c_to_s_link->queue_delay_max = 2 * test_ctx->c_to_s_link->microsec_latency;
         test_ctx->s_to_c_link->queue_delay_max = 2 * test_ctx->s_to_c_link->microsec_latency;
 
@@ -857,7 +894,8 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
 
     /* Prepare to send data */
     if (ret == 0) {
-        if (test_id == multipath_test_sat_plus || test_id == multipath_test_perf) {
+        if (test_id == multipath_test_sat_plus || test_id == multipath_test_perf ||
+            test_id == multipath_test_coupled_shared || test_id == multipath_test_coupled_disjoint) {
             ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_multipath_long, sizeof(test_scenario_multipath_long));
         } else {
             ret = test_api_init_send_recv_scenario(test_ctx, test_scenario_multipath, sizeof(test_scenario_multipath));
@@ -877,9 +915,13 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
                 /* Simulate an asymmetric "satellite and landline" scenario */
                 multipath_test_sat_links(test_ctx, 1);
             }
-            else if (test_id == multipath_test_perf) {
+            else if (test_id == multipath_test_perf || test_id == multipath_test_coupled_disjoint) {
                 multipath_test_perf_links(test_ctx, 1);
             }
+            else if (test_id == multipath_test_coupled_shared) {
+                /* Both paths go through the same wifi bottleneck */
+                multipath_test_shared_links(test_ctx);
+            }
             else if (test_id == multipath_test_fail) {
                 /* Kill link #1 in server to client direction. This will cause path challenges to fail */
                 multipath_test_kill_server_links(test_ctx, 1);
@@ -1200,8 +1242,37 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
             }
         }
     }
+    /* In the coupled scenarios, verify that the coupled algorithm is used and
+     * that both paths carry data.
+     */
+    if (ret == 0 && (test_id == multipath_test_coupled_shared || test_id == multipath_test_coupled_disjoint)) {
+        if (test_ctx->cnx_server->congestion_alg != cc_algo) {
+            DBG_PRINTF("Server does not use %s.\n", cc_algo->congestion_algorithm_id);
+            ret = -1;
+        }
+        else if (test_ctx->cnx_server->nb_paths != 2) {
+            DBG_PRINTF("Coupled scenario, %d paths on server connection.\n", test_ctx->cnx_server->nb_paths);
+            ret = -1;
+        }
+        else {
+            for (int i = 0; ret == 0 && i < 2; i++) {
+                if (test_ctx->cnx_server->path[i]->delivered < 100000) {
+                    DBG_PRINTF("Not enough data delivered on server path %d (%" PRIu64 ").\n",
+                        i, test_ctx->cnx_server->path[i]->delivered);
+                    ret = -1;
+                }
+            }
+        }
+    }
+
+    /* Report the losses at the server to client bottleneck of the first path */
+    if (bottleneck_drops != NULL && test_ctx != NULL) {
+        *bottleneck_drops = test_ctx->s_to_c_link->packets_dropped;
+    }
+
     /* Delete the context */
     if (test_ctx != NULL) {
+        multipath_test_unshare_links(test_ctx);
         tls_api_delete_ctx(test_ctx);
     }
 
@@ -1213,6 +1284,11 @@ int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t t
     return ret;
 }
 
+int multipath_test_one(uint64_t max_completion_microsec, multipath_test_enum_t test_id)
+{
+    return multipath_test_one_ex(max_completion_microsec, test_id, NULL, NULL);
+}
+
 /* Basic multipath test. Set up two links in parallel, verify that both are used and that
  * the overall transmission is shorterthan if only one link was used.
  */
@@ -1358,6 +1434,137 @@ int multipath_perf_test()
     return  multipath_test_one(max_completion_microsec, multipath_test_perf);
 }
 
+/* Test the coupled congestion control algorithms when both paths
+ * share the same bottleneck, and when the paths are disjoint, as in
+ * the wifi+lte perf scenario.
+ * The 10MB transfer takes at least 1.6 seconds at the 50 Mbps of the
+ * wifi link, and 0.9 second at the 90 Mbps of both links. The measured
+ * completion times are 1.88 to 1.91 seconds on the shared bottleneck,
+ * and 1.25 to 1.27 seconds on disjoint paths; the bounds add a 10% margin.
+ * On the shared bottleneck, an aggressive sender shows up as packets
+ * dropped at the bottleneck queue. Two uncoupled newreno paths cause
+ * 64 drops, the coupled algorithms 63. The test verifies that the
+ * coupled algorithms do not cause more losses than newreno, with a
+ * margin of 1/8, and that the losses stay below an absolute bound.
+ */
+#define MULTIPATH_COUPLED_MAX_DROPS 80
+
+static int multipath_coupled_test_one(uint64_t max_completion_microsec, multipath_test_enum_t test_id)
+{
+    picoquic_congestion_algorithm_t const* cc_algo[] = {
+        picoquic_lia_algorithm, picoquic_olia_algorithm, picoquic_balia_algorithm
+    };
+    uint64_t uncoupled_drops = 0;
+    uint64_t coupled_drops = 0;
+    int ret = 0;
+
+    if (test_id == multipath_test_coupled_shared) {
+        ret = multipath_test_one_ex(max_completion_microsec, test_id, picoquic_newreno_algorithm, &uncoupled_drops);
+        if (ret != 0) {
+            DBG_PRINTF("Uncoupled newreno test fails, ret = %d", ret);
+        }
+    }
+
+    for (size_t i = 0; ret == 0 && i < sizeof(cc_algo) / sizeof(picoquic_congestion_algorithm_t const*); i++) {
+        ret = multipath_test_one_ex(max_completion_microsec, test_id, cc_algo[i], &coupled_drops);
+        if (ret != 0) {
+            DBG_PRINTF("Coupled test fails for %s, ret = %d", cc_algo[i]->congestion_algorithm_id, ret);
+        }
+        else if (test_id == multipath_test_coupled_shared &&
+            (coupled_drops > uncoupled_drops + uncoupled_drops / 8 || coupled_drops > MULTIPATH_COUPLED_MAX_DROPS)) {
+            DBG_PRINTF("%s drops %" PRIu64 " packets at the shared bottleneck, newreno %" PRIu64,
+                cc_algo[i]->congestion_algorithm_id, coupled_drops, uncoupled_drops);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+int multipath_coupled_shared_test()
+{
+    uint64_t max_completion_microsec = 2100000;
+
+    return multipath_coupled_test_one(max_completion_microsec, multipath_test_coupled_shared);
+}
+
+int multipath_coupled_disjoint_test()
+{
+    uint64_t max_completion_microsec = 1400000;
+
+    return multipath_coupled_test_one(max_completion_microsec, multipath_test_coupled_disjoint);
+}
+
+/* Unit test of the OLIA alpha term. The best paths are those with the
+ * largest l_r/rtt_r^2. The test sets two paths for which the ranking
+ * differs from l_r^2/rtt_r: the short RTT path is the best, even if the
+ * long RTT path delivered more bytes since the last loss. Since the
+ * long RTT path also has the largest window, OLIA shall move window
+ * from it to the short RTT path.
+ */
+static void multipath_olia_alpha_set_path(picoquic_cnx_t* cnx, picoquic_path_t* path_x,
+    uint64_t rtt, uint64_t cwin, uint64_t bytes_acked, uint64_t current_time)
+{
+    picoquic_per_ack_state_t ack_state = { 0 };
+
+    ack_state.nb_bytes_acknowledged = bytes_acked;
+    cnx->congestion_alg->alg_notify(cnx, path_x, picoquic_congestion_notification_acknowledgement,
+        &ack_state, current_time);
+    path_x->first_tuple->challenge_verified = 1;
+    path_x->smoothed_rtt = rtt;
+    path_x->rtt_min = rtt;
+    path_x->cwin = cwin;
+}
+
+int multipath_olia_alpha_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    struct sockaddr_in saddr;
+    struct sockaddr_in caddr;
+
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 443;
+    memset(&caddr, 0, sizeof(struct sockaddr_in));
+    caddr.sin_family = AF_INET;
+    caddr.sin_port = 1234;
+
+    quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time, &simulated_time, NULL, NULL, 0);
+    if (quic == NULL) {
+        ret = -1;
+    }
+    else if ((cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+        (struct sockaddr*)&saddr, simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL ||
+        picoquic_create_path(cnx, simulated_time, (struct sockaddr*)&caddr, (struct sockaddr*)&saddr, 0, 1) < 0) {
+        DBG_PRINTF("%s", "Cannot create the connection");
+        ret = -1;
+    }
+    else {
+        /* Short RTT path: l/rtt^2 = 1e-3, l^2/rtt = 1e6.
+         * Long RTT path: l/rtt^2 = 5e-4, l^2/rtt = 2e6. */
+        picoquic_set_congestion_algorithm(cnx, picoquic_olia_algorithm);
+        multipath_olia_alpha_set_path(cnx, cnx->path[0], 10000, 30000, 100000, simulated_time);
+        multipath_olia_alpha_set_path(cnx, cnx->path[1], 20000, 60000, 200000, simulated_time);
+
+        if (picoquic_olia_alpha(cnx, cnx->path[0]) != 0.5 ||
+            picoquic_olia_alpha(cnx, cnx->path[1]) != -0.5) {
+            DBG_PRINTF("OLIA alpha: short RTT path %f, long RTT path %f, expected 0.5, -0.5",
+                picoquic_olia_alpha(cnx, cnx->path[0]), picoquic_olia_alpha(cnx, cnx->path[1]));
+            ret = -1;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
 #if defined(_WINDOWS) && !defined(_WINDOWS64)
 int multipath_callback_test()
 {
@@ -0,0 +1,317 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoquic_path_scheduler.h"
+
+/* Unit test of the multipath schedulers. The test creates a connection
+ * with two paths, sets the state of the paths and the scheduler flags
+ * directly, and verifies the decisions of each scheduler. A third path
+ * is then added to test the redundant repeats.
+ */
+static void path_scheduler_test_set_path(picoquic_path_t* path_x, uint64_t rtt, uint64_t cwin,
+    uint64_t last_sent_time, int is_cwin_ok)
+{
+    path_x->first_tuple->challenge_verified = 1;
+    path_x->smoothed_rtt = rtt;
+    path_x->rtt_min = rtt;
+    path_x->rtt_variant = rtt / 10;
+    path_x->cwin = cwin;
+    path_x->bytes_in_transit = (is_cwin_ok) ? 0 : cwin;
+    path_x->last_sent_time = last_sent_time;
+    path_x->is_scheduler_candidate = 1;
+    path_x->is_scheduler_pacing_ok = 1;
+    path_x->is_scheduler_cwin_ok = (is_cwin_ok) ? 1 : 0;
+}
+
+static int path_scheduler_test_one(picoquic_cnx_t* cnx, picoquic_path_scheduler_t const* scheduler,
+    picoquic_path_t* expected)
+{
+    int ret = 0;
+    picoquic_path_t* selected;
+
+    picoquic_set_path_scheduler(cnx, scheduler);
+    selected = cnx->path_scheduler->scheduler_select(cnx, 0);
+    if (selected != expected) {
+        DBG_PRINTF("Scheduler %s selects path %d, expected %d", scheduler->path_scheduler_id,
+            (selected == NULL) ? -1 : (int)selected->unique_path_id,
+            (expected == NULL) ? -1 : (int)expected->unique_path_id);
+        ret = -1;
+    }
+    return ret;
+}
+
+static int path_scheduler_test_names()
+{
+    int ret = 0;
+    picoquic_path_scheduler_t const* schedulers[5];
+
+    schedulers[0] = picoquic_default_path_scheduler;
+    schedulers[1] = picoquic_minrtt_path_scheduler;
+    schedulers[2] = picoquic_ecf_path_scheduler;
+    schedulers[3] = picoquic_weighted_path_scheduler;
+    schedulers[4] = picoquic_redundant_path_scheduler;
+
+    for (int i = 0; ret == 0 && i < 5; i++) {
+        if (picoquic_get_path_scheduler(schedulers[i]->path_scheduler_id) != schedulers[i]) {
+            DBG_PRINTF("Cannot find scheduler %s", schedulers[i]->path_scheduler_id);
+            ret = -1;
+        }
+        else if (schedulers[i]->is_redundant != (schedulers[i] == picoquic_redundant_path_scheduler)) {
+            DBG_PRINTF("Unexpected redundant flag for %s", schedulers[i]->path_scheduler_id);
+            ret = -1;
+        }
+    }
+    if (ret == 0 && (picoquic_get_path_scheduler("nosuchscheduler") != NULL ||
+        picoquic_get_path_scheduler(NULL) != NULL)) {
+        DBG_PRINTF("%s", "Unexpected scheduler found");
+        ret = -1;
+    }
+    return ret;
+}
+
+/* Queue on a path a packet carrying the first bytes of stream 0 */
+static picoquic_packet_t* path_scheduler_test_queue(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time)
+{
+    uint8_t frame[] = { 0x0a, 0, 4, 1, 2, 3, 4 };
+    picoquic_packet_t* packet = picoquic_create_packet(cnx->quic);
+
+    if (packet != NULL) {
+        packet->ptype = picoquic_packet_1rtt_protected;
+        packet->pc = picoquic_packet_context_application;
+        packet->offset = 16;
+        memcpy(packet->bytes + packet->offset, frame, sizeof(frame));
+        packet->length = packet->offset + sizeof(frame);
+        packet->send_time = current_time;
+        packet->send_path = path_x;
+        packet->sequence_number = path_x->pkt_ctx.send_sequence++;
+        picoquic_queue_for_retransmit(cnx, path_x, packet, packet->length, current_time);
+    }
+    return packet;
+}
+
+static int path_scheduler_test_repeat(picoquic_cnx_t* cnx, picoquic_path_t* path_x, uint64_t current_time,
+    int expect_repeat, int expect_more)
+{
+    int ret = 0;
+    uint8_t buffer[PICOQUIC_MAX_PACKET_SIZE];
+    size_t length = 0;
+    int more_data = 0;
+    int is_pure_ack = 1;
+
+    if (picoquic_redundant_retransmit_as_needed(cnx, path_x, current_time, buffer, sizeof(buffer),
+        &length, &more_data, &is_pure_ack) != 0 ||
+        (length > 0) != expect_repeat || more_data != expect_more || is_pure_ack == expect_repeat) {
+        DBG_PRINTF("Repeat on path %d at %" PRIu64 ": length %zu, more data %d", (int)path_x->unique_path_id,
+            current_time, length, more_data);
+        ret = -1;
+    }
+    return ret;
+}
+
+/* Redundant repeats with three paths. A packet sent on the first path is
+ * repeated once on each of the other paths. The redundant cursor of the first
+ * path only moves to the next packet once the first one was repeated on all
+ * the candidate paths, and packets older than half an RTT are not repeated.
+ */
+static int path_scheduler_redundant_test(picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    int ret = 0;
+    picoquic_packet_t* first = NULL;
+    picoquic_packet_t* second = NULL;
+
+    cnx->is_multipath_enabled = 1;
+    for (int i = 0; i < 3; i++) {
+        path_scheduler_test_set_path(cnx->path[i], 10000, 30000, 0, 1);
+    }
+
+    if ((first = path_scheduler_test_queue(cnx, cnx->path[0], current_time)) == NULL ||
+        path_scheduler_test_repeat(cnx, cnx->path[1], current_time, 1, 0) != 0 ||
+        path_scheduler_test_repeat(cnx, cnx->path[1], current_time, 0, 0) != 0) {
+        ret = -1;
+    }
+    else if ((second = path_scheduler_test_queue(cnx, cnx->path[0], current_time + 1000)) == NULL ||
+        path_scheduler_test_repeat(cnx, cnx->path[2], current_time + 1000, 1, 1) != 0) {
+        ret = -1;
+    }
+    else if (first->was_preemptively_repeated ||
+        first->redundant_path_mask != ((1ull << cnx->path[1]->unique_path_id) | (1ull << cnx->path[2]->unique_path_id)) ||
+        cnx->path[0]->pkt_ctx.redundant_repeat_ptr != second ||
+        cnx->path[0]->pkt_ctx.preemptive_repeat_ptr != NULL) {
+        DBG_PRINTF("%s", "Unexpected redundant repeat state");
+        ret = -1;
+    }
+    else if (path_scheduler_test_repeat(cnx, cnx->path[2], current_time + 1000, 1, 0) != 0 ||
+        path_scheduler_test_repeat(cnx, cnx->path[1], current_time + 10000, 0, 0) != 0) {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int path_scheduler_test()
+{
+    int ret = path_scheduler_test_names();
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    picoquic_path_t* fast = NULL;
+    picoquic_path_t* slow = NULL;
+    struct sockaddr_in saddr;
+    struct sockaddr_in caddr;
+
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 443;
+    memset(&caddr, 0, sizeof(struct sockaddr_in));
+    caddr.sin_family = AF_INET;
+    caddr.sin_port = 1234;
+
+    if (ret == 0) {
+        quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+            NULL, NULL, NULL, NULL, simulated_time, &simulated_time, NULL, NULL, 0);
+        if (quic == NULL) {
+            ret = -1;
+        }
+        else if ((cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&saddr, simulated_time, 0, "test-sni", "test-alpn", 1)) == NULL ||
+            picoquic_create_path(cnx, simulated_time, (struct sockaddr*)&caddr, (struct sockaddr*)&saddr, 0, 1) < 0) {
+            DBG_PRINTF("%s", "Cannot create the connection");
+            ret = -1;
+        }
+        else if (cnx->path_scheduler != picoquic_default_path_scheduler) {
+            DBG_PRINTF("%s", "Connection does not use the default scheduler");
+            ret = -1;
+        }
+        else {
+            fast = cnx->path[0];
+            slow = cnx->path[1];
+        }
+    }
+
+    /* Both paths ready. The fast path was used last. */
+    if (ret == 0) {
+        path_scheduler_test_set_path(fast, 10000, 30000, 100, 1);
+        path_scheduler_test_set_path(slow, 50000, 30000, 50, 1);
+
+        if (path_scheduler_test_one(cnx, picoquic_default_path_scheduler, slow) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_redundant_path_scheduler, slow) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_minrtt_path_scheduler, fast) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_ecf_path_scheduler, fast) != 0) {
+            ret = -1;
+        }
+    }
+    /* Weighted round robin shares in proportion of cwin/rtt, i.e., 5 to 1 */
+    if (ret == 0) {
+        int nb_fast = 0;
+        int nb_slow = 0;
+
+        picoquic_set_path_scheduler(cnx, picoquic_weighted_path_scheduler);
+        for (int i = 0; i < 600; i++) {
+            picoquic_path_t* selected = cnx->path_scheduler->scheduler_select(cnx, 0);
+            if (selected == fast) {
+                nb_fast++;
+            }
+            else if (selected == slow) {
+                nb_slow++;
+            }
+        }
+        if (nb_fast != 500 || nb_slow != 100) {
+            DBG_PRINTF("Weighted scheduler sends %d on fast path, %d on slow path", nb_fast, nb_slow);
+            ret = -1;
+        }
+    }
+    /* Fast path blocked by congestion control */
+    if (ret == 0) {
+        path_scheduler_test_set_path(fast, 10000, 30000, 100, 0);
+
+        if (path_scheduler_test_one(cnx, picoquic_default_path_scheduler, slow) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_minrtt_path_scheduler, slow) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_weighted_path_scheduler, slow) != 0) {
+            ret = -1;
+        }
+    }
+    /* With a short backlog, ECF waits for the fast path */
+    if (ret == 0) {
+        uint8_t data[1024];
+
+        memset(data, 0x5a, sizeof(data));
+        for (int i = 0; ret == 0 && i < 20; i++) {
+            ret = picoquic_add_to_stream(cnx, 0, data, sizeof(data), 0);
+        }
+        if (ret == 0 && (path_scheduler_test_one(cnx, picoquic_ecf_path_scheduler, fast) != 0 ||
+            !cnx->is_path_scheduler_waiting)) {
+            DBG_PRINTF("%s", "ECF does not wait for the fast path");
+            ret = -1;
+        }
+        /* With a long backlog, ECF uses the slow path as well */
+        for (int i = 0; ret == 0 && i < 400; i++) {
+            ret = picoquic_add_to_stream(cnx, 0, data, sizeof(data), 0);
+        }
+        if (ret == 0 && (cnx->path_scheduler->scheduler_select(cnx, 0) != slow ||
+            cnx->is_path_scheduler_waiting)) {
+            DBG_PRINTF("%s", "ECF does not use the slow path");
+            ret = -1;
+        }
+    }
+    /* No path is ready */
+    if (ret == 0) {
+        path_scheduler_test_set_path(slow, 50000, 30000, 50, 0);
+
+        if (path_scheduler_test_one(cnx, picoquic_default_path_scheduler, NULL) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_minrtt_path_scheduler, NULL) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_ecf_path_scheduler, NULL) != 0 ||
+            path_scheduler_test_one(cnx, picoquic_weighted_path_scheduler, NULL) != 0) {
+            ret = -1;
+        }
+    }
+    /* Redundant repeats, after adding a third path */
+    if (ret == 0) {
+        caddr.sin_port = 1235;
+        if (picoquic_create_path(cnx, simulated_time, (struct sockaddr*)&caddr, (struct sockaddr*)&saddr, 0, 2) < 0 ||
+            cnx->nb_paths != 3) {
+            DBG_PRINTF("%s", "Cannot create the third path");
+            ret = -1;
+        }
+        else {
+            ret = path_scheduler_redundant_test(cnx, 1000000);
+        }
+    }
+    /* Setting a NULL scheduler restores the default */
+    if (ret == 0) {
+        picoquic_set_path_scheduler(cnx, NULL);
+        if (cnx->path_scheduler != picoquic_default_path_scheduler) {
+            DBG_PRINTF("%s", "NULL does not restore the default scheduler");
+            ret = -1;
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
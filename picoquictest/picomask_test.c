@@ -576,7 +576,7 @@ int picomask_test_target_cnx_create(picomask_test_ctx_t* pt_ctx)
         picoquic_set_callback(cnx, h3zero_callback, h3_ctx);
         /* Perform the initialization, settings and QPACK streams
          */
-        ret = h3zero_protocol_init(cnx);
+        ret = h3zero_protocol_init_ex(cnx, h3_ctx);
         /* TODO: Request a simple file */
         /* start */
         if (ret == 0) {
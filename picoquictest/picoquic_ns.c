@@ -82,6 +82,8 @@
 *   two links on the left leading to the "main" and "background" clients,
 *   two links on the right leading the the "main" and "background" servers.
 *   Or, at a later stage, maybe allow for aribitrary topologies.
+*   The only exception is multipath: the main client can open a second
+*   path, from a second address, through a second pair of links.
 * - we do not yet support dynamically changing the properties of the links,
 *   e.g., having link break, be restored, or change data rate and latency.
 * - the "L4S" implementation is a place holder.
@@ -95,7 +97,7 @@
 
 #define PICOQUIC_NS_MAX_CLIENTS 5
 #define QUIC_PERF_ALPN "perf"
-#define PICOQUIC_NS_NB_LINKS 2
+#define PICOQUIC_NS_NB_LINKS 4 /* links 2 and 3 are only used by the second path */
 #define PICOQUIC_NS_NB_NODES 2
 
 typedef struct st_picoquic_ns_client_t {
@@ -123,6 +125,11 @@ typedef struct st_picoquic_ns_ctx_t {
     uint64_t next_cnx_start_time;
     picoquic_ns_client_t* client_ctx[PICOQUIC_NS_MAX_CLIENTS];
     uint8_t packet_ecn_default;
+    /* Multipath support */
+    struct sockaddr_in second_addr;
+    picoquic_path_scheduler_t const* path_scheduler;
+    int is_multipath;
+    int is_second_path_started;
 } picoquic_ns_ctx_t;
 
 
@@ -148,6 +155,7 @@ int picoquic_ns_server_callback(picoquic_cnx_t* cnx,
                     &cc_ctx->client_ctx[i]->cnx->path[0]->first_tuple->p_local_cnxid->cnx_id) == 0) {
                 picoquic_set_congestion_algorithm_ex(cnx, cc_ctx->client_ctx[i]->cc_algo,
                     cc_ctx->client_ctx[i]->cc_option_string);
+                picoquic_set_path_scheduler(cnx, cc_ctx->path_scheduler);
                 if (cc_ctx->client_ctx[i]->seed_cwin > 0 &&
                     cc_ctx->client_ctx[i]->seed_rtt > 0) {
                     uint8_t* ip_addr;
@@ -400,6 +408,36 @@ int picoquic_ns_create_link(picoquic_ns_ctx_t* cc_ctx, int link_id)
     return ret;
 }
 
+/* Create the links of the second path, client to server (2) and
+ * server to client (3). Parameters not specified for the second
+ * path are copied from the first path.
+ */
+int picoquic_ns_create_second_path_links(picoquic_ns_ctx_t* cc_ctx, picoquic_ns_spec_t* spec)
+{
+    int ret = 0;
+    picoquic_ns_link_spec_t* link_spec = &cc_ctx->vary_link_spec[0];
+    uint64_t latency = (spec->second_path_latency > 0) ? spec->second_path_latency : link_spec->latency;
+    uint64_t queue_delay_max = (spec->second_path_queue_delay_max > 0) ? spec->second_path_queue_delay_max : link_spec->queue_delay_max;
+
+    if (latency == 0) {
+        latency = 10000; /* default to 10ms */
+    }
+    for (int link_id = 2; ret == 0 && link_id < PICOQUIC_NS_NB_LINKS; link_id++) {
+        double data_rate = spec->second_path_data_rate_in_gbps;
+        if (data_rate == 0) {
+            data_rate = (link_id == 2) ? link_spec->data_rate_in_gbps_up : link_spec->data_rate_in_gbps_down;
+        }
+        if (data_rate == 0) {
+            data_rate = 0.01; /* default to 10mbps */
+        }
+        if ((cc_ctx->link[link_id] = picoquictest_sim_link_create(data_rate, latency, NULL,
+            queue_delay_max, cc_ctx->simulated_time)) == NULL) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
 int picoquic_ns_create_links(picoquic_ns_ctx_t* cc_ctx, picoquic_ns_spec_t* spec)
 {
     /* first step is to create the scenarios */
@@ -407,10 +445,13 @@ int picoquic_ns_create_links(picoquic_ns_ctx_t* cc_ctx, picoquic_ns_spec_t* spec
 
     /* next create the link with parameters of the first scenario */
     if (ret == 0) {
-        for (int i = 0; ret == 0 && i < PICOQUIC_NS_NB_LINKS; i++) {
+        for (int i = 0; ret == 0 && i < 2; i++) {
             ret = picoquic_ns_create_link(cc_ctx, i);
         }
     }
+    if (ret == 0 && spec->is_multipath) {
+        ret = picoquic_ns_create_second_path_links(cc_ctx, spec);
+    }
 
     /* The simulation will automatically execute the transition to
      * the first "vary_link_spec" value. */
@@ -493,6 +534,15 @@ picoquic_ns_ctx_t* picoquic_ns_create_ctx(picoquic_ns_spec_t* spec, FILE* err_fd
             cc_ctx->addr[i].sin_addr.s_addr = htonl(ip_addr);
 #endif
         }
+        /* The second path uses the next client address */
+        cc_ctx->second_addr = cc_ctx->addr[1];
+#ifdef _WINDOWS
+        cc_ctx->second_addr.sin_addr.S_un.S_addr = htonl(0x0A000001 + PICOQUIC_NS_NB_NODES);
+#else
+        cc_ctx->second_addr.sin_addr.s_addr = htonl(0x0A000001 + PICOQUIC_NS_NB_NODES);
+#endif
+        cc_ctx->is_multipath = spec->is_multipath;
+        cc_ctx->path_scheduler = spec->path_scheduler;
         /* Create server side quic context */
         if ((cc_ctx->q_ctx[0] = picoquic_create(
             PICOQUIC_NS_MAX_CLIENTS,
@@ -540,6 +590,11 @@ picoquic_ns_ctx_t* picoquic_ns_create_ctx(picoquic_ns_spec_t* spec, FILE* err_fd
         else {
             picoquic_set_default_pmtud_policy(cc_ctx->q_ctx[1], picoquic_pmtud_delayed);
         }
+        if (ret == 0 && spec->is_multipath) {
+            for (int i = 0; i < PICOQUIC_NS_NB_NODES; i++) {
+                picoquic_set_default_multipath_option(cc_ctx->q_ctx[i], 1);
+            }
+        }
         if (spec->qlog_dir != NULL) {
             for (int i = 0; ret == 0 && i < 2; i++) {
                 ret = picoquic_set_qlog(cc_ctx->q_ctx[i], spec->qlog_dir);
@@ -592,10 +647,11 @@ int picoquic_ns_incoming_packet(picoquic_ns_ctx_t* cc_ctx, int link_id)
 
     /* TODO, but not yet: add management of CPU time, see picoquic_test_endpoint_t */
     /* For now, just submit the packet to the specified server.
-     * The context id is set to the same value of the node id
+     * The even links lead to the server (node 0), the odd links
+     * lead to the clients (node 1).
      */
     if (packet != NULL) {
-        int node_id = link_id;
+        int node_id = link_id & 1;
         picoquic_cnx_t* first_cnx = NULL;
         ret = picoquic_incoming_packet_ex(cc_ctx->q_ctx[node_id], packet->bytes, packet->length,
             (struct sockaddr*)&packet->addr_from, (struct sockaddr*)&packet->addr_to, 0,
@@ -627,6 +683,12 @@ int picoquic_ns_prepare_packet(picoquic_ns_ctx_t* cc_ctx, int node_id, int* is_a
              * always the other node.
              */
             int link_id = (node_id == 0) ? 1 : 0;
+            if (cc_ctx->is_multipath &&
+                picoquic_compare_addr((struct sockaddr*)((node_id == 0) ? &packet->addr_to : &packet->addr_from),
+                    (struct sockaddr*)&cc_ctx->second_addr) == 0) {
+                /* The packet belongs to the second path */
+                link_id += 2;
+            }
             if (packet->addr_from.ss_family == 0) {
                 picoquic_store_addr(&packet->addr_from, (struct sockaddr*)&cc_ctx->addr[node_id]);
             }
@@ -656,6 +718,7 @@ int picoquic_ns_start_connection(picoquic_ns_ctx_t* cc_ctx, int cnx_id)
     }
     else {
         picoquic_set_congestion_algorithm_ex(cc_ctx->client_ctx[cnx_id]->cnx, cc_ctx->client_ctx[cnx_id]->cc_algo, cc_ctx->client_ctx[cnx_id]->cc_option_string);
+        picoquic_set_path_scheduler(cc_ctx->client_ctx[cnx_id]->cnx, cc_ctx->path_scheduler);
         picoquic_set_callback(cc_ctx->client_ctx[cnx_id]->cnx, quicperf_callback,
             cc_ctx->client_ctx[cnx_id]->quicperf_ctx);
         cc_ctx->client_ctx[cnx_id]->cnx->local_parameters.max_datagram_frame_size = 1532;
@@ -770,6 +833,21 @@ void picoquic_ns_vary_link(picoquic_ns_ctx_t* cc_ctx)
     }
 }
 
+/* Start the second path of the main connection once the connection is
+ * ready. The probe fails if the peer has not yet provided connection IDs
+ * for the new path, in which case it will be retried at the next step.
+ */
+void picoquic_ns_start_second_path(picoquic_ns_ctx_t* cc_ctx)
+{
+    picoquic_cnx_t* cnx = (cc_ctx->client_ctx[0] == NULL) ? NULL : cc_ctx->client_ctx[0]->cnx;
+
+    if (cnx != NULL && picoquic_get_cnx_state(cnx) == picoquic_state_ready && cnx->is_multipath_enabled &&
+        picoquic_probe_new_path(cnx, (struct sockaddr*)&cc_ctx->addr[0],
+            (struct sockaddr*)&cc_ctx->second_addr, cc_ctx->simulated_time) == 0) {
+        cc_ctx->is_second_path_started = 1;
+    }
+}
+
 /* One simulation step -- TODO: add link variability.
  */
 
@@ -788,6 +866,10 @@ int picoquic_ns_step(picoquic_ns_ctx_t* cc_ctx, int* is_active)
         start_connection
     } next_action = no_action;
 
+    if (cc_ctx->is_multipath && !cc_ctx->is_second_path_started) {
+        picoquic_ns_start_second_path(cc_ctx);
+    }
+
     /* check whether there is a link state change */
     if (cc_ctx->next_vary_link_time < t_next_action) {
         t_next_action = cc_ctx->next_vary_link_time;
@@ -796,7 +878,7 @@ int picoquic_ns_step(picoquic_ns_ctx_t* cc_ctx, int* is_active)
 
     /* Check whether there is something to receive */
     for (int i = 0; i < PICOQUIC_NS_NB_LINKS; i++) {
-        if (cc_ctx->link[i]->first_packet != NULL) {
+        if (cc_ctx->link[i] != NULL && cc_ctx->link[i]->first_packet != NULL) {
             uint64_t t_arrival = picoquictest_sim_link_next_arrival(cc_ctx->link[i], t_next_action);
             if (t_arrival < t_next_action) {
                 t_next_action = t_arrival;
@@ -887,7 +969,7 @@ static int picoquic_ns_media_excluded(char const* media_excluded, char const* id
 {
     int is_excluded = 0;
     size_t id_len = strlen(id);
-    while (*media_excluded != 0){
+    while (media_excluded != NULL && *media_excluded != 0){
         size_t to_next_comma = 0;
 
         while (*media_excluded == ' ' || *media_excluded == '\t') {
@@ -951,6 +1033,34 @@ int picoquic_ns_media_check(quicperf_ctx_t* quicperf_ctx, picoquic_ns_spec_t* sp
     return ret;
 }
 
+void picoquic_ns_get_results(picoquic_ns_ctx_t* cc_ctx, picoquic_ns_spec_t* spec, picoquic_ns_results_t* results)
+{
+    quicperf_ctx_t* quicperf_ctx = cc_ctx->client_ctx[0]->quicperf_ctx;
+    uint64_t sum_delays = 0;
+
+    memset(results, 0, sizeof(picoquic_ns_results_t));
+    results->completion_time = cc_ctx->simulated_time;
+
+    for (size_t i = 0; i < quicperf_ctx->nb_scenarios; i++) {
+        if (quicperf_ctx->scenarios[i].media_type != quicperf_media_batch &&
+            !picoquic_ns_media_excluded(spec->media_excluded, quicperf_ctx->scenarios[i].id)) {
+            quicperf_stream_report_t* report = &quicperf_ctx->reports[i];
+            results->nb_media_frames += report->nb_frames_received;
+            sum_delays += report->sum_delays;
+            if (report->max_delays > results->media_latency_max) {
+                results->media_latency_max = report->max_delays;
+            }
+        }
+    }
+    if (results->nb_media_frames > 0) {
+        results->media_latency_average = sum_delays / results->nb_media_frames;
+    }
+    results->first_path_packets = cc_ctx->link[1]->packets_sent;
+    if (cc_ctx->link[3] != NULL) {
+        results->second_path_packets = cc_ctx->link[3]->packets_sent;
+    }
+}
+
 int picoquic_ns(picoquic_ns_spec_t* spec, FILE* err_fd)
 {
     int ret = 0;
@@ -1026,6 +1136,10 @@ int picoquic_ns(picoquic_ns_spec_t* spec, FILE* err_fd)
         ret = picoquic_ns_media_check(cc_ctx->client_ctx[0]->quicperf_ctx, spec, err_fd);
     }
 
+    if (ret == 0 && spec->results != NULL) {
+        picoquic_ns_get_results(cc_ctx, spec, spec->results);
+    }
+
     if (cc_ctx != NULL) {
         picoquic_ns_delete_ctx(cc_ctx);
     }
@@ -59,6 +59,18 @@ typedef struct st_picoquic_ns_link_spec_t {
     int is_wifi_jitter; /* 0 = guaussian jitter (default), 1 = wifi jitter emulation. */
 } picoquic_ns_link_spec_t;
 
+/* Results of the simulation, reported if the spec provides a results
+ * structure. The media latency is computed over the media streams of the
+ * main connection that are not excluded. */
+typedef struct st_picoquic_ns_results_t {
+    uint64_t completion_time; /* Simulated time when the main connection completed */
+    uint64_t nb_media_frames; /* Number of media frames received */
+    uint64_t media_latency_average; /* Average latency of media frames */
+    uint64_t media_latency_max; /* Tail latency, largest delay of media frames */
+    uint64_t first_path_packets; /* Packets carried by the server to client link of the first path */
+    uint64_t second_path_packets; /* Same for the second path, if multipath */
+} picoquic_ns_results_t;
+
 typedef struct st_picoquic_ns_spec_t {
     uint64_t main_start_time;
     uint64_t main_target_time;
@@ -95,6 +107,18 @@ typedef struct st_picoquic_ns_spec_t {
     char const* media_excluded;
     uint64_t media_latency_average;
     uint64_t media_latency_max;
+    /* Multipath: if "is_multipath" is set, the main client opens a second path
+     * through a second pair of links once the connection is ready. The second
+     * links are not affected by the link variation scenarios. Data rate, latency
+     * and queue delay default to those of the first path if not specified.
+     * Client and server use the specified path scheduler, or the default.
+     */
+    int is_multipath;
+    double second_path_data_rate_in_gbps;
+    uint64_t second_path_latency;
+    uint64_t second_path_queue_delay_max;
+    picoquic_path_scheduler_t const* path_scheduler;
+    picoquic_ns_results_t* results; /* if specified, filled with the results of the simulation */
 } picoquic_ns_spec_t;
 
 int picoquic_ns(picoquic_ns_spec_t* spec, FILE* err_fd);
@@ -46,6 +46,8 @@ int picohash_test();
 int picohash_bytes_test();
 int siphash_test();
 int picohash_embedded_test();
+int picohash_open_test();
+int picohash_bench_test();
 int picolog_basic_test();
 int bytestream_test();
 int create_cnx_test();
@@ -67,6 +69,7 @@ int tls_api_connect_test();
 #endif
 int tls_api_test();
 int tls_api_inject_hs_ack_test();
+int tls_api_open_tables_test();
 int tls_api_silence_test();
 int tls_api_loss_test(uint64_t mask);
 int tls_api_client_first_loss_test();
@@ -100,6 +103,7 @@ int tls_api_very_long_congestion_test();
 int tls_api_retry_test();
 int tls_api_retry_large_test();
 int ackrange_test();
+int ack_index_bench_test();
 int ack_of_ack_test();
 int ack_disorder_test();
 int ack_horizon_test();
@@ -114,6 +118,7 @@ int skip_frame_test();
 int keep_alive_test();
 int logger_test();
 int binlog_test();
+int binlog_writer_test();
 int app_message_overflow_test();
 int socket_test();
 int test_stateless_blowback();
@@ -191,7 +196,18 @@ int sockloop_migration_test();
 int sockloop_nat_test();
 int sockloop_thread_test();
 int sockloop_thread_name_test();
+int sockloop_recv_batch_test();
+int sockloop_epoll_test();
+int sockloop_uring_test();
+int sockloop_send_batch_test();
+int sockloop_send_batch_peers_test();
+int sockloop_send_batch_partial_test();
+int sockloop_send_batch_eio_test();
+int sockloop_shard_test();
 int splay_test();
+int wheel_test();
+int wheel_bench_test();
+int picoindex_test();
 int TlsStreamFrameTest();
 int draft17_vector_test();
 int dtn_basic_test();
@@ -237,6 +253,7 @@ int padding_null_test();
 int padding_zero_min_test();
 int packet_trace_test();
 int qlog_auto_test();
+int qlog_worker_test();
 int qlog_error_test();
 int qlog_trace_test();
 int qlog_trace_auto_test();
@@ -245,6 +262,9 @@ int qlog_trace_ecn_test();
 int perflog_test();
 int rebinding_stress_test();
 int many_short_loss_test();
+int zero_copy_receive_test();
+int compact_sent_packets_test();
+int incoming_batch_test();
 int random_padding_test();
 int ec00_zero_test();
 int ec2f_second_flight_nack_test();
@@ -288,6 +308,11 @@ int cc_ns_wifi_bad_bbr_test();
 int cc_ns_varylink_test();
 int cc_ns_satellite_test();
 int cc_ns_media_test();
+int cc_ns_mpsched_default_test();
+int cc_ns_mpsched_minrtt_test();
+int cc_ns_mpsched_ecf_test();
+int cc_ns_mpsched_weighted_test();
+int cc_ns_mpsched_redundant_test();
 int satellite_basic_test();
 int satellite_seeded_test();
 int satellite_seeded_bbr1_test();
@@ -331,6 +356,8 @@ int h3zero_capsule_test();
 int h3zero_client_data_test();
 int qpack_huffman_test();
 int qpack_huffman_base_test();
+int qpack_huffman_encode_test();
+int qpack_huffman_bench_test();
 int h3zero_parse_qpack_test();
 int h3zero_prepare_qpack_test();
 int h3zero_user_agent_test();
@@ -351,6 +378,7 @@ int optimistic_ack_test();
 int optimistic_hole_test();
 int document_addresses_test();
 int socket_ecn_test();
+int socket_gro_test();
 int null_sni_test();
 int preferred_address_test();
 int preferred_address_dis_mig_test();
@@ -359,13 +387,18 @@ int cid_for_lb_test();
 int cid_for_lb_cli_test();
 int retry_protection_vector_test();
 int retry_protection_v2_test();
+int aead_batch_bench_test();
 int test_copy_for_retransmit();
 int dataqueue_copy_test();
 int dataqueue_packet_test();
 int bad_coalesce_test();
 int bad_cnxid_test();
 int stream_splay_test();
+int stream_index_test();
+int stream_index_bench_test();
 int stream_output_test();
+int stream_output_bench_test();
+int stream_buffers_test();
 int stream_rank_test();
 int provide_stream_buffer_test();
 int not_before_cnxid_test();
@@ -409,6 +442,8 @@ int datagram_small_test();
 int datagram_small_new_test();
 int datagram_small_packet_test();
 int datagram_wifi_test();
+int datagram_ring_test();
+int datagram_queue_test();
 int ddos_amplification_test();
 int ddos_amplification_0rtt_test();
 int ddos_amplification_8k_test();
@@ -502,6 +537,9 @@ int multipath_socket_error_test();
 int multipath_abandon_test();
 int multipath_back1_test();
 int multipath_perf_test();
+int multipath_coupled_shared_test();
+int multipath_coupled_disjoint_test();
+int multipath_olia_alpha_test();
 int multipath_callback_test();
 int multipath_quality_test();
 int multipath_stream_af_test();
@@ -513,6 +551,7 @@ int multipath_discovery_test();
 int multipath_keep_alive_test();
 int multipath_qlog_test();
 int multipath_tunnel_test();
+int path_scheduler_test();
 int token_reuse_api_test();
 int get_hash_test();
 int get_tls_errors_test();
@@ -554,6 +593,9 @@ int demo_alpn_test();
 int demo_file_sanitize_test();
 int demo_file_access_test();
 int demo_server_file_test();
+int h3zero_async_file_test();
+int h3zero_content_cache_test();
+int h3zero_qpack_test();
 int demo_ticket_test();
 int demo_error_test();
 int h3zero_satellite_test();
@@ -164,6 +164,8 @@ typedef struct st_picoquic_test_endpoint_t {
     size_t packet_queue_max;
     /* flag to mark use of AF_UNSPEC for receiving "addr_to" */
     int addr_to_unspec;
+    /* flag to submit all queued packets with picoquic_incoming_packet_batch */
+    int use_batch_receive;
     /* next time endpoint ready */
     uint64_t next_time_ready;
     /* last time client sent something */
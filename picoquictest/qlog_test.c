@@ -153,6 +153,133 @@ int qlog_auto_test()
 }
 
 
+/*
+* Test of the background qlog conversion. The first worker has no thread,
+* so the queue fills up and the third conversion is dropped. The queued
+* conversions are done when the worker is deleted. The second worker
+* converts the logs in the background. In the third pass, the binary logs
+* are written by a binlog writer, which queues the conversions after
+* closing the files. In the last pass, the binlog writer runs without a
+* qlog worker, so the binary logs are kept and not converted.
+*/
+#define QLOG_WORKER_NB_CNX 3
+
+static int qlog_worker_cnx(picoquic_qlog_worker_t* worker, picoquic_binlog_writer_t* writer,
+	char* binlog_name, char* qlog_name, size_t name_size)
+{
+	picoquic_quic_t* quic = NULL;
+	picoquic_cnx_t* cnx = NULL;
+	char cid_name[2 * PICOQUIC_CONNECTION_ID_MAX_SIZE + 1];
+
+	int ret = picoquic_test_set_minimal_cnx(&quic, &cnx);
+	if (ret == 0 && writer != NULL) {
+		ret = picoquic_set_binlog_writer(quic, writer);
+	}
+	if (ret == 0) {
+		picoquic_set_binlog(quic, ".");
+		ret = picoquic_set_qlog(quic, ".");
+		picoquic_set_qlog_worker(quic, worker);
+	}
+	if (ret == 0) {
+		binlog_new_connection(cnx);
+		ret = picoquic_start_client_cnx(cnx);
+	}
+	if (ret == 0) {
+		(void)picoquic_print_connection_id_hexa(cid_name, sizeof(cid_name), &cnx->initial_cnxid);
+		ret = picoquic_sprintf(qlog_name, name_size, NULL, "%s%s%s.client.qlog", ".", PICOQUIC_FILE_SEPARATOR, cid_name);
+		if (ret == 0) {
+			ret = picoquic_sprintf(binlog_name, name_size, NULL, "%s", (cnx->binlog_file_name == NULL) ? "" : cnx->binlog_file_name);
+		}
+	}
+
+	picoquic_test_delete_minimal_cnx(&quic, &cnx);
+	return ret;
+}
+
+static int qlog_worker_file_exists(char const* file_name)
+{
+	FILE* F = picoquic_file_open(file_name, "r");
+	int exists = (F != NULL);
+
+	(void)picoquic_file_close(F);
+	return exists;
+}
+
+int qlog_worker_test()
+{
+	int ret = 0;
+	char binlog_name[QLOG_WORKER_NB_CNX][512];
+	char qlog_name[QLOG_WORKER_NB_CNX][512];
+	picoquic_qlog_worker_stats_t stats;
+
+	for (int pass = 0; ret == 0 && pass < 4; pass++) {
+		picoquic_qlog_worker_t* worker = NULL;
+		picoquic_binlog_writer_t* writer = NULL;
+
+		if (pass < 3 && (worker = picoquic_qlog_worker_create((pass == 0) ? 0 : 1, (pass == 0) ? 2 : 0)) == NULL) {
+			DBG_PRINTF("Cannot create qlog worker, pass %d", pass);
+			ret = -1;
+			break;
+		}
+		if (pass >= 2 && (writer = picoquic_binlog_writer_create(0)) == NULL) {
+			DBG_PRINTF("%s", "Cannot create binlog writer");
+			ret = -1;
+		}
+		for (int i = 0; ret == 0 && i < QLOG_WORKER_NB_CNX; i++) {
+			ret = qlog_worker_cnx(worker, writer, binlog_name[i], qlog_name[i], sizeof(qlog_name[i]));
+		}
+		if (writer != NULL) {
+			/* The writer queues the pending conversions when it closes the files */
+			picoquic_binlog_writer_delete(writer);
+		}
+		if (pass == 0) {
+			picoquic_qlog_worker_get_stats(worker, &stats);
+			if (stats.nb_queued != 2 || stats.nb_dropped != 1 || stats.queue_length != 2 ||
+				stats.queue_length_max != 2 || stats.nb_converted != 0) {
+				DBG_PRINTF("Unexpected qlog queue, %" PRIu64 " queued, %" PRIu64 " dropped, %" PRIu64 " converted",
+					stats.nb_queued, stats.nb_dropped, stats.nb_converted);
+				ret = -1;
+			}
+		}
+		else if (ret == 0 && worker != NULL) {
+			if (picoquic_qlog_worker_wait_idle(worker, 10000000) != 0) {
+				DBG_PRINTF("%s", "Qlog worker did not complete");
+				ret = -1;
+			}
+			else {
+				picoquic_qlog_worker_get_stats(worker, &stats);
+				if (stats.nb_converted != QLOG_WORKER_NB_CNX || stats.nb_failed != 0 || stats.nb_dropped != 0) {
+					DBG_PRINTF("Unexpected qlog conversions, %" PRIu64 " converted, %" PRIu64 " failed",
+						stats.nb_converted, stats.nb_failed);
+					ret = -1;
+				}
+			}
+		}
+		if (worker != NULL) {
+			picoquic_qlog_worker_delete(worker);
+		}
+
+		for (int i = 0; ret == 0 && i < QLOG_WORKER_NB_CNX; i++) {
+			int expected = (worker != NULL && (pass > 0 || i < 2));
+			if (qlog_worker_file_exists(qlog_name[i]) != expected) {
+				DBG_PRINTF("Qlog file %s %s", qlog_name[i], (expected) ? "not created" : "unexpected");
+				ret = -1;
+			}
+			else if (worker == NULL && !qlog_worker_file_exists(binlog_name[i])) {
+				DBG_PRINTF("Binary log %s not kept", binlog_name[i]);
+				ret = -1;
+			}
+		}
+		for (int i = 0; i < QLOG_WORKER_NB_CNX; i++) {
+			int last_err = 0;
+			(void)picoquic_file_delete(qlog_name[i], &last_err);
+			(void)picoquic_file_delete(binlog_name[i], &last_err);
+		}
+	}
+
+	return ret;
+}
+
 #define QLOG_ERROR_FILE "qlog_error_test.txt"
 
 int qlog_string(FILE* f, bytestream* s, uint64_t l);
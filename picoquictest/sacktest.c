@@ -621,6 +621,166 @@ int ackrange_test()
 }
 
 
+/* Measure the cost of processing ACK frames when many packets are queued
+ * for retransmission. Queue N packets, then acknowledge every other pair of
+ * packets with ACK frames of 32 ranges, then acknowledge the remaining
+ * packets. Verify that the expected packets are removed from the queue.
+ * The test runs with and without the packet number index, and prints the
+ * processing time of both.
+ */
+#define ACK_INDEX_BENCH_WINDOW 128
+#define ACK_INDEX_BENCH_NB_RANGES (ACK_INDEX_BENCH_WINDOW / 4)
+
+static size_t ack_index_bench_frame(uint8_t* bytes, size_t bytes_max, uint64_t largest,
+    uint64_t num_block, uint64_t first_range)
+{
+    size_t byte_index = 0;
+
+    bytes[byte_index++] = picoquic_frame_type_ack;
+    byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, largest);
+    byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, 0);
+    byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, num_block);
+    byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, first_range);
+    for (uint64_t i = 0; i < num_block; i++) {
+        /* Gap of 2 packets, range of 2 packets */
+        byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, 1);
+        byte_index += picoquic_varint_encode(bytes + byte_index, bytes_max - byte_index, 1);
+    }
+
+    return byte_index;
+}
+
+static int ack_index_bench_one(uint64_t nb_packets, int is_index_disabled, uint64_t* ack_time)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    uint64_t current_time = 0;
+    picoquic_packet_context_t* pkt_ctx;
+    uint64_t base;
+    uint8_t frame[1024];
+    picoquic_packet_data_t packet_data;
+
+    if (picoquic_test_set_minimal_cnx(&quic, &cnx) != 0) {
+        return -1;
+    }
+
+    pkt_ctx = &cnx->pkt_ctx[picoquic_packet_context_application];
+    pkt_ctx->is_pn_index_disabled = is_index_disabled;
+    base = pkt_ctx->send_sequence;
+
+    for (uint64_t i = 0; ret == 0 && i < nb_packets; i++) {
+        picoquic_packet_t* p = picoquic_create_packet(quic);
+
+        if (p == NULL) {
+            ret = -1;
+        }
+        else {
+            p->sequence_number = base + i;
+            p->ptype = picoquic_packet_1rtt_protected;
+            p->pc = picoquic_packet_context_application;
+            p->send_path = cnx->path[0];
+            p->send_time = current_time;
+            p->length = 1000;
+            p->offset = p->length;
+            p->checksum_overhead = 16;
+            picoquic_queue_for_retransmit(cnx, cnx->path[0], p, p->length, current_time);
+        }
+    }
+    pkt_ctx->send_sequence = base + nb_packets;
+
+    if (ret == 0) {
+        uint64_t start_time = picoquic_current_time();
+
+        /* Acknowledge the packets whose number modulo 4 is 0 or 1 */
+        for (uint64_t w = 0; ret == 0 && w + ACK_INDEX_BENCH_WINDOW <= nb_packets; w += ACK_INDEX_BENCH_WINDOW) {
+            size_t length = ack_index_bench_frame(frame, sizeof(frame), base + w + ACK_INDEX_BENCH_WINDOW - 3,
+                ACK_INDEX_BENCH_NB_RANGES - 1, 1);
+            memset(&packet_data, 0, sizeof(picoquic_packet_data_t));
+            current_time += 10;
+            if (picoquic_decode_ack_frame(cnx, frame, frame + length, current_time, 3, 0, 0, &packet_data) == NULL) {
+                DBG_PRINTF("Cannot decode ACK of window %" PRIu64, w);
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            /* Verify that only the expected packets remain */
+            uint64_t nb_remaining = 0;
+            picoquic_packet_t* p = pkt_ctx->pending_first;
+
+            while (p != NULL) {
+                if (((p->sequence_number - base) & 2) == 0) {
+                    DBG_PRINTF("Packet %" PRIu64 " is still queued", p->sequence_number - base);
+                    ret = -1;
+                    break;
+                }
+                nb_remaining++;
+                p = p->packet_next;
+            }
+            if (ret == 0 && nb_remaining != nb_packets / 2) {
+                DBG_PRINTF("Expected %" PRIu64 " queued packets, got %" PRIu64, nb_packets / 2, nb_remaining);
+                ret = -1;
+            }
+        }
+
+        /* Acknowledge all the packets up to the end of each window */
+        for (uint64_t w = 0; ret == 0 && w + ACK_INDEX_BENCH_WINDOW <= nb_packets; w += ACK_INDEX_BENCH_WINDOW) {
+            size_t length = ack_index_bench_frame(frame, sizeof(frame), base + w + ACK_INDEX_BENCH_WINDOW - 1,
+                0, w + ACK_INDEX_BENCH_WINDOW - 1);
+            memset(&packet_data, 0, sizeof(picoquic_packet_data_t));
+            current_time += 10;
+            if (picoquic_decode_ack_frame(cnx, frame, frame + length, current_time, 3, 0, 0, &packet_data) == NULL) {
+                DBG_PRINTF("Cannot decode final ACK of window %" PRIu64, w);
+                ret = -1;
+            }
+        }
+
+        *ack_time = picoquic_current_time() - start_time;
+
+        if (ret == 0 && pkt_ctx->pending_first != NULL) {
+            DBG_PRINTF("Packet %" PRIu64 " is still queued after final ACK", pkt_ctx->pending_first->sequence_number - base);
+            ret = -1;
+        }
+        if (ret == 0 && pkt_ctx->pn_index_count != 0) {
+            DBG_PRINTF("%" PRIu64 " packets still in index", pkt_ctx->pn_index_count);
+            ret = -1;
+        }
+        if (ret == 0 && (pkt_ctx->pn_index == NULL) != (is_index_disabled != 0)) {
+            DBG_PRINTF("Unexpected index state, disabled = %d", is_index_disabled);
+            ret = -1;
+        }
+    }
+
+    picoquic_test_delete_minimal_cnx(&quic, &cnx);
+
+    return ret;
+}
+
+int ack_index_bench_test()
+{
+    int ret = 0;
+    const uint64_t nb_packets[3] = { 10240, 51200, 102400 };
+
+    for (int i = 0; ret == 0 && i < 3; i++) {
+        uint64_t index_time = 0;
+        uint64_t list_time = 0;
+
+        if ((ret = ack_index_bench_one(nb_packets[i], 0, &index_time)) != 0) {
+            DBG_PRINTF("Ack index bench fails for %" PRIu64 " packets", nb_packets[i]);
+        }
+        else if ((ret = ack_index_bench_one(nb_packets[i], 1, &list_time)) != 0) {
+            DBG_PRINTF("Ack list bench fails for %" PRIu64 " packets", nb_packets[i]);
+        }
+        else {
+            DBG_PRINTF("%" PRIu64 " packets, ack processing %" PRIu64 " us with index, %" PRIu64 " us without",
+                nb_packets[i], index_time, list_time);
+        }
+    }
+
+    return ret;
+}
+
 /* Examine what happens when the packets are received in disorder. In this test, even packets (0, 2..)
  * are received through a high latency path, odd packets (1..3) through a low latency path, and the
  * ack-of-ack is sent after 32 packets are received. The goal is to verify that ack ranges are
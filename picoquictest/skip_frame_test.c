@@ -2274,6 +2274,162 @@ int binlog_test()
     return ret;
 }
 
+/* Test of the asynchronous binary log writer. The events are queued
+ * in the ring of the QUIC context and written by the writer thread.
+ * The resulting file shall be identical to the one produced by the
+ * synchronous writer in binlog_test. A second pass uses a very small
+ * ring, so some events may be dropped: the file shall then contain
+ * exactly the events that were queued, and still be parsable. */
+static int binlog_writer_one_test(size_t ring_size, size_t nb_repeat, char const * log_test_ref)
+{
+    int ret = 0;
+    const picoquic_connection_id_t initial_cid = {
+        { 1, 2, 3, 4 }, 4
+    };
+    const picoquic_connection_id_t dest_cid = {
+        { 5, 6, 7, 8 }, 4
+    };
+    uint64_t simulated_time = 0;
+    picoquic_binlog_ring_stats_t ring_stats;
+    picoquic_binlog_writer_t* writer = picoquic_binlog_writer_create(ring_size);
+    picoquic_quic_t* quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+
+    memset(&ring_stats, 0, sizeof(ring_stats));
+
+    if (quic == NULL || writer == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context or log writer\n");
+        ret = -1;
+    }
+    else if (picoquic_set_binlog_writer(quic, writer) != 0) {
+        DBG_PRINTF("%s", "Cannot set the log writer\n");
+        ret = -1;
+    }
+    else {
+        picoquic_set_binlog(quic, ".");
+        (void)picoquic_set_default_spinbit_policy(quic, picoquic_spinbit_null);
+
+        struct sockaddr_in saddr;
+        memset(&saddr, 0, sizeof(struct sockaddr_in));
+        picoquic_cnx_t* cnx = picoquic_create_cnx(quic, initial_cid, dest_cid, (struct sockaddr*) & saddr,
+            simulated_time, 0, "test-sni", "test-alpn", 1);
+
+        if (cnx == NULL) {
+            DBG_PRINTF("%s", "Cannot create QUIC CNX context\n");
+            ret = -1;
+        }
+        else {
+            picoquic_log_new_connection(cnx);
+            for (size_t r = 0; r < nb_repeat; r++) {
+                for (size_t i = 0; i < nb_test_skip_list; i++) {
+                    picoquic_packet_header ph;
+                    memset(&ph, 0, sizeof(ph));
+
+                    ph.ptype = picoquic_packet_1rtt_protected;
+                    ph.pn64 = i;
+                    ph.dest_cnx_id = initial_cid;
+                    ph.srce_cnx_id = dest_cid;
+
+                    ph.offset = 0;
+                    ph.payload_length = test_skip_list[i].len;
+
+                    picoquic_log_packet(cnx, cnx->path[0], 0, 0, &ph, test_skip_list[i].val, test_skip_list[i].len);
+                }
+                for (size_t i = 0; i < nb_test_frame_error_list; i++) {
+                    picoquic_packet_header ph;
+                    memset(&ph, 0, sizeof(ph));
+
+                    ph.ptype = picoquic_packet_1rtt_protected;
+                    ph.pn64 = i;
+                    ph.dest_cnx_id = initial_cid;
+                    ph.srce_cnx_id = dest_cid;
+
+                    ph.offset = 0;
+                    ph.payload_length = test_frame_error_list[i].len;
+
+                    picoquic_log_packet(cnx, cnx->path[0], 0, 0, &ph, test_frame_error_list[i].val, test_frame_error_list[i].len);
+                }
+            }
+            picoquic_delete_cnx(cnx);
+        }
+        picoquic_get_binlog_ring_stats(quic, &ring_stats);
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    if (writer != NULL) {
+        /* Deleting the writer flushes and closes the remaining files */
+        picoquic_binlog_writer_delete(writer);
+    }
+
+    if (ret == 0) {
+        /* The file contains the 16 bytes header, plus all the queued events */
+        long file_size = -1;
+        FILE* F = picoquic_file_open(binlog_test_file, "rb");
+
+        if (F != NULL) {
+            if (fseek(F, 0, SEEK_END) == 0) {
+                file_size = ftell(F);
+            }
+            (void)picoquic_file_close(F);
+        }
+
+        if (ring_stats.nb_events == 0 || file_size < 0 || (uint64_t)file_size != 16 + ring_stats.nb_bytes) {
+            DBG_PRINTF("Events: %" PRIu64 ", bytes queued: %" PRIu64 ", file size: %ld\n",
+                ring_stats.nb_events, ring_stats.nb_bytes, file_size);
+            ret = -1;
+        }
+        else if (log_test_ref != NULL) {
+            if (ring_stats.nb_dropped_events != 0) {
+                DBG_PRINTF("Unexpected drops: %" PRIu64 "\n", ring_stats.nb_dropped_events);
+                ret = -1;
+            }
+            else if (picoquic_test_compare_binary_files(binlog_test_file, log_test_ref) != 0) {
+                DBG_PRINTF("%s", "Unexpected content in binary log file.\n");
+                ret = -1;
+            }
+        }
+        else {
+            uint64_t log_time = 0;
+            uint16_t flags;
+            FILE* f_binlog = picoquic_open_cc_log_file_for_read(binlog_test_file, &flags, &log_time);
+
+            if (f_binlog == NULL) {
+                DBG_PRINTF("%s", "Cannot open the binary log.\n");
+                ret = -1;
+            }
+            else if (qlog_convert(&initial_cid, f_binlog, binlog_test_file, NULL, ".", flags) != 0) {
+                DBG_PRINTF("%s", "Cannot convert the binary log into QLOG.\n");
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int binlog_writer_test()
+{
+    char log_test_ref[512];
+    int ret = picoquic_get_input_path(log_test_ref, sizeof(log_test_ref), picoquic_solution_dir, BINLOG_TEST_REF);
+
+    if (ret != 0) {
+        DBG_PRINTF("%s", "Cannot set the log ref file name.\n");
+    }
+    else {
+        ret = binlog_writer_one_test(0, 1, log_test_ref);
+    }
+
+    if (ret == 0) {
+        ret = binlog_writer_one_test(4096, 64, NULL);
+    }
+
+    return ret;
+}
+
 /* Basic test of connection ID stash, part of migration support  */
 static const picoquic_remote_cnxid_t stash_test_case[] = {
     { NULL,  1,{ { 0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }, 4 },
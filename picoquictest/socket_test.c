@@ -243,3 +243,96 @@ int socket_ecn_test()
 
     return ret;
 }
+
+/*
+ * Test that UDP GRO is supported on Linux. Send a GSO train of several
+ * segments through the loopback interface, and verify that the receiver
+ * gets all the data, either coalesced with the right segment size, or
+ * segment by segment if the kernel did not coalesce.
+ */
+int socket_gro_test()
+{
+    int ret = 0;
+#if defined(UDP_GRO) && defined(UDP_SEGMENT)
+    SOCKET_TYPE fd_recv = picoquic_open_client_socket(AF_INET);
+    SOCKET_TYPE fd_send = picoquic_open_client_socket(AF_INET);
+    struct sockaddr_storage addr_recv = { 0 };
+    struct sockaddr_in loopback = { 0 };
+    uint8_t message[4 * 1000];
+    uint8_t buffer[0x10000];
+    size_t segment_size = 1000;
+    int total_recv = 0;
+    int gro = 1;
+
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (uint8_t)(i / segment_size);
+    }
+
+    loopback.sin_family = AF_INET;
+    loopback.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (fd_recv == INVALID_SOCKET || fd_send == INVALID_SOCKET ||
+        bind(fd_recv, (struct sockaddr*)&loopback, sizeof(loopback)) != 0 ||
+        picoquic_get_local_address(fd_recv, &addr_recv) != 0) {
+        DBG_PRINTF("%s", "Cannot open GRO test sockets");
+        ret = -1;
+    }
+    else if (setsockopt(fd_recv, SOL_UDP, UDP_GRO, &gro, sizeof(gro)) != 0) {
+        /* Old kernel, GRO not supported. Not an error. */
+        DBG_PRINTF("%s", "UDP_GRO not supported");
+    }
+    else {
+        int sock_err = 0;
+        ((struct sockaddr_in*)&addr_recv)->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (picoquic_sendmsg(fd_send, (struct sockaddr*)&addr_recv, NULL, 0,
+            (const char*)message, (int)sizeof(message), (int)segment_size, &sock_err) != (int)sizeof(message)) {
+            DBG_PRINTF("Cannot send GSO train, err %d", sock_err);
+            ret = -1;
+        }
+
+        while (ret == 0 && total_recv < (int)sizeof(message)) {
+            struct sockaddr_storage addr_from;
+            struct sockaddr_storage addr_dest;
+            int dest_if = 0;
+            unsigned char received_ecn = 0;
+            size_t udp_coalesced_size = 0;
+            fd_set readfds;
+            struct timeval tv = { 1, 0 };
+            int bytes_recv;
+
+            FD_ZERO(&readfds);
+            FD_SET(fd_recv, &readfds);
+            if (select((int)fd_recv + 1, &readfds, NULL, NULL, &tv) <= 0) {
+                DBG_PRINTF("Timeout after receiving %d bytes", total_recv);
+                ret = -1;
+                break;
+            }
+            bytes_recv = picoquic_recvmsg_ex(fd_recv, &addr_from, &addr_dest, &dest_if, &received_ecn,
+                buffer, (int)sizeof(buffer), &udp_coalesced_size);
+            if (bytes_recv <= 0 || total_recv + bytes_recv > (int)sizeof(message)) {
+                ret = -1;
+            }
+            else if (bytes_recv > (int)segment_size && udp_coalesced_size != segment_size) {
+                DBG_PRINTF("Received %d bytes, coalesced size %zu", bytes_recv, udp_coalesced_size);
+                ret = -1;
+            }
+            else if (memcmp(buffer, message + total_recv, bytes_recv) != 0) {
+                DBG_PRINTF("Data mismatch at offset %d", total_recv);
+                ret = -1;
+            }
+            else {
+                total_recv += bytes_recv;
+            }
+        }
+    }
+
+    if (fd_recv != INVALID_SOCKET) {
+        SOCKET_CLOSE(fd_recv);
+    }
+    if (fd_send != INVALID_SOCKET) {
+        SOCKET_CLOSE(fd_send);
+    }
+#endif
+    return ret;
+}
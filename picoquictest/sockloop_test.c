@@ -29,6 +29,8 @@
 #include "autoqlog.h"
 #include "picoquic_packet_loop.h"
 #include "picosocks.h"
+#include "picoquic_lb.h"
+#include "picoquic_shard.h"
 
 
 #ifndef SLEEP
@@ -62,8 +64,18 @@ typedef struct st_sockloop_test_spec_t {
     int extra_socket_required;
     int prefer_extra_socket;
     int force_migration;
+    int recv_batch_size;
+    int use_epoll;
+    int use_io_uring;
+    int send_batch_size;
+    int simulate_partial_send;
+    int nb_extra_clients;
 } sockloop_test_spec_t;
 
+/* The client and server sides of all connections share a context created
+ * for 8 connections. */
+#define SOCKLOOP_TEST_EXTRA_CLIENTS_MAX 3
+
 typedef struct st_sockloop_test_cb_t {
     picoquic_test_tls_api_ctx_t* test_ctx;
     uint8_t test_id;
@@ -399,6 +411,68 @@ int sockloop_test_cnx_config(picoquic_test_tls_api_ctx_t* test_ctx, struct socka
     return ret;
 }
 
+/* Extra clients only perform the handshake, so that the packets sent by
+ * the loop are for several peers, over IPv4 and IPv6. */
+static int sockloop_test_extra_client_cb(picoquic_cnx_t* cnx,
+    uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(cnx);
+    UNREFERENCED_PARAMETER(stream_id);
+    UNREFERENCED_PARAMETER(bytes);
+    UNREFERENCED_PARAMETER(length);
+    UNREFERENCED_PARAMETER(fin_or_event);
+    UNREFERENCED_PARAMETER(callback_ctx);
+    UNREFERENCED_PARAMETER(v_stream_ctx);
+#endif
+    return 0;
+}
+
+static int sockloop_test_extra_clients_config(picoquic_test_tls_api_ctx_t* test_ctx, sockloop_test_spec_t* spec,
+    picoquic_cnx_t** extra_cnx, uint64_t current_time)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < spec->nb_extra_clients; i++) {
+        struct sockaddr_storage server_address;
+        picoquic_connection_id_t icid;
+
+        ret = sockloop_test_addr_config(&server_address, (i & 1) ? AF_INET6 : AF_INET, spec->port);
+        if (ret == 0) {
+            sockloop_test_set_icid(&icid, spec->test_id);
+            icid.id[5] = (uint8_t)(i + 1);
+            extra_cnx[i] = picoquic_create_cnx(test_ctx->qclient, icid, picoquic_null_connection_id,
+                (struct sockaddr*)&server_address, current_time, 0, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN, 1);
+            if (extra_cnx[i] == NULL) {
+                ret = -1;
+            }
+            else {
+                picoquic_set_callback(extra_cnx[i], sockloop_test_extra_client_cb, NULL);
+                ret = picoquic_start_client_cnx(extra_cnx[i]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+static int sockloop_test_verify_extra_clients(sockloop_test_spec_t* spec, picoquic_cnx_t** extra_cnx)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < spec->nb_extra_clients; i++) {
+        picoquic_state_enum cnx_state = picoquic_get_cnx_state(extra_cnx[i]);
+
+        if (cnx_state != picoquic_state_ready && cnx_state != picoquic_state_client_ready_start) {
+            DBG_PRINTF("Extra client %d is in state %d", i, cnx_state);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
 int sockloop_test_verify_migration(sockloop_test_cb_t * loop_cb, picoquic_cnx_t* cnx_client)
 {
     int ret = 0;
@@ -451,6 +525,7 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
     uint64_t current_time = picoquic_current_time();
     picoquic_socket_ctx_t double_bind[2] = { 0 };
     picoquic_network_thread_ctx_t* thread_ctx = NULL;
+    picoquic_cnx_t* extra_cnx[SOCKLOOP_TEST_EXTRA_CLIENTS_MAX] = { 0 };
     int nb_double_bind = 0;
 
     /* Create test context
@@ -478,6 +553,15 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
     if (ret == 0) {
         ret = test_api_init_send_recv_scenario(test_ctx, spec->scenario, spec->scenario_size);
     }
+    /* Extra clients are started with the loop, which requires a foreground loop */
+    if (ret == 0 && spec->nb_extra_clients > 0) {
+        if (spec->nb_extra_clients > SOCKLOOP_TEST_EXTRA_CLIENTS_MAX || spec->use_background_thread) {
+            ret = -1;
+        }
+        else {
+            ret = sockloop_test_extra_clients_config(test_ctx, spec, extra_cnx, current_time);
+        }
+    }
     /* If testing a socket fault, bind sockets to the desired port */
     for (int i = 0; i < 2; i++) {
         double_bind[i].fd = INVALID_SOCKET;
@@ -522,7 +606,11 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
             param.simulate_eio = spec->simulate_eio;
             param.extra_socket_required = spec->extra_socket_required;
             param.prefer_extra_socket = spec->prefer_extra_socket;
-            
+            param.recv_batch_size = spec->recv_batch_size;
+            param.use_epoll = spec->use_epoll;
+            param.use_io_uring = spec->use_io_uring;
+            param.send_batch_size = spec->send_batch_size;
+            param.simulate_partial_send = spec->simulate_partial_send;
 
             loop_cb.force_migration = spec->force_migration;
             loop_cb.param = &param;
@@ -576,6 +664,33 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
             else {
                 ret = picoquic_packet_loop_v2(test_ctx->qserver, &param, sockloop_test_cb, &loop_cb);
             }
+#if defined(__linux__)
+            if (ret == 0 && spec->send_batch_size > 1) {
+                /* Verify that the test hooks of batched sends were exercised */
+                if (param.simulate_partial_send != 0) {
+                    DBG_PRINTF("%d partial sends were not simulated", param.simulate_partial_send);
+                    ret = -1;
+                }
+                else if (param.simulate_eio && param.send_length_max > PICOQUIC_MAX_PACKET_SIZE) {
+                    DBG_PRINTF("%s", "EIO was not simulated");
+                    ret = -1;
+                }
+            }
+#endif
+            if (ret == 0 && spec->use_io_uring) {
+#ifdef PICOQUIC_HAVE_IO_URING
+                if (picoquic_packet_loop_uring_supported()) {
+                    if (!param.is_io_uring_used) {
+                        DBG_PRINTF("%s", "The io_uring loop did not run");
+                        ret = -1;
+                    }
+                }
+                else
+#endif
+                {
+                    DBG_PRINTF("%s", "io_uring not supported, only the socket loop was tested");
+                }
+            }
         }
     }
     /* Verify that the scenario worked. */
@@ -593,6 +708,9 @@ int sockloop_test_one(sockloop_test_spec_t *spec)
         else {
             ret = tls_api_one_scenario_verify(test_ctx);
         }
+        if (ret == 0) {
+            ret = sockloop_test_verify_extra_clients(spec, extra_cnx);
+        }
     }
     else {
         if (spec->double_bind) {
@@ -730,4 +848,256 @@ int sockloop_thread_name_test()
     spec.thread_name = "picoquic loop";
 
     return(sockloop_test_one(&spec));
-}
\ No newline at end of file
+}
+
+int sockloop_recv_batch_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 9);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.recv_batch_size = 32;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_epoll_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 10);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.use_background_thread = 1;
+    spec.use_epoll = 1;
+    spec.recv_batch_size = 32;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_uring_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 11);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.use_background_thread = 1;
+    spec.use_io_uring = 1;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_send_batch_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 12);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.send_batch_size = 32;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_send_batch_peers_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 13);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.send_batch_size = 32;
+    spec.nb_extra_clients = SOCKLOOP_TEST_EXTRA_CLIENTS_MAX;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_send_batch_partial_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 14);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.send_batch_size = 32;
+    spec.simulate_partial_send = 16;
+    spec.nb_extra_clients = 2;
+
+    return(sockloop_test_one(&spec));
+}
+
+int sockloop_send_batch_eio_test()
+{
+    sockloop_test_spec_t spec;
+    sockloop_test_set_spec(&spec, 15);
+    spec.socket_buffer_size = 0xffff;
+    spec.scenario = sockloop_test_scenario_1M;
+    spec.scenario_size = sizeof(sockloop_test_scenario_1M);
+    spec.send_batch_size = 32;
+    spec.simulate_eio = 1;
+
+    return(sockloop_test_one(&spec));
+}
+
+/* Test of the sharded server.
+ * The test starts a server with several shards, verifies that the CID
+ * generated by each shard are routed to that shard, that work posted
+ * by CID is executed in the right context, and that short header packets
+ * arriving at the wrong shard are forwarded to the shard that owns the CID.
+ */
+#define SOCKLOOP_SHARD_TEST_NB 4
+
+typedef struct st_sockloop_shard_work_t {
+    picoquic_quic_t* expected_quic;
+    volatile int nb_executed;
+    volatile int nb_wrong_quic;
+} sockloop_shard_work_t;
+
+static int sockloop_shard_work_fn(picoquic_quic_t* quic, void* work_ctx)
+{
+    sockloop_shard_work_t* work = (sockloop_shard_work_t*)work_ctx;
+
+    if (quic != NULL) {
+        if (quic == work->expected_quic) {
+            work->nb_executed++;
+        }
+        else {
+            work->nb_wrong_quic++;
+        }
+    }
+    return 0;
+}
+
+int sockloop_shard_test()
+{
+    int ret = 0;
+#ifdef SO_REUSEPORT
+    picoquic_quic_t* quic[SOCKLOOP_SHARD_TEST_NB];
+    picoquic_connection_id_t cid[SOCKLOOP_SHARD_TEST_NB];
+    sockloop_shard_work_t work[SOCKLOOP_SHARD_TEST_NB];
+    picoquic_sharded_server_t* server = NULL;
+    picoquic_packet_loop_param_t param = { 0 };
+    uint64_t current_time = picoquic_current_time();
+
+    memset(quic, 0, sizeof(quic));
+    memset(work, 0, sizeof(work));
+    for (int i = 0; ret == 0 && i < SOCKLOOP_SHARD_TEST_NB; i++) {
+        quic[i] = picoquic_create(8, NULL, NULL, NULL, PICOQUIC_TEST_ALPN, NULL, NULL,
+            NULL, NULL, NULL, current_time, NULL, NULL, NULL, 0);
+        if (quic[i] == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        param.local_af = AF_INET;
+        param.local_port = 3456;
+        server = picoquic_start_sharded_server(SOCKLOOP_SHARD_TEST_NB, quic, NULL, &param, NULL, NULL, &ret);
+        if (server == NULL) {
+            DBG_PRINTF("Cannot start sharded server, ret = %d", ret);
+            ret = -1;
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < SOCKLOOP_SHARD_TEST_NB; i++) {
+        picoquic_network_thread_ctx_t* thread_ctx = picoquic_sharded_server_thread(server, i);
+        for (int j = 0; j < 1000 && !thread_ctx->thread_is_ready; j++) {
+            SLEEP(1);
+        }
+        if (!thread_ctx->thread_is_ready) {
+            DBG_PRINTF("Shard %d is not ready", i);
+            ret = -1;
+        }
+    }
+
+    /* Each shard generates a CID, which should be routed back to it */
+    for (int i = 0; ret == 0 && i < SOCKLOOP_SHARD_TEST_NB; i++) {
+        picoquic_connection_id_t random_cid = picoquic_null_connection_id;
+
+        random_cid.id_len = quic[i]->local_cnxid_length;
+        for (uint8_t j = 0; j < random_cid.id_len; j++) {
+            random_cid.id[j] = (uint8_t)(0x11 * j + i);
+        }
+        cid[i] = random_cid;
+        quic[i]->cnx_id_callback_fn(quic[i], random_cid, picoquic_null_connection_id,
+            quic[i]->cnx_id_callback_ctx, &cid[i]);
+        if (picoquic_shard_from_cid(server, &cid[i]) != i) {
+            DBG_PRINTF("CID of shard %d not routed to that shard", i);
+            ret = -1;
+        }
+        else {
+            work[i].expected_quic = quic[i];
+            ret = picoquic_shard_post_by_cid(server, &cid[i], sockloop_shard_work_fn, &work[i]);
+        }
+    }
+
+    /* Send short header packets from several source ports, so that
+     * the kernel delivers some of them to the wrong shard. */
+    if (ret == 0) {
+        struct sockaddr_storage server_addr;
+        ret = sockloop_test_addr_config(&server_addr, AF_INET, param.local_port);
+        for (int k = 0; ret == 0 && k < 16; k++) {
+            SOCKET_TYPE fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+            if (fd == INVALID_SOCKET) {
+                ret = -1;
+                break;
+            }
+            for (int i = 0; i < SOCKLOOP_SHARD_TEST_NB; i++) {
+                uint8_t packet[64];
+                memset(packet, 0, sizeof(packet));
+                packet[0] = 0x40;
+                memcpy(packet + 1, cid[i].id, cid[i].id_len);
+                (void)sendto(fd, (const char*)packet, sizeof(packet), 0, (struct sockaddr*)&server_addr, sizeof(struct sockaddr_in));
+            }
+            SOCKET_CLOSE(fd);
+        }
+    }
+
+    if (ret == 0) {
+        uint64_t total_forwarded = 0;
+        uint64_t total_received_forwarded = 0;
+
+        for (int j = 0; j < 100; j++) {
+            total_forwarded = 0;
+            total_received_forwarded = 0;
+            for (int i = 0; i < SOCKLOOP_SHARD_TEST_NB; i++) {
+                uint64_t nb_forwarded;
+                uint64_t nb_received_forwarded;
+                uint64_t nb_dropped;
+                picoquic_shard_get_forwarding_stats(server, i, &nb_forwarded, &nb_received_forwarded, &nb_dropped);
+                total_forwarded += nb_forwarded;
+                total_received_forwarded += nb_received_forwarded;
+            }
+            if (total_forwarded > 0 && total_forwarded == total_received_forwarded) {
+                break;
+            }
+            SLEEP(10);
+        }
+        if (total_forwarded == 0 || total_forwarded != total_received_forwarded) {
+            DBG_PRINTF("Forwarded %" PRIu64 " packets, received %" PRIu64,
+                total_forwarded, total_received_forwarded);
+            ret = -1;
+        }
+    }
+
+    for (int i = 0; ret == 0 && i < SOCKLOOP_SHARD_TEST_NB; i++) {
+        if (work[i].nb_executed != 1 || work[i].nb_wrong_quic != 0) {
+            DBG_PRINTF("Work for shard %d executed %d times, %d in wrong context", i,
+                work[i].nb_executed, work[i].nb_wrong_quic);
+            ret = -1;
+        }
+    }
+
+    if (server != NULL) {
+        picoquic_delete_sharded_server(server);
+    }
+    for (int i = 0; i < SOCKLOOP_SHARD_TEST_NB; i++) {
+        if (quic[i] != NULL) {
+            picoquic_free(quic[i]);
+        }
+    }
+#endif
+    return ret;
+}
@@ -814,18 +814,23 @@ int stream_output_test()
             }
 
             if (ret == 0) {
-                /* Mark all streams as active */
-                stream = cnx->first_output_stream;
-
-                while (stream != NULL) {
-                    stream->maxdata_remote = 4096;
-                    picoquic_mark_active_stream(cnx, stream->stream_id, 1, NULL);
-                    stream = stream->next_output_stream;
+                /* Mark all streams as active. The streams were removed from
+                 * the output list since they had nothing to send. */
+                for (size_t i = 0; i < sizeof(output2) / sizeof(uint64_t); i++) {
+                    stream = picoquic_find_stream(cnx, output2[i]);
+                    if (stream != NULL) {
+                        stream->maxdata_remote = 4096;
+                        picoquic_mark_active_stream(cnx, stream->stream_id, 1, NULL);
+                    }
                 }
+                ret = stream_output_test_list(cnx, sizeof(output2) / sizeof(uint64_t), output2);
 
                 /* Check that first stream is what we expect */
                 stream = picoquic_find_ready_stream(cnx);
-                if (stream == NULL) {
+                if (ret != 0) {
+                    DBG_PRINTF("%s", "Active streams not listed in order\n");
+                }
+                else if (stream == NULL) {
                     DBG_PRINTF("Expected stream[%d],got NULL\n", (int)output2[0]);
                     ret = -1;
                 }
@@ -853,6 +858,334 @@ int stream_output_test()
     return ret;
 }
 
+/* Measure the cost of picking the next output stream when many streams
+ * are active. The test queues data on 10,000 streams, then repeatedly picks
+ * the next stream and formats a stream frame for it, verifying that the
+ * round robin levels cycle through all streams in order and that the FIFO
+ * levels drain the first stream first.
+ */
+#define STREAM_OUTPUT_BENCH_NB_STREAMS 10000
+#define STREAM_OUTPUT_BENCH_NB_CHUNKS 3
+#define STREAM_OUTPUT_BENCH_CHUNK_SIZE 64
+
+static int stream_output_bench_one(uint8_t stream_priority)
+{
+    int ret = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+    uint8_t data[STREAM_OUTPUT_BENCH_CHUNK_SIZE];
+    uint8_t frame[2 * STREAM_OUTPUT_BENCH_CHUNK_SIZE];
+    const size_t nb_picks = STREAM_OUTPUT_BENCH_NB_STREAMS * STREAM_OUTPUT_BENCH_NB_CHUNKS;
+
+    memset(data, 0xaa, sizeof(data));
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 1000;
+
+    quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        return -1;
+    }
+
+    picoquic_set_default_priority(quic, stream_priority);
+    cnx = picoquic_create_cnx(quic,
+        picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*)&saddr,
+        simulated_time, 0, "test-sni", "test-alpn", 1);
+
+    if (cnx == NULL) {
+        DBG_PRINTF("%s", "Cannot create connection\n");
+        ret = -1;
+    }
+    else {
+        uint64_t start_time;
+        uint64_t pick_time;
+
+        picoquic_set_callback(cnx, stream_output_test_callback, NULL);
+        cnx->maxdata_remote = UINT64_MAX;
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = 0x100000;
+        cnx->max_stream_id_bidir_remote = STREAM_ID_FROM_RANK(STREAM_OUTPUT_BENCH_NB_STREAMS, 1, 0);
+
+        for (int i = 0; ret == 0 && i < STREAM_OUTPUT_BENCH_NB_STREAMS; i++) {
+            for (int j = 0; ret == 0 && j < STREAM_OUTPUT_BENCH_NB_CHUNKS; j++) {
+                if (picoquic_add_to_stream(cnx, 4 * (uint64_t)i, data, sizeof(data), 0) != 0) {
+                    DBG_PRINTF("Cannot queue data on stream %d\n", 4 * i);
+                    ret = -1;
+                }
+            }
+        }
+
+        start_time = picoquic_current_time();
+        for (size_t i = 0; ret == 0 && i < nb_picks; i++) {
+            picoquic_stream_head_t* stream = picoquic_find_ready_stream(cnx);
+            uint64_t expected_id = ((stream_priority & 1) == 0) ?
+                4 * (i % STREAM_OUTPUT_BENCH_NB_STREAMS) : 4 * (i / STREAM_OUTPUT_BENCH_NB_CHUNKS);
+
+            if (stream == NULL) {
+                DBG_PRINTF("Pick %zu, no stream ready\n", i);
+                ret = -1;
+            }
+            else if (stream->stream_id != expected_id) {
+                DBG_PRINTF("Pick %zu, expected stream %" PRIu64 ", got %" PRIu64 "\n", i, expected_id, stream->stream_id);
+                ret = -1;
+            }
+            else {
+                int more_data = 0;
+                int is_pure_ack = 1;
+                int is_still_active = 0;
+                uint8_t* bytes_next;
+
+                simulated_time++;
+                bytes_next = picoquic_format_stream_frame(cnx, stream, frame, frame + sizeof(frame),
+                    &more_data, &is_pure_ack, &is_still_active, &ret);
+                if (ret == 0 && (bytes_next == NULL || bytes_next == frame)) {
+                    DBG_PRINTF("Pick %zu, no data sent on stream %" PRIu64 "\n", i, stream->stream_id);
+                    ret = -1;
+                }
+            }
+        }
+        pick_time = picoquic_current_time() - start_time;
+
+        if (ret == 0 && picoquic_find_ready_stream(cnx) != NULL) {
+            DBG_PRINTF("%s", "Unexpected ready stream after all data was sent\n");
+            ret = -1;
+        }
+        if (ret == 0 && cnx->first_output_stream != NULL) {
+            DBG_PRINTF("%s", "Idle streams still in the output list\n");
+            ret = -1;
+        }
+        if (ret == 0) {
+            DBG_PRINTF("%d streams, priority %d, %zu picks, %.3f us per pick\n",
+                STREAM_OUTPUT_BENCH_NB_STREAMS, stream_priority, nb_picks, ((double)pick_time) / nb_picks);
+        }
+
+        picoquic_delete_cnx(cnx);
+    }
+
+    picoquic_free(quic);
+
+    return ret;
+}
+
+int stream_output_bench_test()
+{
+    int ret = stream_output_bench_one(8);
+
+    if (ret == 0) {
+        ret = stream_output_bench_one(9);
+    }
+
+    return ret;
+}
+
+/* Test the application owned send buffers.
+ * Queue three buffers on stream 0 and two on stream 4, format stream frames
+ * and verify that the frames carry the application bytes. Acknowledge the
+ * frames of stream 0 out of order, and verify that the buffers are released
+ * in order once acknowledged. Then reset stream 4 and verify that its
+ * buffers are released as not acknowledged.
+ */
+#define STREAM_BUFFERS_TEST_NB 5
+
+typedef struct st_stream_buffers_test_ctx_t {
+    int nb_released;
+    int nb_acked;
+    const uint8_t* released[STREAM_BUFFERS_TEST_NB];
+} stream_buffers_test_ctx_t;
+
+static void stream_buffers_test_release(void* release_ctx, const uint8_t* bytes, size_t length, int is_acknowledged)
+{
+    stream_buffers_test_ctx_t* ctx = (stream_buffers_test_ctx_t*)release_ctx;
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(length);
+#endif
+    if (ctx->nb_released < STREAM_BUFFERS_TEST_NB) {
+        ctx->released[ctx->nb_released] = bytes;
+    }
+    ctx->nb_released++;
+    if (is_acknowledged) {
+        ctx->nb_acked++;
+    }
+}
+
+int picoquic_process_ack_of_stream_frame(picoquic_cnx_t* cnx, uint8_t* bytes,
+    size_t bytes_max, size_t* consumed);
+uint8_t* picoquic_format_stream_reset_frame(picoquic_cnx_t* cnx, picoquic_stream_head_t* stream,
+    uint8_t* bytes, uint8_t* bytes_max, int* more_data, int* is_pure_ack);
+
+int stream_buffers_test()
+{
+    int ret = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    uint64_t simulated_time = 0;
+    struct sockaddr_in saddr;
+    uint8_t buffer[STREAM_BUFFERS_TEST_NB][100];
+    uint8_t frames[3][256];
+    size_t frame_length[3] = { 0, 0, 0 };
+    picoquic_iovec_t iov[STREAM_BUFFERS_TEST_NB];
+    stream_buffers_test_ctx_t release_ctx;
+
+    memset(&release_ctx, 0, sizeof(release_ctx));
+    memset(&saddr, 0, sizeof(struct sockaddr_in));
+    saddr.sin_family = AF_INET;
+    saddr.sin_port = 1000;
+    for (int i = 0; i < STREAM_BUFFERS_TEST_NB; i++) {
+        memset(buffer[i], 0x10 + i, sizeof(buffer[i]));
+        iov[i].base = buffer[i];
+        iov[i].len = sizeof(buffer[i]);
+    }
+
+    quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, simulated_time,
+        &simulated_time, NULL, NULL, 0);
+
+    if (quic == NULL) {
+        DBG_PRINTF("%s", "Cannot create QUIC context\n");
+        return -1;
+    }
+
+    cnx = picoquic_create_cnx(quic,
+        picoquic_null_connection_id, picoquic_null_connection_id, (struct sockaddr*)&saddr,
+        simulated_time, 0, "test-sni", "test-alpn", 1);
+
+    if (cnx == NULL) {
+        DBG_PRINTF("%s", "Cannot create connection\n");
+        ret = -1;
+    }
+    else {
+        picoquic_stream_head_t* stream = NULL;
+
+        picoquic_set_callback(cnx, stream_output_test_callback, NULL);
+        cnx->maxdata_remote = PICOQUIC_DEFAULT_0RTT_WINDOW;
+        cnx->remote_parameters.initial_max_stream_data_bidi_remote = PICOQUIC_DEFAULT_0RTT_WINDOW;
+        cnx->max_stream_id_bidir_remote = 4;
+
+        if (picoquic_add_buffers_to_stream(cnx, 0, iov, 3, 1, stream_buffers_test_release, &release_ctx, NULL) != 0 ||
+            picoquic_add_buffers_to_stream(cnx, 4, iov + 3, 2, 0, stream_buffers_test_release, &release_ctx, NULL) != 0) {
+            DBG_PRINTF("%s", "Cannot queue the buffers\n");
+            ret = -1;
+        }
+        else if ((stream = picoquic_find_stream(cnx, 0)) == NULL) {
+            DBG_PRINTF("%s", "Cannot find stream 0\n");
+            ret = -1;
+        }
+
+        /* Send the content of stream 0 in three frames, one per buffer */
+        for (int i = 0; ret == 0 && i < 3; i++) {
+            int more_data = 0;
+            int is_pure_ack = 1;
+            int is_still_active = 0;
+            uint8_t* bytes_next = picoquic_format_stream_frame(cnx, stream, frames[i], frames[i] + sizeof(frames[i]),
+                &more_data, &is_pure_ack, &is_still_active, &ret);
+
+            if (ret != 0 || bytes_next == NULL || bytes_next == frames[i]) {
+                DBG_PRINTF("Cannot format frame %d\n", i);
+                ret = -1;
+            }
+            else {
+                frame_length[i] = bytes_next - frames[i];
+                if (frame_length[i] < 4 || memcmp(bytes_next - 4, buffer[i] + sizeof(buffer[i]) - 4, 4) != 0) {
+                    DBG_PRINTF("Frame %d does not carry buffer %d\n", i, i);
+                    ret = -1;
+                }
+            }
+        }
+
+        if (ret == 0 && (stream->send_queue != NULL || stream->release_queue == NULL || release_ctx.nb_released != 0)) {
+            DBG_PRINTF("%s", "Buffers released before acknowledgement\n");
+            ret = -1;
+        }
+
+        /* Copy sent data for retransmission, forward and backward */
+        if (ret == 0) {
+            const uint64_t copy_offset[3] = { 200, 50, 150 };
+            const size_t copy_length[3] = { 60, 200, 20 };
+
+            for (int i = 0; ret == 0 && i < 3; i++) {
+                uint8_t copy[256];
+
+                if (picoquic_stream_copy_sent_data(stream, copy_offset[i], copy_length[i], copy) != 0) {
+                    DBG_PRINTF("Cannot copy %zu bytes at offset %" PRIu64 "\n", copy_length[i], copy_offset[i]);
+                    ret = -1;
+                }
+                for (size_t j = 0; ret == 0 && j < copy_length[i]; j++) {
+                    if (copy[j] != 0x10 + (copy_offset[i] + j) / 100) {
+                        DBG_PRINTF("Wrong byte %zu in copy at offset %" PRIu64 "\n", j, copy_offset[i]);
+                        ret = -1;
+                    }
+                }
+            }
+        }
+
+        /* Acknowledge the second frame first, then the first one */
+        for (int i = 1; ret == 0 && i >= 0; i--) {
+            size_t consumed = 0;
+
+            ret = picoquic_process_ack_of_stream_frame(cnx, frames[i], frame_length[i], &consumed);
+            if (ret == 0 && release_ctx.nb_released != ((i == 1) ? 0 : 2)) {
+                DBG_PRINTF("After ack of frame %d, %d buffers released\n", i, release_ctx.nb_released);
+                ret = -1;
+            }
+        }
+
+        if (ret == 0 && (release_ctx.nb_acked != 2 || release_ctx.released[0] != buffer[0] || release_ctx.released[1] != buffer[1])) {
+            DBG_PRINTF("%s", "Buffers not released in order\n");
+            ret = -1;
+        }
+
+        /* Only the data of the last buffer can still be copied */
+        if (ret == 0) {
+            uint8_t copy[100];
+
+            if (picoquic_stream_copy_sent_data(stream, 210, 50, copy) != 0 || copy[0] != 0x12 ||
+                picoquic_stream_copy_sent_data(stream, 50, 10, NULL) == 0) {
+                DBG_PRINTF("%s", "Wrong copy of sent data after release\n");
+                ret = -1;
+            }
+        }
+
+        if (ret == 0) {
+            /* Reset stream 4 before any of its data is sent */
+            if (picoquic_reset_stream(cnx, 4, 0) != 0) {
+                DBG_PRINTF("%s", "Cannot reset stream 4\n");
+                ret = -1;
+            }
+            else {
+                picoquic_stream_head_t* stream4 = picoquic_find_stream(cnx, 4);
+                int more_data = 0;
+                int is_pure_ack = 1;
+
+                if (stream4 == NULL || picoquic_format_stream_reset_frame(cnx, stream4, frames[0], frames[0] + sizeof(frames[0]),
+                    &more_data, &is_pure_ack) == frames[0]) {
+                    DBG_PRINTF("%s", "Cannot format reset of stream 4\n");
+                    ret = -1;
+                }
+                else if (release_ctx.nb_released != 4 || release_ctx.nb_acked != 2) {
+                    DBG_PRINTF("After reset, %d buffers released, %d acked\n", release_ctx.nb_released, release_ctx.nb_acked);
+                    ret = -1;
+                }
+            }
+        }
+
+        picoquic_delete_cnx(cnx);
+
+        if (ret == 0 && release_ctx.nb_released != STREAM_BUFFERS_TEST_NB) {
+            DBG_PRINTF("After delete, %d buffers released\n", release_ctx.nb_released);
+            ret = -1;
+        }
+    }
+
+    picoquic_free(quic);
+
+    return ret;
+}
+
 /* Test the STREAM ID and STREAM RANK macros
  */
 
@@ -0,0 +1,310 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_internal.h"
+#include "picoquic_utils.h"
+#include "picoindex.h"
+
+/* Unit test of the paged index: random insertions and removals
+ * are checked against a flat table. */
+#define PICOINDEX_TEST_KEYS 20000
+
+static int picoindex_test_check(picoindex_t* index, void** reference, uint64_t key_base)
+{
+    int ret = 0;
+    size_t nb_values = 0;
+
+    for (size_t i = 0; ret == 0 && i < PICOINDEX_TEST_KEYS; i++) {
+        if (picoindex_get(index, key_base + i) != reference[i]) {
+            DBG_PRINTF("Key %zu, expected %p, got %p", i, reference[i], picoindex_get(index, key_base + i));
+            ret = -1;
+        }
+        else if (reference[i] != NULL) {
+            nb_values++;
+        }
+    }
+    if (ret == 0 && nb_values != index->nb_values) {
+        DBG_PRINTF("Expected %zu values, index has %zu", nb_values, index->nb_values);
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int picoindex_test()
+{
+    int ret = 0;
+    picoindex_t index;
+    uint64_t random_ctx = 0x1D3C0FFEE;
+    const uint64_t key_base = 1000000;
+    void** reference = (void**)calloc(PICOINDEX_TEST_KEYS, sizeof(void*));
+
+    memset(&index, 0, sizeof(index));
+
+    if (reference == NULL) {
+        ret = -1;
+    }
+
+    /* Random set and remove of keys in a sliding window, so that
+     * pages are released and reused at both ends of the range. */
+    for (int round = 0; ret == 0 && round < 20; round++) {
+        size_t window_start = (size_t)round * (PICOINDEX_TEST_KEYS / 40);
+        size_t window_size = PICOINDEX_TEST_KEYS / 2;
+
+        for (int step = 0; ret == 0 && step < 5000; step++) {
+            size_t i = window_start + (size_t)picoquic_test_uniform_random(&random_ctx, window_size);
+
+            if (picoquic_test_uniform_random(&random_ctx, 3) == 0) {
+                picoindex_remove(&index, key_base + i);
+                reference[i] = NULL;
+            }
+            else if (picoindex_set(&index, key_base + i, &reference[i]) != 0) {
+                DBG_PRINTF("Cannot set key %zu", i);
+                ret = -1;
+            }
+            else {
+                reference[i] = &reference[i];
+            }
+        }
+        /* Remove the keys before the next window */
+        for (size_t i = 0; ret == 0 && i < PICOINDEX_TEST_KEYS / 40; i++) {
+            picoindex_remove(&index, key_base + window_start + i);
+            reference[window_start + i] = NULL;
+        }
+        if (ret == 0) {
+            ret = picoindex_test_check(&index, reference, key_base);
+        }
+        if (ret == 0 && index.nb_values > 0 &&
+            (index.first_page > ((key_base + window_start + PICOINDEX_TEST_KEYS / 40) >> PICOINDEX_PAGE_BITS) + 1 ||
+            index.first_page + index.nb_pages < ((key_base + window_start + window_size) >> PICOINDEX_PAGE_BITS))) {
+            DBG_PRINTF("Unexpected page range, first %" PRIu64 ", nb %zu", index.first_page, index.nb_pages);
+            ret = -1;
+        }
+        if (ret == 0 && index.nb_free_pages > PICOINDEX_FREE_PAGES_MAX) {
+            DBG_PRINTF("Too many free pages: %zu", index.nb_free_pages);
+            ret = -1;
+        }
+    }
+
+    /* Insert keys before the current range */
+    for (size_t i = 0; ret == 0 && i < PICOINDEX_TEST_KEYS / 4; i += 7) {
+        if (picoindex_set(&index, key_base + i, &reference[i]) != 0) {
+            DBG_PRINTF("Cannot set key %zu", i);
+            ret = -1;
+        }
+        else {
+            reference[i] = &reference[i];
+        }
+    }
+    if (ret == 0) {
+        ret = picoindex_test_check(&index, reference, key_base);
+    }
+
+    /* Keys too far from the current range cannot be indexed */
+    if (ret == 0 && (picoindex_set(&index, key_base << 20, reference) == 0 ||
+        picoindex_get(&index, key_base << 20) != NULL)) {
+        DBG_PRINTF("%s", "Far key should not be indexed");
+        ret = -1;
+    }
+
+    /* Remove all keys, the index shall be empty */
+    for (size_t i = 0; ret == 0 && i < PICOINDEX_TEST_KEYS; i++) {
+        picoindex_remove(&index, key_base + i);
+        reference[i] = NULL;
+    }
+    if (ret == 0 && (index.nb_values != 0 || index.nb_pages != 0)) {
+        DBG_PRINTF("Index not empty, %zu values, %zu pages", index.nb_values, index.nb_pages);
+        ret = -1;
+    }
+
+    picoindex_clear(&index);
+    if (reference != NULL) {
+        free(reference);
+    }
+
+    return ret;
+}
+
+/* Verify that the streams of a connection are found through the index,
+ * with a sliding window of open streams, as in request per stream
+ * workloads, and that the index memory stays bounded. */
+static picoquic_cnx_t* stream_index_test_cnx(picoquic_quic_t** quic, uint64_t* simulated_time)
+{
+    picoquic_cnx_t* cnx = NULL;
+    struct sockaddr_in saddr;
+
+    *quic = picoquic_create(8, NULL, NULL, NULL, NULL, NULL,
+        NULL, NULL, NULL, NULL, *simulated_time, simulated_time, NULL, NULL, 0);
+    if (*quic != NULL) {
+        memset(&saddr, 0, sizeof(struct sockaddr_in));
+        saddr.sin_family = AF_INET;
+        cnx = picoquic_create_cnx(*quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&saddr, *simulated_time, 0, "test-sni", "test-alpn", 1);
+    }
+
+    return cnx;
+}
+
+static picoquic_stream_head_t* stream_index_tree_find(picoquic_cnx_t* cnx, uint64_t stream_id)
+{
+    picoquic_stream_head_t target;
+    target.stream_id = stream_id;
+
+    return (picoquic_stream_head_t*)picosplay_find(&cnx->stream_tree, (void*)&target);
+}
+
+int stream_index_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = stream_index_test_cnx(&quic, &simulated_time);
+    const uint64_t nb_streams = 100000;
+    const uint64_t window = 500;
+    size_t nb_pages_max = 0;
+
+    if (cnx == NULL) {
+        DBG_PRINTF("%s", "Cannot create the connection");
+        ret = -1;
+    }
+
+    for (uint64_t i = 0; ret == 0 && i < nb_streams; i++) {
+        uint64_t stream_id = 4 * i;
+        picoquic_stream_head_t* stream = picoquic_create_stream(cnx, stream_id);
+
+        if (stream == NULL || stream->is_not_indexed || picoquic_find_stream(cnx, stream_id) != stream) {
+            DBG_PRINTF("Cannot create or find stream %" PRIu64, stream_id);
+            ret = -1;
+        }
+        else if (i >= window) {
+            uint64_t old_id = 4 * (i - window);
+            picoquic_stream_head_t* old_stream = picoquic_find_stream(cnx, old_id);
+
+            if (old_stream == NULL || old_stream != stream_index_tree_find(cnx, old_id)) {
+                DBG_PRINTF("Cannot find stream %" PRIu64, old_id);
+                ret = -1;
+            }
+            else {
+                picoquic_delete_stream(cnx, old_stream);
+                if (picoquic_find_stream(cnx, old_id) != NULL) {
+                    DBG_PRINTF("Deleted stream %" PRIu64 " still found", old_id);
+                    ret = -1;
+                }
+            }
+        }
+        if (cnx->stream_index[0].nb_pages > nb_pages_max) {
+            nb_pages_max = cnx->stream_index[0].nb_pages;
+        }
+    }
+
+    if (ret == 0 && nb_pages_max > window / PICOINDEX_PAGE_SIZE + 2) {
+        DBG_PRINTF("Index uses up to %zu pages for %" PRIu64 " streams", nb_pages_max, window);
+        ret = -1;
+    }
+
+    /* A stream too far from the others is only found in the tree */
+    if (ret == 0) {
+        uint64_t far_id = ((uint64_t)1) << 40;
+        picoquic_stream_head_t* stream = picoquic_create_stream(cnx, far_id);
+
+        if (stream == NULL || !stream->is_not_indexed || cnx->nb_streams_not_indexed != 1 ||
+            picoquic_find_stream(cnx, far_id) != stream ||
+            picoquic_find_stream(cnx, 4 * (nb_streams - 1)) == NULL) {
+            DBG_PRINTF("%s", "Cannot find the stream that is not indexed");
+            ret = -1;
+        }
+        else {
+            picoquic_delete_stream(cnx, stream);
+            if (cnx->nb_streams_not_indexed != 0 || picoquic_find_stream(cnx, far_id) != NULL) {
+                DBG_PRINTF("%s", "Cannot delete the stream that is not indexed");
+                ret = -1;
+            }
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+/* Compare the cost of finding streams through the index and
+ * through the splay tree, with 10,000 open streams. */
+#define STREAM_INDEX_BENCH_STREAMS 10000
+#define STREAM_INDEX_BENCH_LOOKUPS 1000000
+
+int stream_index_bench_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = stream_index_test_cnx(&quic, &simulated_time);
+    uint64_t random_ctx = 0xABCDEF0123456789ull;
+
+    if (cnx == NULL) {
+        DBG_PRINTF("%s", "Cannot create the connection");
+        ret = -1;
+    }
+
+    for (uint64_t i = 0; ret == 0 && i < STREAM_INDEX_BENCH_STREAMS; i++) {
+        if (picoquic_create_stream(cnx, 4 * i) == NULL) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        uint64_t start_time = picoquic_current_time();
+        uint64_t index_time;
+        uint64_t tree_time;
+        uint64_t nb_found = 0;
+
+        for (int i = 0; i < STREAM_INDEX_BENCH_LOOKUPS; i++) {
+            uint64_t stream_id = 4 * picoquic_test_uniform_random(&random_ctx, STREAM_INDEX_BENCH_STREAMS);
+            nb_found += (picoquic_find_stream(cnx, stream_id) != NULL);
+        }
+        index_time = picoquic_current_time() - start_time;
+        start_time = picoquic_current_time();
+        for (int i = 0; i < STREAM_INDEX_BENCH_LOOKUPS; i++) {
+            uint64_t stream_id = 4 * picoquic_test_uniform_random(&random_ctx, STREAM_INDEX_BENCH_STREAMS);
+            nb_found += (stream_index_tree_find(cnx, stream_id) != NULL);
+        }
+        tree_time = picoquic_current_time() - start_time;
+
+        if (nb_found != 2 * STREAM_INDEX_BENCH_LOOKUPS) {
+            DBG_PRINTF("Found %" PRIu64 " streams out of %d", nb_found, 2 * STREAM_INDEX_BENCH_LOOKUPS);
+            ret = -1;
+        }
+        else {
+            DBG_PRINTF("%d streams, find: index %.3f us, splay %.3f us",
+                STREAM_INDEX_BENCH_STREAMS, ((double)index_time) / STREAM_INDEX_BENCH_LOOKUPS,
+                ((double)tree_time) / STREAM_INDEX_BENCH_LOOKUPS);
+        }
+    }
+
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
@@ -1249,6 +1249,8 @@ int tls_api_init_ctx(picoquic_test_tls_api_ctx_t** pctx, uint32_t proposed_versi
     return tls_api_init_ctx_ex(pctx, proposed_version, sni, alpn, p_simulated_time, ticket_file_name, token_file_name, force_zero_share, delayed_init, use_bad_crypt, NULL);
 }
 
+#define PICOQUIC_INCOMING_BATCH_TEST_MAX 64
+
 static picoquictest_sim_packet_t* tls_api_one_endpoint_packet_dequeue(
     picoquic_test_endpoint_t* endpoint)
 {
@@ -1266,11 +1268,62 @@ static picoquictest_sim_packet_t* tls_api_one_endpoint_packet_dequeue(
     return packet;
 }
 
+static int tls_api_one_endpoint_batch_dequeue(picoquic_test_endpoint_t* endpoint,
+    picoquic_quic_t* quic, uint64_t simulated_time, int* was_active, uint8_t recv_ecn)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packets[PICOQUIC_INCOMING_BATCH_TEST_MAX];
+    picoquic_incoming_datagram_t datagrams[PICOQUIC_INCOMING_BATCH_TEST_MAX];
+    struct sockaddr unspec;
+    size_t nb_packets = 0;
+    size_t nb_datagrams = 0;
+
+    unspec.sa_family = AF_UNSPEC;
+
+    /* Submit all the packets waiting in the queue as a single batch */
+    while (nb_packets < PICOQUIC_INCOMING_BATCH_TEST_MAX &&
+        (packets[nb_packets] = tls_api_one_endpoint_packet_dequeue(endpoint)) != NULL) {
+        picoquictest_sim_packet_t* packet = packets[nb_packets++];
+
+        if (packet->length > 16) {
+            datagrams[nb_datagrams].bytes = packet->bytes;
+            datagrams[nb_datagrams].length = packet->length;
+            datagrams[nb_datagrams].addr_from = (struct sockaddr*)&packet->addr_from;
+            datagrams[nb_datagrams].addr_to = (endpoint->addr_to_unspec) ? &unspec : (struct sockaddr*)&packet->addr_to;
+            datagrams[nb_datagrams].if_index_to = 0;
+            datagrams[nb_datagrams].received_ecn = (recv_ecn == 0) ? packet->ecn_mark : recv_ecn;
+            nb_datagrams++;
+        }
+    }
+
+    if (nb_datagrams > 0) {
+        ret = picoquic_incoming_packet_batch(quic, datagrams, nb_datagrams, NULL, simulated_time);
+        *was_active |= 1;
+
+        endpoint->next_time_ready = simulated_time +
+            nb_datagrams * endpoint->incoming_cpu_time;
+
+        if (ret != 0) {
+            ret = -1;
+        }
+    }
+
+    for (size_t i = 0; i < nb_packets; i++) {
+        free(packets[i]);
+    }
+
+    return ret;
+}
+
 static int tls_api_one_endpoint_dequeue(picoquic_test_endpoint_t *endpoint,
     picoquic_quic_t * quic, uint64_t simulated_time, int * was_active, uint8_t recv_ecn)
 {
     int ret = 0;
 
+    if (endpoint->use_batch_receive) {
+        return tls_api_one_endpoint_batch_dequeue(endpoint, quic, simulated_time, was_active, recv_ecn);
+    }
+
     /* If there is something to receive, do it now */
     picoquictest_sim_packet_t* packet = tls_api_one_endpoint_packet_dequeue(endpoint);
 
@@ -2205,6 +2258,44 @@ int tls_api_test()
     return tls_api_test_with_loss(NULL, PICOQUIC_INTERNAL_TEST_VERSION_1, PICOQUIC_TEST_SNI, PICOQUIC_TEST_ALPN);
 }
 
+/* Run a connection with open addressing tables on the server. The client
+ * connection already exists, so the client tables cannot be replaced. */
+int tls_api_open_tables_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+    int ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, PICOQUIC_INTERNAL_TEST_VERSION_1, NULL, NULL);
+
+    if (ret == 0) {
+        if (picoquic_set_open_addressing_tables(test_ctx->qclient, 1) == 0) {
+            DBG_PRINTF("%s", "Client tables replaced while a connection exists\n");
+            ret = -1;
+        }
+        else if (picoquic_set_open_addressing_tables(test_ctx->qserver, 1) != 0 ||
+            test_ctx->qserver->table_cnx_by_id->slots == NULL) {
+            DBG_PRINTF("%s", "Cannot set open addressing tables\n");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time, test_scenario_q_and_r, sizeof(test_scenario_q_and_r),
+            0, 0, 0, 0, 2000000);
+    }
+
+    if (ret == 0 && (test_ctx->cnx_server == NULL || picoquic_cnx_by_id(test_ctx->qserver,
+        test_ctx->cnx_server->first_local_cnxid_list->local_cnxid_first->cnx_id, NULL) != test_ctx->cnx_server)) {
+        DBG_PRINTF("%s", "Server connection not found by CID\n");
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+    }
+
+    return ret;
+}
+
 int tls_api_inject_hs_ack_test()
 {
     uint64_t simulated_time = 0;
@@ -2932,6 +3023,12 @@ int tls_api_one_scenario_verify(picoquic_test_tls_api_ctx_t* test_ctx)
         } else 
         if (ret == 0 && test_ctx->qserver->nb_data_nodes_allocated > test_ctx->qserver->nb_data_nodes_in_pool) {
             ret = -1;
+        } else
+        if (ret == 0 && test_ctx->qclient->nb_data_refs_allocated > test_ctx->qclient->nb_data_refs_in_pool) {
+            ret = -1;
+        } else
+        if (ret == 0 && test_ctx->qserver->nb_data_refs_allocated > test_ctx->qserver->nb_data_refs_in_pool) {
+            ret = -1;
         }
     }
     if (ret != 0)
@@ -3124,6 +3221,112 @@ int many_short_loss_test()
     return tls_api_one_scenario_test(test_scenario_more_streams, sizeof(test_scenario_more_streams), 0, 0x882818A881288848ull, 16000, 2000, 0, 0, NULL, NULL);
 }
 
+/* Zero copy receive test: run a long transfer with losses, so that
+ * data is received out of order and queued by reference to the decrypted
+ * packets. Verify that the data is received correctly, that references
+ * were actually used, and that all packets are released at the end.
+ */
+int zero_copy_receive_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+    int ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, 0, NULL, NULL);
+
+    if (ret == 0) {
+        picoquic_set_zero_copy_receive(test_ctx->qclient, 1);
+        picoquic_set_zero_copy_receive(test_ctx->qserver, 1);
+
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_very_long, sizeof(test_scenario_very_long), 0, 0x30000, 128000, 0, 2210000);
+    }
+
+    if (ret == 0 && test_ctx->qclient->nb_data_refs_allocated_max == 0) {
+        DBG_PRINTF("%s", "No stream data was received by reference\n");
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+/* Compact sent packets test: transfer data with losses while the sent
+ * packets only keep a manifest of their frames, so that lost stream data
+ * has to be copied from the data retained in the streams.
+ */
+int compact_sent_packets_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+    int ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, 0, NULL, NULL);
+
+    if (ret == 0) {
+        picoquic_set_compact_sent_packets(test_ctx->qclient, 1);
+        picoquic_set_compact_sent_packets(test_ctx->qserver, 1);
+
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_very_long, sizeof(test_scenario_very_long), 0, 0x30000, 128000, 0, 2210000);
+    }
+
+    if (ret == 0 && test_ctx->cnx_server->nb_packets_compacted == 0) {
+        DBG_PRINTF("%s", "No compact packet record on the server\n");
+        ret = -1;
+    }
+
+    if (ret == 0 && test_ctx->cnx_server->nb_retransmission_total == 0) {
+        DBG_PRINTF("%s", "No data was repeated from compact records\n");
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
+/* Incoming batch test: the endpoints are slow to process incoming
+ * packets, so packets accumulate in their input queues and are submitted
+ * together with picoquic_incoming_packet_batch. Verify that the transfer
+ * completes and that packets were actually decrypted in batches.
+ */
+int incoming_batch_test()
+{
+    uint64_t simulated_time = 0;
+    picoquic_test_tls_api_ctx_t* test_ctx = NULL;
+
+    int ret = tls_api_one_scenario_init(&test_ctx, &simulated_time, 0, NULL, NULL);
+
+    if (ret == 0) {
+        test_ctx->client_endpoint.use_batch_receive = 1;
+        test_ctx->client_endpoint.incoming_cpu_time = 20;
+        test_ctx->server_endpoint.use_batch_receive = 1;
+        test_ctx->server_endpoint.incoming_cpu_time = 20;
+
+        ret = tls_api_one_scenario_body(test_ctx, &simulated_time,
+            test_scenario_very_long, sizeof(test_scenario_very_long), 0, 0x30000, 128000, 0, 2500000);
+    }
+
+    if (ret == 0 && test_ctx->cnx_client->nb_packets_batch_decrypted == 0 &&
+        test_ctx->cnx_server->nb_packets_batch_decrypted == 0) {
+        DBG_PRINTF("%s", "No packet was decrypted in a batch\n");
+        ret = -1;
+    }
+
+    if (test_ctx != NULL) {
+        tls_api_delete_ctx(test_ctx);
+        test_ctx = NULL;
+    }
+
+    return ret;
+}
+
 /* Implicit ACK test: verify that the queues of initial and
  * handshake packets are empty after reaching the ready state
  */
@@ -0,0 +1,396 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2025, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "picoquic_utils.h"
+#include "picosplay.h"
+#include "picowheel.h"
+
+/* Test the timing wheel against the splay tree that it replaces
+ * for the scheduling of connections. Both structures are given the
+ * same sequence of operations, and shall return the same first node
+ * at each step, including when several nodes have the same wake time.
+ */
+
+typedef struct st_wheel_test_node_t {
+    uint64_t wake_time;
+    int is_inserted;
+    picosplay_node_t splay_node;
+    picowheel_node_t wheel_node;
+} wheel_test_node_t;
+
+static int64_t wheel_test_compare(void* l, void* r)
+{
+    const uint64_t ltime = ((wheel_test_node_t*)l)->wake_time;
+    const uint64_t rtime = ((wheel_test_node_t*)r)->wake_time;
+    if (ltime < rtime) return -1;
+    if (ltime > rtime) return 1;
+    return 0;
+}
+
+static picosplay_node_t* wheel_test_create_node(void* v)
+{
+    return &((wheel_test_node_t*)v)->splay_node;
+}
+
+static void* wheel_test_node_value(picosplay_node_t* node)
+{
+    return (node == NULL) ? NULL : (void*)((char*)node - offsetof(struct st_wheel_test_node_t, splay_node));
+}
+
+static void wheel_test_delete_node(void* tree, picosplay_node_t* node)
+{
+#ifdef _WINDOWS
+    UNREFERENCED_PARAMETER(tree);
+#endif
+    memset(node, 0, sizeof(picosplay_node_t));
+}
+
+static wheel_test_node_t* wheel_test_node_from_wheel(picowheel_node_t* node)
+{
+    return (node == NULL) ? NULL : (wheel_test_node_t*)((char*)node - offsetof(struct st_wheel_test_node_t, wheel_node));
+}
+
+static void wheel_test_remove(picosplay_tree_t* tree, picowheel_t* wheel, wheel_test_node_t* node)
+{
+    if (node->is_inserted) {
+        picosplay_delete_hint(tree, &node->splay_node);
+        node->is_inserted = 0;
+    }
+    /* Removing a node that is not in the wheel shall be harmless */
+    picowheel_remove(wheel, &node->wheel_node);
+}
+
+static void wheel_test_insert(picosplay_tree_t* tree, picowheel_t* wheel, wheel_test_node_t* node, uint64_t wake_time)
+{
+    node->wake_time = wake_time;
+    node->is_inserted = 1;
+    picosplay_insert(tree, node);
+    picowheel_insert(wheel, &node->wheel_node, wake_time);
+}
+
+/* Pick a wake time the way connections do: mostly short delays, some
+ * keep alive and idle timers, some times in the past, some times
+ * rounded to produce ties, and a few "never". */
+static uint64_t wheel_test_pick_time(uint64_t current_time, uint64_t* random_ctx)
+{
+    uint64_t wake_time;
+    uint64_t r = picoquic_test_uniform_random(random_ctx, 16);
+
+    switch (r) {
+    case 0:
+        wake_time = current_time;
+        break;
+    case 1:
+        wake_time = UINT64_MAX;
+        break;
+    case 2:
+        wake_time = current_time - picoquic_test_uniform_random(random_ctx, 100000);
+        break;
+    case 3:
+        wake_time = current_time + 1000000 * (1 + picoquic_test_uniform_random(random_ctx, 30));
+        break;
+    case 4:
+    case 5:
+        wake_time = ((current_time / 1000) + picoquic_test_uniform_random(random_ctx, 8)) * 1000;
+        break;
+    case 6:
+        wake_time = current_time + picoquic_test_uniform_random(random_ctx, 0x1000000000ull);
+        break;
+    default:
+        wake_time = current_time + picoquic_test_uniform_random(random_ctx, 50000);
+        break;
+    }
+    return wake_time;
+}
+
+int wheel_test()
+{
+    int ret = 0;
+    const size_t nb_nodes = 1000;
+    const size_t nb_steps = 200000;
+    uint64_t random_ctx = 0x5EEDF00DBA5EBA11ull;
+    uint64_t current_time = 0x100000000ull;
+    picosplay_tree_t tree;
+    picowheel_t* wheel = (picowheel_t*)malloc(sizeof(picowheel_t));
+    wheel_test_node_t* nodes = (wheel_test_node_t*)calloc(nb_nodes, sizeof(wheel_test_node_t));
+
+    picosplay_init_tree(&tree, wheel_test_compare, wheel_test_create_node, wheel_test_delete_node, wheel_test_node_value);
+
+    if (wheel == NULL || nodes == NULL) {
+        DBG_PRINTF("%s", "Cannot allocate the test wheel.\n");
+        ret = -1;
+    }
+    else {
+        picowheel_init(wheel);
+
+        if (picowheel_first(wheel, current_time) != NULL) {
+            DBG_PRINTF("%s", "Empty wheel returns a node.\n");
+            ret = -1;
+        }
+
+        for (size_t i = 0; i < nb_nodes; i++) {
+            wheel_test_insert(&tree, wheel, &nodes[i], wheel_test_pick_time(current_time, &random_ctx));
+        }
+
+        for (size_t step = 0; ret == 0 && step < nb_steps; step++) {
+            wheel_test_node_t* node = (wheel_test_node_t*)wheel_test_node_value(picosplay_first(&tree));
+            wheel_test_node_t* w_node = wheel_test_node_from_wheel(picowheel_first(wheel, current_time));
+
+            if (node != w_node || (size_t)tree.size != wheel->size) {
+                DBG_PRINTF("Step %zu, wheel returns node %p (size %zu), expected %p (size %d)\n",
+                    step, (void*)w_node, wheel->size, (void*)node, tree.size);
+                ret = -1;
+                break;
+            }
+
+            switch (picoquic_test_uniform_random(&random_ctx, 4)) {
+            case 0:
+                /* A connection that was not the first one receives a packet */
+                node = &nodes[picoquic_test_uniform_random(&random_ctx, nb_nodes)];
+                wheel_test_remove(&tree, wheel, node);
+                wheel_test_insert(&tree, wheel, node, wheel_test_pick_time(current_time, &random_ctx));
+                break;
+            case 1:
+                /* A connection is deleted, or recreated */
+                node = &nodes[picoquic_test_uniform_random(&random_ctx, nb_nodes)];
+                if (node->is_inserted) {
+                    wheel_test_remove(&tree, wheel, node);
+                }
+                else {
+                    wheel_test_insert(&tree, wheel, node, wheel_test_pick_time(current_time, &random_ctx));
+                }
+                break;
+            default:
+                /* The first connection is processed, and rescheduled */
+                if (node != NULL) {
+                    if (node->wake_time > current_time && node->wake_time != UINT64_MAX) {
+                        current_time = node->wake_time;
+                    }
+                    wheel_test_remove(&tree, wheel, node);
+                    wheel_test_insert(&tree, wheel, node, wheel_test_pick_time(current_time, &random_ctx));
+                }
+                break;
+            }
+        }
+
+        /* Empty the wheel in order */
+        while (ret == 0 && tree.size > 0) {
+            wheel_test_node_t* node = (wheel_test_node_t*)wheel_test_node_value(picosplay_first(&tree));
+            wheel_test_node_t* w_node = wheel_test_node_from_wheel(picowheel_first(wheel, current_time));
+
+            if (node != w_node) {
+                DBG_PRINTF("Draining, wheel returns node %p, expected %p\n", (void*)w_node, (void*)node);
+                ret = -1;
+            }
+            else {
+                wheel_test_remove(&tree, wheel, node);
+            }
+        }
+
+        if (ret == 0 && (wheel->size != 0 || picowheel_first(wheel, current_time) != NULL)) {
+            DBG_PRINTF("Wheel not empty after draining, size %zu\n", wheel->size);
+            ret = -1;
+        }
+
+        /* Looking for the next timer shall not move the wheel past the
+         * current time, so that a packet arriving before that timer is
+         * scheduled in the wheel and not in the late tree. */
+        if (ret == 0) {
+            picowheel_node_t* first;
+
+            picowheel_insert(wheel, &nodes[0].wheel_node, current_time + 10000000);
+            first = picowheel_first(wheel, current_time);
+            picowheel_insert(wheel, &nodes[1].wheel_node, current_time + 1000);
+            if (first != &nodes[0].wheel_node || picowheel_first(wheel, current_time) != &nodes[1].wheel_node ||
+                wheel->late.size != 0) {
+                DBG_PRINTF("Arrival before the next timer, first %p, late size %d\n",
+                    (void*)picowheel_first(wheel, current_time), wheel->late.size);
+                ret = -1;
+            }
+            picowheel_remove(wheel, &nodes[0].wheel_node);
+            picowheel_remove(wheel, &nodes[1].wheel_node);
+        }
+    }
+
+    if (wheel != NULL) {
+        free(wheel);
+    }
+    if (nodes != NULL) {
+        free(nodes);
+    }
+
+    return ret;
+}
+
+/* Compare the cost of the splay tree and of the timing wheel for
+ * large numbers of mostly idle connections. Each step processes the
+ * first connection and reschedules it, mostly with keep alive or idle
+ * timers, and one step in four simulates the arrival of a packet for a
+ * random connection. The sequence of connections returned by both
+ * structures is checked to be identical.
+ * In the clock driven variant, the time advances by up to 100us at each
+ * step, and the first connection is only processed once its wake time is
+ * reached. Otherwise, a packet arrives, and the connection is scheduled
+ * before the next timer. The largest number of late nodes in the wheel
+ * is reported. */
+#define WHEEL_BENCH_STEPS 1000000
+
+static int wheel_bench_one(wheel_test_node_t* nodes, size_t nb_nodes, picosplay_tree_t* tree, picowheel_t* wheel,
+    int is_clock_driven, uint64_t* checksum, uint64_t* duration, size_t* late_max)
+{
+    int ret = 0;
+    uint64_t random_ctx = 0xBE4C4BE4C4BE4C4ull;
+    uint64_t current_time = 0x100000000ull;
+    uint64_t start_time;
+
+    *checksum = 0;
+    *late_max = 0;
+
+    for (size_t i = 0; i < nb_nodes; i++) {
+        uint64_t wake_time = current_time + picoquic_test_uniform_random(&random_ctx, 30000000);
+        nodes[i].wake_time = wake_time;
+        if (tree != NULL) {
+            picosplay_insert(tree, &nodes[i]);
+        }
+        else {
+            picowheel_insert(wheel, &nodes[i].wheel_node, wake_time);
+        }
+    }
+    start_time = picoquic_current_time();
+
+    for (size_t step = 0; ret == 0 && step < WHEEL_BENCH_STEPS; step++) {
+        wheel_test_node_t* node = NULL;
+        uint64_t wake_time;
+
+        if (is_clock_driven) {
+            current_time += picoquic_test_uniform_random(&random_ctx, 100);
+            node = (tree != NULL) ? (wheel_test_node_t*)wheel_test_node_value(picosplay_first(tree)) :
+                wheel_test_node_from_wheel(picowheel_first(wheel, current_time));
+            if (node != NULL && node->wake_time > current_time) {
+                node = NULL;
+            }
+        }
+
+        if (node == NULL && (is_clock_driven || (step & 3) == 3)) {
+            node = &nodes[picoquic_test_uniform_random(&random_ctx, nb_nodes)];
+            wake_time = current_time + picoquic_test_uniform_random(&random_ctx, 1000);
+        }
+        else {
+            if (node == NULL) {
+                node = (tree != NULL) ? (wheel_test_node_t*)wheel_test_node_value(picosplay_first(tree)) :
+                    wheel_test_node_from_wheel(picowheel_first(wheel, current_time));
+            }
+            if (node == NULL) {
+                ret = -1;
+                break;
+            }
+            if (node->wake_time > current_time) {
+                current_time = node->wake_time;
+            }
+            if (picoquic_test_uniform_random(&random_ctx, 10) == 0) {
+                wake_time = current_time + picoquic_test_uniform_random(&random_ctx, 20000);
+            }
+            else {
+                wake_time = current_time + 1000000 + picoquic_test_uniform_random(&random_ctx, 29000000);
+            }
+        }
+        *checksum = (*checksum * 31) + (uint64_t)(node - nodes);
+
+        if (tree != NULL) {
+            picosplay_delete_hint(tree, &node->splay_node);
+            node->wake_time = wake_time;
+            picosplay_insert(tree, node);
+        }
+        else {
+            picowheel_remove(wheel, &node->wheel_node);
+            node->wake_time = wake_time;
+            picowheel_insert(wheel, &node->wheel_node, wake_time);
+            if ((size_t)wheel->late.size > *late_max) {
+                *late_max = (size_t)wheel->late.size;
+            }
+        }
+    }
+
+    *duration = picoquic_current_time() - start_time;
+
+    return ret;
+}
+
+int wheel_bench_test()
+{
+    int ret = 0;
+    const size_t nb_nodes[3] = { 1000, 100000, 1000000 };
+
+    for (size_t n = 0; ret == 0 && n < sizeof(nb_nodes) / sizeof(size_t); n++) {
+        wheel_test_node_t* nodes = (wheel_test_node_t*)calloc(nb_nodes[n], sizeof(wheel_test_node_t));
+        picowheel_t* wheel = (picowheel_t*)malloc(sizeof(picowheel_t));
+        picosplay_tree_t tree;
+
+        picosplay_init_tree(&tree, wheel_test_compare, wheel_test_create_node, wheel_test_delete_node, wheel_test_node_value);
+
+        if (nodes == NULL || wheel == NULL) {
+            DBG_PRINTF("Cannot allocate %zu nodes\n", nb_nodes[n]);
+            ret = -1;
+        }
+        else {
+            for (int is_clock_driven = 0; ret == 0 && is_clock_driven < 2; is_clock_driven++) {
+                uint64_t splay_checksum = 0;
+                uint64_t splay_duration = 0;
+                uint64_t wheel_checksum = 0;
+                uint64_t wheel_duration = 0;
+                size_t late_max = 0;
+
+                picosplay_empty_tree(&tree);
+                memset(nodes, 0, nb_nodes[n] * sizeof(wheel_test_node_t));
+                picowheel_init(wheel);
+                ret = wheel_bench_one(nodes, nb_nodes[n], &tree, NULL, is_clock_driven, &splay_checksum, &splay_duration, &late_max);
+                if (ret == 0) {
+                    ret = wheel_bench_one(nodes, nb_nodes[n], NULL, wheel, is_clock_driven, &wheel_checksum, &wheel_duration, &late_max);
+                }
+                if (ret == 0 && splay_checksum != wheel_checksum) {
+                    DBG_PRINTF("%zu nodes, %s, wheel and splay schedules differ.\n", nb_nodes[n],
+                        (is_clock_driven) ? "clock" : "next");
+                    ret = -1;
+                }
+                if (ret == 0) {
+                    DBG_PRINTF("%zu nodes, %s, %d steps, splay: %.3f us, wheel: %.3f us per step, late max: %zu\n",
+                        nb_nodes[n], (is_clock_driven) ? "clock" : "next", WHEEL_BENCH_STEPS,
+                        ((double)splay_duration) / WHEEL_BENCH_STEPS, ((double)wheel_duration) / WHEEL_BENCH_STEPS,
+                        late_max);
+                }
+            }
+            picosplay_empty_tree(&tree);
+        }
+
+        if (nodes != NULL) {
+            free(nodes);
+        }
+        if (wheel != NULL) {
+            free(wheel);
+        }
+    }
+
+    return ret;
+}
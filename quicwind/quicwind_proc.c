@@ -73,6 +73,7 @@ typedef struct st_quicwind_callback_ctx_t {
     int nb_open_streams;
     picoquic_alpn_enum alpn;
     int progress_observed;
+    h3zero_callback_ctx_t* h3_ctx; /* H3 control and QPACK streams */
 } quicwind_callback_ctx_t;
 
 /* Loop callback context.
@@ -148,6 +149,10 @@ static void quicwind_delete_context(picoquic_cnx_t * cnx, quicwind_callback_ctx_
         quicwind_delete_stream_context(ctx, stream_ctx);
     }
 
+    if (ctx->h3_ctx != NULL) {
+        h3zero_callback_delete_context(cnx, ctx->h3_ctx);
+    }
+
     free(ctx);
 }
 
@@ -175,7 +180,11 @@ int quicwind_callback(picoquic_cnx_t* cnx,
         /* TODO: parse the frames. */
         /* TODO: check settings frame */
         stream_ctx = quicwind_find_stream(ctx, stream_id);
-        if (stream_ctx != NULL && stream_ctx->F != NULL) {
+        if (stream_ctx == NULL && ctx->h3_ctx != NULL && !IS_BIDIR_STREAM_ID(stream_id) && !IS_CLIENT_STREAM_ID(stream_id)) {
+            /* Control and QPACK streams opened by the server */
+            ret = h3zero_client_process_remote_unidir(cnx, ctx->h3_ctx, stream_id, bytes, length);
+        }
+        else if (stream_ctx != NULL && stream_ctx->F != NULL) {
             if (length > 0) {
                 switch (ctx->alpn) {
                 case picoquic_alpn_http_3: {
@@ -195,6 +204,9 @@ int quicwind_callback(picoquic_cnx_t* cnx,
                             bytes += available_data;
                         }
                     }
+                    if (ret == 0 && ctx->h3_ctx != NULL) {
+                        ret = h3zero_qpack_send_instructions(cnx, ctx->h3_ctx);
+                    }
                     break;
                 }
                 case picoquic_alpn_http_0_9:
@@ -365,6 +377,8 @@ int quicwind_start_download(picoquic_cnx_t * cnx, quicwind_callback_ctx_t * ctx,
         memset(s_ctx, 0, sizeof(quicwind_stream_ctx_t));
         /* Set stream ID */
         s_ctx->stream_id = ((uint64_t)ctx->nb_client_streams)*4u;
+        s_ctx->stream_state.h3_ctx = ctx->h3_ctx;
+        s_ctx->stream_state.stream_id = s_ctx->stream_id;
 
         /* make sure that the doc name is properly formated */
         path = (uint8_t *)doc_name;
@@ -412,8 +426,9 @@ int quicwind_start_download(picoquic_cnx_t * cnx, quicwind_callback_ctx_t * ctx,
             /* Format the protocol specific request */
             switch (ctx->alpn) {
             case picoquic_alpn_http_3:
-                ret = h3zero_client_create_stream_request(
-                    request, sizeof(request), path, path_len, 0, cnx->sni, &request_length);
+                ret = h3zero_client_create_stream_request_qpack(
+                    (ctx->h3_ctx == NULL) ? NULL : &ctx->h3_ctx->qpack, s_ctx->stream_id,
+                    request, sizeof(request), path, path_len, NULL, 0, 0, cnx->sni, &request_length);
                 break;
             case picoquic_alpn_http_0_9:
             default:
@@ -426,6 +441,9 @@ int quicwind_start_download(picoquic_cnx_t * cnx, quicwind_callback_ctx_t * ctx,
             if (ret == 0) {
                 ret = picoquic_add_to_stream(cnx, s_ctx->stream_id, request, request_length, 1);
             }
+            if (ret == 0 && ctx->h3_ctx != NULL) {
+                ret = h3zero_qpack_send_instructions(cnx, ctx->h3_ctx);
+            }
 
             if (ret < 0) {
                 AppendText(_T("Something really bad happened - closing the connection\r\n"));
@@ -499,7 +517,9 @@ int quicwind_start_connection(picoquic_quic_t * qclient,
                 if (ret == 0) {
                     switch (ctx->alpn) {
                     case picoquic_alpn_http_3:
-                        ret = h3zero_protocol_init(cnx_client);
+                        if ((ctx->h3_ctx = h3zero_client_protocol_init(cnx_client)) == NULL) {
+                            ret = -1;
+                        }
                         break;
                     default:
                         break;